@@ -9,6 +9,7 @@
 #include "ai_audio_cloud_asr.h"
 #include "ai_audio_player.h"
 #include "ai_audio_input.h"
+#include "ai_audio_trace.h"
 /***********************************************************
 ************************macro define************************
 ***********************************************************/
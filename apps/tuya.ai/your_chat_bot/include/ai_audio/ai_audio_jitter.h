@@ -0,0 +1,144 @@
+/**
+ * @file ai_audio_jitter.h
+ * @brief Jitter buffer between the MP3 stream and the speaker.
+ *
+ * Decoded PCM frames are kept in a fixed pool. Playback waits until a
+ * prebuffer watermark is reached, the watermark follows the longest gaps seen
+ * between data arrivals and grows after each underrun. On an underrun the last
+ * frame is played again with a fade out, and playback resumes with a fade in,
+ * so that gaps are heard as short dips instead of clicks.
+ *
+ * ai_audio_jitter_arrival is called by the stream writer, the rest by the
+ * player task. The arrivals are shared with ai_audio_jitter_reset,
+ * ai_audio_jitter_frame_pop and ai_audio_jitter_stats_get, the caller holds
+ * one lock around these calls.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __AI_AUDIO_JITTER_H__
+#define __AI_AUDIO_JITTER_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#ifndef AI_AUDIO_PLAYER_PREBUF_MIN_MS
+#define AI_AUDIO_PLAYER_PREBUF_MIN_MS 100
+#endif
+
+#ifndef AI_AUDIO_PLAYER_PREBUF_MAX_MS
+#define AI_AUDIO_PLAYER_PREBUF_MAX_MS 600
+#endif
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef void *AI_AUDIO_JITTER_HANDLE;
+
+typedef struct {
+    uint32_t underruns;     // underruns in the current stream
+    uint32_t latency_ms;    // first arrival to first frame played
+    uint32_t rebuffer_ms;   // time spent waiting after underruns
+    uint32_t watermark_ms;  // current prebuffer watermark
+    uint32_t gap_peak_ms;   // longest recent gap between arrivals
+} AI_AUDIO_JITTER_STATS_T;
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+/**
+ * @brief Creates a jitter buffer.
+ * @param frame_num Number of PCM frames in the pool, one of them holds the last played frame.
+ * @param frame_size Size in bytes of one PCM frame.
+ * @param handle Pointer to store the jitter buffer handle.
+ * @return OPERATE_RET - OPRT_OK on success, otherwise an error code.
+ */
+OPERATE_RET ai_audio_jitter_create(uint32_t frame_num, uint32_t frame_size, AI_AUDIO_JITTER_HANDLE *handle);
+
+/**
+ * @brief Frees a jitter buffer.
+ * @param handle The jitter buffer handle.
+ * @return None
+ */
+void ai_audio_jitter_destroy(AI_AUDIO_JITTER_HANDLE handle);
+
+/**
+ * @brief Drops the buffered frames and starts a new stream, the learned gaps are kept.
+ * @param handle The jitter buffer handle.
+ * @return None
+ */
+void ai_audio_jitter_reset(AI_AUDIO_JITTER_HANDLE handle);
+
+/**
+ * @brief Records the arrival of stream data.
+ * @param handle The jitter buffer handle.
+ * @param now_ms Current time in milliseconds.
+ * @return None
+ */
+void ai_audio_jitter_arrival(AI_AUDIO_JITTER_HANDLE handle, uint32_t now_ms);
+
+/**
+ * @brief Gets a free frame to decode into.
+ * @param handle The jitter buffer handle.
+ * @return uint8_t* - The frame buffer, NULL if the pool is full.
+ */
+uint8_t *ai_audio_jitter_frame_alloc(AI_AUDIO_JITTER_HANDLE handle);
+
+/**
+ * @brief Queues the frame returned by ai_audio_jitter_frame_alloc.
+ * @param handle The jitter buffer handle.
+ * @param len Length of the decoded PCM in bytes, 16 bits per sample.
+ * @param sample_rate Sample rate of the frame.
+ * @param channels Number of interleaved channels.
+ * @return None
+ */
+void ai_audio_jitter_frame_commit(AI_AUDIO_JITTER_HANDLE handle, uint32_t len, uint32_t sample_rate,
+                                  uint8_t channels);
+
+/**
+ * @brief Gets the next frame to play.
+ * @param handle The jitter buffer handle.
+ * @param now_ms Current time in milliseconds.
+ * @param is_eof Whether all the stream data has arrived, the watermark is then ignored.
+ * @param pcm Pointer to store the frame.
+ * @param len Pointer to store the frame length.
+ * @return OPERATE_RET - OPRT_OK if a frame is returned, it must be given back with
+ *         ai_audio_jitter_frame_release. OPRT_RECV_DA_NOT_ENOUGH while buffering.
+ */
+OPERATE_RET ai_audio_jitter_frame_pop(AI_AUDIO_JITTER_HANDLE handle, uint32_t now_ms, uint8_t is_eof, uint8_t **pcm,
+                                      uint32_t *len);
+
+/**
+ * @brief Gives back the frame returned by ai_audio_jitter_frame_pop once it is played.
+ * @param handle The jitter buffer handle.
+ * @return None
+ */
+void ai_audio_jitter_frame_release(AI_AUDIO_JITTER_HANDLE handle);
+
+/**
+ * @brief Gets the number of frames waiting to be played.
+ * @param handle The jitter buffer handle.
+ * @return uint32_t - The number of frames.
+ */
+uint32_t ai_audio_jitter_count(AI_AUDIO_JITTER_HANDLE handle);
+
+/**
+ * @brief Gets the statistics of the current stream.
+ * @param handle The jitter buffer handle.
+ * @param stats Pointer to store the statistics.
+ * @return None
+ */
+void ai_audio_jitter_stats_get(AI_AUDIO_JITTER_HANDLE handle, AI_AUDIO_JITTER_STATS_T *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AI_AUDIO_JITTER_H__ */
@@ -0,0 +1,115 @@
+/**
+ * @file ai_audio_trace.h
+ * @brief Latency trace of the voice interaction stages.
+ *
+ * Each utterance gets an ID when valid voice is detected, then the first time
+ * every later stage is reached is stamped with the system millisecond tick
+ * into a lock-free ring. The per-stage spans are aggregated from the ring on
+ * demand and dumped by the "ai_trace" cli command.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __AI_AUDIO_TRACE_H__
+#define __AI_AUDIO_TRACE_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#ifndef AI_AUDIO_TRACE_RING_SIZE
+#define AI_AUDIO_TRACE_RING_SIZE 256
+#endif
+
+#if defined(ENABLE_AI_AUDIO_TRACE) && (ENABLE_AI_AUDIO_TRACE == 1)
+#define AI_AUDIO_TRACE_BEGIN(ts_ms) ai_audio_trace_begin(ts_ms)
+#define AI_AUDIO_TRACE_MARK(stage)  ai_audio_trace_mark(stage)
+#else
+#define AI_AUDIO_TRACE_BEGIN(ts_ms)
+#define AI_AUDIO_TRACE_MARK(stage)
+#endif
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef enum {
+    AI_AUDIO_TRACE_VOICE_START = 0, // valid voice detected in the mic data
+    AI_AUDIO_TRACE_UPLOAD_START,    // upload event started
+    AI_AUDIO_TRACE_UPLOAD_FIRST,    // first audio packet sent
+    AI_AUDIO_TRACE_UPLOAD_END,      // last audio packet sent
+    AI_AUDIO_TRACE_ASR_TEXT,        // asr text received
+    AI_AUDIO_TRACE_NLG_FIRST,       // first reply text received
+    AI_AUDIO_TRACE_TTS_FIRST,       // first reply audio received
+    AI_AUDIO_TRACE_PLAY_FIRST,      // first reply audio frame played
+    AI_AUDIO_TRACE_STAGE_NUM,
+} AI_AUDIO_TRACE_STAGE_E;
+
+typedef struct {
+    uint32_t count; // utterances with this span
+    uint32_t p50_ms;
+    uint32_t p90_ms;
+    uint32_t p99_ms;
+    uint32_t max_ms;
+} AI_AUDIO_TRACE_STATS_T;
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+/**
+ * @brief Initializes the trace ring and registers the cli command.
+ * @param None
+ * @return OPERATE_RET - OPRT_OK on success, otherwise an error code.
+ */
+OPERATE_RET ai_audio_trace_init(void);
+
+/**
+ * @brief Starts a new utterance, its voice start stage is stamped with ts_ms.
+ * @param ts_ms Time the valid voice was captured, in system milliseconds.
+ * @return uint32_t - The utterance ID, 0 if the trace is not initialized.
+ */
+uint32_t ai_audio_trace_begin(uint32_t ts_ms);
+
+/**
+ * @brief Stamps a stage of the current utterance, only the first call per utterance is kept.
+ * @param stage The stage reached.
+ * @return None
+ */
+void ai_audio_trace_mark(AI_AUDIO_TRACE_STAGE_E stage);
+
+/**
+ * @brief Drops the recorded utterances.
+ * @param None
+ * @return None
+ */
+void ai_audio_trace_clear(void);
+
+/**
+ * @brief Aggregates the utterances in the ring.
+ *
+ * The span of a stage runs from the closest earlier stage recorded for the
+ * same utterance, so stages[AI_AUDIO_TRACE_VOICE_START] is always empty.
+ *
+ * @param stages Array of AI_AUDIO_TRACE_STAGE_NUM entries to store the span of each stage.
+ * @param reply Pointer to store the span from the last audio packet sent to the first audio frame played.
+ * @return uint32_t - The number of utterances found.
+ */
+uint32_t ai_audio_trace_stats_get(AI_AUDIO_TRACE_STATS_T *stages, AI_AUDIO_TRACE_STATS_T *reply);
+
+/**
+ * @brief Logs the per-stage percentiles.
+ * @param None
+ * @return None
+ */
+void ai_audio_trace_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AI_AUDIO_TRACE_H__ */
@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Pack the LVGL C-array fonts and images of the chat bot into one asset file.
+
+The output is read at runtime by src/display/asset/ui_asset.c, either from a
+file system path or from a raw flash partition. All fields are little endian.
+
+    header  : magic "TYAP", u16 version, u16 entry_num, u32 total_size, u32 rsvd
+    entry   : char name[28], u8 type, u8 rsvd[3], u32 offset, u32 size
+    font    : u32 glyph_num, i16 line_height, i16 base_line,
+              i8 underline_position, u8 underline_thickness, u8 bpp, u8 rsvd,
+              glyph_num * (u32 unicode, u32 offset)   -- sorted by unicode
+              glyph: u16 adv_w, u8 box_w, u8 box_h, i8 ofs_x, i8 ofs_y, u16 rsvd, bitmap
+    image   : u8 cf, u8 rsvd, u16 w, u16 h, u16 stride, u32 data_size, data
+
+Kerning tables of the C fonts are not packed.
+"""
+import argparse
+import glob
+import os
+import re
+import struct
+
+ASSET_MAGIC = b"TYAP"
+ASSET_VERSION = 1
+ASSET_NAME_LEN = 28
+
+ASSET_TYPE_FONT = 1
+ASSET_TYPE_IMAGE = 2
+
+HEADER_FMT = "<4sHHII"
+ENTRY_FMT = "<28sB3xII"
+FONT_HEAD_FMT = "<IhhbBBx"
+GLYPH_IDX_FMT = "<II"
+GLYPH_HEAD_FMT = "<HBBbbH"
+IMAGE_HEAD_FMT = "<BxHHHI"
+
+# lv_color_format_t values of LVGL v9
+COLOR_FORMAT = {
+    "LV_COLOR_FORMAT_L8": 0x06,
+    "LV_COLOR_FORMAT_I1": 0x07,
+    "LV_COLOR_FORMAT_I2": 0x08,
+    "LV_COLOR_FORMAT_I4": 0x09,
+    "LV_COLOR_FORMAT_I8": 0x0A,
+    "LV_COLOR_FORMAT_A1": 0x0B,
+    "LV_COLOR_FORMAT_A2": 0x0C,
+    "LV_COLOR_FORMAT_A4": 0x0D,
+    "LV_COLOR_FORMAT_A8": 0x0E,
+    "LV_COLOR_FORMAT_RGB888": 0x0F,
+    "LV_COLOR_FORMAT_ARGB8888": 0x10,
+    "LV_COLOR_FORMAT_XRGB8888": 0x11,
+    "LV_COLOR_FORMAT_RGB565": 0x12,
+    "LV_COLOR_FORMAT_RGB565A8": 0x14,
+}
+
+CMAP_FORMAT0_FULL = "LV_FONT_FMT_TXT_CMAP_FORMAT0_FULL"
+CMAP_SPARSE_FULL = "LV_FONT_FMT_TXT_CMAP_SPARSE_FULL"
+CMAP_FORMAT0_TINY = "LV_FONT_FMT_TXT_CMAP_FORMAT0_TINY"
+CMAP_SPARSE_TINY = "LV_FONT_FMT_TXT_CMAP_SPARSE_TINY"
+
+
+def strip_comments(src):
+    src = re.sub(r"/\*.*?\*/", "", src, flags=re.S)
+    return re.sub(r"//[^\n]*", "", src)
+
+
+def parse_array(src, name):
+    m = re.search(r"\b%s\s*\[\s*\]\s*=\s*\{(.*?)\};" % re.escape(name), src, re.S)
+    if m is None:
+        raise ValueError(f"array '{name}' not found")
+    return [int(v, 0) for v in re.findall(r"-?0x[0-9a-fA-F]+|-?\d+", m.group(1))]
+
+
+def parse_field(block, field, default=None):
+    m = re.search(r"\.%s\s*=\s*(-?\w+)" % re.escape(field), block)
+    if m is None:
+        if default is None:
+            raise ValueError(f"field '{field}' not found")
+        return default
+    return m.group(1)
+
+
+def parse_font(path):
+    with open(path, "r", encoding="utf-8") as f:
+        src = strip_comments(f.read())
+
+    bitmap = bytes(parse_array(src, "glyph_bitmap"))
+
+    glyph_dsc = []
+    m = re.search(r"glyph_dsc\[\]\s*=\s*\{(.*?)\};", src, re.S)
+    for g in re.finditer(r"\{([^{}]*)\}", m.group(1)):
+        glyph_dsc.append({k: int(parse_field(g.group(1), k), 0)
+                          for k in ("bitmap_index", "adv_w", "box_w", "box_h", "ofs_x", "ofs_y")})
+
+    m = re.search(r"font_dsc\s*=\s*\{(.*?)\};", src, re.S)
+    font_dsc = m.group(1)
+    bpp = int(parse_field(font_dsc, "bpp"), 0)
+    if int(parse_field(font_dsc, "bitmap_format", "0"), 0) != 0:
+        raise ValueError(f"{path}: compressed bitmaps are not supported")
+
+    # unicode -> glyph id
+    glyphs = {}
+    m = re.search(r"cmaps\[\]\s*=\s*\{(.*?)\};", src, re.S)
+    for c in re.finditer(r"\{([^{}]*)\}", m.group(1)):
+        cmap = c.group(1)
+        start = int(parse_field(cmap, "range_start"), 0)
+        length = int(parse_field(cmap, "range_length"), 0)
+        gid_start = int(parse_field(cmap, "glyph_id_start"), 0)
+        cmap_type = parse_field(cmap, "type")
+        unicode_list = parse_field(cmap, "unicode_list", "NULL")
+        ofs_list = parse_field(cmap, "glyph_id_ofs_list", "NULL")
+
+        if cmap_type == CMAP_FORMAT0_TINY:
+            for i in range(length):
+                glyphs[start + i] = gid_start + i
+        elif cmap_type == CMAP_FORMAT0_FULL:
+            for i, ofs in enumerate(parse_array(src, ofs_list)):
+                glyphs[start + i] = gid_start + ofs
+        elif cmap_type == CMAP_SPARSE_TINY:
+            for i, u in enumerate(parse_array(src, unicode_list)):
+                glyphs[start + u] = gid_start + i
+        elif cmap_type == CMAP_SPARSE_FULL:
+            ofs = parse_array(src, ofs_list)
+            for i, u in enumerate(parse_array(src, unicode_list)):
+                glyphs[start + u] = gid_start + ofs[i]
+        else:
+            raise ValueError(f"{path}: unknown cmap type {cmap_type}")
+
+    m = re.search(r"lv_font_t\s+\w+\s*=\s*\{(.*?)\};", src, re.S)
+    font = m.group(1)
+    line_height = int(parse_field(font, "line_height"), 0)
+    base_line = int(parse_field(font, "base_line"), 0)
+    underline_position = int(parse_field(font, "underline_position", "0"), 0)
+    underline_thickness = int(parse_field(font, "underline_thickness", "0"), 0)
+
+    head = struct.pack(FONT_HEAD_FMT, len(glyphs), line_height, base_line,
+                       underline_position, underline_thickness, bpp)
+    index = b""
+    data = b""
+    data_ofs = len(head) + len(glyphs) * struct.calcsize(GLYPH_IDX_FMT)
+    for unicode in sorted(glyphs):
+        g = glyph_dsc[glyphs[unicode]]
+        size = (g["box_w"] * g["box_h"] * bpp + 7) // 8
+        index += struct.pack(GLYPH_IDX_FMT, unicode, data_ofs + len(data))
+        data += struct.pack(GLYPH_HEAD_FMT, g["adv_w"], g["box_w"], g["box_h"], g["ofs_x"], g["ofs_y"], 0)
+        data += bitmap[g["bitmap_index"]:g["bitmap_index"] + size]
+
+    return head + index + data
+
+
+def parse_image(path):
+    with open(path, "r", encoding="utf-8") as f:
+        src = strip_comments(f.read())
+
+    m = re.search(r"lv_image_dsc_t\s+(\w+)\s*=\s*\{(.*?)\};", src, re.S)
+    name, dsc = m.group(1), m.group(2)
+    cf = COLOR_FORMAT[parse_field(dsc, "header.cf")]
+    w = int(parse_field(dsc, "header.w"), 0)
+    h = int(parse_field(dsc, "header.h"), 0)
+    stride = int(parse_field(dsc, "header.stride", "0"), 0)
+    data = bytes(parse_array(src, parse_field(dsc, "data")))
+
+    return name, struct.pack(IMAGE_HEAD_FMT, cf, w, h, stride, len(data)) + data
+
+
+def build_pack(entries, output_path):
+    head_size = struct.calcsize(HEADER_FMT) + len(entries) * struct.calcsize(ENTRY_FMT)
+    table = b""
+    blobs = b""
+    for name, entry_type, blob in entries:
+        if len(name.encode()) >= ASSET_NAME_LEN:
+            raise ValueError(f"asset name '{name}' is too long")
+        # keep every blob 4 byte aligned so that it can be read into PSRAM directly
+        blobs += b"\0" * (-len(blobs) % 4)
+        table += struct.pack(ENTRY_FMT, name.encode(), entry_type, head_size + len(blobs), len(blob))
+        blobs += blob
+
+    total = head_size + len(blobs)
+    with open(output_path, "wb") as f:
+        f.write(struct.pack(HEADER_FMT, ASSET_MAGIC, ASSET_VERSION, len(entries), total, 0))
+        f.write(table)
+        f.write(blobs)
+
+    print(f"assets: {len(entries)} entries, {total} bytes -> {output_path}")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--font", action="append", default=[],
+                        help="LVGL C font, the file name without extension is the asset name")
+    parser.add_argument("--image", action="append", default=[],
+                        help="LVGL C image, the lv_image_dsc_t variable name is the asset name")
+    parser.add_argument("--image-dir", action="append", default=[],
+                        help="Directory of LVGL C images (e.g. the emoji directory)")
+    parser.add_argument("--output", required=True, help="Path to the output asset file")
+    args = parser.parse_args()
+
+    entries = []
+    for path in args.font:
+        name = os.path.splitext(os.path.basename(path))[0]
+        entries.append((name, ASSET_TYPE_FONT, parse_font(path)))
+
+    images = list(args.image)
+    for d in args.image_dir:
+        images += sorted(p for p in glob.glob(os.path.join(d, "*.c")) if re.search(r"lv_image_dsc_t\s+\w+\s*=", open(p).read()))
+    for path in images:
+        name, blob = parse_image(path)
+        entries.append((name, ASSET_TYPE_IMAGE, blob))
+
+    build_pack(entries, args.output)
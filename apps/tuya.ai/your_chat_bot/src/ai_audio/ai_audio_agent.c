@@ -79,6 +79,7 @@ static OPERATE_RET __ai_agent_audio_recv(AI_BIZ_ATTR_INFO_T *attr, AI_BIZ_HEAD_I
 
     switch (head->stream_flag) {
     case AI_STREAM_START: {
+        AI_AUDIO_TRACE_MARK(AI_AUDIO_TRACE_TTS_FIRST);
         AI_AGENT_MSG_T ai_msg = {
             .type = AI_AGENT_MSG_TP_AUDIO_START,
             .data_len = len,
@@ -133,6 +134,7 @@ static OPERATE_RET _parse_asr(cJSON *json)
         ai_msg.data_len = strlen(text);
     }
     ai_msg.type = AI_AGENT_MSG_TP_TEXT_ASR;
+    AI_AUDIO_TRACE_MARK(AI_AUDIO_TRACE_ASR_TEXT);
 
     if (sg_ai.cbs.ai_agent_msg_cb) {
         sg_ai.cbs.ai_agent_msg_cb(&ai_msg);
@@ -152,6 +154,7 @@ static OPERATE_RET _parse_nlg(cJSON *json, uint8_t eof)
 
     if (AI_AGENT_CHAT_STREAM_START == sg_ai.stream_status) {
         sg_ai.stream_status = AI_AGENT_CHAT_STREAM_DATA;
+        AI_AUDIO_TRACE_MARK(AI_AUDIO_TRACE_NLG_FIRST);
 
         ai_msg.type = AI_AGENT_MSG_TP_TEXT_NLG_START;
         ai_msg.data_len = strlen(sg_ai.stream_event_id);
@@ -489,6 +492,7 @@ OPERATE_RET ai_audio_agent_upload_start(uint8_t enable_vad)
     }
 
     sg_ai.is_audio_upload_first_frame = true;
+    AI_AUDIO_TRACE_MARK(AI_AUDIO_TRACE_UPLOAD_START);
     PR_DEBUG("upload start event_id:%s", sg_ai.event_id);
 
     return rt;
@@ -547,6 +551,8 @@ OPERATE_RET ai_audio_agent_upload_data(uint8_t *data, uint32_t len)
 
     TUYA_CALL_ERR_RETURN(tuya_ai_send_biz_pkt(TY_AI_CHAT_ID_DS_AUDIO, &attr, AI_PT_AUDIO, &head, (char *)data));
 
+    AI_AUDIO_TRACE_MARK((NULL == data) ? AI_AUDIO_TRACE_UPLOAD_END : AI_AUDIO_TRACE_UPLOAD_FIRST);
+
     return rt;
 }
 
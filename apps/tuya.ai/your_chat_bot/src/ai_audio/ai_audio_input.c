@@ -58,6 +58,7 @@ typedef struct {
     MUTEX_HANDLE                   rb_mutex;
 
     AI_AUDIO_INPUT_ASR_T           asr;  
+    uint32_t                       frame_ms; // capture time of the last mic frame
 
 } AI_AUDIO_INPUT_INFO_T;
 // clang-format on
@@ -388,6 +389,8 @@ static void __ai_audio_get_input_frame(TDL_AUDIO_FRAME_FORMAT_E type, TDL_AUDIO_
     tuya_ring_buff_write(sg_audio_input.ringbuff_hdl, data, len);
     tal_mutex_unlock(sg_audio_input.rb_mutex);
 
+    sg_audio_input.frame_ms = (uint32_t)tal_system_get_millisecond();
+
     return;
 }
 
@@ -426,6 +429,10 @@ static void __ai_audio_handle_frame_task(void *arg)
             tkl_vad_start();
         }
 
+        if (AI_AUDIO_INPUT_EVT_GET_VALID_VOICE_START == event) {
+            AI_AUDIO_TRACE_BEGIN(sg_audio_input.frame_ms);
+        }
+
         if ((event != AI_AUDIO_INPUT_EVT_NONE) && sg_audio_input_inform_cb) {
             sg_audio_input_inform_cb(event, NULL);
         }
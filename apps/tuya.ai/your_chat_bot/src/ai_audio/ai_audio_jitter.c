@@ -0,0 +1,406 @@
+/**
+ * @file ai_audio_jitter.c
+ * @brief Jitter buffer between the MP3 stream and the speaker.
+ *
+ * The pool is a ring of decoded PCM frames. The slot right before the head
+ * keeps the last played frame so it can be faded out on an underrun without a
+ * copy, which leaves frame_num - 1 slots for the frames waiting to be played.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+#include "tkl_system.h"
+#include "tkl_memory.h"
+
+#include "tal_api.h"
+
+#include "ai_audio_jitter.h"
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define JITTER_UNDERRUN_STEP_MS 50   // watermark added after each underrun
+#define JITTER_GAP_DECAY_MS     8000 // the gap peak fades away over about this time
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef enum {
+    JITTER_ST_PREBUF = 0,
+    JITTER_ST_PLAY,
+} JITTER_STATE_E;
+
+typedef enum {
+    JITTER_POP_NONE = 0,
+    JITTER_POP_HEAD,
+    JITTER_POP_CONCEAL,
+} JITTER_POP_E;
+
+typedef struct {
+    uint32_t len;
+    uint16_t ms;
+    uint8_t channels;
+} JITTER_FRAME_T;
+
+typedef struct {
+    uint32_t frame_num;
+    uint32_t frame_size;
+    uint8_t *pcm;
+    JITTER_FRAME_T *frames;
+
+    uint32_t head;
+    uint32_t count;
+    uint32_t buffered_ms;
+    bool last_valid;
+    JITTER_POP_E popped;
+
+    JITTER_STATE_E state;
+    bool fade_in;
+    bool arrived;
+    bool played;
+    uint32_t first_arrival;
+    uint32_t last_arrival;
+    uint32_t underrun_start;
+
+    // kept from one stream to the next
+    uint32_t gap_peak_ms;
+    uint32_t boost_ms;
+
+    AI_AUDIO_JITTER_STATS_T stats;
+} AI_AUDIO_JITTER_T;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static void __jitter_pcm_fade(uint8_t *pcm, uint32_t len, uint8_t channels, bool fade_in)
+{
+    int16_t *sample = (int16_t *)pcm;
+    uint32_t i = 0, c = 0, gain = 0;
+    uint32_t n = 0;
+
+    if (0 == channels) {
+        channels = 1;
+    }
+    n = len / sizeof(int16_t) / channels;
+
+    for (i = 0; i < n; i++) {
+        gain = fade_in ? i : (n - 1 - i);
+        for (c = 0; c < channels; c++) {
+            sample[i * channels + c] = (int16_t)((int32_t)sample[i * channels + c] * (int32_t)gain / (int32_t)n);
+        }
+    }
+}
+
+static uint32_t __jitter_watermark(AI_AUDIO_JITTER_T *jb)
+{
+    uint32_t watermark = jb->gap_peak_ms + jb->boost_ms;
+
+    if (watermark < AI_AUDIO_PLAYER_PREBUF_MIN_MS) {
+        watermark = AI_AUDIO_PLAYER_PREBUF_MIN_MS;
+    }
+    if (watermark > AI_AUDIO_PLAYER_PREBUF_MAX_MS) {
+        watermark = AI_AUDIO_PLAYER_PREBUF_MAX_MS;
+    }
+
+    return watermark;
+}
+
+/**
+ * @brief Creates a jitter buffer.
+ * @param frame_num Number of PCM frames in the pool, one of them holds the last played frame.
+ * @param frame_size Size in bytes of one PCM frame.
+ * @param handle Pointer to store the jitter buffer handle.
+ * @return OPERATE_RET - OPRT_OK on success, otherwise an error code.
+ */
+OPERATE_RET ai_audio_jitter_create(uint32_t frame_num, uint32_t frame_size, AI_AUDIO_JITTER_HANDLE *handle)
+{
+    AI_AUDIO_JITTER_T *jb = NULL;
+
+    if (NULL == handle || frame_num < 2 || 0 == frame_size) {
+        return OPRT_INVALID_PARM;
+    }
+
+    jb = (AI_AUDIO_JITTER_T *)tkl_system_malloc(sizeof(AI_AUDIO_JITTER_T));
+    TUYA_CHECK_NULL_RETURN(jb, OPRT_MALLOC_FAILED);
+    memset(jb, 0, sizeof(AI_AUDIO_JITTER_T));
+
+    jb->frames = (JITTER_FRAME_T *)tkl_system_malloc(frame_num * sizeof(JITTER_FRAME_T));
+    TUYA_CHECK_NULL_GOTO(jb->frames, __ERR);
+
+    jb->pcm = (uint8_t *)tkl_system_psram_malloc(frame_num * frame_size);
+    TUYA_CHECK_NULL_GOTO(jb->pcm, __ERR);
+
+    jb->frame_num = frame_num;
+    jb->frame_size = frame_size;
+    ai_audio_jitter_reset(jb);
+
+    *handle = jb;
+
+    return OPRT_OK;
+
+__ERR:
+    if (jb->frames) {
+        tkl_system_free(jb->frames);
+    }
+    tkl_system_free(jb);
+
+    return OPRT_MALLOC_FAILED;
+}
+
+/**
+ * @brief Frees a jitter buffer.
+ * @param handle The jitter buffer handle.
+ * @return None
+ */
+void ai_audio_jitter_destroy(AI_AUDIO_JITTER_HANDLE handle)
+{
+    AI_AUDIO_JITTER_T *jb = (AI_AUDIO_JITTER_T *)handle;
+
+    if (NULL == jb) {
+        return;
+    }
+
+    tkl_system_psram_free(jb->pcm);
+    tkl_system_free(jb->frames);
+    tkl_system_free(jb);
+}
+
+/**
+ * @brief Drops the buffered frames and starts a new stream, the learned gaps are kept.
+ * @param handle The jitter buffer handle.
+ * @return None
+ */
+void ai_audio_jitter_reset(AI_AUDIO_JITTER_HANDLE handle)
+{
+    AI_AUDIO_JITTER_T *jb = (AI_AUDIO_JITTER_T *)handle;
+
+    if (NULL == jb) {
+        return;
+    }
+
+    jb->head = 0;
+    jb->count = 0;
+    jb->buffered_ms = 0;
+    jb->last_valid = false;
+    jb->popped = JITTER_POP_NONE;
+
+    jb->state = JITTER_ST_PREBUF;
+    jb->fade_in = false;
+    jb->arrived = false;
+    jb->played = false;
+
+    // the network may have recovered since the last underruns
+    jb->boost_ms /= 2;
+
+    memset(&jb->stats, 0, sizeof(AI_AUDIO_JITTER_STATS_T));
+}
+
+/**
+ * @brief Records the arrival of stream data.
+ * @param handle The jitter buffer handle.
+ * @param now_ms Current time in milliseconds.
+ * @return None
+ */
+void ai_audio_jitter_arrival(AI_AUDIO_JITTER_HANDLE handle, uint32_t now_ms)
+{
+    AI_AUDIO_JITTER_T *jb = (AI_AUDIO_JITTER_T *)handle;
+    uint32_t gap = 0, decay = 0;
+
+    if (NULL == jb) {
+        return;
+    }
+
+    if (!jb->arrived) {
+        jb->arrived = true;
+        jb->first_arrival = now_ms;
+        jb->last_arrival = now_ms;
+        return;
+    }
+
+    gap = now_ms - jb->last_arrival;
+    jb->last_arrival = now_ms;
+
+    if (gap >= jb->gap_peak_ms) {
+        jb->gap_peak_ms = gap;
+    } else {
+        decay = (gap >= JITTER_GAP_DECAY_MS) ? jb->gap_peak_ms : (jb->gap_peak_ms * gap / JITTER_GAP_DECAY_MS);
+        jb->gap_peak_ms -= decay;
+    }
+}
+
+/**
+ * @brief Gets a free frame to decode into.
+ * @param handle The jitter buffer handle.
+ * @return uint8_t* - The frame buffer, NULL if the pool is full.
+ */
+uint8_t *ai_audio_jitter_frame_alloc(AI_AUDIO_JITTER_HANDLE handle)
+{
+    AI_AUDIO_JITTER_T *jb = (AI_AUDIO_JITTER_T *)handle;
+
+    if (NULL == jb || jb->count >= jb->frame_num - 1) {
+        return NULL;
+    }
+
+    return jb->pcm + ((jb->head + jb->count) % jb->frame_num) * jb->frame_size;
+}
+
+/**
+ * @brief Queues the frame returned by ai_audio_jitter_frame_alloc.
+ * @param handle The jitter buffer handle.
+ * @param len Length of the decoded PCM in bytes, 16 bits per sample.
+ * @param sample_rate Sample rate of the frame.
+ * @param channels Number of interleaved channels.
+ * @return None
+ */
+void ai_audio_jitter_frame_commit(AI_AUDIO_JITTER_HANDLE handle, uint32_t len, uint32_t sample_rate,
+                                  uint8_t channels)
+{
+    AI_AUDIO_JITTER_T *jb = (AI_AUDIO_JITTER_T *)handle;
+    JITTER_FRAME_T *frame = NULL;
+
+    if (NULL == jb || jb->count >= jb->frame_num - 1 || len > jb->frame_size) {
+        return;
+    }
+
+    frame = &jb->frames[(jb->head + jb->count) % jb->frame_num];
+    frame->len = len;
+    frame->channels = channels ? channels : 1;
+    frame->ms = sample_rate ? (len / sizeof(int16_t) / frame->channels * 1000 / sample_rate) : 0;
+
+    jb->count++;
+    jb->buffered_ms += frame->ms;
+}
+
+/**
+ * @brief Gets the next frame to play.
+ * @param handle The jitter buffer handle.
+ * @param now_ms Current time in milliseconds.
+ * @param is_eof Whether all the stream data has arrived, the watermark is then ignored.
+ * @param pcm Pointer to store the frame.
+ * @param len Pointer to store the frame length.
+ * @return OPERATE_RET - OPRT_OK if a frame is returned, it must be given back with
+ *         ai_audio_jitter_frame_release. OPRT_RECV_DA_NOT_ENOUGH while buffering.
+ */
+OPERATE_RET ai_audio_jitter_frame_pop(AI_AUDIO_JITTER_HANDLE handle, uint32_t now_ms, uint8_t is_eof, uint8_t **pcm,
+                                      uint32_t *len)
+{
+    AI_AUDIO_JITTER_T *jb = (AI_AUDIO_JITTER_T *)handle;
+    JITTER_FRAME_T *frame = NULL;
+    uint32_t slot = 0;
+
+    if (NULL == jb || NULL == pcm || NULL == len) {
+        return OPRT_INVALID_PARM;
+    }
+    if (JITTER_POP_NONE != jb->popped) {
+        return OPRT_COM_ERROR;
+    }
+
+    if (0 == jb->count) {
+        if (JITTER_ST_PLAY != jb->state || is_eof) {
+            return OPRT_RECV_DA_NOT_ENOUGH;
+        }
+
+        // underrun: buffer more next time and fade the last frame out instead of cutting it
+        jb->state = JITTER_ST_PREBUF;
+        jb->fade_in = true;
+        jb->underrun_start = now_ms;
+        jb->stats.underruns++;
+        if (jb->boost_ms < AI_AUDIO_PLAYER_PREBUF_MAX_MS) {
+            jb->boost_ms += JITTER_UNDERRUN_STEP_MS;
+        }
+        if (!jb->last_valid) {
+            return OPRT_RECV_DA_NOT_ENOUGH;
+        }
+
+        slot = (jb->head + jb->frame_num - 1) % jb->frame_num;
+        frame = &jb->frames[slot];
+        *pcm = jb->pcm + slot * jb->frame_size;
+        *len = frame->len;
+        __jitter_pcm_fade(*pcm, *len, frame->channels, false);
+        jb->popped = JITTER_POP_CONCEAL;
+
+        return OPRT_OK;
+    }
+
+    if (JITTER_ST_PREBUF == jb->state) {
+        if (!is_eof && jb->buffered_ms < __jitter_watermark(jb) && jb->count < jb->frame_num - 1) {
+            return OPRT_RECV_DA_NOT_ENOUGH;
+        }
+
+        jb->state = JITTER_ST_PLAY;
+        if (!jb->played) {
+            jb->played = true;
+            jb->stats.latency_ms = jb->arrived ? (now_ms - jb->first_arrival) : 0;
+        } else {
+            jb->stats.rebuffer_ms += now_ms - jb->underrun_start;
+        }
+    }
+
+    frame = &jb->frames[jb->head];
+    *pcm = jb->pcm + jb->head * jb->frame_size;
+    *len = frame->len;
+    if (jb->fade_in) {
+        jb->fade_in = false;
+        __jitter_pcm_fade(*pcm, *len, frame->channels, true);
+    }
+    jb->popped = JITTER_POP_HEAD;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Gives back the frame returned by ai_audio_jitter_frame_pop once it is played.
+ * @param handle The jitter buffer handle.
+ * @return None
+ */
+void ai_audio_jitter_frame_release(AI_AUDIO_JITTER_HANDLE handle)
+{
+    AI_AUDIO_JITTER_T *jb = (AI_AUDIO_JITTER_T *)handle;
+
+    if (NULL == jb) {
+        return;
+    }
+
+    if (JITTER_POP_HEAD == jb->popped) {
+        jb->buffered_ms -= jb->frames[jb->head].ms;
+        jb->head = (jb->head + 1) % jb->frame_num;
+        jb->count--;
+        jb->last_valid = true;
+    } else if (JITTER_POP_CONCEAL == jb->popped) {
+        // already faded out, not to be played again
+        jb->last_valid = false;
+    }
+
+    jb->popped = JITTER_POP_NONE;
+}
+
+/**
+ * @brief Gets the number of frames waiting to be played.
+ * @param handle The jitter buffer handle.
+ * @return uint32_t - The number of frames.
+ */
+uint32_t ai_audio_jitter_count(AI_AUDIO_JITTER_HANDLE handle)
+{
+    AI_AUDIO_JITTER_T *jb = (AI_AUDIO_JITTER_T *)handle;
+
+    return jb ? jb->count : 0;
+}
+
+/**
+ * @brief Gets the statistics of the current stream.
+ * @param handle The jitter buffer handle.
+ * @param stats Pointer to store the statistics.
+ * @return None
+ */
+void ai_audio_jitter_stats_get(AI_AUDIO_JITTER_HANDLE handle, AI_AUDIO_JITTER_STATS_T *stats)
+{
+    AI_AUDIO_JITTER_T *jb = (AI_AUDIO_JITTER_T *)handle;
+
+    if (NULL == jb || NULL == stats) {
+        return;
+    }
+
+    memcpy(stats, &jb->stats, sizeof(AI_AUDIO_JITTER_STATS_T));
+    stats->watermark_ms = __jitter_watermark(jb);
+    stats->gap_peak_ms = jb->gap_peak_ms;
+}
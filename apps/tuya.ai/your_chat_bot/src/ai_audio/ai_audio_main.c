@@ -258,6 +258,10 @@ OPERATE_RET ai_audio_init(AI_AUDIO_CONFIG_T *cfg)
     input_cfg.get_valid_data_method = __get_input_get_valid_data_method(cfg->work_mode);
     sg_ai_audio_work_mode = cfg->work_mode;
 
+#if defined(ENABLE_AI_AUDIO_TRACE) && (ENABLE_AI_AUDIO_TRACE == 1)
+    TUYA_CALL_ERR_LOG(ai_audio_trace_init());
+#endif
+
     TUYA_CALL_ERR_RETURN(ai_audio_input_init(&input_cfg, __ai_audio_input_inform_handle));
 
     TDL_AUDIO_HANDLE_T audio_hdl = NULL;
@@ -23,6 +23,7 @@
 #include "ai_media_alert.h"
 #include "minimp3_ex.h"
 #include "ai_audio.h"
+#include "ai_audio_jitter.h"
 
 /***********************************************************
 ************************macro define************************
@@ -38,6 +39,13 @@
 #define MP3_PCM_SIZE_MAX           (MAX_NSAMP * MAX_NCHAN * MAX_NGRAN * 2)
 #define PLAYING_NO_DATA_TIMEOUT_MS (5 * 1000)
 
+#ifndef AI_AUDIO_PLAYER_PCM_FRAME_NUM
+#define AI_AUDIO_PLAYER_PCM_FRAME_NUM 24
+#endif
+
+// frames decoded ahead at most per loop, so playback is not held up
+#define MP3_DECODE_AHEAD_MAX 4
+
 #define AI_AUDIO_PLAYER_STAT_CHANGE(last_stat, new_stat)                              \
     do {                                                                              \
         if(last_stat != new_stat) {                                                   \
@@ -68,7 +76,8 @@ typedef struct {
     uint8_t                *mp3_raw;
     uint8_t                *mp3_raw_head;
     uint32_t                mp3_raw_used_len;
-    uint8_t                *mp3_pcm; // mp3 decode to pcm buffer
+
+    AI_AUDIO_JITTER_HANDLE  jitter; // decoded pcm frames waiting to be played
 
 } APP_PLAYER_T;
 
@@ -99,31 +108,31 @@ static OPERATE_RET __ai_audio_player_mp3_start(void)
     }
 
     sg_player.mp3_raw_used_len = 0;
+    tal_mutex_lock(sg_player.spk_rb_mutex);
+    ai_audio_jitter_reset(sg_player.jitter);
+    tal_mutex_unlock(sg_player.spk_rb_mutex);
 
     return rt;
 }
 
-static OPERATE_RET __ai_audio_player_mp3_playing(void)
+static OPERATE_RET __ai_audio_player_mp3_decode(void)
 {
-    OPERATE_RET rt = OPRT_OK;
     APP_PLAYER_T *ctx = &sg_player;
+    uint8_t *pcm = NULL;
 
-    if (NULL == ctx->mp3_dec) {
-        PR_ERR("mp3 decoder is NULL");
-        return OPRT_COM_ERROR;
+    pcm = ai_audio_jitter_frame_alloc(ctx->jitter);
+    if (NULL == pcm) {
+        return OPRT_EXCEED_UPPER_LIMIT;
     }
 
     tal_mutex_lock(sg_player.spk_rb_mutex);
     uint32_t rb_used_len = tuya_ring_buff_used_size_get(ctx->rb_hdl);
     tal_mutex_unlock(sg_player.spk_rb_mutex);
     if (0 == rb_used_len && 0 == ctx->mp3_raw_used_len) {
-        // PR_DEBUG("mp3 data is empty");
-        rt = OPRT_RECV_DA_NOT_ENOUGH;
-        goto __EXIT;
+        return OPRT_RECV_DA_NOT_ENOUGH;
     }
 
     if (NULL != ctx->mp3_raw_head && ctx->mp3_raw_used_len > 0 && ctx->mp3_raw_head != ctx->mp3_raw) {
-        // PR_DEBUG("move data, offset=%d, used_len=%d", ctx->mp3_raw_head - ctx->mp3_raw, ctx->mp3_raw_used_len);
         memmove(ctx->mp3_raw, ctx->mp3_raw_head, ctx->mp3_raw_used_len);
     }
     ctx->mp3_raw_head = ctx->mp3_raw;
@@ -132,31 +141,73 @@ static OPERATE_RET __ai_audio_player_mp3_playing(void)
     if (rb_used_len > 0 && ctx->mp3_raw_used_len < MAINBUF_SIZE) {
         uint32_t read_len = ((MAINBUF_SIZE - ctx->mp3_raw_used_len) > rb_used_len) ?\
                              rb_used_len : (MAINBUF_SIZE - ctx->mp3_raw_used_len);
-          
-        tal_mutex_lock(sg_player.spk_rb_mutex);                     
+
+        tal_mutex_lock(sg_player.spk_rb_mutex);
         uint32_t rt_len = tuya_ring_buff_read(ctx->rb_hdl, ctx->mp3_raw + ctx->mp3_raw_used_len, read_len);
-        tal_mutex_unlock(sg_player.spk_rb_mutex);  
-        //  PR_DEBUG("read_len=%d rt_len: %d", read_len, rt_len);
+        tal_mutex_unlock(sg_player.spk_rb_mutex);
 
         ctx->mp3_raw_used_len += rt_len;
     }
 
     int samples = mp3dec_decode_frame(ctx->mp3_dec, ctx->mp3_raw_head, ctx->mp3_raw_used_len,
-                                      (mp3d_sample_t *)ctx->mp3_pcm, &ctx->mp3_frame_info);
+                                      (mp3d_sample_t *)pcm, &ctx->mp3_frame_info);
     if (samples == 0) {
+        if (ctx->mp3_frame_info.frame_bytes > 0) {
+            // skipped data, e.g. an ID3 tag
+            ctx->mp3_raw_used_len -= ctx->mp3_frame_info.frame_bytes;
+            ctx->mp3_raw_head += ctx->mp3_frame_info.frame_bytes;
+            return OPRT_OK;
+        }
+        if (ctx->mp3_raw_used_len < MAINBUF_SIZE && !ctx->is_eof) {
+            // the frame is not complete yet, keep it for the next data
+            return OPRT_RECV_DA_NOT_ENOUGH;
+        }
         ctx->mp3_raw_used_len = 0;
         ctx->mp3_raw_head = ctx->mp3_raw;
-        rt = OPRT_COM_ERROR;
-        goto __EXIT;
+        return OPRT_COM_ERROR;
     }
 
     ctx->mp3_raw_used_len -= ctx->mp3_frame_info.frame_bytes;
     ctx->mp3_raw_head += ctx->mp3_frame_info.frame_bytes;
 
-    tdl_audio_play(ctx->audio_hdl, ctx->mp3_pcm, samples * 2);
+    ai_audio_jitter_frame_commit(ctx->jitter, samples * ctx->mp3_frame_info.channels * sizeof(mp3d_sample_t),
+                                 ctx->mp3_frame_info.hz, ctx->mp3_frame_info.channels);
 
-__EXIT:
-    return rt;
+    return OPRT_OK;
+}
+
+static OPERATE_RET __ai_audio_player_mp3_playing(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+    APP_PLAYER_T *ctx = &sg_player;
+    uint8_t *pcm = NULL;
+    uint32_t pcm_len = 0, i = 0;
+
+    if (NULL == ctx->mp3_dec) {
+        PR_ERR("mp3 decoder is NULL");
+        return OPRT_COM_ERROR;
+    }
+
+    // decode ahead into the jitter buffer
+    for (i = 0; i < MP3_DECODE_AHEAD_MAX; i++) {
+        if (OPRT_OK != __ai_audio_player_mp3_decode()) {
+            break;
+        }
+    }
+
+    // the arrivals are recorded by the writer under the same lock
+    tal_mutex_lock(ctx->spk_rb_mutex);
+    rt = ai_audio_jitter_frame_pop(ctx->jitter, (uint32_t)tal_system_get_millisecond(), ctx->is_eof, &pcm, &pcm_len);
+    tal_mutex_unlock(ctx->spk_rb_mutex);
+    if (OPRT_OK != rt) {
+        return OPRT_RECV_DA_NOT_ENOUGH;
+    }
+
+    tdl_audio_play(ctx->audio_hdl, pcm, pcm_len);
+    ai_audio_jitter_frame_release(ctx->jitter);
+    AI_AUDIO_TRACE_MARK(AI_AUDIO_TRACE_PLAY_FIRST);
+
+    return OPRT_OK;
 }
 
 static OPERATE_RET __ai_audio_player_mp3_init(void)
@@ -168,16 +219,12 @@ static OPERATE_RET __ai_audio_player_mp3_init(void)
     sg_player.mp3_raw = (uint8_t *)tkl_system_psram_malloc(MAINBUF_SIZE);
     TUYA_CHECK_NULL_GOTO(sg_player.mp3_raw, __ERR);
 
-    sg_player.mp3_pcm = (uint8_t *)tkl_system_psram_malloc(MP3_PCM_SIZE_MAX);
-    TUYA_CHECK_NULL_GOTO(sg_player.mp3_pcm, __ERR);
+    TUYA_CALL_ERR_GOTO(ai_audio_jitter_create(AI_AUDIO_PLAYER_PCM_FRAME_NUM, MP3_PCM_SIZE_MAX, &sg_player.jitter),
+                       __ERR);
 
     return rt;
 
 __ERR:
-    if (sg_player.mp3_pcm) {
-        tkl_system_psram_free(sg_player.mp3_pcm);
-        sg_player.mp3_pcm = NULL;
-    }
 
     if (sg_player.mp3_raw) {
         tkl_system_psram_free(sg_player.mp3_raw);
@@ -228,8 +275,14 @@ static void __ai_audio_player_task(void *arg)
             tal_mutex_lock(ctx->spk_rb_mutex);
             uint32_t rb_used_len = tuya_ring_buff_used_size_get(ctx->rb_hdl);
             tal_mutex_unlock(ctx->spk_rb_mutex);
-            if (rb_used_len == 0 && 0 == ctx->mp3_raw_used_len && ctx->is_eof) {
-                PR_DEBUG("app player end");
+            if (rb_used_len == 0 && 0 == ctx->mp3_raw_used_len && 0 == ai_audio_jitter_count(ctx->jitter) &&
+                ctx->is_eof) {
+                AI_AUDIO_JITTER_STATS_T stats;
+                tal_mutex_lock(ctx->spk_rb_mutex);
+                ai_audio_jitter_stats_get(ctx->jitter, &stats);
+                tal_mutex_unlock(ctx->spk_rb_mutex);
+                PR_DEBUG("app player end, latency:%dms underruns:%d rebuffer:%dms watermark:%dms", stats.latency_ms,
+                         stats.underruns, stats.rebuffer_ms, stats.watermark_ms);
                 ctx->stat = AI_AUDIO_PLAYER_STAT_FINISH;
             }
         } break;
@@ -409,7 +462,10 @@ OPERATE_RET ai_audio_player_data_write(char *id, uint8_t *data, uint32_t len, ui
     }
 
 
-    if (NULL != data && len > 0) {    
+    if (NULL != data && len > 0) {
+        tal_mutex_lock(sg_player.spk_rb_mutex);
+        ai_audio_jitter_arrival(sg_player.jitter, (uint32_t)tal_system_get_millisecond());
+        tal_mutex_unlock(sg_player.spk_rb_mutex);
         while((alreay_write_len < len) && \
               (AI_AUDIO_PLAYER_STAT_PLAY == sg_player.stat ||\
                AI_AUDIO_PLAYER_STAT_START == sg_player.stat)) {
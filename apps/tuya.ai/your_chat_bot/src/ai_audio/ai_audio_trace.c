@@ -0,0 +1,353 @@
+/**
+ * @file ai_audio_trace.c
+ * @brief Latency trace of the voice interaction stages.
+ *
+ * Writers from any thread claim a ring entry with an atomic add on the write
+ * index. An entry carries the index it was written at once it is complete,
+ * so the reader skips entries that are being written or were overwritten
+ * while it copied them, and nothing is ever locked on the audio paths.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+#include "tkl_memory.h"
+
+#include "tal_api.h"
+#include "tal_cli.h"
+
+#include "ai_audio_trace.h"
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#if (AI_AUDIO_TRACE_RING_SIZE & (AI_AUDIO_TRACE_RING_SIZE - 1))
+#error "AI_AUDIO_TRACE_RING_SIZE must be a power of 2"
+#endif
+
+#define TRACE_RING_MASK (AI_AUDIO_TRACE_RING_SIZE - 1)
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint32_t seq; // write index + 1 once complete, 0 while written
+    uint32_t id;
+    uint32_t ts_ms;
+    uint32_t stage;
+} TRACE_ENTRY_T;
+
+typedef struct {
+    uint32_t mask;
+    uint32_t ts_ms[AI_AUDIO_TRACE_STAGE_NUM];
+} TRACE_UTTERANCE_T;
+
+typedef struct {
+    TRACE_ENTRY_T *ring;
+    uint32_t head;   // next write index
+    uint32_t base;   // entries before it were cleared
+    uint32_t cur_id; // current utterance, 0 before the first one
+    uint32_t marked; // stages stamped for the current utterance
+} AI_AUDIO_TRACE_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static AI_AUDIO_TRACE_T sg_trace;
+
+static const char *sg_stage_name[AI_AUDIO_TRACE_STAGE_NUM] = {
+    "voice_start", "upload_start", "upload_first", "upload_end",
+    "asr_text",    "nlg_first",    "tts_first",    "play_first",
+};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static void __trace_record(uint32_t id, uint32_t stage, uint32_t ts_ms)
+{
+    uint32_t idx = __atomic_fetch_add(&sg_trace.head, 1, __ATOMIC_RELAXED);
+    TRACE_ENTRY_T *entry = &sg_trace.ring[idx & TRACE_RING_MASK];
+
+    __atomic_store_n(&entry->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    entry->id = id;
+    entry->ts_ms = ts_ms;
+    entry->stage = stage;
+    __atomic_store_n(&entry->seq, idx + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief copies the complete entries from the oldest to the newest
+ */
+static uint32_t __trace_snapshot(TRACE_ENTRY_T *out)
+{
+    uint32_t head = __atomic_load_n(&sg_trace.head, __ATOMIC_ACQUIRE);
+    uint32_t base = __atomic_load_n(&sg_trace.base, __ATOMIC_RELAXED);
+    uint32_t idx, seq, num = 0;
+    TRACE_ENTRY_T *entry;
+
+    if (head - base > AI_AUDIO_TRACE_RING_SIZE) {
+        base = head - AI_AUDIO_TRACE_RING_SIZE;
+    }
+
+    for (idx = base; idx != head; idx++) {
+        entry = &sg_trace.ring[idx & TRACE_RING_MASK];
+        seq = __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE);
+        if (seq != idx + 1) {
+            continue;
+        }
+        out[num] = *entry;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&entry->seq, __ATOMIC_RELAXED) != seq || out[num].stage >= AI_AUDIO_TRACE_STAGE_NUM) {
+            continue;
+        }
+        num++;
+    }
+
+    return num;
+}
+
+static void __trace_percentile(uint32_t *val, uint32_t num, AI_AUDIO_TRACE_STATS_T *stats)
+{
+    uint32_t i, j, v;
+
+    memset(stats, 0, sizeof(AI_AUDIO_TRACE_STATS_T));
+    if (0 == num) {
+        return;
+    }
+
+    // at most one value per utterance in the ring, insertion sort is enough
+    for (i = 1; i < num; i++) {
+        v = val[i];
+        for (j = i; j > 0 && val[j - 1] > v; j--) {
+            val[j] = val[j - 1];
+        }
+        val[j] = v;
+    }
+
+    // nearest rank
+    stats->count = num;
+    stats->p50_ms = val[(num * 50 + 99) / 100 - 1];
+    stats->p90_ms = val[(num * 90 + 99) / 100 - 1];
+    stats->p99_ms = val[(num * 99 + 99) / 100 - 1];
+    stats->max_ms = val[num - 1];
+}
+
+static void __ai_audio_trace_cmd(int argc, char *argv[])
+{
+    if (argc > 1 && 0 == strcmp(argv[1], "clear")) {
+        ai_audio_trace_clear();
+        PR_INFO("ai trace cleared");
+        return;
+    }
+
+    ai_audio_trace_dump();
+}
+
+static cli_cmd_t sg_trace_cli_cmd[] = {
+    {.name = "ai_trace", .func = __ai_audio_trace_cmd, .help = "voice latency per stage, ai_trace [clear]"},
+};
+
+/**
+ * @brief Initializes the trace ring and registers the cli command.
+ * @param None
+ * @return OPERATE_RET - OPRT_OK on success, otherwise an error code.
+ */
+OPERATE_RET ai_audio_trace_init(void)
+{
+    if (sg_trace.ring) {
+        return OPRT_OK;
+    }
+
+    sg_trace.ring = (TRACE_ENTRY_T *)tkl_system_malloc(AI_AUDIO_TRACE_RING_SIZE * sizeof(TRACE_ENTRY_T));
+    if (NULL == sg_trace.ring) {
+        return OPRT_MALLOC_FAILED;
+    }
+    memset(sg_trace.ring, 0, AI_AUDIO_TRACE_RING_SIZE * sizeof(TRACE_ENTRY_T));
+
+    tal_cli_cmd_register(sg_trace_cli_cmd, CNTSOF(sg_trace_cli_cmd));
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Starts a new utterance, its voice start stage is stamped with ts_ms.
+ * @param ts_ms Time the valid voice was captured, in system milliseconds.
+ * @return uint32_t - The utterance ID, 0 if the trace is not initialized.
+ */
+uint32_t ai_audio_trace_begin(uint32_t ts_ms)
+{
+    uint32_t id;
+
+    if (NULL == sg_trace.ring) {
+        return 0;
+    }
+
+    __atomic_store_n(&sg_trace.marked, 1 << AI_AUDIO_TRACE_VOICE_START, __ATOMIC_RELAXED);
+    id = __atomic_add_fetch(&sg_trace.cur_id, 1, __ATOMIC_RELEASE);
+    if (0 == id) {
+        id = __atomic_add_fetch(&sg_trace.cur_id, 1, __ATOMIC_RELEASE);
+    }
+    __trace_record(id, AI_AUDIO_TRACE_VOICE_START, ts_ms);
+
+    PR_DEBUG("ai trace utterance %d", id);
+
+    return id;
+}
+
+/**
+ * @brief Stamps a stage of the current utterance, only the first call per utterance is kept.
+ * @param stage The stage reached.
+ * @return None
+ */
+void ai_audio_trace_mark(AI_AUDIO_TRACE_STAGE_E stage)
+{
+    uint32_t id, bit;
+
+    if (NULL == sg_trace.ring || stage >= AI_AUDIO_TRACE_STAGE_NUM) {
+        return;
+    }
+
+    id = __atomic_load_n(&sg_trace.cur_id, __ATOMIC_ACQUIRE);
+    if (0 == id) {
+        return;
+    }
+
+    bit = 1 << stage;
+    if (__atomic_fetch_or(&sg_trace.marked, bit, __ATOMIC_RELAXED) & bit) {
+        return;
+    }
+
+    __trace_record(id, stage, (uint32_t)tal_system_get_millisecond());
+}
+
+/**
+ * @brief Drops the recorded utterances.
+ * @param None
+ * @return None
+ */
+void ai_audio_trace_clear(void)
+{
+    __atomic_store_n(&sg_trace.base, __atomic_load_n(&sg_trace.head, __ATOMIC_ACQUIRE), __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Aggregates the utterances in the ring.
+ * @param stages Array of AI_AUDIO_TRACE_STAGE_NUM entries to store the span of each stage.
+ * @param reply Pointer to store the span from the last audio packet sent to the first audio frame played.
+ * @return uint32_t - The number of utterances found.
+ */
+uint32_t ai_audio_trace_stats_get(AI_AUDIO_TRACE_STATS_T *stages, AI_AUDIO_TRACE_STATS_T *reply)
+{
+    TRACE_ENTRY_T *entries = NULL;
+    TRACE_UTTERANCE_T *utts = NULL, *utt;
+    uint32_t *val = NULL;
+    uint32_t entry_num, utt_num = 0, min_id, i, n, s, prev;
+
+    if (NULL == stages || NULL == reply) {
+        return 0;
+    }
+    memset(stages, 0, AI_AUDIO_TRACE_STAGE_NUM * sizeof(AI_AUDIO_TRACE_STATS_T));
+    memset(reply, 0, sizeof(AI_AUDIO_TRACE_STATS_T));
+    if (NULL == sg_trace.ring) {
+        return 0;
+    }
+
+    entries = (TRACE_ENTRY_T *)tkl_system_malloc(AI_AUDIO_TRACE_RING_SIZE * sizeof(TRACE_ENTRY_T));
+    utts = (TRACE_UTTERANCE_T *)tkl_system_malloc(AI_AUDIO_TRACE_RING_SIZE * sizeof(TRACE_UTTERANCE_T));
+    val = (uint32_t *)tkl_system_malloc(AI_AUDIO_TRACE_RING_SIZE * sizeof(uint32_t));
+    if (NULL == entries || NULL == utts || NULL == val) {
+        PR_ERR("ai trace malloc failed");
+        goto __EXIT;
+    }
+
+    entry_num = __trace_snapshot(entries);
+    if (0 == entry_num) {
+        goto __EXIT;
+    }
+
+    // IDs only grow and every utterance starts with an entry, so the IDs in
+    // the ring are a range no longer than the ring
+    min_id = entries[0].id;
+    for (i = 1; i < entry_num; i++) {
+        if ((int32_t)(entries[i].id - min_id) < 0) {
+            min_id = entries[i].id;
+        }
+    }
+
+    memset(utts, 0, AI_AUDIO_TRACE_RING_SIZE * sizeof(TRACE_UTTERANCE_T));
+    for (i = 0; i < entry_num; i++) {
+        n = entries[i].id - min_id;
+        if (n >= AI_AUDIO_TRACE_RING_SIZE) {
+            continue;
+        }
+        utts[n].mask |= 1 << entries[i].stage;
+        utts[n].ts_ms[entries[i].stage] = entries[i].ts_ms;
+        utt_num = (n + 1 > utt_num) ? n + 1 : utt_num;
+    }
+
+    for (s = AI_AUDIO_TRACE_VOICE_START + 1; s < AI_AUDIO_TRACE_STAGE_NUM; s++) {
+        for (i = 0, n = 0; i < utt_num; i++) {
+            utt = &utts[i];
+            if (!(utt->mask & (1 << s))) {
+                continue;
+            }
+            for (prev = s; prev > 0 && !(utt->mask & (1 << (prev - 1))); prev--) {
+            }
+            // spans of stages that raced ahead of the previous one are dropped
+            if (prev > 0 && (int32_t)(utt->ts_ms[s] - utt->ts_ms[prev - 1]) >= 0) {
+                val[n++] = utt->ts_ms[s] - utt->ts_ms[prev - 1];
+            }
+        }
+        __trace_percentile(val, n, &stages[s]);
+    }
+
+    for (i = 0, n = 0; i < utt_num; i++) {
+        utt = &utts[i];
+        if ((utt->mask & (1 << AI_AUDIO_TRACE_UPLOAD_END)) && (utt->mask & (1 << AI_AUDIO_TRACE_PLAY_FIRST)) &&
+            (int32_t)(utt->ts_ms[AI_AUDIO_TRACE_PLAY_FIRST] - utt->ts_ms[AI_AUDIO_TRACE_UPLOAD_END]) >= 0) {
+            val[n++] = utt->ts_ms[AI_AUDIO_TRACE_PLAY_FIRST] - utt->ts_ms[AI_AUDIO_TRACE_UPLOAD_END];
+        }
+    }
+    __trace_percentile(val, n, reply);
+
+    for (i = 0, n = 0; i < utt_num; i++) {
+        n += (utts[i].mask) ? 1 : 0;
+    }
+    utt_num = n;
+
+__EXIT:
+    if (entries) {
+        tkl_system_free(entries);
+    }
+    if (utts) {
+        tkl_system_free(utts);
+    }
+    if (val) {
+        tkl_system_free(val);
+    }
+
+    return utt_num;
+}
+
+/**
+ * @brief Logs the per-stage percentiles.
+ * @param None
+ * @return None
+ */
+void ai_audio_trace_dump(void)
+{
+    AI_AUDIO_TRACE_STATS_T stages[AI_AUDIO_TRACE_STAGE_NUM];
+    AI_AUDIO_TRACE_STATS_T reply;
+    uint32_t num, s;
+
+    num = ai_audio_trace_stats_get(stages, &reply);
+
+    PR_INFO("ai trace: %d utterances, span from the previous stage in ms", num);
+    PR_INFO("%-12s %5s %6s %6s %6s %6s", "stage", "n", "p50", "p90", "p99", "max");
+    for (s = AI_AUDIO_TRACE_VOICE_START + 1; s < AI_AUDIO_TRACE_STAGE_NUM; s++) {
+        PR_INFO("%-12s %5d %6d %6d %6d %6d", sg_stage_name[s], stages[s].count, stages[s].p50_ms, stages[s].p90_ms,
+                stages[s].p99_ms, stages[s].max_ms);
+    }
+    PR_INFO("%-12s %5d %6d %6d %6d %6d", "reply", reply.count, reply.p50_ms, reply.p90_ms, reply.p99_ms,
+            reply.max_ms);
+}
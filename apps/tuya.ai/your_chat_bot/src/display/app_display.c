@@ -18,6 +18,9 @@
 
 #include "font_awesome_symbols.h"
 #include "ui_display.h"
+#if defined(ENABLE_GUI_ASSET_PACK) && (ENABLE_GUI_ASSET_PACK == 1)
+#include "ui_asset.h"
+#endif
 
 #include "tal_log.h"
 #include "tal_queue.h"
@@ -26,11 +29,20 @@
 #include "tkl_memory.h"
 
 #include "lvgl.h"
+#include "lv_port_disp.h"
 
 /***********************************************************
 ************************macro define************************
 ***********************************************************/
 
+#if defined(ENABLE_GUI_ASSET_PACK) && (ENABLE_GUI_ASSET_PACK == 1)
+#define UI_TEXT_FONT(name)  ui_asset_font_get(#name)
+#define UI_EMOJI_FONT(size) ui_asset_emoji_font_get(size)
+#else
+#define UI_TEXT_FONT(name)  (&name)
+#define UI_EMOJI_FONT(size) font_emoji_##size##_init()
+#endif
+
 /***********************************************************
 ***********************typedef define***********************
 ***********************************************************/
@@ -92,42 +104,51 @@ static OPERATE_RET __get_ui_font(UI_FONT_T *ui_font)
 
 #if defined(BOARD_CHOICE_TUYA_T5AI_BOARD)
 #if defined(ENABLE_GUI_WECHAT)
-    ui_font->text = &font_puhui_18_2;
+    ui_font->text = UI_TEXT_FONT(font_puhui_18_2);
     ui_font->icon = &font_awesome_16_4;
-    ui_font->emoji = font_emoji_32_init();
+    ui_font->emoji = UI_EMOJI_FONT(32);
     ui_font->emoji_list = sg_emo_list;
 #elif defined(ENABLE_GUI_CHATBOT)
-    ui_font->text = &font_puhui_18_2;
+    ui_font->text = UI_TEXT_FONT(font_puhui_18_2);
     ui_font->icon = &font_awesome_16_4;
-    ui_font->emoji = font_emoji_64_init();
+    ui_font->emoji = UI_EMOJI_FONT(64);
     ui_font->emoji_list = sg_emo_list;
 #endif
 #elif defined(BOARD_CHOICE_TUYA_T5AI_EVB)
 #if defined(ENABLE_GUI_WECHAT)
-    ui_font->text = &font_puhui_18_2;
+    ui_font->text = UI_TEXT_FONT(font_puhui_18_2);
     ui_font->icon = &font_awesome_16_4;
-    ui_font->emoji = font_emoji_32_init();
+    ui_font->emoji = UI_EMOJI_FONT(32);
     ui_font->emoji_list = sg_emo_list;
 #elif defined(ENABLE_GUI_CHATBOT)
-    ui_font->text = &font_puhui_18_2;
+    ui_font->text = UI_TEXT_FONT(font_puhui_18_2);
     ui_font->icon = &font_awesome_16_4;
-    ui_font->emoji = font_emoji_64_init();
+    ui_font->emoji = UI_EMOJI_FONT(64);
     ui_font->emoji_list = sg_emo_list;
 #endif
 #elif defined(BOARD_CHOICE_BREAD_COMPACT_WIFI)
-    ui_font->text = &font_puhui_14_1;
+    ui_font->text = UI_TEXT_FONT(font_puhui_14_1);
     ui_font->icon = &font_awesome_14_1;
     ui_font->emoji = &font_awesome_30_1;
     ui_font->emoji_list = sg_awesome_emo_list;
 #elif defined(BOARD_CHOICE_WAVESHARE_ESP32_S3_TOUCH_AMOLED_1_8)
-    ui_font->text = &font_puhui_30_4;
+    ui_font->text = UI_TEXT_FONT(font_puhui_30_4);
     ui_font->icon = &font_awesome_30_4;
-    ui_font->emoji = font_emoji_64_init();
+    ui_font->emoji = UI_EMOJI_FONT(64);
     ui_font->emoji_list = sg_emo_list;
 #else
 #error "Please define the font for your board"
 #endif
 
+    // the asset pack may be missing or incomplete
+    if (NULL == ui_font->text) {
+        PR_ERR("text font not available, use the default font");
+        ui_font->text = (lv_font_t *)LV_FONT_DEFAULT;
+    }
+    if (NULL == ui_font->emoji) {
+        ui_font->emoji = ui_font->text;
+    }
+
     return rt;
 }
 
@@ -218,6 +239,9 @@ static void __chat_bot_ui_task(void *args)
     (void)args;
 
     tuya_lvgl_mutex_lock();
+#if defined(ENABLE_GUI_ASSET_PACK) && (ENABLE_GUI_ASSET_PACK == 1)
+    TUYA_CALL_ERR_LOG(ui_asset_init(GUI_ASSET_PACK_PATH, GUI_ASSET_PACK_FLASH_ADDR, GUI_ASSET_CACHE_SIZE * 1024));
+#endif
     // Initialize the display font
     TUYA_CALL_ERR_LOG(__get_ui_font(&sg_display.ui_font));
     // ui initialization
@@ -0,0 +1,598 @@
+/**
+ * @file ui_asset.c
+ * @brief Fonts, emoji and images streamed from the packed asset file
+ *
+ * The pack header and entry table are read once at initialization. A font
+ * only keeps its sorted code point index in PSRAM; glyph metrics and bitmaps
+ * are read on first use and kept in the LRU cache. Images are read as a whole
+ * into the cache on first use. What a display refresh uses stays in the cache
+ * until the refresh is over. The pack layout is described in
+ * script/pack_assets.py.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+
+#include "tuya_cloud_types.h"
+
+#include "tal_fs.h"
+#include "tal_log.h"
+#include "tkl_flash.h"
+#include "tkl_memory.h"
+
+#include "ui_asset.h"
+#include "ui_asset_cache.h"
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define ASSET_FONT_MAX_NUM  4
+#define ASSET_EMOJI_MAX_NUM 2
+
+// cache key: entry id in the high bits, code point (or the image marker) in the low 21 bits
+#define ASSET_KEY_IMAGE         0x1FFFFF
+#define ASSET_KEY(entry, code)  ((((uint32_t)(entry)) << 21) | ((code) & 0x1FFFFF))
+#define ASSET_KEY_IS_IMAGE(key) (((key) & 0x1FFFFF) == ASSET_KEY_IMAGE)
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+#pragma pack(1)
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t entry_num;
+    uint32_t total_size;
+    uint32_t rsvd;
+} ASSET_HEADER_T;
+
+typedef struct {
+    char name[UI_ASSET_NAME_LEN];
+    uint8_t type;
+    uint8_t rsvd[3];
+    uint32_t offset;
+    uint32_t size;
+} ASSET_ENTRY_T;
+
+typedef struct {
+    uint32_t glyph_num;
+    int16_t line_height;
+    int16_t base_line;
+    int8_t underline_position;
+    uint8_t underline_thickness;
+    uint8_t bpp;
+    uint8_t rsvd;
+} ASSET_FONT_HEAD_T;
+
+typedef struct {
+    uint32_t unicode;
+    uint32_t offset;
+} ASSET_GLYPH_IDX_T;
+
+typedef struct {
+    uint16_t adv_w; // 1/16 pixel
+    uint8_t box_w;
+    uint8_t box_h;
+    int8_t ofs_x;
+    int8_t ofs_y;
+    uint16_t rsvd;
+    uint8_t bitmap[0];
+} ASSET_GLYPH_T;
+
+typedef struct {
+    uint8_t cf;
+    uint8_t rsvd;
+    uint16_t w;
+    uint16_t h;
+    uint16_t stride;
+    uint32_t data_size;
+} ASSET_IMAGE_HEAD_T;
+#pragma pack()
+
+typedef struct {
+    lv_font_t font;
+    uint16_t entry_id;
+    uint8_t bpp;
+    uint32_t glyph_num;
+    ASSET_GLYPH_IDX_T *index;
+} ASSET_FONT_T;
+
+typedef struct {
+    uint32_t size;
+    lv_font_t *font;
+} ASSET_EMOJI_FONT_T;
+
+typedef struct {
+    uint32_t flash_addr;
+    TUYA_FILE file;
+
+    uint16_t entry_num;
+    ASSET_ENTRY_T *entry;
+
+    uint8_t font_num;
+    ASSET_FONT_T *font[ASSET_FONT_MAX_NUM];
+
+    uint8_t emoji_num;
+    ASSET_EMOJI_FONT_T emoji[ASSET_EMOJI_MAX_NUM];
+} UI_ASSET_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static UI_ASSET_T sg_asset = {0};
+
+static const uint8_t sg_opa2_table[4] = {0, 85, 170, 255};
+static const uint8_t sg_opa4_table[16] = {0, 17, 34, 51, 68, 85, 102, 119, 136, 153, 170, 187, 204, 221, 238, 255};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static OPERATE_RET __asset_read(uint32_t offset, void *buf, uint32_t len)
+{
+    if (sg_asset.flash_addr) {
+        return tkl_flash_read(sg_asset.flash_addr + offset, (uint8_t *)buf, len);
+    }
+
+    if (NULL == sg_asset.file) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+
+    if (tal_fseek(sg_asset.file, offset, TUYA_SEEK_SET) != 0) {
+        return OPRT_COM_ERROR;
+    }
+
+    if (tal_fread(buf, len, sg_asset.file) != (int)len) {
+        return OPRT_COM_ERROR;
+    }
+
+    return OPRT_OK;
+}
+
+static int __asset_entry_find(const char *name, uint8_t type)
+{
+    uint16_t i;
+
+    for (i = 0; i < sg_asset.entry_num; i++) {
+        if (sg_asset.entry[i].type == type && 0 == strncmp(sg_asset.entry[i].name, name, UI_ASSET_NAME_LEN)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static void __asset_cache_evict_cb(uint32_t key, void *data)
+{
+    // LVGL caches decoded images by their source pointer, which is about to be reused
+    if (ASSET_KEY_IS_IMAGE(key)) {
+        lv_image_cache_drop(data);
+    }
+}
+
+static void __asset_refr_event_cb(lv_event_t *e)
+{
+    // the draw tasks of a refresh keep the image pointers until it is done
+    if (LV_EVENT_REFR_START == lv_event_get_code(e)) {
+        ui_asset_cache_pass_begin();
+    } else {
+        ui_asset_cache_pass_end();
+    }
+}
+
+static ASSET_GLYPH_T *__asset_glyph_load(ASSET_FONT_T *af, uint32_t unicode)
+{
+    OPERATE_RET rt = OPRT_OK;
+    ASSET_GLYPH_T *glyph = NULL;
+    ASSET_GLYPH_T head;
+    uint32_t key = ASSET_KEY(af->entry_id, unicode);
+    uint32_t offset, size;
+    int32_t low = 0, high = (int32_t)af->glyph_num - 1, mid = 0;
+
+    glyph = (ASSET_GLYPH_T *)ui_asset_cache_get(key);
+    if (glyph) {
+        return glyph;
+    }
+
+    while (low <= high) {
+        mid = (low + high) / 2;
+        if (af->index[mid].unicode == unicode) {
+            break;
+        } else if (af->index[mid].unicode < unicode) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    if (low > high) {
+        return NULL;
+    }
+
+    offset = sg_asset.entry[af->entry_id].offset + af->index[mid].offset;
+    TUYA_CALL_ERR_LOG(__asset_read(offset, &head, sizeof(ASSET_GLYPH_T)));
+    if (OPRT_OK != rt) {
+        return NULL;
+    }
+
+    size = ((uint32_t)head.box_w * head.box_h * af->bpp + 7) / 8;
+    glyph = (ASSET_GLYPH_T *)ui_asset_cache_alloc(key, sizeof(ASSET_GLYPH_T) + size);
+    if (NULL == glyph) {
+        return NULL;
+    }
+
+    memcpy(glyph, &head, sizeof(ASSET_GLYPH_T));
+    if (size && OPRT_OK != __asset_read(offset + sizeof(ASSET_GLYPH_T), glyph->bitmap, size)) {
+        ui_asset_cache_remove(key);
+        return NULL;
+    }
+
+    return glyph;
+}
+
+static bool __asset_font_get_glyph_dsc(const lv_font_t *font, lv_font_glyph_dsc_t *dsc_out, uint32_t unicode_letter,
+                                       uint32_t unicode_letter_next)
+{
+    ASSET_FONT_T *af = (ASSET_FONT_T *)font->dsc;
+    ASSET_GLYPH_T *glyph = NULL;
+    bool is_tab = (unicode_letter == '\t');
+    uint32_t adv_w;
+
+    (void)unicode_letter_next;
+
+    if (is_tab) {
+        unicode_letter = ' ';
+    }
+
+    glyph = __asset_glyph_load(af, unicode_letter);
+    if (NULL == glyph) {
+        return false;
+    }
+
+    adv_w = glyph->adv_w;
+    if (is_tab) {
+        adv_w *= 2;
+    }
+
+    dsc_out->adv_w = (adv_w + (1 << 3)) >> 4;
+    dsc_out->box_w = is_tab ? glyph->box_w * 2 : glyph->box_w;
+    dsc_out->box_h = glyph->box_h;
+    dsc_out->ofs_x = glyph->ofs_x;
+    dsc_out->ofs_y = glyph->ofs_y;
+    dsc_out->format = (lv_font_glyph_format_t)af->bpp;
+    dsc_out->is_placeholder = false;
+    dsc_out->gid.index = unicode_letter;
+
+    return true;
+}
+
+static const void *__asset_font_get_glyph_bitmap(lv_font_glyph_dsc_t *g_dsc, lv_draw_buf_t *draw_buf)
+{
+    ASSET_FONT_T *af = (ASSET_FONT_T *)g_dsc->resolved_font->dsc;
+    ASSET_GLYPH_T *glyph = NULL;
+    const uint8_t *bitmap_in = NULL;
+    uint8_t *bitmap_out = NULL;
+    uint32_t stride, bit = 0;
+    int32_t x, y;
+
+    if (NULL == draw_buf) {
+        return NULL;
+    }
+
+    glyph = __asset_glyph_load(af, g_dsc->gid.index);
+    if (NULL == glyph || 0 == glyph->box_w || 0 == glyph->box_h) {
+        return NULL;
+    }
+
+    // expand the packed 1/2/4/8 bpp bitmap into A8, same as lv_font_get_bitmap_fmt_txt
+    bitmap_in = glyph->bitmap;
+    bitmap_out = draw_buf->data;
+    stride = lv_draw_buf_width_to_stride(glyph->box_w, LV_COLOR_FORMAT_A8);
+
+    for (y = 0; y < glyph->box_h; y++) {
+        for (x = 0; x < glyph->box_w; x++, bit += af->bpp) {
+            uint8_t byte = bitmap_in[bit >> 3];
+            uint8_t shift = 8 - af->bpp - (bit & 0x7);
+
+            switch (af->bpp) {
+            case 1:
+                bitmap_out[x] = ((byte >> shift) & 0x1) ? 0xFF : 0x00;
+                break;
+            case 2:
+                bitmap_out[x] = sg_opa2_table[(byte >> shift) & 0x3];
+                break;
+            case 4:
+                bitmap_out[x] = sg_opa4_table[(byte >> shift) & 0xF];
+                break;
+            default:
+                bitmap_out[x] = byte;
+                break;
+            }
+        }
+        bitmap_out += stride;
+    }
+
+    return draw_buf;
+}
+
+static const lv_image_dsc_t *__asset_image_load(int entry_id)
+{
+    OPERATE_RET rt = OPRT_OK;
+    lv_image_dsc_t *img = NULL;
+    ASSET_IMAGE_HEAD_T head;
+    uint32_t key = ASSET_KEY(entry_id, ASSET_KEY_IMAGE);
+    uint32_t offset = sg_asset.entry[entry_id].offset;
+
+    img = (lv_image_dsc_t *)ui_asset_cache_get(key);
+    if (img) {
+        return img;
+    }
+
+    TUYA_CALL_ERR_LOG(__asset_read(offset, &head, sizeof(ASSET_IMAGE_HEAD_T)));
+    if (OPRT_OK != rt) {
+        return NULL;
+    }
+
+    // keep the pixel data 4 byte aligned behind the descriptor
+    img = (lv_image_dsc_t *)ui_asset_cache_alloc(key, LV_ALIGN_UP(sizeof(lv_image_dsc_t), 4) + head.data_size);
+    if (NULL == img) {
+        return NULL;
+    }
+
+    memset(img, 0, sizeof(lv_image_dsc_t));
+    img->header.magic = LV_IMAGE_HEADER_MAGIC;
+    img->header.cf = head.cf;
+    img->header.w = head.w;
+    img->header.h = head.h;
+    img->header.stride = head.stride;
+    img->data_size = head.data_size;
+    img->data = (const uint8_t *)img + LV_ALIGN_UP(sizeof(lv_image_dsc_t), 4);
+
+    if (OPRT_OK != __asset_read(offset + sizeof(ASSET_IMAGE_HEAD_T), (void *)img->data, head.data_size)) {
+        ui_asset_cache_remove(key);
+        return NULL;
+    }
+
+    return img;
+}
+
+static const void *__asset_emoji_path_cb(const lv_font_t *font, uint32_t unicode, uint32_t unicode_next,
+                                         int32_t *offset_y, void *user_data)
+{
+    char name[UI_ASSET_NAME_LEN];
+    int entry_id;
+
+    (void)font;
+    (void)unicode_next;
+    (void)offset_y;
+
+    snprintf(name, sizeof(name), "emoji_%x_%d", (unsigned int)unicode, (int)(uintptr_t)user_data);
+    entry_id = __asset_entry_find(name, UI_ASSET_TYPE_IMAGE);
+    if (entry_id < 0) {
+        return NULL;
+    }
+
+    return __asset_image_load(entry_id);
+}
+
+/**
+ * @brief Open the asset pack and set up the glyph/bitmap cache
+ *
+ * @param path File system path of the pack, used when flash_addr is 0
+ * @param flash_addr Start address of the flash partition holding the pack, 0 to use path
+ * @param cache_size Size of the LRU cache in bytes
+ * @return OPERATE_RET OPRT_OK on success
+ */
+OPERATE_RET ui_asset_init(const char *path, uint32_t flash_addr, uint32_t cache_size)
+{
+    OPERATE_RET rt = OPRT_OK;
+    ASSET_HEADER_T header;
+    uint32_t table_size;
+    lv_display_t *disp = NULL;
+
+    if (sg_asset.entry) {
+        return OPRT_OK;
+    }
+
+    if (0 == flash_addr) {
+        if (NULL == path) {
+            return OPRT_INVALID_PARM;
+        }
+        sg_asset.file = tal_fopen(path, "r");
+        if (NULL == sg_asset.file) {
+            PR_ERR("open asset pack %s failed", path);
+            return OPRT_FILE_OPEN_FAILED;
+        }
+    }
+    sg_asset.flash_addr = flash_addr;
+
+    TUYA_CALL_ERR_GOTO(__asset_read(0, &header, sizeof(ASSET_HEADER_T)), __ERR);
+    if (memcmp(header.magic, UI_ASSET_MAGIC, 4) || header.version != UI_ASSET_VERSION) {
+        PR_ERR("invalid asset pack, version %d", header.version);
+        rt = OPRT_INVALID_PARM;
+        goto __ERR;
+    }
+
+    table_size = header.entry_num * sizeof(ASSET_ENTRY_T);
+    sg_asset.entry = (ASSET_ENTRY_T *)tkl_system_psram_malloc(table_size);
+    if (NULL == sg_asset.entry) {
+        rt = OPRT_MALLOC_FAILED;
+        goto __ERR;
+    }
+    TUYA_CALL_ERR_GOTO(__asset_read(sizeof(ASSET_HEADER_T), sg_asset.entry, table_size), __ERR);
+    sg_asset.entry_num = header.entry_num;
+
+    TUYA_CALL_ERR_GOTO(ui_asset_cache_init(cache_size, __asset_cache_evict_cb), __ERR);
+
+    disp = lv_display_get_default();
+    if (disp) {
+        lv_display_add_event_cb(disp, __asset_refr_event_cb, LV_EVENT_REFR_START, NULL);
+        lv_display_add_event_cb(disp, __asset_refr_event_cb, LV_EVENT_REFR_READY, NULL);
+    }
+
+    PR_DEBUG("asset pack: %d entries, %d bytes, cache %d bytes", header.entry_num, header.total_size, cache_size);
+
+    return OPRT_OK;
+
+__ERR:
+    if (sg_asset.entry) {
+        tkl_system_psram_free(sg_asset.entry);
+        sg_asset.entry = NULL;
+    }
+    sg_asset.entry_num = 0;
+    if (sg_asset.file) {
+        tal_fclose(sg_asset.file);
+        sg_asset.file = NULL;
+    }
+    return rt;
+}
+
+/**
+ * @brief Get a font from the asset pack
+ *
+ * @param name Asset name, the file name of the C font (e.g. "font_puhui_16_2")
+ * @return lv_font_t* The font, NULL if not found
+ */
+lv_font_t *ui_asset_font_get(const char *name)
+{
+    OPERATE_RET rt = OPRT_OK;
+    ASSET_FONT_T *af = NULL;
+    ASSET_FONT_HEAD_T head;
+    uint32_t index_size;
+    int entry_id;
+    uint8_t i;
+
+    entry_id = __asset_entry_find(name, UI_ASSET_TYPE_FONT);
+    if (entry_id < 0) {
+        PR_ERR("font %s not in asset pack", name);
+        return NULL;
+    }
+
+    for (i = 0; i < sg_asset.font_num; i++) {
+        if (sg_asset.font[i]->entry_id == entry_id) {
+            return &sg_asset.font[i]->font;
+        }
+    }
+
+    if (sg_asset.font_num >= ASSET_FONT_MAX_NUM) {
+        PR_ERR("too many asset fonts");
+        return NULL;
+    }
+
+    TUYA_CALL_ERR_LOG(__asset_read(sg_asset.entry[entry_id].offset, &head, sizeof(ASSET_FONT_HEAD_T)));
+    if (OPRT_OK != rt) {
+        return NULL;
+    }
+
+    af = (ASSET_FONT_T *)tkl_system_psram_malloc(sizeof(ASSET_FONT_T));
+    if (NULL == af) {
+        return NULL;
+    }
+    memset(af, 0, sizeof(ASSET_FONT_T));
+
+    // the code point index is the only per-glyph data kept outside the cache
+    index_size = head.glyph_num * sizeof(ASSET_GLYPH_IDX_T);
+    af->index = (ASSET_GLYPH_IDX_T *)tkl_system_psram_malloc(index_size);
+    if (NULL == af->index) {
+        tkl_system_psram_free(af);
+        return NULL;
+    }
+    if (OPRT_OK !=
+        __asset_read(sg_asset.entry[entry_id].offset + sizeof(ASSET_FONT_HEAD_T), af->index, index_size)) {
+        tkl_system_psram_free(af->index);
+        tkl_system_psram_free(af);
+        return NULL;
+    }
+
+    af->entry_id = entry_id;
+    af->bpp = head.bpp;
+    af->glyph_num = head.glyph_num;
+
+    af->font.get_glyph_dsc = __asset_font_get_glyph_dsc;
+    af->font.get_glyph_bitmap = __asset_font_get_glyph_bitmap;
+    af->font.line_height = head.line_height;
+    af->font.base_line = head.base_line;
+    af->font.subpx = LV_FONT_SUBPX_NONE;
+    af->font.underline_position = head.underline_position;
+    af->font.underline_thickness = head.underline_thickness;
+    af->font.dsc = af;
+    af->font.fallback = NULL;
+
+    sg_asset.font[sg_asset.font_num++] = af;
+
+    return &af->font;
+}
+
+/**
+ * @brief Get an image font mapping emoji code points to the "emoji_<code>_<size>" images
+ *
+ * @param size Emoji size in pixels
+ * @return lv_font_t* The emoji font, NULL on error
+ */
+lv_font_t *ui_asset_emoji_font_get(uint32_t size)
+{
+    lv_font_t *font = NULL;
+    uint8_t i;
+
+    for (i = 0; i < sg_asset.emoji_num; i++) {
+        if (sg_asset.emoji[i].size == size) {
+            return sg_asset.emoji[i].font;
+        }
+    }
+
+    if (sg_asset.emoji_num >= ASSET_EMOJI_MAX_NUM) {
+        return NULL;
+    }
+
+    font = lv_imgfont_create(size, __asset_emoji_path_cb, (void *)(uintptr_t)size);
+    if (NULL == font) {
+        PR_ERR("create emoji font failed");
+        return NULL;
+    }
+    font->base_line = 0;
+    font->fallback = NULL;
+
+    sg_asset.emoji[sg_asset.emoji_num].size = size;
+    sg_asset.emoji[sg_asset.emoji_num].font = font;
+    sg_asset.emoji_num++;
+
+    return font;
+}
+
+/**
+ * @brief Get an image from the asset pack
+ *
+ * @note The image lives in the cache, it stays valid until it is evicted.
+ *       Images that are shown permanently should be copied by the caller.
+ *
+ * @param name Asset name, the variable name of the C image
+ * @return const lv_image_dsc_t* The image, NULL if not found
+ */
+const lv_image_dsc_t *ui_asset_image_get(const char *name)
+{
+    int entry_id = __asset_entry_find(name, UI_ASSET_TYPE_IMAGE);
+
+    if (entry_id < 0) {
+        return NULL;
+    }
+
+    return __asset_image_load(entry_id);
+}
+
+/**
+ * @brief Get the asset pack and cache statistics
+ *
+ * @param stat Pointer to store the statistics
+ * @return OPERATE_RET OPRT_OK on success
+ */
+OPERATE_RET ui_asset_get_stat(UI_ASSET_STAT_T *stat)
+{
+    if (NULL == stat) {
+        return OPRT_INVALID_PARM;
+    }
+
+    stat->entry_num = sg_asset.entry_num;
+    ui_asset_cache_get_stat(&stat->cache_capacity, &stat->cache_used, &stat->cache_hit, &stat->cache_miss);
+
+    return OPRT_OK;
+}
@@ -0,0 +1,101 @@
+/**
+ * @file ui_asset.h
+ * @brief Header file for the packed UI assets (fonts, emoji and images)
+ *
+ * The assets are produced by script/pack_assets.py from the LVGL C sources and
+ * stored either in a file or in a raw flash partition. Fonts and images are
+ * loaded lazily, glyph by glyph, into an LRU cache in PSRAM whose size is fixed
+ * by configuration, so neither the firmware image nor the RAM usage grows with
+ * the number of languages or emoji.
+ *
+ * All functions must be called with the LVGL lock held.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __UI_ASSET_H__
+#define __UI_ASSET_H__
+
+#include "tuya_cloud_types.h"
+
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define UI_ASSET_MAGIC       "TYAP"
+#define UI_ASSET_VERSION     1
+#define UI_ASSET_NAME_LEN    28
+
+#define UI_ASSET_TYPE_FONT  1
+#define UI_ASSET_TYPE_IMAGE 2
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint32_t entry_num;
+    uint32_t cache_capacity;
+    uint32_t cache_used;
+    uint32_t cache_hit;
+    uint32_t cache_miss;
+} UI_ASSET_STAT_T;
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+/**
+ * @brief Open the asset pack and set up the glyph/bitmap cache
+ *
+ * @param path File system path of the pack, used when flash_addr is 0
+ * @param flash_addr Start address of the flash partition holding the pack, 0 to use path
+ * @param cache_size Size of the LRU cache in bytes
+ * @return OPERATE_RET OPRT_OK on success
+ */
+OPERATE_RET ui_asset_init(const char *path, uint32_t flash_addr, uint32_t cache_size);
+
+/**
+ * @brief Get a font from the asset pack
+ *
+ * @param name Asset name, the file name of the C font (e.g. "font_puhui_16_2")
+ * @return lv_font_t* The font, NULL if not found
+ */
+lv_font_t *ui_asset_font_get(const char *name);
+
+/**
+ * @brief Get an image font mapping emoji code points to the "emoji_<code>_<size>" images
+ *
+ * @param size Emoji size in pixels
+ * @return lv_font_t* The emoji font, NULL on error
+ */
+lv_font_t *ui_asset_emoji_font_get(uint32_t size);
+
+/**
+ * @brief Get an image from the asset pack
+ *
+ * @note The image lives in the cache, it stays valid until it is evicted.
+ *       Images that are shown permanently should be copied by the caller.
+ *
+ * @param name Asset name, the variable name of the C image
+ * @return const lv_image_dsc_t* The image, NULL if not found
+ */
+const lv_image_dsc_t *ui_asset_image_get(const char *name);
+
+/**
+ * @brief Get the asset pack and cache statistics
+ *
+ * @param stat Pointer to store the statistics
+ * @return OPERATE_RET OPRT_OK on success
+ */
+OPERATE_RET ui_asset_get_stat(UI_ASSET_STAT_T *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UI_ASSET_H__ */
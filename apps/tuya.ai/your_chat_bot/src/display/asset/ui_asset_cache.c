@@ -0,0 +1,278 @@
+/**
+ * @file ui_asset_cache.c
+ * @brief LRU cache for glyphs and bitmaps loaded from the asset pack
+ *
+ * Items live in a hash table for lookup and in a list ordered by use for
+ * eviction. The memory comes from PSRAM and is bounded by the capacity given
+ * at initialization. Items used since the start of a draw pass are never
+ * evicted before the pass ends, LVGL may still read them.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "tuya_cloud_types.h"
+
+#include "tal_log.h"
+#include "tkl_memory.h"
+#include "tuya_list.h"
+
+#include "ui_asset_cache.h"
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define CACHE_HASH_SIZE 256
+#define CACHE_HASH(key) (((key) ^ ((key) >> 8) ^ ((key) >> 21)) & (CACHE_HASH_SIZE - 1))
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct ui_asset_cache_item {
+    LIST_HEAD lru_node;
+    struct ui_asset_cache_item *hash_next;
+    uint32_t key;
+    uint32_t size;
+    uint32_t pass; // the last draw pass the item was used in
+    uint8_t data[0];
+} UI_ASSET_CACHE_ITEM_T;
+
+typedef struct {
+    uint32_t capacity;
+    uint32_t used;
+    uint32_t hit;
+    uint32_t miss;
+
+    uint32_t pass;
+    bool in_pass;
+
+    UI_ASSET_CACHE_EVICT_CB evict_cb;
+
+    LIST_HEAD lru_list; // head is the most recently used
+    UI_ASSET_CACHE_ITEM_T *hash[CACHE_HASH_SIZE];
+} UI_ASSET_CACHE_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static UI_ASSET_CACHE_T *sg_cache = NULL;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static UI_ASSET_CACHE_ITEM_T *__cache_find(uint32_t key, UI_ASSET_CACHE_ITEM_T ***link)
+{
+    UI_ASSET_CACHE_ITEM_T **pp = &sg_cache->hash[CACHE_HASH(key)];
+
+    while (*pp) {
+        if ((*pp)->key == key) {
+            if (link) {
+                *link = pp;
+            }
+            return *pp;
+        }
+        pp = &(*pp)->hash_next;
+    }
+
+    return NULL;
+}
+
+static void __cache_item_free(UI_ASSET_CACHE_ITEM_T *item, UI_ASSET_CACHE_ITEM_T **link)
+{
+    if (sg_cache->evict_cb) {
+        sg_cache->evict_cb(item->key, item->data);
+    }
+
+    *link = item->hash_next;
+    tuya_list_del(&item->lru_node);
+    sg_cache->used -= sizeof(UI_ASSET_CACHE_ITEM_T) + item->size;
+
+    tkl_system_psram_free(item);
+}
+
+static bool __cache_evict_lru(void)
+{
+    UI_ASSET_CACHE_ITEM_T *item = NULL, **link = NULL;
+
+    if (tuya_list_empty(&sg_cache->lru_list)) {
+        return false;
+    }
+
+    // the items of the pass are the most recently used ones, when the last is pinned all are
+    item = tuya_list_entry(sg_cache->lru_list.prev, UI_ASSET_CACHE_ITEM_T, lru_node);
+    if (sg_cache->in_pass && item->pass == sg_cache->pass) {
+        return false;
+    }
+
+    if (__cache_find(item->key, &link) == item) {
+        __cache_item_free(item, link);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Initialize the cache
+ *
+ * @param capacity Max bytes held by the cache, item headers included
+ * @param evict_cb Called before an item is freed, can be NULL
+ * @return OPERATE_RET OPRT_OK on success
+ */
+OPERATE_RET ui_asset_cache_init(uint32_t capacity, UI_ASSET_CACHE_EVICT_CB evict_cb)
+{
+    if (sg_cache) {
+        return OPRT_OK;
+    }
+
+    sg_cache = (UI_ASSET_CACHE_T *)tkl_system_psram_malloc(sizeof(UI_ASSET_CACHE_T));
+    if (NULL == sg_cache) {
+        return OPRT_MALLOC_FAILED;
+    }
+    memset(sg_cache, 0, sizeof(UI_ASSET_CACHE_T));
+
+    sg_cache->capacity = capacity;
+    sg_cache->evict_cb = evict_cb;
+    INIT_LIST_HEAD(&sg_cache->lru_list);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Look up an item and mark it as most recently used
+ *
+ * @param key Item key
+ * @return void* Item data, NULL on miss
+ */
+void *ui_asset_cache_get(uint32_t key)
+{
+    UI_ASSET_CACHE_ITEM_T *item = NULL;
+
+    if (NULL == sg_cache) {
+        return NULL;
+    }
+
+    item = __cache_find(key, NULL);
+    if (NULL == item) {
+        sg_cache->miss++;
+        return NULL;
+    }
+
+    sg_cache->hit++;
+    item->pass = sg_cache->pass;
+    tuya_list_del(&item->lru_node);
+    tuya_list_add(&item->lru_node, &sg_cache->lru_list);
+
+    return item->data;
+}
+
+/**
+ * @brief Allocate a new item, evicting least recently used items if needed
+ *
+ * @param key Item key, must not be in the cache yet
+ * @param size Data size in bytes
+ * @return void* Item data to be filled by the caller, NULL if it does not fit
+ */
+void *ui_asset_cache_alloc(uint32_t key, uint32_t size)
+{
+    UI_ASSET_CACHE_ITEM_T *item = NULL;
+    uint32_t need = sizeof(UI_ASSET_CACHE_ITEM_T) + size;
+
+    if (NULL == sg_cache || need > sg_cache->capacity) {
+        return NULL;
+    }
+
+    while (sg_cache->used + need > sg_cache->capacity) {
+        if (!__cache_evict_lru()) {
+            PR_ERR("asset cache full with the items of the draw pass, %d bytes", sg_cache->used);
+            return NULL;
+        }
+    }
+
+    item = (UI_ASSET_CACHE_ITEM_T *)tkl_system_psram_malloc(need);
+    while (NULL == item && __cache_evict_lru()) {
+        // the heap is fragmented, give back more memory
+        item = (UI_ASSET_CACHE_ITEM_T *)tkl_system_psram_malloc(need);
+    }
+    if (NULL == item) {
+        PR_ERR("asset cache malloc %d failed", need);
+        return NULL;
+    }
+
+    item->key = key;
+    item->size = size;
+    item->pass = sg_cache->pass;
+    item->hash_next = sg_cache->hash[CACHE_HASH(key)];
+    sg_cache->hash[CACHE_HASH(key)] = item;
+    tuya_list_add(&item->lru_node, &sg_cache->lru_list);
+    sg_cache->used += need;
+
+    return item->data;
+}
+
+/**
+ * @brief Remove an item, typically after the caller failed to fill it
+ *
+ * @param key Item key
+ */
+void ui_asset_cache_remove(uint32_t key)
+{
+    UI_ASSET_CACHE_ITEM_T *item = NULL, **link = NULL;
+
+    if (NULL == sg_cache) {
+        return;
+    }
+
+    item = __cache_find(key, &link);
+    if (item) {
+        __cache_item_free(item, link);
+    }
+}
+
+/**
+ * @brief Start a draw pass, the items used from now on are kept until it ends
+ */
+void ui_asset_cache_pass_begin(void)
+{
+    if (NULL == sg_cache) {
+        return;
+    }
+
+    sg_cache->pass++;
+    sg_cache->in_pass = true;
+}
+
+/**
+ * @brief End the draw pass, its items can be evicted again
+ */
+void ui_asset_cache_pass_end(void)
+{
+    if (NULL == sg_cache) {
+        return;
+    }
+
+    sg_cache->in_pass = false;
+}
+
+/**
+ * @brief Get the cache usage
+ *
+ * @param capacity Capacity in bytes, can be NULL
+ * @param used Used bytes, can be NULL
+ * @param hit Number of hits, can be NULL
+ * @param miss Number of misses, can be NULL
+ */
+void ui_asset_cache_get_stat(uint32_t *capacity, uint32_t *used, uint32_t *hit, uint32_t *miss)
+{
+    if (capacity) {
+        *capacity = sg_cache ? sg_cache->capacity : 0;
+    }
+    if (used) {
+        *used = sg_cache ? sg_cache->used : 0;
+    }
+    if (hit) {
+        *hit = sg_cache ? sg_cache->hit : 0;
+    }
+    if (miss) {
+        *miss = sg_cache ? sg_cache->miss : 0;
+    }
+}
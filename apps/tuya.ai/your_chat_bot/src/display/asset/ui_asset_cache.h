@@ -0,0 +1,91 @@
+/**
+ * @file ui_asset_cache.h
+ * @brief LRU cache for glyphs and bitmaps loaded from the asset pack
+ *
+ * Items are keyed by a 32-bit key and allocated from PSRAM. When the total
+ * size would exceed the capacity, the least recently used items are evicted,
+ * except the ones used during the current draw pass.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __UI_ASSET_CACHE_H__
+#define __UI_ASSET_CACHE_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef void (*UI_ASSET_CACHE_EVICT_CB)(uint32_t key, void *data);
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+/**
+ * @brief Initialize the cache
+ *
+ * @param capacity Max bytes held by the cache, item headers included
+ * @param evict_cb Called before an item is freed, can be NULL
+ * @return OPERATE_RET OPRT_OK on success
+ */
+OPERATE_RET ui_asset_cache_init(uint32_t capacity, UI_ASSET_CACHE_EVICT_CB evict_cb);
+
+/**
+ * @brief Look up an item and mark it as most recently used
+ *
+ * @param key Item key
+ * @return void* Item data, NULL on miss
+ */
+void *ui_asset_cache_get(uint32_t key);
+
+/**
+ * @brief Allocate a new item, evicting least recently used items if needed
+ *
+ * @param key Item key, must not be in the cache yet
+ * @param size Data size in bytes
+ * @return void* Item data to be filled by the caller, NULL if it does not fit
+ */
+void *ui_asset_cache_alloc(uint32_t key, uint32_t size);
+
+/**
+ * @brief Remove an item, typically after the caller failed to fill it
+ *
+ * @param key Item key
+ */
+void ui_asset_cache_remove(uint32_t key);
+
+/**
+ * @brief Start a draw pass, the items used from now on are kept until it ends
+ */
+void ui_asset_cache_pass_begin(void);
+
+/**
+ * @brief End the draw pass, its items can be evicted again
+ */
+void ui_asset_cache_pass_end(void);
+
+/**
+ * @brief Get the cache usage
+ *
+ * @param capacity Capacity in bytes, can be NULL
+ * @param used Used bytes, can be NULL
+ * @param hit Number of hits, can be NULL
+ * @param miss Number of misses, can be NULL
+ */
+void ui_asset_cache_get_stat(uint32_t *capacity, uint32_t *used, uint32_t *hit, uint32_t *miss);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UI_ASSET_CACHE_H__ */
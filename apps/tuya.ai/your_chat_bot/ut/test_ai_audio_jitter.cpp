@@ -0,0 +1,220 @@
+/**
+ * @file test_ai_audio_jitter.cpp
+ * @brief UT of the jitter buffer of the MP3 player, replaying arrival traces.
+ *
+ * A trace lists when the TTS stream data arrives and how many 24 ms frames
+ * it holds. The replay runs on a simulated millisecond clock: what arrived is
+ * decoded into the pool as long as it has room, like the decode-ahead of the
+ * player task, and the speaker pops a frame whenever it is done with the last
+ * one. Each replay prints the underruns and the latency it added.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "tuya_cloud_types.h"
+#include "tuya_error_code.h"
+#include "ai_audio_jitter.h"
+}
+
+#define FRAME_RATE    24000
+#define FRAME_SAMPLES 576 // 24 ms
+#define FRAME_SIZE    (FRAME_SAMPLES * 2)
+#define FRAME_MS      24
+#define POOL_FRAMES   24
+#define SAMPLE_VALUE  10000
+
+namespace {
+
+struct Arrival {
+    uint32_t at_ms;
+    uint32_t frames;
+};
+
+struct Replay {
+    AI_AUDIO_JITTER_STATS_T stats;
+    uint32_t played;
+    uint32_t concealed;
+    uint32_t end_ms;
+    int16_t conceal_last;  // last sample of the first concealed frame
+    int16_t resume_first;  // first sample of the frame after it
+};
+
+std::vector<Arrival> __steady(uint32_t frames, uint32_t from_ms = 0)
+{
+    std::vector<Arrival> trace;
+
+    for (uint32_t i = 0; i < frames; i++) {
+        trace.push_back({from_ms + i * FRAME_MS, 1});
+    }
+    return trace;
+}
+
+// bursts of frames that keep up with the playback on average, every other one late
+std::vector<Arrival> __bursty(uint32_t bursts, uint32_t frames_per_burst, uint32_t late_ms)
+{
+    std::vector<Arrival> trace;
+
+    for (uint32_t i = 0; i < bursts; i++) {
+        trace.push_back({i * frames_per_burst * FRAME_MS + ((i & 1) ? late_ms : 0), frames_per_burst});
+    }
+    return trace;
+}
+
+Replay __replay(AI_AUDIO_JITTER_HANDLE jb, const std::vector<Arrival> &trace, const char *name)
+{
+    Replay r = {};
+    uint32_t now = 0, next = 0, backlog = 0, total = 0, busy_until = 0, underruns = 0;
+    bool in_conceal = false;
+
+    for (auto &a : trace) {
+        total += a.frames;
+    }
+
+    ai_audio_jitter_reset(jb);
+    for (now = 0; r.played < total; now++) {
+        if (now >= 600000U) {
+            ADD_FAILURE() << name << " never ends";
+            break;
+        }
+
+        for (; next < trace.size() && trace[next].at_ms <= now; next++) {
+            ai_audio_jitter_arrival(jb, now);
+            backlog += trace[next].frames;
+        }
+        for (uint8_t *pcm; backlog && (pcm = ai_audio_jitter_frame_alloc(jb)) != NULL; backlog--) {
+            for (uint32_t i = 0; i < FRAME_SAMPLES; i++) {
+                ((int16_t *)pcm)[i] = SAMPLE_VALUE;
+            }
+            ai_audio_jitter_frame_commit(jb, FRAME_SIZE, FRAME_RATE, 1);
+        }
+
+        if (now < busy_until) {
+            continue;
+        }
+        uint8_t *pcm = NULL;
+        uint32_t len = 0;
+        bool is_eof = next == trace.size() && 0 == backlog;
+        if (OPRT_OK != ai_audio_jitter_frame_pop(jb, now, is_eof, &pcm, &len)) {
+            continue;
+        }
+        EXPECT_EQ((uint32_t)FRAME_SIZE, len);
+
+        AI_AUDIO_JITTER_STATS_T stats;
+        ai_audio_jitter_stats_get(jb, &stats);
+        if (stats.underruns > underruns) {
+            // the last frame again, faded out
+            underruns = stats.underruns;
+            r.concealed++;
+            if (1 == r.concealed) {
+                r.conceal_last = ((int16_t *)pcm)[FRAME_SAMPLES - 1];
+                in_conceal = true;
+            }
+        } else {
+            if (in_conceal) {
+                r.resume_first = ((int16_t *)pcm)[0];
+                in_conceal = false;
+            }
+            r.played++;
+        }
+        busy_until = now + FRAME_MS;
+        ai_audio_jitter_frame_release(jb);
+    }
+
+    r.end_ms = busy_until;
+    ai_audio_jitter_stats_get(jb, &r.stats);
+    printf("[ REPLAY   ] %-10s %4u frames: underruns %u, latency %u ms, rebuffer %u ms, watermark %u ms\n", name,
+           total, r.stats.underruns, r.stats.latency_ms, r.stats.rebuffer_ms, r.stats.watermark_ms);
+    return r;
+}
+
+class AiAudioJitter : public ::testing::Test {
+  protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(OPRT_OK, ai_audio_jitter_create(POOL_FRAMES, FRAME_SIZE, &jb));
+    }
+
+    void TearDown() override
+    {
+        ai_audio_jitter_destroy(jb);
+    }
+
+    AI_AUDIO_JITTER_HANDLE jb = nullptr;
+};
+
+} // namespace
+
+TEST_F(AiAudioJitter, SteadyStreamPlaysWithoutUnderruns)
+{
+    Replay r = __replay(jb, __steady(200), "steady");
+
+    EXPECT_EQ(0U, r.stats.underruns);
+    EXPECT_EQ(200U, r.played);
+    // the least prebuffer, not more
+    EXPECT_GE(r.stats.latency_ms, (uint32_t)AI_AUDIO_PLAYER_PREBUF_MIN_MS - FRAME_MS);
+    EXPECT_LE(r.stats.latency_ms, (uint32_t)AI_AUDIO_PLAYER_PREBUF_MIN_MS + FRAME_MS);
+}
+
+TEST_F(AiAudioJitter, ShortStreamPlaysAtTheEnd)
+{
+    // less than the watermark, the end of the stream starts it
+    Replay r = __replay(jb, __steady(2), "short");
+
+    EXPECT_EQ(0U, r.stats.underruns);
+    EXPECT_EQ(2U, r.played);
+    EXPECT_LE(r.stats.latency_ms, (uint32_t)FRAME_MS + 1);
+}
+
+TEST_F(AiAudioJitter, StallIsConcealedWithFades)
+{
+    std::vector<Arrival> trace = __steady(50);
+    std::vector<Arrival> after = __steady(50, 50 * FRAME_MS + 500);
+
+    trace.insert(trace.end(), after.begin(), after.end());
+    Replay r = __replay(jb, trace, "stall");
+
+    EXPECT_EQ(1U, r.stats.underruns);
+    EXPECT_EQ(1U, r.concealed);
+    EXPECT_EQ(100U, r.played);
+    EXPECT_GT(r.stats.rebuffer_ms, 0U);
+    // faded out to silence and back in from it, no click
+    EXPECT_LT(abs(r.conceal_last), SAMPLE_VALUE / 100);
+    EXPECT_EQ(0, r.resume_first);
+}
+
+TEST_F(AiAudioJitter, LearnsTheGapsOfABurstyStream)
+{
+    // 8 frames every 192 ms, every other burst 150 ms late
+    Replay first = __replay(jb, __bursty(20, 8, 150), "bursty");
+    Replay second = __replay(jb, __bursty(20, 8, 150), "bursty 2");
+
+    EXPECT_GT(first.stats.underruns, 0U);
+    EXPECT_EQ(160U, first.played);
+    // the next stream waits for the gap it learned and plays through
+    EXPECT_EQ(0U, second.stats.underruns);
+    EXPECT_GT(second.stats.latency_ms, first.stats.latency_ms);
+    EXPECT_LE(second.stats.latency_ms, (uint32_t)AI_AUDIO_PLAYER_PREBUF_MAX_MS);
+}
+
+TEST_F(AiAudioJitter, UnderrunsRaiseTheWatermark)
+{
+    std::vector<Arrival> trace;
+
+    // a frame every 30 ms only, the speaker keeps running dry
+    for (uint32_t i = 0; i < 100; i++) {
+        trace.push_back({i * 30, 1});
+    }
+    Replay slow = __replay(jb, trace, "slow");
+
+    EXPECT_GT(slow.stats.underruns, 0U);
+    EXPECT_EQ(100U, slow.played);
+    EXPECT_GE(slow.stats.watermark_ms, AI_AUDIO_PLAYER_PREBUF_MIN_MS + slow.stats.underruns * 25U);
+}
@@ -0,0 +1,250 @@
+/**
+ * @file test_ai_audio_trace.cpp
+ * @brief UT of the ring and the aggregation of the voice latency trace.
+ *
+ * The marks are stamped with the system millisecond clock, which the tests
+ * freeze and step with bench_clock_advance so every span is known.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "tuya_cloud_types.h"
+#include "tuya_error_code.h"
+#include "tal_api.h"
+#include "tal_cli.h"
+#include "bench_port.h"
+#include "ai_audio_trace.h"
+}
+
+#define CLOCK_START_MS 10000
+
+extern "C" {
+// the cli is not part of the host port
+int tal_cli_cmd_register(const cli_cmd_t *cmd, uint8_t num)
+{
+    return OPRT_OK;
+}
+}
+
+namespace {
+
+class AiAudioTrace : public ::testing::Test {
+  protected:
+    void SetUp() override
+    {
+        // the ring is static and lives on, start every case empty
+        ASSERT_EQ(OPRT_OK, ai_audio_trace_init());
+        ai_audio_trace_clear();
+        bench_clock_freeze(CLOCK_START_MS);
+    }
+
+    void TearDown() override
+    {
+        bench_clock_release();
+    }
+
+    void begin()
+    {
+        ai_audio_trace_begin((uint32_t)tal_system_get_millisecond());
+    }
+
+    void mark_after(uint32_t ms, AI_AUDIO_TRACE_STAGE_E stage)
+    {
+        bench_clock_advance(ms);
+        ai_audio_trace_mark(stage);
+    }
+
+    uint32_t stats()
+    {
+        return ai_audio_trace_stats_get(stages, &reply);
+    }
+
+    AI_AUDIO_TRACE_STATS_T stages[AI_AUDIO_TRACE_STAGE_NUM];
+    AI_AUDIO_TRACE_STATS_T reply;
+};
+
+} // namespace
+
+TEST_F(AiAudioTrace, SpansRunFromThePreviousStage)
+{
+    const uint32_t step[AI_AUDIO_TRACE_STAGE_NUM] = {0, 5, 20, 1500, 300, 400, 250, 60};
+
+    begin();
+    for (uint32_t s = AI_AUDIO_TRACE_UPLOAD_START; s < AI_AUDIO_TRACE_STAGE_NUM; s++) {
+        mark_after(step[s], (AI_AUDIO_TRACE_STAGE_E)s);
+    }
+
+    ASSERT_EQ(1U, stats());
+    EXPECT_EQ(0U, stages[AI_AUDIO_TRACE_VOICE_START].count);
+    for (uint32_t s = AI_AUDIO_TRACE_UPLOAD_START; s < AI_AUDIO_TRACE_STAGE_NUM; s++) {
+        EXPECT_EQ(1U, stages[s].count) << "stage " << s;
+        EXPECT_EQ(step[s], stages[s].p50_ms) << "stage " << s;
+        EXPECT_EQ(step[s], stages[s].max_ms) << "stage " << s;
+    }
+    EXPECT_EQ(1U, reply.count);
+    EXPECT_EQ(300U + 400U + 250U + 60U, reply.p50_ms);
+}
+
+TEST_F(AiAudioTrace, PercentilesAreNearestRank)
+{
+    // the asr spans are 100..1 ms, fed out of order
+    for (uint32_t i = 0; i < 100; i++) {
+        begin();
+        mark_after(100 - i, AI_AUDIO_TRACE_ASR_TEXT);
+    }
+
+    ASSERT_EQ(100U, stats());
+    EXPECT_EQ(100U, stages[AI_AUDIO_TRACE_ASR_TEXT].count);
+    EXPECT_EQ(50U, stages[AI_AUDIO_TRACE_ASR_TEXT].p50_ms);
+    EXPECT_EQ(90U, stages[AI_AUDIO_TRACE_ASR_TEXT].p90_ms);
+    EXPECT_EQ(99U, stages[AI_AUDIO_TRACE_ASR_TEXT].p99_ms);
+    EXPECT_EQ(100U, stages[AI_AUDIO_TRACE_ASR_TEXT].max_ms);
+
+    ai_audio_trace_clear();
+    for (uint32_t i = 1; i <= 10; i++) {
+        begin();
+        mark_after(i, AI_AUDIO_TRACE_ASR_TEXT);
+    }
+
+    ASSERT_EQ(10U, stats());
+    EXPECT_EQ(5U, stages[AI_AUDIO_TRACE_ASR_TEXT].p50_ms);
+    EXPECT_EQ(9U, stages[AI_AUDIO_TRACE_ASR_TEXT].p90_ms);
+    EXPECT_EQ(10U, stages[AI_AUDIO_TRACE_ASR_TEXT].p99_ms);
+}
+
+TEST_F(AiAudioTrace, FirstMarkOfAStageIsKept)
+{
+    begin();
+    mark_after(30, AI_AUDIO_TRACE_UPLOAD_START);
+    mark_after(70, AI_AUDIO_TRACE_UPLOAD_START);
+    mark_after(10, AI_AUDIO_TRACE_UPLOAD_FIRST);
+
+    ASSERT_EQ(1U, stats());
+    EXPECT_EQ(30U, stages[AI_AUDIO_TRACE_UPLOAD_START].max_ms);
+    EXPECT_EQ(80U, stages[AI_AUDIO_TRACE_UPLOAD_FIRST].max_ms);
+
+    // the next utterance stamps its stages again
+    begin();
+    mark_after(40, AI_AUDIO_TRACE_UPLOAD_START);
+
+    ASSERT_EQ(2U, stats());
+    EXPECT_EQ(2U, stages[AI_AUDIO_TRACE_UPLOAD_START].count);
+    EXPECT_EQ(40U, stages[AI_AUDIO_TRACE_UPLOAD_START].max_ms);
+}
+
+TEST_F(AiAudioTrace, MissingStagesAreSkipped)
+{
+    // a reply without asr text or nlg, as for a cloud skill
+    begin();
+    mark_after(5, AI_AUDIO_TRACE_UPLOAD_START);
+    mark_after(1000, AI_AUDIO_TRACE_UPLOAD_END);
+    mark_after(700, AI_AUDIO_TRACE_TTS_FIRST);
+
+    ASSERT_EQ(1U, stats());
+    EXPECT_EQ(0U, stages[AI_AUDIO_TRACE_UPLOAD_FIRST].count);
+    EXPECT_EQ(1000U, stages[AI_AUDIO_TRACE_UPLOAD_END].max_ms);
+    EXPECT_EQ(0U, stages[AI_AUDIO_TRACE_ASR_TEXT].count);
+    EXPECT_EQ(0U, stages[AI_AUDIO_TRACE_NLG_FIRST].count);
+    EXPECT_EQ(700U, stages[AI_AUDIO_TRACE_TTS_FIRST].max_ms);
+    // not played yet
+    EXPECT_EQ(0U, reply.count);
+}
+
+TEST_F(AiAudioTrace, StagesWithoutAnEarlierOneHaveNoSpan)
+{
+    begin();
+    mark_after(10, AI_AUDIO_TRACE_UPLOAD_START);
+    // the utterance goes on after a clear, its voice start is gone
+    ai_audio_trace_clear();
+    mark_after(10, AI_AUDIO_TRACE_PLAY_FIRST);
+    ai_audio_trace_mark(AI_AUDIO_TRACE_STAGE_NUM);
+
+    ASSERT_EQ(1U, stats());
+    for (uint32_t s = 0; s < AI_AUDIO_TRACE_STAGE_NUM; s++) {
+        EXPECT_EQ(0U, stages[s].count) << "stage " << s;
+    }
+    EXPECT_EQ(0U, reply.count);
+}
+
+TEST_F(AiAudioTrace, RingKeepsTheNewestUtterances)
+{
+    // two entries per utterance, the ring holds the last half of them
+    const uint32_t num = AI_AUDIO_TRACE_RING_SIZE;
+
+    for (uint32_t i = 0; i < num; i++) {
+        begin();
+        mark_after(i + 1, AI_AUDIO_TRACE_UPLOAD_START);
+    }
+
+    ASSERT_EQ(num / 2, stats());
+    EXPECT_EQ(num / 2, stages[AI_AUDIO_TRACE_UPLOAD_START].count);
+    EXPECT_EQ(num / 2 + num / 4, stages[AI_AUDIO_TRACE_UPLOAD_START].p50_ms);
+    EXPECT_EQ(num, stages[AI_AUDIO_TRACE_UPLOAD_START].max_ms);
+}
+
+TEST_F(AiAudioTrace, ClearDropsTheRecordedUtterances)
+{
+    begin();
+    mark_after(10, AI_AUDIO_TRACE_UPLOAD_START);
+    ASSERT_EQ(1U, stats());
+
+    ai_audio_trace_clear();
+    EXPECT_EQ(0U, stats());
+    EXPECT_EQ(0U, stages[AI_AUDIO_TRACE_UPLOAD_START].count);
+
+    begin();
+    mark_after(20, AI_AUDIO_TRACE_UPLOAD_START);
+    ASSERT_EQ(1U, stats());
+    EXPECT_EQ(20U, stages[AI_AUDIO_TRACE_UPLOAD_START].max_ms);
+}
+
+TEST_F(AiAudioTrace, ConcurrentMarksAreNotTorn)
+{
+    // eight entries per utterance, as many as the ring holds
+    const uint32_t rounds = AI_AUDIO_TRACE_RING_SIZE / AI_AUDIO_TRACE_STAGE_NUM;
+    volatile bool done = false;
+
+    // a reader aggregates while the stages are marked from four threads
+    std::thread reader([&]() {
+        AI_AUDIO_TRACE_STATS_T s[AI_AUDIO_TRACE_STAGE_NUM], r;
+
+        while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+            EXPECT_LE(ai_audio_trace_stats_get(s, &r), rounds);
+        }
+    });
+
+    for (uint32_t i = 0; i < rounds; i++) {
+        std::vector<std::thread> writers;
+
+        begin();
+        for (uint32_t t = 0; t < 4; t++) {
+            writers.emplace_back([t]() {
+                for (uint32_t s = AI_AUDIO_TRACE_UPLOAD_START + t; s < AI_AUDIO_TRACE_STAGE_NUM; s += 4) {
+                    ai_audio_trace_mark((AI_AUDIO_TRACE_STAGE_E)s);
+                    // the first mark of a stage wins
+                    ai_audio_trace_mark((AI_AUDIO_TRACE_STAGE_E)s);
+                }
+            });
+        }
+        for (auto &w : writers) {
+            w.join();
+        }
+        bench_clock_advance(1);
+    }
+    __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+    reader.join();
+
+    ASSERT_EQ(rounds, stats());
+    for (uint32_t s = AI_AUDIO_TRACE_UPLOAD_START; s < AI_AUDIO_TRACE_STAGE_NUM; s++) {
+        EXPECT_EQ(rounds, stages[s].count) << "stage " << s;
+        EXPECT_EQ(0U, stages[s].max_ms) << "stage " << s;
+    }
+    EXPECT_EQ(rounds, reply.count);
+}
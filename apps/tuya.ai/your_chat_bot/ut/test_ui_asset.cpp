@@ -0,0 +1,305 @@
+/**
+ * @file test_ui_asset.cpp
+ * @brief UT of the asset pack: pack_assets.py, ui_asset.c and its cache.
+ *
+ * The build packs font_puhui_14_1 and two emoji images with pack_assets.py.
+ * The same C font and images are linked into the test, so every glyph read
+ * back through ui_asset.c is compared with what the font decoder of LVGL
+ * gives for the C font, and every image byte for byte. The few LVGL calls of
+ * ui_asset.c outside the font decoder are faked here, the display events
+ * among them, to check that a refresh keeps what it uses in the cache.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "tuya_cloud_types.h"
+#include "tuya_error_code.h"
+#include "lvgl.h"
+#include "ui_asset.h"
+#include "ui_asset_cache.h"
+
+LV_FONT_DECLARE(font_puhui_14_1);
+LV_IMAGE_DECLARE(emoji_1f602_32);
+LV_IMAGE_DECLARE(emoji_1f602_64);
+}
+
+#define CACHE_SIZE  (32 * 1024)
+#define UNICODE_MAX 0x10000
+#define GLYPH_MAX   64
+
+namespace {
+
+struct Imgfont {
+    lv_font_t font;
+    lv_imgfont_get_path_cb_t path_cb;
+    void *user_data;
+};
+
+std::map<lv_event_code_t, lv_event_cb_t> sg_disp_events;
+std::vector<const void *> sg_dropped;
+std::vector<Imgfont *> sg_imgfonts;
+uint8_t sg_disp; // only its address is used
+
+void __refresh_event(lv_event_code_t code)
+{
+    ASSERT_EQ(1U, sg_disp_events.count(code));
+    sg_disp_events[code]((lv_event_t *)&code);
+}
+
+bool __glyph_get(const lv_font_t *font, uint32_t unicode, lv_font_glyph_dsc_t *dsc, uint8_t *bitmap)
+{
+    lv_draw_buf_t draw_buf;
+
+    memset(dsc, 0, sizeof(lv_font_glyph_dsc_t));
+    if (!font->get_glyph_dsc(font, dsc, unicode, 0)) {
+        return false;
+    }
+    dsc->resolved_font = font;
+
+    memset(&draw_buf, 0, sizeof(draw_buf));
+    memset(bitmap, 0, GLYPH_MAX * GLYPH_MAX);
+    draw_buf.data = bitmap;
+    font->get_glyph_bitmap(dsc, &draw_buf);
+    return true;
+}
+
+class UiAsset : public ::testing::Test {
+  protected:
+    void SetUp() override
+    {
+        // the pack is opened once for all the cases, like on the device
+        ASSERT_EQ(OPRT_OK, ui_asset_init(UT_ASSET_PACK, 0, CACHE_SIZE));
+    }
+};
+
+} // namespace
+
+/* The LVGL calls of ui_asset.c which are not part of the font decoder */
+extern "C" {
+
+uint32_t lv_draw_buf_width_to_stride(uint32_t w, lv_color_format_t color_format)
+{
+    // LV_DRAW_BUF_STRIDE_ALIGN is 1, only A8 is asked for
+    return (LV_COLOR_FORMAT_A8 == color_format) ? w : 0;
+}
+
+void lv_log_add(lv_log_level_t level, const char *file, int line, const char *func, const char *format, ...)
+{
+    (void)level;
+    (void)file;
+    (void)line;
+    (void)func;
+    (void)format;
+}
+
+void *lv_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+void lv_free(void *data)
+{
+    free(data);
+}
+
+void *lv_utils_bsearch(const void *key, const void *base, size_t n, size_t size,
+                       int (*cmp)(const void *pRef, const void *pElement))
+{
+    const uint8_t *low = (const uint8_t *)base;
+
+    while (n) {
+        const uint8_t *mid = low + (n / 2) * size;
+        int c = cmp(key, mid);
+
+        if (0 == c) {
+            return (void *)mid;
+        } else if (c > 0) {
+            low = mid + size;
+            n -= n / 2 + 1;
+        } else {
+            n /= 2;
+        }
+    }
+    return NULL;
+}
+
+void lv_image_cache_drop(const void *src)
+{
+    sg_dropped.push_back(src);
+}
+
+lv_font_t *lv_imgfont_create(uint16_t height, lv_imgfont_get_path_cb_t path_cb, void *user_data)
+{
+    Imgfont *f = new Imgfont();
+
+    f->font.line_height = height;
+    f->path_cb = path_cb;
+    f->user_data = user_data;
+    sg_imgfonts.push_back(f);
+    return &f->font;
+}
+
+lv_display_t *lv_display_get_default(void)
+{
+    return (lv_display_t *)&sg_disp;
+}
+
+void lv_display_add_event_cb(lv_display_t *disp, lv_event_cb_t event_cb, lv_event_code_t filter, void *user_data)
+{
+    (void)user_data;
+    if ((lv_display_t *)&sg_disp == disp) {
+        sg_disp_events[filter] = event_cb;
+    }
+}
+
+lv_event_code_t lv_event_get_code(lv_event_t *e)
+{
+    return *(lv_event_code_t *)e;
+}
+
+} // extern "C"
+
+TEST_F(UiAsset, GlyphsMatchTheCFont)
+{
+    static uint8_t want_bitmap[GLYPH_MAX * GLYPH_MAX], got_bitmap[GLYPH_MAX * GLYPH_MAX];
+    lv_font_t *font = ui_asset_font_get("font_puhui_14_1");
+    lv_font_glyph_dsc_t want, got;
+    uint32_t glyphs = 0;
+
+    ASSERT_NE(nullptr, font);
+    EXPECT_EQ(font_puhui_14_1.line_height, font->line_height);
+    EXPECT_EQ(font_puhui_14_1.base_line, font->base_line);
+    EXPECT_EQ(font_puhui_14_1.underline_position, font->underline_position);
+
+    // far more glyphs than the cache holds, most of them are evicted on the way
+    for (uint32_t u = 0; u < UNICODE_MAX; u++) {
+        bool found = __glyph_get(&font_puhui_14_1, u, &want, want_bitmap);
+
+        ASSERT_EQ(found, __glyph_get(font, u, &got, got_bitmap)) << std::hex << "U+" << u;
+        if (!found) {
+            continue;
+        }
+        ASSERT_LE(want.box_w, GLYPH_MAX);
+        ASSERT_LE(want.box_h, GLYPH_MAX);
+        EXPECT_EQ(want.adv_w, got.adv_w) << std::hex << "U+" << u;
+        EXPECT_EQ(want.box_w, got.box_w) << std::hex << "U+" << u;
+        EXPECT_EQ(want.box_h, got.box_h) << std::hex << "U+" << u;
+        EXPECT_EQ(want.ofs_x, got.ofs_x) << std::hex << "U+" << u;
+        EXPECT_EQ(want.ofs_y, got.ofs_y) << std::hex << "U+" << u;
+        EXPECT_EQ(want.format, got.format) << std::hex << "U+" << u;
+        ASSERT_EQ(0, memcmp(want_bitmap, got_bitmap, sizeof(want_bitmap))) << std::hex << "U+" << u;
+        glyphs++;
+    }
+    EXPECT_GT(glyphs, 1000U);
+
+    UI_ASSET_STAT_T stat;
+    ASSERT_EQ(OPRT_OK, ui_asset_get_stat(&stat));
+    EXPECT_LE(stat.cache_used, stat.cache_capacity);
+    EXPECT_GT(stat.cache_hit, 0U);
+}
+
+TEST_F(UiAsset, FontNotInThePackIsNull)
+{
+    EXPECT_EQ(nullptr, ui_asset_font_get("font_puhui_18_2"));
+    EXPECT_EQ(nullptr, ui_asset_image_get("emoji_1f602_16"));
+}
+
+TEST_F(UiAsset, EmojiFontGivesThePackedImages)
+{
+    const lv_image_dsc_t *want[] = {&emoji_1f602_32, &emoji_1f602_64};
+    uint32_t sizes[] = {32, 64};
+
+    for (int i = 0; i < 2; i++) {
+        lv_font_t *font = ui_asset_emoji_font_get(sizes[i]);
+        int32_t offset_y = 0;
+
+        ASSERT_NE(nullptr, font);
+        EXPECT_EQ(font, ui_asset_emoji_font_get(sizes[i]));
+        Imgfont *f = (Imgfont *)font;
+
+        const lv_image_dsc_t *img =
+            (const lv_image_dsc_t *)f->path_cb(font, 0x1f602, 0, &offset_y, f->user_data);
+        ASSERT_NE(nullptr, img) << sizes[i];
+        EXPECT_EQ(want[i]->header.cf, img->header.cf);
+        EXPECT_EQ(want[i]->header.w, img->header.w);
+        EXPECT_EQ(want[i]->header.h, img->header.h);
+        EXPECT_EQ(want[i]->header.stride, img->header.stride);
+        ASSERT_EQ(want[i]->data_size, img->data_size);
+        EXPECT_EQ(0, memcmp(want[i]->data, img->data, img->data_size));
+        EXPECT_EQ(0U, (uintptr_t)img->data % 4);
+
+        EXPECT_EQ(nullptr, f->path_cb(font, 0x1f600, 0, &offset_y, f->user_data));
+    }
+}
+
+TEST_F(UiAsset, RefreshKeepsWhatItUses)
+{
+    static uint8_t bitmap[GLYPH_MAX * GLYPH_MAX];
+    lv_font_t *font = ui_asset_font_get("font_puhui_14_1");
+    lv_font_glyph_dsc_t dsc;
+    uint32_t u = 0x4E00, failed = 0;
+
+    ASSERT_NE(nullptr, font);
+
+    // the emoji is drawn first, then more glyphs than fit next to it
+    __refresh_event(LV_EVENT_REFR_START);
+    const lv_image_dsc_t *img = ui_asset_image_get("emoji_1f602_64");
+    ASSERT_NE(nullptr, img);
+    std::vector<uint8_t> data(img->data, img->data + img->data_size);
+    sg_dropped.clear();
+
+    for (; u < 0x9FA5 && 0 == failed; u++) {
+        if (__glyph_get(&font_puhui_14_1, u, &dsc, bitmap) && !__glyph_get(font, u, &dsc, bitmap)) {
+            failed = u;
+        }
+    }
+    EXPECT_NE(0U, failed) << "the cache never filled up";
+    EXPECT_EQ(0, std::count(sg_dropped.begin(), sg_dropped.end(), (const void *)img));
+    EXPECT_EQ(0, memcmp(data.data(), img->data, data.size()));
+
+    // once the refresh is over the glyph fits again, the emoji makes room
+    __refresh_event(LV_EVENT_REFR_READY);
+    EXPECT_TRUE(__glyph_get(font, failed, &dsc, bitmap));
+    for (; u < 0x9FA5 && 0 == std::count(sg_dropped.begin(), sg_dropped.end(), (const void *)img); u++) {
+        __glyph_get(font, u, &dsc, bitmap);
+    }
+    EXPECT_EQ(1, std::count(sg_dropped.begin(), sg_dropped.end(), (const void *)img));
+}
+
+TEST(UiAssetCache, PassPinsItsItems)
+{
+    // a cache of its own would need a second init, the one of the pack is used
+    UI_ASSET_STAT_T stat;
+
+    ASSERT_EQ(OPRT_OK, ui_asset_init(UT_ASSET_PACK, 0, CACHE_SIZE));
+    ASSERT_EQ(OPRT_OK, ui_asset_get_stat(&stat));
+
+    ui_asset_cache_pass_begin();
+    uint32_t key = 0x7FFF0000, num = 0;
+    while (num <= CACHE_SIZE / 1024 && ui_asset_cache_alloc(key + num, 1024)) {
+        num++;
+    }
+    ASSERT_GT(num, 0U);
+    ASSERT_LT(num, CACHE_SIZE / 1024) << "the items of the pass were evicted";
+    EXPECT_NE(nullptr, ui_asset_cache_get(key));
+    ui_asset_cache_pass_end();
+
+    // out of the pass the oldest ones go first
+    EXPECT_NE(nullptr, ui_asset_cache_alloc(key + num, 1024));
+    EXPECT_NE(nullptr, ui_asset_cache_get(key));
+    EXPECT_EQ(nullptr, ui_asset_cache_get(key + 1));
+
+    for (uint32_t i = 0; i <= num; i++) {
+        ui_asset_cache_remove(key + i);
+    }
+}
@@ -0,0 +1,398 @@
+/**
+ * @file json_cursor.c
+ * @brief Lazy, allocation-free reader of JSON text.
+ *
+ * Every lookup scans the text of one container. A value that is skipped is
+ * only checked as far as needed to find its end: strings and escapes are
+ * followed so that brackets inside them are not counted, the content of a
+ * nested container is not checked until it is looked into.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <string.h>
+#include "json_cursor.h"
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static const char *__skip_ws(const char *p, const char *end)
+{
+    while (p < end && (' ' == *p || '\t' == *p || '\r' == *p || '\n' == *p)) {
+        p++;
+    }
+
+    return p;
+}
+
+// p at the opening quote, returns the byte after the closing one
+static const char *__string_end(const char *p, const char *end)
+{
+    for (p++; p < end; p++) {
+        if ('\\' == *p) {
+            p++;
+        } else if ('"' == *p) {
+            return p + 1;
+        }
+    }
+
+    return NULL;
+}
+
+// p at the opening bracket, returns the byte after the closing one
+static const char *__container_end(const char *p, const char *end)
+{
+    uint32_t depth = 0;
+
+    while (p < end) {
+        switch (*p) {
+        case '"':
+            p = __string_end(p, end);
+            if (NULL == p) {
+                return NULL;
+            }
+            continue;
+        case '{':
+        case '[':
+            depth++;
+            break;
+        case '}':
+        case ']':
+            if (0 == --depth) {
+                return p + 1;
+            }
+            break;
+        default:
+            break;
+        }
+        p++;
+    }
+
+    return NULL;
+}
+
+static const char *__literal_end(const char *p, const char *end, const char *literal)
+{
+    size_t len = strlen(literal);
+
+    if ((size_t)(end - p) < len || 0 != memcmp(p, literal, len)) {
+        return NULL;
+    }
+
+    return p + len;
+}
+
+// p at the first byte of a value, fills the cursor and returns the byte after it
+static const char *__value_scan(const char *p, const char *end, json_cursor_t *value)
+{
+    const char *next = NULL;
+
+    if (p >= end) {
+        return NULL;
+    }
+
+    switch (*p) {
+    case '{':
+        value->type = JSON_CURSOR_OBJECT;
+        next = __container_end(p, end);
+        break;
+    case '[':
+        value->type = JSON_CURSOR_ARRAY;
+        next = __container_end(p, end);
+        break;
+    case '"':
+        value->type = JSON_CURSOR_STRING;
+        next = __string_end(p, end);
+        break;
+    case 't':
+        value->type = JSON_CURSOR_TRUE;
+        next = __literal_end(p, end, "true");
+        break;
+    case 'f':
+        value->type = JSON_CURSOR_FALSE;
+        next = __literal_end(p, end, "false");
+        break;
+    case 'n':
+        value->type = JSON_CURSOR_NULL;
+        next = __literal_end(p, end, "null");
+        break;
+    default:
+        if ('-' != *p && (*p < '0' || *p > '9')) {
+            return NULL;
+        }
+        value->type = JSON_CURSOR_NUMBER;
+        for (next = p + 1; next < end && '\0' != *next && NULL != strchr("0123456789+-.eE", *next); next++) {
+        }
+        break;
+    }
+
+    if (NULL == next) {
+        value->type = JSON_CURSOR_NONE;
+        return NULL;
+    }
+    value->json = p;
+    value->len = next - p;
+
+    return next;
+}
+
+int json_cursor_init(json_cursor_t *cursor, const char *json, size_t len)
+{
+    if (NULL == cursor || NULL == json) {
+        return -1;
+    }
+
+    memset(cursor, 0, sizeof(json_cursor_t));
+    if (NULL == __value_scan(__skip_ws(json, json + len), json + len, cursor)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+// visits the members of an object, or the elements of an array with key NULL,
+// until visit returns true
+static int __container_walk(const json_cursor_t *container, bool (*visit)(const char *key, size_t key_len,
+                                                                          const json_cursor_t *value, void *arg),
+                            void *arg)
+{
+    const char *p = container->json + 1;
+    const char *end = container->json + container->len - 1; // the closing bracket
+    const char *key = NULL;
+    size_t key_len = 0;
+    json_cursor_t value = {0};
+
+    p = __skip_ws(p, end);
+    while (p < end) {
+        if (JSON_CURSOR_OBJECT == container->type) {
+            if ('"' != *p || NULL == (key = p + 1, p = __string_end(p, end))) {
+                return -1;
+            }
+            key_len = p - 1 - key;
+            p = __skip_ws(p, end);
+            if (p >= end || ':' != *p) {
+                return -1;
+            }
+            p = __skip_ws(p + 1, end);
+        }
+
+        p = __value_scan(p, end, &value);
+        if (NULL == p) {
+            return -1;
+        }
+        if (visit(key, key_len, &value, arg)) {
+            return 0;
+        }
+
+        p = __skip_ws(p, end);
+        if (p < end) {
+            if (',' != *p) {
+                return -1;
+            }
+            p = __skip_ws(p + 1, end);
+        }
+    }
+
+    return -1;
+}
+
+typedef struct {
+    const char *key;
+    uint32_t index;
+    json_cursor_t *value;
+} json_cursor_lookup_t;
+
+static bool __member_visit(const char *key, size_t key_len, const json_cursor_t *value, void *arg)
+{
+    json_cursor_lookup_t *lookup = (json_cursor_lookup_t *)arg;
+
+    if (key_len != strlen(lookup->key) || 0 != memcmp(key, lookup->key, key_len)) {
+        return false;
+    }
+    *lookup->value = *value;
+
+    return true;
+}
+
+static bool __element_visit(const char *key, size_t key_len, const json_cursor_t *value, void *arg)
+{
+    json_cursor_lookup_t *lookup = (json_cursor_lookup_t *)arg;
+
+    if (lookup->index--) {
+        return false;
+    }
+    *lookup->value = *value;
+
+    return true;
+}
+
+int json_cursor_get(const json_cursor_t *object, const char *key, json_cursor_t *value)
+{
+    json_cursor_lookup_t lookup = {.key = key, .value = value};
+
+    if (NULL == object || NULL == key || NULL == value || JSON_CURSOR_OBJECT != object->type) {
+        return -1;
+    }
+
+    return __container_walk(object, __member_visit, &lookup);
+}
+
+int json_cursor_index(const json_cursor_t *array, uint32_t index, json_cursor_t *value)
+{
+    json_cursor_lookup_t lookup = {.index = index, .value = value};
+
+    if (NULL == array || NULL == value || JSON_CURSOR_ARRAY != array->type) {
+        return -1;
+    }
+
+    return __container_walk(array, __element_visit, &lookup);
+}
+
+int json_cursor_int(const json_cursor_t *value, int32_t *num)
+{
+    const char *p = NULL, *end = NULL;
+    int64_t acc = 0;
+    bool negative = false;
+
+    if (NULL == value || NULL == num || JSON_CURSOR_NUMBER != value->type) {
+        return -1;
+    }
+
+    p = value->json;
+    end = p + value->len;
+    if ('-' == *p) {
+        negative = true;
+        p++;
+    }
+    // saturates like cJSON does for valueint
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        if (acc <= INT32_MAX) {
+            acc = acc * 10 + (*p - '0');
+        }
+    }
+    acc = negative ? -acc : acc;
+    *num = acc > INT32_MAX ? INT32_MAX : (acc < INT32_MIN ? INT32_MIN : (int32_t)acc);
+
+    return 0;
+}
+
+bool json_cursor_is_true(const json_cursor_t *value)
+{
+    return NULL != value && JSON_CURSOR_TRUE == value->type;
+}
+
+static char __ascii_lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+bool json_cursor_string_equal(const json_cursor_t *value, const char *str, bool ignore_case)
+{
+    size_t len = 0, i;
+
+    if (NULL == value || NULL == str || JSON_CURSOR_STRING != value->type) {
+        return false;
+    }
+
+    len = value->len - 2;
+    if (len != strlen(str)) {
+        return false;
+    }
+    for (i = 0; i < len; i++) {
+        if (ignore_case ? __ascii_lower(value->json[1 + i]) != __ascii_lower(str[i]) : value->json[1 + i] != str[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static int __hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = __ascii_lower(c);
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+
+    return -1;
+}
+
+int json_cursor_string_copy(const json_cursor_t *value, char *buf, size_t size)
+{
+    const char *p = NULL, *end = NULL;
+    uint32_t code, i;
+    size_t len = 0;
+    int digit;
+
+    if (NULL == value || NULL == buf || 0 == size || JSON_CURSOR_STRING != value->type) {
+        return -1;
+    }
+
+    p = value->json + 1;
+    end = value->json + value->len - 1;
+    while (p < end) {
+        // one byte is kept for the NUL
+        if (len + 1 >= size) {
+            return -1;
+        }
+
+        if ('\\' != *p) {
+            buf[len++] = *p++;
+            continue;
+        }
+
+        p++;
+        switch (*p++) {
+        case 'b':
+            buf[len++] = '\b';
+            break;
+        case 'f':
+            buf[len++] = '\f';
+            break;
+        case 'n':
+            buf[len++] = '\n';
+            break;
+        case 'r':
+            buf[len++] = '\r';
+            break;
+        case 't':
+            buf[len++] = '\t';
+            break;
+        case 'u':
+            if (end - p < 4) {
+                return -1;
+            }
+            for (code = 0, i = 0; i < 4; i++) {
+                digit = __hex_value(*p++);
+                if (digit < 0) {
+                    return -1;
+                }
+                code = (code << 4) | digit;
+            }
+            if (code < 0x80) {
+                buf[len++] = (char)code;
+            } else if (len + 3 >= size) {
+                return -1;
+            } else if (code < 0x800) {
+                buf[len++] = (char)(0xC0 | (code >> 6));
+                buf[len++] = (char)(0x80 | (code & 0x3F));
+            } else {
+                buf[len++] = (char)(0xE0 | (code >> 12));
+                buf[len++] = (char)(0x80 | ((code >> 6) & 0x3F));
+                buf[len++] = (char)(0x80 | (code & 0x3F));
+            }
+            break;
+        default:
+            // \" \\ \/
+            buf[len++] = p[-1];
+            break;
+        }
+    }
+    buf[len] = '\0';
+
+    return (int)len;
+}
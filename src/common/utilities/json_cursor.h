@@ -0,0 +1,130 @@
+/**
+ * @file json_cursor.h
+ * @brief Lazy, allocation-free reader of JSON text.
+ *
+ * A cursor is a view of one JSON value inside a text buffer. Nothing is parsed
+ * up front: looking up a member or an element scans the text of its container
+ * at that time, skipping the values in between without decoding them. The
+ * buffer must outlive every cursor into it, and nothing is allocated, so a
+ * response can be read where it was received instead of being copied into a
+ * tree of objects.
+ *
+ * Keys are compared with the raw text between the quotes, a key written with
+ * escapes does not match. Strings are unescaped by json_cursor_string_copy.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+#ifndef __JSON_CURSOR_H__
+#define __JSON_CURSOR_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    JSON_CURSOR_NONE = 0,
+    JSON_CURSOR_OBJECT,
+    JSON_CURSOR_ARRAY,
+    JSON_CURSOR_STRING,
+    JSON_CURSOR_NUMBER,
+    JSON_CURSOR_TRUE,
+    JSON_CURSOR_FALSE,
+    JSON_CURSOR_NULL,
+} JSON_CURSOR_TYPE_E;
+
+typedef struct {
+    JSON_CURSOR_TYPE_E type;
+    const char *json; // text of the value, a string with its quotes
+    size_t len;
+} json_cursor_t;
+
+/**
+ * @brief Points a cursor at the value a JSON text holds.
+ *
+ * Only the extent of the value is checked, its members are checked when they
+ * are looked up.
+ *
+ * @param[out] cursor: the value
+ * @param[in] json: the text, not necessarily NUL terminated
+ * @param[in] len: length of the text
+ *
+ * @return 0 on success, -1 if the text is not a JSON value
+ */
+int json_cursor_init(json_cursor_t *cursor, const char *json, size_t len);
+
+/**
+ * @brief Looks up a member of an object.
+ *
+ * @param[in] object: cursor of the object
+ * @param[in] key: name of the member
+ * @param[out] value: the value of the member
+ *
+ * @return 0 on success, -1 if the object has no such member or is malformed
+ */
+int json_cursor_get(const json_cursor_t *object, const char *key, json_cursor_t *value);
+
+/**
+ * @brief Looks up an element of an array.
+ *
+ * @param[in] array: cursor of the array
+ * @param[in] index: position of the element
+ * @param[out] value: the element
+ *
+ * @return 0 on success, -1 if the array is shorter or malformed
+ */
+int json_cursor_index(const json_cursor_t *array, uint32_t index, json_cursor_t *value);
+
+/**
+ * @brief Reads a number as an integer, the fraction is dropped.
+ *
+ * @param[in] value: cursor of the number
+ * @param[out] num: the integer
+ *
+ * @return 0 on success, -1 if the value is not a number
+ */
+int json_cursor_int(const json_cursor_t *value, int32_t *num);
+
+/**
+ * @brief Tells whether a value is the literal true.
+ *
+ * @param[in] value: cursor of the value, may be of any type
+ *
+ * @return true only for the literal true
+ */
+bool json_cursor_is_true(const json_cursor_t *value);
+
+/**
+ * @brief Compares a string value with a C string, without unescaping.
+ *
+ * @param[in] value: cursor of the string
+ * @param[in] str: the C string
+ * @param[in] ignore_case: compare ASCII letters case insensitively
+ *
+ * @return true if the value is a string equal to str
+ */
+bool json_cursor_string_equal(const json_cursor_t *value, const char *str, bool ignore_case);
+
+/**
+ * @brief Copies a string value unescaped and NUL terminated.
+ *
+ * \uXXXX escapes are written as UTF-8, surrogate pairs are not combined.
+ *
+ * @param[in] value: cursor of the string
+ * @param[out] buf: the copy
+ * @param[in] size: size of buf
+ *
+ * @return length of the copy, -1 if the value is not a string or buf is too
+ * small
+ */
+int json_cursor_string_copy(const json_cursor_t *value, char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSON_CURSOR_H__ */
@@ -46,6 +46,6 @@
  */
 #define HTTP_USER_AGENT_VALUE    "TUYA_IOT_SDK"
 
-#include "tal_api.h"
+#include "tal_memory.h"
 
 #endif /* ifndef CORE_HTTP_CONFIG_DEFAULTS_ */
@@ -2726,7 +2726,8 @@ HTTPStatus_t HTTPClient_Request( const TransportInterface_t * pTransport,
                 LogError( ( "Failed to receive HTTP data: Transport recv() "
                             "returned error: TransportStatus=%ld",
                             ( long int ) currentReceived ) );
-                return HTTPNetworkError;
+                returnStatus = HTTPNetworkError;
+                goto __exit;
             }
             totalReceived += currentReceived;
             pResponse->pBuffer[totalReceived] = 0;
@@ -2812,7 +2813,8 @@ HTTPStatus_t HTTPClient_Request( const TransportInterface_t * pTransport,
                 LogError( ( "Failed to receive HTTP data: Transport recv() "
                             "returned error: TransportStatus=%ld",
                             ( long int ) currentReceived ) );
-                return HTTPNetworkError;
+                returnStatus = HTTPNetworkError;
+                goto __exit;
             }
             chunkLen = currentReceived;
             parsingContext.recvState = HTTP_PARSE_CHUNK;
@@ -2844,7 +2846,8 @@ HTTPStatus_t HTTPClient_Request( const TransportInterface_t * pTransport,
                 LogError( ( "Failed to receive HTTP data: Transport recv() "
                             "returned error: TransportStatus=%ld",
                             ( long int ) currentReceived ) );
-                return HTTPNetworkError;
+                returnStatus = HTTPNetworkError;
+                goto __exit;
             }
             bodyLen += currentReceived;
             if (pResponse->contentLength == bodyLen) {
@@ -0,0 +1,85 @@
+/**
+ * @file http_client_pool.h
+ * @brief Keep-alive connections of http_client_request.
+ *
+ * A connection whose response allowed keep-alive is parked in the pool
+ * instead of being closed, the next request to the same host, port and CA
+ * takes it back and skips the DNS lookup, the TCP connect and the TLS
+ * handshake. Parked connections are closed once idle for
+ * HTTP_POOL_IDLE_TIMEOUT_MS.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __HTTP_CLIENT_POOL_H__
+#define __HTTP_CLIENT_POOL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "tuya_cloud_types.h"
+#include "tuya_transporter.h"
+
+#ifndef HTTP_POOL_SIZE
+#define HTTP_POOL_SIZE 2
+#endif
+
+#ifndef HTTP_POOL_IDLE_TIMEOUT_MS
+#define HTTP_POOL_IDLE_TIMEOUT_MS 20000
+#endif
+
+/* a connection parked for less is taken without the health check, a server
+ * closing that soon announces it with Connection: close and the retry of
+ * http_client_request covers the others */
+#ifndef HTTP_POOL_CHECK_IDLE_MS
+#define HTTP_POOL_CHECK_IDLE_MS 1000
+#endif
+
+typedef struct {
+    const char *host;
+    uint16_t port;
+    const uint8_t *cacert; // NULL for plain TCP, compared by address
+    size_t cacert_len;
+} http_client_pool_key_t;
+
+/**
+ * @brief Takes a parked connection to a host out of the pool.
+ *
+ * Connections idle for too long and connections the server has closed or
+ * written to in the meantime are closed on the way.
+ *
+ * @param[in] key: host, port and CA of the request
+ *
+ * @return the connection, NULL if none is parked
+ */
+tuya_transporter_t http_client_pool_checkout(const http_client_pool_key_t *key);
+
+/**
+ * @brief Parks a connection in the pool, or closes and destroys it.
+ *
+ * When the pool is full the connection idle for the longest time is closed
+ * to make room.
+ *
+ * @param[in] key: host, port and CA the connection was opened for
+ * @param[in] transporter: the connection, owned by the pool from now on
+ * @param[in] reusable: FALSE when the response or an error ended the
+ * connection, it is then closed at once
+ *
+ * @return none
+ */
+void http_client_pool_checkin(const http_client_pool_key_t *key, tuya_transporter_t transporter, BOOL_T reusable);
+
+/**
+ * @brief Closes every parked connection, e.g. when the network goes down.
+ *
+ * @return none
+ */
+void http_client_pool_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HTTP_CLIENT_POOL_H__ */
@@ -0,0 +1,309 @@
+/**
+ * @file http_client_pool.c
+ * @brief Keep-alive connections of http_client_request.
+ *
+ * The pool only holds idle connections, a connection that is checked out
+ * belongs to its request until it is checked in again. Slots are looked up
+ * and replaced under a mutex, connections are always closed and polled for
+ * their health without the lock held since a TLS close may write to the
+ * network and a poll may wait for it. A one shot timer is armed
+ * for the oldest parked connection and closes the expired ones. Any change of
+ * the link status flushes the pool, sockets of a lost link would only time
+ * out.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+#include "tuya_iot_config.h"
+#include "tal_log.h"
+#include "tal_mutex.h"
+#include "tal_event.h"
+#include "tal_system.h"
+#include "tal_sw_timer.h"
+#include "http_client_pool.h"
+
+#if defined(ENABLE_HTTP_POOL) && (ENABLE_HTTP_POOL == 1)
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define HTTP_POOL_HOST_LEN 64
+/* tal_net_select waits forever on 0, the health check polls for 1 ms */
+#define HTTP_POOL_CHECK_MS 1
+
+/* sg_pool_init states */
+#define HTTP_POOL_INIT_NONE  0
+#define HTTP_POOL_INIT_BUSY  1
+#define HTTP_POOL_INIT_READY 2
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    tuya_transporter_t transporter; // NULL while the slot is free
+    char host[HTTP_POOL_HOST_LEN];
+    uint16_t port;
+    const uint8_t *cacert;
+    size_t cacert_len;
+    SYS_TIME_T idle_since;
+} http_pool_conn_t;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static uint8_t sg_pool_init = HTTP_POOL_INIT_NONE;
+static MUTEX_HANDLE sg_pool_mutex = NULL;
+static TIMER_ID sg_pool_timer = NULL;
+static http_pool_conn_t sg_pool[HTTP_POOL_SIZE];
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static void __pool_conn_close(tuya_transporter_t transporter)
+{
+    tuya_transporter_close(transporter);
+    tuya_transporter_destroy(transporter);
+}
+
+static BOOL_T __pool_key_match(const http_pool_conn_t *conn, const http_client_pool_key_t *key)
+{
+    return conn->port == key->port && conn->cacert == key->cacert && conn->cacert_len == key->cacert_len &&
+           0 == strcmp(conn->host, key->host);
+}
+
+static BOOL_T __pool_conn_expired(const http_pool_conn_t *conn, SYS_TIME_T now)
+{
+    return now - conn->idle_since >= HTTP_POOL_IDLE_TIMEOUT_MS;
+}
+
+// re-arms the timer for the oldest parked connection, stops it if none is left
+static void __pool_timer_arm(SYS_TIME_T now)
+{
+    SYS_TIME_T oldest = 0;
+    uint32_t i;
+
+    for (i = 0; i < HTTP_POOL_SIZE; i++) {
+        if (sg_pool[i].transporter && (0 == oldest || sg_pool[i].idle_since < oldest)) {
+            oldest = sg_pool[i].idle_since;
+        }
+    }
+
+    if (0 == oldest) {
+        tal_sw_timer_stop(sg_pool_timer);
+        return;
+    }
+
+    // the timer fires late rather than early, so an expired one is closed then
+    tal_sw_timer_start(sg_pool_timer, oldest + HTTP_POOL_IDLE_TIMEOUT_MS - now + 1, TAL_TIMER_ONCE);
+}
+
+static void __pool_timer_cb(TIMER_ID timer_id, void *arg)
+{
+    tuya_transporter_t expired[HTTP_POOL_SIZE];
+    uint32_t num = 0, i;
+    SYS_TIME_T now = tal_system_get_millisecond();
+
+    tal_mutex_lock(sg_pool_mutex);
+    for (i = 0; i < HTTP_POOL_SIZE; i++) {
+        if (sg_pool[i].transporter && __pool_conn_expired(&sg_pool[i], now)) {
+            expired[num++] = sg_pool[i].transporter;
+            sg_pool[i].transporter = NULL;
+        }
+    }
+    __pool_timer_arm(now);
+    tal_mutex_unlock(sg_pool_mutex);
+
+    for (i = 0; i < num; i++) {
+        PR_DEBUG("http pool close idle connection %p", expired[i]);
+        __pool_conn_close(expired[i]);
+    }
+}
+
+static int __pool_link_status_cb(void *data)
+{
+    http_client_pool_flush();
+
+    return OPRT_OK;
+}
+
+static BOOL_T __pool_ready(void)
+{
+    return (HTTP_POOL_INIT_READY == __atomic_load_n(&sg_pool_init, __ATOMIC_ACQUIRE)) ? TRUE : FALSE;
+}
+
+static OPERATE_RET __pool_init(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint8_t state = HTTP_POOL_INIT_NONE;
+
+    if (__pool_ready()) {
+        return OPRT_OK;
+    }
+
+    // requests of several tasks may check in their first connections at once
+    if (!__atomic_compare_exchange_n(&sg_pool_init, &state, HTTP_POOL_INIT_BUSY, FALSE, __ATOMIC_ACQUIRE,
+                                     __ATOMIC_ACQUIRE)) {
+        while (HTTP_POOL_INIT_BUSY == (state = __atomic_load_n(&sg_pool_init, __ATOMIC_ACQUIRE))) {
+            tal_system_sleep(1);
+        }
+        return (HTTP_POOL_INIT_READY == state) ? OPRT_OK : OPRT_COM_ERROR;
+    }
+
+    TUYA_CALL_ERR_GOTO(tal_sw_timer_create(__pool_timer_cb, NULL, &sg_pool_timer), __ERR);
+    TUYA_CALL_ERR_GOTO(tal_mutex_create_init(&sg_pool_mutex), __ERR);
+    tal_event_subscribe(EVENT_LINK_STATUS_CHG, "http_pool", __pool_link_status_cb, SUBSCRIBE_TYPE_NORMAL);
+
+    __atomic_store_n(&sg_pool_init, HTTP_POOL_INIT_READY, __ATOMIC_RELEASE);
+
+    return OPRT_OK;
+
+__ERR:
+    if (sg_pool_timer) {
+        tal_sw_timer_delete(sg_pool_timer);
+        sg_pool_timer = NULL;
+    }
+    __atomic_store_n(&sg_pool_init, HTTP_POOL_INIT_NONE, __ATOMIC_RELEASE);
+    return rt;
+}
+
+tuya_transporter_t http_client_pool_checkout(const http_client_pool_key_t *key)
+{
+    tuya_transporter_t transporter = NULL;
+    tuya_transporter_t stale[HTTP_POOL_SIZE];
+    uint32_t num = 0, i;
+    BOOL_T check = FALSE;
+    SYS_TIME_T now;
+
+    if (NULL == key || NULL == key->host || !__pool_ready()) {
+        return NULL;
+    }
+
+    // every pass takes one connection out of the pool, so it ends once the pool has none left
+    for (;;) {
+        num = 0;
+        transporter = NULL;
+        tal_mutex_lock(sg_pool_mutex);
+        now = tal_system_get_millisecond();
+        for (i = 0; i < HTTP_POOL_SIZE; i++) {
+            if (NULL == sg_pool[i].transporter || !__pool_key_match(&sg_pool[i], key)) {
+                continue;
+            }
+
+            if (__pool_conn_expired(&sg_pool[i], now)) {
+                stale[num++] = sg_pool[i].transporter;
+                sg_pool[i].transporter = NULL;
+                continue;
+            }
+
+            transporter = sg_pool[i].transporter;
+            check = (now - sg_pool[i].idle_since >= HTTP_POOL_CHECK_IDLE_MS) ? TRUE : FALSE;
+            sg_pool[i].transporter = NULL;
+            break;
+        }
+        if (transporter || num) {
+            __pool_timer_arm(now);
+        }
+        tal_mutex_unlock(sg_pool_mutex);
+
+        for (i = 0; i < num; i++) {
+            PR_DEBUG("http pool close stale connection %p", stale[i]);
+            __pool_conn_close(stale[i]);
+        }
+
+        // checked out already, so polled without the lock: an idle connection has nothing to
+        // read, data or EOF means the server is done with it
+        if (NULL == transporter || !check || 0 == tuya_transporter_poll_read(transporter, HTTP_POOL_CHECK_MS)) {
+            return transporter;
+        }
+        PR_DEBUG("http pool close stale connection %p", transporter);
+        __pool_conn_close(transporter);
+    }
+}
+
+void http_client_pool_checkin(const http_client_pool_key_t *key, tuya_transporter_t transporter, BOOL_T reusable)
+{
+    tuya_transporter_t evicted = NULL;
+    http_pool_conn_t *slot = NULL;
+    uint32_t i;
+
+    if (NULL == transporter) {
+        return;
+    }
+
+    if (!reusable || NULL == key || NULL == key->host || strlen(key->host) >= HTTP_POOL_HOST_LEN ||
+        OPRT_OK != __pool_init()) {
+        __pool_conn_close(transporter);
+        return;
+    }
+
+    tal_mutex_lock(sg_pool_mutex);
+    // a free slot, or else the one idle for the longest time
+    for (i = 0; i < HTTP_POOL_SIZE; i++) {
+        if (NULL == sg_pool[i].transporter) {
+            slot = &sg_pool[i];
+            break;
+        }
+        if (NULL == slot || sg_pool[i].idle_since < slot->idle_since) {
+            slot = &sg_pool[i];
+        }
+    }
+    evicted = slot->transporter;
+
+    slot->transporter = transporter;
+    strcpy(slot->host, key->host);
+    slot->port = key->port;
+    slot->cacert = key->cacert;
+    slot->cacert_len = key->cacert_len;
+    slot->idle_since = tal_system_get_millisecond();
+    __pool_timer_arm(slot->idle_since);
+    tal_mutex_unlock(sg_pool_mutex);
+
+    if (evicted) {
+        PR_DEBUG("http pool full, close connection %p", evicted);
+        __pool_conn_close(evicted);
+    }
+}
+
+void http_client_pool_flush(void)
+{
+    tuya_transporter_t parked[HTTP_POOL_SIZE];
+    uint32_t num = 0, i;
+
+    if (!__pool_ready()) {
+        return;
+    }
+
+    tal_mutex_lock(sg_pool_mutex);
+    for (i = 0; i < HTTP_POOL_SIZE; i++) {
+        if (sg_pool[i].transporter) {
+            parked[num++] = sg_pool[i].transporter;
+            sg_pool[i].transporter = NULL;
+        }
+    }
+    tal_sw_timer_stop(sg_pool_timer);
+    tal_mutex_unlock(sg_pool_mutex);
+
+    for (i = 0; i < num; i++) {
+        __pool_conn_close(parked[i]);
+    }
+}
+
+#else
+
+tuya_transporter_t http_client_pool_checkout(const http_client_pool_key_t *key)
+{
+    return NULL;
+}
+
+void http_client_pool_checkin(const http_client_pool_key_t *key, tuya_transporter_t transporter, BOOL_T reusable)
+{
+    if (transporter) {
+        tuya_transporter_close(transporter);
+        tuya_transporter_destroy(transporter);
+    }
+}
+
+void http_client_pool_flush(void)
+{
+}
+
+#endif
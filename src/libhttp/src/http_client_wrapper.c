@@ -2,6 +2,7 @@
 #include "http_client_interface.h"
 #include "transport_interface.h"
 #include "core_http_client.h"
+#include "http_client_pool.h"
 #include "tuya_tls.h"
 #include "tal_log.h"
 
@@ -74,16 +75,32 @@ static http_client_status_t core_http_request_send(const TransportInterface_t *p
     return HTTP_CLIENT_SUCCESS;
 }
 
-http_client_status_t http_client_request(const http_client_request_t *request, http_client_response_t *response)
+// counts what a request received, to tell a stale connection from a failed request
+typedef struct {
+    NetworkContext_t network; // first, the transport functions take it for the context
+    size_t received;
+} http_client_context_t;
+
+static int32_t http_client_transport_recv(NetworkContext_t *pNetwork, void *pBuffer, size_t bytesToRecv)
+{
+    http_client_context_t *context = (http_client_context_t *)pNetwork;
+    int32_t ret = NetworkTransportRecv(pNetwork, pBuffer, bytesToRecv);
+
+    if (ret > 0) {
+        context->received += ret;
+    }
+
+    return ret;
+}
+
+static http_client_status_t http_client_connect(const http_client_request_t *request, NetworkContext_t *network)
 {
-    http_client_status_t rt = HTTP_CLIENT_SUCCESS;
     int ret = OPRT_OK;
 
     /* TLS pre init */
-    NetworkContext_t network;
     TUYA_TRANSPORT_TYPE_E transport_type = (request->cacert == NULL) ? TRANSPORT_TYPE_TCP : TRANSPORT_TYPE_TLS;
-    network = tuya_transporter_create(transport_type, NULL);
-    if (NULL == network) {
+    *network = tuya_transporter_create(transport_type, NULL);
+    if (NULL == *network) {
         return HTTP_CLIENT_MALLOC_FAULT;
     }
 
@@ -98,32 +115,50 @@ http_client_status_t http_client_request(const http_client_request_t *request, h
             .verify = true,
         };
 
-        ret = tuya_transporter_ctrl(network, TUYA_TRANSPORTER_SET_TLS_CONFIG, &tls_config);
+        ret = tuya_transporter_ctrl(*network, TUYA_TRANSPORTER_SET_TLS_CONFIG, &tls_config);
         if (OPRT_OK != ret) {
             log_error("network_tls_init fail:%d", ret);
+            tuya_transporter_destroy(*network);
             return ret;
         }
 
-        ret = tuya_transporter_connect(network, tls_config.hostname, tls_config.port, tls_config.timeout);
+        ret = tuya_transporter_connect(*network, tls_config.hostname, tls_config.port, tls_config.timeout);
         if (OPRT_OK != ret) {
-            tuya_transporter_close(network);
-            tuya_transporter_destroy(network);
+            tuya_transporter_close(*network);
+            tuya_transporter_destroy(*network);
             return HTTP_CLIENT_SEND_FAULT;
         }
 
         log_debug("tls connencted!");
     } else {
-        ret = tuya_transporter_connect(network, request->host, (request->port == 0) ? DEFAULT_HTTP_PORT : request->port,
+        ret = tuya_transporter_connect(*network, request->host, (request->port == 0) ? DEFAULT_HTTP_PORT : request->port,
                                        request->timeout_ms);
         if (OPRT_OK != ret) {
-            tuya_transporter_close(network);
-            tuya_transporter_destroy(network);
+            tuya_transporter_close(*network);
+            tuya_transporter_destroy(*network);
             return HTTP_CLIENT_SEND_FAULT;
         }
     }
+
+    return HTTP_CLIENT_SUCCESS;
+}
+
+http_client_status_t http_client_request(const http_client_request_t *request, http_client_response_t *response)
+{
+    http_client_status_t rt = HTTP_CLIENT_SUCCESS;
+    http_client_context_t context = {0};
+    BOOL_T reused = FALSE;
+
+    http_client_pool_key_t key = {
+        .host = request->host,
+        .port = request->port,
+        .cacert = request->cacert,
+        .cacert_len = request->cacert_len,
+    };
+
     /* http client TransportInterface */
-    TransportInterface_t pTransportInterface = {.pNetworkContext = (NetworkContext_t *)&network,
-                                                .recv = (TransportRecv_t)NetworkTransportRecv,
+    TransportInterface_t pTransportInterface = {.pNetworkContext = &context.network,
+                                                .recv = (TransportRecv_t)http_client_transport_recv,
                                                 .send = (TransportSend_t)NetworkTransportSend};
 
     /* http client request object make */
@@ -134,19 +169,45 @@ http_client_status_t http_client_request(const http_client_request_t *request, h
         .hostLen = strlen(request->host),
         .pPath = request->path,
         .pathLen = strlen(request->path),
+#if defined(ENABLE_HTTP_POOL) && (ENABLE_HTTP_POOL == 1)
+        .reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG,
+#endif
     };
 
     HTTPResponse_t http_response = {0};
 
-    /* HTTP request send */
-    log_debug("http request send!");
-    rt = core_http_request_send((const TransportInterface_t *)&pTransportInterface,
-                                (const HTTPRequestInfo_t *)&requestInfo, request->headers, request->headers_count,
-                                (const uint8_t *)request->body, request->body_length, &http_response);
+    context.network = http_client_pool_checkout(&key);
+    reused = (NULL != context.network);
+
+    for (;;) {
+        if (NULL == context.network) {
+            rt = http_client_connect(request, &context.network);
+            if (HTTP_CLIENT_SUCCESS != rt) {
+                return rt;
+            }
+        }
+
+        /* HTTP request send */
+        log_debug("http request send, %s connection!", reused ? "reused" : "new");
+        context.received = 0;
+        rt = core_http_request_send((const TransportInterface_t *)&pTransportInterface,
+                                    (const HTTPRequestInfo_t *)&requestInfo, request->headers, request->headers_count,
+                                    (const uint8_t *)request->body, request->body_length, &http_response);
+
+        /* a parked connection the server closed fails before any of the response, retry once on a new one */
+        if (HTTP_CLIENT_SEND_FAULT == rt && reused && 0 == context.received) {
+            log_debug("reused connection is stale, retry on a new one");
+            http_client_pool_checkin(&key, context.network, FALSE);
+            context.network = NULL;
+            reused = FALSE;
+            continue;
+        }
+        break;
+    }
 
-    /* tls disconnect */
-    tuya_transporter_close(network);
-    tuya_transporter_destroy(network);
+    http_client_pool_checkin(&key, context.network,
+                             HTTP_CLIENT_SUCCESS == rt &&
+                                 !(http_response.respFlags & HTTP_RESPONSE_CONNECTION_CLOSE_FLAG));
 
     if (OPRT_OK != rt) {
         log_error("http_request_send error:%d", rt);
@@ -874,7 +874,11 @@
 
     /*1: Show CPU usage and FPS count
      * Requires `LV_USE_SYSMON = 1`*/
+    #if defined(LVGL_ENABLE_PERF_MONITOR) && (LVGL_ENABLE_PERF_MONITOR == 1)
+    #define LV_USE_PERF_MONITOR 1
+    #else
     #define LV_USE_PERF_MONITOR 0
+    #endif
     #if LV_USE_PERF_MONITOR
         #define LV_USE_PERF_MONITOR_POS LV_ALIGN_BOTTOM_RIGHT
 
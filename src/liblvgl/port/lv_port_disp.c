@@ -14,15 +14,40 @@
 #include <stdbool.h>
 #include "tal_log.h"
 
+#include "tal_queue.h"
+#include "tal_semaphore.h"
+#include "tal_thread.h"
+
 #include "tuya_lcd_device.h"
 #include "tkl_display.h"
 #include "tkl_memory.h"
 
 #define BYTE_PER_PIXEL (LV_COLOR_FORMAT_GET_SIZE(LV_COLOR_FORMAT_RGB565)) /*will be 2 for RGB565 */
 
+#if defined(LVGL_DISP_RENDER_MODE_DIRECT) && (LVGL_DISP_RENDER_MODE_DIRECT == 1)
+#define DISP_RENDER_MODE LV_DISPLAY_RENDER_MODE_DIRECT
+#define DISP_BUF_DIVISOR 1
+#else
+#define DISP_RENDER_MODE LV_DISPLAY_RENDER_MODE_PARTIAL
+#if defined(LVGL_DISP_BUF_DIVISOR)
+#define DISP_BUF_DIVISOR LVGL_DISP_BUF_DIVISOR
+#else
+#define DISP_BUF_DIVISOR 20
+#endif
+#endif
+
+/*Max dirty areas kept for one frame in direct mode, the rest is merged into the last one*/
+#define DISP_MERGE_AREA_MAX 8
+
 /**********************
  *      TYPEDEFS
  **********************/
+typedef struct {
+    TKL_DISP_FRAMEBUFFER_S fb;
+    bool is_last;
+    uint8_t rect_num;
+    TKL_DISP_RECT_S rect[DISP_MERGE_AREA_MAX];
+} DISP_FLUSH_JOB_T;
 
 /**********************
  *  STATIC PROTOTYPES
@@ -31,6 +56,10 @@ static void disp_init(TKL_DISP_DEVICE_S *device);
 
 static void disp_flush(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map);
 
+static OPERATE_RET disp_flush_task_init(void);
+
+static void disp_flush_wait(lv_display_t *disp);
+
 /**********************
  *  STATIC VARIABLES
  **********************/
@@ -38,6 +67,15 @@ static TKL_DISP_DEVICE_S sg_lcd;
 static TKL_DISP_INFO_S sg_lcd_info;
 static lv_display_t *disp_drv_backup = NULL;
 
+static QUEUE_HANDLE sg_flush_queue = NULL;
+static SEM_HANDLE sg_flush_idle_sem = NULL; /*held from handing a job over until the task is done with it*/
+static THREAD_HANDLE sg_flush_thrd = NULL;
+
+#if DISP_RENDER_MODE == LV_DISPLAY_RENDER_MODE_DIRECT
+static uint8_t sg_dirty_num = 0;
+static TKL_DISP_RECT_S sg_dirty_rect[DISP_MERGE_AREA_MAX];
+#endif
+
 /**********************
  *      MACROS
  **********************/
@@ -57,11 +95,17 @@ void lv_port_disp_init(TKL_DISP_DEVICE_S *device)
      * -----------------------------------*/
     lv_display_t *disp = lv_display_create(sg_lcd_info.width, sg_lcd_info.height);
     lv_display_set_flush_cb(disp, disp_flush);
+    disp_drv_backup = disp;
+
+    /*Blit in a separate task so that LVGL renders the next buffer while the current one is being sent*/
+    if (OPRT_OK == disp_flush_task_init()) {
+        lv_display_set_flush_wait_cb(disp, disp_flush_wait);
+    }
 
-    /* Example 2
-     * Two buffers for partial rendering
-     * In flush_cb DMA or similar hardware should be used to update the display in the background.*/
-    uint32_t buf_len = sg_lcd_info.width * sg_lcd_info.height * BYTE_PER_PIXEL / 20;
+    /* Two buffers: 1/DISP_BUF_DIVISOR of the screen for partial rendering,
+     * or full frames for direct mode (only reasonable with PSRAM).
+     * The flush task sends one buffer to the display while LVGL renders into the other.*/
+    uint32_t buf_len = sg_lcd_info.width * sg_lcd_info.height * BYTE_PER_PIXEL / DISP_BUF_DIVISOR;
 
     LV_ATTRIBUTE_MEM_ALIGN
     static uint8_t *buf_2_1;
@@ -81,7 +125,7 @@ void lv_port_disp_init(TKL_DISP_DEVICE_S *device)
     }
     memset(buf_2_2, 0x00, buf_len);
 
-    lv_display_set_buffers(disp, buf_2_1, buf_2_2, buf_len, LV_DISPLAY_RENDER_MODE_PARTIAL);
+    lv_display_set_buffers(disp, buf_2_1, buf_2_2, buf_len, DISP_RENDER_MODE);
 }
 
 /**********************
@@ -134,33 +178,185 @@ void disp_disable_update(void)
     disp_flush_enabled = false;
 }
 
+static void disp_flush_job_run(DISP_FLUSH_JOB_T *job)
+{
+    uint8_t i;
+
+    for (i = 0; i < job->rect_num; i++) {
+        tkl_disp_blit(&sg_lcd, &job->fb, &job->rect[i]);
+    }
+
+    if (job->is_last) {
+        tkl_disp_flush(&sg_lcd);
+    }
+}
+
+/*With the task running, this is the only place where LVGL is told that a buffer is free again*/
+static void disp_flush_task(void *args)
+{
+    DISP_FLUSH_JOB_T job;
+
+    (void)args;
+
+    for (;;) {
+        tal_queue_fetch(sg_flush_queue, &job, 0xFFFFFFFF);
+
+        disp_flush_job_run(&job);
+
+        lv_disp_flush_ready(disp_drv_backup);
+        tal_semaphore_post(sg_flush_idle_sem);
+    }
+}
+
+static OPERATE_RET disp_flush_task_init(void)
+{
+#if defined(LVGL_DISP_FLUSH_ASYNC) && (LVGL_DISP_FLUSH_ASYNC == 1)
+    OPERATE_RET rt = OPRT_OK;
+
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&sg_flush_idle_sem, 1, 1), __ERR);
+    TUYA_CALL_ERR_GOTO(tal_queue_create_init(&sg_flush_queue, sizeof(DISP_FLUSH_JOB_T), 2), __ERR);
+
+    THREAD_CFG_T cfg = {
+        .thrdname = "lv_flush",
+        .priority = THREAD_PRIO_1,
+        .stackDepth = 1024 * 4,
+    };
+    TUYA_CALL_ERR_GOTO(tal_thread_create_and_start(&sg_flush_thrd, NULL, NULL, disp_flush_task, NULL, &cfg), __ERR);
+
+    return OPRT_OK;
+
+__ERR:
+    PR_ERR("flush task init failed, fall back to synchronous flush");
+    if (sg_flush_queue) {
+        tal_queue_free(sg_flush_queue);
+        sg_flush_queue = NULL;
+    }
+    if (sg_flush_idle_sem) {
+        tal_semaphore_release(sg_flush_idle_sem);
+        sg_flush_idle_sem = NULL;
+    }
+    return rt;
+#else
+    return OPRT_NOT_SUPPORTED;
+#endif
+}
+
+/*Called by LVGL before it reuses a buffer which may still be under transfer*/
+static void disp_flush_wait(lv_display_t *disp_drv)
+{
+    (void)disp_drv;
+
+    tal_semaphore_wait_forever(sg_flush_idle_sem);
+    tal_semaphore_post(sg_flush_idle_sem);
+}
+
+static void disp_rect_from_area(TKL_DISP_RECT_S *rect, const lv_area_t *area)
+{
+    rect->x = area->x1;
+    rect->y = area->y1;
+    rect->width = area->x2 - area->x1 + 1;
+    rect->height = area->y2 - area->y1 + 1;
+}
+
+#if DISP_RENDER_MODE == LV_DISPLAY_RENDER_MODE_DIRECT
+static void disp_rect_union(TKL_DISP_RECT_S *out, const TKL_DISP_RECT_S *a, const TKL_DISP_RECT_S *b)
+{
+    int x1 = LV_MIN(a->x, b->x);
+    int y1 = LV_MIN(a->y, b->y);
+    int x2 = LV_MAX(a->x + a->width, b->x + b->width);
+    int y2 = LV_MAX(a->y + a->height, b->y + b->height);
+
+    out->x = x1;
+    out->y = y1;
+    out->width = x2 - x1;
+    out->height = y2 - y1;
+}
+
+/* Collect the areas LVGL redrew in this frame. Two areas are merged when
+ * their bounding box costs no more pixels than sending them separately,
+ * which also turns overlapping and adjacent stripes into a single blit.*/
+static void disp_dirty_area_add(const lv_area_t *area)
+{
+    uint8_t i;
+    TKL_DISP_RECT_S rect, merged;
+
+    disp_rect_from_area(&rect, area);
+
+    i = 0;
+    while (i < sg_dirty_num) {
+        disp_rect_union(&merged, &sg_dirty_rect[i], &rect);
+        if ((uint32_t)merged.width * merged.height <=
+            (uint32_t)sg_dirty_rect[i].width * sg_dirty_rect[i].height + (uint32_t)rect.width * rect.height) {
+            rect = merged;
+            sg_dirty_rect[i] = sg_dirty_rect[--sg_dirty_num];
+            i = 0;
+            continue;
+        }
+        i++;
+    }
+
+    if (sg_dirty_num < DISP_MERGE_AREA_MAX) {
+        sg_dirty_rect[sg_dirty_num++] = rect;
+    } else {
+        disp_rect_union(&sg_dirty_rect[DISP_MERGE_AREA_MAX - 1], &sg_dirty_rect[DISP_MERGE_AREA_MAX - 1], &rect);
+    }
+}
+#endif
+
+/*Hand a job to the flush task, or run it here when there is no task*/
+static void disp_flush_job_submit(lv_display_t *disp_drv, DISP_FLUSH_JOB_T *job)
+{
+    if (NULL == sg_flush_queue) {
+        disp_flush_job_run(job);
+        lv_disp_flush_ready(disp_drv);
+        return;
+    }
+
+    /*Taken back by the task once it is done, the queue is empty then so the post does not wait*/
+    tal_semaphore_wait_forever(sg_flush_idle_sem);
+    tal_queue_post(sg_flush_queue, job, 0xFFFFFFFF);
+}
+
 /*Flush the content of the internal buffer the specific area on the display.
  *`px_map` contains the rendered image as raw pixel map and it should be copied to `area` on the display.
- *You can use DMA or any hardware acceleration to do this operation in the background but
- *'lv_display_flush_ready()' has to be called when it's finished.*/
+ *The transfer is handed to the flush task and 'lv_display_flush_ready()' is called there when it's finished.
+ *Areas which are not sent still go through the task, so that the ready calls keep their order.
+ *In direct mode the areas of a frame are only collected here and sent together on the last one.*/
 static void disp_flush(lv_display_t *disp_drv, const lv_area_t *area, uint8_t *px_map)
 {
-    OPERATE_RET rt = OPRT_OK;
-    TKL_DISP_FRAMEBUFFER_S buf;
-    TKL_DISP_RECT_S rect;
+    DISP_FLUSH_JOB_T job;
 
-    if (disp_flush_enabled) {
-        buf.buffer = (void *)px_map;
-        buf.format = TKL_DISP_PIXEL_FMT_RGB565;
-        rect.x = area->x1;
-        rect.y = area->y1;
-        rect.width = area->x2 - area->x1 + 1;
-        rect.height = area->y2 - area->y1 + 1;
+    memset(&job, 0, sizeof(DISP_FLUSH_JOB_T));
+    if (!disp_flush_enabled) {
+        disp_flush_job_submit(disp_drv, &job);
+        return;
+    }
 
-        memcpy(&buf.rect, &rect, sizeof(TKL_DISP_RECT_S));
-        tkl_disp_blit(&sg_lcd, &buf, &rect);
+    job.fb.buffer = (void *)px_map;
+    job.fb.format = TKL_DISP_PIXEL_FMT_RGB565;
+    job.is_last = lv_disp_flush_is_last(disp_drv);
 
-        if (lv_disp_flush_is_last(disp_drv)) {
-            tkl_disp_flush(&sg_lcd);
-        }
+#if DISP_RENDER_MODE == LV_DISPLAY_RENDER_MODE_DIRECT
+    disp_dirty_area_add(area);
+    if (!job.is_last) {
+        disp_flush_job_submit(disp_drv, &job);
+        return;
     }
 
-    lv_disp_flush_ready(disp_drv);
+    job.fb.rect.x = 0;
+    job.fb.rect.y = 0;
+    job.fb.rect.width = sg_lcd_info.width;
+    job.fb.rect.height = sg_lcd_info.height;
+    job.rect_num = sg_dirty_num;
+    memcpy(job.rect, sg_dirty_rect, sg_dirty_num * sizeof(TKL_DISP_RECT_S));
+    sg_dirty_num = 0;
+#else
+    disp_rect_from_area(&job.fb.rect, area);
+    job.rect[0] = job.fb.rect;
+    job.rect_num = 1;
+#endif
+
+    disp_flush_job_submit(disp_drv, &job);
 }
 
 #else /*Enable this file at the top*/
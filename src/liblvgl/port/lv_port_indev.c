@@ -9,7 +9,10 @@
 #include "tuya_iot_config.h"
 #include "lv_port_indev.h"
 #ifdef LVGL_ENABLE_TOUCH
-#include "tkl_touch.h"
+#include "touch_service.h"
+#endif
+#ifdef LVGL_ENABLE_ENCODER
+#include "drv_encoder.h"
 #endif
 
 /*********************
@@ -98,7 +101,7 @@ void lv_port_indev_init(void)
 /*Initialize your touchpad*/
 static void touchpad_init(void)
 {
-    tkl_touch_init();
+    touch_service_start();
 }
 
 /*Will be called by the library to read the touchpad*/
@@ -106,21 +109,19 @@ static void touchpad_read(lv_indev_t *indev_drv, lv_indev_data_t *data)
 {
     static int32_t last_x = 0;
     static int32_t last_y = 0;
-    uint8_t point_num = 0;
-    touch_point_t point;
-
-    tkl_touch_read(&point_num, &point, 1);
-    /*Save the pressed coordinates and the state*/
-    if (point_num > 0) {
-        data->state = LV_INDEV_STATE_PRESSED;
-        last_x = point.x;
-        last_y = point.y;
-        PR_DEBUG("touchpad_read: x=%d, y=%d", point.x, point.y);
-    } else {
-        data->state = LV_INDEV_STATE_RELEASED;
+    static lv_indev_state_t last_state = LV_INDEV_STATE_RELEASED;
+    touch_event_t evt;
+
+    /*One event per call, LVGL calls again while there are more so that a
+     *quick tap still shows as a press then a release*/
+    if (OPRT_OK == touch_service_event_get(&evt, 0)) {
+        last_x = evt.point.x;
+        last_y = evt.point.y;
+        last_state = (TOUCH_EVENT_RELEASE == evt.type) ? LV_INDEV_STATE_RELEASED : LV_INDEV_STATE_PRESSED;
+        data->continue_reading = true;
     }
 
-    /*Set the last pressed coordinates*/
+    data->state = last_state;
     data->point.x = last_x;
     data->point.y = last_y;
 }
@@ -135,7 +136,7 @@ lv_indev_state_t encoder_state;
 /*Initialize your encoder*/
 static void encoder_init(void)
 {
-    drv_encoder_init();
+    tkl_encoder_init();
 }
 
 /*Will be called by the library to read the encoder*/
@@ -15,7 +15,12 @@
 #include "tal_thread.h"
 #include "tal_system.h"
 
+#if defined(LWIP_TUYA_LF_MBOX) && (LWIP_TUYA_LF_MBOX == 1)
+#include "sys_mbox_lf.h"
+#define SYS_MBOX_NULL           ( SYS_MBOX_LF_HANDLE )0
+#else
 #define SYS_MBOX_NULL           ( QUEUE_HANDLE )0
+#endif
 #define SYS_SEM_NULL            ( SEM_HANDLE )0
 
 /* ------------------------ Type definitions ------------------------------ */
@@ -23,7 +28,11 @@ typedef SEM_HANDLE sys_sem_t;
 typedef MUTEX_HANDLE sys_mutex_t;
 typedef THREAD_HANDLE sys_thread_t;
 typedef int     sys_prot_t;
+#if defined(LWIP_TUYA_LF_MBOX) && (LWIP_TUYA_LF_MBOX == 1)
+typedef SYS_MBOX_LF_HANDLE sys_mbox_t;
+#else
 typedef QUEUE_HANDLE sys_mbox_t;
+#endif
 
 #endif /* __SYS_RTXC_H__ */
 
@@ -0,0 +1,100 @@
+/**
+ * @file sys_mbox_lf.h
+ * @brief Lock-free mailbox of the lwIP sys_arch port.
+ *
+ * A bounded ring of message pointers for any number of producers and a single
+ * consumer. Producers claim a slot with one compare-and-swap and never take a
+ * lock, the consumer sleeps on one wakeup semaphore which is only posted when
+ * it is parked, so a busy tcpip_thread costs no kernel call per message.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __SYS_MBOX_LF_H__
+#define __SYS_MBOX_LF_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define SYS_MBOX_LF_WAIT_FOREVER 0xFFFFFFFF
+
+typedef struct sys_mbox_lf *SYS_MBOX_LF_HANDLE;
+
+/***********************************************************
+*************************function define********************
+***********************************************************/
+/**
+ * @brief Creates an empty mailbox.
+ *
+ * @param[out] mbox: the new mailbox
+ * @param[in] size: messages the mailbox holds, rounded up to a power of 2
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET sys_mbox_lf_create(SYS_MBOX_LF_HANDLE *mbox, uint32_t size);
+
+/**
+ * @brief Frees a mailbox, the messages still in it are dropped.
+ *
+ * @param[in] mbox: the mailbox
+ *
+ * @return none
+ */
+void sys_mbox_lf_free(SYS_MBOX_LF_HANDLE mbox);
+
+/**
+ * @brief Posts a message without blocking, safe from any number of threads.
+ *
+ * @param[in] mbox: the mailbox
+ * @param[in] msg: the message, may be NULL
+ *
+ * @return OPRT_OK on success, OPRT_EXCEED_UPPER_LIMIT if the mailbox is full.
+ */
+OPERATE_RET sys_mbox_lf_trypost(SYS_MBOX_LF_HANDLE mbox, void *msg);
+
+/**
+ * @brief Posts a message, waits while the mailbox is full.
+ *
+ * @param[in] mbox: the mailbox
+ * @param[in] msg: the message, may be NULL
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET sys_mbox_lf_post(SYS_MBOX_LF_HANDLE mbox, void *msg);
+
+/**
+ * @brief Fetches the oldest message without blocking. Only the consumer
+ * thread of the mailbox may fetch.
+ *
+ * @param[in] mbox: the mailbox
+ * @param[out] msg: the message
+ *
+ * @return OPRT_OK on success, OPRT_RESOURCE_NOT_READY if the mailbox is empty.
+ */
+OPERATE_RET sys_mbox_lf_tryfetch(SYS_MBOX_LF_HANDLE mbox, void **msg);
+
+/**
+ * @brief Fetches the oldest message, waits for one if the mailbox is empty.
+ * Only the consumer thread of the mailbox may fetch.
+ *
+ * @param[in] mbox: the mailbox
+ * @param[out] msg: the message
+ * @param[in] timeout: wait in ms, SYS_MBOX_LF_WAIT_FOREVER to wait until a
+ * message arrives
+ *
+ * @return OPRT_OK on success, OPRT_TIMEOUT if no message arrived in time.
+ */
+OPERATE_RET sys_mbox_lf_fetch(SYS_MBOX_LF_HANDLE mbox, void **msg, uint32_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SYS_MBOX_LF_H__ */
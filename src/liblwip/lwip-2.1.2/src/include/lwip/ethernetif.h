@@ -27,6 +27,26 @@ typedef struct {
     ip4_addr_t gw;
 } ty_netif_ip_info_s;
 
+#if LWIP_TUYA_ZERO_COPY
+/* gives a rx buffer back to the driver */
+typedef void (*tuya_ethernetif_rx_free_cb)(void *buf, void *arg);
+
+typedef struct {
+    void *buf;
+    u16_t len;
+} TUYA_ETHERNETIF_SG_T;
+
+typedef struct {
+    u32_t rx_pkts;
+    u32_t rx_bytes;
+    u32_t rx_copy_bytes;  /* bytes copied because no rx wrapper was free */
+    u32_t rx_pool_empty;
+    u32_t tx_pkts;
+    u32_t tx_bytes;
+    u32_t tx_copy_bytes;  /* bytes copied by tuya_ethernetif_tx_copy */
+} TUYA_ETHERNETIF_ZC_STAT_T;
+#endif /* LWIP_TUYA_ZERO_COPY */
+
 /***********************************************************
 *************************variable define********************
 ***********************************************************/
@@ -123,6 +143,49 @@ extern int tuya_hostap_eapol_input(int vif_index, unsigned char *buf, unsigned s
 int tuya_ethernetif_get_ifindex_by_mac(NW_MAC_S *mac, TUYA_NETIF_TYPE *net_if_idx);
 
 int tuya_ethernetif_get_dns_srv(NW_IP_TYPE type, NW_IP_S *ip);
+
+#if LWIP_TUYA_ZERO_COPY
+/**
+ * @brief ethernet interface recv a driver buffer without copying it
+ *
+ * @param[in]      netif     the netif to which to recieve the packet
+ * @param[in]      buf       the frame, kept until free_cb is called
+ * @param[in]      len       the length of the frame
+ * @param[in]      free_cb   gives the buffer back to the driver
+ * @param[in]      arg       passed to free_cb
+ * @return  err_t  ERR_OK: the buffer was taken, free_cb is called once   other: fail, free_cb is not called
+ */
+err_t tuya_ethernetif_rx_input(struct netif *netif, void *buf, u16_t len, tuya_ethernetif_rx_free_cb free_cb,
+                               void *arg);
+
+/**
+ * @brief scatter-gather list of a pbuf chain to be sent
+ *
+ * @param[in]      p         the packet to be send, in pbuf mode
+ * @param[out]     sg        the entries, one per non-empty pbuf
+ * @param[in]      sg_num    the size of sg
+ * @return  int    the number of entries, -1 if the chain needs more than sg_num
+ */
+int tuya_ethernetif_tx_sg(struct pbuf *p, TUYA_ETHERNETIF_SG_T *sg, int sg_num);
+
+/**
+ * @brief copy a pbuf chain into one driver buffer, for drivers or chains sg does not fit
+ *
+ * @param[in]      p         the packet to be send, in pbuf mode
+ * @param[out]     buf       the driver buffer
+ * @param[in]      size      the size of buf
+ * @return  int    the frame length, -1 if buf is too small
+ */
+int tuya_ethernetif_tx_copy(struct pbuf *p, void *buf, u16_t size);
+
+/**
+ * @brief get the rx/tx counters of the zero copy path
+ *
+ * @param[out]     stat      the counters since boot
+ * @return  void
+ */
+void tuya_ethernetif_zc_stat_get(TUYA_ETHERNETIF_ZC_STAT_T *stat);
+#endif /* LWIP_TUYA_ZERO_COPY */
 #ifdef LWIP_DUAL_NET_SUPPORT
 /**
  * Helper struct to hold private data used to operate your ethernet interface.
@@ -81,6 +81,16 @@
 #define LWIP_RANDOMIZE_INITIAL_LOCAL_PORTS  1
 
 #define LWIP_TUYA_PACKET_PRINT          0
+
+/* ---------Zero copy ethernetif--------- */
+//#define LWIP_TUYA_ZERO_COPY             1
+
+#if LWIP_TUYA_ZERO_COPY
+#define LWIP_SUPPORT_CUSTOM_PBUF        1
+#endif
+
+/* ---------Lock-free sys_mbox--------- */
+//#define LWIP_TUYA_LF_MBOX               0
     
     
 //#define LWIP_DEBUG                      0
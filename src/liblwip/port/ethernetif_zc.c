@@ -0,0 +1,227 @@
+/**
+ * @file ethernetif_zc.c
+ * @brief Zero copy rx/tx path of the ethernet interface.
+ *
+ * The driver hands its rx buffers to lwip as PBUF_REF custom pbufs and gets
+ * them back through a callback once lwip is done with them, and sends pbuf
+ * chains as scatter-gather lists. Only the pbuf core of lwip is used here, so
+ * the path also builds on the host for its UT.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "lwip/opt.h"
+#include "lwip/def.h"
+#include "lwip/pbuf.h"
+#include "lwip/sys.h"
+#include "lwip/err.h"
+#include "ethernetif.h"
+
+#if LWIP_TUYA_ZERO_COPY
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#ifndef LWIP_TUYA_ZC_RX_NUM
+#define LWIP_TUYA_ZC_RX_NUM 16
+#endif
+
+/* a driver rx buffer lent to lwip */
+typedef struct tuya_ethernetif_rx_pbuf {
+    struct pbuf_custom pc;
+    void *buf;
+    tuya_ethernetif_rx_free_cb free_cb;
+    void *arg;
+    struct tuya_ethernetif_rx_pbuf *next;
+} TUYA_ETHERNETIF_RX_PBUF_T;
+
+/***********************************************************
+*************************variable define********************
+***********************************************************/
+static TUYA_ETHERNETIF_RX_PBUF_T s_rx_pbuf[LWIP_TUYA_ZC_RX_NUM];
+static TUYA_ETHERNETIF_RX_PBUF_T *s_rx_pbuf_free = NULL;
+static u8_t s_rx_pbuf_inited = 0;
+static TUYA_ETHERNETIF_ZC_STAT_T s_zc_stat;
+
+/***********************************************************
+*************************function define********************
+***********************************************************/
+/**
+ * @brief give a wrapped rx buffer back to its driver, called by pbuf_free
+ *
+ * @param[in]       p       the custom pbuf
+ * @return  void
+ */
+static void tuya_ethernetif_rx_pbuf_free(struct pbuf *p)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    TUYA_ETHERNETIF_RX_PBUF_T *rx = (TUYA_ETHERNETIF_RX_PBUF_T *)p;
+
+    rx->free_cb(rx->buf, rx->arg);
+
+    SYS_ARCH_PROTECT(lev);
+    rx->next = s_rx_pbuf_free;
+    s_rx_pbuf_free = rx;
+    SYS_ARCH_UNPROTECT(lev);
+}
+
+static TUYA_ETHERNETIF_RX_PBUF_T *tuya_ethernetif_rx_pbuf_get(void)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    TUYA_ETHERNETIF_RX_PBUF_T *rx = NULL;
+    int i;
+
+    SYS_ARCH_PROTECT(lev);
+    if (!s_rx_pbuf_inited) {
+        for (i = 0; i < LWIP_TUYA_ZC_RX_NUM; i++) {
+            s_rx_pbuf[i].next = s_rx_pbuf_free;
+            s_rx_pbuf_free = &s_rx_pbuf[i];
+        }
+        s_rx_pbuf_inited = 1;
+    }
+    rx = s_rx_pbuf_free;
+    if (rx) {
+        s_rx_pbuf_free = rx->next;
+    }
+    SYS_ARCH_UNPROTECT(lev);
+
+    return rx;
+}
+
+/**
+ * @brief ethernet interface recv a driver buffer without copying it
+ *
+ * The buffer is wrapped in a PBUF_REF custom pbuf and handed to the netif
+ * input, free_cb gives it back to the driver once lwip drops the last
+ * reference, which may be long after this call (e.g. tcp out of sequence
+ * queue). When all LWIP_TUYA_ZC_RX_NUM wrappers are in use, the frame is
+ * copied into a PBUF_POOL pbuf and the buffer is released at once.
+ *
+ * @param[in]      netif     the netif to which to recieve the packet
+ * @param[in]      buf       the frame, kept until free_cb is called
+ * @param[in]      len       the length of the frame
+ * @param[in]      free_cb   gives the buffer back to the driver
+ * @param[in]      arg       passed to free_cb
+ * @return  err_t  ERR_OK: the buffer was taken, free_cb is called once   other: fail, free_cb is not called
+ */
+err_t tuya_ethernetif_rx_input(struct netif *netif, void *buf, u16_t len, tuya_ethernetif_rx_free_cb free_cb,
+                               void *arg)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    TUYA_ETHERNETIF_RX_PBUF_T *rx = NULL;
+    struct pbuf *p = NULL;
+
+    if (NULL == netif || NULL == buf || 0 == len || NULL == free_cb) {
+        return ERR_ARG;
+    }
+
+    rx = tuya_ethernetif_rx_pbuf_get();
+    if (rx) {
+        rx->buf = buf;
+        rx->free_cb = free_cb;
+        rx->arg = arg;
+        rx->pc.custom_free_function = tuya_ethernetif_rx_pbuf_free;
+        p = pbuf_alloced_custom(PBUF_RAW, len, PBUF_REF, &rx->pc, buf, len);
+    } else {
+        p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+        if (NULL == p) {
+            return ERR_MEM;
+        }
+        pbuf_take(p, buf, len);
+        free_cb(buf, arg);
+    }
+
+    SYS_ARCH_PROTECT(lev);
+    s_zc_stat.rx_pkts++;
+    s_zc_stat.rx_bytes += len;
+    if (NULL == rx) {
+        s_zc_stat.rx_copy_bytes += len;
+        s_zc_stat.rx_pool_empty++;
+    }
+    SYS_ARCH_UNPROTECT(lev);
+
+    if (ERR_OK != netif->input(p, netif)) {
+        pbuf_free(p);
+    }
+
+    return ERR_OK;
+}
+
+/**
+ * @brief scatter-gather list of a pbuf chain to be sent
+ *
+ * The entries point into the pbufs, a driver that keeps them after
+ * linkoutput returns must pbuf_ref the packet and pbuf_free it once sent.
+ *
+ * @param[in]      p         the packet to be send, in pbuf mode
+ * @param[out]     sg        the entries, one per non-empty pbuf
+ * @param[in]      sg_num    the size of sg
+ * @return  int    the number of entries, -1 if the chain needs more than sg_num
+ */
+int tuya_ethernetif_tx_sg(struct pbuf *p, TUYA_ETHERNETIF_SG_T *sg, int sg_num)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+    struct pbuf *q = NULL;
+    int n = 0;
+
+    for (q = p; q != NULL; q = q->next) {
+        if (0 == q->len) {
+            continue;
+        }
+        if (n == sg_num) {
+            return -1;
+        }
+        sg[n].buf = q->payload;
+        sg[n].len = q->len;
+        n++;
+    }
+
+    SYS_ARCH_PROTECT(lev);
+    s_zc_stat.tx_pkts++;
+    s_zc_stat.tx_bytes += p->tot_len;
+    SYS_ARCH_UNPROTECT(lev);
+
+    return n;
+}
+
+/**
+ * @brief copy a pbuf chain into one driver buffer, for drivers or chains sg does not fit
+ *
+ * @param[in]      p         the packet to be send, in pbuf mode
+ * @param[out]     buf       the driver buffer
+ * @param[in]      size      the size of buf
+ * @return  int    the frame length, -1 if buf is too small
+ */
+int tuya_ethernetif_tx_copy(struct pbuf *p, void *buf, u16_t size)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    if (p->tot_len > size) {
+        return -1;
+    }
+    pbuf_copy_partial(p, buf, p->tot_len, 0);
+
+    SYS_ARCH_PROTECT(lev);
+    s_zc_stat.tx_pkts++;
+    s_zc_stat.tx_bytes += p->tot_len;
+    s_zc_stat.tx_copy_bytes += p->tot_len;
+    SYS_ARCH_UNPROTECT(lev);
+
+    return p->tot_len;
+}
+
+/**
+ * @brief get the rx/tx counters of the zero copy path
+ *
+ * @param[out]     stat      the counters since boot
+ * @return  void
+ */
+void tuya_ethernetif_zc_stat_get(TUYA_ETHERNETIF_ZC_STAT_T *stat)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    SYS_ARCH_PROTECT(lev);
+    *stat = s_zc_stat;
+    SYS_ARCH_UNPROTECT(lev);
+}
+#endif /* LWIP_TUYA_ZERO_COPY */
@@ -239,29 +239,139 @@ err_t sys_mutex_trylock(sys_mutex_t *pxMutex)
     }
     return ERR_OK;
 }
+
+void sys_delay_ms(uint32_t ms)
+{
+    tal_system_sleep(ms);
+}
+
 /* ------------------------ Start implementation ( Mailboxes ) ------------ */
+#if defined(LWIP_TUYA_LF_MBOX) && (LWIP_TUYA_LF_MBOX == 1)
+/*
+ * The lock-free mailbox takes any number of posting threads and one fetching
+ * thread, which is how lwIP uses its mailboxes: tcpip_thread fetches the
+ * tcpip mailbox, the owner of a netconn fetches its recvmbox and acceptmbox.
+ */
 
 /*
 Creates an empty mailbox.
 */
 err_t sys_mbox_new(sys_mbox_t *mbox, int size)
 {
-    if (tal_queue_create_init(mbox, sizeof(void *), size) != ERR_OK) {
-        SYS_ARCH_DBG("%s: call tal_queue_create_init failed\n", __func__);
+    if (sys_mbox_lf_create(mbox, size > 0 ? (uint32_t)size : 0) != OPRT_OK) {
+        SYS_ARCH_DBG("%s: call sys_mbox_lf_create failed\n", __func__);
         return ERR_MEM;
     }
 
+    return ERR_OK;
+}
+
+/*
+Deallocates a mailbox. If there are messages still present in the
+mailbox when the mailbox is deallocated, it is an indication of a
+programming error in lwIP and the developer should be notified.
+*/
+void sys_mbox_free(sys_mbox_t *mbox)
+{
+    sys_mbox_lf_free(*mbox);
+}
+
+/*
+ * Posts the "msg" to the mailbox, waits while the mailbox is full.
+ */
+void sys_mbox_post(sys_mbox_t *mbox, void *msg)
+{
+    if (sys_mbox_lf_post(*mbox, msg) != OPRT_OK) {
+        SYS_ARCH_DBG("%s: call sys_mbox_lf_post failed\n", __func__);
+    }
+}
+
+/*
+ * Try to post the "msg" to the mailbox. Returns ERR_MEM if this one is full,
+ * else, ERR_OK if the "msg" is posted.
+ */
+err_t sys_mbox_trypost(sys_mbox_t *mbox, void *msg)
+{
+    if (sys_mbox_lf_trypost(*mbox, msg) != OPRT_OK) {
+        SYS_ARCH_DBG("%s: call sys_mbox_lf_trypost failed\n", __func__);
+        return ERR_MEM;
+    }
+
+    return ERR_OK;
+}
+
+/*
+ * Blocks the thread until a message arrives in the mailbox, but does
+ * not block the thread longer than "timeout" milliseconds, 0 waits forever.
+ * Returns the milliseconds waited, or SYS_ARCH_TIMEOUT.
+ */
+u32_t sys_arch_mbox_fetch(sys_mbox_t *mbox, void **msg, u32_t timeout)
+{
+    void *dummyptr;
+    unsigned int StartTime, Elapsed;
+
+    StartTime = tal_system_get_millisecond();
+    if (msg == NULL) {
+        msg = &dummyptr;
+    }
+
     if (*mbox == NULL) {
-        SYS_ARCH_DBG("%s: null mbox\n", __func__);
+        *msg = NULL;
+        SYS_ARCH_DBG("%s: input invalid params\n", __func__);
         return ERR_MEM;
     }
 
+    if (sys_mbox_lf_fetch(*mbox, msg, timeout ? timeout : SYS_MBOX_LF_WAIT_FOREVER) != OPRT_OK) {
+        *msg = NULL;
+        SYS_ARCH_DBG("%s: mbox fetch wait timeout %d\n", __func__, timeout);
+        return SYS_ARCH_TIMEOUT;
+    }
+
+    Elapsed = tal_system_get_millisecond() - StartTime;
+    if (Elapsed == 0) {
+        Elapsed = 1;
+    }
+
+    return Elapsed;
+}
+
+/*
+ * This is similar to sys_arch_mbox_fetch, however if a message is not present
+ * in the mailbox, it immediately returns with the code SYS_MBOX_EMPTY
+ * On success 0 is returned.
+ */
+u32_t sys_arch_mbox_tryfetch(sys_mbox_t *mbox, void **msg)
+{
+    void *pvDummy;
+
+    if (msg == NULL) {
+        msg = &pvDummy;
+    }
+
+    if (sys_mbox_lf_tryfetch(*mbox, msg) != OPRT_OK) {
+        return SYS_MBOX_EMPTY;
+    }
+
     return ERR_OK;
 }
+#else
 
-void sys_delay_ms(uint32_t ms)
+/*
+Creates an empty mailbox.
+*/
+err_t sys_mbox_new(sys_mbox_t *mbox, int size)
 {
-    tal_system_sleep(ms);
+    if (tal_queue_create_init(mbox, sizeof(void *), size) != ERR_OK) {
+        SYS_ARCH_DBG("%s: call tal_queue_create_init failed\n", __func__);
+        return ERR_MEM;
+    }
+
+    if (*mbox == NULL) {
+        SYS_ARCH_DBG("%s: null mbox\n", __func__);
+        return ERR_MEM;
+    }
+
+    return ERR_OK;
 }
 
 /*
@@ -380,6 +490,7 @@ u32_t sys_arch_mbox_tryfetch(sys_mbox_t *mbox, void **msg)
 
     return ERR_OK;
 }
+#endif /* LWIP_TUYA_LF_MBOX */
 
 /** Returns the current time in milliseconds. */
 u32_t sys_now(void)
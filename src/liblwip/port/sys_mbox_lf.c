@@ -0,0 +1,221 @@
+/**
+ * @file sys_mbox_lf.c
+ * @brief Lock-free mailbox of the lwIP sys_arch port.
+ *
+ * Every slot of the ring carries a sequence number. A producer owns the slot
+ * at tail when its sequence equals tail, claims it by moving tail forward
+ * with a compare-and-swap, stores the message and publishes it by setting the
+ * sequence to tail + 1. The consumer reads the slot at head once its sequence
+ * is head + 1 and hands it back to the producers of the next lap. Messages
+ * leave in the order their slots were claimed, so the messages of one
+ * producer keep their order.
+ *
+ * The consumer raises parked before it sleeps and looks at the ring once
+ * more, a producer looks at parked after it published. One of the two always
+ * sees the other, the producer that clears parked posts the wakeup. A producer
+ * blocked on a full ring does the same with blocked and the space semaphore,
+ * which the consumer only posts while blocked is not 0 and the ring has
+ * drained to half. The ring empties before the consumer sleeps, so a blocked
+ * producer is always posted.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "tal_log.h"
+#include "tal_memory.h"
+#include "tal_semaphore.h"
+#include "tal_system.h"
+#include "lwip/arch/sys_mbox_lf.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define SYS_MBOX_LF_MIN_SIZE 2
+
+typedef struct {
+    uint32_t seq;
+    void *msg;
+} SYS_MBOX_LF_CELL_T;
+
+struct sys_mbox_lf {
+    uint32_t mask;
+    uint32_t tail;   // next slot a producer claims
+    uint32_t head;   // next slot the consumer reads, consumer only
+    uint32_t parked;  // 1 while the consumer may be asleep on wakeup
+    uint32_t blocked; // producers that may be asleep on space
+    SEM_HANDLE wakeup;
+    SEM_HANDLE space;
+    SYS_MBOX_LF_CELL_T cells[];
+};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+OPERATE_RET sys_mbox_lf_create(SYS_MBOX_LF_HANDLE *mbox, uint32_t size)
+{
+    OPERATE_RET rt = OPRT_OK;
+    struct sys_mbox_lf *lf = NULL;
+    uint32_t num = SYS_MBOX_LF_MIN_SIZE, i;
+
+    TUYA_CHECK_NULL_RETURN(mbox, OPRT_INVALID_PARM);
+
+    while (num < size) {
+        num <<= 1;
+    }
+
+    lf = tal_malloc(sizeof(struct sys_mbox_lf) + num * sizeof(SYS_MBOX_LF_CELL_T));
+    TUYA_CHECK_NULL_RETURN(lf, OPRT_MALLOC_FAILED);
+    memset(lf, 0, sizeof(struct sys_mbox_lf));
+
+    lf->mask = num - 1;
+    for (i = 0; i < num; i++) {
+        lf->cells[i].seq = i;
+        lf->cells[i].msg = NULL;
+    }
+
+    rt = tal_semaphore_create_init(&lf->wakeup, 0, 1);
+    if (OPRT_OK != rt) {
+        tal_free(lf);
+        return rt;
+    }
+    rt = tal_semaphore_create_init(&lf->space, 0, 1);
+    if (OPRT_OK != rt) {
+        tal_semaphore_release(lf->wakeup);
+        tal_free(lf);
+        return rt;
+    }
+
+    *mbox = lf;
+
+    return OPRT_OK;
+}
+
+void sys_mbox_lf_free(SYS_MBOX_LF_HANDLE mbox)
+{
+    if (NULL == mbox) {
+        return;
+    }
+
+    tal_semaphore_release(mbox->wakeup);
+    tal_semaphore_release(mbox->space);
+    tal_free(mbox);
+}
+
+OPERATE_RET sys_mbox_lf_trypost(SYS_MBOX_LF_HANDLE mbox, void *msg)
+{
+    SYS_MBOX_LF_CELL_T *cell = NULL;
+    uint32_t pos, seq;
+    int32_t diff;
+
+    pos = __atomic_load_n(&mbox->tail, __ATOMIC_RELAXED);
+    for (;;) {
+        cell = &mbox->cells[pos & mbox->mask];
+        seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        diff = (int32_t)(seq - pos);
+        if (0 == diff) {
+            // the uncontended post claims its slot here on the first try
+            if (__atomic_compare_exchange_n(&mbox->tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // the consumer has not read this slot of the previous lap yet
+            return OPRT_EXCEED_UPPER_LIMIT;
+        } else {
+            pos = __atomic_load_n(&mbox->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->msg = msg;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+    // pairs with the fence of sys_mbox_lf_fetch, see the file header
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&mbox->parked, __ATOMIC_RELAXED) && __atomic_exchange_n(&mbox->parked, 0, __ATOMIC_ACQ_REL)) {
+        tal_semaphore_post(mbox->wakeup);
+    }
+
+    return OPRT_OK;
+}
+
+OPERATE_RET sys_mbox_lf_post(SYS_MBOX_LF_HANDLE mbox, void *msg)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    while (OPRT_EXCEED_UPPER_LIMIT == (rt = sys_mbox_lf_trypost(mbox, msg))) {
+        __atomic_add_fetch(&mbox->blocked, 1, __ATOMIC_SEQ_CST);
+        // a slot freed before blocked was raised did not post space
+        rt = sys_mbox_lf_trypost(mbox, msg);
+        if (OPRT_EXCEED_UPPER_LIMIT == rt) {
+            tal_semaphore_wait(mbox->space, SEM_WAIT_FOREVER);
+        }
+        __atomic_sub_fetch(&mbox->blocked, 1, __ATOMIC_RELAXED);
+        if (OPRT_EXCEED_UPPER_LIMIT != rt) {
+            break;
+        }
+    }
+
+    return rt;
+}
+
+OPERATE_RET sys_mbox_lf_tryfetch(SYS_MBOX_LF_HANDLE mbox, void **msg)
+{
+    SYS_MBOX_LF_CELL_T *cell = NULL;
+    uint32_t pos = mbox->head;
+
+    cell = &mbox->cells[pos & mbox->mask];
+    if ((int32_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - (pos + 1)) < 0) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+
+    *msg = cell->msg;
+    __atomic_store_n(&cell->seq, pos + mbox->mask + 1, __ATOMIC_RELEASE);
+    mbox->head = pos + 1;
+
+    // pairs with the increment of blocked in sys_mbox_lf_post, see the file header.
+    // Blocked producers are woken once half of the ring is free, waking them for
+    // every freed slot trades one message per context switch.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&mbox->blocked, __ATOMIC_RELAXED) &&
+        (uint32_t)(__atomic_load_n(&mbox->tail, __ATOMIC_RELAXED) - mbox->head) <= (mbox->mask + 1) / 2) {
+        tal_semaphore_post(mbox->space);
+    }
+
+    return OPRT_OK;
+}
+
+OPERATE_RET sys_mbox_lf_fetch(SYS_MBOX_LF_HANDLE mbox, void **msg, uint32_t timeout)
+{
+    SYS_TIME_T start = 0;
+    uint32_t waited = 0;
+
+    if (SYS_MBOX_LF_WAIT_FOREVER != timeout) {
+        start = tal_system_get_millisecond();
+    }
+
+    for (;;) {
+        if (OPRT_OK == sys_mbox_lf_tryfetch(mbox, msg)) {
+            return OPRT_OK;
+        }
+
+        __atomic_store_n(&mbox->parked, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        // a producer that published before parked was raised did not post
+        if (OPRT_OK == sys_mbox_lf_tryfetch(mbox, msg)) {
+            // a late producer may still post, the next fetch takes it as a spurious wakeup
+            __atomic_store_n(&mbox->parked, 0, __ATOMIC_RELAXED);
+            return OPRT_OK;
+        }
+
+        if (SYS_MBOX_LF_WAIT_FOREVER != timeout) {
+            waited = (uint32_t)(tal_system_get_millisecond() - start);
+            if (waited >= timeout) {
+                __atomic_store_n(&mbox->parked, 0, __ATOMIC_RELAXED);
+                return OPRT_TIMEOUT;
+            }
+        }
+
+        tal_semaphore_wait(mbox->wakeup, SYS_MBOX_LF_WAIT_FOREVER == timeout ? SEM_WAIT_FOREVER : timeout - waited);
+        __atomic_store_n(&mbox->parked, 0, __ATOMIC_RELAXED);
+    }
+}
@@ -0,0 +1,20 @@
+/**
+ * @file cc.h
+ * @brief Compiler and platform of the host UT, lwip's defaults on the libc.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __CC_H__
+#define __CC_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define LWIP_TIMEVAL_PRIVATE 0
+
+#define LWIP_RAND() ((u32_t)rand())
+
+#endif /* __CC_H__ */
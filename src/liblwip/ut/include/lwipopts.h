@@ -0,0 +1,36 @@
+/**
+ * @file lwipopts.h
+ * @brief lwip options of the host UT.
+ *
+ * Only the pbuf core is built: no OS, the heap and the pools on the libc
+ * malloc and no protocols.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef LWIP_HDR_LWIPOPTS_H
+#define LWIP_HDR_LWIPOPTS_H
+
+#define NO_SYS                   1
+#define SYS_LIGHTWEIGHT_PROT     0
+#define MEM_LIBC_MALLOC          1
+#define MEMP_MEM_MALLOC          1
+#define PBUF_POOL_SIZE           64
+#define PBUF_POOL_BUFSIZE        1600
+
+#define LWIP_TCP                 0
+#define LWIP_UDP                 0
+#define LWIP_RAW                 0
+#define LWIP_NETCONN             0
+#define LWIP_SOCKET              0
+#define LWIP_STATS               0
+
+#define LWIP_TUYA_PACKET_PRINT   0
+
+/* ---------Zero copy ethernetif--------- */
+#define LWIP_TUYA_ZERO_COPY      1
+#define LWIP_TUYA_ZC_RX_NUM      8
+#define LWIP_SUPPORT_CUSTOM_PBUF 1
+
+#endif /* LWIP_HDR_LWIPOPTS_H */
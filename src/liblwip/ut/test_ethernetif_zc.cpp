@@ -0,0 +1,299 @@
+/**
+ * @file test_ethernetif_zc.cpp
+ * @brief UT of the zero copy rx/tx path of the ethernet interface.
+ *
+ * The driver side is simulated: rx buffers come from the heap and are counted
+ * when they are given back, and the netif input either drops a frame at once
+ * or holds it for a while, like the tcp out of sequence queue does. Every
+ * buffer must be given back exactly once, and frames may only be copied when
+ * all the wrappers are held.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <set>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "lwip/mem.h"
+#include "lwip/memp.h"
+#include "lwip/pbuf.h"
+#include "lwip/ethernetif.h"
+}
+
+#define FRAME_LEN 1514
+#define ETH_HLEN  14
+
+namespace {
+
+struct Driver {
+    uint32_t released = 0;
+    uint32_t unknown = 0; // not lent or given back already
+    std::set<void *> lent;
+};
+
+class EthernetifZc : public ::testing::Test {
+  protected:
+    void SetUp() override
+    {
+        mem_init();
+        memp_init();
+        memset(&netif, 0, sizeof(netif));
+        netif.input = __input;
+        netif.state = this;
+        tuya_ethernetif_zc_stat_get(&before);
+    }
+
+    void TearDown() override
+    {
+        release_held(held.size());
+    }
+
+    static void __free_cb(void *buf, void *arg)
+    {
+        Driver *drv = (Driver *)arg;
+
+        drv->released++;
+        if (0 == drv->lent.erase(buf)) {
+            drv->unknown++;
+            return;
+        }
+        free(buf);
+    }
+
+    static err_t __input(struct pbuf *p, struct netif *inp)
+    {
+        EthernetifZc *self = (EthernetifZc *)inp->state;
+
+        self->last_payload = p->payload;
+        self->last_custom = 0 != (p->flags & PBUF_FLAG_IS_CUSTOM);
+        if (ERR_OK != self->input_err) {
+            return self->input_err;
+        }
+        if (self->hold_every && 0 == ++self->input_cnt % self->hold_every) {
+            self->held.push_back(p);
+            return ERR_OK;
+        }
+        // what ethernet_input does before passing the frame up
+        pbuf_remove_header(p, ETH_HLEN);
+        pbuf_free(p);
+        return ERR_OK;
+    }
+
+    uint8_t *frame(uint8_t fill)
+    {
+        uint8_t *buf = (uint8_t *)malloc(FRAME_LEN);
+
+        memset(buf, fill, FRAME_LEN);
+        drv.lent.insert(buf);
+        return buf;
+    }
+
+    void release_held(size_t num)
+    {
+        for (; num && !held.empty(); num--) {
+            pbuf_free(held.back());
+            held.pop_back();
+        }
+    }
+
+    TUYA_ETHERNETIF_ZC_STAT_T stat()
+    {
+        TUYA_ETHERNETIF_ZC_STAT_T now, delta;
+
+        tuya_ethernetif_zc_stat_get(&now);
+        delta.rx_pkts = now.rx_pkts - before.rx_pkts;
+        delta.rx_bytes = now.rx_bytes - before.rx_bytes;
+        delta.rx_copy_bytes = now.rx_copy_bytes - before.rx_copy_bytes;
+        delta.rx_pool_empty = now.rx_pool_empty - before.rx_pool_empty;
+        delta.tx_pkts = now.tx_pkts - before.tx_pkts;
+        delta.tx_bytes = now.tx_bytes - before.tx_bytes;
+        delta.tx_copy_bytes = now.tx_copy_bytes - before.tx_copy_bytes;
+        return delta;
+    }
+
+    struct netif netif;
+    Driver drv;
+    TUYA_ETHERNETIF_ZC_STAT_T before;
+    std::vector<struct pbuf *> held;
+    uint32_t hold_every = 0;
+    uint32_t input_cnt = 0;
+    err_t input_err = ERR_OK;
+    void *last_payload = nullptr;
+    bool last_custom = false;
+};
+
+} // namespace
+
+TEST_F(EthernetifZc, RxBufferIsLentWithoutACopy)
+{
+    uint8_t *buf = frame(1);
+
+    ASSERT_EQ(ERR_OK, tuya_ethernetif_rx_input(&netif, buf, FRAME_LEN, __free_cb, &drv));
+    EXPECT_EQ((void *)buf, last_payload);
+    EXPECT_TRUE(last_custom);
+    EXPECT_EQ(1U, drv.released);
+    EXPECT_TRUE(drv.lent.empty());
+
+    TUYA_ETHERNETIF_ZC_STAT_T s = stat();
+    EXPECT_EQ(1U, s.rx_pkts);
+    EXPECT_EQ((uint32_t)FRAME_LEN, s.rx_bytes);
+    EXPECT_EQ(0U, s.rx_copy_bytes);
+    EXPECT_EQ(0U, s.rx_pool_empty);
+}
+
+TEST_F(EthernetifZc, HeldBufferIsReleasedWithItsLastReference)
+{
+    uint8_t *buf = frame(2);
+
+    hold_every = 1;
+    ASSERT_EQ(ERR_OK, tuya_ethernetif_rx_input(&netif, buf, FRAME_LEN, __free_cb, &drv));
+    ASSERT_EQ(1U, held.size());
+    pbuf_ref(held[0]);
+
+    pbuf_free(held[0]);
+    EXPECT_EQ(0U, drv.released);
+    release_held(1);
+    EXPECT_EQ(1U, drv.released);
+}
+
+TEST_F(EthernetifZc, DryPoolCopiesAndReleasesAtOnce)
+{
+    hold_every = 1;
+    for (int i = 0; i < LWIP_TUYA_ZC_RX_NUM; i++) {
+        ASSERT_EQ(ERR_OK, tuya_ethernetif_rx_input(&netif, frame(i), FRAME_LEN, __free_cb, &drv));
+    }
+    EXPECT_EQ(0U, drv.released);
+
+    uint8_t *buf = frame(0x5A);
+    ASSERT_EQ(ERR_OK, tuya_ethernetif_rx_input(&netif, buf, FRAME_LEN, __free_cb, &drv));
+    EXPECT_NE((void *)buf, last_payload);
+    EXPECT_FALSE(last_custom);
+    EXPECT_EQ(0x5A, ((uint8_t *)held.back()->payload)[FRAME_LEN - 1]);
+    EXPECT_EQ(1U, drv.released);
+
+    TUYA_ETHERNETIF_ZC_STAT_T s = stat();
+    EXPECT_EQ(1U, s.rx_pool_empty);
+    EXPECT_EQ((uint32_t)FRAME_LEN, s.rx_copy_bytes);
+
+    // a wrapper back in the pool, the next frame is lent again
+    release_held(2);
+    EXPECT_EQ(2U, drv.released);
+    buf = frame(3);
+    ASSERT_EQ(ERR_OK, tuya_ethernetif_rx_input(&netif, buf, FRAME_LEN, __free_cb, &drv));
+    EXPECT_EQ((void *)buf, last_payload);
+    EXPECT_EQ(1U, stat().rx_pool_empty);
+}
+
+TEST_F(EthernetifZc, EveryBufferIsReleasedOnceUnderOoseq)
+{
+    const uint32_t num = 20000;
+    uint32_t seed = 1;
+
+    // every third frame held, one held frame dropped after every fourth
+    hold_every = 3;
+    for (uint32_t i = 0; i < num; i++) {
+        ASSERT_EQ(ERR_OK, tuya_ethernetif_rx_input(&netif, frame((uint8_t)i), FRAME_LEN, __free_cb, &drv));
+        seed = seed * 1103515245U + 12345U;
+        release_held(0 == ((seed >> 16) & 0x7FFF) % 4);
+        if (held.size() > LWIP_TUYA_ZC_RX_NUM) {
+            // the queue is flushed once the gap is filled
+            release_held(held.size());
+        }
+    }
+    release_held(held.size());
+
+    TUYA_ETHERNETIF_ZC_STAT_T s = stat();
+    printf("[ ZC       ] %u frames: %u copied, %.1f copied bytes per frame\n", s.rx_pkts, s.rx_pool_empty,
+           (double)s.rx_copy_bytes / s.rx_pkts);
+    EXPECT_EQ(num, drv.released);
+    EXPECT_EQ(num, s.rx_pkts);
+    EXPECT_EQ(s.rx_pool_empty * FRAME_LEN, s.rx_copy_bytes);
+    EXPECT_GT(s.rx_pool_empty, 0U);
+    EXPECT_LT(s.rx_pool_empty, num / 10);
+    EXPECT_EQ(0U, drv.unknown);
+    EXPECT_TRUE(drv.lent.empty());
+}
+
+TEST_F(EthernetifZc, RefusedFrameIsReleased)
+{
+    input_err = ERR_MEM;
+    ASSERT_EQ(ERR_OK, tuya_ethernetif_rx_input(&netif, frame(4), FRAME_LEN, __free_cb, &drv));
+    EXPECT_EQ(1U, drv.released);
+}
+
+TEST_F(EthernetifZc, BadArgumentsKeepTheBuffer)
+{
+    uint8_t *buf = frame(5);
+
+    EXPECT_EQ(ERR_ARG, tuya_ethernetif_rx_input(NULL, buf, FRAME_LEN, __free_cb, &drv));
+    EXPECT_EQ(ERR_ARG, tuya_ethernetif_rx_input(&netif, NULL, FRAME_LEN, __free_cb, &drv));
+    EXPECT_EQ(ERR_ARG, tuya_ethernetif_rx_input(&netif, buf, 0, __free_cb, &drv));
+    EXPECT_EQ(ERR_ARG, tuya_ethernetif_rx_input(&netif, buf, FRAME_LEN, NULL, &drv));
+    EXPECT_EQ(0U, drv.released);
+    EXPECT_EQ(0U, stat().rx_pkts);
+    drv.lent.erase(buf);
+    free(buf);
+}
+
+TEST_F(EthernetifZc, TxSgListsTheNonEmptyPbufs)
+{
+    static uint8_t payload[FRAME_LEN - 54];
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, 54, PBUF_RAM);
+    struct pbuf *empty = pbuf_alloc(PBUF_RAW, 0, PBUF_RAM);
+    struct pbuf *ref = pbuf_alloc(PBUF_RAW, sizeof(payload), PBUF_REF);
+    TUYA_ETHERNETIF_SG_T sg[4];
+
+    ASSERT_NE(nullptr, p);
+    ASSERT_NE(nullptr, empty);
+    ASSERT_NE(nullptr, ref);
+    ref->payload = payload;
+    pbuf_cat(p, empty);
+    pbuf_cat(p, ref);
+
+    ASSERT_EQ(2, tuya_ethernetif_tx_sg(p, sg, 4));
+    EXPECT_EQ(p->payload, sg[0].buf);
+    EXPECT_EQ(54, sg[0].len);
+    EXPECT_EQ((void *)payload, sg[1].buf);
+    EXPECT_EQ(sizeof(payload), sg[1].len);
+
+    // the list does not fit, nothing is counted
+    EXPECT_EQ(-1, tuya_ethernetif_tx_sg(p, sg, 1));
+
+    TUYA_ETHERNETIF_ZC_STAT_T s = stat();
+    EXPECT_EQ(1U, s.tx_pkts);
+    EXPECT_EQ((uint32_t)FRAME_LEN, s.tx_bytes);
+    EXPECT_EQ(0U, s.tx_copy_bytes);
+    pbuf_free(p);
+}
+
+TEST_F(EthernetifZc, TxCopyFlattensTheChain)
+{
+    static uint8_t payload[FRAME_LEN - 54];
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, 54, PBUF_RAM);
+    struct pbuf *ref = pbuf_alloc(PBUF_RAW, sizeof(payload), PBUF_REF);
+    uint8_t out[1600];
+
+    ASSERT_NE(nullptr, p);
+    ASSERT_NE(nullptr, ref);
+    memset(p->payload, 0x11, 54);
+    memset(payload, 0x22, sizeof(payload));
+    ref->payload = payload;
+    pbuf_cat(p, ref);
+
+    EXPECT_EQ(-1, tuya_ethernetif_tx_copy(p, out, FRAME_LEN - 1));
+    ASSERT_EQ(FRAME_LEN, tuya_ethernetif_tx_copy(p, out, sizeof(out)));
+    EXPECT_EQ(0x11, out[53]);
+    EXPECT_EQ(0x22, out[54]);
+    EXPECT_EQ(0x22, out[FRAME_LEN - 1]);
+
+    TUYA_ETHERNETIF_ZC_STAT_T s = stat();
+    EXPECT_EQ(1U, s.tx_pkts);
+    EXPECT_EQ((uint32_t)FRAME_LEN, s.tx_copy_bytes);
+    pbuf_free(p);
+}
@@ -0,0 +1,129 @@
+/**
+ * @file test_sys_mbox_lf.cpp
+ * @brief UT of the lock-free mailbox of the lwIP sys_arch port.
+ *
+ * Producer threads post numbered messages and the test thread fetches them
+ * like tcpip_thread does. Every fetched message must be the next one of its
+ * producer, so a lost, duplicated or reordered message fails. The tiny
+ * mailbox of the stress keeps it full, the producers blocking on space and
+ * the consumer parking all the time.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "tuya_cloud_types.h"
+#include "tuya_error_code.h"
+#include "lwip/arch/sys_mbox_lf.h"
+}
+
+#define LOST_MS 1000 // a message not fetched by then is lost
+
+// a message is its producer in the high bits and its number in the low ones
+#define SEQ_BITS     24
+#define SEQ_MASK     ((1u << SEQ_BITS) - 1)
+#define MSG(id, seq) ((void *)(uintptr_t)(((id) << SEQ_BITS) | ((seq)&SEQ_MASK)))
+#define MSG_ID(msg)  ((uint32_t)(uintptr_t)(msg) >> SEQ_BITS)
+#define MSG_SEQ(msg) ((uint32_t)(uintptr_t)(msg)&SEQ_MASK)
+
+namespace {
+
+// posts msgs numbered messages from each of producers threads and checks them in
+void __stress(uint32_t size, uint32_t producers, uint32_t msgs)
+{
+    SYS_MBOX_LF_HANDLE mbox = NULL;
+    std::vector<std::thread> threads;
+    std::vector<uint32_t> next(producers, 0);
+    std::vector<OPERATE_RET> post_rt(producers, OPRT_OK);
+    void *msg = NULL;
+
+    ASSERT_EQ(OPRT_OK, sys_mbox_lf_create(&mbox, size));
+    for (uint32_t id = 0; id < producers; id++) {
+        threads.emplace_back([mbox, id, msgs, &post_rt]() {
+            for (uint32_t seq = 0; seq < msgs && OPRT_OK == post_rt[id]; seq++) {
+                post_rt[id] = sys_mbox_lf_post(mbox, MSG(id, seq));
+            }
+        });
+    }
+
+    for (uint32_t i = 0; i < producers * msgs; i++) {
+        ASSERT_EQ(OPRT_OK, sys_mbox_lf_fetch(mbox, &msg, LOST_MS)) << "lost after " << i << " messages";
+        uint32_t id = MSG_ID(msg);
+        ASSERT_LT(id, producers);
+        ASSERT_EQ(next[id] & SEQ_MASK, MSG_SEQ(msg)) << "producer " << id;
+        next[id]++;
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    for (uint32_t id = 0; id < producers; id++) {
+        EXPECT_EQ(OPRT_OK, post_rt[id]) << "producer " << id;
+        EXPECT_EQ(msgs, next[id]) << "producer " << id;
+    }
+    EXPECT_EQ(OPRT_RESOURCE_NOT_READY, sys_mbox_lf_tryfetch(mbox, &msg));
+    sys_mbox_lf_free(mbox);
+}
+
+} // namespace
+
+TEST(SysMboxLf, FullMailboxRefusesATrypost)
+{
+    SYS_MBOX_LF_HANDLE mbox = NULL;
+    void *msg = NULL;
+
+    // 3 rounds up to 4
+    ASSERT_EQ(OPRT_OK, sys_mbox_lf_create(&mbox, 3));
+    for (uintptr_t i = 0; i < 4; i++) {
+        ASSERT_EQ(OPRT_OK, sys_mbox_lf_trypost(mbox, (void *)i));
+    }
+    EXPECT_EQ(OPRT_EXCEED_UPPER_LIMIT, sys_mbox_lf_trypost(mbox, (void *)4));
+
+    for (uintptr_t i = 0; i < 4; i++) {
+        ASSERT_EQ(OPRT_OK, sys_mbox_lf_tryfetch(mbox, &msg));
+        EXPECT_EQ((void *)i, msg);
+    }
+    EXPECT_EQ(OPRT_RESOURCE_NOT_READY, sys_mbox_lf_tryfetch(mbox, &msg));
+    sys_mbox_lf_free(mbox);
+}
+
+TEST(SysMboxLf, EmptyFetchTimesOut)
+{
+    SYS_MBOX_LF_HANDLE mbox = NULL;
+    void *msg = NULL;
+
+    ASSERT_EQ(OPRT_OK, sys_mbox_lf_create(&mbox, 2));
+    EXPECT_EQ(OPRT_TIMEOUT, sys_mbox_lf_fetch(mbox, &msg, 20));
+
+    // a late post wakes the parked consumer
+    std::thread producer([mbox]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        sys_mbox_lf_post(mbox, MSG(1, 7));
+    });
+    EXPECT_EQ(OPRT_OK, sys_mbox_lf_fetch(mbox, &msg, SYS_MBOX_LF_WAIT_FOREVER));
+    EXPECT_EQ(MSG(1, 7), msg);
+    producer.join();
+    sys_mbox_lf_free(mbox);
+}
+
+TEST(SysMboxLf, OneProducerKeepsItsOrder)
+{
+    __stress(16, 1, 100000);
+}
+
+TEST(SysMboxLf, ProducersOnATinyMailboxLoseNothing)
+{
+    __stress(2, 16, 5000);
+}
+
+TEST(SysMboxLf, ProducersKeepTheirOrder)
+{
+    __stress(16, 4, 50000);
+}
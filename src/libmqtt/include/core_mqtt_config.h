@@ -36,7 +36,13 @@
 
 /**
  * @brief CORE_MQTT_BUFFER_SIZE
+ *
+ * Receive buffer of a client. Publishes that do not fit are streamed to the
+ * message callback in chunks of this buffer, it only needs to hold the other
+ * packets and the topic of a publish.
  */
+#ifndef CORE_MQTT_BUFFER_SIZE
 #define CORE_MQTT_BUFFER_SIZE (2048U)
+#endif
 
 #endif /* ifndef CORE_MQTT_CONFIG_H_ */
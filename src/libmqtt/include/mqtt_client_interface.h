@@ -33,13 +33,38 @@ typedef enum mqtt_cleint_qos {
     MQTT_QOS_2 = 2  /**< Delivery exactly once. */
 } mqtt_client_qos_t;
 
+/**
+ * @brief A received publish, or a chunk of it.
+ *
+ * A publish that fits in CORE_MQTT_BUFFER_SIZE comes whole: offset is 0 and
+ * length is total_length. A larger one is streamed, on_message gets its
+ * payload in order, one chunk per call, each with the same msgid and topic.
+ * A chunk is only valid during the call, and only until the handler sends a
+ * packet. A stream cut by a network error stops short of total_length, the
+ * connection is dropped with it. A payload over MQTT_MESSAGE_SIZE_MAX is
+ * acked and dropped without a call.
+ */
 typedef struct mqtt_client_message {
-    const char *topic;
+    const char *topic; // in the received packet, not NUL terminated
+    size_t topic_length;
     const uint8_t *payload;
     size_t length;
+    size_t offset;       // of this chunk in the payload
+    size_t total_length; // of the whole payload
     mqtt_client_qos_t qos;
 } mqtt_client_message_t;
 
+/**
+ * @brief Reassembles the chunks of streamed publishes for handlers that need
+ * the whole payload, see mqtt_client_message_collect.
+ */
+typedef struct {
+    uint8_t *buffer;
+    size_t length; // received so far
+    bool done;     // the last message returned is in buffer
+    mqtt_client_message_t message;
+} mqtt_client_collector_t;
+
 typedef struct {
     const uint8_t *cacert;
     size_t cacert_len;
@@ -79,4 +104,28 @@ uint16_t mqtt_client_unsubscribe(void *client, const char *topic, uint8_t qos);
 
 uint16_t mqtt_client_publish(void *client, const char *topic, const uint8_t *payload, size_t length, uint8_t qos);
 
+/**
+ * @brief Gives the whole publish a chunk belongs to, once it is complete.
+ *
+ * A whole message is returned as it is, without a copy. The chunks of a
+ * streamed one are copied to a buffer of the collector, NUL terminated, and
+ * the message is returned with its last chunk. That buffer is valid until the
+ * next call or mqtt_client_collector_reset. A chunk out of order drops the
+ * message.
+ *
+ * @param[in] collector the collector, zeroed before its first use
+ * @param[in] msg a message or a chunk, as given to on_message
+ *
+ * @return the whole message, NULL while chunks are missing
+ */
+const mqtt_client_message_t *mqtt_client_message_collect(mqtt_client_collector_t *collector,
+                                                         const mqtt_client_message_t *msg);
+
+/**
+ * @brief Frees the buffer of a collector.
+ *
+ * @param[in] collector the collector
+ */
+void mqtt_client_collector_reset(mqtt_client_collector_t *collector);
+
 #endif /* ifndef MQTT_CLIENT_INTERFACE_H */
@@ -13,10 +13,43 @@
 #define log_debug PR_DEBUG
 #define log_error PR_ERR
 
+/* room left for the payload next to the topic of a streamed publish */
+#define MQTT_STREAM_CHUNK_MIN 256
+
+/* largest publish payload given to on_message, larger ones are dropped */
+#ifndef MQTT_MESSAGE_SIZE_MAX
+#define MQTT_MESSAGE_SIZE_MAX (64 * 1024)
+#endif
+
+/*
+ * coreMQTT reads a packet whole into mqttbuffer and drops the ones that do
+ * not fit. Its reads go through mqtt_client_recv, which reads the fixed
+ * header of each packet first. A publish too large for the buffer has its
+ * payload streamed to on_message from here, in chunks read into the head of
+ * mqttbuffer with the topic kept at its tail, out of reach of the packets a
+ * handler sends meanwhile. coreMQTT then gets the same publish with a one
+ * byte topic and no payload, rebuilt from the qos and packet id kept in this
+ * state, and acks it as usual.
+ */
+typedef struct {
+    uint8_t fixed[5]; // fixed header of the current packet
+    uint8_t fixed_len;
+    uint8_t fixed_pos;
+    uint8_t replay[5]; // variable header given to coreMQTT for a streamed publish
+    uint8_t replay_len;
+    uint8_t replay_pos;
+    size_t pass_left; // bytes of the current packet read straight from the transport
+    bool streamed;    // the payload of the current publish went to on_message already
+    mqtt_client_qos_t qos;
+    uint16_t topic_len;
+    uint16_t msgid;
+} mqtt_client_rx_t;
+
 typedef struct {
     mqtt_client_config_t config;
     MQTTContext_t mqclient;
     tuya_transporter_t network;
+    mqtt_client_rx_t rx;
     uint8_t mqttbuffer[CORE_MQTT_BUFFER_SIZE];
 } mqtt_client_context_t;
 
@@ -31,26 +64,21 @@ static void core_mqtt_library_callback(struct MQTTContext *pContext, struct MQTT
      * type is used for the dup, QoS, and retain flags. Hence masking
      * out the lower bits to check if the packet is publish. */
     if ((pPacketInfo->type & 0xF0U) == MQTT_PACKET_TYPE_PUBLISH) {
-        if (context->config.on_message == NULL) {
+        if (context->config.on_message == NULL || context->rx.streamed) {
             return;
         }
 
-        char *topic = tal_malloc(pDeserializedInfo->pPublishInfo->topicNameLength + 1);
-        if (topic == NULL) {
-            return;
-        }
-        memcpy(topic, pDeserializedInfo->pPublishInfo->pTopicName, pDeserializedInfo->pPublishInfo->topicNameLength);
-        topic[pDeserializedInfo->pPublishInfo->topicNameLength] = '\0';
-
         context->config.on_message(context, msgid,
                                    &(const mqtt_client_message_t){
-                                       .topic = topic,
+                                       .topic = pDeserializedInfo->pPublishInfo->pTopicName,
+                                       .topic_length = pDeserializedInfo->pPublishInfo->topicNameLength,
                                        .payload = pDeserializedInfo->pPublishInfo->pPayload,
                                        .length = pDeserializedInfo->pPublishInfo->payloadLength,
+                                       .offset = 0,
+                                       .total_length = pDeserializedInfo->pPublishInfo->payloadLength,
                                        .qos = pDeserializedInfo->pPublishInfo->qos,
                                    },
                                    context->config.userdata);
-        tal_free(topic);
 
     } else {
         switch (pPacketInfo->type) {
@@ -117,6 +145,214 @@ static int network_read(NetworkContext_t *pNetwork, unsigned char *pMsg, size_t
     return result;
 }
 
+static int network_read_exact(NetworkContext_t *pNetwork, uint8_t *buf, size_t len)
+{
+    size_t got = 0;
+    int result = 0;
+
+    while (got < len) {
+        result = network_read(pNetwork, buf + got, len - got);
+        if (result <= 0) {
+            return -1;
+        }
+        got += result;
+    }
+
+    return (int)got;
+}
+
+static uint8_t mqtt_remaining_length_encode(uint8_t *buf, size_t length)
+{
+    uint8_t n = 0;
+
+    do {
+        buf[n] = length % 128;
+        length /= 128;
+        if (length) {
+            buf[n] |= 0x80;
+        }
+        n++;
+    } while (length);
+
+    return n;
+}
+
+static int mqtt_client_discard(mqtt_client_context_t *context, size_t length)
+{
+    size_t n;
+
+    for (; length; length -= n) {
+        n = (length < CORE_MQTT_BUFFER_SIZE) ? length : CORE_MQTT_BUFFER_SIZE;
+        if (network_read_exact(&context->network, context->mqttbuffer, n) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// a publish of the qos and packet id of the streamed one, its payload is gone already
+static void mqtt_client_replay_build(mqtt_client_rx_t *rx)
+{
+    rx->replay[0] = 0;
+    rx->replay[1] = 1;
+    rx->replay[2] = '/';
+    rx->replay_len = 3;
+    if (rx->qos > MQTT_QOS_0) {
+        rx->replay[rx->replay_len++] = rx->msgid >> 8;
+        rx->replay[rx->replay_len++] = rx->msgid & 0xFF;
+    }
+    rx->fixed_len = 1 + mqtt_remaining_length_encode(&rx->fixed[1], rx->replay_len);
+    rx->streamed = true;
+}
+
+static int mqtt_client_publish_stream(mqtt_client_context_t *context, size_t remaining)
+{
+    mqtt_client_rx_t *rx = &context->rx;
+    uint8_t *buf = context->mqttbuffer;
+    uint8_t *topic = NULL;
+    uint8_t head[2];
+    size_t var_len, n;
+
+    rx->qos = (mqtt_client_qos_t)((rx->fixed[0] >> 1) & 0x03);
+    if (network_read_exact(&context->network, head, 2) < 0) {
+        return -1;
+    }
+    rx->topic_len = ((uint16_t)head[0] << 8) | head[1];
+    var_len = 2 + rx->topic_len + ((rx->qos > MQTT_QOS_0) ? 2 : 0);
+    if (var_len > remaining) {
+        log_error("bad publish, topic of %d bytes", (int)rx->topic_len);
+        return -1;
+    }
+    if (var_len + MQTT_STREAM_CHUNK_MIN > CORE_MQTT_BUFFER_SIZE) {
+        // no room for the topic, dropped unacked like coreMQTT does
+        log_error("publish dropped, topic of %d bytes", (int)rx->topic_len);
+        if (mqtt_client_discard(context, remaining - 2) < 0) {
+            return -1;
+        }
+        rx->fixed_len = 0;
+        return 0;
+    }
+    topic = buf + CORE_MQTT_BUFFER_SIZE - rx->topic_len;
+    if (network_read_exact(&context->network, topic, rx->topic_len) < 0) {
+        return -1;
+    }
+    if (rx->qos > MQTT_QOS_0) {
+        if (network_read_exact(&context->network, head, 2) < 0) {
+            return -1;
+        }
+        rx->msgid = ((uint16_t)head[0] << 8) | head[1];
+    }
+
+    mqtt_client_message_t msg = {
+        .topic = (const char *)topic,
+        .topic_length = rx->topic_len,
+        .payload = buf,
+        .total_length = remaining - var_len,
+        .qos = rx->qos,
+    };
+    if (msg.total_length > MQTT_MESSAGE_SIZE_MAX) {
+        // acked all the same, the broker would only send it again
+        log_error("publish of %d bytes dropped, over %d", (int)msg.total_length, MQTT_MESSAGE_SIZE_MAX);
+        if (mqtt_client_discard(context, msg.total_length) < 0) {
+            return -1;
+        }
+        mqtt_client_replay_build(rx);
+        return 1;
+    }
+
+    for (msg.offset = 0; msg.offset < msg.total_length; msg.offset += n) {
+        n = msg.total_length - msg.offset;
+        if (n > CORE_MQTT_BUFFER_SIZE - rx->topic_len) {
+            n = CORE_MQTT_BUFFER_SIZE - rx->topic_len;
+        }
+        if (network_read_exact(&context->network, buf, n) < 0) {
+            return -1;
+        }
+        msg.length = n;
+        if (context->config.on_message) {
+            context->config.on_message(context, rx->msgid, &msg, context->config.userdata);
+        }
+    }
+    mqtt_client_replay_build(rx);
+
+    return 1;
+}
+
+// reads the fixed header of the next packet, 0 when there is none
+static int mqtt_client_packet_start(mqtt_client_context_t *context)
+{
+    mqtt_client_rx_t *rx = &context->rx;
+    size_t remaining = 0, multiplier = 1;
+    uint8_t i;
+    int result;
+
+    memset(rx, 0, sizeof(mqtt_client_rx_t));
+    result = network_read(&context->network, rx->fixed, 1);
+    if (result <= 0) {
+        return result;
+    }
+
+    for (i = 1;; i++) {
+        if (i == sizeof(rx->fixed) || network_read_exact(&context->network, &rx->fixed[i], 1) < 0) {
+            return -1;
+        }
+        remaining += (rx->fixed[i] & 0x7F) * multiplier;
+        multiplier *= 128;
+        if ((rx->fixed[i] & 0x80) == 0) {
+            break;
+        }
+    }
+    rx->fixed_len = i + 1;
+
+    if ((rx->fixed[0] & 0xF0U) != MQTT_PACKET_TYPE_PUBLISH || remaining <= CORE_MQTT_BUFFER_SIZE) {
+        rx->pass_left = remaining;
+        return 1;
+    }
+
+    return mqtt_client_publish_stream(context, remaining);
+}
+
+static int mqtt_client_recv(NetworkContext_t *pNetwork, unsigned char *pMsg, size_t len)
+{
+    mqtt_client_context_t *context =
+        (mqtt_client_context_t *)((uint8_t *)pNetwork - offsetof(mqtt_client_context_t, network));
+    mqtt_client_rx_t *rx = &context->rx;
+    size_t n;
+    int result;
+
+    for (;;) {
+        if (rx->fixed_pos < rx->fixed_len) {
+            n = rx->fixed_len - rx->fixed_pos;
+            n = (len < n) ? len : n;
+            memcpy(pMsg, &rx->fixed[rx->fixed_pos], n);
+            rx->fixed_pos += n;
+            return (int)n;
+        }
+
+        if (rx->replay_pos < rx->replay_len) {
+            n = rx->replay_len - rx->replay_pos;
+            n = (len < n) ? len : n;
+            memcpy(pMsg, &rx->replay[rx->replay_pos], n);
+            rx->replay_pos += n;
+            return (int)n;
+        }
+
+        if (rx->pass_left) {
+            result = network_read(pNetwork, pMsg, (len < rx->pass_left) ? len : rx->pass_left);
+            if (result > 0) {
+                rx->pass_left -= result;
+            }
+            return result;
+        }
+
+        result = mqtt_client_packet_start(context);
+        if (result <= 0) {
+            return result;
+        }
+    }
+}
+
 mqtt_client_status_t mqtt_client_init(void *client, const mqtt_client_config_t *config)
 {
     mqtt_client_context_t *context = (mqtt_client_context_t *)client;
@@ -156,7 +392,7 @@ mqtt_client_status_t mqtt_client_init(void *client, const mqtt_client_config_t *
     TransportInterface_t transport;
     transport.pNetworkContext = &context->network;
     transport.send = (TransportSend_t)network_write;
-    transport.recv = (TransportRecv_t)network_read;
+    transport.recv = (TransportRecv_t)mqtt_client_recv;
 
     /* Fill the values for network buffer. */
     MQTTFixedBuffer_t network_buffer;
@@ -200,6 +436,9 @@ mqtt_client_status_t mqtt_client_connect(void *client)
 
     bool pSessionPresent = false;
 
+    /* a new connection starts on a packet boundary */
+    memset(&context->rx, 0, sizeof(mqtt_client_rx_t));
+
     /* Send MQTT CONNECT packet to broker. */
     mqtt_status = MQTT_Connect(&context->mqclient,
                                &(const MQTTConnectInfo_t){.cleanSession = true,
@@ -317,4 +556,67 @@ mqtt_client_status_t mqtt_client_yield(void *client)
         return MQTT_STATUS_NETWORK_TIMEOUT;
     }
     return MQTT_STATUS_SUCCESS;
-}
\ No newline at end of file
+}
+
+const mqtt_client_message_t *mqtt_client_message_collect(mqtt_client_collector_t *collector,
+                                                         const mqtt_client_message_t *msg)
+{
+    if (collector == NULL || msg == NULL) {
+        return NULL;
+    }
+
+    if (collector->done) {
+        mqtt_client_collector_reset(collector);
+    }
+
+    if (msg->offset == 0 && msg->length == msg->total_length) {
+        mqtt_client_collector_reset(collector);
+        return msg;
+    }
+
+    if (msg->offset == 0) {
+        mqtt_client_collector_reset(collector);
+        if (msg->total_length > MQTT_MESSAGE_SIZE_MAX) {
+            log_error("publish of %d bytes refused, over %d", (int)msg->total_length, MQTT_MESSAGE_SIZE_MAX);
+            return NULL;
+        }
+        collector->buffer = tal_malloc(msg->total_length + 1);
+        if (collector->buffer == NULL) {
+            log_error("no memory for a publish of %d bytes", (int)msg->total_length);
+            return NULL;
+        }
+    } else if (collector->buffer == NULL || msg->offset != collector->length ||
+               msg->total_length != collector->message.total_length) {
+        mqtt_client_collector_reset(collector);
+        return NULL;
+    }
+
+    if (msg->length > msg->total_length - msg->offset) {
+        mqtt_client_collector_reset(collector);
+        return NULL;
+    }
+    memcpy(collector->buffer + msg->offset, msg->payload, msg->length);
+    collector->length = msg->offset + msg->length;
+    collector->message = *msg;
+    if (collector->length < msg->total_length) {
+        return NULL;
+    }
+
+    collector->buffer[collector->length] = '\0';
+    collector->message.payload = collector->buffer;
+    collector->message.length = collector->length;
+    collector->message.offset = 0;
+    collector->done = true;
+
+    return &collector->message;
+}
+
+void mqtt_client_collector_reset(mqtt_client_collector_t *collector)
+{
+    if (collector == NULL) {
+        return;
+    }
+
+    tal_free(collector->buffer);
+    memset(collector, 0, sizeof(mqtt_client_collector_t));
+}
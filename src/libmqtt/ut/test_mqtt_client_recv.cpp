@@ -0,0 +1,404 @@
+/**
+ * @file test_mqtt_client_recv.cpp
+ * @brief UT of the MQTT client receiving publishes larger than its buffer.
+ *
+ * The transporter is faked here: the broker is a feed of packets read in
+ * small pieces and everything the client sends is kept. The client has its
+ * default CORE_MQTT_BUFFER_SIZE, so a 64 KB publish is streamed to on_message
+ * in chunks, each compared in place and reassembled with
+ * mqtt_client_message_collect. A handler may publish while a stream is
+ * received, the way the matop and protocol handlers answer, which must leave
+ * the topic of the next chunks and the ack of the publish as they were.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "tuya_cloud_types.h"
+#include "tuya_error_code.h"
+#include "tuya_transporter.h"
+#include "tuya_tls.h"
+#include "core_mqtt_config.h"
+#include "mqtt_client_interface.h"
+}
+
+#define READ_MAX    700 // bytes the broker gives per read
+#define YIELD_MS    5
+#define YIELD_MAX   100
+#define BIG_LEN     (64 * 1024)
+#define QOS0_LEN    10000
+#define LONG_TOPIC  1900 // leaves no room for a chunk
+#define REPLY_TOPIC "reply/a/topic/longer/than/the/one/of/the/publish/being/received/so/its/header/reaches/past/it"
+
+namespace {
+
+struct Broker {
+    std::vector<uint8_t> feed;
+    size_t pos = 0;
+    std::vector<uint8_t> sent;
+};
+
+struct Seen {
+    std::string topic;
+    uint16_t msgid;
+    std::vector<uint8_t> payload;
+    uint32_t chunks;
+};
+
+struct Sent {
+    uint8_t type;
+    uint16_t msgid; // of a PUBACK
+};
+
+Broker sg_broker;
+uint8_t sg_transporter; // only its address is used
+
+std::vector<Seen> sg_seen;
+std::string sg_topic; // of the message being received
+uint32_t sg_chunks;
+uint32_t sg_bad;
+bool sg_reply;
+uint32_t sg_replies;
+mqtt_client_collector_t sg_collector;
+
+std::vector<uint8_t> __payload(size_t len, uint8_t seed)
+{
+    std::vector<uint8_t> p(len);
+
+    for (size_t i = 0; i < len; i++) {
+        p[i] = (uint8_t)(i * 7 + seed + (i >> 8));
+    }
+    return p;
+}
+
+void __publish_feed(const std::string &topic, uint8_t qos, uint16_t msgid, const std::vector<uint8_t> &payload)
+{
+    std::vector<uint8_t> &f = sg_broker.feed;
+    size_t remaining = 2 + topic.size() + (qos ? 2 : 0) + payload.size();
+
+    f.push_back(0x30 | (qos << 1));
+    do {
+        f.push_back((remaining % 128) | ((remaining >= 128) ? 0x80 : 0));
+        remaining /= 128;
+    } while (remaining);
+    f.push_back(topic.size() >> 8);
+    f.push_back(topic.size() & 0xFF);
+    f.insert(f.end(), topic.begin(), topic.end());
+    if (qos) {
+        f.push_back(msgid >> 8);
+        f.push_back(msgid & 0xFF);
+    }
+    f.insert(f.end(), payload.begin(), payload.end());
+}
+
+std::vector<Sent> __sent_parse(void)
+{
+    const std::vector<uint8_t> &s = sg_broker.sent;
+    std::vector<Sent> packets;
+    size_t pos = 0;
+
+    while (pos < s.size()) {
+        size_t remaining = 0, shift = 0, n = pos + 1;
+        Sent p = {(uint8_t)(s[pos] & 0xF0), 0};
+
+        do {
+            remaining |= (size_t)(s[n] & 0x7F) << shift;
+            shift += 7;
+        } while (s[n++] & 0x80);
+        if (0x40 == p.type) {
+            p.msgid = ((uint16_t)s[n] << 8) | s[n + 1];
+        }
+        packets.push_back(p);
+        pos = n + remaining;
+    }
+    return packets;
+}
+
+std::vector<uint16_t> __acks(void)
+{
+    std::vector<uint16_t> ids;
+
+    for (const Sent &p : __sent_parse()) {
+        if (0x40 == p.type) {
+            ids.push_back(p.msgid);
+        }
+    }
+    return ids;
+}
+
+void __on_message(void *client, uint16_t msgid, const mqtt_client_message_t *msg, void *userdata)
+{
+    std::string topic(msg->topic, msg->topic_length);
+    const mqtt_client_message_t *whole = NULL;
+
+    // every chunk of a publish has its topic
+    if (0 == msg->offset) {
+        sg_topic = topic;
+        sg_chunks = 0;
+    } else if (topic != sg_topic) {
+        sg_bad++;
+    }
+    if (msg->length > CORE_MQTT_BUFFER_SIZE || msg->offset + msg->length > msg->total_length) {
+        sg_bad++;
+    }
+    sg_chunks++;
+
+    whole = mqtt_client_message_collect(&sg_collector, msg);
+    if (whole) {
+        sg_seen.push_back({sg_topic, msgid, std::vector<uint8_t>(whole->payload, whole->payload + whole->length),
+                           sg_chunks});
+    }
+
+    // an answer sent from the handler goes through the buffer of the client,
+    // the chunk is not read after it
+    if (sg_reply) {
+        std::vector<uint8_t> reply = __payload(64, 9);
+
+        mqtt_client_publish(client, REPLY_TOPIC, reply.data(), reply.size(), 0);
+        sg_replies++;
+    }
+}
+
+uint32_t __chunks_of(const std::string &topic, size_t len)
+{
+    size_t room = CORE_MQTT_BUFFER_SIZE - topic.size();
+
+    return (len <= CORE_MQTT_BUFFER_SIZE) ? 1 : (uint32_t)((len + room - 1) / room);
+}
+
+class MqttClientRecv : public ::testing::Test {
+  protected:
+    void *client = NULL;
+
+    void SetUp() override
+    {
+        mqtt_client_config_t config = {};
+        static const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+
+        sg_broker = Broker();
+        sg_broker.feed.assign(connack, connack + sizeof(connack));
+        sg_seen.clear();
+        sg_bad = 0;
+        sg_reply = false;
+        sg_replies = 0;
+
+        config.host = "broker";
+        config.port = 1883;
+        config.keepalive = 60;
+        config.timeout_ms = YIELD_MS;
+        config.clientid = "ut";
+        config.username = "ut";
+        config.password = "ut";
+        config.on_message = __on_message;
+        client = mqtt_client_new();
+        ASSERT_NE(nullptr, client);
+        ASSERT_EQ(MQTT_STATUS_SUCCESS, mqtt_client_init(client, &config));
+        ASSERT_EQ(MQTT_STATUS_SUCCESS, mqtt_client_connect(client));
+        sg_broker.sent.clear();
+    }
+
+    void TearDown() override
+    {
+        mqtt_client_disconnect(client);
+        mqtt_client_deinit(client);
+        mqtt_client_free(client);
+        mqtt_client_collector_reset(&sg_collector);
+    }
+
+    // yields until the client has read everything the broker sent
+    void run()
+    {
+        for (int i = 0; i < YIELD_MAX && sg_broker.pos < sg_broker.feed.size(); i++) {
+            ASSERT_EQ(MQTT_STATUS_SUCCESS, mqtt_client_yield(client));
+        }
+        ASSERT_EQ(sg_broker.feed.size(), sg_broker.pos);
+        EXPECT_EQ(0U, sg_bad);
+    }
+};
+
+} // namespace
+
+/* The transporter of the client */
+extern "C" {
+
+tuya_transporter_t tuya_transporter_create(TUYA_TRANSPORT_TYPE_E transport_type, tuya_transporter_t dependency)
+{
+    (void)dependency;
+    return (TRANSPORT_TYPE_TCP == transport_type) ? (tuya_transporter_t)&sg_transporter : NULL;
+}
+
+OPERATE_RET tuya_transporter_destroy(tuya_transporter_t transporter)
+{
+    (void)transporter;
+    return OPRT_OK;
+}
+
+OPERATE_RET tuya_transporter_connect(tuya_transporter_t transporter, const char *host, int port, int timeout_ms)
+{
+    (void)transporter;
+    (void)host;
+    (void)port;
+    (void)timeout_ms;
+    return OPRT_OK;
+}
+
+OPERATE_RET tuya_transporter_close(tuya_transporter_t transporter)
+{
+    (void)transporter;
+    return OPRT_OK;
+}
+
+OPERATE_RET tuya_transporter_read(tuya_transporter_t transporter, uint8_t *buf, int len, int timeout_ms)
+{
+    size_t n = sg_broker.feed.size() - sg_broker.pos;
+
+    (void)transporter;
+    (void)timeout_ms;
+    if (0 == n) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+    n = (n < (size_t)len) ? n : (size_t)len;
+    n = (n < READ_MAX) ? n : READ_MAX;
+    memcpy(buf, sg_broker.feed.data() + sg_broker.pos, n);
+    sg_broker.pos += n;
+    return (OPERATE_RET)n;
+}
+
+OPERATE_RET tuya_transporter_write(tuya_transporter_t transporter, uint8_t *buf, int len, int timeout_ms)
+{
+    (void)transporter;
+    (void)timeout_ms;
+    sg_broker.sent.insert(sg_broker.sent.end(), buf, buf + len);
+    return len;
+}
+
+OPERATE_RET tuya_transporter_ctrl(tuya_transporter_t transporter, uint32_t cmd, void *args)
+{
+    (void)transporter;
+    if (TUYA_TRANSPORTER_GET_TLS_CONFIG == cmd) {
+        *(tuya_tls_config_t **)args = NULL;
+    }
+    return OPRT_OK;
+}
+
+} // extern "C"
+
+TEST_F(MqttClientRecv, SmallPublishComesWhole)
+{
+    std::vector<uint8_t> payload = __payload(100, 1);
+
+    __publish_feed("ut/small", 0, 0, payload);
+    run();
+
+    ASSERT_EQ(1U, sg_seen.size());
+    EXPECT_EQ("ut/small", sg_seen[0].topic);
+    EXPECT_EQ(1U, sg_seen[0].chunks);
+    EXPECT_TRUE(payload == sg_seen[0].payload);
+}
+
+TEST_F(MqttClientRecv, LargePublishReassemblesThroughTheBuffer)
+{
+    std::vector<uint8_t> big = __payload(BIG_LEN, 2), qos0 = __payload(QOS0_LEN, 3), small = __payload(10, 4);
+
+    __publish_feed("ut/big", 1, 7, big);
+    __publish_feed("ut/qos0", 0, 0, qos0);
+    __publish_feed("ut/small", 1, 8, small);
+    run();
+
+    ASSERT_EQ(3U, sg_seen.size());
+    EXPECT_EQ("ut/big", sg_seen[0].topic);
+    EXPECT_EQ(7, sg_seen[0].msgid);
+    EXPECT_EQ(__chunks_of("ut/big", BIG_LEN), sg_seen[0].chunks);
+    EXPECT_TRUE(big == sg_seen[0].payload);
+    EXPECT_EQ("ut/qos0", sg_seen[1].topic);
+    EXPECT_EQ(__chunks_of("ut/qos0", QOS0_LEN), sg_seen[1].chunks);
+    EXPECT_TRUE(qos0 == sg_seen[1].payload);
+    EXPECT_EQ("ut/small", sg_seen[2].topic);
+    EXPECT_TRUE(small == sg_seen[2].payload);
+
+    // the streamed publish is acked like the whole one
+    EXPECT_EQ((std::vector<uint16_t>{7, 8}), __acks());
+}
+
+TEST_F(MqttClientRecv, HandlerPublishingDuringReceive)
+{
+    std::vector<uint8_t> big = __payload(BIG_LEN, 5), small = __payload(10, 6);
+
+    sg_reply = true;
+    __publish_feed("ut/big", 1, 9, big);
+    __publish_feed("ut/small", 1, 10, small);
+    run();
+
+    ASSERT_EQ(2U, sg_seen.size());
+    EXPECT_EQ("ut/big", sg_seen[0].topic);
+    EXPECT_EQ(9, sg_seen[0].msgid);
+    EXPECT_TRUE(big == sg_seen[0].payload);
+    EXPECT_EQ("ut/small", sg_seen[1].topic);
+    EXPECT_TRUE(small == sg_seen[1].payload);
+    EXPECT_EQ(sg_seen[0].chunks + sg_seen[1].chunks, sg_replies);
+
+    uint32_t publishes = 0;
+    for (const Sent &p : __sent_parse()) {
+        publishes += (0x30 == p.type) ? 1 : 0;
+    }
+    EXPECT_EQ(sg_replies, publishes);
+    EXPECT_EQ((std::vector<uint16_t>{9, 10}), __acks());
+}
+
+TEST_F(MqttClientRecv, OversizedPublishIsAckedAndDropped)
+{
+    std::vector<uint8_t> over = __payload(MQTT_MESSAGE_SIZE_MAX + 1, 7), small = __payload(10, 8);
+
+    __publish_feed("ut/over", 1, 11, over);
+    __publish_feed("ut/small", 1, 12, small);
+    run();
+
+    ASSERT_EQ(1U, sg_seen.size());
+    EXPECT_EQ("ut/small", sg_seen[0].topic);
+    EXPECT_EQ(1U, sg_seen[0].chunks);
+    EXPECT_EQ((std::vector<uint16_t>{11, 12}), __acks());
+}
+
+TEST_F(MqttClientRecv, TopicLeavingNoRoomIsDroppedUnacked)
+{
+    std::vector<uint8_t> payload = __payload(2 * CORE_MQTT_BUFFER_SIZE, 9), small = __payload(10, 10);
+
+    __publish_feed(std::string(LONG_TOPIC, 'x'), 1, 13, payload);
+    __publish_feed("ut/small", 1, 14, small);
+    run();
+
+    ASSERT_EQ(1U, sg_seen.size());
+    EXPECT_EQ("ut/small", sg_seen[0].topic);
+    EXPECT_EQ((std::vector<uint16_t>{14}), __acks());
+}
+
+TEST(MqttClientCollect, MessageOverTheCapIsRefused)
+{
+    mqtt_client_collector_t collector = {};
+    std::vector<uint8_t> chunk = __payload(100, 11);
+    mqtt_client_message_t msg = {};
+
+    msg.topic = "ut/over";
+    msg.topic_length = 7;
+    msg.payload = chunk.data();
+    msg.length = chunk.size();
+    msg.total_length = MQTT_MESSAGE_SIZE_MAX + 1;
+    EXPECT_EQ(nullptr, mqtt_client_message_collect(&collector, &msg));
+    EXPECT_EQ(nullptr, collector.buffer);
+
+    // a smaller one is reassembled
+    msg.total_length = 2 * chunk.size();
+    EXPECT_EQ(nullptr, mqtt_client_message_collect(&collector, &msg));
+    msg.offset = chunk.size();
+    const mqtt_client_message_t *whole = mqtt_client_message_collect(&collector, &msg);
+    ASSERT_NE(nullptr, whole);
+    EXPECT_EQ(2 * chunk.size(), whole->length);
+    mqtt_client_collector_reset(&collector);
+}
@@ -5,189 +5,393 @@
  *        for different kinds of encoders used in the system, enabling accurate
  *        position and speed feedback.
  *
+ * The interrupt of a channel reads both of them, steps the decoder and posts
+ * the semaphore of the task. The decoder of an encoder is only written there,
+ * the task and the getters read its counts without a lock. While a knob turns
+ * or a button settles, the task samples every ENCODER_SAMPLE_MS, otherwise it
+ * waits for the next interrupt.
+ *
  * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
  *
  */
+#include <string.h>
 #include "drv_encoder.h"
 
-static int32_t encode_angle = 0;
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#ifndef ENCODER_STEPS_PER_DETENT
+#define ENCODER_STEPS_PER_DETENT 4
+#endif
+
+/* sample period of the speed and the button while they change */
+#ifndef ENCODER_SAMPLE_MS
+#define ENCODER_SAMPLE_MS 10
+#endif
+
+/* time the button level must hold before it counts */
+#ifndef ENCODER_DEBOUNCE_MS
+#define ENCODER_DEBOUNCE_MS 20
+#endif
+
+#ifndef ENCODER_STACK_SIZE
+#define ENCODER_STACK_SIZE 2048
+#endif
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct encoder_dev {
+    struct encoder_dev *next;
+    ENCODER_CFG_T cfg;
+    encoder_quad_t quad; // written by the interrupts only
+    encoder_velocity_t vel;
+    int32_t position; // of the last event
+    uint8_t raw;      // button level of the last sample, 1 pressed
+    uint8_t pressed;  // debounced
+    uint32_t raw_ms;  // since raw holds
+} ENCODER_DEV_T;
+
+typedef struct {
+    SEM_HANDLE sem;
+    MUTEX_HANDLE mutex;
+    THREAD_HANDLE thread;
+    ENCODER_DEV_T *list;
+} ENCODER_SERVICE_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static ENCODER_SERVICE_T sg_encoder;
+static ENCODER_HANDLE sg_default;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static uint8_t __encoder_ab_read(ENCODER_DEV_T *dev)
+{
+    TUYA_GPIO_LEVEL_E a_level = TUYA_GPIO_LEVEL_HIGH;
+    TUYA_GPIO_LEVEL_E b_level = TUYA_GPIO_LEVEL_HIGH;
+
+    tkl_gpio_read(dev->cfg.pin_a, &a_level);
+    tkl_gpio_read(dev->cfg.pin_b, &b_level);
+
+    return ((a_level == TUYA_GPIO_LEVEL_HIGH) ? 0x02 : 0) | ((b_level == TUYA_GPIO_LEVEL_HIGH) ? 0x01 : 0);
+}
+
+static uint8_t __encoder_button_read(ENCODER_DEV_T *dev)
+{
+    TUYA_GPIO_LEVEL_E level = TUYA_GPIO_LEVEL_HIGH;
+
+    if (dev->cfg.pin_p >= TUYA_GPIO_NUM_MAX) {
+        return 0;
+    }
+    tkl_gpio_read(dev->cfg.pin_p, &level);
+
+    return (level == TUYA_GPIO_LEVEL_LOW) ? 1 : 0;
+}
+
+static void __encoder_ab_irq_cb(void *args)
+{
+    ENCODER_DEV_T *dev = (ENCODER_DEV_T *)args;
+
+    encoder_quad_edge(&dev->quad, __encoder_ab_read(dev));
+    tal_semaphore_post(sg_encoder.sem);
+}
+
+static void __encoder_p_irq_cb(void *args)
+{
+    tal_semaphore_post(sg_encoder.sem);
+}
+
+// publishes what changed since the last sample, true while a sample is due
+static bool __encoder_sample(ENCODER_DEV_T *dev, uint32_t now_ms)
+{
+    volatile encoder_quad_t *quad = &dev->quad;
+    int32_t position = quad->detents;
+    uint8_t raw;
+
+    encoder_velocity_update(&dev->vel, quad->steps, now_ms);
+    if (position != dev->position) {
+        ENCODER_ROTATE_EVT_T evt = {
+            .handle = dev,
+            .delta = position - dev->position,
+            .position = position,
+            .velocity = dev->vel.velocity,
+            .acceleration = dev->vel.acceleration,
+        };
+        dev->position = position;
+        tal_event_publish(EVENT_ENCODER_ROTATE, &evt);
+    }
 
-static SEM_HANDLE example_sem_hdl = NULL;
-static THREAD_HANDLE wait_thrd_hdl = NULL;
-static MUTEX_HANDLE mutex_hdl = NULL;
+    raw = __encoder_button_read(dev);
+    if (raw != dev->raw) {
+        dev->raw = raw;
+        dev->raw_ms = now_ms;
+    } else if (raw != dev->pressed && now_ms - dev->raw_ms >= ENCODER_DEBOUNCE_MS) {
+        ENCODER_PRESS_EVT_T evt = {
+            .handle = dev,
+            .pressed = raw,
+        };
+        dev->pressed = raw;
+        tal_event_publish(EVENT_ENCODER_PRESS, &evt);
+    }
+
+    return dev->vel.velocity || dev->vel.acceleration || dev->raw != dev->pressed;
+}
+
+static void __encoder_task(void *args)
+{
+    ENCODER_DEV_T *dev = NULL;
+    bool active = false;
+    uint32_t now_ms;
+
+    for (;;) {
+        tal_semaphore_wait(sg_encoder.sem, active ? ENCODER_SAMPLE_MS : SEM_WAIT_FOREVER);
+        now_ms = (uint32_t)tal_system_get_millisecond();
+
+        active = false;
+        tal_mutex_lock(sg_encoder.mutex);
+        for (dev = sg_encoder.list; dev; dev = dev->next) {
+            active |= __encoder_sample(dev, now_ms);
+        }
+        tal_mutex_unlock(sg_encoder.mutex);
+    }
+}
 
-static void __gpio_irq_callback(void *args)
+static OPERATE_RET __encoder_service_start(void)
 {
-    uint8_t pin_id = (uint8_t)args;
+    OPERATE_RET rt = OPRT_OK;
+    THREAD_CFG_T param;
+
+    if (sg_encoder.thread) {
+        return OPRT_OK;
+    }
+
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&sg_encoder.sem, 0, 1), __exit);
+    TUYA_CALL_ERR_GOTO(tal_mutex_create_init(&sg_encoder.mutex), __exit);
+
+    param.priority = THREAD_PRIO_2;
+    param.stackDepth = ENCODER_STACK_SIZE;
+    param.thrdname = "encoder";
+    TUYA_CALL_ERR_GOTO(tal_thread_create_and_start(&sg_encoder.thread, NULL, NULL, __encoder_task, NULL, &param),
+                       __exit);
+
+    return OPRT_OK;
 
-    tal_semaphore_post(example_sem_hdl);
+__exit:
+    if (sg_encoder.mutex) {
+        tal_mutex_release(sg_encoder.mutex);
+        sg_encoder.mutex = NULL;
+    }
+    if (sg_encoder.sem) {
+        tal_semaphore_release(sg_encoder.sem);
+        sg_encoder.sem = NULL;
+    }
+    sg_encoder.thread = NULL;
+
+    return rt;
+}
+
+static void __encoder_irq_deinit(ENCODER_DEV_T *dev)
+{
+    tkl_gpio_irq_disable(dev->cfg.pin_a);
+    tkl_gpio_irq_disable(dev->cfg.pin_b);
+    if (dev->cfg.pin_p < TUYA_GPIO_NUM_MAX) {
+        tkl_gpio_irq_disable(dev->cfg.pin_p);
+    }
+}
+
+static OPERATE_RET __encoder_irq_init(ENCODER_DEV_T *dev)
+{
+    OPERATE_RET rt = OPRT_OK;
+    TUYA_GPIO_BASE_CFG_T in_pin_cfg = {
+        .mode = TUYA_GPIO_PULLUP,
+        .direct = TUYA_GPIO_INPUT,
+    };
+    TUYA_GPIO_IRQ_T irq_cfg = {
+        .cb = __encoder_ab_irq_cb,
+        .arg = dev,
+        .mode = TUYA_GPIO_IRQ_RISE_FALL,
+    };
+
+    TUYA_CALL_ERR_RETURN(tkl_gpio_init(dev->cfg.pin_a, &in_pin_cfg));
+    TUYA_CALL_ERR_RETURN(tkl_gpio_init(dev->cfg.pin_b, &in_pin_cfg));
+    encoder_quad_reset(&dev->quad, __encoder_ab_read(dev), dev->cfg.steps_per_detent);
+
+    TUYA_CALL_ERR_RETURN(tkl_gpio_irq_init(dev->cfg.pin_a, &irq_cfg));
+    TUYA_CALL_ERR_RETURN(tkl_gpio_irq_init(dev->cfg.pin_b, &irq_cfg));
+    if (dev->cfg.pin_p < TUYA_GPIO_NUM_MAX) {
+        TUYA_CALL_ERR_RETURN(tkl_gpio_init(dev->cfg.pin_p, &in_pin_cfg));
+        irq_cfg.cb = __encoder_p_irq_cb;
+        TUYA_CALL_ERR_RETURN(tkl_gpio_irq_init(dev->cfg.pin_p, &irq_cfg));
+    }
+
+    TUYA_CALL_ERR_RETURN(tkl_gpio_irq_enable(dev->cfg.pin_a));
+    TUYA_CALL_ERR_RETURN(tkl_gpio_irq_enable(dev->cfg.pin_b));
+    if (dev->cfg.pin_p < TUYA_GPIO_NUM_MAX) {
+        TUYA_CALL_ERR_RETURN(tkl_gpio_irq_enable(dev->cfg.pin_p));
+    }
+
+    return OPRT_OK;
 }
 
 /**
- * @brief Wait for semaphore and process encoder input task.
+ * @brief Opens an encoder and starts decoding it.
  *
- * This function waits for a semaphore in an infinite loop, reads the encoder's input signals,
- * and updates the encoding angle based on the state of the input signals.
- * When the input signal is low, the encoding angle is increased; when the input signal is high,
- * the encoding angle is decreased. The function also checks the thread state to decide whether
- * to exit the loop.
+ * @param[in] cfg: the pins and detents of the encoder
+ * @param[out] handle: the encoder
  *
- * @param args The passed-in parameter, currently unused.
+ * @return OPRT_OK on success, others on failure
  */
-static void __sema_wait_task(void *args)
+OPERATE_RET encoder_open(const ENCODER_CFG_T *cfg, ENCODER_HANDLE *handle)
 {
-    uint32_t cnt = 0;
-    TUYA_GPIO_LEVEL_E a_level = 0;
-    TUYA_GPIO_LEVEL_E b_level = 0;
-
-    while (1) {
-        tal_semaphore_wait(example_sem_hdl, SEM_WAIT_FOREVER);
-
-        tkl_gpio_read(DECODER_INPUT_A, &a_level);
-        tkl_gpio_read(DECODER_INPUT_B, &b_level);
-
-        if (a_level == TUYA_GPIO_LEVEL_LOW && b_level == TUYA_GPIO_LEVEL_LOW) {
-            tal_system_sleep(3);
-            tkl_gpio_read(DECODER_INPUT_A, &a_level);
-            tkl_gpio_read(DECODER_INPUT_B, &b_level);
-
-            if (a_level == TUYA_GPIO_LEVEL_LOW && b_level == TUYA_GPIO_LEVEL_LOW) {
-                tal_mutex_lock(mutex_hdl);
-                encode_angle += 1;
-                tal_mutex_unlock(mutex_hdl);
-            }
-        } else if (a_level == TUYA_GPIO_LEVEL_LOW && b_level == TUYA_GPIO_LEVEL_HIGH) {
-            tal_system_sleep(3);
-            tkl_gpio_read(DECODER_INPUT_A, &a_level);
-            tkl_gpio_read(DECODER_INPUT_B, &b_level);
-
-            if (a_level == TUYA_GPIO_LEVEL_LOW && b_level == TUYA_GPIO_LEVEL_HIGH) {
-                tal_mutex_lock(mutex_hdl);
-                encode_angle -= 1;
-                tal_mutex_unlock(mutex_hdl);
-            }
-        }
+    OPERATE_RET rt = OPRT_OK;
+    ENCODER_DEV_T *dev = NULL;
 
-        cnt = 0;
-        while (1) {
-            tkl_gpio_read(DECODER_INPUT_A, &a_level);
-            tkl_gpio_read(DECODER_INPUT_B, &b_level);
-
-            if (a_level == TUYA_GPIO_LEVEL_HIGH && b_level == TUYA_GPIO_LEVEL_HIGH) {
-                break;
-            }
-
-            tal_system_sleep(10);
-            cnt++;
-            if (cnt > 100) {
-                PR_ERR("encoder wait timeout");
-                break;
-            }
-        }
+    if (NULL == cfg || NULL == handle || cfg->pin_a >= TUYA_GPIO_NUM_MAX || cfg->pin_b >= TUYA_GPIO_NUM_MAX) {
+        return OPRT_INVALID_PARM;
+    }
 
-        if (THREAD_STATE_STOP == tal_thread_get_state(wait_thrd_hdl)) {
-            break;
-        }
+    TUYA_CALL_ERR_RETURN(__encoder_service_start());
+
+    dev = tal_malloc(sizeof(ENCODER_DEV_T));
+    TUYA_CHECK_NULL_RETURN(dev, OPRT_MALLOC_FAILED);
+    memset(dev, 0, sizeof(ENCODER_DEV_T));
+    dev->cfg = *cfg;
+    encoder_velocity_reset(&dev->vel);
+
+    rt = __encoder_irq_init(dev);
+    if (OPRT_OK != rt) {
+        PR_ERR("encoder irq init err:%d", rt);
+        __encoder_irq_deinit(dev);
+        tal_free(dev);
+        return rt;
     }
 
-    wait_thrd_hdl = NULL;
-    PR_DEBUG("thread __sema_wait_task will delete");
+    tal_mutex_lock(sg_encoder.mutex);
+    dev->next = sg_encoder.list;
+    sg_encoder.list = dev;
+    tal_mutex_unlock(sg_encoder.mutex);
 
-    return;
+    *handle = dev;
+
+    return OPRT_OK;
 }
 
 /**
- * @brief Get the angle value of the encoder.
+ * @brief Stops the interrupts of an encoder and frees it.
+ *
+ * @param[in] handle: the encoder
+ *
+ * @return OPRT_OK on success, others on failure
+ */
+OPERATE_RET encoder_close(ENCODER_HANDLE handle)
+{
+    ENCODER_DEV_T *dev = (ENCODER_DEV_T *)handle;
+    ENCODER_DEV_T **pp = NULL;
+
+    if (NULL == dev || NULL == sg_encoder.mutex) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tal_mutex_lock(sg_encoder.mutex);
+    for (pp = &sg_encoder.list; *pp && *pp != dev; pp = &(*pp)->next) {
+    }
+    if (NULL == *pp) {
+        tal_mutex_unlock(sg_encoder.mutex);
+        return OPRT_NOT_FOUND;
+    }
+    *pp = dev->next;
+    tal_mutex_unlock(sg_encoder.mutex);
+
+    __encoder_irq_deinit(dev);
+    if (handle == sg_default) {
+        sg_default = NULL;
+    }
+    tal_free(dev);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Gets the position, speed and button of an encoder.
  *
- * This function locks the mutex before getting the angle value to ensure thread safety.
- * After reading the angle value, it unlocks the mutex. The returned value is the current
- * angle of the encoder.
+ * @param[in] handle: the encoder
+ * @param[out] state: gets the state
  *
- * @return The current angle value of the encoder, in degrees.
+ * @return OPRT_OK on success, others on failure
+ */
+OPERATE_RET encoder_state_get(ENCODER_HANDLE handle, ENCODER_STATE_T *state)
+{
+    ENCODER_DEV_T *dev = (ENCODER_DEV_T *)handle;
+    volatile encoder_quad_t *quad = NULL;
+
+    if (NULL == dev || NULL == state) {
+        return OPRT_INVALID_PARM;
+    }
+
+    quad = &dev->quad;
+    state->position = quad->detents;
+    state->steps = quad->steps;
+    state->errors = quad->errors;
+    state->velocity = dev->vel.velocity;
+    state->acceleration = dev->vel.acceleration;
+    state->pressed = dev->pressed;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Get the angle value of the encoder.
+ *
+ * @return The current angle value of the encoder, in detents.
  */
 int32_t encoder_get_angle(void)
 {
-    int32_t value;
+    ENCODER_STATE_T state;
 
-    tal_mutex_lock(mutex_hdl);
-    value = encode_angle;
-    tal_mutex_unlock(mutex_hdl);
+    if (OPRT_OK != encoder_state_get(sg_default, &state)) {
+        return 0;
+    }
 
-    return value;
+    return state.position;
 }
 
 /**
  * @brief Check if the encoder button is pressed.
  *
- * This function reads the voltage level of the encoder input pin. If a low voltage level
- * is still detected after a short delay, it returns 1 to indicate that the button is pressed;
- * otherwise, it returns 0 to indicate that it is not pressed.
- *
  * @return uint8_t Returns 1 if the button is pressed, returns 0 if not pressed.
  */
 uint8_t encoder_get_pressed(void)
 {
-    TUYA_GPIO_LEVEL_E read_level = TUYA_GPIO_LEVEL_LOW;
-
-    tkl_gpio_read(DECODER_INPUT_P, &read_level);
-    if (read_level == TUYA_GPIO_LEVEL_LOW) {
-        tal_system_sleep(5);
-        tkl_gpio_read(DECODER_INPUT_P, &read_level);
-        if (read_level == TUYA_GPIO_LEVEL_LOW) {
-            return 1;
-        }
+    ENCODER_STATE_T state;
+
+    if (OPRT_OK != encoder_state_get(sg_default, &state)) {
+        return 0;
     }
 
-    return 0;
+    return state.pressed ? 1 : 0;
 }
 
 /**
  * @brief Initialize the encoder module.
  *
- * This function is responsible for creating semaphores and mutexes, initializing GPIO input pins,
- * and setting up the encoder input interrupt configuration. If the waiting thread has not been
- * created yet, it will start the thread to handle semaphore waiting.
- *
  * @return None
  */
 void tkl_encoder_init(void)
 {
     OPERATE_RET rt = OPRT_OK;
-
-    TUYA_CALL_ERR_RETURN(tal_semaphore_create_init(&example_sem_hdl, 0, 1));
-    TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&mutex_hdl));
-
-    THREAD_CFG_T thread_cfg = {
-        .thrdname = "sem_wait",
-        .stackDepth = 2048,
-        .priority = THREAD_PRIO_2,
+    ENCODER_CFG_T cfg = {
+        .pin_a = DECODER_INPUT_A,
+        .pin_b = DECODER_INPUT_B,
+        .pin_p = DECODER_INPUT_P,
+        .steps_per_detent = ENCODER_STEPS_PER_DETENT,
     };
 
-    if (NULL == wait_thrd_hdl) {
-        TUYA_CALL_ERR_RETURN(
-            tal_thread_create_and_start(&wait_thrd_hdl, NULL, NULL, __sema_wait_task, NULL, &thread_cfg));
+    if (sg_default) {
+        return;
     }
 
-    /*GPIO input init*/
-    TUYA_GPIO_BASE_CFG_T in_pin_cfg = {
-        .mode = TUYA_GPIO_PULLUP,
-        .direct = TUYA_GPIO_INPUT,
-    };
-
-    TUYA_CALL_ERR_LOG(tkl_gpio_init(DECODER_INPUT_A, &in_pin_cfg));
-
-    TUYA_CALL_ERR_LOG(tkl_gpio_init(DECODER_INPUT_B, &in_pin_cfg));
-
-    TUYA_CALL_ERR_LOG(tkl_gpio_init(DECODER_INPUT_P, &in_pin_cfg));
-
-    /*Encoder input init*/
-    TUYA_GPIO_IRQ_T irq_cfg = {
-        .cb = __gpio_irq_callback,
-        .arg = NULL,
-        .mode = TUYA_GPIO_IRQ_FALL,
-    };
-    TUYA_CALL_ERR_LOG(tkl_gpio_irq_init(DECODER_INPUT_A, &irq_cfg));
-
-    /*irq enable*/
-    TUYA_CALL_ERR_LOG(tkl_gpio_irq_enable(DECODER_INPUT_A));
+    TUYA_CALL_ERR_LOG(encoder_open(&cfg, &sg_default));
 }
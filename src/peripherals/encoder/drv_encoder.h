@@ -5,6 +5,11 @@
  *        for different kinds of encoders used in the system, enabling accurate
  *        position and speed feedback.
  *
+ * Every encoder is opened with its own pins. Both channels raise interrupts on
+ * both edges and are decoded in the interrupt, a task samples the counts to
+ * estimate the speed and publishes EVENT_ENCODER_ROTATE and EVENT_ENCODER_PRESS
+ * on the event bus.
+ *
  * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
  *
  */
@@ -23,35 +28,102 @@ extern "C" {
 #include "tal_api.h"
 #include "tal_log.h"
 #include "tkl_output.h"
+#include "encoder_quad.h"
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define EVENT_ENCODER_ROTATE "encoder.rotate" // the knob moved by detents, ENCODER_ROTATE_EVT_T
+#define EVENT_ENCODER_PRESS  "encoder.press"  // the button changed, ENCODER_PRESS_EVT_T
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef void *ENCODER_HANDLE;
+
+typedef struct {
+    TUYA_GPIO_NUM_E pin_a;
+    TUYA_GPIO_NUM_E pin_b;
+    TUYA_GPIO_NUM_E pin_p; // the button, TUYA_GPIO_NUM_MAX without one
+    uint8_t steps_per_detent;
+} ENCODER_CFG_T;
+
+typedef struct {
+    ENCODER_HANDLE handle;
+    int32_t delta;        // detents since the last event
+    int32_t position;     // detents since the encoder was opened
+    int32_t velocity;     // steps/s
+    int32_t acceleration; // steps/s^2
+} ENCODER_ROTATE_EVT_T;
+
+typedef struct {
+    ENCODER_HANDLE handle;
+    bool pressed;
+} ENCODER_PRESS_EVT_T;
+
+typedef struct {
+    int32_t position;     // detents
+    int32_t steps;        // quadrature steps
+    int32_t velocity;     // steps/s
+    int32_t acceleration; // steps/s^2
+    uint32_t errors;      // transitions that skipped a state
+    bool pressed;         // debounced
+} ENCODER_STATE_T;
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
 /**
- * @brief Get the angle value of the encoder.
+ * @brief Opens an encoder and starts decoding it.
  *
- * This function locks the mutex before getting the angle value to ensure thread safety.
- * After reading the angle value, it unlocks the mutex. The returned value is the current
- * angle of the encoder.
+ * The events go to the subscribers of EVENT_ENCODER_ROTATE and
+ * EVENT_ENCODER_PRESS on the task of the encoders. They should return quickly
+ * and must not open or close an encoder.
  *
- * @return The current angle value of the encoder, in degrees.
+ * @param[in] cfg: the pins and detents of the encoder
+ * @param[out] handle: the encoder
+ *
+ * @return OPRT_OK on success, others on failure
  */
-int32_t encoder_get_angle(void);
+OPERATE_RET encoder_open(const ENCODER_CFG_T *cfg, ENCODER_HANDLE *handle);
+
+/**
+ * @brief Stops the interrupts of an encoder and frees it.
+ *
+ * @param[in] handle: the encoder
+ *
+ * @return OPRT_OK on success, others on failure
+ */
+OPERATE_RET encoder_close(ENCODER_HANDLE handle);
+
+/**
+ * @brief Gets the position, speed and button of an encoder.
+ *
+ * The speed is the one of the last sample of the task, the position is read
+ * straight from the decoder.
+ *
+ * @param[in] handle: the encoder
+ * @param[out] state: gets the state
+ *
+ * @return OPRT_OK on success, others on failure
+ */
+OPERATE_RET encoder_state_get(ENCODER_HANDLE handle, ENCODER_STATE_T *state);
 
 /**
  * @brief Get the angle value of the encoder.
  *
- * This function locks the mutex before getting the angle value to ensure thread safety.
- * After reading the angle value, it unlocks the mutex. The returned value is the current
- * angle of the encoder.
+ * The position in detents of the encoder opened by tkl_encoder_init, on the
+ * DECODER_INPUT_A, DECODER_INPUT_B and DECODER_INPUT_P pins.
  *
- * @return The current angle value of the encoder, in degrees.
+ * @return The current angle value of the encoder, in detents.
  */
 int32_t encoder_get_angle(void);
 
-
 /**
  * @brief Check if the encoder button is pressed.
  *
- * This function reads the voltage level of the encoder input pin. If a low voltage level
- * is still detected after a short delay, it returns 1 to indicate that the button is pressed;
- * otherwise, it returns 0 to indicate that it is not pressed.
+ * The debounced state of the button of the encoder opened by
+ * tkl_encoder_init.
  *
  * @return uint8_t Returns 1 if the button is pressed, returns 0 if not pressed.
  */
@@ -60,9 +132,9 @@ uint8_t encoder_get_pressed(void);
 /**
  * @brief Initialize the encoder module.
  *
- * This function is responsible for creating semaphores and mutexes, initializing GPIO input pins,
- * and setting up the encoder input interrupt configuration. If the waiting thread has not been
- * created yet, it will start the thread to handle semaphore waiting.
+ * Opens the encoder of the DECODER_INPUT_A, DECODER_INPUT_B and
+ * DECODER_INPUT_P pins, read by encoder_get_angle and encoder_get_pressed.
+ * Initializing it again does nothing.
  *
  * @return None
  */
@@ -71,4 +143,4 @@ void tkl_encoder_init(void);
 #ifdef __cplusplus
 }
 #endif
-#endif /* __DRV_ENCODER_H__ */
\ No newline at end of file
+#endif /* __DRV_ENCODER_H__ */
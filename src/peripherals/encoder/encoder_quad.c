@@ -0,0 +1,126 @@
+/**
+ * @file encoder_quad.c
+ * @brief Quadrature decoding and speed estimation of rotary encoders.
+ * encoder_quad_edge runs in the GPIO interrupt, it is a table lookup and a
+ * few additions.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+#include <string.h>
+#include "encoder_quad.h"
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define Q_ERR 2 // both channels changed, an edge was missed
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+// indexed by the previous state << 2 | the new one, forwards is
+// 11 -> 10 -> 00 -> 01 -> 11
+static const int8_t sg_quad_table[16] = {
+    0, 1, -1, Q_ERR, -1, 0, Q_ERR, 1, 1, Q_ERR, 0, -1, Q_ERR, -1, 1, 0,
+};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+void encoder_quad_reset(encoder_quad_t *quad, uint8_t ab, uint8_t steps_per_detent)
+{
+    if (NULL == quad) {
+        return;
+    }
+
+    memset(quad, 0, sizeof(encoder_quad_t));
+    quad->state = ab & 0x03;
+    quad->steps_per_detent = MAX(steps_per_detent, 1);
+}
+
+int8_t encoder_quad_edge(encoder_quad_t *quad, uint8_t ab)
+{
+    int8_t step, detent = 0;
+
+    ab &= 0x03;
+    step = sg_quad_table[(quad->state << 2) | ab];
+    quad->state = ab;
+    if (Q_ERR == step) {
+        quad->errors++;
+        return 0;
+    }
+    if (0 == step) {
+        return 0;
+    }
+
+    quad->steps += step;
+    if (1 == quad->steps_per_detent) {
+        quad->detents += step;
+        return step;
+    }
+
+    quad->acc += step;
+    if (ENCODER_QUAD_REST == ab) {
+        if (2 * quad->acc >= quad->steps_per_detent) {
+            detent = 1;
+        } else if (-2 * quad->acc >= quad->steps_per_detent) {
+            detent = -1;
+        }
+        quad->acc = 0;
+    } else if (quad->acc >= quad->steps_per_detent || -quad->acc >= quad->steps_per_detent) {
+        // past a detent without a rest, the knob has no detents at 11
+        detent = (quad->acc > 0) ? 1 : -1;
+        quad->acc -= detent * quad->steps_per_detent;
+    }
+    quad->detents += detent;
+
+    return detent;
+}
+
+void encoder_velocity_reset(encoder_velocity_t *vel)
+{
+    if (vel) {
+        memset(vel, 0, sizeof(encoder_velocity_t));
+    }
+}
+
+static int32_t __iir(int32_t out, int32_t in, int32_t alpha)
+{
+    return out + (int32_t)(((int64_t)in - out) * alpha / 256);
+}
+
+void encoder_velocity_update(encoder_velocity_t *vel, int32_t steps, uint32_t now_ms)
+{
+    int32_t velocity_q8, accel_q8;
+    uint32_t dt;
+
+    if (NULL == vel) {
+        return;
+    }
+
+    dt = now_ms - vel->ms;
+    if (!vel->primed) {
+        vel->primed = 1;
+        vel->steps = steps;
+        vel->ms = now_ms;
+        return;
+    }
+    if (0 == dt) {
+        return;
+    }
+
+    velocity_q8 = (int32_t)((int64_t)(steps - vel->steps) * 1000 * 256 / dt);
+    velocity_q8 = __iir(vel->velocity_q8, velocity_q8, ENCODER_VELOCITY_ALPHA);
+    accel_q8 = (int32_t)((int64_t)(velocity_q8 - vel->velocity_q8) * 1000 / dt);
+    vel->acceleration_q8 = __iir(vel->acceleration_q8, accel_q8, ENCODER_ACCEL_ALPHA);
+    vel->velocity_q8 = velocity_q8;
+    if (steps == vel->steps && 0 == velocity_q8 / 256) {
+        // a knob at rest has no acceleration left to filter out
+        vel->velocity_q8 = 0;
+        vel->acceleration_q8 = 0;
+    }
+
+    vel->steps = steps;
+    vel->ms = now_ms;
+    vel->velocity = vel->velocity_q8 / 256;
+    vel->acceleration = vel->acceleration_q8 / 256;
+}
@@ -0,0 +1,122 @@
+/**
+ * @file encoder_quad.h
+ * @brief Quadrature decoding and speed estimation of rotary encoders.
+ * The decoder takes the levels of the A and B channels on each edge and
+ * follows them through a state table: a valid transition is a step forwards
+ * or backwards, contact bounce on one channel steps back and forth and cancels
+ * out, a transition that changes both channels was missed and is counted as
+ * an error. Steps make detents, the clicks of the knob.
+ *
+ * The estimator turns the step count sampled over time into a velocity and an
+ * acceleration. Nothing here touches the hardware or the OS, so synthetic edge
+ * sequences give the same results on any host.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+#ifndef __ENCODER_QUAD_H__
+#define __ENCODER_QUAD_H__
+
+#include <stdint.h>
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+/* A << 1 | B of the state both channels rest in between detents, high with
+ * the pull-ups */
+#define ENCODER_QUAD_REST 0x03
+
+/* weight of a new sample in the velocity IIR, out of 256 */
+#ifndef ENCODER_VELOCITY_ALPHA
+#define ENCODER_VELOCITY_ALPHA 64
+#endif
+
+/* weight of a new sample in the acceleration IIR, out of 256, lower since
+ * the difference of two velocities carries more of the step quantization */
+#ifndef ENCODER_ACCEL_ALPHA
+#define ENCODER_ACCEL_ALPHA 24
+#endif
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint8_t state;            // A << 1 | B after the last edge
+    uint8_t steps_per_detent; // 4 for the usual knob, 1 counts every step
+    int8_t acc;               // steps since the last detent
+    int32_t steps;
+    int32_t detents;
+    uint32_t errors; // transitions that skipped a state
+} encoder_quad_t;
+
+typedef struct {
+    uint8_t primed : 1;
+    int32_t steps; // at the last sample
+    uint32_t ms;
+    int32_t velocity_q8;     // steps/s, 8 fractional bits
+    int32_t acceleration_q8; // steps/s^2, 8 fractional bits
+    int32_t velocity;        // steps/s
+    int32_t acceleration;    // steps/s^2
+} encoder_velocity_t;
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+/**
+ * @brief Resets a decoder to the levels the channels have now.
+ *
+ * @param[in] quad: the decoder
+ * @param[in] ab: level of A << 1 | level of B
+ * @param[in] steps_per_detent: steps of a detent, 0 is taken as 1
+ *
+ * @return none
+ */
+void encoder_quad_reset(encoder_quad_t *quad, uint8_t ab, uint8_t steps_per_detent);
+
+/**
+ * @brief Runs the decoder on the levels read after an edge of A or B.
+ *
+ * Positive is the direction in which A falls while B is low. With several
+ * steps per detent a detent is counted when the channels come back to rest
+ * at least half a detent away from the last one, so a lost edge does not lose
+ * the detent and a knob turned half way and back counts nothing.
+ *
+ * @param[in] quad: the decoder
+ * @param[in] ab: level of A << 1 | level of B
+ *
+ * @return the detents moved, -1, 0 or 1
+ */
+int8_t encoder_quad_edge(encoder_quad_t *quad, uint8_t ab);
+
+/**
+ * @brief Resets an estimator, the next sample only primes it.
+ *
+ * @param[in] vel: the estimator
+ *
+ * @return none
+ */
+void encoder_velocity_reset(encoder_velocity_t *vel);
+
+/**
+ * @brief Updates the velocity and acceleration from a sample of the steps.
+ *
+ * Samples should come on a steady period while the knob turns, a few tens of
+ * milliseconds at most. Samples at the time of the last one are ignored.
+ *
+ * @param[in] vel: the estimator
+ * @param[in] steps: steps of the decoder now
+ * @param[in] now_ms: time of the sample
+ *
+ * @return none
+ */
+void encoder_velocity_update(encoder_velocity_t *vel, int32_t steps, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ENCODER_QUAD_H__ */
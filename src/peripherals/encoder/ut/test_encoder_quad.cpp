@@ -0,0 +1,135 @@
+/**
+ * @file test_encoder_quad.cpp
+ * @brief UT of the quadrature decoder and the velocity estimator of the encoder.
+ *
+ * Every transition of the state table is compared with the Gray code distance
+ * of its two states, then sequences of A << 1 | B states, written as digits,
+ * must give their detents, steps and errors: turns both ways, bounce, a turn
+ * half way and back, a lost edge. The velocity estimator is fed step counts
+ * sampled on a jittery period at a constant speed, a constant acceleration
+ * and after a stop.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdlib.h>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "tuya_cloud_types.h"
+#include "encoder_quad.h"
+}
+
+#define SAMPLE_MS 10
+
+namespace {
+
+struct Seq {
+    const char *name;
+    uint8_t steps_per_detent;
+    const char *states; // the first one is the state at reset
+    int32_t detents;
+    int32_t steps;
+    uint32_t errors;
+};
+
+const Seq sg_seqs[] = {
+    {"forward", 4, "3201320132013", 3, 12, 0},
+    {"backward", 4, "3102310231023102310231023", -6, -24, 0},
+    // B bounces on the first step, A on the last
+    {"bounce", 4, "323232013201313", 2, 8, 0},
+    {"half_back", 4, "32002313", 0, 0, 0},
+    // 0 is missed between 2 and 1
+    {"lost_edge", 4, "321332013", 2, 6, 1},
+    {"rest_at_10", 4, "201320132", 2, 8, 0},
+    {"no_detents", 1, "320131023", 0, 0, 0},
+    {"every_step", 1, "32013", 4, 4, 0},
+    {"noise", 4, "303030", 0, 0, 5},
+};
+
+// position of a state along the forwards direction 11 -> 10 -> 00 -> 01
+int32_t __gray_pos(uint8_t ab)
+{
+    static const int32_t pos[4] = {2, 3, 1, 0};
+
+    return pos[ab & 0x03];
+}
+
+// samples steps(t) = v0 * t + a * t^2 / 2 for ms, on periods of 9 to 11 ms
+void __velocity_feed(encoder_velocity_t *vel, uint32_t *now_ms, int32_t v0, int32_t a, uint32_t ms)
+{
+    static const uint32_t jitter[] = {0, 1, 2, 1, 0, 2};
+    uint32_t start = *now_ms, t = 0, i = 0;
+    int64_t steps0 = vel->steps;
+
+    while (t < ms) {
+        t += SAMPLE_MS - 1 + jitter[i++ % CNTSOF(jitter)];
+        encoder_velocity_update(vel, (int32_t)(steps0 + (int64_t)v0 * t / 1000 + (int64_t)a * t * t / 2000000),
+                                start + t);
+    }
+    *now_ms = start + t;
+}
+
+} // namespace
+
+TEST(EncoderQuad, TableFollowsTheGrayCode)
+{
+    encoder_quad_t quad;
+
+    for (uint8_t prev = 0; prev < 4; prev++) {
+        for (uint8_t cur = 0; cur < 4; cur++) {
+            int32_t dist = (__gray_pos(cur) - __gray_pos(prev) + 4) % 4;
+
+            encoder_quad_reset(&quad, prev, 1);
+            encoder_quad_edge(&quad, cur);
+            EXPECT_EQ((1 == dist) ? 1 : ((3 == dist) ? -1 : 0), quad.steps) << (int)prev << " -> " << (int)cur;
+            EXPECT_EQ((2 == dist) ? 1U : 0U, quad.errors) << (int)prev << " -> " << (int)cur;
+        }
+    }
+}
+
+TEST(EncoderQuad, SequencesGiveTheirDetents)
+{
+    encoder_quad_t quad;
+
+    for (const Seq &seq : sg_seqs) {
+        const char *p = seq.states;
+        int32_t detents = 0;
+
+        encoder_quad_reset(&quad, *p - '0', seq.steps_per_detent);
+        for (p++; *p; p++) {
+            detents += encoder_quad_edge(&quad, *p - '0');
+        }
+        EXPECT_EQ(seq.detents, detents) << seq.name;
+        EXPECT_EQ(seq.detents, quad.detents) << seq.name;
+        EXPECT_EQ(seq.steps, quad.steps) << seq.name;
+        EXPECT_EQ(seq.errors, quad.errors) << seq.name;
+    }
+}
+
+TEST(EncoderVelocity, FollowsSpeedAccelerationAndStop)
+{
+    encoder_velocity_t vel;
+    uint32_t now_ms = 1000;
+
+    encoder_velocity_reset(&vel);
+    encoder_velocity_update(&vel, 0, now_ms);
+
+    __velocity_feed(&vel, &now_ms, 400, 0, 1000);
+    EXPECT_GE(vel.velocity, 390);
+    EXPECT_LE(vel.velocity, 410);
+    EXPECT_LE(abs(vel.acceleration), 150);
+
+    // 400 up to 2400 steps/s in a second
+    __velocity_feed(&vel, &now_ms, 400, 2000, 1000);
+    EXPECT_GE(vel.velocity, 2250);
+    EXPECT_LE(vel.velocity, 2450);
+    EXPECT_GE(vel.acceleration, 1700);
+    EXPECT_LE(vel.acceleration, 2300);
+
+    __velocity_feed(&vel, &now_ms, 0, 0, 500);
+    EXPECT_EQ(0, vel.velocity);
+    EXPECT_EQ(0, vel.acceleration);
+}
@@ -97,14 +97,15 @@ int cst816x_i2c_read(uint8_t *point_num, touch_point_t *touch_coord, uint8_t max
 {
     uint8_t read_num = 1;
     uint8_t x_point_h, x_point_l, y_point_h, y_point_l;
-    uint8_t data[13];
+    uint8_t data[REG_YPOS_LOW + 1];
 
     if (point_num == NULL || touch_coord == NULL || max_num == 0) {
         return -1;
     }
     *point_num = 0;
 
-    if (cst816x_i2c_port_read(CST816_ADDR, REG_STATUS, &data, sizeof(data)) < 0) {
+    /* one burst from the status to the first point */
+    if (cst816x_i2c_port_read(CST816_ADDR, REG_STATUS, data, sizeof(data)) < 0) {
         PR_ERR("read point num fail");
         return -1;
     }
@@ -11,7 +11,7 @@
  */
 #include "gt1151.h"
 
-static uint8_t point_data[GT1151_POINT_INFO_TOTAL_SIZE] = {0};
+static uint8_t point_data[1 + GT1151_POINT_INFO_TOTAL_SIZE] = {0};
 
 static int gt1151_i2c_port_read(uint16_t dev_addr, uint16_t register_addr, uint8_t *data_buf, uint16_t len)
 {
@@ -31,11 +31,10 @@ static int gt1151_i2c_port_read(uint16_t dev_addr, uint16_t register_addr, uint8
 
 static int gt1151_i2c_port_write(uint16_t dev_addr, uint16_t register_addr, uint8_t *data_buf, uint16_t len)
 {
-    OPERATE_RET ret = OPRT_OK;
-    uint8_t *cmd_bytes = tal_malloc(len + 2);
+    uint8_t cmd_bytes[2 + GT1151_I2C_WRITE_MAX];
 
-    if (cmd_bytes == NULL) {
-        return OPRT_MALLOC_FAILED;
+    if (len > GT1151_I2C_WRITE_MAX) {
+        return OPRT_INVALID_PARM;
     }
 
     cmd_bytes[0] = (uint8_t)(register_addr >> 8);
@@ -43,10 +42,7 @@ static int gt1151_i2c_port_write(uint16_t dev_addr, uint16_t register_addr, uint
 
     memcpy(&cmd_bytes[2], data_buf, len);
 
-    ret = tkl_i2c_master_send(TOUCH_I2C_PORT, dev_addr, cmd_bytes, len + 2, FALSE);
-    tal_free(cmd_bytes);
-
-    return ret;
+    return tkl_i2c_master_send(TOUCH_I2C_PORT, dev_addr, cmd_bytes, len + 2, FALSE);
 }
 
 /**
@@ -94,13 +90,16 @@ int gt1151_i2c_init(void)
  * @brief Reads touch points data from the GT1151 touch controller via I2C.
  *
  * This function reads the number of touch points and their coordinates from the GT1151
- * touch controller. It communicates with the controller over the I2C bus.
+ * touch controller. It communicates with the controller over the I2C bus, with
+ * one burst read of the status and the points then the write that clears the
+ * status.
  *
  * @param point_num Pointer to a variable where the number of touch points will be stored.
  * @param touch_coord Pointer to an array where touch coordinates will be stored.
  * @param max_num The maximum number of touch points to read.
  *
- * @return 0 on success, -1 on error or if there are no touch points.
+ * @return 0 on success, OPRT_RESOURCE_NOT_READY when the controller has no new
+ *         frame, -1 on error.
  */
 int gt1151_i2c_read(uint8_t *point_num, touch_point_t *touch_coord, uint8_t max_num)
 {
@@ -113,38 +112,27 @@ int gt1151_i2c_read(uint8_t *point_num, touch_point_t *touch_coord, uint8_t max_
     }
 
     if (max_num > GT1151_POINT_INFO_NUM) {
-        PR_ERR("invalid param");
-        return -1;
+        max_num = GT1151_POINT_INFO_NUM;
     }
 
     *point_num = 0;
 
-    if (gt1151_i2c_port_read(GT1151_I2C_SLAVE_ADDR, GT1151_STATUS, &status, 1)) {
+    /* status and points in one burst, the points follow the status register */
+    if (gt1151_i2c_port_read(GT1151_I2C_SLAVE_ADDR, GT1151_STATUS, point_data, sizeof(point_data))) {
         return -1;
     }
 
-    if (status == 0) {
-        /* no touch */
-        return 0;
-    } else if ((status & 0x80) == 0) {
-        /* no touch */
-        return 0;
+    status = point_data[0];
+    if ((status & 0x80) == 0) {
+        /* no new frame */
+        return OPRT_RESOURCE_NOT_READY;
     }
 
-    PR_DEBUG("GT1151 read status: 0x%02x", status & 0x0f);
     read_num = ((status & 0x0f) > max_num) ? max_num : (status & 0x0f);
 
-    /* read gt911 reg */
-    memset(point_data, 0, sizeof(point_data));
-    if (gt1151_i2c_port_read(GT1151_I2C_SLAVE_ADDR, GT1151_POINT1_REG, point_data, sizeof(point_data))) {
-        return -1;
-    }
-
-    PR_DEBUG("GT1151 read point data: 0x%02x", point_data[0]);
-
     /* get point coordinates */
     for (uint8_t i = 0; i < read_num; i++) {
-        uint8_t *p_data = &point_data[i * 8];
+        uint8_t *p_data = &point_data[1 + i * GT1151_POINT_INFO_SIZE];
         touch_coord[i].x = (uint16_t)p_data[2] << 8 | p_data[1];
         touch_coord[i].y = (uint16_t)p_data[4] << 8 | p_data[3];
     }
@@ -152,8 +140,8 @@ int gt1151_i2c_read(uint8_t *point_num, touch_point_t *touch_coord, uint8_t max_
     *point_num = read_num;
 
     // clear status
-    point_data[0] = 0;
-    gt1151_i2c_port_write(GT1151_I2C_SLAVE_ADDR, GT1151_STATUS, &point_data[0], 1);
+    status = 0;
+    gt1151_i2c_port_write(GT1151_I2C_SLAVE_ADDR, GT1151_STATUS, &status, 1);
 
     return 0;
 }
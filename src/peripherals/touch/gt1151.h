@@ -34,6 +34,9 @@
 #define GT1151_POINT_INFO_SIZE       (8)
 #define GT1151_POINT_INFO_TOTAL_SIZE (GT1151_POINT_INFO_NUM * GT1151_POINT_INFO_SIZE)
 
+/* Longest register write */
+#define GT1151_I2C_WRITE_MAX 8
+
 #define GT1151_COMMAND_REG (0x8040)
 
 #define GT1151_CONFIG_REG (0x8050)
@@ -11,7 +11,7 @@
  */
 #include "gt911_i2c.h"
 
-static uint8_t point_data[8 * GT911_I2C_MAX_POINT] = {0};
+static uint8_t point_data[1 + GT911_POINT_INFO_SIZE * GT911_I2C_MAX_POINT] = {0};
 
 static int gt911_i2c_port_read(uint16_t dev_addr, uint16_t register_addr, uint8_t *data_buf, uint16_t len)
 {
@@ -31,11 +31,10 @@ static int gt911_i2c_port_read(uint16_t dev_addr, uint16_t register_addr, uint8_
 
 static int gt911_i2c_port_write(uint16_t dev_addr, uint16_t register_addr, uint8_t *data_buf, uint16_t len)
 {
-    OPERATE_RET ret = OPRT_OK;
-    uint8_t *cmd_bytes = tal_malloc(len + 2);
+    uint8_t cmd_bytes[2 + GT911_I2C_WRITE_MAX];
 
-    if (cmd_bytes == NULL) {
-        return OPRT_MALLOC_FAILED;
+    if (len > GT911_I2C_WRITE_MAX) {
+        return OPRT_INVALID_PARM;
     }
 
     cmd_bytes[0] = (uint8_t)(register_addr >> 8);
@@ -43,10 +42,7 @@ static int gt911_i2c_port_write(uint16_t dev_addr, uint16_t register_addr, uint8
 
     memcpy(&cmd_bytes[2], data_buf, len);
 
-    ret = tkl_i2c_master_send(TOUCH_I2C_PORT, dev_addr, cmd_bytes, len + 2, FALSE);
-    tal_free(cmd_bytes);
-
-    return ret;
+    return tkl_i2c_master_send(TOUCH_I2C_PORT, dev_addr, cmd_bytes, len + 2, FALSE);
 }
 
 /**
@@ -95,17 +91,21 @@ int gt911_i2c_init(void)
  * @brief Reads touch points data from the GT911 touch controller via I2C.
  *
  * This function reads the number of touch points and their coordinates from the GT911
- * touch controller. It communicates with the controller over the I2C bus.
+ * touch controller. It communicates with the controller over the I2C bus: a
+ * single finger costs one burst read of the status and the point, plus the
+ * write that clears the status.
  *
  * @param point_num Pointer to a variable where the number of touch points will be stored.
  * @param touch_coord Pointer to an array where touch coordinates will be stored.
  * @param max_num The maximum number of touch points to read.
  *
- * @return 0 on success, -1 on error or if there are no touch points.
+ * @return 0 on success, OPRT_RESOURCE_NOT_READY when the controller has no new
+ *         frame, -1 on error.
  */
 int gt911_i2c_read(uint8_t *point_num, touch_point_t *touch_coord, uint8_t max_num)
 {
     uint8_t read_num;
+    uint8_t status;
 
     if (point_num == NULL || touch_coord == NULL || max_num == 0) {
         return -1;
@@ -113,40 +113,44 @@ int gt911_i2c_read(uint8_t *point_num, touch_point_t *touch_coord, uint8_t max_n
 
     *point_num = 0;
 
-    if (gt911_i2c_port_read(GT911_I2C_SLAVE_ADDR, GT911_READ_XY_REG, point_data, 1)) {
+    /* status and the first point in one burst, most frames have a single finger */
+    if (gt911_i2c_port_read(GT911_I2C_SLAVE_ADDR, GT911_READ_XY_REG, point_data, 1 + GT911_POINT_INFO_SIZE)) {
         return -1;
     }
 
-    /* no touch */
-    if (point_data[0] == 0) {
-        return 0;
-    } else if (point_data[0] == 0x80) {
-        point_data[0] = 0;
-        gt911_i2c_port_write(GT911_I2C_SLAVE_ADDR, GT911_READ_XY_REG, &point_data[0], 1);
-
-        return 0;
+    /* no new frame */
+    status = point_data[0];
+    if ((status & 0x80) == 0) {
+        return OPRT_RESOURCE_NOT_READY;
     }
 
-    if (point_data[0] > GT911_I2C_MAX_POINT) {
-        point_data[0] = GT911_I2C_MAX_POINT;
+    read_num = status & 0x0f;
+    if (read_num > GT911_I2C_MAX_POINT) {
+        read_num = GT911_I2C_MAX_POINT;
+    }
+    if (read_num > max_num) {
+        read_num = max_num;
     }
 
-    read_num = (point_data[0] > max_num) ? max_num : point_data[0];
-
-    /* read gt911 reg */
-    gt911_i2c_port_read(GT911_I2C_SLAVE_ADDR, GT911_READ_XY_REG, point_data, (8 * read_num));
+    /* the other points follow the first one */
+    if (read_num > 1 && gt911_i2c_port_read(GT911_I2C_SLAVE_ADDR, GT911_POINT2_REG,
+                                            &point_data[1 + GT911_POINT_INFO_SIZE],
+                                            (read_num - 1) * GT911_POINT_INFO_SIZE)) {
+        read_num = 1;
+    }
 
     /* get point coordinates */
     for (uint8_t i = 0; i < read_num; i++) {
-        uint8_t *p_data = &point_data[i * 8];
-        touch_coord[i].x = (uint16_t)p_data[3] << 8 | p_data[2];
-        touch_coord[i].y = (uint16_t)p_data[5] << 8 | p_data[4];
+        uint8_t *p_data = &point_data[1 + i * GT911_POINT_INFO_SIZE];
+        touch_coord[i].x = (uint16_t)p_data[2] << 8 | p_data[1];
+        touch_coord[i].y = (uint16_t)p_data[4] << 8 | p_data[3];
     }
 
     *point_num = read_num;
 
-    point_data[0] = 0;
-    gt911_i2c_port_write(GT911_I2C_SLAVE_ADDR, GT911_READ_XY_REG, &point_data[0], 1);
+    /* hand the buffer back to the controller */
+    status = 0;
+    gt911_i2c_port_write(GT911_I2C_SLAVE_ADDR, GT911_READ_XY_REG, &status, 1);
 
     return 0;
 }
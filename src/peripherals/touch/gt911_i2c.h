@@ -40,6 +40,10 @@
 
 /* Max detectable simultaneous touch points */
 #define GT911_I2C_MAX_POINT 5
+#define GT911_POINT_INFO_SIZE 8
+
+/* Longest register write */
+#define GT911_I2C_WRITE_MAX 8
 
 int gt911_i2c_init(void);
 
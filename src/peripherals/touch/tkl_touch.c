@@ -74,7 +74,9 @@ OPERATE_RET tkl_touch_init(void)
  * @param point_num Pointer to a variable that will hold the number of touch points.
  * @param point Pointer to an array that will hold the touch point data.
  * @param max_num The maximum number of touch points that can be read.
- * @return int Returns OPRT_OK on success, or an error code on failure.
+ * @return int Returns OPRT_OK on success, OPRT_RESOURCE_NOT_READY when the
+ *         controller has no new frame since the last read, or an error code
+ *         on failure.
  */
 OPERATE_RET tkl_touch_read(uint8_t *point_num, touch_point_t *point, uint8_t max_num)
 {
@@ -93,8 +95,10 @@ OPERATE_RET tkl_touch_read(uint8_t *point_num, touch_point_t *point, uint8_t max
 #error "Not support touch IC"
 #endif
 
-    if (ret != OPRT_OK) {
-        PR_ERR("cst816x read failed\n");
+    if (ret == OPRT_RESOURCE_NOT_READY) {
+        return ret;
+    } else if (ret != OPRT_OK) {
+        PR_ERR("touch read failed %d", ret);
         return ret;
     }
     return OPRT_OK;
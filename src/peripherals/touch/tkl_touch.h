@@ -17,11 +17,7 @@
 #include "tal_api.h"
 #include "tkl_pinmux.h"
 #include "tkl_i2c.h"
-
-typedef struct {
-    uint16_t x;
-    uint16_t y;
-} touch_point_t;
+#include "touch_gesture.h"
 
 /**
  * @brief Initializes the I2C peripheral for touch device communication.
@@ -53,7 +49,9 @@ OPERATE_RET tkl_touch_init(void);
  * @param point_num Pointer to a variable that will hold the number of touch points.
  * @param point Pointer to an array that will hold the touch point data.
  * @param max_num The maximum number of touch points that can be read.
- * @return int Returns OPRT_OK on success, or an error code on failure.
+ * @return int Returns OPRT_OK on success, OPRT_RESOURCE_NOT_READY when the
+ *         controller has no new frame since the last read, or an error code
+ *         on failure.
  */
 OPERATE_RET tkl_touch_read(uint8_t *point_num, touch_point_t *point, uint8_t max_num);
 
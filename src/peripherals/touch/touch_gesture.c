@@ -0,0 +1,248 @@
+/**
+ * @file touch_gesture.c
+ * @brief Coordinate filtering and gesture recognition of touch frames.
+ * The filter works in fixed point, the recognizer only on the first two
+ * fingers: one finger makes taps, long-presses and swipes, two fingers make
+ * pinches and cancel the other gestures until every finger is lifted.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+#include <string.h>
+#include "touch_gesture.h"
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static uint16_t __median3(uint16_t a, uint16_t b, uint16_t c)
+{
+    uint16_t t;
+
+    if (a > b) {
+        t = a;
+        a = b;
+        b = t;
+    }
+
+    return (c < a) ? a : ((c > b) ? b : c);
+}
+
+static int32_t __iir(int32_t out, uint16_t in)
+{
+    int64_t delta = ((int32_t)in << 8) - out;
+
+    return out + (int32_t)(delta * TOUCH_FILTER_IIR_ALPHA / 256);
+}
+
+void touch_filter_reset(touch_filter_t *filter)
+{
+    if (filter) {
+        memset(filter, 0, sizeof(touch_filter_t));
+    }
+}
+
+void touch_filter_apply(touch_filter_t *filter, touch_point_t *points, uint8_t point_num)
+{
+    uint8_t i, num = MIN(point_num, TOUCH_GESTURE_POINT_MAX);
+    touch_filter_point_t *fp = NULL;
+
+    if (NULL == filter || (num && NULL == points)) {
+        return;
+    }
+
+    for (i = 0; i < num; i++) {
+        fp = &filter->point[i];
+        if (num != filter->point_num) {
+            fp->raw[0] = fp->raw[1] = fp->raw[2] = points[i];
+            fp->x = (int32_t)points[i].x << 8;
+            fp->y = (int32_t)points[i].y << 8;
+            continue;
+        }
+
+        fp->raw[0] = fp->raw[1];
+        fp->raw[1] = fp->raw[2];
+        fp->raw[2] = points[i];
+        fp->x = __iir(fp->x, __median3(fp->raw[0].x, fp->raw[1].x, fp->raw[2].x));
+        fp->y = __iir(fp->y, __median3(fp->raw[0].y, fp->raw[1].y, fp->raw[2].y));
+        points[i].x = (uint16_t)((fp->x + 128) >> 8);
+        points[i].y = (uint16_t)((fp->y + 128) >> 8);
+    }
+    filter->point_num = num;
+}
+
+static uint64_t __dist2(const touch_point_t *a, const touch_point_t *b)
+{
+    int64_t dx = (int32_t)a->x - b->x, dy = (int32_t)a->y - b->y;
+
+    return (uint64_t)(dx * dx + dy * dy);
+}
+
+static uint32_t __isqrt(uint64_t v)
+{
+    uint64_t res = 0, bit = (uint64_t)1 << 62;
+
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (v >= res + bit) {
+            v -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32_t)res;
+}
+
+static TOUCH_SWIPE_DIR_E __swipe_dir(const touch_point_t *from, const touch_point_t *to)
+{
+    int32_t dx = (int32_t)to->x - from->x, dy = (int32_t)to->y - from->y;
+    int32_t adx = (dx < 0) ? -dx : dx, ady = (dy < 0) ? -dy : dy;
+
+    if (MAX(adx, ady) < TOUCH_GESTURE_SWIPE_MIN_DIST) {
+        return TOUCH_SWIPE_NONE;
+    }
+    if (adx >= ady) {
+        return (dx > 0) ? TOUCH_SWIPE_RIGHT : TOUCH_SWIPE_LEFT;
+    }
+
+    // y grows downwards on a screen
+    return (dy > 0) ? TOUCH_SWIPE_DOWN : TOUCH_SWIPE_UP;
+}
+
+static uint8_t __event_add(touch_event_t *events, uint8_t n, TOUCH_EVENT_TYPE_E type, uint32_t now_ms,
+                           const touch_point_t *point, uint8_t point_num)
+{
+    touch_event_t *evt = &events[n];
+
+    memset(evt, 0, sizeof(touch_event_t));
+    evt->type = type;
+    evt->time_ms = now_ms;
+    evt->point = *point;
+    evt->point_num = point_num;
+
+    return n + 1;
+}
+
+void touch_gesture_reset(touch_gesture_t *gesture)
+{
+    if (gesture) {
+        memset(gesture, 0, sizeof(touch_gesture_t));
+    }
+}
+
+static uint8_t __release(touch_gesture_t *gesture, uint32_t now_ms, touch_event_t *events)
+{
+    uint32_t elapsed = now_ms - gesture->press_ms;
+    TOUCH_SWIPE_DIR_E dir = TOUCH_SWIPE_NONE;
+    uint8_t n = 0;
+
+    gesture->pressed = 0;
+    gesture->point_num = 0;
+    n = __event_add(events, n, TOUCH_EVENT_RELEASE, now_ms, &gesture->last, 0);
+    if (gesture->multi || gesture->long_pressed) {
+        return n;
+    }
+
+    if (!gesture->moved && elapsed <= TOUCH_GESTURE_TAP_MS) {
+        n = __event_add(events, n, TOUCH_EVENT_TAP, now_ms, &gesture->last, 0);
+    } else if (gesture->moved && elapsed <= TOUCH_GESTURE_SWIPE_MAX_MS &&
+               TOUCH_SWIPE_NONE != (dir = __swipe_dir(&gesture->start, &gesture->last))) {
+        n = __event_add(events, n, TOUCH_EVENT_SWIPE, now_ms, &gesture->start, 0);
+        events[n - 1].dir = dir;
+    }
+
+    return n;
+}
+
+static void __pinch_start(touch_gesture_t *gesture, const touch_point_t *points)
+{
+    gesture->multi = 1;
+    gesture->pinching = 0;
+    gesture->pinch_dist = __isqrt(__dist2(&points[0], &points[1]));
+    gesture->pinch_scale = 256;
+}
+
+static uint8_t __pinch(touch_gesture_t *gesture, const touch_point_t *points, uint32_t now_ms,
+                       touch_event_t *events, uint8_t n)
+{
+    uint32_t dist = __isqrt(__dist2(&points[0], &points[1]));
+    uint32_t diff = (dist > gesture->pinch_dist) ? dist - gesture->pinch_dist : gesture->pinch_dist - dist;
+    uint32_t scale = 0;
+    touch_point_t center;
+
+    if (!gesture->pinching && diff < TOUCH_GESTURE_PINCH_MIN_DIST) {
+        return n;
+    }
+    gesture->pinching = 1;
+
+    scale = (dist << 8) / MAX(gesture->pinch_dist, 1);
+    scale = MIN(scale, UINT16_MAX);
+    if (scale == gesture->pinch_scale) {
+        return n;
+    }
+    gesture->pinch_scale = (uint16_t)scale;
+
+    center.x = (uint16_t)(((uint32_t)points[0].x + points[1].x) / 2);
+    center.y = (uint16_t)(((uint32_t)points[0].y + points[1].y) / 2);
+    n = __event_add(events, n, TOUCH_EVENT_PINCH, now_ms, &center, 2);
+    events[n - 1].scale = (uint16_t)scale;
+
+    return n;
+}
+
+uint8_t touch_gesture_feed(touch_gesture_t *gesture, touch_point_t *points, uint8_t point_num, uint32_t now_ms,
+                           touch_event_t *events)
+{
+    uint8_t n = 0;
+
+    if (NULL == gesture || NULL == events || (point_num && NULL == points)) {
+        return 0;
+    }
+
+    touch_filter_apply(&gesture->filter, points, point_num);
+
+    if (0 == point_num) {
+        return gesture->pressed ? __release(gesture, now_ms, events) : 0;
+    }
+
+    if (!gesture->pressed) {
+        gesture->pressed = 1;
+        gesture->moved = 0;
+        gesture->multi = 0;
+        gesture->long_pressed = 0;
+        gesture->press_ms = now_ms;
+        gesture->start = gesture->last = points[0];
+        gesture->point_num = point_num;
+        if (point_num >= 2) {
+            __pinch_start(gesture, points);
+        }
+        return __event_add(events, n, TOUCH_EVENT_PRESS, now_ms, &points[0], point_num);
+    }
+
+    if (points[0].x != gesture->last.x || points[0].y != gesture->last.y) {
+        gesture->last = points[0];
+        n = __event_add(events, n, TOUCH_EVENT_MOVE, now_ms, &points[0], point_num);
+        if (!gesture->moved &&
+            __dist2(&gesture->start, &gesture->last) > TOUCH_GESTURE_TAP_SLOP * TOUCH_GESTURE_TAP_SLOP) {
+            gesture->moved = 1;
+        }
+    }
+
+    if (point_num >= 2) {
+        if (gesture->point_num < 2) {
+            __pinch_start(gesture, points);
+        } else {
+            n = __pinch(gesture, points, now_ms, events, n);
+        }
+    } else if (!gesture->moved && !gesture->multi && !gesture->long_pressed &&
+               now_ms - gesture->press_ms >= TOUCH_GESTURE_LONG_PRESS_MS) {
+        gesture->long_pressed = 1;
+        n = __event_add(events, n, TOUCH_EVENT_LONG_PRESS, now_ms, &gesture->last, point_num);
+    }
+    gesture->point_num = point_num;
+
+    return n;
+}
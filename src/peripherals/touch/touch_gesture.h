@@ -0,0 +1,184 @@
+/**
+ * @file touch_gesture.h
+ * @brief Coordinate filtering and gesture recognition of touch frames.
+ * A frame is the set of points a touch controller reports at one time. The
+ * filter smooths each point with a median of its last three samples followed
+ * by an IIR low-pass, the recognizer turns the filtered frames into pointer
+ * events (press, move, release) and gestures (tap, long-press, swipe, pinch).
+ *
+ * Nothing here touches the hardware or the OS, times are given by the caller,
+ * so recorded frames replay to the same events on any host. The point type of
+ * the drivers lives here for the same reason.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+#ifndef __TOUCH_GESTURE_H__
+#define __TOUCH_GESTURE_H__
+
+#include <stdint.h>
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+/* points of a frame the filter and the recognizer follow */
+#ifndef TOUCH_GESTURE_POINT_MAX
+#define TOUCH_GESTURE_POINT_MAX 2
+#endif
+
+/* weight of a new sample in the IIR, out of 256 */
+#ifndef TOUCH_FILTER_IIR_ALPHA
+#define TOUCH_FILTER_IIR_ALPHA 128
+#endif
+
+/* moves within this distance of the press point still make a tap */
+#ifndef TOUCH_GESTURE_TAP_SLOP
+#define TOUCH_GESTURE_TAP_SLOP 10
+#endif
+
+#ifndef TOUCH_GESTURE_TAP_MS
+#define TOUCH_GESTURE_TAP_MS 300
+#endif
+
+#ifndef TOUCH_GESTURE_LONG_PRESS_MS
+#define TOUCH_GESTURE_LONG_PRESS_MS 600
+#endif
+
+#ifndef TOUCH_GESTURE_SWIPE_MIN_DIST
+#define TOUCH_GESTURE_SWIPE_MIN_DIST 50
+#endif
+
+#ifndef TOUCH_GESTURE_SWIPE_MAX_MS
+#define TOUCH_GESTURE_SWIPE_MAX_MS 800
+#endif
+
+/* change of the distance between two fingers that starts a pinch */
+#ifndef TOUCH_GESTURE_PINCH_MIN_DIST
+#define TOUCH_GESTURE_PINCH_MIN_DIST 20
+#endif
+
+/* most events a single frame can produce */
+#define TOUCH_GESTURE_EVENT_MAX 2
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+} touch_point_t;
+
+typedef enum {
+    TOUCH_EVENT_PRESS = 0,
+    TOUCH_EVENT_MOVE,
+    TOUCH_EVENT_RELEASE,
+    TOUCH_EVENT_TAP,
+    TOUCH_EVENT_LONG_PRESS,
+    TOUCH_EVENT_SWIPE,
+    TOUCH_EVENT_PINCH,
+} TOUCH_EVENT_TYPE_E;
+
+typedef enum {
+    TOUCH_SWIPE_NONE = 0,
+    TOUCH_SWIPE_LEFT,
+    TOUCH_SWIPE_RIGHT,
+    TOUCH_SWIPE_UP,
+    TOUCH_SWIPE_DOWN,
+} TOUCH_SWIPE_DIR_E;
+
+typedef struct {
+    TOUCH_EVENT_TYPE_E type;
+    uint32_t time_ms;
+    touch_point_t point; // first finger, its start for a swipe, the center of the fingers for a pinch
+    uint8_t point_num;
+    TOUCH_SWIPE_DIR_E dir; // swipe only
+    uint16_t scale;        // pinch only, distance of the fingers over their first one, 256 is 1.0
+} touch_event_t;
+
+typedef struct {
+    touch_point_t raw[3]; // last samples, oldest first
+    int32_t x, y;         // IIR output, 8 fractional bits
+} touch_filter_point_t;
+
+typedef struct {
+    touch_filter_point_t point[TOUCH_GESTURE_POINT_MAX];
+    uint8_t point_num; // of the previous frame, 0 when released
+} touch_filter_t;
+
+typedef struct {
+    touch_filter_t filter;
+    uint8_t pressed : 1;
+    uint8_t moved : 1;   // left the tap slop
+    uint8_t multi : 1;   // had two fingers since the press
+    uint8_t long_pressed : 1;
+    uint8_t pinching : 1;
+    uint8_t point_num;
+    uint32_t press_ms;
+    touch_point_t start; // first finger at the press
+    touch_point_t last;  // first finger of the last frame
+    uint32_t pinch_dist; // between the fingers when the second one landed
+    uint16_t pinch_scale;
+} touch_gesture_t;
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+/**
+ * @brief Resets a filter, the next frame is taken as a new press.
+ *
+ * @param[in] filter: the filter
+ *
+ * @return none
+ */
+void touch_filter_reset(touch_filter_t *filter);
+
+/**
+ * @brief Filters the points of a frame in place.
+ *
+ * Points beyond TOUCH_GESTURE_POINT_MAX are left as they are. A change in the
+ * number of points restarts the filter, the first sample of a press passes
+ * through unchanged.
+ *
+ * @param[in] filter: the filter
+ * @param[in,out] points: the points of the frame
+ * @param[in] point_num: number of points, 0 on release
+ *
+ * @return none
+ */
+void touch_filter_apply(touch_filter_t *filter, touch_point_t *points, uint8_t point_num);
+
+/**
+ * @brief Resets a recognizer to the released state.
+ *
+ * @param[in] gesture: the recognizer
+ *
+ * @return none
+ */
+void touch_gesture_reset(touch_gesture_t *gesture);
+
+/**
+ * @brief Filters a frame and runs the recognizer on it.
+ *
+ * Frames should come at least every few tens of milliseconds while a finger
+ * is down, a long-press is only seen on a frame.
+ *
+ * @param[in] gesture: the recognizer
+ * @param[in,out] points: the points of the frame, filtered on return
+ * @param[in] point_num: number of points, 0 on release
+ * @param[in] now_ms: time of the frame
+ * @param[out] events: gets the events of the frame, TOUCH_GESTURE_EVENT_MAX at most
+ *
+ * @return the number of events
+ */
+uint8_t touch_gesture_feed(touch_gesture_t *gesture, touch_point_t *points, uint8_t point_num, uint32_t now_ms,
+                           touch_event_t *events);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TOUCH_GESTURE_H__ */
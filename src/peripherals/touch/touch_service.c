@@ -0,0 +1,217 @@
+/**
+ * @file touch_service.c
+ * @brief Touch input service.
+ * The INT pin only posts a semaphore, the I2C reads happen on the task of the
+ * service. While a finger is down the task also reads on a period since not
+ * every controller raises INT for a finger that holds still, and a press that
+ * sees no new frame for TOUCH_SERVICE_STALE_MS is released so that a lost
+ * frame cannot leave the GUI pressed.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+#include <string.h>
+#include "tal_api.h"
+#include "tkl_gpio.h"
+#include "touch_service.h"
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#ifndef TOUCH_INT_PIN
+#define TOUCH_INT_PIN -1
+#endif
+
+#ifndef TOUCH_INT_IRQ_MODE
+#define TOUCH_INT_IRQ_MODE TUYA_GPIO_IRQ_FALL
+#endif
+
+/* read period while a finger is down, or always without an INT pin */
+#ifndef TOUCH_READ_INTERVAL_MS
+#define TOUCH_READ_INTERVAL_MS 20
+#endif
+
+#ifndef TOUCH_SERVICE_STALE_MS
+#define TOUCH_SERVICE_STALE_MS 300
+#endif
+
+#ifndef TOUCH_SERVICE_QUEUE_NUM
+#define TOUCH_SERVICE_QUEUE_NUM 16
+#endif
+
+#ifndef TOUCH_SERVICE_STACK_SIZE
+#define TOUCH_SERVICE_STACK_SIZE 2048
+#endif
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    THREAD_HANDLE thread;
+    SEM_HANDLE sem;
+    QUEUE_HANDLE queue;
+    touch_gesture_cb_t cb;
+    void *cb_arg;
+    touch_gesture_t gesture;
+    uint32_t frame_ms; // of the last frame read
+} TOUCH_SERVICE_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static TOUCH_SERVICE_T sg_touch;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static void __touch_irq_cb(void *args)
+{
+    tal_semaphore_post(sg_touch.sem);
+}
+
+static void __touch_events_dispatch(touch_point_t *points, uint8_t point_num, uint32_t now_ms)
+{
+    touch_event_t events[TOUCH_GESTURE_EVENT_MAX];
+    touch_gesture_cb_t cb = sg_touch.cb;
+    uint8_t num, i;
+
+    num = touch_gesture_feed(&sg_touch.gesture, points, point_num, now_ms, events);
+    for (i = 0; i < num; i++) {
+        if (events[i].type <= TOUCH_EVENT_RELEASE) {
+            // the GUI drains the queue on each of its reads, a full queue
+            // means it is stalled and new events are dropped
+            tal_queue_post(sg_touch.queue, &events[i], 0);
+        } else if (cb) {
+            cb(&events[i], sg_touch.cb_arg);
+        }
+    }
+}
+
+static void __touch_task(void *args)
+{
+    touch_point_t points[TOUCH_GESTURE_POINT_MAX];
+    uint32_t timeout, now_ms;
+    uint8_t point_num;
+    OPERATE_RET rt;
+
+    for (;;) {
+        timeout = (sg_touch.gesture.pressed || TOUCH_INT_PIN < 0) ? TOUCH_READ_INTERVAL_MS : SEM_WAIT_FOREVER;
+        tal_semaphore_wait(sg_touch.sem, timeout);
+
+        point_num = 0;
+        rt = tkl_touch_read(&point_num, points, TOUCH_GESTURE_POINT_MAX);
+        now_ms = (uint32_t)tal_system_get_millisecond();
+        if (OPRT_OK != rt) {
+            if (sg_touch.gesture.pressed && now_ms - sg_touch.frame_ms >= TOUCH_SERVICE_STALE_MS) {
+                __touch_events_dispatch(points, 0, now_ms);
+            }
+            continue;
+        }
+
+        sg_touch.frame_ms = now_ms;
+        __touch_events_dispatch(points, point_num, now_ms);
+    }
+}
+
+static OPERATE_RET __touch_int_init(void)
+{
+#if TOUCH_INT_PIN >= 0
+    OPERATE_RET rt = OPRT_OK;
+    TUYA_GPIO_BASE_CFG_T pin_cfg = {
+        .mode = TUYA_GPIO_PULLUP,
+        .direct = TUYA_GPIO_INPUT,
+    };
+    TUYA_GPIO_IRQ_T irq_cfg = {
+        .mode = TOUCH_INT_IRQ_MODE,
+        .cb = __touch_irq_cb,
+        .arg = NULL,
+    };
+
+    TUYA_CALL_ERR_RETURN(tkl_gpio_init(TOUCH_INT_PIN, &pin_cfg));
+    TUYA_CALL_ERR_RETURN(tkl_gpio_irq_init(TOUCH_INT_PIN, &irq_cfg));
+    TUYA_CALL_ERR_RETURN(tkl_gpio_irq_enable(TOUCH_INT_PIN));
+#endif
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Initializes the touch controller and starts the service.
+ *
+ * Starting a running service does nothing.
+ *
+ * @return OPRT_OK on success, others on failure
+ */
+OPERATE_RET touch_service_start(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+    THREAD_CFG_T param;
+
+    if (sg_touch.thread) {
+        return OPRT_OK;
+    }
+
+    TUYA_CALL_ERR_RETURN(tkl_touch_init());
+    touch_gesture_reset(&sg_touch.gesture);
+
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&sg_touch.sem, 0, 1), __exit);
+    TUYA_CALL_ERR_GOTO(tal_queue_create_init(&sg_touch.queue, sizeof(touch_event_t), TOUCH_SERVICE_QUEUE_NUM),
+                       __exit);
+
+    param.priority = THREAD_PRIO_2;
+    param.stackDepth = TOUCH_SERVICE_STACK_SIZE;
+    param.thrdname = "touch";
+    TUYA_CALL_ERR_GOTO(tal_thread_create_and_start(&sg_touch.thread, NULL, NULL, __touch_task, NULL, &param),
+                       __exit);
+
+    // a failed INT pin leaves the service reading on the period of a press
+    TUYA_CALL_ERR_LOG(__touch_int_init());
+
+    return OPRT_OK;
+
+__exit:
+    if (sg_touch.queue) {
+        tal_queue_free(sg_touch.queue);
+        sg_touch.queue = NULL;
+    }
+    if (sg_touch.sem) {
+        tal_semaphore_release(sg_touch.sem);
+        sg_touch.sem = NULL;
+    }
+    sg_touch.thread = NULL;
+
+    return rt;
+}
+
+/**
+ * @brief Takes the oldest pointer event of the queue.
+ *
+ * @param[out] evt: gets a TOUCH_EVENT_PRESS, TOUCH_EVENT_MOVE or TOUCH_EVENT_RELEASE
+ * @param[in] timeout_ms: time to wait for an event, 0 to only check
+ *
+ * @return OPRT_OK when an event was taken, others otherwise
+ */
+OPERATE_RET touch_service_event_get(touch_event_t *evt, uint32_t timeout_ms)
+{
+    if (NULL == evt) {
+        return OPRT_INVALID_PARM;
+    }
+    if (NULL == sg_touch.queue) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+
+    return tal_queue_fetch(sg_touch.queue, evt, timeout_ms);
+}
+
+/**
+ * @brief Sets the callback of the gestures.
+ *
+ * @param[in] cb: the callback, NULL to drop the gestures
+ * @param[in] arg: argument of the callback
+ *
+ * @return none
+ */
+void touch_service_gesture_cb_set(touch_gesture_cb_t cb, void *arg)
+{
+    sg_touch.cb_arg = arg;
+    sg_touch.cb = cb;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file touch_service.h
+ * @brief Touch input service.
+ * A task reads the touch controller when its INT pin fires, and on a short
+ * period while a finger is down, filters the points and recognizes gestures.
+ * Pointer events (press, move, release) are queued for the input driver of
+ * the GUI, gestures go to the callback of the application.
+ *
+ * Without an INT pin (TOUCH_INT_PIN -1) the controller is polled instead.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+#ifndef __TOUCH_SERVICE_H__
+#define __TOUCH_SERVICE_H__
+
+#include "tuya_cloud_types.h"
+#include "tkl_touch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef void (*touch_gesture_cb_t)(const touch_event_t *evt, void *arg);
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+/**
+ * @brief Initializes the touch controller and starts the service.
+ *
+ * Starting a running service does nothing.
+ *
+ * @return OPRT_OK on success, others on failure
+ */
+OPERATE_RET touch_service_start(void);
+
+/**
+ * @brief Takes the oldest pointer event of the queue.
+ *
+ * @param[out] evt: gets a TOUCH_EVENT_PRESS, TOUCH_EVENT_MOVE or TOUCH_EVENT_RELEASE
+ * @param[in] timeout_ms: time to wait for an event, 0 to only check
+ *
+ * @return OPRT_OK when an event was taken, others otherwise
+ */
+OPERATE_RET touch_service_event_get(touch_event_t *evt, uint32_t timeout_ms);
+
+/**
+ * @brief Sets the callback of the gestures.
+ *
+ * The callback runs on the task of the service and gets the tap, long-press,
+ * swipe and pinch events. It should return quickly, the next frame is not
+ * read before.
+ *
+ * @param[in] cb: the callback, NULL to drop the gestures
+ * @param[in] arg: argument of the callback
+ *
+ * @return none
+ */
+void touch_service_gesture_cb_set(touch_gesture_cb_t cb, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TOUCH_SERVICE_H__ */
@@ -0,0 +1,141 @@
+/**
+ * @file test_touch_gesture.cpp
+ * @brief UT of the touch filter and gesture recognizer.
+ *
+ * The recorded traces of touch_traces.h are replayed through
+ * touch_gesture_feed and must give their events, the filter must hold a
+ * still finger against jitter and spikes.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <string.h>
+#include <string>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "tuya_cloud_types.h"
+#include "tuya_error_code.h"
+#include "touch_gesture.h"
+#include "touch_traces.h"
+}
+
+namespace {
+
+struct Replay {
+    std::string events;
+    uint16_t scale; // of the last pinch update
+};
+
+// replays a trace, the events as in touch_traces.h
+Replay __replay(const TOUCH_TRACE_T &trace)
+{
+    static const char dirs[] = "?<>^v";
+    TOUCH_TRACE_FRAME_T frames[TOUCH_TRACE_FRAME_MAX];
+    touch_event_t events[TOUCH_GESTURE_EVENT_MAX];
+    touch_gesture_t gesture;
+    uint32_t num = 0;
+    Replay r = {"", 0};
+
+    EXPECT_EQ(OPRT_OK, touch_trace_parse(trace.frames, frames, &num)) << trace.name;
+    touch_gesture_reset(&gesture);
+    for (uint32_t f = 0; f < num; f++) {
+        uint8_t n = touch_gesture_feed(&gesture, frames[f].point, frames[f].num, frames[f].ms, events);
+
+        for (uint8_t e = 0; e < n; e++) {
+            switch (events[e].type) {
+            case TOUCH_EVENT_PRESS:
+                r.events += 'P';
+                break;
+            case TOUCH_EVENT_RELEASE:
+                r.events += 'R';
+                break;
+            case TOUCH_EVENT_TAP:
+                r.events += 'T';
+                break;
+            case TOUCH_EVENT_LONG_PRESS:
+                r.events += 'L';
+                break;
+            case TOUCH_EVENT_SWIPE:
+                r.events += 'S';
+                r.events += dirs[events[e].dir];
+                break;
+            case TOUCH_EVENT_PINCH:
+                r.scale = events[e].scale;
+                if (r.events.empty() || 'Z' != r.events.back()) {
+                    r.events += 'Z';
+                }
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    return r;
+}
+
+} // namespace
+
+TEST(TouchGesture, RecordedTracesGiveTheirEvents)
+{
+    for (const TOUCH_TRACE_T &trace : sg_touch_traces) {
+        Replay r = __replay(trace);
+
+        EXPECT_EQ(trace.events, r.events) << trace.name;
+        if (trace.scale_max) {
+            EXPECT_GE(r.scale, trace.scale_min) << trace.name;
+            EXPECT_LE(r.scale, trace.scale_max) << trace.name;
+        }
+    }
+}
+
+TEST(TouchGesture, ReplayIsRepeatable)
+{
+    // the recognizer keeps nothing between a reset and the next press
+    for (const TOUCH_TRACE_T &trace : sg_touch_traces) {
+        Replay first = __replay(trace);
+        Replay second = __replay(trace);
+
+        EXPECT_EQ(first.events, second.events) << trace.name;
+        EXPECT_EQ(first.scale, second.scale) << trace.name;
+    }
+}
+
+TEST(TouchFilter, StillFingerStaysWithinItsJitter)
+{
+    // +-2 of jitter and single sample spikes, the spikes never show
+    static const int8_t jitter[] = {0, 2, -1, -2, 1, 40, 2, -2, 0, 1, -1, 2, -40, 0, 1, -2};
+    touch_filter_t filter;
+    touch_point_t point;
+
+    touch_filter_reset(&filter);
+    for (uint32_t i = 0; i < 4 * CNTSOF(jitter); i++) {
+        point.x = (uint16_t)(500 + jitter[i % CNTSOF(jitter)]);
+        point.y = (uint16_t)(500 - jitter[(i + 3) % CNTSOF(jitter)]);
+        touch_filter_apply(&filter, &point, 1);
+        EXPECT_GE(point.x, 498) << "frame " << i;
+        EXPECT_LE(point.x, 502) << "frame " << i;
+        EXPECT_GE(point.y, 498) << "frame " << i;
+        EXPECT_LE(point.y, 502) << "frame " << i;
+    }
+}
+
+TEST(TouchFilter, FirstSampleOfAPressPassesThrough)
+{
+    touch_filter_t filter;
+    touch_point_t point = {100, 100};
+
+    touch_filter_reset(&filter);
+    touch_filter_apply(&filter, &point, 1);
+    point = {400, 300};
+    touch_filter_apply(&filter, &point, 0);
+
+    // released in between, the new press is not pulled towards the old one
+    point = {400, 300};
+    touch_filter_apply(&filter, &point, 1);
+    EXPECT_EQ(400, point.x);
+    EXPECT_EQ(300, point.y);
+}
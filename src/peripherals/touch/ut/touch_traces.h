@@ -0,0 +1,182 @@
+/**
+ * @file touch_traces.h
+ * @brief Touch panel traces shared by the UT and the benchmark of touch_gesture.
+ *
+ * The traces are frames recorded from a touch panel, one line per frame with
+ * its time in ms, the number of points and their coordinates. They carry the
+ * jitter and the odd spike of real panels. The events a trace must give are
+ * written as a string: P press, R release, T tap, L long-press, S and a
+ * direction (<, >, ^, v) for a swipe, Z for one or more pinch updates. Moves
+ * are left out.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __TOUCH_TRACES_H__
+#define __TOUCH_TRACES_H__
+
+#include <stdlib.h>
+
+#include "tuya_cloud_types.h"
+#include "touch_gesture.h"
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define TOUCH_TRACE_FRAME_MAX 64
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint32_t ms;
+    uint8_t num;
+    touch_point_t point[TOUCH_GESTURE_POINT_MAX];
+} TOUCH_TRACE_FRAME_T;
+
+typedef struct {
+    const char *name;
+    const char *frames;
+    const char *events;
+    uint16_t scale_min, scale_max; // of the last pinch, 0 when there is none
+} TOUCH_TRACE_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static const TOUCH_TRACE_T sg_touch_traces[] = {
+    // the spike at 30 ms is one bad sample, the median drops it
+    {"tap", "0 1 120 200\n"
+            "10 1 121 199\n"
+            "20 1 119 201\n"
+            "30 1 200 201\n"
+            "40 1 120 200\n"
+            "50 1 121 200\n"
+            "60 0\n",
+     "PRT", 0, 0},
+    {"long_press", "0 1 300 150\n"
+                   "50 1 301 151\n"
+                   "100 1 299 150\n"
+                   "150 1 300 152\n"
+                   "200 1 302 150\n"
+                   "250 1 300 149\n"
+                   "300 1 299 151\n"
+                   "350 1 301 150\n"
+                   "400 1 300 150\n"
+                   "450 1 298 151\n"
+                   "500 1 300 150\n"
+                   "550 1 301 149\n"
+                   "600 1 300 151\n"
+                   "650 1 300 150\n"
+                   "700 1 299 150\n"
+                   "750 1 301 151\n"
+                   "800 0\n",
+     "PLR", 0, 0},
+    {"swipe_left", "0 1 400 240\n"
+                   "20 1 385 242\n"
+                   "40 1 360 239\n"
+                   "60 1 330 241\n"
+                   "80 1 296 243\n"
+                   "100 1 262 240\n"
+                   "120 1 230 238\n"
+                   "140 1 201 241\n"
+                   "160 1 178 240\n"
+                   "180 1 161 242\n"
+                   "200 1 152 241\n"
+                   "220 0\n",
+     "PRS<", 0, 0},
+    {"swipe_up", "0 1 160 300\n"
+                 "15 1 161 280\n"
+                 "30 1 159 251\n"
+                 "45 1 162 214\n"
+                 "60 1 160 176\n"
+                 "75 1 158 142\n"
+                 "90 1 161 117\n"
+                 "105 1 160 104\n"
+                 "120 0\n",
+     "PRS^", 0, 0},
+    // too slow for a swipe
+    {"drag", "0 1 100 100\n"
+             "100 1 120 101\n"
+             "200 1 141 99\n"
+             "300 1 162 100\n"
+             "400 1 180 102\n"
+             "500 1 201 100\n"
+             "600 1 220 99\n"
+             "700 1 242 101\n"
+             "800 1 260 100\n"
+             "900 1 281 100\n"
+             "1000 1 300 101\n"
+             "1100 0\n",
+     "PR", 0, 0},
+    // the second finger lands, they spread from 80 to 240 apart, one lifts
+    {"pinch_out", "0 1 200 240\n"
+                  "15 2 200 240 280 240\n"
+                  "30 2 198 241 283 239\n"
+                  "45 2 190 240 290 240\n"
+                  "60 2 178 239 302 241\n"
+                  "75 2 164 240 316 240\n"
+                  "90 2 150 241 331 239\n"
+                  "105 2 138 240 343 240\n"
+                  "120 2 128 240 352 241\n"
+                  "135 2 122 239 358 240\n"
+                  "150 2 120 240 360 240\n"
+                  "165 2 120 240 360 240\n"
+                  "180 2 120 241 360 240\n"
+                  "195 1 120 240\n"
+                  "210 0\n",
+     "PZR", 680, 770},
+    {"pinch_in", "0 2 100 100 300 300\n"
+                 "15 2 104 104 296 296\n"
+                 "30 2 115 115 285 285\n"
+                 "45 2 131 130 270 271\n"
+                 "60 2 148 149 252 251\n"
+                 "75 2 160 160 240 240\n"
+                 "90 2 165 165 235 235\n"
+                 "105 2 166 165 234 235\n"
+                 "120 2 166 166 234 234\n"
+                 "135 0\n",
+     "PZR", 60, 110},
+    // two fingers that hold still are neither a tap nor a pinch
+    {"two_finger_hold", "0 2 100 200 200 200\n"
+                        "20 2 101 200 201 199\n"
+                        "40 2 100 201 199 200\n"
+                        "60 0\n",
+     "PR", 0, 0},
+};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+// parses the frames of a trace
+static inline OPERATE_RET touch_trace_parse(const char *text, TOUCH_TRACE_FRAME_T *frames, uint32_t *num)
+{
+    const char *p = text;
+    char *end = NULL;
+    uint32_t n = 0, i;
+
+    for (; *p; n++) {
+        if (n == TOUCH_TRACE_FRAME_MAX) {
+            return OPRT_EXCEED_UPPER_LIMIT;
+        }
+        frames[n].ms = strtoul(p, &end, 10);
+        frames[n].num = (uint8_t)strtoul(end, &end, 10);
+        if (frames[n].num > TOUCH_GESTURE_POINT_MAX) {
+            return OPRT_INVALID_PARM;
+        }
+        for (i = 0; i < frames[n].num; i++) {
+            frames[n].point[i].x = (uint16_t)strtoul(end, &end, 10);
+            frames[n].point[i].y = (uint16_t)strtoul(end, &end, 10);
+        }
+        if ('\n' != *end) {
+            return OPRT_INVALID_PARM;
+        }
+        p = end + 1;
+    }
+    *num = n;
+
+    return OPRT_OK;
+}
+
+#endif /* __TOUCH_TRACES_H__ */
@@ -9,6 +9,12 @@
  * command is executed. The CLI functionality is designed to facilitate
  * debugging and configuration through a command line interface.
  *
+ * A command line is "cmd args", optionally followed by up to three filters
+ * its output is piped through: "| grep [-v] <text>", "| head [lines]" and
+ * "| count". "source <file>" runs the lines of a script. Ctrl-C cancels the
+ * line running on the console, long running commands should poll
+ * tal_cli_canceled() to stop early.
+ *
  * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
  *
  */
@@ -31,6 +37,16 @@ extern "C" {
  */
 typedef void (*cli_cmd_func_cb_t)(int argc, char *argv[]);
 
+/**
+ * @brief gets the output of a command line run by tal_cli_exec
+ *
+ * @param[in] data The output, not null terminated
+ * @param[in] len The length of data
+ * @param[in] arg The arg given to tal_cli_exec
+ *
+ */
+typedef void (*cli_out_cb_t)(const char *data, uint32_t len, void *arg);
+
 typedef struct {
     /** cli command name */
     char *name;
@@ -82,6 +98,41 @@ int tal_cli_init_with_uart(uint8_t uart_num);
  */
 void tal_cli_echo(char *string);
 
+/**
+ * @brief cli print formatted output of a command
+ *
+ * @param[in] fmt printf format, the output is cut at CLI_PRINTF_MAX bytes
+ *
+ * @return None
+ *
+ */
+void tal_cli_printf(const char *fmt, ...);
+
+/**
+ * @brief check whether the command line running was canceled, by Ctrl-C or
+ * by a head filter that got its lines
+ *
+ * @return 1 if canceled, 0 otherwise
+ *
+ */
+int tal_cli_canceled(void);
+
+/**
+ * @brief run a command line in the calling thread
+ *
+ * @param[in] line The command line, pipes and scripts included
+ * @param[in] out Gets the output, NULL sends it to the console
+ * @param[in] arg Passed to out
+ *
+ * @note Lines run one at a time, a command must not call it. The CLI does
+ * not have to be initialized.
+ *
+ * @return OPRT_OK on success, OPRT_NOT_FOUND if there is no such command.
+ * Others on error, please refer to tuya_error_code.h
+ *
+ */
+int tal_cli_exec(const char *line, cli_out_cb_t out, void *arg);
+
 #ifdef __cplusplus
 }
 #endif
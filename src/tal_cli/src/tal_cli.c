@@ -10,18 +10,34 @@
  * dynamic command registration, facilitating development and debugging
  * processes.
  *
+ * Commands are looked up through a hash index of their names. The console
+ * task only edits the line, an entered line runs as a job on its own task so
+ * Ctrl-C still reaches the console: it cancels the job, drops the rest of its
+ * output and gives the prompt back. What is typed while a job runs is kept
+ * and replayed once it ends. A line may pipe the output of its command
+ * through the built-in filters grep, head and count, and "source" runs the
+ * lines of a script file. Output is gathered in a buffer and written to the
+ * UART in one go instead of byte by byte.
+ *
  * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
  *
  */
 
 /*============================ INCLUDES ======================================*/
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "tuya_slist.h"
 #include "tal_uart.h"
 #include "tal_log.h"
 #include "tal_cli.h"
 #include "tal_thread.h"
+#include "tal_mutex.h"
+#include "tal_semaphore.h"
+#include "tal_system.h"
 #include "tal_memory.h"
+#include "tal_fs.h"
 
 /*============================ MACROS ========================================*/
 #ifndef CLI_BUFFER_SIZE
@@ -43,6 +59,48 @@
 #ifndef CLI_CMD_NAME_MAX
 #define CLI_CMD_NAME_MAX 20
 #endif
+
+//! slots of the command index, a power of 2
+#ifndef CLI_CMD_HASH_SIZE
+#define CLI_CMD_HASH_SIZE 64
+#endif
+
+#ifndef CLI_OUT_BUFFER_SIZE
+#define CLI_OUT_BUFFER_SIZE 128
+#endif
+
+//! filters a line may pipe its output through
+#ifndef CLI_PIPE_NUM
+#define CLI_PIPE_NUM 3
+#endif
+
+//! longer lines reach the filters in pieces
+#ifndef CLI_FILTER_LINE_MAX
+#define CLI_FILTER_LINE_MAX 128
+#endif
+
+#ifndef CLI_SCRIPT_DEPTH
+#define CLI_SCRIPT_DEPTH 3
+#endif
+
+//! bytes typed while a job runs
+#ifndef CLI_AHEAD_SIZE
+#define CLI_AHEAD_SIZE 64
+#endif
+
+#ifndef CLI_JOB_STACK_SIZE
+#define CLI_JOB_STACK_SIZE 3072
+#endif
+
+#ifndef CLI_PRINTF_MAX
+#define CLI_PRINTF_MAX 256
+#endif
+
+#define CLI_JOB_POLL_MS 50
+
+#if (CLI_CMD_HASH_SIZE & (CLI_CMD_HASH_SIZE - 1))
+#error "CLI_CMD_HASH_SIZE must be a power of 2"
+#endif
 /*============================ MACROFIED FUNCTIONS ===========================*/
 /*============================ TYPES =========================================*/
 typedef struct {
@@ -57,6 +115,7 @@ typedef struct {
 
 typedef enum {
     CLI_NULL_KEY = '\0',
+    CLI_CTRL_C_KEY = 0x03,
     CLI_ESC_KEY = 0x1b,
     CLI_ENTER_KEY = '\r',
     CLI_ENTER2_KEY = '\n',
@@ -80,51 +139,200 @@ typedef struct {
     history_data_t data[CLI_HISTORY_NUM];
 } cli_history_t;
 
+//! where output goes, the console when NULL
+typedef struct cli_sink cli_sink_t;
+struct cli_sink {
+    cli_sink_t *next;
+    void (*write)(cli_sink_t *sink, const char *data, uint32_t len);
+};
+
+typedef enum {
+    CLI_FILTER_GREP,
+    CLI_FILTER_HEAD,
+    CLI_FILTER_COUNT,
+} cli_filter_type_t;
+
+//! a filter sees the output line by line, empty lines are dropped
+typedef struct {
+    cli_sink_t sink;
+    cli_filter_type_t type;
+    uint8_t invert;
+    uint8_t full; //! head got its lines
+    const char *pattern;
+    uint32_t limit;
+    uint32_t lines;
+    uint16_t len;
+    char line[CLI_FILTER_LINE_MAX + 1];
+} cli_filter_t;
+
+typedef struct {
+    cli_sink_t sink;
+    cli_out_cb_t cb;
+    void *arg;
+} cli_cb_sink_t;
+
+//! a command line being run
+typedef struct {
+    cli_sink_t *out;
+    volatile uint8_t canceled;
+    uint8_t depth; //! scripts being run
+} cli_ctx_t;
+
 typedef struct {
     TUYA_UART_NUM_E port_id;
     THREAD_HANDLE thread;
+    THREAD_HANDLE job_thread;
+    SEM_HANDLE job_sem;  //! a line to run
+    SEM_HANDLE idle_sem; //! the job task is free
+    MUTEX_HANDLE out_mutex;
     char *prompt;
     uint8_t echo;
+    volatile uint8_t fg; //! a job owns the console
     uint16_t index;
     uint16_t insert;
+    uint16_t ahead_head;
+    uint16_t ahead_len;
+    uint16_t out_len;
+    cli_ctx_t job;
     cli_history_t history;
-    int argc;
-    char *argv[CLI_ARGV_NUM];
     char buffer[CLI_BUFFER_SIZE + 1];
+    char line[CLI_BUFFER_SIZE + 1]; //! the line of the job
+    char ahead[CLI_AHEAD_SIZE];
+    char out[CLI_OUT_BUFFER_SIZE];
 } cli_t;
 
 /*============================ PROTOTYPES ====================================*/
 static void cli_hello(int argc, char *argv[]);
+static void cli_help(int argc, char *argv[]);
+static void cli_source(int argc, char *argv[]);
 static void cli_print_prompt(cli_t *cli);
+static int cli_line_exec(cli_ctx_t *ctx, char *line);
 
 /*============================ LOCAL VARIABLES ===============================*/
 static cli_t *s_cli_handle = NULL;
 static SLIST_HEAD s_cli_dynamic_table;
 static cli_cmd_table_t s_cli_static_table[CLI_CMD_TABLE_NUM];
+static cli_cmd_t *s_cli_cmd_hash[CLI_CMD_HASH_SIZE];
+static uint16_t s_cli_cmd_hash_num;
+static uint8_t s_cli_cmd_hash_full; //! some commands are only found by a scan
+static MUTEX_HANDLE s_cli_exec_mutex;
+static cli_ctx_t *s_cli_ctx; //! the line running, under s_cli_exec_mutex
 
-static const cli_cmd_t s_cli_cmd[] = {{
-    .name = "hello",
-    .help = "print helo world",
-    .func = cli_hello,
-}};
+static const cli_cmd_t s_cli_cmd[] = {
+    {
+        .name = "hello",
+        .help = "print helo world",
+        .func = cli_hello,
+    },
+    {
+        .name = "help",
+        .help = "list the commands",
+        .func = cli_help,
+    },
+    {
+        .name = "source",
+        .help = "run the command lines of a file",
+        .func = cli_source,
+    },
+};
 
 /*============================ IMPLEMENTATION ================================*/
-static int32_t cli_out_put(TUYA_UART_NUM_E port_id, char *out_str, uint32_t len)
+static void cli_out_flush_locked(cli_t *cli)
+{
+    if (cli->out_len) {
+        tal_uart_write(cli->port_id, (const uint8_t *)cli->out, cli->out_len);
+        cli->out_len = 0;
+    }
+}
+
+static void cli_out_put(cli_t *cli, const char *out_str, uint32_t len)
+{
+    uint32_t n;
+
+    tal_mutex_lock(cli->out_mutex);
+    while (len) {
+        if (CLI_OUT_BUFFER_SIZE == cli->out_len) {
+            cli_out_flush_locked(cli);
+        }
+        n = MIN(len, (uint32_t)(CLI_OUT_BUFFER_SIZE - cli->out_len));
+        memcpy(&cli->out[cli->out_len], out_str, n);
+        cli->out_len += n;
+        out_str += n;
+        len -= n;
+    }
+    tal_mutex_unlock(cli->out_mutex);
+}
+
+static void cli_out_flush(cli_t *cli)
 {
-    return tal_uart_write(port_id, (const uint8_t *)out_str, len);
+    tal_mutex_lock(cli->out_mutex);
+    cli_out_flush_locked(cli);
+    tal_mutex_unlock(cli->out_mutex);
 }
 
-static void cli_print_string(cli_t *cli, char *string)
+static void cli_sink_write(cli_sink_t *sink, const char *data, uint32_t len)
 {
-    cli_out_put(cli->port_id, "\r\n", 2);
-    while ('\0' != *string) {
-        cli_out_put(cli->port_id, string++, 1);
+    if (sink) {
+        sink->write(sink, data, len);
+    } else if (s_cli_handle) {
+        cli_out_put(s_cli_handle, data, len);
+    }
+}
+
+//! output of commands, it belongs to the line running if any
+static void cli_job_write(const char *data, uint32_t len)
+{
+    cli_ctx_t *ctx = s_cli_ctx;
+
+    if (ctx && ctx->canceled) {
+        return;
+    }
+    cli_sink_write(ctx ? ctx->out : NULL, data, len);
+}
+
+static void cli_job_flush(void)
+{
+    if (s_cli_handle) {
+        cli_out_flush(s_cli_handle);
     }
 }
 
 static void cli_hello(int argc, char *argv[])
 {
-    cli_print_string(s_cli_handle, "helo world");
+    tal_cli_echo("helo world");
+}
+
+//! FNV-1a
+static uint32_t cli_cmd_hash(const char *name)
+{
+    uint32_t hash = 2166136261u;
+
+    while ('\0' != *name) {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static void cli_cmd_index(cli_cmd_t *cmd)
+{
+    uint32_t i = cli_cmd_hash(cmd->name) & (CLI_CMD_HASH_SIZE - 1);
+
+    for (; s_cli_cmd_hash[i]; i = (i + 1) & (CLI_CMD_HASH_SIZE - 1)) {
+        //! the first one registered is found, as with the scan
+        if (0 == strcmp(s_cli_cmd_hash[i]->name, cmd->name)) {
+            return;
+        }
+    }
+
+    //! kept 3/4 full at most so a miss ends early
+    if (s_cli_cmd_hash_num >= CLI_CMD_HASH_SIZE / 4 * 3) {
+        s_cli_cmd_hash_full = 1;
+        return;
+    }
+    s_cli_cmd_hash[i] = cmd;
+    s_cli_cmd_hash_num++;
 }
 
 static cli_cmd_t *cli_cmd_find_with_name(char *name)
@@ -136,6 +344,15 @@ static cli_cmd_t *cli_cmd_find_with_name(char *name)
         return NULL;
     }
 
+    for (i = cli_cmd_hash(name) & (CLI_CMD_HASH_SIZE - 1); s_cli_cmd_hash[i]; i = (i + 1) & (CLI_CMD_HASH_SIZE - 1)) {
+        if (0 == strcmp(s_cli_cmd_hash[i]->name, name)) {
+            return s_cli_cmd_hash[i];
+        }
+    }
+    if (!s_cli_cmd_hash_full) {
+        return NULL;
+    }
+
     for (i = 0; i < CLI_CMD_TABLE_NUM; i++) {
         for (j = 0; j < s_cli_static_table[i].num; j++) {
             cmd = s_cli_static_table[i].cmd + j;
@@ -174,10 +391,10 @@ static void cli_print_cmd(cli_t *cli, cli_cmd_t *cmd)
     len = strlen(cmd->name);
     len = len > CLI_CMD_NAME_MAX ? CLI_CMD_NAME_MAX : len;
     strncpy(name, cmd->name, len);
-    cli_out_put(cli->port_id, "\r\n", 2);
-    cli_out_put(cli->port_id, name, strlen(name));
-    cli_out_put(cli->port_id, "\t", 1);
-    cli_out_put(cli->port_id, cmd->help, strlen(cmd->help));
+    cli_out_put(cli, "\r\n", 2);
+    cli_out_put(cli, name, strlen(name));
+    cli_out_put(cli, "\t", 1);
+    cli_out_put(cli, cmd->help, strlen(cmd->help));
 }
 
 static void cli_print_all_cmd(cli_t *cli)
@@ -210,13 +427,13 @@ static void cli_print_cmd_title(cli_t *cli)
 {
     int i;
 
-    cli_out_put(cli->port_id, "\r\ncmd", 5);
+    cli_out_put(cli, "\r\ncmd", 5);
     for (i = 3; i < CLI_CMD_NAME_MAX; i++) {
-        cli_out_put(cli->port_id, " ", 1);
+        cli_out_put(cli, " ", 1);
     }
-    cli_out_put(cli->port_id, "\thelp\r\n", 7);
+    cli_out_put(cli, "\thelp\r\n", 7);
     for (i = 0; i < 2 * CLI_CMD_NAME_MAX; i++) {
-        cli_out_put(cli->port_id, "-", 1);
+        cli_out_put(cli, "-", 1);
     }
 }
 
@@ -290,7 +507,7 @@ static int cli_table_key(cli_t *cli)
     }
 
     cli_print_prompt(cli);
-    cli_out_put(cli->port_id, cli->buffer, cli->index);
+    cli_out_put(cli, cli->buffer, cli->index);
 
     return OPRT_OK;
 }
@@ -361,7 +578,62 @@ static int cli_histroy_data_save(cli_t *cli)
     return true;
 }
 
-static int cli_key_detect(TUYA_UART_NUM_E port_id, char *data, cli_key_t *key)
+static int cli_fg_end(cli_t *cli)
+{
+    int fg;
+
+    tal_mutex_lock(cli->out_mutex);
+    fg = cli->fg;
+    cli->fg = 0;
+    tal_mutex_unlock(cli->out_mutex);
+
+    return fg;
+}
+
+static void cli_job_cancel(cli_t *cli)
+{
+    cli->job.canceled = 1;
+    if (cli_fg_end(cli)) {
+        cli_out_put(cli, "^C", 2);
+        cli_print_prompt(cli);
+        cli_out_flush(cli);
+    }
+}
+
+//! while a job owns the console only Ctrl-C is handled, the rest is kept
+//! and replayed once the job ends
+static void cli_getc(cli_t *cli, char *ch)
+{
+    for (;;) {
+        if (!cli->fg) {
+            if (cli->ahead_len) {
+                *ch = cli->ahead[cli->ahead_head];
+                cli->ahead_head = (cli->ahead_head + 1) % CLI_AHEAD_SIZE;
+                cli->ahead_len--;
+            } else {
+                tal_uart_read(cli->port_id, (uint8_t *)ch, 1);
+            }
+            return;
+        }
+
+        //! full, the rest waits in the UART
+        if (CLI_AHEAD_SIZE == cli->ahead_len) {
+            tal_system_sleep(CLI_JOB_POLL_MS);
+            continue;
+        }
+        if (tal_uart_read_timeout(cli->port_id, (uint8_t *)ch, 1, CLI_JOB_POLL_MS) <= 0) {
+            continue;
+        }
+        if (CLI_CTRL_C_KEY == *ch) {
+            cli_job_cancel(cli);
+            continue;
+        }
+        cli->ahead[(cli->ahead_head + cli->ahead_len) % CLI_AHEAD_SIZE] = *ch;
+        cli->ahead_len++;
+    }
+}
+
+static int cli_key_detect(cli_t *cli, char *data, cli_key_t *key)
 {
     char ch;
     enum {
@@ -371,12 +643,13 @@ static int cli_key_detect(TUYA_UART_NUM_E port_id, char *data, cli_key_t *key)
     } state = CHECK_KEY;
 
     for (;;) {
-        tal_uart_read(port_id, (uint8_t *)&ch, 1);
+        cli_getc(cli, &ch);
 
         switch (state) {
 
         case CHECK_KEY:
-            if (CLI_ENTER_KEY == ch || CLI_ENTER2_KEY == ch || CLI_BACKSPACE_KEY == ch || CLI_BACKSPACE2_KEY == ch || CLI_TABLE_KEY == ch) {
+            if (CLI_ENTER_KEY == ch || CLI_ENTER2_KEY == ch || CLI_BACKSPACE_KEY == ch || CLI_BACKSPACE2_KEY == ch || CLI_TABLE_KEY == ch ||
+                CLI_CTRL_C_KEY == ch) {
                 *key = ch;
                 return OPRT_OK;
             } else if (CLI_ESC_KEY == ch) {
@@ -412,8 +685,8 @@ static int cli_key_detect(TUYA_UART_NUM_E port_id, char *data, cli_key_t *key)
 
 static void cli_print_prompt(cli_t *cli)
 {
-    cli_out_put(cli->port_id, "\r\n", 2);
-    cli_out_put(cli->port_id, cli->prompt, strlen(cli->prompt));
+    cli_out_put(cli, "\r\n", 2);
+    cli_out_put(cli, cli->prompt, strlen(cli->prompt));
 }
 
 static int cli_parse_buffer(char *buffer, int *argc, char **argv)
@@ -474,35 +747,294 @@ __exit:
     return OPRT_OK;
 }
 
-static int cli_cmd_exec(int argc, char **argv)
+static void cli_filter_emit(cli_filter_t *filter)
+{
+    cli_sink_write(filter->sink.next, "\r\n", 2);
+    cli_sink_write(filter->sink.next, filter->line, filter->len);
+}
+
+static void cli_filter_line(cli_filter_t *filter)
 {
+    filter->line[filter->len] = '\0';
+
+    switch (filter->type) {
+
+    case CLI_FILTER_GREP:
+        if ((NULL != strstr(filter->line, filter->pattern)) != filter->invert) {
+            cli_filter_emit(filter);
+        }
+        break;
+
+    case CLI_FILTER_HEAD:
+        if (filter->lines < filter->limit) {
+            filter->lines++;
+            cli_filter_emit(filter);
+        }
+        filter->full = filter->lines >= filter->limit;
+        break;
+
+    case CLI_FILTER_COUNT:
+        filter->lines++;
+        break;
+    }
+
+    filter->len = 0;
+}
+
+static void cli_filter_write(cli_sink_t *sink, const char *data, uint32_t len)
+{
+    cli_filter_t *filter = (cli_filter_t *)sink;
+
+    for (; len; data++, len--) {
+        if ('\n' == *data) {
+            if (filter->len) {
+                cli_filter_line(filter);
+            }
+            continue;
+        }
+        if ('\r' == *data) {
+            continue;
+        }
+        if (CLI_FILTER_LINE_MAX == filter->len) {
+            cli_filter_line(filter);
+        }
+        filter->line[filter->len++] = *data;
+    }
+}
+
+static void cli_filter_finish(cli_filter_t *filter)
+{
+    char count[16];
+
+    if (filter->len) {
+        cli_filter_line(filter);
+    }
+    if (CLI_FILTER_COUNT == filter->type) {
+        snprintf(count, sizeof(count), "\r\n%u", (unsigned)filter->lines);
+        cli_sink_write(filter->sink.next, count, strlen(count));
+    }
+}
+
+//! grep [-v] <text>, head [lines], count
+static int cli_filter_parse(cli_filter_t *filter, int argc, char **argv)
+{
+    memset(filter, 0, sizeof(cli_filter_t));
+    filter->sink.write = cli_filter_write;
+
+    if (0 == strcmp(argv[0], "grep") && (2 == argc || (3 == argc && 0 == strcmp(argv[1], "-v")))) {
+        filter->type = CLI_FILTER_GREP;
+        filter->invert = (3 == argc);
+        filter->pattern = argv[argc - 1];
+    } else if (0 == strcmp(argv[0], "head") && argc <= 2) {
+        filter->type = CLI_FILTER_HEAD;
+        filter->limit = (2 == argc) ? strtoul(argv[1], NULL, 10) : 10;
+        if (0 == filter->limit) {
+            return OPRT_INVALID_PARM;
+        }
+    } else if (0 == strcmp(argv[0], "count") && 1 == argc) {
+        filter->type = CLI_FILTER_COUNT;
+    } else {
+        return OPRT_INVALID_PARM;
+    }
+
+    return OPRT_OK;
+}
+
+static void cli_ctx_print(cli_ctx_t *ctx, const char *string)
+{
+    if (!ctx->canceled) {
+        cli_sink_write(ctx->out, "\r\n", 2);
+        cli_sink_write(ctx->out, string, strlen(string));
+    }
+}
+
+//! runs "cmd args | filter args | ...", line is split in place
+static int cli_line_exec(cli_ctx_t *ctx, char *line)
+{
+    char *segment[CLI_PIPE_NUM + 1];
+    char *argv[CLI_ARGV_NUM];
+    cli_filter_t *filter = NULL;
+    cli_sink_t *out = ctx->out;
+    cli_cmd_t *cmd = NULL;
+    int argc = 0, num = 0, i;
+    int result = OPRT_OK;
+
+    for (segment[num++] = line; NULL != (line = strchr(line, '|'));) {
+        if (CLI_PIPE_NUM < num) {
+            cli_ctx_print(ctx, "Too many pipes");
+            return OPRT_INVALID_PARM;
+        }
+        *line++ = '\0';
+        segment[num++] = line;
+    }
+
+    if (num > 1) {
+        filter = tal_malloc((num - 1) * sizeof(cli_filter_t));
+        if (NULL == filter) {
+            return OPRT_MALLOC_FAILED;
+        }
+        //! the last filter writes where the line does
+        for (i = num - 1; i > 0; i--) {
+            cli_parse_buffer(segment[i], &argc, argv);
+            if (0 == argc || OPRT_OK != cli_filter_parse(&filter[i - 1], argc, argv)) {
+                cli_ctx_print(ctx, "Bad filter, use grep [-v] <text>, head [lines] or count");
+                tal_free(filter);
+                return OPRT_INVALID_PARM;
+            }
+            filter[i - 1].sink.next = (num - 1 == i) ? out : &filter[i].sink;
+        }
+        ctx->out = &filter[0].sink;
+    }
+
+    cli_parse_buffer(segment[0], &argc, argv);
+    if (argc) {
+        cmd = cli_cmd_find_with_name(argv[0]);
+        if (cmd) {
+            cmd->func(argc, argv);
+        } else {
+            result = OPRT_NOT_FOUND;
+        }
+    }
+
+    //! in order, a filter may still write to the next one
+    for (i = 0; i < num - 1 && !ctx->canceled; i++) {
+        cli_filter_finish(&filter[i]);
+    }
+    ctx->out = out;
+    tal_free(filter);
+
+    if (OPRT_NOT_FOUND == result) {
+        cli_ctx_print(ctx, "No command or file name");
+    }
+
+    return result;
+}
+
+static void cli_help(int argc, char *argv[])
+{
+    int i, j;
     cli_cmd_t *cmd;
+    cli_cmd_node_t *node = NULL;
+    SLIST_HEAD *pos = NULL;
 
-    cmd = cli_cmd_find_with_name(argv[0]);
-    if (cmd) {
-        cmd->func(argc, argv);
-        return OPRT_OK;
+    for (i = 0; i < CLI_CMD_TABLE_NUM; i++) {
+        for (j = 0; j < s_cli_static_table[i].num; j++) {
+            cmd = s_cli_static_table[i].cmd + j;
+            tal_cli_printf("\r\n%-*.*s\t%s", CLI_CMD_NAME_MAX, CLI_CMD_NAME_MAX, cmd->name, cmd->help);
+        }
     }
 
-    return OPRT_NOT_FOUND;
+    SLIST_FOR_EACH_ENTRY(node, cli_cmd_node_t, pos, &s_cli_dynamic_table, next)
+    {
+        for (i = 0; i < node->table.num; i++) {
+            cmd = node->table.cmd + i;
+            tal_cli_printf("\r\n%-*.*s\t%s", CLI_CMD_NAME_MAX, CLI_CMD_NAME_MAX, cmd->name, cmd->help);
+        }
+    }
 }
 
-static void cli_enter_key(cli_t *cli)
+//! blank lines and lines starting with '#' are skipped
+static void cli_source(int argc, char *argv[])
 {
-    int result;
+    cli_ctx_t *ctx = s_cli_ctx;
+    TUYA_FILE file = NULL;
+    char *buffer = NULL, *line = NULL;
+    uint32_t num = 0;
+    size_t len = 0;
+
+    if (2 != argc) {
+        tal_cli_echo("Use like: source <file>");
+        return;
+    }
+    if (NULL == ctx || CLI_SCRIPT_DEPTH <= ctx->depth) {
+        tal_cli_echo("Scripts nested too deep");
+        return;
+    }
+    file = tal_fopen(argv[1], "r");
+    if (NULL == file) {
+        tal_cli_printf("\r\n%s: can't open", argv[1]);
+        return;
+    }
+    buffer = tal_malloc(CLI_BUFFER_SIZE + 1);
+    if (NULL == buffer) {
+        tal_fclose(file);
+        return;
+    }
 
+    ctx->depth++;
+    while (!tal_cli_canceled() && tal_fgets(buffer, CLI_BUFFER_SIZE + 1, file)) {
+        num++;
+        len = strlen(buffer);
+        if (CLI_BUFFER_SIZE == len && '\n' != buffer[len - 1]) {
+            tal_cli_printf("\r\n%s:%u: line too long", argv[1], (unsigned)num);
+            while (tal_fgets(buffer, CLI_BUFFER_SIZE + 1, file) && '\n' != buffer[strlen(buffer) - 1]) {
+            }
+            continue;
+        }
+        while (len && ('\n' == buffer[len - 1] || '\r' == buffer[len - 1] || ' ' == buffer[len - 1])) {
+            buffer[--len] = '\0';
+        }
+        for (line = buffer; ' ' == *line; line++) {
+        }
+        if ('\0' == *line || '#' == *line) {
+            continue;
+        }
+        cli_line_exec(ctx, line);
+    }
+    ctx->depth--;
+
+    tal_free(buffer);
+    tal_fclose(file);
+}
+
+static void cli_job_task(void *parameter)
+{
+    cli_t *cli = (cli_t *)parameter;
+
+    for (;;) {
+        tal_semaphore_wait(cli->job_sem, SEM_WAIT_FOREVER);
+
+        tal_mutex_lock(s_cli_exec_mutex);
+        s_cli_ctx = &cli->job;
+        cli_line_exec(&cli->job, cli->line);
+        s_cli_ctx = NULL;
+        tal_mutex_unlock(s_cli_exec_mutex);
+
+        //! not when Ctrl-C gave the prompt back already
+        if (cli_fg_end(cli)) {
+            cli_print_prompt(cli);
+        }
+        cli_out_flush(cli);
+        tal_semaphore_post(cli->idle_sem);
+    }
+}
+
+static void cli_enter_key(cli_t *cli)
+{
     if (0 == cli->index) {
         cli_print_prompt(cli);
         return;
     }
     cli->buffer[cli->index] = 0;
     cli_histroy_data_save(cli);
-    cli_parse_buffer(cli->buffer, &cli->argc, cli->argv);
-    cli_out_put(cli->port_id, "\r\n", 2);
-    result = cli_cmd_exec(cli->argc, cli->argv);
-    if (OPRT_OK != result) {
-        cli_print_string(cli, "No command or file name");
-    }
+    cli_out_put(cli, "\r\n", 2);
+    cli_out_flush(cli);
+
+    //! a job canceled with Ctrl-C may still be on its way out
+    tal_semaphore_wait(cli->idle_sem, SEM_WAIT_FOREVER);
+    memcpy(cli->line, cli->buffer, cli->index + 1);
+    cli->job.canceled = 0;
+    cli->fg = 1;
+    tal_semaphore_post(cli->job_sem);
+
+    cli->index = 0;
+    cli->insert = 0;
+    memset(cli->buffer, 0, sizeof(cli->buffer));
+}
+
+static void cli_ctrl_c_key(cli_t *cli)
+{
+    cli_out_put(cli, "^C", 2);
     cli_print_prompt(cli);
     cli->index = 0;
     cli->insert = 0;
@@ -520,18 +1052,18 @@ static void cli_backspace_key(cli_t *cli)
         cli->insert--;
         memmove(&cli->buffer[cli->insert], &cli->buffer[cli->insert + 1], cli->index - cli->insert);
         cli->buffer[cli->index] = '\0';
-        cli_out_put(cli->port_id, &ch, 1);
-        cli_out_put(cli->port_id, &cli->buffer[cli->insert], cli->index - cli->insert);
-        cli_out_put(cli->port_id, " \b", 2);
+        cli_out_put(cli, &ch, 1);
+        cli_out_put(cli, &cli->buffer[cli->insert], cli->index - cli->insert);
+        cli_out_put(cli, " \b", 2);
         int i;
         for (i = 0; i < (cli->index - cli->insert); i++) {
-            cli_out_put(cli->port_id, &ch, 1);
+            cli_out_put(cli, &ch, 1);
         }
     } else {
         cli->index--;
         cli->insert--;
         cli->buffer[cli->insert] = '\0';
-        cli_out_put(cli->port_id, "\b \b", 3);
+        cli_out_put(cli, "\b \b", 3);
     }
 }
 
@@ -543,15 +1075,15 @@ static void cli_up_key(cli_t *cli)
 
     if (cli_histroy_data_perv(cli, &history_data)) {
         ch = '\r';
-        cli_out_put(cli->port_id, &ch, 1);
+        cli_out_put(cli, &ch, 1);
         ch = ' ';
         for (i = 0; i < cli->index + strlen(cli->prompt); i++) {
-            cli_out_put(cli->port_id, &ch, 1);
+            cli_out_put(cli, &ch, 1);
         }
         ch = '\r';
-        cli_out_put(cli->port_id, &ch, 1);
-        cli_out_put(cli->port_id, cli->prompt, strlen(cli->prompt));
-        cli_out_put(cli->port_id, (char *)history_data, strlen((char *)history_data));
+        cli_out_put(cli, &ch, 1);
+        cli_out_put(cli, cli->prompt, strlen(cli->prompt));
+        cli_out_put(cli, (char *)history_data, strlen((char *)history_data));
         strcpy(cli->buffer, (char *)history_data);
         cli->index = strlen(cli->buffer);
         cli->buffer[cli->index] = '\0';
@@ -567,15 +1099,15 @@ static void cli_down_key(cli_t *cli)
 
     if (cli_histroy_data_next(cli, &history_data)) {
         ch = '\r';
-        cli_out_put(cli->port_id, &ch, 1);
+        cli_out_put(cli, &ch, 1);
         ch = ' ';
         for (i = 0; i < cli->index + strlen(cli->prompt); i++) {
-            cli_out_put(cli->port_id, &ch, 1);
+            cli_out_put(cli, &ch, 1);
         }
         ch = '\r';
-        cli_out_put(cli->port_id, &ch, 1);
-        cli_out_put(cli->port_id, cli->prompt, strlen(cli->prompt));
-        cli_out_put(cli->port_id, (char *)history_data, strlen((char *)history_data));
+        cli_out_put(cli, &ch, 1);
+        cli_out_put(cli, cli->prompt, strlen(cli->prompt));
+        cli_out_put(cli, (char *)history_data, strlen((char *)history_data));
         strcpy(cli->buffer, (char *)history_data);
         cli->index = strlen(cli->buffer);
         cli->buffer[cli->index] = '\0';
@@ -588,7 +1120,7 @@ static void cli_letf_key(cli_t *cli)
     char ch = '\b';
 
     if (cli->insert) {
-        cli_out_put(cli->port_id, &ch, 1);
+        cli_out_put(cli, &ch, 1);
         cli->insert--;
     }
 }
@@ -599,7 +1131,7 @@ static void cli_right_key(cli_t *cli)
 
     if (cli->insert < cli->index) {
         ch = cli->buffer[cli->insert];
-        cli_out_put(cli->port_id, &ch, 1);
+        cli_out_put(cli, &ch, 1);
         cli->insert++;
     }
 }
@@ -638,6 +1170,10 @@ static void cli_key_app(cli_t *cli, cli_key_t key)
         cli_right_key(cli);
         break;
 
+    case CLI_CTRL_C_KEY:
+        cli_ctrl_c_key(cli);
+        break;
+
     default:
         break;
     }
@@ -655,7 +1191,9 @@ static void cli_task(void *parameter)
     cli->echo = 1;
 
     for (;;) {
-        cli_key_detect(cli->port_id, &data, &key);
+        //! what the last key printed
+        cli_out_flush(cli);
+        cli_key_detect(cli, &data, &key);
         if (CLI_NULL_KEY != key) {
             cli_key_app(cli, key);
             continue;
@@ -670,12 +1208,12 @@ static void cli_task(void *parameter)
             memmove(&cli->buffer[cli->insert + 1], &cli->buffer[cli->insert], cli->index - cli->insert);
             cli->buffer[cli->insert] = data;
             cli->index++;
-            cli_out_put(cli->port_id, &cli->buffer[cli->insert], cli->index - cli->insert);
+            cli_out_put(cli, &cli->buffer[cli->insert], cli->index - cli->insert);
             int i;
             char ch = '\b';
             cli->insert++;
             for (i = 0; i < (cli->index - cli->insert); i++) {
-                cli_out_put(cli->port_id, &ch, 1);
+                cli_out_put(cli, &ch, 1);
             }
             continue;
         } else {
@@ -683,7 +1221,7 @@ static void cli_task(void *parameter)
             cli->insert = cli->index;
         }
         if (cli->echo) {
-            cli_out_put(cli->port_id, &data, 1);
+            cli_out_put(cli, &data, 1);
         }
     }
 }
@@ -691,6 +1229,21 @@ static void cli_task(void *parameter)
 static int cli_cmd_register(cli_cmd_t *cmd, uint8_t num)
 {
     int i = 0;
+    cli_cmd_node_t *node = NULL;
+    SLIST_HEAD *pos = NULL;
+
+    //! a table registered again is already there
+    for (i = 0; i < CLI_CMD_TABLE_NUM; i++) {
+        if (cmd == s_cli_static_table[i].cmd) {
+            return OPRT_OK;
+        }
+    }
+    SLIST_FOR_EACH_ENTRY(node, cli_cmd_node_t, pos, &s_cli_dynamic_table, next)
+    {
+        if (cmd == node->table.cmd) {
+            return OPRT_OK;
+        }
+    }
 
     for (i = 0; i < CLI_CMD_TABLE_NUM; i++) {
         if (s_cli_static_table[i].cmd) {
@@ -698,9 +1251,9 @@ static int cli_cmd_register(cli_cmd_t *cmd, uint8_t num)
         }
         s_cli_static_table[i].cmd = cmd;
         s_cli_static_table[i].num = num;
-        return OPRT_OK;
+        goto __index;
     }
-    cli_cmd_node_t *node = tal_malloc(sizeof(cli_cmd_node_t));
+    node = tal_malloc(sizeof(cli_cmd_node_t));
     if (NULL == node) {
         return OPRT_MALLOC_FAILED;
     }
@@ -708,9 +1261,31 @@ static int cli_cmd_register(cli_cmd_t *cmd, uint8_t num)
     node->table.num = num;
     tuya_slist_add_head(&s_cli_dynamic_table, &node->next);
 
+__index:
+    for (i = 0; i < num; i++) {
+        cli_cmd_index(cmd + i);
+    }
+
     return OPRT_OK;
 }
 
+//! what tal_cli_exec needs without the console
+static int cli_core_init(void)
+{
+    if (NULL == s_cli_exec_mutex && OPRT_OK != tal_mutex_create_init(&s_cli_exec_mutex)) {
+        return OPRT_COM_ERROR;
+    }
+
+    return cli_cmd_register((cli_cmd_t *)s_cli_cmd, CNTSOF(s_cli_cmd));
+}
+
+static void cli_cb_write(cli_sink_t *sink, const char *data, uint32_t len)
+{
+    cli_cb_sink_t *cb_sink = (cli_cb_sink_t *)sink;
+
+    cb_sink->cb(data, len, cb_sink->arg);
+}
+
 /**
  * @brief cli echo string
  *
@@ -721,7 +1296,105 @@ static int cli_cmd_register(cli_cmd_t *cmd, uint8_t num)
  */
 void tal_cli_echo(char *string)
 {
-    cli_print_string(s_cli_handle, string);
+    cli_job_write("\r\n", 2);
+    cli_job_write(string, strlen(string));
+    cli_job_flush();
+}
+
+/**
+ * @brief Prints formatted output of a command, cut at CLI_PRINTF_MAX bytes.
+ *
+ * @param[in] fmt printf format
+ *
+ * @return None
+ */
+void tal_cli_printf(const char *fmt, ...)
+{
+    char buffer[CLI_PRINTF_MAX];
+    va_list ap;
+    int len;
+
+    va_start(ap, fmt);
+    len = vsnprintf(buffer, sizeof(buffer), fmt, ap);
+    va_end(ap);
+    if (len <= 0) {
+        return;
+    }
+
+    cli_job_write(buffer, MIN((uint32_t)len, sizeof(buffer) - 1));
+    cli_job_flush();
+}
+
+/**
+ * @brief Checks whether the command line running was canceled.
+ *
+ * A line is canceled by Ctrl-C, or once a head filter it writes to got its
+ * lines.
+ *
+ * @return 1 if it was canceled, 0 otherwise
+ */
+int tal_cli_canceled(void)
+{
+    cli_ctx_t *ctx = s_cli_ctx;
+    cli_sink_t *sink = NULL;
+
+    if (NULL == ctx) {
+        return 0;
+    }
+    if (ctx->canceled) {
+        return 1;
+    }
+    for (sink = ctx->out; sink; sink = sink->next) {
+        if (cli_filter_write == sink->write && ((cli_filter_t *)sink)->full) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Runs a command line in the calling thread.
+ *
+ * @param line The command line, pipes and scripts included.
+ * @param out Gets the output, NULL sends it to the console.
+ * @param arg Passed to out.
+ * @return Returns OPRT_OK if the command ran, OPRT_NOT_FOUND if there is no
+ * such command, OPRT_INVALID_PARM if a filter is malformed, or an error code.
+ */
+int tal_cli_exec(const char *line, cli_out_cb_t out, void *arg)
+{
+    cli_cb_sink_t cb_sink = {.sink = {.next = NULL, .write = cli_cb_write}, .cb = out, .arg = arg};
+    cli_ctx_t ctx = {.out = out ? &cb_sink.sink : NULL};
+    char *buffer = NULL;
+    size_t len = 0;
+    int result = OPRT_OK;
+
+    if (NULL == line) {
+        return OPRT_INVALID_PARM;
+    }
+    result = cli_core_init();
+    if (OPRT_OK != result) {
+        return result;
+    }
+
+    len = strlen(line);
+    buffer = tal_malloc(len + 1);
+    if (NULL == buffer) {
+        return OPRT_MALLOC_FAILED;
+    }
+    memcpy(buffer, line, len + 1);
+
+    tal_mutex_lock(s_cli_exec_mutex);
+    s_cli_ctx = &ctx;
+    result = cli_line_exec(&ctx, buffer);
+    s_cli_ctx = NULL;
+    tal_mutex_unlock(s_cli_exec_mutex);
+
+    tal_free(buffer);
+    cli_job_flush();
+
+    return result;
 }
 
 /**
@@ -758,12 +1431,20 @@ int tal_cli_init_with_uart(uint8_t uart_num)
     if (s_cli_handle) {
         return OPRT_OK;
     }
+    if (OPRT_OK != cli_core_init()) {
+        return OPRT_COM_ERROR;
+    }
     s_cli_handle = tal_malloc(sizeof(cli_t));
     if (NULL == s_cli_handle) {
         return OPRT_MALLOC_FAILED;
     }
     memset(s_cli_handle, 0, sizeof(cli_t));
     s_cli_handle->port_id = uart_num;
+    if (OPRT_OK != tal_mutex_create_init(&s_cli_handle->out_mutex) ||
+        OPRT_OK != tal_semaphore_create_init(&s_cli_handle->job_sem, 0, 1) ||
+        OPRT_OK != tal_semaphore_create_init(&s_cli_handle->idle_sem, 1, 1)) {
+        goto __exit;
+    }
     TAL_UART_CFG_T cfg = {0};
     cfg.base_cfg.baudrate = 115200;
     cfg.base_cfg.databits = TUYA_UART_DATA_LEN_8BIT;
@@ -776,23 +1457,44 @@ int tal_cli_init_with_uart(uint8_t uart_num)
         PR_ERR("uart init failed", result);
         goto __exit;
     }
-    tal_cli_cmd_register((cli_cmd_t *)&s_cli_cmd, 1);
 
     THREAD_CFG_T param;
 
     param.priority = THREAD_PRIO_3;
-    param.stackDepth = 3072;
+    param.stackDepth = CLI_JOB_STACK_SIZE;
+    param.thrdname = "cli_job";
+
+    result = tal_thread_create_and_start(&s_cli_handle->job_thread, NULL, NULL, cli_job_task, s_cli_handle, &param);
+    if (OPRT_OK != result) {
+        PR_ERR("tuya cli create thread failed %d", result);
+        tal_uart_deinit(uart_num);
+        goto __exit;
+    }
+
+    //! commands run on the job thread, the console only edits the line
+    param.stackDepth = 2048;
     param.thrdname = "cli";
 
     result = tal_thread_create_and_start(&s_cli_handle->thread, NULL, NULL, cli_task, s_cli_handle, &param);
     if (OPRT_OK != result) {
         PR_ERR("tuya cli create thread failed %d", result);
+        tal_thread_delete(s_cli_handle->job_thread);
+        tal_uart_deinit(uart_num);
         goto __exit;
     }
 
     return OPRT_OK;
 
 __exit:
+    if (s_cli_handle->idle_sem) {
+        tal_semaphore_release(s_cli_handle->idle_sem);
+    }
+    if (s_cli_handle->job_sem) {
+        tal_semaphore_release(s_cli_handle->job_sem);
+    }
+    if (s_cli_handle->out_mutex) {
+        tal_mutex_release(s_cli_handle->out_mutex);
+    }
     tal_free(s_cli_handle);
     s_cli_handle = NULL;
 
@@ -23,13 +23,24 @@ extern "C" {
 
 typedef struct {
     uint32_t rx_buffer_size;
-#ifdef CONFIG_TX_ASYNC
-    uint32_t tx_buffer_size;
-#endif
+    uint32_t tx_buffer_size; // tx ring of O_ASYNC_WRITE and O_TX_DMA
     uint8_t open_mode;
     TUYA_UART_BASE_CFG_T base_cfg;
 } TAL_UART_CFG_T;
 
+/**
+ * @brief uart tx done callback
+ *
+ * @param[in] port_id: uart port id
+ * @param[in] arg: the argument given to tal_uart_tx_done_cb_reg
+ *
+ * @note O_ASYNC_WRITE and O_TX_DMA call it in the tx interrupt once the tx ring
+ * is sent out, the blocking write calls it before tal_uart_write returns.
+ *
+ * @return none
+ */
+typedef void (*TAL_UART_TX_DONE_CB)(TUYA_UART_NUM_E port_id, void *arg);
+
 /**
  * @brief init uart
  *
@@ -65,6 +76,23 @@ OPERATE_RET tal_uart_init(TUYA_UART_NUM_E port_id, TAL_UART_CFG_T *cfg);
  */
 int tal_uart_read(TUYA_UART_NUM_E port_id, uint8_t *data, uint32_t len);
 
+/**
+ * @brief read data from uart, wait at most timeout_ms for it
+ *
+ * @param[in] port_id: uart port id, id index starts from 0
+ * @param[in] data: read data buffer
+ * @param[in] len: the read size
+ * @param[in] timeout_ms: the max wait time, SEM_WAIT_FOREVER to wait until
+ * data arrives
+ *
+ * @note The wait ends once len bytes are received or the line goes idle. An
+ * interrupt driven port goes idle at the end of every rx interrupt, an
+ * O_RX_DMA port when its driver reports the idle line.
+ *
+ * @return >=0, the read size, 0 on timeout; < 0, read error
+ */
+int tal_uart_read_timeout(TUYA_UART_NUM_E port_id, uint8_t *data, uint32_t len, uint32_t timeout_ms);
+
 /**
  * @brief send data by uart
  *
@@ -130,6 +158,46 @@ typedef void (*TAL_UART_IRQ_CB)(TUYA_UART_NUM_E port_id, void *buff, uint16_t le
  */
 void tal_uart_rx_reg_irq_cb(TUYA_UART_NUM_E port_id, TAL_UART_IRQ_CB rx_cb);
 
+/**
+ * @brief register the tx done callback
+ *
+ * @param[in] port_id: uart port id
+ * @param[in] cb: tx done callback, NULL to remove it
+ * @param[in] arg: argument of cb
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tal_uart_tx_done_cb_reg(TUYA_UART_NUM_E port_id, TAL_UART_TX_DONE_CB cb, void *arg);
+
+/**
+ * @brief get the rx ring area a DMA can fill next
+ *
+ * @param[in] port_id: uart port id
+ * @param[out] buf: start of the area
+ *
+ * @note For the tkl drivers of ports opened with O_RX_DMA, which fill the rx
+ * ring in place instead of raising the rx interrupt. When it returns 0 the
+ * ring is full, the driver stops receiving until tal calls
+ * tkl_uart_set_rx_flowctrl(port_id, FALSE).
+ *
+ * @return length of the area
+ */
+uint32_t tal_uart_dma_rx_buf_get(TUYA_UART_NUM_E port_id, uint8_t **buf);
+
+/**
+ * @brief hand the bytes a DMA received to the readers
+ *
+ * @param[in] port_id: uart port id
+ * @param[in] len: bytes filled in the area of tal_uart_dma_rx_buf_get
+ * @param[in] idle: TRUE when called for the idle line, FALSE for a full or
+ * half full DMA buffer
+ *
+ * @note Called by the tkl driver in its DMA or idle line interrupt.
+ *
+ * @return none
+ */
+void tal_uart_dma_rx_done(TUYA_UART_NUM_E port_id, uint32_t len, BOOL_T idle);
+
 /**
  * @brief get rx data size
  *
@@ -11,11 +11,20 @@
  * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
  *
  */
+#include "tkl_system.h"
 #include "tkl_uart.h"
 #include "tal_uart.h"
 #include "tuya_slist.h"
 #include "tuya_ringbuf.h"
-#include "tal_api.h"
+#include "tal_memory.h"
+#include "tal_mutex.h"
+#include "tal_semaphore.h"
+#include "tal_system.h"
+
+// tkl_uart_read and tkl_uart_write move at most this many bytes per call
+#define UART_BLOCK_MAX 0xFFFF
+
+#define UART_TX_ASYNC(mode) ((mode) & (O_ASYNC_WRITE | O_TX_DMA))
 
 typedef struct uart_dev_node {
     SLIST_HEAD node;
@@ -23,14 +32,18 @@ typedef struct uart_dev_node {
     uint32_t open_mode;
     SEM_HANDLE rx_ring_sem;
     TUYA_RINGBUFF_T rx_ring;
-#ifdef CONFIG_UART_ASYNC_WRITE
-    TKL_SEM_HANDLE tx_ring_sem;
+    SEM_HANDLE tx_ring_sem;
     TUYA_RINGBUFF_T tx_ring;
-#endif
+    uint32_t tx_sending;  // bytes of tx_ring handed to tkl_uart_write, 0 while tx is idle
+    uint32_t rx_wake_len; // received bytes that wake the reader before the line goes idle
+    uint16_t rx_idle;     // the line went idle since the last read
+    uint16_t rx_stopped;  // rx is held off because rx_ring was full
     uint16_t wait_rx_flag;
     uint16_t wait_tx_flag;
     SEM_HANDLE rx_block_sem;
     SEM_HANDLE tx_block_sem;
+    TAL_UART_TX_DONE_CB tx_done_cb;
+    void *tx_done_arg;
 } TAL_UART_DEV;
 
 struct single_mutext_list {
@@ -83,40 +96,73 @@ OPERATE_RET uart_list_delete_one_node(TAL_UART_DEV *uart_info)
     return OPRT_OK;
 }
 
-#ifdef CONFIG_UART_ASYNC_WRITE
-void uart_tx_chars_in_isr(uint32_t port_num)
+static void uart_tx_start(TAL_UART_DEV *uart_info)
+{
+    uint8_t *tx_buf = NULL;
+    uint32_t len = 0;
+
+    TKL_ENTER_CRITICAL();
+    if (uart_info->tx_sending == 0) {
+        len = MIN(tuya_ring_buff_read_region_get(uart_info->tx_ring, &tx_buf), UART_BLOCK_MAX);
+        uart_info->tx_sending = len;
+    }
+    TKL_EXIT_CRITICAL();
+
+    if (len == 0) {
+        return;
+    }
+
+    /*
+     * The driver sends the area of the ring in place, by DMA or from its tx
+     * interrupt, and calls uart_tx_chars_in_isr once it is sent. The area is
+     * only released then.
+     */
+    if (tkl_uart_write(uart_info->port_num, tx_buf, len) <= 0) {
+        uart_info->tx_sending = 0;
+    }
+}
+
+void uart_tx_chars_in_isr(TUYA_UART_NUM_E port_num)
 {
     TAL_UART_DEV *uart_info = uart_list_get_one_node(port_num);
-    if (uart_info == NULL) {
+    if ((uart_info == NULL) || (uart_info->tx_ring == NULL)) {
         return;
     }
 
-    ring_buffer_s *tx_ring = uart_info->tx_ring;
-    uint8_t tx_byte;
-    uint8_t tx_count = 0;
+    uint32_t tx_bytes = 0;
 
-    while (1) {
-        ret = tuya_ring_buff_read(tx_ring, &tx_byte, 1);
-        if (ret != 1) {
-            break;
-        }
+    TKL_ENTER_CRITICAL();
+    tx_bytes = tuya_ring_buff_read_commit(uart_info->tx_ring, uart_info->tx_sending);
+    uart_info->tx_sending = 0;
+    TKL_EXIT_CRITICAL();
 
-        ret = tkl_uart_write(port_num, &tx_byte, 1);
-        if (ret != 1) {
-            break;
-        }
+    if (tx_bytes == 0) {
+        return;
+    }
 
-        tx_count++;
+    if (uart_info->wait_tx_flag == TRUE) {
+        uart_info->wait_tx_flag = FALSE;
+        tal_semaphore_post(uart_info->tx_block_sem);
     }
 
-    if ((uart_info->open_mode & O_BLOCK) && (tx_count > 0)) {
-        if (uart_info->wait_rx_flag == TRUE) {
-            uart_info->wait_rx_flag = FALSE;
-            tal_semaphore_post(uart_info->tx_block_sem);
-        }
+    uart_tx_start(uart_info);
+    if ((uart_info->tx_sending == 0) && (uart_info->tx_done_cb != NULL)) {
+        uart_info->tx_done_cb(port_num, uart_info->tx_done_arg);
+    }
+}
+
+static void uart_rx_wakeup(TAL_UART_DEV *uart_info, BOOL_T idle)
+{
+    if (idle) {
+        uart_info->rx_idle = TRUE;
+    }
+
+    if ((uart_info->wait_rx_flag == TRUE) &&
+        (idle || tuya_ring_buff_used_size_get(uart_info->rx_ring) >= uart_info->rx_wake_len)) {
+        uart_info->wait_rx_flag = FALSE;
+        tal_semaphore_post(uart_info->rx_block_sem);
     }
 }
-#endif
 
 void uart_rx_chars_in_isr(TUYA_UART_NUM_E port_num)
 {
@@ -125,40 +171,51 @@ void uart_rx_chars_in_isr(TUYA_UART_NUM_E port_num)
         return;
     }
 
-    uint8_t rx_char;
-    int ret = 0;
+    uint8_t *rx_buf = NULL;
+    uint8_t rx_drop[16];
+    uint32_t room = 0;
     uint32_t rx_bytes = 0;
+    int ret = 0;
 
     /*
-     * When the software buffer is full, the data read will not be written into
-     * the software buffer. However, it will continue to read the content of the
-     * hardware buffer until it is empty.
+     * The driver reads straight into the free area of the software buffer, a
+     * read shorter than the area means the hardware buffer is empty.
      */
     while (1) {
-        ret = tkl_uart_read(port_num, &rx_char, 1);
-        if (ret != 1) {
+        room = MIN(tuya_ring_buff_write_region_get(uart_info->rx_ring, &rx_buf), UART_BLOCK_MAX);
+        if (room == 0) {
             break;
         }
 
-        ret = tuya_ring_buff_write(uart_info->rx_ring, &rx_char, 1);
-        if (ret != 1) {
+        ret = tkl_uart_read(port_num, rx_buf, room);
+        if (ret <= 0) {
             break;
         }
 
-        rx_bytes++;
-
-#if OPERATING_SYSTEM == SYSTEM_LINUX
-        break;
-#endif
+        tuya_ring_buff_write_commit(uart_info->rx_ring, ret);
+        rx_bytes += ret;
+        if (ret < room) {
+            break;
+        }
     }
 
-#ifdef CONFIG_UART_FLOW_CONTRAL
-
-#endif
+    /*
+     * When the software buffer is full, flow control leaves the data in the
+     * hardware buffer until a read makes room. Without it, the content of the
+     * hardware buffer is read until it is empty and dropped.
+     */
+    if (room == 0) {
+        if ((uart_info->open_mode & O_FLOW_CTRL) && (tkl_uart_set_rx_flowctrl(port_num, TRUE) == OPRT_OK)) {
+            uart_info->rx_stopped = TRUE;
+        } else {
+            while (tkl_uart_read(port_num, rx_drop, sizeof(rx_drop)) == sizeof(rx_drop)) {
+            }
+        }
+    }
 
-    if ((rx_bytes >= 1) && (uart_info->wait_rx_flag == TRUE)) {
-        uart_info->wait_rx_flag = FALSE;
-        tal_semaphore_post(uart_info->rx_block_sem);
+    // the interrupt comes once the hardware buffer is drained, the line is idle
+    if (rx_bytes >= 1) {
+        uart_rx_wakeup(uart_info, TRUE);
     }
 
     return;
@@ -174,7 +231,6 @@ void uart_free_source(TAL_UART_DEV *uart_info)
         tal_semaphore_release(uart_info->tx_block_sem);
     }
 
-#ifdef CONFIG_UART_ASYNC_WRITE
     if (uart_info->tx_ring != NULL) {
         tuya_ring_buff_free(uart_info->tx_ring);
     }
@@ -182,7 +238,6 @@ void uart_free_source(TAL_UART_DEV *uart_info)
     if (uart_info->tx_ring_sem != NULL) {
         tal_semaphore_release(uart_info->tx_ring_sem);
     }
-#endif
 
     if (uart_info->rx_ring != NULL) {
         tuya_ring_buff_free(uart_info->rx_ring);
@@ -211,6 +266,10 @@ OPERATE_RET tal_uart_init(TUYA_UART_NUM_E port_num, TAL_UART_CFG_T *cfg)
         return OPRT_INVALID_PARM;
     }
 
+    if (UART_TX_ASYNC(cfg->open_mode) && (cfg->tx_buffer_size == 0)) {
+        return OPRT_INVALID_PARM;
+    }
+
     OPERATE_RET ret = 0;
 
     if (g_uart_list.mutex == NULL) {
@@ -233,12 +292,13 @@ OPERATE_RET tal_uart_init(TUYA_UART_NUM_E port_num, TAL_UART_CFG_T *cfg)
     uart_info->port_num = port_num;
     uart_info->open_mode = cfg->open_mode;
 
-    if (uart_info->open_mode & O_BLOCK) {
-        ret = tal_semaphore_create_init(&uart_info->rx_block_sem, 0, 1);
-        if (ret != OPRT_OK) {
-            goto ERR_EXIT;
-        }
+    // tal_uart_read_timeout waits on rx_block_sem in every open mode
+    ret = tal_semaphore_create_init(&uart_info->rx_block_sem, 0, 1);
+    if (ret != OPRT_OK) {
+        goto ERR_EXIT;
+    }
 
+    if (uart_info->open_mode & O_BLOCK) {
         ret = tal_semaphore_create_init(&uart_info->tx_block_sem, 0, 1);
         if (ret != OPRT_OK) {
             goto ERR_EXIT;
@@ -260,22 +320,31 @@ OPERATE_RET tal_uart_init(TUYA_UART_NUM_E port_num, TAL_UART_CFG_T *cfg)
         goto ERR_EXIT;
     }
 
-#ifdef CONFIG_UART_ASYNC_WRITE
-    tkl_uart_tx_irq_cb_reg(port_num, uart_tx_chars_in_isr);
+    if (UART_TX_ASYNC(uart_info->open_mode)) {
+        ret = tuya_ring_buff_create(cfg->tx_buffer_size, OVERFLOW_STOP_TYPE, &uart_info->tx_ring);
+        if (ret != OPRT_OK) {
+            goto ERR_EXIT;
+        }
 
-    ret = tuya_ring_buff_create(cfg->tx_buffer_size, OVERFLOW_STOP_TYPE, &uart_info->tx_ring);
-    if (ret != OPRT_OK) {
-        goto ERR_EXIT;
+        ret = tal_semaphore_create_init(&uart_info->tx_ring_sem, 1, 1);
+        if (ret != OPRT_OK) {
+            goto ERR_EXIT;
+        }
     }
 
-    ret = tal_semaphore_create_init(&uart_info->tx_ring_sem, 1, 1);
+    ret = uart_list_add_one_node(uart_info);
     if (ret != OPRT_OK) {
         goto ERR_EXIT;
     }
-#endif
 
-    ret = uart_list_add_one_node(uart_info);
-    tkl_uart_rx_irq_cb_reg(port_num, uart_rx_chars_in_isr);
+    if (UART_TX_ASYNC(uart_info->open_mode)) {
+        tkl_uart_tx_irq_cb_reg(port_num, uart_tx_chars_in_isr);
+    }
+
+    // an O_RX_DMA driver fills the ring through tal_uart_dma_rx_buf_get instead
+    if ((uart_info->open_mode & O_RX_DMA) == 0) {
+        tkl_uart_rx_irq_cb_reg(port_num, uart_rx_chars_in_isr);
+    }
 
     return ret;
 
@@ -284,6 +353,71 @@ ERR_EXIT:
     return ret;
 }
 
+static int uart_read(TAL_UART_DEV *uart_info, uint8_t *data, uint32_t len, uint32_t timeout_ms)
+{
+    OPERATE_RET ret = tal_semaphore_wait(uart_info->rx_ring_sem, SEM_WAIT_FOREVER);
+    if (ret != OPRT_OK) {
+        return ret;
+    }
+
+    TUYA_RINGBUFF_T rx_ring = uart_info->rx_ring;
+    uint32_t capacity = tuya_ring_buff_free_size_get(rx_ring) + tuya_ring_buff_used_size_get(rx_ring);
+    uint32_t read_count = 0;
+    uint32_t used = 0;
+    uint32_t waited = 0;
+    SYS_TIME_T start = 0;
+
+    // waiting for more than half of the ring would hold back the driver
+    uart_info->rx_wake_len = MIN(len, MAX(capacity / 2, 1));
+
+    if ((timeout_ms != 0) && (timeout_ms != SEM_WAIT_FOREVER)) {
+        start = tal_system_get_millisecond();
+    }
+
+    while (timeout_ms != 0) {
+        used = tuya_ring_buff_used_size_get(rx_ring);
+        if ((used >= uart_info->rx_wake_len) || ((used != 0) && uart_info->rx_idle)) {
+            break;
+        }
+
+        uart_info->wait_rx_flag = TRUE;
+        // data received before the flag was raised did not post
+        used = tuya_ring_buff_used_size_get(rx_ring);
+        if ((used >= uart_info->rx_wake_len) || ((used != 0) && uart_info->rx_idle)) {
+            uart_info->wait_rx_flag = FALSE;
+            break;
+        }
+
+        if (timeout_ms != SEM_WAIT_FOREVER) {
+            waited = (uint32_t)(tal_system_get_millisecond() - start);
+            if (waited >= timeout_ms) {
+                uart_info->wait_rx_flag = FALSE;
+                break;
+            }
+        }
+
+        ret = tal_semaphore_wait(uart_info->rx_block_sem,
+                                 (timeout_ms == SEM_WAIT_FOREVER) ? SEM_WAIT_FOREVER : timeout_ms - waited);
+        uart_info->wait_rx_flag = FALSE;
+        if ((ret != OPRT_OK) && (timeout_ms == SEM_WAIT_FOREVER)) {
+            break;
+        }
+    }
+
+    // cleared first, the line going idle during the read is kept for the next one
+    uart_info->rx_idle = FALSE;
+    read_count = tuya_ring_buff_read(rx_ring, data, len);
+
+    if ((uart_info->rx_stopped == TRUE) &&
+        (tuya_ring_buff_free_size_get(rx_ring) > tuya_ring_buff_used_size_get(rx_ring))) {
+        uart_info->rx_stopped = FALSE;
+        tkl_uart_set_rx_flowctrl(uart_info->port_num, FALSE);
+    }
+
+    tal_semaphore_post(uart_info->rx_ring_sem);
+    return read_count;
+}
+
 /**
  * @brief read data from uart
  *
@@ -306,81 +440,66 @@ int tal_uart_read(TUYA_UART_NUM_E port_num, uint8_t *data, uint32_t len)
         return OPRT_INVALID_PARM;
     }
 
-    OPERATE_RET ret = tal_semaphore_wait(uart_info->rx_ring_sem, SEM_WAIT_FOREVER);
-    if (ret != OPRT_OK) {
-        return ret;
-    }
-
-    TUYA_RINGBUFF_T *rx_ring = uart_info->rx_ring;
-    uint32_t buffer_size = tuya_ring_buff_used_size_get(rx_ring);
-    uint32_t read_count = 0;
+    return uart_read(uart_info, data, len, (uart_info->open_mode & O_BLOCK) ? SEM_WAIT_FOREVER : 0);
+}
 
-    if (buffer_size != 0) {
-        read_count = tuya_ring_buff_read(rx_ring, data, len);
-    } else {
-        if (uart_info->open_mode & O_BLOCK) {
-            while (read_count == 0) {
-                read_count = tuya_ring_buff_read(rx_ring, data, len);
-                if (read_count != 0) {
-                    break;
-                }
-
-                uart_info->wait_rx_flag = TRUE;
-                ret = tal_semaphore_wait(uart_info->rx_block_sem, SEM_WAIT_FOREVER);
-                if (ret != OPRT_OK) {
-                    break;
-                }
-            }
-        }
+/**
+ * @brief read data from uart, wait at most timeout_ms for it
+ *
+ * @param[in] port_num: uart port number
+ * @param[in] data: read data buffer
+ * @param[in] len: the read size
+ * @param[in] timeout_ms: the max wait time
+ *
+ * @note This API is used to read data from uart.
+ *
+ * @return >=0, the read size, 0 on timeout; < 0, read error
+ */
+int tal_uart_read_timeout(TUYA_UART_NUM_E port_num, uint8_t *data, uint32_t len, uint32_t timeout_ms)
+{
+    if (data == NULL) {
+        return OPRT_INVALID_PARM;
     }
 
-#ifdef CONFIG_UART_FLOW_CONTRAL
-    if (uart_info->open_mode & O_FLOW_CTRL) {
-        ret = tuya_ring_buff_read(rx_ring);
-        if (ret == 0) {
-            tkl_uart_set_rx_flowctrl(port_num, FALSE);
-        }
+    TAL_UART_DEV *uart_info = uart_list_get_one_node(port_num);
+    if (uart_info == NULL) {
+        return OPRT_INVALID_PARM;
     }
-#endif
 
-    tal_semaphore_post(uart_info->rx_ring_sem);
-    return read_count;
+    return uart_read(uart_info, data, len, timeout_ms);
 }
 
-#ifdef CONFIG_UART_WRITE_ASYNC
-OPERATE_RET uart_async_write(TAL_UART_DEV *uart_info, uint8_t *data, uint32_t len)
+static int uart_async_write(TAL_UART_DEV *uart_info, const uint8_t *data, uint32_t len)
 {
     OPERATE_RET ret = tal_semaphore_wait(uart_info->tx_ring_sem, SEM_WAIT_FOREVER);
-    if (uart_info == NULL) {
+    if (ret != OPRT_OK) {
         return ret;
     }
 
-    uint16_t tx_bytes = tuya_ring_buff_write(uart_info->tx_ring, data, len);
+    uint32_t tx_bytes = 0;
 
-#ifdef CONFIG_UART_BLOCK
-    if (uart_info->open_mode & O_BLOCK) {
-        while (ret == OPRT_OK) {
-            tx_bytes = tuya_ring_buff_write(uart_info->tx_ring, data, len);
-        }
-        if (tx_bytes != 0) {
+    while (1) {
+        tx_bytes += tuya_ring_buff_write(uart_info->tx_ring, &data[tx_bytes], len - tx_bytes);
+        uart_tx_start(uart_info);
+        if ((tx_bytes == len) || ((uart_info->open_mode & O_BLOCK) == 0)) {
             break;
         }
 
         uart_info->wait_tx_flag = TRUE;
-        ret = tal_semaphore_wait(uart_info->tx_block_sem, SEM_WAIT_FOREVER);
+        // room made before the flag was raised did not post
+        if (tuya_ring_buff_free_size_get(uart_info->tx_ring) == 0) {
+            ret = tal_semaphore_wait(uart_info->tx_block_sem, SEM_WAIT_FOREVER);
+        }
+        uart_info->wait_tx_flag = FALSE;
+        if (ret != OPRT_OK) {
+            break;
+        }
     }
-}
-#endif
-
-if (tx_bytes != 0) {
-    set_tx_int(uart_info->port_num, true);
-}
 
-tal_semaphore_post(uart_info->tx_ring_sem);
+    tal_semaphore_post(uart_info->tx_ring_sem);
 
-return tx_bytes;
+    return tx_bytes;
 }
-#endif
 
 /**
  * @brief send data by uart
@@ -404,22 +523,24 @@ int tal_uart_write(TUYA_UART_NUM_E port_num, const uint8_t *data, uint32_t len)
         return OPRT_INVALID_PARM;
     }
 
-    int tx_bytes = 0;
+    if (UART_TX_ASYNC(uart_info->open_mode)) {
+        return uart_async_write(uart_info, data, len);
+    }
+
+    uint32_t tx_bytes = 0;
     int ret;
-    if ((uart_info->open_mode & O_ASYNC_WRITE) == 0) {
-        while (tx_bytes != len) {
-            ret = tkl_uart_write(port_num, (void *)&data[tx_bytes], 1);
-            if (ret != 1) {
-                break;
-            }
-            tx_bytes++;
+
+    while (tx_bytes < len) {
+        ret = tkl_uart_write(port_num, (void *)&data[tx_bytes], MIN(len - tx_bytes, UART_BLOCK_MAX));
+        if (ret <= 0) {
+            break;
         }
+        tx_bytes += ret;
     }
-#ifdef CONFIG_UART_WRITE_ASYNC
-    else {
-        tx_bytes = uart_async_write(uart_info, data, len);
+
+    if ((tx_bytes != 0) && (uart_info->tx_done_cb != NULL)) {
+        uart_info->tx_done_cb(port_num, uart_info->tx_done_arg);
     }
-#endif
 
     return tx_bytes;
 }
@@ -451,22 +572,49 @@ OPERATE_RET tal_uart_deinit(TUYA_UART_NUM_E port_num)
         return ret;
     }
 
-    tuya_ring_buff_free(uart_info->rx_ring);
-    tal_semaphore_release(uart_info->rx_ring_sem);
+    uart_free_source(uart_info);
 
-#ifdef CONFIG_UART_ASYNC_WRITE
-    tuya_ring_buff_free(uart_info->tx_ring);
-    tal_semaphore_release(uart_info->tx_ring_sem);
-#endif
+    return ret;
+}
 
-    if (uart_info->open_mode & O_BLOCK) {
-        tal_semaphore_release(uart_info->rx_block_sem);
-        tal_semaphore_release(uart_info->tx_block_sem);
+OPERATE_RET tal_uart_tx_done_cb_reg(TUYA_UART_NUM_E port_num, TAL_UART_TX_DONE_CB cb, void *arg)
+{
+    TAL_UART_DEV *uart_info = uart_list_get_one_node(port_num);
+    if (uart_info == NULL) {
+        return OPRT_INVALID_PARM;
     }
 
-    tal_free(uart_info);
+    uart_info->tx_done_arg = arg;
+    uart_info->tx_done_cb = cb;
 
-    return ret;
+    return OPRT_OK;
+}
+
+uint32_t tal_uart_dma_rx_buf_get(TUYA_UART_NUM_E port_num, uint8_t **buf)
+{
+    TAL_UART_DEV *uart_info = uart_list_get_one_node(port_num);
+    if ((uart_info == NULL) || (buf == NULL)) {
+        return 0;
+    }
+
+    uint32_t room = tuya_ring_buff_write_region_get(uart_info->rx_ring, buf);
+    if (room == 0) {
+        uart_info->rx_stopped = TRUE;
+    }
+
+    return room;
+}
+
+void tal_uart_dma_rx_done(TUYA_UART_NUM_E port_num, uint32_t len, BOOL_T idle)
+{
+    TAL_UART_DEV *uart_info = uart_list_get_one_node(port_num);
+    if (uart_info == NULL) {
+        return;
+    }
+
+    if ((tuya_ring_buff_write_commit(uart_info->rx_ring, len) != 0) || idle) {
+        uart_rx_wakeup(uart_info, idle);
+    }
 }
 
 int tal_uart_get_rx_data_size(TUYA_UART_NUM_E port_num)
@@ -476,8 +624,5 @@ int tal_uart_get_rx_data_size(TUYA_UART_NUM_E port_num)
         return OPRT_INVALID_PARM;
     }
 
-    TUYA_RINGBUFF_T *rx_ring = uart_info->rx_ring;
-    uint32_t buffer_size = tuya_ring_buff_used_size_get(rx_ring);
-
-    return buffer_size;
+    return tuya_ring_buff_used_size_get(uart_info->rx_ring);
 }
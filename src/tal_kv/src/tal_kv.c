@@ -35,6 +35,12 @@ static lfs_t lfs;
 static lfs_size_t lfs_flash_addr;
 static tal_kv_cfg_t lfs_kv_cfg;
 static MUTEX_HANDLE lfs_mutex;
+// set up once from lfs_kv_cfg.key
+static tal_aes_key_t *lfs_enc_key;
+static tal_aes_key_t *lfs_dec_key;
+
+// values are encrypted through the stack in chunks of this size
+#define KV_CRYPT_CHUNK 128
 
 extern int kv_serialize(const kv_db_t *db, const uint32_t dbcnt, char **out, uint32_t *out_len);
 extern int kv_deserialize(const char *in, kv_db_t *db, const uint32_t dbcnt);
@@ -146,6 +152,15 @@ int tal_kv_init(tal_kv_cfg_t *kv_cfg)
     tal_sha256_ret((const uint8_t *)kv_cfg->key, TAL_LV_KEY_LEN, sha256_ret, 0);
     memcpy(lfs_kv_cfg.key, sha256_ret, TAL_LV_KEY_LEN);
 
+    tal_aes_key_free(lfs_enc_key);
+    tal_aes_key_free(lfs_dec_key);
+    lfs_enc_key = lfs_dec_key = NULL;
+    if (OPRT_OK != tal_aes_key_create(TAL_AES_CBC, SYMMETRY_ENCRYPT, (uint8_t *)lfs_kv_cfg.key, 128, &lfs_enc_key) ||
+        OPRT_OK != tal_aes_key_create(TAL_AES_CBC, SYMMETRY_DECRYPT, (uint8_t *)lfs_kv_cfg.key, 128, &lfs_dec_key)) {
+        PR_ERR("kv key setup failed");
+        return OPRT_COM_ERROR;
+    }
+
     tal_mutex_create_init(&lfs_mutex);
 
     TUYA_FLASH_BASE_INFO_T info;
@@ -212,30 +227,34 @@ int tal_kv_set(const char *key, const uint8_t *value, size_t length)
         PR_ERR("lfs open %s err", key);
         return result;
     }
-    uint8_t *ec_data = NULL;
-    uint32_t ec_len = 0;
-    uint8_t iv[16];
+    uint8_t chunk[KV_CRYPT_CHUNK + 16];
+    tal_aes_stream_t stream;
+    size_t offset = 0, ec_len = 0, n = 0;
 
-    memcpy(iv, lfs_kv_cfg.seed, 16);
-    result =
-        tal_aes128_cbc_encode((uint8_t *)value, length, (uint8_t *)lfs_kv_cfg.key, iv, &ec_data, (uint32_t *)&ec_len);
-    if (OPRT_OK != result) {
-        lfs_file_close(&lfs, &file);
-        tal_mutex_unlock(lfs_mutex);
-        PR_DEBUG("key %s encrypt failed", key);
-        return result;
-    }
+    // the value is encrypted chunk by chunk into the file, never copied whole
     lfs_file_rewind(&lfs, &file);
-    result = lfs_file_write(&lfs, &file, ec_data, ec_len);
+    result = tal_aes_stream_start(&stream, lfs_enc_key, SYMMETRY_ENCRYPT, (const uint8_t *)lfs_kv_cfg.seed, 16, TRUE);
+    while (OPRT_OK == result && offset <= length) {
+        if (offset < length) {
+            n = (length - offset < KV_CRYPT_CHUNK) ? length - offset : KV_CRYPT_CHUNK;
+            result = tal_aes_stream_update(&stream, value + offset, n, chunk, sizeof(chunk), &ec_len);
+            offset += n;
+        } else {
+            result = tal_aes_stream_finish(&stream, chunk, sizeof(chunk), &ec_len, NULL, 0);
+            offset++;
+        }
+        if (OPRT_OK != result) {
+            PR_DEBUG("key %s encrypt failed", key);
+        } else if (ec_len && (lfs_ssize_t)ec_len != lfs_file_write(&lfs, &file, chunk, ec_len)) {
+            result = OPRT_KVS_WR_FAIL;
+            PR_ERR("kv write fail");
+        }
+    }
     lfs_file_close(&lfs, &file);
-    tal_aes_free_data(ec_data);
     tal_mutex_unlock(lfs_mutex);
-    if (result != ec_len) {
-        PR_ERR("kv write fail %d", result);
-        return OPRT_KVS_WR_FAIL;
-    }
+    memset(chunk, 0, sizeof(chunk));
 
-    return OPRT_OK;
+    return result;
 }
 
 /**
@@ -289,21 +308,20 @@ int tal_kv_get(const char *key, uint8_t **value, size_t *length)
         PR_ERR("kv read error %d", result);
         return OPRT_KVS_RD_FAIL;
     }
-    uint8_t *dec_data = NULL;
-    uint32_t dec_len = 0;
+    size_t dec_len = 0;
     uint8_t iv[16];
 
+    // decrypted where it was read, the padding makes room for the NUL
     memcpy(iv, lfs_kv_cfg.seed, 16);
-    result = tal_aes128_cbc_decode(ec_data, ec_len, (uint8_t *)lfs_kv_cfg.key, iv, &dec_data, (uint32_t *)&dec_len);
-    dec_len = tal_aes_get_actual_length(dec_data, dec_len);
-    tal_free(ec_data);
-    if (OPRT_OK != result || dec_len > ec_len) {
-        PR_ERR("key %s decrypt failed %d, %d-%d", key, result, dec_len, ec_len);
+    result = tal_aes_key_decrypt_pkcs7(lfs_dec_key, iv, ec_data, ec_len, ec_data, &dec_len);
+    if (OPRT_OK != result) {
+        PR_ERR("key %s decrypt failed %d, %d", key, result, ec_len);
+        tal_free(ec_data);
         return OPRT_BUFFER_NOT_ENOUGH;
     }
-    *value = dec_data;
-    *length = (size_t)dec_len;
-    dec_data[dec_len] = 0;
+    *value = ec_data;
+    *length = dec_len;
+    ec_data[dec_len] = 0;
 
     return OPRT_OK;
 }
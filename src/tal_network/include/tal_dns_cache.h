@@ -0,0 +1,74 @@
+/**
+ * @file tal_dns_cache.h
+ * @brief Resolver cache shared by all users of tal_net_gethostbyname.
+ *
+ * Results are kept for DNS_CACHE_TTL seconds. Failures are cached for
+ * DNS_CACHE_NEG_TTL seconds so that a dead resolver is not hammered by every
+ * reconnect. After the TTL an entry is still served for DNS_CACHE_STALE_TTL
+ * seconds while a background task refreshes it, and entries close to expiry
+ * are refreshed ahead of time. The last known good addresses are saved to KV
+ * and served at boot until the first refresh completes, and they are used as
+ * a fallback whenever the resolver fails.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+#ifndef __TAL_DNS_CACHE_H__
+#define __TAL_DNS_CACHE_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+/* max addresses kept per host */
+#define DNS_CACHE_ADDR_MAX 4
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+/**
+ * @brief Resolve a domain through the cache
+ *
+ * @param[in] domain: domain name
+ * @param[out] addr: buffer for the addresses, the preferred one first
+ * @param[in,out] num: in the size of addr, out the number of addresses
+ *
+ * @note Blocks only when the domain is not cached or its stale window is
+ * over. Concurrent callers are allowed.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_dns_cache_lookup(const char *domain, TUYA_IP_ADDR_T *addr, uint8_t *num);
+
+/**
+ * @brief Mark a domain as expired, e.g. after connecting to its address failed
+ *
+ * @param[in] domain: domain name
+ *
+ * @note The next lookup resolves again and falls back to the cached
+ * addresses only if the resolver fails. The preferred address is rotated to
+ * the end of the list.
+ *
+ * @return OPRT_OK on success, OPRT_NOT_FOUND if the domain is not cached
+ */
+OPERATE_RET tal_dns_cache_invalidate(const char *domain);
+
+/**
+ * @brief Drop all cached entries, including the persisted ones
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_dns_cache_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TAL_DNS_CACHE_H__ */
@@ -385,13 +385,47 @@ OPERATE_RET tal_net_set_broadcast(const int fd);
  * @param[in] domain: domain information
  * @param[in] addr: address information
  *
- * @note This API is used for getting address information by domain.
+ * @note This API is used for getting address information by domain. The
+ * result comes from the dns cache when ENABLE_DNS_CACHE is set.
  *
  * @return OPRT_OK on success. Others on error, please refer to
  * tuya_error_code.h
  */
 OPERATE_RET tal_net_gethostbyname(const char *domain, TUYA_IP_ADDR_T *addr);
 
+/**
+ * @brief Get all address information by domain, bypassing the dns cache
+ *
+ * @param[in] domain: domain information
+ * @param[out] addr: address buffer
+ * @param[in,out] num: in the size of addr, out the number of addresses
+ *
+ * @note This API always queries the resolver, only the posix path can return
+ * more than one address.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_gethostbyname_all(const char *domain, TUYA_IP_ADDR_T *addr, uint8_t *num);
+
+/**
+ * @brief Connect to a domain, racing the connections to its addresses
+ *
+ * @param[in] domain: domain information
+ * @param[in] port: port information of server
+ * @param[in] timeout_ms: overall timeout
+ * @param[out] fd: connected tcp socket in block mode
+ *
+ * @note The addresses come from the dns cache. A connection is started to the
+ * first address and, every NET_CONNECT_RACE_DELAY ms without an answer, to
+ * the next one. The first socket connected wins and the others are closed.
+ * A domain whose connections all fail is invalidated in the dns cache.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_connect_race(const char *domain, const uint16_t port, const uint32_t timeout_ms, int *fd);
+
 /**
  * @brief Set keepalive option of socket fd to monitor the connection
  *
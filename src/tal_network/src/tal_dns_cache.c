@@ -0,0 +1,565 @@
+/**
+ * @file tal_dns_cache.c
+ * @brief Resolver cache shared by all users of tal_net_gethostbyname.
+ *
+ * The cache is a small table replaced in LRU order. Lookups are served from
+ * the table under a mutex, the resolver itself is always called without the
+ * lock held: synchronously on a miss, or from the refresh task for entries
+ * that are stale or about to expire. A changed set of addresses is saved to
+ * KV after the lock is dropped, so flash writes never stall the lookups.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+#include "tuya_iot_config.h"
+#include "tal_api.h"
+#include "tal_network.h"
+#include "tal_dns_cache.h"
+
+#if defined(ENABLE_DNS_CACHE) && (ENABLE_DNS_CACHE == 1)
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#ifndef DNS_CACHE_ENTRY_NUM
+#define DNS_CACHE_ENTRY_NUM 8
+#endif
+
+#ifndef DNS_CACHE_TTL
+#define DNS_CACHE_TTL 600
+#endif
+
+#ifndef DNS_CACHE_NEG_TTL
+#define DNS_CACHE_NEG_TTL 10
+#endif
+
+#ifndef DNS_CACHE_STALE_TTL
+#define DNS_CACHE_STALE_TTL 86400
+#endif
+
+#define DNS_CACHE_HOST_LEN 64
+/* refresh ahead once less than 1/8 of the TTL is left */
+#define DNS_CACHE_PREFETCH_MS (DNS_CACHE_TTL * 1000ULL / 8)
+
+#define DNS_CACHE_KV_KEY      "dns_cache"
+#define DNS_REFRESH_STACK     4096
+
+/* sg_dns_init states */
+#define DNS_INIT_NONE  0
+#define DNS_INIT_BUSY  1
+#define DNS_INIT_READY 2
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    char host[DNS_CACHE_HOST_LEN];
+    TUYA_IP_ADDR_T addr[DNS_CACHE_ADDR_MAX];
+    uint8_t addr_num; // 0 means a cached failure
+    uint8_t refreshing;
+    OPERATE_RET err;
+    SYS_TIME_T expire;     // fresh until
+    SYS_TIME_T stale;      // served with a background refresh until
+    SYS_TIME_T next_retry; // no refresh before, set after a failed refresh
+    SYS_TIME_T last_use;
+} DNS_CACHE_ENTRY_T;
+
+/* persisted record, only last known good addresses are saved */
+typedef struct {
+    char host[DNS_CACHE_HOST_LEN];
+    TUYA_IP_ADDR_T addr[DNS_CACHE_ADDR_MAX];
+    uint8_t addr_num;
+    uint8_t rsvd[3];
+} DNS_CACHE_RECORD_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static MUTEX_HANDLE sg_dns_mutex = NULL;
+static MUTEX_HANDLE sg_save_mutex = NULL;
+static SEM_HANDLE sg_refresh_sem = NULL;
+static THREAD_HANDLE sg_refresh_thrd = NULL;
+static DNS_CACHE_ENTRY_T sg_dns_cache[DNS_CACHE_ENTRY_NUM];
+static BOOL_T sg_dns_loaded = FALSE;
+static BOOL_T sg_dns_dirty = FALSE;
+static uint8_t sg_dns_init = DNS_INIT_NONE;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static DNS_CACHE_ENTRY_T *__dns_cache_find(const char *domain)
+{
+    int i;
+
+    for (i = 0; i < DNS_CACHE_ENTRY_NUM; i++) {
+        if (sg_dns_cache[i].host[0] && 0 == strcmp(sg_dns_cache[i].host, domain)) {
+            return &sg_dns_cache[i];
+        }
+    }
+
+    return NULL;
+}
+
+static DNS_CACHE_ENTRY_T *__dns_cache_alloc(const char *domain)
+{
+    int i;
+    DNS_CACHE_ENTRY_T *entry = &sg_dns_cache[0];
+
+    for (i = 0; i < DNS_CACHE_ENTRY_NUM; i++) {
+        if (0 == sg_dns_cache[i].host[0]) {
+            entry = &sg_dns_cache[i];
+            break;
+        }
+        if (sg_dns_cache[i].last_use < entry->last_use) {
+            entry = &sg_dns_cache[i];
+        }
+    }
+
+    memset(entry, 0, sizeof(DNS_CACHE_ENTRY_T));
+    strncpy(entry->host, domain, DNS_CACHE_HOST_LEN - 1);
+
+    return entry;
+}
+
+/**
+ * @brief write the last known good addresses to KV, called without the lock
+ *
+ * @note Saves run one at a time and each writes the table as it is then, so
+ * an older copy never overwrites a newer one. Several changes made while a
+ * save is writing are saved once.
+ */
+static void __dns_cache_save(void)
+{
+    int i, num = 0;
+    DNS_CACHE_RECORD_T *rec = NULL;
+
+    rec = (DNS_CACHE_RECORD_T *)tal_malloc(sizeof(DNS_CACHE_RECORD_T) * DNS_CACHE_ENTRY_NUM);
+    if (NULL == rec) {
+        return;
+    }
+    memset(rec, 0, sizeof(DNS_CACHE_RECORD_T) * DNS_CACHE_ENTRY_NUM);
+
+    tal_mutex_lock(sg_save_mutex);
+    tal_mutex_lock(sg_dns_mutex);
+    if (!sg_dns_dirty) {
+        tal_mutex_unlock(sg_dns_mutex);
+        tal_mutex_unlock(sg_save_mutex);
+        tal_free(rec);
+        return;
+    }
+    sg_dns_dirty = FALSE;
+    for (i = 0; i < DNS_CACHE_ENTRY_NUM; i++) {
+        if (sg_dns_cache[i].host[0] && sg_dns_cache[i].addr_num) {
+            memcpy(rec[num].host, sg_dns_cache[i].host, DNS_CACHE_HOST_LEN);
+            memcpy(rec[num].addr, sg_dns_cache[i].addr, sizeof(rec[num].addr));
+            rec[num].addr_num = sg_dns_cache[i].addr_num;
+            num++;
+        }
+    }
+    tal_mutex_unlock(sg_dns_mutex);
+
+    if (num) {
+        tal_kv_set(DNS_CACHE_KV_KEY, (const uint8_t *)rec, sizeof(DNS_CACHE_RECORD_T) * num);
+    } else {
+        tal_kv_del(DNS_CACHE_KV_KEY);
+    }
+    tal_mutex_unlock(sg_save_mutex);
+
+    tal_free(rec);
+}
+
+static void __dns_cache_load(SYS_TIME_T now)
+{
+    size_t i, len = 0;
+    uint8_t *value = NULL;
+    DNS_CACHE_RECORD_T *rec = NULL;
+    DNS_CACHE_ENTRY_T *entry = NULL;
+
+    // tried once only, a KV that is not ready yet is filled by the lookups themselves
+    sg_dns_loaded = TRUE;
+    if (0 != tal_kv_get(DNS_CACHE_KV_KEY, &value, &len) || NULL == value) {
+        return;
+    }
+
+    rec = (DNS_CACHE_RECORD_T *)value;
+    for (i = 0; i < len / sizeof(DNS_CACHE_RECORD_T) && i < DNS_CACHE_ENTRY_NUM; i++) {
+        rec[i].host[DNS_CACHE_HOST_LEN - 1] = '\0';
+        if (0 == rec[i].host[0] || 0 == rec[i].addr_num || rec[i].addr_num > DNS_CACHE_ADDR_MAX) {
+            continue;
+        }
+        // resolved while kv was not ready, the live result is newer
+        entry = __dns_cache_find(rec[i].host);
+        if (entry && entry->addr_num) {
+            continue;
+        }
+        if (NULL == entry) {
+            entry = __dns_cache_alloc(rec[i].host);
+        }
+        memcpy(entry->addr, rec[i].addr, sizeof(entry->addr));
+        entry->addr_num = rec[i].addr_num;
+        // already expired, served while the refresh task resolves it again
+        entry->expire = now;
+        entry->stale = now + DNS_CACHE_STALE_TTL * 1000ULL;
+    }
+
+    tal_kv_free(value);
+}
+
+static BOOL_T __dns_cache_addr_has(const TUYA_IP_ADDR_T *addr, uint8_t num, const TUYA_IP_ADDR_T *ip)
+{
+    uint8_t i;
+
+    for (i = 0; i < num; i++) {
+        if (0 == memcmp(&addr[i], ip, sizeof(TUYA_IP_ADDR_T))) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ * @brief store a resolve result, called with the lock held
+ *
+ * @return TRUE if the last known good addresses changed
+ */
+static BOOL_T __dns_cache_update(DNS_CACHE_ENTRY_T *entry, OPERATE_RET rt, TUYA_IP_ADDR_T *addr, uint8_t num,
+                                 SYS_TIME_T now)
+{
+    if (OPRT_OK != rt || 0 == num) {
+        entry->err = (OPRT_OK != rt) ? rt : OPRT_COM_ERROR;
+        entry->next_retry = now + DNS_CACHE_NEG_TTL * 1000ULL;
+        if (0 == entry->addr_num) {
+            // nothing to fall back to, cache the failure
+            entry->expire = entry->next_retry;
+            entry->stale = entry->next_retry;
+        } else if (entry->stale < entry->next_retry) {
+            // keep serving the last known good addresses instead of blocking every lookup
+            entry->stale = entry->next_retry;
+        }
+        return FALSE;
+    }
+
+    // resolvers rotate their answers, only a different set of addresses is worth saving
+    BOOL_T changed = (num != entry->addr_num);
+    uint8_t i;
+
+    for (i = 0; i < num && !changed; i++) {
+        changed = !__dns_cache_addr_has(entry->addr, entry->addr_num, &addr[i]);
+    }
+
+    memcpy(entry->addr, addr, num * sizeof(TUYA_IP_ADDR_T));
+    entry->addr_num = num;
+    entry->err = OPRT_OK;
+    entry->expire = now + DNS_CACHE_TTL * 1000ULL;
+    entry->stale = entry->expire + DNS_CACHE_STALE_TTL * 1000ULL;
+    entry->next_retry = 0;
+
+    return changed;
+}
+
+static void __dns_refresh_task(void *args)
+{
+    int i;
+    OPERATE_RET rt = OPRT_OK;
+    char host[DNS_CACHE_HOST_LEN];
+    TUYA_IP_ADDR_T addr[DNS_CACHE_ADDR_MAX];
+    uint8_t num;
+    BOOL_T changed;
+    DNS_CACHE_ENTRY_T *entry = NULL;
+
+    for (;;) {
+        tal_semaphore_wait(sg_refresh_sem, SEM_WAIT_FOREVER);
+
+        for (i = 0; i < DNS_CACHE_ENTRY_NUM; i++) {
+            tal_mutex_lock(sg_dns_mutex);
+            if (!sg_dns_cache[i].refreshing) {
+                tal_mutex_unlock(sg_dns_mutex);
+                continue;
+            }
+            memcpy(host, sg_dns_cache[i].host, DNS_CACHE_HOST_LEN);
+            tal_mutex_unlock(sg_dns_mutex);
+
+            num = DNS_CACHE_ADDR_MAX;
+            rt = tal_net_gethostbyname_all(host, addr, &num);
+
+            changed = FALSE;
+            tal_mutex_lock(sg_dns_mutex);
+            // the slot may have been reused for another host meanwhile
+            entry = __dns_cache_find(host);
+            if (entry) {
+                changed = __dns_cache_update(entry, rt, addr, num, tal_system_get_millisecond());
+                entry->refreshing = 0;
+            }
+            if (changed) {
+                sg_dns_dirty = TRUE;
+            }
+            tal_mutex_unlock(sg_dns_mutex);
+
+            if (changed) {
+                __dns_cache_save();
+            }
+
+            PR_DEBUG("dns refresh %s rt:%d num:%d", host, rt, num);
+        }
+    }
+}
+
+/**
+ * @brief queue a background refresh, called with the lock held
+ */
+static void __dns_cache_refresh(DNS_CACHE_ENTRY_T *entry, SYS_TIME_T now)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (entry->refreshing || now < entry->next_retry) {
+        return;
+    }
+
+    if (NULL == sg_refresh_thrd) {
+        THREAD_CFG_T thrd_param = {.thrdname = "dns_refresh", .priority = THREAD_PRIO_3, .stackDepth = DNS_REFRESH_STACK};
+        TUYA_CALL_ERR_LOG(tal_thread_create_and_start(&sg_refresh_thrd, NULL, NULL, __dns_refresh_task, NULL,
+                                                      &thrd_param));
+        if (OPRT_OK != rt) {
+            sg_refresh_thrd = NULL;
+            return;
+        }
+    }
+
+    entry->refreshing = 1;
+    tal_semaphore_post(sg_refresh_sem);
+}
+
+static BOOL_T __dns_cache_ready(void)
+{
+    return (DNS_INIT_READY == __atomic_load_n(&sg_dns_init, __ATOMIC_ACQUIRE)) ? TRUE : FALSE;
+}
+
+static OPERATE_RET __dns_cache_init(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint8_t state = DNS_INIT_NONE;
+
+    if (__dns_cache_ready()) {
+        return OPRT_OK;
+    }
+
+    // the first lookups may come from several tasks at once, only one creates the lock
+    if (!__atomic_compare_exchange_n(&sg_dns_init, &state, DNS_INIT_BUSY, FALSE, __ATOMIC_ACQUIRE,
+                                     __ATOMIC_ACQUIRE)) {
+        while (DNS_INIT_BUSY == (state = __atomic_load_n(&sg_dns_init, __ATOMIC_ACQUIRE))) {
+            tal_system_sleep(1);
+        }
+        return (DNS_INIT_READY == state) ? OPRT_OK : OPRT_COM_ERROR;
+    }
+
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&sg_refresh_sem, 0, DNS_CACHE_ENTRY_NUM), __ERR);
+    TUYA_CALL_ERR_GOTO(tal_mutex_create_init(&sg_dns_mutex), __ERR);
+    TUYA_CALL_ERR_GOTO(tal_mutex_create_init(&sg_save_mutex), __ERR);
+
+    __atomic_store_n(&sg_dns_init, DNS_INIT_READY, __ATOMIC_RELEASE);
+
+    return OPRT_OK;
+
+__ERR:
+    if (sg_dns_mutex) {
+        tal_mutex_release(sg_dns_mutex);
+        sg_dns_mutex = NULL;
+    }
+    if (sg_refresh_sem) {
+        tal_semaphore_release(sg_refresh_sem);
+        sg_refresh_sem = NULL;
+    }
+    __atomic_store_n(&sg_dns_init, DNS_INIT_NONE, __ATOMIC_RELEASE);
+    return rt;
+}
+
+static uint8_t __dns_cache_copy(DNS_CACHE_ENTRY_T *entry, TUYA_IP_ADDR_T *addr, uint8_t num)
+{
+    if (num > entry->addr_num) {
+        num = entry->addr_num;
+    }
+    memcpy(addr, entry->addr, num * sizeof(TUYA_IP_ADDR_T));
+
+    return num;
+}
+
+/**
+ * @brief Resolve a domain through the cache
+ *
+ * @param[in] domain: domain name
+ * @param[out] addr: buffer for the addresses, the preferred one first
+ * @param[in,out] num: in the size of addr, out the number of addresses
+ *
+ * @note Blocks only when the domain is not cached or its stale window is
+ * over. Concurrent callers are allowed.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_dns_cache_lookup(const char *domain, TUYA_IP_ADDR_T *addr, uint8_t *num)
+{
+    OPERATE_RET rt = OPRT_OK;
+    DNS_CACHE_ENTRY_T *entry = NULL;
+    TUYA_IP_ADDR_T res_addr[DNS_CACHE_ADDR_MAX];
+    uint8_t res_num = DNS_CACHE_ADDR_MAX;
+    SYS_TIME_T now;
+    BOOL_T changed = FALSE;
+
+    if (NULL == domain || NULL == addr || NULL == num || 0 == *num) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (strlen(domain) >= DNS_CACHE_HOST_LEN || OPRT_OK != __dns_cache_init()) {
+        return tal_net_gethostbyname_all(domain, addr, num);
+    }
+
+    tal_mutex_lock(sg_dns_mutex);
+    now = tal_system_get_millisecond();
+    if (!sg_dns_loaded) {
+        __dns_cache_load(now);
+    }
+
+    entry = __dns_cache_find(domain);
+    if (entry) {
+        entry->last_use = now;
+        if (now < entry->expire) {
+            if (0 == entry->addr_num) {
+                rt = entry->err;
+                tal_mutex_unlock(sg_dns_mutex);
+                return rt;
+            }
+            if (entry->expire - now < DNS_CACHE_PREFETCH_MS) {
+                __dns_cache_refresh(entry, now);
+            }
+            *num = __dns_cache_copy(entry, addr, *num);
+            tal_mutex_unlock(sg_dns_mutex);
+            return OPRT_OK;
+        }
+        if (now < entry->stale && entry->addr_num) {
+            __dns_cache_refresh(entry, now);
+            *num = __dns_cache_copy(entry, addr, *num);
+            tal_mutex_unlock(sg_dns_mutex);
+            return OPRT_OK;
+        }
+    }
+    tal_mutex_unlock(sg_dns_mutex);
+
+    rt = tal_net_gethostbyname_all(domain, res_addr, &res_num);
+
+    tal_mutex_lock(sg_dns_mutex);
+    now = tal_system_get_millisecond();
+    entry = __dns_cache_find(domain);
+    if (NULL == entry) {
+        entry = __dns_cache_alloc(domain);
+    }
+    entry->last_use = now;
+    changed = __dns_cache_update(entry, rt, res_addr, res_num, now);
+    if (changed) {
+        sg_dns_dirty = TRUE;
+    }
+
+    if (entry->addr_num) {
+        if (OPRT_OK != rt) {
+            PR_ERR("dns %s failed %d, use last known good address", domain, rt);
+        }
+        *num = __dns_cache_copy(entry, addr, *num);
+        rt = OPRT_OK;
+    }
+    tal_mutex_unlock(sg_dns_mutex);
+
+    if (changed) {
+        __dns_cache_save();
+    }
+
+    return rt;
+}
+
+/**
+ * @brief Mark a domain as expired, e.g. after connecting to its address failed
+ *
+ * @param[in] domain: domain name
+ *
+ * @note The next lookup resolves again and falls back to the cached
+ * addresses only if the resolver fails. The preferred address is rotated to
+ * the end of the list.
+ *
+ * @return OPRT_OK on success, OPRT_NOT_FOUND if the domain is not cached
+ */
+OPERATE_RET tal_dns_cache_invalidate(const char *domain)
+{
+    TUYA_IP_ADDR_T first;
+    DNS_CACHE_ENTRY_T *entry = NULL;
+
+    if (NULL == domain) {
+        return OPRT_INVALID_PARM;
+    }
+    if (!__dns_cache_ready()) {
+        return OPRT_NOT_FOUND;
+    }
+
+    tal_mutex_lock(sg_dns_mutex);
+    entry = __dns_cache_find(domain);
+    if (NULL == entry) {
+        tal_mutex_unlock(sg_dns_mutex);
+        return OPRT_NOT_FOUND;
+    }
+
+    if (entry->addr_num > 1) {
+        first = entry->addr[0];
+        memmove(&entry->addr[0], &entry->addr[1], (entry->addr_num - 1) * sizeof(TUYA_IP_ADDR_T));
+        entry->addr[entry->addr_num - 1] = first;
+    }
+    entry->expire = 0;
+    entry->stale = 0;
+    entry->next_retry = 0;
+    tal_mutex_unlock(sg_dns_mutex);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Drop all cached entries, including the persisted ones
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_dns_cache_clear(void)
+{
+    if (!__dns_cache_ready()) {
+        tal_kv_del(DNS_CACHE_KV_KEY);
+        return OPRT_OK;
+    }
+
+    // no save in progress can write the old table back after the delete
+    tal_mutex_lock(sg_save_mutex);
+    tal_mutex_lock(sg_dns_mutex);
+    // a refresh in progress finds no entry by name and drops its result
+    memset(sg_dns_cache, 0, sizeof(sg_dns_cache));
+    sg_dns_loaded = TRUE;
+    sg_dns_dirty = FALSE;
+    tal_mutex_unlock(sg_dns_mutex);
+
+    tal_kv_del(DNS_CACHE_KV_KEY);
+    tal_mutex_unlock(sg_save_mutex);
+
+    return OPRT_OK;
+}
+
+#else
+
+OPERATE_RET tal_dns_cache_lookup(const char *domain, TUYA_IP_ADDR_T *addr, uint8_t *num)
+{
+    return tal_net_gethostbyname_all(domain, addr, num);
+}
+
+OPERATE_RET tal_dns_cache_invalidate(const char *domain)
+{
+    return OPRT_NOT_SUPPORTED;
+}
+
+OPERATE_RET tal_dns_cache_clear(void)
+{
+    return OPRT_NOT_SUPPORTED;
+}
+
+#endif
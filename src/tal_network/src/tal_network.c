@@ -31,6 +31,8 @@
  */
 #include "tuya_iot_config.h"
 #include "tal_api.h"
+#include "tal_network.h"
+#include "tal_dns_cache.h"
 
 #if 100 == OPERATING_SYSTEM
 #include <unistd.h>
@@ -56,6 +58,10 @@
 #include "tkl_network.h"
 #endif
 
+#ifndef NET_CONNECT_RACE_DELAY
+#define NET_CONNECT_RACE_DELAY 250
+#endif
+
 #if (defined(ENABLE_LIBLWIP) && (ENABLE_LIBLWIP == 1)) || 100 == OPERATING_SYSTEM
 #define NET_USING_POSIX        1
 #define TAL_TO_SYS_FD_SET(fds) ((fd_set *)fds)
@@ -1016,38 +1022,203 @@ OPERATE_RET tal_net_set_broadcast(const int fd)
 }
 
 /**
- * @brief Get address information by domain
+ * @brief Get all address information by domain, bypassing the dns cache
  *
  * @param[in] domain: domain information
- * @param[in] addr: address information
+ * @param[out] addr: address buffer
+ * @param[in,out] num: in the size of addr, out the number of addresses
  *
- * @note This API is used for getting address information by domain.
+ * @note This API always queries the resolver, only the posix path can return
+ * more than one address.
  *
  * @return OPRT_OK on success. Others on error, please refer to
  * tuya_error_code.h
  */
-OPERATE_RET tal_net_gethostbyname(const char *domain, TUYA_IP_ADDR_T *addr)
+OPERATE_RET tal_net_gethostbyname_all(const char *domain, TUYA_IP_ADDR_T *addr, uint8_t *num)
 {
     int ret = -1;
 
-    if ((domain == NULL) || (addr == NULL)) {
+    if ((domain == NULL) || (addr == NULL) || (num == NULL) || (*num == 0)) {
         return -2;
     }
 
 #if NET_USING_POSIX
     struct hostent *h = NULL;
+    uint8_t i = 0;
     h = gethostbyname(domain);
     if (h) {
-        *addr = ntohl(((struct in_addr *)(h->h_addr_list[0]))->s_addr);
-        ret = OPRT_OK;
+        for (i = 0; i < *num && h->h_addr_list[i]; i++) {
+            addr[i] = ntohl(((struct in_addr *)(h->h_addr_list[i]))->s_addr);
+        }
+        *num = i;
+        ret = (i > 0) ? OPRT_OK : -1;
     }
 #else
     ret = tkl_net_gethostbyname(domain, addr);
+    *num = (OPRT_OK == ret) ? 1 : 0;
 #endif
 
     return ret;
 }
 
+/**
+ * @brief Get address information by domain
+ *
+ * @param[in] domain: domain information
+ * @param[in] addr: address information
+ *
+ * @note This API is used for getting address information by domain. The
+ * result comes from the dns cache when ENABLE_DNS_CACHE is set.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_gethostbyname(const char *domain, TUYA_IP_ADDR_T *addr)
+{
+    uint8_t num = 1;
+
+    if ((domain == NULL) || (addr == NULL)) {
+        return -2;
+    }
+
+#if defined(ENABLE_DNS_CACHE) && (ENABLE_DNS_CACHE == 1)
+    return tal_dns_cache_lookup(domain, addr, &num);
+#else
+    return tal_net_gethostbyname_all(domain, addr, &num);
+#endif
+}
+
+static BOOL_T __net_connect_done(int fd, TUYA_IP_ADDR_T addr, uint16_t port)
+{
+#if NET_USING_POSIX
+    int err = -1;
+    int len = sizeof(err);
+
+    if (0 != tal_net_getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len)) {
+        return FALSE;
+    }
+    return (0 == err) ? TRUE : FALSE;
+#else
+    // connecting again to the same peer reports EISCONN once connected
+    TUYA_ERRNO ret = tal_net_connect(fd, addr, port);
+    return (0 == ret || UNW_EISCONN == tal_net_get_errno()) ? TRUE : FALSE;
+#endif
+}
+
+/**
+ * @brief Connect to a domain, racing the connections to its addresses
+ *
+ * @param[in] domain: domain information
+ * @param[in] port: port information of server
+ * @param[in] timeout_ms: overall timeout
+ * @param[out] fd: connected tcp socket in block mode
+ *
+ * @note The addresses come from the dns cache. A connection is started to the
+ * first address and, every NET_CONNECT_RACE_DELAY ms without an answer, to
+ * the next one. The first socket connected wins and the others are closed.
+ * A domain whose connections all fail is invalidated in the dns cache.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_connect_race(const char *domain, const uint16_t port, const uint32_t timeout_ms, int *fd)
+{
+    OPERATE_RET rt = OPRT_OK;
+    TUYA_IP_ADDR_T addr[DNS_CACHE_ADDR_MAX];
+    int sock[DNS_CACHE_ADDR_MAX];
+    uint8_t num = DNS_CACHE_ADDR_MAX, started = 0, i;
+    int maxfd, winner = -1;
+    TUYA_FD_SET_T wfds;
+    SYS_TIME_T start, now, next_start;
+
+    if (NULL == domain || NULL == fd) {
+        return OPRT_INVALID_PARM;
+    }
+
+    TUYA_CALL_ERR_RETURN(tal_dns_cache_lookup(domain, addr, &num));
+
+    for (i = 0; i < num; i++) {
+        sock[i] = -1;
+    }
+
+    start = tal_system_get_millisecond();
+    next_start = start;
+    now = start;
+    while (winner < 0 && now - start < timeout_ms) {
+        if (started < num && now >= next_start) {
+            sock[started] = tal_net_socket_create(PROTOCOL_TCP);
+            if (sock[started] >= 0) {
+                tal_net_set_block(sock[started], FALSE);
+                if (0 == tal_net_connect(sock[started], addr[started], port)) {
+                    winner = started;
+                    break;
+                }
+            }
+            started++;
+            next_start = now + NET_CONNECT_RACE_DELAY;
+        }
+
+        tal_net_fd_zero(&wfds);
+        maxfd = -1;
+        for (i = 0; i < started; i++) {
+            if (sock[i] >= 0) {
+                tal_net_fd_set(sock[i], &wfds);
+                maxfd = (sock[i] > maxfd) ? sock[i] : maxfd;
+            }
+        }
+        now = tal_system_get_millisecond();
+        if (maxfd < 0) {
+            if (started >= num) {
+                break;
+            }
+            // nothing in flight, only the next start is left to wait for
+            if (next_start > now && now - start < timeout_ms) {
+                uint32_t idle = timeout_ms - (uint32_t)(now - start);
+                tal_system_sleep((next_start - now < idle) ? (uint32_t)(next_start - now) : idle);
+                now = tal_system_get_millisecond();
+            }
+            continue;
+        }
+
+        uint32_t wait = timeout_ms - (uint32_t)(now - start);
+        if (started < num && next_start > now && next_start - now < wait) {
+            wait = (uint32_t)(next_start - now);
+        }
+        if (tal_net_select(maxfd + 1, NULL, &wfds, NULL, wait) > 0) {
+            for (i = 0; i < started; i++) {
+                if (sock[i] < 0 || !tal_net_fd_isset(sock[i], &wfds)) {
+                    continue;
+                }
+                if (__net_connect_done(sock[i], addr[i], port)) {
+                    winner = i;
+                    break;
+                }
+                // refused or unreachable, give the next address its turn right away
+                tal_net_close(sock[i]);
+                sock[i] = -1;
+                next_start = 0;
+            }
+        }
+        now = tal_system_get_millisecond();
+    }
+
+    for (i = 0; i < started; i++) {
+        if (i != winner && sock[i] >= 0) {
+            tal_net_close(sock[i]);
+        }
+    }
+
+    if (winner < 0) {
+        tal_dns_cache_invalidate(domain);
+        return OPRT_TIMEOUT;
+    }
+
+    tal_net_set_block(sock[winner], TRUE);
+    *fd = sock[winner];
+
+    return OPRT_OK;
+}
+
 /**
  * @brief Set keepalive option of socket fd to monitor the connection
  *
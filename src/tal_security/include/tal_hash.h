@@ -39,6 +39,21 @@ typedef struct {
     uint8_t opad[64]; /*!< HMAC: outer padding */
 } tal_hash_mac_context_t;
 
+typedef enum {
+    TAL_HASH_MAC_SHA1 = 0,
+    TAL_HASH_MAC_SHA256,
+} TAL_HASH_MAC_TYPE_E;
+
+/**
+ * @brief HMAC object bound to one key, see tal_hash_mac_key_create
+ */
+typedef struct tal_hash_mac_key tal_hash_mac_key_t;
+
+typedef struct {
+    const uint8_t *input;
+    size_t ilen;
+} tal_hash_buf_t;
+
 /**
  * @brief This function Create&initializes a sha256 context.
  *
@@ -474,6 +489,114 @@ OPERATE_RET tal_sha1_mac_finish(tal_hash_mac_context_t *hmac_handle, uint8_t *ou
  */
 OPERATE_RET tal_sha1_mac(const uint8_t *key, size_t keylen, const uint8_t *input, size_t ilen, uint8_t *output);
 
+/**
+ * @brief This function creates a keyed HMAC object.
+ *
+ * The key is processed once: with the mbedtls hash, the states after the
+ * inner and the outer pad are kept and copied for every message, which saves
+ * the two compression blocks of the pads and the allocation of a context per
+ * message. Use it instead of tal_sha256_mac or tal_sha1_mac when the same key
+ * signs message after message.
+ *
+ * @param[in] type: TAL_HASH_MAC_SHA1 or TAL_HASH_MAC_SHA256
+ * @param[in] key: key
+ * @param[in] keylen: keylen
+ * @param[out] mac_key: the keyed object, ready for a message
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_hash_mac_key_create(TAL_HASH_MAC_TYPE_E type, const uint8_t *key, size_t keylen,
+                                    tal_hash_mac_key_t **mac_key);
+
+/**
+ * @brief This function frees a keyed HMAC object.
+ *
+ * @param[in] mac_key: the keyed object
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_hash_mac_key_free(tal_hash_mac_key_t *mac_key);
+
+/**
+ * @brief This function drops the message fed so far and starts a new one.
+ *
+ * @param[in] mac_key: the keyed object
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_hash_mac_key_starts(tal_hash_mac_key_t *mac_key);
+
+/**
+ * @brief This function feeds an input buffer into the message being signed.
+ *
+ * @param[in] mac_key: the keyed object
+ * @param[in] input:    The buffer holding the data. This must be a readable
+ *                 buffer of length \p ilen Bytes.
+ * @param[in] ilen:     The length of the input data in Bytes.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_hash_mac_key_update(tal_hash_mac_key_t *mac_key, const uint8_t *input, size_t ilen);
+
+/**
+ * @brief This function finishes the message, writes its MAC and starts the
+ * next one.
+ *
+ * @param[in] mac_key: the keyed object
+ * @param[out] output: the MAC, 32 bytes for SHA256 and 20 for SHA1
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_hash_mac_key_finish(tal_hash_mac_key_t *mac_key, uint8_t *output);
+
+/**
+ * @brief This function signs one message with a keyed HMAC object.
+ *
+ * @param[in] mac_key: the keyed object
+ * @param[in] input: the message
+ * @param[in] ilen: length of the message
+ * @param[out] output: the MAC, 32 bytes for SHA256 and 20 for SHA1
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_hash_mac_key_sign(tal_hash_mac_key_t *mac_key, const uint8_t *input, size_t ilen, uint8_t *output);
+
+/**
+ * @brief This function signs several messages with a keyed HMAC object.
+ *
+ * @param[in] mac_key: the keyed object
+ * @param[in] bufs: the messages
+ * @param[in] num: number of messages
+ * @param[out] output: the MACs one after the other, num times 32 bytes for
+ * SHA256 and 20 for SHA1
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_hash_mac_key_sign_multi(tal_hash_mac_key_t *mac_key, const tal_hash_buf_t *bufs, uint32_t num,
+                                        uint8_t *output);
+
+/**
+ * @brief This function calculates the sha224 or sha256 checksums of several
+ * buffers with one context.
+ *
+ * @param[in] bufs: the buffers
+ * @param[in] num: number of buffers
+ * @param[out] output: the checksums one after the other, num times 32 bytes,
+ * or 28 for sha224
+ * @param[in] is224: \c 0 for sha256, \c 1 for sha224
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_sha256_multi_ret(const tal_hash_buf_t *bufs, uint32_t num, uint8_t *output, int32_t is224);
+
 /**
  * @brief Performs a self-test for the SHA256 algorithm.
  *
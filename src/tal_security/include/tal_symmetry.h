@@ -37,6 +37,35 @@ typedef enum {
     SYMMETRY_ENCRYPT = 1,
 } TAL_SYMMETRY_CRYPT_MODE;
 
+typedef enum {
+    TAL_AES_ECB = 0,
+    TAL_AES_CBC,
+    TAL_AES_CTR,
+    TAL_AES_GCM,
+} TAL_AES_MODE_E;
+
+/* length of the PKCS7 padded ciphertext of len bytes */
+#define TAL_AES_PKCS7_LEN(len) ((((len) / 16) + 1) * 16)
+
+/**
+ * @brief A key bound to an AES mode, created once and used for any number of
+ * messages without allocating.
+ */
+typedef struct tal_aes_key tal_aes_key_t;
+
+/**
+ * @brief State of a message encrypted or decrypted in chunks, see
+ * tal_aes_stream_start().
+ */
+typedef struct {
+    tal_aes_key_t *key;
+    TAL_SYMMETRY_CRYPT_MODE crypt;
+    BOOL_T padding;
+    uint8_t iv[16];    // CBC chaining value, CTR counter block
+    uint8_t block[16]; // ECB and CBC input not processed yet, CTR key stream
+    size_t block_len;  // bytes in block, CTR offset into the key stream
+} tal_aes_stream_t;
+
 /**
  * @brief This function Create&initializes a aes context.
  *
@@ -406,6 +435,208 @@ OPERATE_RET tal_aes128_cbc_decode(uint8_t *data, uint32_t len, uint8_t *key, uin
  */
 OPERATE_RET tal_aes_free_data(uint8_t *data);
 
+/**
+ * @brief Creates a key for an AES mode and sets it up once.
+ *
+ * The key schedule, and the hash subkey of GCM, are computed here, every
+ * message run with the key afterwards neither allocates nor sets the key up
+ * again.
+ *
+ * @param[in] mode: the AES mode the key is used with
+ * @param[in] crypt: direction of an ECB or CBC key, CTR and GCM keys serve
+ * both directions
+ * @param[in] key: the AES key
+ * @param[in] keybits: 128, 192 or 256
+ * @param[out] aes_key: the key, released with tal_aes_key_free()
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_aes_key_create(TAL_AES_MODE_E mode, TAL_SYMMETRY_CRYPT_MODE crypt, const uint8_t *key,
+                               uint32_t keybits, tal_aes_key_t **aes_key);
+
+/**
+ * @brief Releases a key and clears its schedule.
+ *
+ * @param[in] aes_key: the key, may be NULL
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_aes_key_free(tal_aes_key_t *aes_key);
+
+/**
+ * @brief Encrypts or decrypts a message of full blocks with an ECB, CBC or
+ * CTR key.
+ *
+ * @param[in] aes_key: the key
+ * @param[in,out] iv: CBC initialization vector or CTR counter block, updated
+ * to continue after the message. Unused by ECB.
+ * @param[in] input: the message
+ * @param[in] len: length of the message, a multiple of 16 unless CTR
+ * @param[out] output: len bytes, may be input
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_aes_key_crypt(tal_aes_key_t *aes_key, uint8_t iv[16], const uint8_t *input, size_t len,
+                              uint8_t *output);
+
+/**
+ * @brief Pads a message with PKCS7 and encrypts it with an ECB or CBC
+ * encryption key.
+ *
+ * Only the last block is padded, on the stack, so the message may be
+ * encrypted where it is when its buffer has room for the padding.
+ *
+ * @param[in] aes_key: the key
+ * @param[in,out] iv: CBC initialization vector, updated. Unused by ECB.
+ * @param[in] input: the message
+ * @param[in] len: length of the message
+ * @param[out] output: the ciphertext, may be input
+ * @param[in] size: size of output, at least TAL_AES_PKCS7_LEN(len)
+ * @param[out] olen: length of the ciphertext
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_aes_key_encrypt_pkcs7(tal_aes_key_t *aes_key, uint8_t iv[16], const uint8_t *input, size_t len,
+                                      uint8_t *output, size_t size, size_t *olen);
+
+/**
+ * @brief Decrypts a PKCS7 padded message with an ECB or CBC decryption key
+ * and checks the padding.
+ *
+ * @param[in] aes_key: the key
+ * @param[in,out] iv: CBC initialization vector, updated. Unused by ECB.
+ * @param[in] input: the ciphertext
+ * @param[in] len: length of the ciphertext, a multiple of 16
+ * @param[out] output: len bytes, may be input
+ * @param[out] olen: length of the message without the padding
+ *
+ * @return OPRT_OK on success, OPRT_COM_ERROR if the padding is malformed.
+ * Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tal_aes_key_decrypt_pkcs7(tal_aes_key_t *aes_key, uint8_t iv[16], const uint8_t *input, size_t len,
+                                      uint8_t *output, size_t *olen);
+
+/**
+ * @brief Encrypts and authenticates a message with a GCM key.
+ *
+ * @param[in] aes_key: the key
+ * @param[in] iv: the nonce, 12 bytes are recommended
+ * @param[in] iv_len: length of the nonce
+ * @param[in] ad: additional data, may be NULL when ad_len is 0
+ * @param[in] ad_len: length of the additional data
+ * @param[in] input: the message
+ * @param[in] len: length of the message
+ * @param[out] output: len bytes, may be input
+ * @param[out] tag: the authentication tag
+ * @param[in] tag_len: length of the tag, 4 to 16
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_aes_key_gcm_encrypt(tal_aes_key_t *aes_key, const uint8_t *iv, size_t iv_len, const uint8_t *ad,
+                                    size_t ad_len, const uint8_t *input, size_t len, uint8_t *output, uint8_t *tag,
+                                    size_t tag_len);
+
+/**
+ * @brief Decrypts a message with a GCM key and checks its tag.
+ *
+ * @param[in] aes_key: the key
+ * @param[in] iv: the nonce
+ * @param[in] iv_len: length of the nonce
+ * @param[in] ad: additional data, may be NULL when ad_len is 0
+ * @param[in] ad_len: length of the additional data
+ * @param[in] input: the ciphertext
+ * @param[in] len: length of the ciphertext
+ * @param[out] output: len bytes, may be input. Cleared when the tag does not
+ * match.
+ * @param[in] tag: the authentication tag
+ * @param[in] tag_len: length of the tag
+ *
+ * @return OPRT_OK on success, OPRT_AUTHENTICATION_FAIL if the tag does not
+ * match. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tal_aes_key_gcm_decrypt(tal_aes_key_t *aes_key, const uint8_t *iv, size_t iv_len, const uint8_t *ad,
+                                    size_t ad_len, const uint8_t *input, size_t len, uint8_t *output,
+                                    const uint8_t *tag, size_t tag_len);
+
+/**
+ * @brief Starts a message encrypted or decrypted in chunks of any length.
+ *
+ * A GCM stream runs in the context of its key, the key must not be used for
+ * anything else until the stream is finished. ECB, CBC and CTR keys may run
+ * any number of streams at once.
+ *
+ * @param[out] stream: the stream
+ * @param[in] aes_key: the key
+ * @param[in] crypt: direction, that of the key for ECB and CBC
+ * @param[in] iv: CBC initialization vector, CTR counter block or GCM nonce.
+ * Unused by ECB.
+ * @param[in] iv_len: length of iv, 16 unless GCM
+ * @param[in] padding: ECB and CBC only, pad with PKCS7 when encrypting and
+ * remove the padding when decrypting
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_aes_stream_start(tal_aes_stream_t *stream, tal_aes_key_t *aes_key, TAL_SYMMETRY_CRYPT_MODE crypt,
+                                 const uint8_t *iv, size_t iv_len, BOOL_T padding);
+
+/**
+ * @brief Feeds the additional data of a GCM stream, before any chunk.
+ *
+ * @param[in] stream: the stream
+ * @param[in] ad: additional data
+ * @param[in] ad_len: length of the additional data
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_aes_stream_ad(tal_aes_stream_t *stream, const uint8_t *ad, size_t ad_len);
+
+/**
+ * @brief Encrypts or decrypts the next chunk of a stream.
+ *
+ * ECB and CBC keep up to one block back for the next chunk or for
+ * tal_aes_stream_finish(), so a chunk outputs up to 15 bytes more or 16
+ * bytes fewer than it takes. Input and output must not overlap for them,
+ * CTR and GCM output as many bytes as they take and may work in place.
+ *
+ * @param[in] stream: the stream
+ * @param[in] input: the chunk
+ * @param[in] ilen: length of the chunk
+ * @param[out] output: the output
+ * @param[in] size: size of output, ilen + 15 is always enough
+ * @param[out] olen: bytes written to output
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_aes_stream_update(tal_aes_stream_t *stream, const uint8_t *input, size_t ilen, uint8_t *output,
+                                  size_t size, size_t *olen);
+
+/**
+ * @brief Finishes a stream: the padded last block of ECB and CBC, the tag of
+ * GCM.
+ *
+ * @param[in] stream: the stream
+ * @param[out] output: the last bytes, up to 16
+ * @param[in] size: size of output
+ * @param[out] olen: bytes written to output
+ * @param[in,out] tag: GCM only, written when encrypting, checked when
+ * decrypting
+ * @param[in] tag_len: length of the tag
+ *
+ * @return OPRT_OK on success, OPRT_COM_ERROR if the padding is malformed,
+ * OPRT_AUTHENTICATION_FAIL if the tag does not match. Others on error, please
+ * refer to tuya_error_code.h
+ */
+OPERATE_RET tal_aes_stream_finish(tal_aes_stream_t *stream, uint8_t *output, size_t size, size_t *olen, uint8_t *tag,
+                                  size_t tag_len);
+
 /**
  * @brief Performs a self-test for the AES encryption algorithm.
  *
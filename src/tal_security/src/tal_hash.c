@@ -15,6 +15,12 @@
 #include "tkl_memory.h"
 #include "tal_hash.h"
 #include "tal_log.h"
+#if !defined(ENABLE_PLATFORM_SHA256)
+#include "mbedtls/sha256.h"
+#endif
+#if !defined(ENABLE_PLATFORM_SHA1)
+#include "mbedtls/sha1.h"
+#endif
 
 /**
  * @brief This function Create&initializes a sha256 context.
@@ -829,6 +835,430 @@ cleanup:
 
     return (ret);
 }
+/**
+ * @brief Keyed HMAC object. With the mbedtls hash the states after the inner
+ * and the outer pad are hashed once by tal_hash_mac_key_create and copied for
+ * every message. A platform hash has no way to copy a state, the pads are
+ * kept and hashed again, only the key setup and the allocation are saved.
+ */
+struct tal_hash_mac_key {
+    TAL_HASH_MAC_TYPE_E type;
+    BOOL_T cached;
+    union {
+#if !defined(ENABLE_PLATFORM_SHA256)
+        struct {
+            mbedtls_sha256_context inner;
+            mbedtls_sha256_context outer;
+            mbedtls_sha256_context work;
+        } sha256;
+#endif
+#if !defined(ENABLE_PLATFORM_SHA1)
+        struct {
+            mbedtls_sha1_context inner;
+            mbedtls_sha1_context outer;
+            mbedtls_sha1_context work;
+        } sha1;
+#endif
+        tal_hash_mac_context_t hmac;
+    } u;
+};
+
+#if !defined(ENABLE_PLATFORM_SHA256) || !defined(ENABLE_PLATFORM_SHA1)
+static OPERATE_RET __mac_key_cache(tal_hash_mac_key_t *mac_key)
+{
+    tal_hash_mac_context_t hmac = mac_key->u.hmac;
+    int ret = -1;
+
+    // the pads are set, the states of the two are hashed from them
+#if !defined(ENABLE_PLATFORM_SHA256)
+    if (TAL_HASH_MAC_SHA256 == mac_key->type) {
+        memset(&mac_key->u.sha256, 0, sizeof(mac_key->u.sha256));
+        mbedtls_sha256_init(&mac_key->u.sha256.inner);
+        mbedtls_sha256_init(&mac_key->u.sha256.outer);
+        mbedtls_sha256_init(&mac_key->u.sha256.work);
+        if (0 == (ret = mbedtls_sha256_starts(&mac_key->u.sha256.inner, 0)) &&
+            0 == (ret = mbedtls_sha256_update(&mac_key->u.sha256.inner, hmac.ipad, sizeof(hmac.ipad))) &&
+            0 == (ret = mbedtls_sha256_starts(&mac_key->u.sha256.outer, 0))) {
+            ret = mbedtls_sha256_update(&mac_key->u.sha256.outer, hmac.opad, sizeof(hmac.opad));
+        }
+        mbedtls_sha256_clone(&mac_key->u.sha256.work, &mac_key->u.sha256.inner);
+    }
+#endif
+#if !defined(ENABLE_PLATFORM_SHA1)
+    if (TAL_HASH_MAC_SHA1 == mac_key->type) {
+        memset(&mac_key->u.sha1, 0, sizeof(mac_key->u.sha1));
+        mbedtls_sha1_init(&mac_key->u.sha1.inner);
+        mbedtls_sha1_init(&mac_key->u.sha1.outer);
+        mbedtls_sha1_init(&mac_key->u.sha1.work);
+        if (0 == (ret = mbedtls_sha1_starts(&mac_key->u.sha1.inner)) &&
+            0 == (ret = mbedtls_sha1_update(&mac_key->u.sha1.inner, hmac.ipad, sizeof(hmac.ipad))) &&
+            0 == (ret = mbedtls_sha1_starts(&mac_key->u.sha1.outer))) {
+            ret = mbedtls_sha1_update(&mac_key->u.sha1.outer, hmac.opad, sizeof(hmac.opad));
+        }
+        mbedtls_sha1_clone(&mac_key->u.sha1.work, &mac_key->u.sha1.inner);
+    }
+#endif
+    memset(&hmac, 0, sizeof(hmac));
+    // the union holds the states from now on, even when one failed
+    mac_key->cached = TRUE;
+
+    return (0 == ret) ? OPRT_OK : OPRT_COM_ERROR;
+}
+#endif
+
+/**
+ * @brief This function creates a keyed HMAC object.
+ *
+ * @param[in] type: TAL_HASH_MAC_SHA1 or TAL_HASH_MAC_SHA256
+ * @param[in] key: key
+ * @param[in] keylen: keylen
+ * @param[out] mac_key: the keyed object, ready for a message
+ *
+ * @note The key is processed once here, every message signed with the object
+ * afterwards skips it.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_hash_mac_key_create(TAL_HASH_MAC_TYPE_E type, const uint8_t *key, size_t keylen,
+                                    tal_hash_mac_key_t **mac_key)
+{
+    OPERATE_RET ret = OPRT_OK;
+    tal_hash_mac_key_t *object = NULL;
+    tal_hash_mac_context_t hmac;
+
+    if (NULL == mac_key || (NULL == key && 0 != keylen) ||
+        (TAL_HASH_MAC_SHA1 != type && TAL_HASH_MAC_SHA256 != type)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    object = (tal_hash_mac_key_t *)tkl_system_malloc(sizeof(tal_hash_mac_key_t));
+    if (NULL == object) {
+        return OPRT_MALLOC_FAILED;
+    }
+    memset(object, 0, sizeof(tal_hash_mac_key_t));
+    object->type = type;
+
+    // computes the pads and starts the inner hash
+    if (TAL_HASH_MAC_SHA256 == type) {
+        if (OPRT_OK == (ret = tal_sha256_mac_create_init(&hmac))) {
+            ret = tal_sha256_mac_starts(&hmac, key, keylen);
+        }
+    } else {
+        if (OPRT_OK == (ret = tal_sha1_mac_create_init(&hmac))) {
+            ret = tal_sha1_mac_starts(&hmac, key, keylen);
+        }
+    }
+    object->u.hmac = hmac;
+    if (OPRT_OK != ret) {
+        tal_hash_mac_key_free(object);
+        return ret;
+    }
+
+#if !defined(ENABLE_PLATFORM_SHA256)
+    if (TAL_HASH_MAC_SHA256 == type) {
+        tal_sha256_free(hmac.ctx);
+        ret = __mac_key_cache(object);
+    }
+#endif
+#if !defined(ENABLE_PLATFORM_SHA1)
+    if (TAL_HASH_MAC_SHA1 == type) {
+        tal_sha1_free(hmac.ctx);
+        ret = __mac_key_cache(object);
+    }
+#endif
+    memset(&hmac, 0, sizeof(hmac));
+    if (OPRT_OK != ret) {
+        tal_hash_mac_key_free(object);
+        return ret;
+    }
+
+    *mac_key = object;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief This function frees a keyed HMAC object.
+ *
+ * @param[in] mac_key: the keyed object
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_hash_mac_key_free(tal_hash_mac_key_t *mac_key)
+{
+    if (NULL == mac_key) {
+        return OPRT_OK;
+    }
+
+    if (mac_key->cached) {
+#if !defined(ENABLE_PLATFORM_SHA256)
+        if (TAL_HASH_MAC_SHA256 == mac_key->type) {
+            mbedtls_sha256_free(&mac_key->u.sha256.inner);
+            mbedtls_sha256_free(&mac_key->u.sha256.outer);
+            mbedtls_sha256_free(&mac_key->u.sha256.work);
+        }
+#endif
+#if !defined(ENABLE_PLATFORM_SHA1)
+        if (TAL_HASH_MAC_SHA1 == mac_key->type) {
+            mbedtls_sha1_free(&mac_key->u.sha1.inner);
+            mbedtls_sha1_free(&mac_key->u.sha1.outer);
+            mbedtls_sha1_free(&mac_key->u.sha1.work);
+        }
+#endif
+    } else if (TAL_HASH_MAC_SHA256 == mac_key->type) {
+        tal_sha256_mac_free(&mac_key->u.hmac);
+    } else {
+        tal_sha1_mac_free(&mac_key->u.hmac);
+    }
+
+    // the states are derived from the key
+    memset(mac_key, 0, sizeof(tal_hash_mac_key_t));
+    tkl_system_free(mac_key);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief This function drops the message fed so far and starts a new one.
+ *
+ * @param[in] mac_key: the keyed object
+ *
+ * @note tal_hash_mac_key_finish already does it, this is for a message given
+ * up in the middle.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_hash_mac_key_starts(tal_hash_mac_key_t *mac_key)
+{
+    TKL_HASH_HANDLE ctx = NULL;
+
+    if (NULL == mac_key) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (mac_key->cached) {
+#if !defined(ENABLE_PLATFORM_SHA256)
+        if (TAL_HASH_MAC_SHA256 == mac_key->type) {
+            mbedtls_sha256_clone(&mac_key->u.sha256.work, &mac_key->u.sha256.inner);
+        }
+#endif
+#if !defined(ENABLE_PLATFORM_SHA1)
+        if (TAL_HASH_MAC_SHA1 == mac_key->type) {
+            mbedtls_sha1_clone(&mac_key->u.sha1.work, &mac_key->u.sha1.inner);
+        }
+#endif
+        return OPRT_OK;
+    }
+
+    ctx = mac_key->u.hmac.ctx;
+    if (TAL_HASH_MAC_SHA256 == mac_key->type) {
+        if (OPRT_OK != tal_sha256_starts_ret(ctx, 0)) {
+            return OPRT_COM_ERROR;
+        }
+        return tal_sha256_update_ret(ctx, mac_key->u.hmac.ipad, sizeof(mac_key->u.hmac.ipad));
+    }
+    if (OPRT_OK != tal_sha1_starts_ret(ctx)) {
+        return OPRT_COM_ERROR;
+    }
+    return tal_sha1_update_ret(ctx, mac_key->u.hmac.ipad, sizeof(mac_key->u.hmac.ipad));
+}
+
+/**
+ * @brief This function feeds an input buffer into the message being signed.
+ *
+ * @param[in] mac_key: the keyed object
+ * @param[in] input:    The buffer holding the data. This must be a readable
+ *                 buffer of length \p ilen Bytes.
+ * @param[in] ilen:     The length of the input data in Bytes.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_hash_mac_key_update(tal_hash_mac_key_t *mac_key, const uint8_t *input, size_t ilen)
+{
+    int ret = -1;
+
+    if (NULL == mac_key || (NULL == input && 0 != ilen)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (!mac_key->cached) {
+        return (TAL_HASH_MAC_SHA256 == mac_key->type) ? tal_sha256_mac_update(&mac_key->u.hmac, input, ilen)
+                                                      : tal_sha1_mac_update(&mac_key->u.hmac, input, ilen);
+    }
+
+#if !defined(ENABLE_PLATFORM_SHA256)
+    if (TAL_HASH_MAC_SHA256 == mac_key->type) {
+        ret = mbedtls_sha256_update(&mac_key->u.sha256.work, input, ilen);
+    }
+#endif
+#if !defined(ENABLE_PLATFORM_SHA1)
+    if (TAL_HASH_MAC_SHA1 == mac_key->type) {
+        ret = mbedtls_sha1_update(&mac_key->u.sha1.work, input, ilen);
+    }
+#endif
+
+    return (0 == ret) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+/**
+ * @brief This function finishes the message, writes its MAC and starts the
+ * next one.
+ *
+ * @param[in] mac_key: the keyed object
+ * @param[out] output: the MAC, 32 bytes for SHA256 and 20 for SHA1
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_hash_mac_key_finish(tal_hash_mac_key_t *mac_key, uint8_t *output)
+{
+    OPERATE_RET ret = OPRT_OK;
+    uint8_t tmp[32];
+    int err = -1;
+
+    if (NULL == mac_key || NULL == output) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (!mac_key->cached) {
+        ret = (TAL_HASH_MAC_SHA256 == mac_key->type) ? tal_sha256_mac_finish(&mac_key->u.hmac, output)
+                                                     : tal_sha1_mac_finish(&mac_key->u.hmac, output);
+        if (OPRT_OK != ret) {
+            return ret;
+        }
+        return tal_hash_mac_key_starts(mac_key);
+    }
+
+    // H(opad || H(ipad || message)), both prefixes from their saved states
+#if !defined(ENABLE_PLATFORM_SHA256)
+    if (TAL_HASH_MAC_SHA256 == mac_key->type) {
+        if (0 == (err = mbedtls_sha256_finish(&mac_key->u.sha256.work, tmp))) {
+            mbedtls_sha256_clone(&mac_key->u.sha256.work, &mac_key->u.sha256.outer);
+            if (0 == (err = mbedtls_sha256_update(&mac_key->u.sha256.work, tmp, 32))) {
+                err = mbedtls_sha256_finish(&mac_key->u.sha256.work, output);
+            }
+        }
+    }
+#endif
+#if !defined(ENABLE_PLATFORM_SHA1)
+    if (TAL_HASH_MAC_SHA1 == mac_key->type) {
+        if (0 == (err = mbedtls_sha1_finish(&mac_key->u.sha1.work, tmp))) {
+            mbedtls_sha1_clone(&mac_key->u.sha1.work, &mac_key->u.sha1.outer);
+            if (0 == (err = mbedtls_sha1_update(&mac_key->u.sha1.work, tmp, 20))) {
+                err = mbedtls_sha1_finish(&mac_key->u.sha1.work, output);
+            }
+        }
+    }
+#endif
+    memset(tmp, 0, sizeof(tmp));
+    tal_hash_mac_key_starts(mac_key);
+
+    return (0 == err) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+/**
+ * @brief This function signs one message with a keyed HMAC object.
+ *
+ * @param[in] mac_key: the keyed object
+ * @param[in] input: the message
+ * @param[in] ilen: length of the message
+ * @param[out] output: the MAC, 32 bytes for SHA256 and 20 for SHA1
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_hash_mac_key_sign(tal_hash_mac_key_t *mac_key, const uint8_t *input, size_t ilen, uint8_t *output)
+{
+    OPERATE_RET ret = OPRT_OK;
+
+    if (OPRT_OK != (ret = tal_hash_mac_key_update(mac_key, input, ilen))) {
+        tal_hash_mac_key_starts(mac_key);
+        return ret;
+    }
+
+    return tal_hash_mac_key_finish(mac_key, output);
+}
+
+/**
+ * @brief This function signs several messages with a keyed HMAC object.
+ *
+ * @param[in] mac_key: the keyed object
+ * @param[in] bufs: the messages
+ * @param[in] num: number of messages
+ * @param[out] output: the MACs one after the other, num times 32 bytes for
+ * SHA256 and 20 for SHA1
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_hash_mac_key_sign_multi(tal_hash_mac_key_t *mac_key, const tal_hash_buf_t *bufs, uint32_t num,
+                                        uint8_t *output)
+{
+    OPERATE_RET ret = OPRT_OK;
+    size_t size = 0;
+    uint32_t i;
+
+    if (NULL == mac_key || (NULL == bufs && 0 != num) || (NULL == output && 0 != num)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    size = (TAL_HASH_MAC_SHA256 == mac_key->type) ? 32 : 20;
+    for (i = 0; i < num; i++) {
+        if (OPRT_OK != (ret = tal_hash_mac_key_sign(mac_key, bufs[i].input, bufs[i].ilen, output + i * size))) {
+            return ret;
+        }
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief This function calculates the sha224 or sha256 checksums of several
+ * buffers with one context.
+ *
+ * @param[in] bufs: the buffers
+ * @param[in] num: number of buffers
+ * @param[out] output: the checksums one after the other, num times 32 bytes,
+ * or 28 for sha224
+ * @param[in] is224: \c 0 for sha256, \c 1 for sha224
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_sha256_multi_ret(const tal_hash_buf_t *bufs, uint32_t num, uint8_t *output, int32_t is224)
+{
+    OPERATE_RET ret = OPRT_OK;
+    TKL_HASH_HANDLE ctx = NULL;
+    uint8_t sum[32];
+    size_t size = is224 ? 28 : 32;
+    uint32_t i;
+
+    if ((NULL == bufs || NULL == output) && 0 != num) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if ((ret = tal_sha256_create_init(&ctx)) != OPRT_OK) {
+        return ret;
+    }
+
+    for (i = 0; i < num; i++) {
+        if ((ret = tal_sha256_starts_ret(ctx, is224)) != OPRT_OK ||
+            (ret = tal_sha256_update_ret(ctx, bufs[i].input, bufs[i].ilen)) != OPRT_OK ||
+            (ret = tal_sha256_finish_ret(ctx, sum)) != OPRT_OK) {
+            break;
+        }
+        memcpy(output + i * size, sum, size);
+    }
+
+    tal_sha256_free(ctx);
+
+    return ret;
+}
+
 #if defined(ENABLE_TAL_SECURITY_SELF_TEST)
 /*
  * FIPS-180-2 test vectors
@@ -1156,6 +1586,32 @@ static const uint8_t sha256_mac_test_sum[7][32] = {
     {0x9b, 0x09, 0xff, 0xa7, 0x1b, 0x94, 0x2f, 0xcb, 0x27, 0x63, 0x5f, 0xbc, 0xd5, 0xb0, 0xe9, 0x44,
      0xbf, 0xdc, 0x63, 0x64, 0x4f, 0x07, 0x13, 0x93, 0x8a, 0x7f, 0x51, 0x53, 0x5c, 0x3a, 0x35, 0xe2}};
 
+/*
+ * A keyed object signs like the one-shot MAC, also when it is reused
+ */
+static OPERATE_RET __mac_key_self_test(TAL_HASH_MAC_TYPE_E type, const uint8_t *key, size_t keylen,
+                                       const uint8_t *buf, size_t buflen, const uint8_t *sum, uint32_t len)
+{
+    OPERATE_RET ret = OPRT_OK;
+    tal_hash_mac_key_t *mac_key = NULL;
+    uint8_t mac[32];
+    int32_t i;
+
+    if ((ret = tal_hash_mac_key_create(type, key, keylen, &mac_key)) != OPRT_OK) {
+        return ret;
+    }
+
+    for (i = 0; i < 2 && OPRT_OK == ret; i++) {
+        ret = tal_hash_mac_key_sign(mac_key, buf, buflen, mac);
+        if (OPRT_OK == ret && memcmp(mac, sum, len) != 0) {
+            ret = 1;
+        }
+    }
+    tal_hash_mac_key_free(mac_key);
+
+    return ret;
+}
+
 /*
  * Checkup routine
  */
@@ -1186,6 +1642,12 @@ OPERATE_RET tal_sha256_mac_self_test(int32_t verbose)
             goto fail;
         }
 
+        ret = __mac_key_self_test(TAL_HASH_MAC_SHA256, sha256_mac_test_key[i], sha256_mac_test_keylen[i],
+                                  sha256_mac_test_buf[i], sha256_mac_test_buflen[i], sha256_mac_test_sum[i], len);
+        if (ret != 0) {
+            goto fail;
+        }
+
         if (verbose != 0) {
             PR_DEBUG("passed\n");
         }
@@ -1294,6 +1756,12 @@ OPERATE_RET tal_sha1_mac_self_test(int32_t verbose)
             goto fail;
         }
 
+        ret = __mac_key_self_test(TAL_HASH_MAC_SHA1, sha1_mac_test_key[i], sha1_mac_test_keylen[i],
+                                  sha1_mac_test_buf[i], sha1_mac_test_buflen[i], sha1_mac_test_sum[i], len);
+        if (ret != 0) {
+            goto fail;
+        }
+
         if (verbose != 0) {
             PR_DEBUG("passed\n");
         }
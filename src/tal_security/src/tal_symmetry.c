@@ -15,6 +15,16 @@
 #include "tal_symmetry.h"
 #include "tal_log.h"
 #include "tal_memory.h"
+#include "mbedtls/gcm.h"
+
+struct tal_aes_key {
+    TAL_AES_MODE_E mode;
+    TAL_SYMMETRY_CRYPT_MODE crypt;
+    union {
+        TKL_SYMMETRY_HANDLE ctx; // ECB, CBC and CTR
+        mbedtls_gcm_context gcm;
+    } u;
+};
 
 /**
  * @brief This function Create&initializes a aes context.
@@ -729,6 +739,523 @@ OPERATE_RET tal_aes_free_data(uint8_t *data)
     return OPRT_OK;
 }
 
+/**
+ * @brief Creates a key for an AES mode and sets it up once.
+ *
+ * @param[in] mode: the AES mode the key is used with
+ * @param[in] crypt: direction of an ECB or CBC key
+ * @param[in] key: the AES key
+ * @param[in] keybits: 128, 192 or 256
+ * @param[out] aes_key: the key
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_aes_key_create(TAL_AES_MODE_E mode, TAL_SYMMETRY_CRYPT_MODE crypt, const uint8_t *key,
+                               uint32_t keybits, tal_aes_key_t **aes_key)
+{
+    OPERATE_RET ret = OPRT_OK;
+    tal_aes_key_t *k = NULL;
+
+    if (NULL == key || NULL == aes_key || mode > TAL_AES_GCM) {
+        return OPRT_INVALID_PARM;
+    }
+
+    k = tal_malloc(sizeof(tal_aes_key_t));
+    if (NULL == k) {
+        return OPRT_MALLOC_FAILED;
+    }
+    memset(k, 0, sizeof(tal_aes_key_t));
+    k->mode = mode;
+    k->crypt = crypt;
+
+    if (TAL_AES_GCM == mode) {
+        mbedtls_gcm_init(&k->u.gcm);
+        ret = (0 == mbedtls_gcm_setkey(&k->u.gcm, MBEDTLS_CIPHER_ID_AES, key, keybits)) ? OPRT_OK : OPRT_COM_ERROR;
+    } else {
+        ret = tal_aes_create_init(&k->u.ctx);
+        if (OPRT_OK == ret && NULL == k->u.ctx) {
+            ret = OPRT_MALLOC_FAILED;
+        }
+        // CTR only ever runs the cipher forwards
+        if (OPRT_OK == ret && SYMMETRY_DECRYPT == crypt && TAL_AES_CTR != mode) {
+            ret = tal_aes_setkey_dec(k->u.ctx, (uint8_t *)key, keybits);
+        } else if (OPRT_OK == ret) {
+            ret = tal_aes_setkey_enc(k->u.ctx, (uint8_t *)key, keybits);
+        }
+    }
+
+    if (OPRT_OK != ret) {
+        tal_aes_key_free(k);
+        return ret;
+    }
+    *aes_key = k;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Releases a key and clears its schedule.
+ *
+ * @param[in] aes_key: the key, may be NULL
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_aes_key_free(tal_aes_key_t *aes_key)
+{
+    if (NULL == aes_key) {
+        return OPRT_OK;
+    }
+
+    if (TAL_AES_GCM == aes_key->mode) {
+        mbedtls_gcm_free(&aes_key->u.gcm);
+    } else if (aes_key->u.ctx) {
+        tal_aes_free(aes_key->u.ctx);
+    }
+    tal_free(aes_key);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Encrypts or decrypts a message of full blocks with an ECB, CBC or
+ * CTR key.
+ *
+ * @param[in] aes_key: the key
+ * @param[in,out] iv: CBC initialization vector or CTR counter block
+ * @param[in] input: the message
+ * @param[in] len: length of the message
+ * @param[out] output: len bytes, may be input
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_aes_key_crypt(tal_aes_key_t *aes_key, uint8_t iv[16], const uint8_t *input, size_t len,
+                              uint8_t *output)
+{
+    uint8_t stream_block[16];
+    size_t nc_off = 0;
+
+    if (NULL == aes_key || (NULL == input && len) || (NULL == output && len)) {
+        return OPRT_INVALID_PARM;
+    }
+    if (0 == len) {
+        return OPRT_OK;
+    }
+
+    switch (aes_key->mode) {
+    case TAL_AES_ECB:
+        if (len % 16) {
+            return OPRT_INVALID_PARM;
+        }
+        return tal_aes_crypt_ecb(aes_key->u.ctx, aes_key->crypt, len, (uint8_t *)input, output);
+
+    case TAL_AES_CBC:
+        if (NULL == iv || len % 16) {
+            return OPRT_INVALID_PARM;
+        }
+        return tal_aes_crypt_cbc(aes_key->u.ctx, aes_key->crypt, len, iv, (uint8_t *)input, output);
+
+    case TAL_AES_CTR:
+        if (NULL == iv) {
+            return OPRT_INVALID_PARM;
+        }
+        return tal_aes_crypt_ctr(aes_key->u.ctx, len, &nc_off, iv, stream_block, (uint8_t *)input, output);
+
+    default:
+        return OPRT_INVALID_PARM;
+    }
+}
+
+// checks the padding of the last block without branching on its bytes
+static OPERATE_RET __pkcs7_strip(const uint8_t *data, size_t len, size_t *olen)
+{
+    uint8_t pad = data[len - 1], diff = 0;
+    uint32_t i;
+
+    if (0 == pad || pad > 16 || pad > len) {
+        return OPRT_COM_ERROR;
+    }
+    for (i = 0; i < 16; i++) {
+        // the mask keeps only the bytes of the padding
+        diff |= (data[len - 1 - i] ^ pad) & (uint8_t)(0 - (uint8_t)(i < pad));
+    }
+    if (diff) {
+        return OPRT_COM_ERROR;
+    }
+    *olen = len - pad;
+
+    return OPRT_OK;
+}
+
+static BOOL_T __key_is_block(const tal_aes_key_t *aes_key)
+{
+    return TAL_AES_ECB == aes_key->mode || TAL_AES_CBC == aes_key->mode;
+}
+
+/**
+ * @brief Pads a message with PKCS7 and encrypts it with an ECB or CBC
+ * encryption key.
+ *
+ * @param[in] aes_key: the key
+ * @param[in,out] iv: CBC initialization vector, updated
+ * @param[in] input: the message
+ * @param[in] len: length of the message
+ * @param[out] output: the ciphertext, may be input
+ * @param[in] size: size of output
+ * @param[out] olen: length of the ciphertext
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_aes_key_encrypt_pkcs7(tal_aes_key_t *aes_key, uint8_t iv[16], const uint8_t *input, size_t len,
+                                      uint8_t *output, size_t size, size_t *olen)
+{
+    OPERATE_RET ret = OPRT_OK;
+    size_t full = len & ~(size_t)15;
+    uint8_t last[16];
+
+    if (NULL == aes_key || (NULL == input && len) || NULL == output || NULL == olen || !__key_is_block(aes_key) ||
+        SYMMETRY_ENCRYPT != aes_key->crypt) {
+        return OPRT_INVALID_PARM;
+    }
+    if (size < TAL_AES_PKCS7_LEN(len)) {
+        return OPRT_BUFFER_NOT_ENOUGH;
+    }
+
+    // the tail is padded on the stack, the message is never copied
+    memcpy(last, input + full, len - full);
+    memset(last + len - full, (int)(16 - (len - full)), 16 - (len - full));
+
+    ret = tal_aes_key_crypt(aes_key, iv, input, full, output);
+    if (OPRT_OK == ret) {
+        ret = tal_aes_key_crypt(aes_key, iv, last, 16, output + full);
+    }
+    if (OPRT_OK == ret) {
+        *olen = full + 16;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Decrypts a PKCS7 padded message with an ECB or CBC decryption key
+ * and checks the padding.
+ *
+ * @param[in] aes_key: the key
+ * @param[in,out] iv: CBC initialization vector, updated
+ * @param[in] input: the ciphertext
+ * @param[in] len: length of the ciphertext
+ * @param[out] output: len bytes, may be input
+ * @param[out] olen: length of the message without the padding
+ *
+ * @return OPRT_OK on success, OPRT_COM_ERROR if the padding is malformed.
+ * Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tal_aes_key_decrypt_pkcs7(tal_aes_key_t *aes_key, uint8_t iv[16], const uint8_t *input, size_t len,
+                                      uint8_t *output, size_t *olen)
+{
+    OPERATE_RET ret = OPRT_OK;
+
+    if (NULL == aes_key || NULL == input || NULL == output || NULL == olen || 0 == len || len % 16 ||
+        !__key_is_block(aes_key) || SYMMETRY_DECRYPT != aes_key->crypt) {
+        return OPRT_INVALID_PARM;
+    }
+
+    ret = tal_aes_key_crypt(aes_key, iv, input, len, output);
+    if (OPRT_OK != ret) {
+        return ret;
+    }
+
+    return __pkcs7_strip(output, len, olen);
+}
+
+/**
+ * @brief Encrypts and authenticates a message with a GCM key.
+ *
+ * @param[in] aes_key: the key
+ * @param[in] iv: the nonce
+ * @param[in] iv_len: length of the nonce
+ * @param[in] ad: additional data
+ * @param[in] ad_len: length of the additional data
+ * @param[in] input: the message
+ * @param[in] len: length of the message
+ * @param[out] output: len bytes, may be input
+ * @param[out] tag: the authentication tag
+ * @param[in] tag_len: length of the tag
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_aes_key_gcm_encrypt(tal_aes_key_t *aes_key, const uint8_t *iv, size_t iv_len, const uint8_t *ad,
+                                    size_t ad_len, const uint8_t *input, size_t len, uint8_t *output, uint8_t *tag,
+                                    size_t tag_len)
+{
+    if (NULL == aes_key || TAL_AES_GCM != aes_key->mode || NULL == iv || NULL == tag) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (0 != mbedtls_gcm_crypt_and_tag(&aes_key->u.gcm, MBEDTLS_GCM_ENCRYPT, len, iv, iv_len, ad, ad_len, input,
+                                       output, tag_len, tag)) {
+        return OPRT_COM_ERROR;
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Decrypts a message with a GCM key and checks its tag.
+ *
+ * @param[in] aes_key: the key
+ * @param[in] iv: the nonce
+ * @param[in] iv_len: length of the nonce
+ * @param[in] ad: additional data
+ * @param[in] ad_len: length of the additional data
+ * @param[in] input: the ciphertext
+ * @param[in] len: length of the ciphertext
+ * @param[out] output: len bytes, may be input
+ * @param[in] tag: the authentication tag
+ * @param[in] tag_len: length of the tag
+ *
+ * @return OPRT_OK on success, OPRT_AUTHENTICATION_FAIL if the tag does not
+ * match. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tal_aes_key_gcm_decrypt(tal_aes_key_t *aes_key, const uint8_t *iv, size_t iv_len, const uint8_t *ad,
+                                    size_t ad_len, const uint8_t *input, size_t len, uint8_t *output,
+                                    const uint8_t *tag, size_t tag_len)
+{
+    int rt = 0;
+
+    if (NULL == aes_key || TAL_AES_GCM != aes_key->mode || NULL == iv || NULL == tag) {
+        return OPRT_INVALID_PARM;
+    }
+
+    rt = mbedtls_gcm_auth_decrypt(&aes_key->u.gcm, len, iv, iv_len, ad, ad_len, tag, tag_len, input, output);
+    if (MBEDTLS_ERR_GCM_AUTH_FAILED == rt) {
+        return OPRT_AUTHENTICATION_FAIL;
+    }
+
+    return (0 == rt) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+/**
+ * @brief Starts a message encrypted or decrypted in chunks of any length.
+ *
+ * @param[out] stream: the stream
+ * @param[in] aes_key: the key
+ * @param[in] crypt: direction
+ * @param[in] iv: CBC initialization vector, CTR counter block or GCM nonce
+ * @param[in] iv_len: length of iv
+ * @param[in] padding: ECB and CBC only, PKCS7 padding
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_aes_stream_start(tal_aes_stream_t *stream, tal_aes_key_t *aes_key, TAL_SYMMETRY_CRYPT_MODE crypt,
+                                 const uint8_t *iv, size_t iv_len, BOOL_T padding)
+{
+    if (NULL == stream || NULL == aes_key) {
+        return OPRT_INVALID_PARM;
+    }
+    if (__key_is_block(aes_key) && crypt != aes_key->crypt) {
+        return OPRT_INVALID_PARM;
+    }
+    if (TAL_AES_ECB != aes_key->mode && (NULL == iv || (TAL_AES_GCM != aes_key->mode && 16 != iv_len))) {
+        return OPRT_INVALID_PARM;
+    }
+
+    memset(stream, 0, sizeof(tal_aes_stream_t));
+    stream->key = aes_key;
+    stream->crypt = crypt;
+    stream->padding = __key_is_block(aes_key) ? padding : FALSE;
+
+    if (TAL_AES_GCM == aes_key->mode) {
+        if (0 != mbedtls_gcm_starts(&aes_key->u.gcm,
+                                    (SYMMETRY_ENCRYPT == crypt) ? MBEDTLS_GCM_ENCRYPT : MBEDTLS_GCM_DECRYPT, iv,
+                                    iv_len)) {
+            return OPRT_COM_ERROR;
+        }
+    } else if (TAL_AES_ECB != aes_key->mode) {
+        memcpy(stream->iv, iv, 16);
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Feeds the additional data of a GCM stream, before any chunk.
+ *
+ * @param[in] stream: the stream
+ * @param[in] ad: additional data
+ * @param[in] ad_len: length of the additional data
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_aes_stream_ad(tal_aes_stream_t *stream, const uint8_t *ad, size_t ad_len)
+{
+    if (NULL == stream || NULL == stream->key || TAL_AES_GCM != stream->key->mode) {
+        return OPRT_INVALID_PARM;
+    }
+
+    return (0 == mbedtls_gcm_update_ad(&stream->key->u.gcm, ad, ad_len)) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+/**
+ * @brief Encrypts or decrypts the next chunk of a stream.
+ *
+ * @param[in] stream: the stream
+ * @param[in] input: the chunk
+ * @param[in] ilen: length of the chunk
+ * @param[out] output: the output
+ * @param[in] size: size of output
+ * @param[out] olen: bytes written to output
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_aes_stream_update(tal_aes_stream_t *stream, const uint8_t *input, size_t ilen, uint8_t *output,
+                                  size_t size, size_t *olen)
+{
+    OPERATE_RET rt = OPRT_OK;
+    tal_aes_key_t *aes_key = NULL;
+    size_t blocks, keep, take, done = 0;
+
+    if (NULL == stream || NULL == stream->key || (NULL == input && ilen) || NULL == olen) {
+        return OPRT_INVALID_PARM;
+    }
+    aes_key = stream->key;
+    *olen = 0;
+
+    if (TAL_AES_GCM == aes_key->mode) {
+        return (0 == mbedtls_gcm_update(&aes_key->u.gcm, input, ilen, output, size, olen)) ? OPRT_OK : OPRT_COM_ERROR;
+    }
+    if (TAL_AES_CTR == aes_key->mode) {
+        if (size < ilen) {
+            return OPRT_BUFFER_NOT_ENOUGH;
+        }
+        rt = tal_aes_crypt_ctr(aes_key->u.ctx, ilen, &stream->block_len, stream->iv, stream->block, (uint8_t *)input,
+                                output);
+        if (OPRT_OK == rt) {
+            *olen = ilen;
+        }
+        return rt;
+    }
+
+    blocks = (stream->block_len + ilen) / 16;
+    keep = (stream->block_len + ilen) % 16;
+    // the padding is in the last block, it waits for finish
+    if (SYMMETRY_DECRYPT == stream->crypt && stream->padding && blocks && 0 == keep) {
+        blocks--;
+        keep = 16;
+    }
+    if (size < blocks * 16) {
+        return OPRT_BUFFER_NOT_ENOUGH;
+    }
+
+    if (blocks && stream->block_len) {
+        take = 16 - stream->block_len;
+        memcpy(stream->block + stream->block_len, input, take);
+        TUYA_CALL_ERR_RETURN(tal_aes_key_crypt(aes_key, stream->iv, stream->block, 16, output));
+        input += take;
+        ilen -= take;
+        stream->block_len = 0;
+        done = 16;
+        blocks--;
+    }
+    if (blocks) {
+        TUYA_CALL_ERR_RETURN(tal_aes_key_crypt(aes_key, stream->iv, input, blocks * 16, output + done));
+        input += blocks * 16;
+        ilen -= blocks * 16;
+        done += blocks * 16;
+    }
+    if (ilen) {
+        memcpy(stream->block + stream->block_len, input, ilen);
+        stream->block_len += ilen;
+    }
+    *olen = done;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Finishes a stream: the padded last block of ECB and CBC, the tag of
+ * GCM.
+ *
+ * @param[in] stream: the stream
+ * @param[out] output: the last bytes
+ * @param[in] size: size of output
+ * @param[out] olen: bytes written to output
+ * @param[in,out] tag: GCM only, written when encrypting, checked when
+ * decrypting
+ * @param[in] tag_len: length of the tag
+ *
+ * @return OPRT_OK on success, OPRT_COM_ERROR if the padding is malformed,
+ * OPRT_AUTHENTICATION_FAIL if the tag does not match. Others on error, please
+ * refer to tuya_error_code.h
+ */
+OPERATE_RET tal_aes_stream_finish(tal_aes_stream_t *stream, uint8_t *output, size_t size, size_t *olen, uint8_t *tag,
+                                  size_t tag_len)
+{
+    OPERATE_RET ret = OPRT_OK;
+    tal_aes_key_t *aes_key = NULL;
+    uint8_t last[16], diff = 0;
+    size_t len = 0, i;
+
+    if (NULL == stream || NULL == stream->key || NULL == olen) {
+        return OPRT_INVALID_PARM;
+    }
+    aes_key = stream->key;
+    *olen = 0;
+
+    if (TAL_AES_GCM == aes_key->mode) {
+        if (NULL == tag || tag_len > sizeof(last)) {
+            return OPRT_INVALID_PARM;
+        }
+        if (0 != mbedtls_gcm_finish(&aes_key->u.gcm, output, size, olen,
+                                    (SYMMETRY_ENCRYPT == stream->crypt) ? tag : last, tag_len)) {
+            ret = OPRT_COM_ERROR;
+        } else if (SYMMETRY_DECRYPT == stream->crypt) {
+            for (i = 0; i < tag_len; i++) {
+                diff |= last[i] ^ tag[i];
+            }
+            ret = diff ? OPRT_AUTHENTICATION_FAIL : OPRT_OK;
+        }
+    } else if (TAL_AES_CTR == aes_key->mode) {
+        ret = OPRT_OK;
+    } else if (!stream->padding) {
+        ret = stream->block_len ? OPRT_INVALID_PARM : OPRT_OK;
+    } else if (SYMMETRY_ENCRYPT == stream->crypt) {
+        memset(stream->block + stream->block_len, (int)(16 - stream->block_len), 16 - stream->block_len);
+        if (NULL == output || size < 16) {
+            ret = OPRT_BUFFER_NOT_ENOUGH;
+        } else {
+            ret = tal_aes_key_crypt(aes_key, stream->iv, stream->block, 16, output);
+            *olen = (OPRT_OK == ret) ? 16 : 0;
+        }
+    } else if (16 != stream->block_len) {
+        ret = OPRT_COM_ERROR;
+    } else {
+        ret = tal_aes_key_crypt(aes_key, stream->iv, stream->block, 16, last);
+        if (OPRT_OK == ret) {
+            ret = __pkcs7_strip(last, 16, &len);
+        }
+        if (OPRT_OK == ret && len && (NULL == output || size < len)) {
+            ret = OPRT_BUFFER_NOT_ENOUGH;
+        } else if (OPRT_OK == ret) {
+            memcpy(output, last, len);
+            *olen = len;
+        }
+    }
+
+    memset(last, 0, sizeof(last));
+    memset(stream->block, 0, sizeof(stream->block));
+    stream->block_len = 0;
+
+    return ret;
+}
+
 #if defined(ENABLE_TAL_SECURITY_SELF_TEST)
 /*
  * AES test vectors from:
@@ -789,6 +1316,34 @@ static const uint8_t aes_test_ctr_ct[3][48] = {
 
 static const int aes_test_ctr_len[3] = {16, 32, 36};
 
+/*
+ * AES-GCM test case 4 from:
+ *
+ * The Galois/Counter Mode of Operation (GCM), McGrew and Viega
+ */
+static const uint8_t aes_test_gcm_key[16] = {0xFE, 0xFF, 0xE9, 0x92, 0x86, 0x65, 0x73, 0x1C,
+                                             0x6D, 0x6A, 0x8F, 0x94, 0x67, 0x30, 0x83, 0x08};
+
+static const uint8_t aes_test_gcm_iv[12] = {0xCA, 0xFE, 0xBA, 0xBE, 0xFA, 0xCE, 0xDB, 0xAD, 0xDE, 0xCA, 0xF8, 0x88};
+
+static const uint8_t aes_test_gcm_ad[20] = {0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED,
+                                            0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF, 0xAB, 0xAD, 0xDA, 0xD2};
+
+static const uint8_t aes_test_gcm_pt[60] = {
+    0xD9, 0x31, 0x32, 0x25, 0xF8, 0x84, 0x06, 0xE5, 0xA5, 0x59, 0x09, 0xC5, 0xAF, 0xF5, 0x26, 0x9A,
+    0x86, 0xA7, 0xA9, 0x53, 0x15, 0x34, 0xF7, 0xDA, 0x2E, 0x4C, 0x30, 0x3D, 0x8A, 0x31, 0x8A, 0x72,
+    0x1C, 0x3C, 0x0C, 0x95, 0x95, 0x68, 0x09, 0x53, 0x2F, 0xCF, 0x0E, 0x24, 0x49, 0xA6, 0xB5, 0x25,
+    0xB1, 0x6A, 0xED, 0xF5, 0xAA, 0x0D, 0xE6, 0x57, 0xBA, 0x63, 0x7B, 0x39};
+
+static const uint8_t aes_test_gcm_ct[60] = {
+    0x42, 0x83, 0x1E, 0xC2, 0x21, 0x77, 0x74, 0x24, 0x4B, 0x72, 0x21, 0xB7, 0x84, 0xD0, 0xD4, 0x9C,
+    0xE3, 0xAA, 0x21, 0x2F, 0x2C, 0x02, 0xA4, 0xE0, 0x35, 0xC1, 0x7E, 0x23, 0x29, 0xAC, 0xA1, 0x2E,
+    0x21, 0xD5, 0x14, 0xB2, 0x54, 0x66, 0x93, 0x1C, 0x7D, 0x8F, 0x6A, 0x5A, 0xAC, 0x84, 0xAA, 0x05,
+    0x1B, 0xA3, 0x0B, 0x39, 0x6A, 0x0A, 0xAC, 0x97, 0x3D, 0x58, 0xE0, 0x91};
+
+static const uint8_t aes_test_gcm_tag[16] = {0x5B, 0xC9, 0x4F, 0xBC, 0x32, 0x21, 0xA5, 0xDB,
+                                             0x94, 0xFA, 0xE9, 0x5A, 0xE7, 0x12, 0x1A, 0x47};
+
 /*
  * Checkup routine
  */
@@ -807,6 +1362,9 @@ OPERATE_RET tal_aes_self_test(int32_t verbose)
     int32_t len;
     uint8_t nonce_counter[16];
     uint8_t stream_block[16];
+    uint8_t tag[16];
+    tal_aes_key_t *gcm_key = NULL;
+    tal_aes_stream_t stream;
 
     memset(key, 0, 32);
     tal_aes_create_init(&ctx);
@@ -976,6 +1534,58 @@ OPERATE_RET tal_aes_self_test(int32_t verbose)
         PR_DEBUG("\n");
     }
 
+    /*
+     * GCM mode, keyed once, whole and in chunks
+     */
+    if ((ret = tal_aes_key_create(TAL_AES_GCM, SYMMETRY_ENCRYPT, aes_test_gcm_key, 128, &gcm_key)) != 0) {
+        goto exit;
+    }
+
+    for (i = 0; i < 4; i++) {
+        mode = i & 1;
+
+        if (verbose != 0)
+            PR_DEBUG("  AES-GCM-128 (%s%s): ", (mode == SYMMETRY_DECRYPT) ? "dec" : "enc", (i >> 1) ? ", stream" : "");
+
+        memcpy(buf, (mode == SYMMETRY_DECRYPT) ? aes_test_gcm_ct : aes_test_gcm_pt, 60);
+        aes_tests = (mode == SYMMETRY_DECRYPT) ? aes_test_gcm_pt : aes_test_gcm_ct;
+        memcpy(tag, aes_test_gcm_tag, 16);
+
+        if (0 == (i >> 1) && mode == SYMMETRY_ENCRYPT) {
+            ret = tal_aes_key_gcm_encrypt(gcm_key, aes_test_gcm_iv, 12, aes_test_gcm_ad, 20, buf, 60, buf, tag, 16);
+        } else if (0 == (i >> 1)) {
+            ret = tal_aes_key_gcm_decrypt(gcm_key, aes_test_gcm_iv, 12, aes_test_gcm_ad, 20, buf, 60, buf, tag, 16);
+        } else {
+            ret = tal_aes_stream_start(&stream, gcm_key, mode, aes_test_gcm_iv, 12, FALSE);
+            if (ret == 0) {
+                ret = tal_aes_stream_ad(&stream, aes_test_gcm_ad, 20);
+            }
+            for (j = 0; j < 60 && ret == 0; j += 7) {
+                len = (60 - j < 7) ? 60 - j : 7;
+                ret = tal_aes_stream_update(&stream, buf + j, len, buf + j, len, &offset);
+            }
+            if (ret == 0) {
+                ret = tal_aes_stream_finish(&stream, NULL, 0, &offset, tag, 16);
+            }
+        }
+        if (ret != 0) {
+            goto exit;
+        }
+
+        if (memcmp(buf, aes_tests, 60) != 0 || memcmp(tag, aes_test_gcm_tag, 16) != 0) {
+            ret = 1;
+            goto exit;
+        }
+
+        if (verbose != 0) {
+            PR_DEBUG("passed\n");
+        }
+    }
+
+    if (verbose != 0) {
+        PR_DEBUG("\n");
+    }
+
     ret = 0;
 
 exit:
@@ -983,6 +1593,7 @@ exit:
         PR_DEBUG("failed\n");
     }
 
+    tal_aes_key_free(gcm_key);
     tal_aes_free(ctx);
 
     return (ret);
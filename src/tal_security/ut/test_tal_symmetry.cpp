@@ -0,0 +1,282 @@
+/**
+ * @file test_tal_symmetry.cpp
+ * @brief UT of the AES keys and streams of tal_symmetry.
+ *
+ * The keys are checked against the known answers of NIST SP 800-38A for ECB,
+ * CBC and CTR and against test case 4 of the GCM specification. PKCS7 is
+ * checked for every message length up to three blocks, in place, against
+ * tal_aes128_cbc_encode and through streams in odd chunks, and a bad padding
+ * or tag must be refused.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <string.h>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "tuya_cloud_types.h"
+#include "tuya_error_code.h"
+#include "tal_log.h"
+#include "tal_symmetry.h"
+}
+
+#define TAG_LEN 16
+
+namespace {
+
+// NIST SP 800-38A, F.1.1, F.2.1 and F.5.1
+const uint8_t sg_kat_key[16] = {0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+                                0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C};
+
+const uint8_t sg_kat_iv[16] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                               0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F};
+
+const uint8_t sg_kat_counter[16] = {0xF0, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7,
+                                    0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF};
+
+const uint8_t sg_kat_pt[64] = {
+    0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E, 0x11, 0x73, 0x93, 0x17, 0x2A,
+    0xAE, 0x2D, 0x8A, 0x57, 0x1E, 0x03, 0xAC, 0x9C, 0x9E, 0xB7, 0x6F, 0xAC, 0x45, 0xAF, 0x8E, 0x51,
+    0x30, 0xC8, 0x1C, 0x46, 0xA3, 0x5C, 0xE4, 0x11, 0xE5, 0xFB, 0xC1, 0x19, 0x1A, 0x0A, 0x52, 0xEF,
+    0xF6, 0x9F, 0x24, 0x45, 0xDF, 0x4F, 0x9B, 0x17, 0xAD, 0x2B, 0x41, 0x7B, 0xE6, 0x6C, 0x37, 0x10};
+
+const uint8_t sg_kat_ecb[64] = {
+    0x3A, 0xD7, 0x7B, 0xB4, 0x0D, 0x7A, 0x36, 0x60, 0xA8, 0x9E, 0xCA, 0xF3, 0x24, 0x66, 0xEF, 0x97,
+    0xF5, 0xD3, 0xD5, 0x85, 0x03, 0xB9, 0x69, 0x9D, 0xE7, 0x85, 0x89, 0x5A, 0x96, 0xFD, 0xBA, 0xAF,
+    0x43, 0xB1, 0xCD, 0x7F, 0x59, 0x8E, 0xCE, 0x23, 0x88, 0x1B, 0x00, 0xE3, 0xED, 0x03, 0x06, 0x88,
+    0x7B, 0x0C, 0x78, 0x5E, 0x27, 0xE8, 0xAD, 0x3F, 0x82, 0x23, 0x20, 0x71, 0x04, 0x72, 0x5D, 0xD4};
+
+const uint8_t sg_kat_cbc[64] = {
+    0x76, 0x49, 0xAB, 0xAC, 0x81, 0x19, 0xB2, 0x46, 0xCE, 0xE9, 0x8E, 0x9B, 0x12, 0xE9, 0x19, 0x7D,
+    0x50, 0x86, 0xCB, 0x9B, 0x50, 0x72, 0x19, 0xEE, 0x95, 0xDB, 0x11, 0x3A, 0x91, 0x76, 0x78, 0xB2,
+    0x73, 0xBE, 0xD6, 0xB8, 0xE3, 0xC1, 0x74, 0x3B, 0x71, 0x16, 0xE6, 0x9E, 0x22, 0x22, 0x95, 0x16,
+    0x3F, 0xF1, 0xCA, 0xA1, 0x68, 0x1F, 0xAC, 0x09, 0x12, 0x0E, 0xCA, 0x30, 0x75, 0x86, 0xE1, 0xA7};
+
+const uint8_t sg_kat_ctr[64] = {
+    0x87, 0x4D, 0x61, 0x91, 0xB6, 0x20, 0xE3, 0x26, 0x1B, 0xEF, 0x68, 0x64, 0x99, 0x0D, 0xB6, 0xCE,
+    0x98, 0x06, 0xF6, 0x6B, 0x79, 0x70, 0xFD, 0xFF, 0x86, 0x17, 0x18, 0x7B, 0xB9, 0xFF, 0xFD, 0xFF,
+    0x5A, 0xE4, 0xDF, 0x3E, 0xDB, 0xD5, 0xD3, 0x5E, 0x5B, 0x4F, 0x09, 0x02, 0x0D, 0xB0, 0x3E, 0xAB,
+    0x1E, 0x03, 0x1D, 0xDA, 0x2F, 0xBE, 0x03, 0xD1, 0x79, 0x21, 0x70, 0xA0, 0xF3, 0x00, 0x9C, 0xEE};
+
+// The Galois/Counter Mode of Operation, McGrew and Viega, test case 4
+const uint8_t sg_gcm_key[16] = {0xFE, 0xFF, 0xE9, 0x92, 0x86, 0x65, 0x73, 0x1C,
+                                0x6D, 0x6A, 0x8F, 0x94, 0x67, 0x30, 0x83, 0x08};
+
+const uint8_t sg_gcm_iv[12] = {0xCA, 0xFE, 0xBA, 0xBE, 0xFA, 0xCE, 0xDB, 0xAD, 0xDE, 0xCA, 0xF8, 0x88};
+
+const uint8_t sg_gcm_ad[20] = {0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED,
+                               0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF, 0xAB, 0xAD, 0xDA, 0xD2};
+
+const uint8_t sg_gcm_pt[60] = {0xD9, 0x31, 0x32, 0x25, 0xF8, 0x84, 0x06, 0xE5, 0xA5, 0x59, 0x09, 0xC5,
+                               0xAF, 0xF5, 0x26, 0x9A, 0x86, 0xA7, 0xA9, 0x53, 0x15, 0x34, 0xF7, 0xDA,
+                               0x2E, 0x4C, 0x30, 0x3D, 0x8A, 0x31, 0x8A, 0x72, 0x1C, 0x3C, 0x0C, 0x95,
+                               0x95, 0x68, 0x09, 0x53, 0x2F, 0xCF, 0x0E, 0x24, 0x49, 0xA6, 0xB5, 0x25,
+                               0xB1, 0x6A, 0xED, 0xF5, 0xAA, 0x0D, 0xE6, 0x57, 0xBA, 0x63, 0x7B, 0x39};
+
+const uint8_t sg_gcm_ct[60] = {0x42, 0x83, 0x1E, 0xC2, 0x21, 0x77, 0x74, 0x24, 0x4B, 0x72, 0x21, 0xB7,
+                               0x84, 0xD0, 0xD4, 0x9C, 0xE3, 0xAA, 0x21, 0x2F, 0x2C, 0x02, 0xA4, 0xE0,
+                               0x35, 0xC1, 0x7E, 0x23, 0x29, 0xAC, 0xA1, 0x2E, 0x21, 0xD5, 0x14, 0xB2,
+                               0x54, 0x66, 0x93, 0x1C, 0x7D, 0x8F, 0x6A, 0x5A, 0xAC, 0x84, 0xAA, 0x05,
+                               0x1B, 0xA3, 0x0B, 0x39, 0x6A, 0x0A, 0xAC, 0x97, 0x3D, 0x58, 0xE0, 0x91};
+
+const uint8_t sg_gcm_tag[TAG_LEN] = {0x5B, 0xC9, 0x4F, 0xBC, 0x32, 0x21, 0xA5, 0xDB,
+                                     0x94, 0xFA, 0xE9, 0x5A, 0xE7, 0x12, 0x1A, 0x47};
+
+// a key with the chaining value of the KAT, the message in two calls so it carries over
+void __kat_check(TAL_AES_MODE_E mode, TAL_SYMMETRY_CRYPT_MODE crypt, const uint8_t *iv, const uint8_t *input,
+                 const uint8_t *expect)
+{
+    tal_aes_key_t *aes_key = NULL;
+    uint8_t chain[16] = {0}, out[64];
+
+    if (iv) {
+        memcpy(chain, iv, 16);
+    }
+    ASSERT_EQ(OPRT_OK, tal_aes_key_create(mode, crypt, sg_kat_key, 128, &aes_key));
+    EXPECT_EQ(OPRT_OK, tal_aes_key_crypt(aes_key, chain, input, 32, out));
+    EXPECT_EQ(OPRT_OK, tal_aes_key_crypt(aes_key, chain, input + 32, 32, out + 32));
+    tal_aes_key_free(aes_key);
+    EXPECT_EQ(0, memcmp(out, expect, 64));
+}
+
+// a message through a stream in chunks of chunk bytes
+OPERATE_RET __stream_run(tal_aes_key_t *aes_key, TAL_SYMMETRY_CRYPT_MODE crypt, const uint8_t *iv, size_t iv_len,
+                         const uint8_t *ad, size_t ad_len, const uint8_t *input, size_t len, size_t chunk,
+                         std::vector<uint8_t> *output, uint8_t *tag)
+{
+    tal_aes_stream_t stream;
+    OPERATE_RET rt = OPRT_OK;
+    size_t done = 0, n, i;
+
+    output->assign(len + chunk + 32, 0);
+    TUYA_CALL_ERR_RETURN(tal_aes_stream_start(&stream, aes_key, crypt, iv, iv_len, TRUE));
+    if (tag) {
+        TUYA_CALL_ERR_RETURN(tal_aes_stream_ad(&stream, ad, ad_len));
+    }
+    for (i = 0; i < len; i += chunk) {
+        n = (len - i < chunk) ? len - i : chunk;
+        TUYA_CALL_ERR_RETURN(tal_aes_stream_update(&stream, input + i, n, output->data() + done, chunk + 16, &n));
+        done += n;
+    }
+    TUYA_CALL_ERR_RETURN(tal_aes_stream_finish(&stream, output->data() + done, 16, &n, tag, TAG_LEN));
+    output->resize(done + n);
+
+    return OPRT_OK;
+}
+
+void __fill(uint8_t *buf, size_t len, uint8_t seed)
+{
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = (uint8_t)(i * 31 + seed);
+    }
+}
+
+} // namespace
+
+TEST(TalAesKey, EcbKnownAnswers)
+{
+    __kat_check(TAL_AES_ECB, SYMMETRY_ENCRYPT, NULL, sg_kat_pt, sg_kat_ecb);
+    __kat_check(TAL_AES_ECB, SYMMETRY_DECRYPT, NULL, sg_kat_ecb, sg_kat_pt);
+}
+
+TEST(TalAesKey, CbcKnownAnswers)
+{
+    __kat_check(TAL_AES_CBC, SYMMETRY_ENCRYPT, sg_kat_iv, sg_kat_pt, sg_kat_cbc);
+    __kat_check(TAL_AES_CBC, SYMMETRY_DECRYPT, sg_kat_iv, sg_kat_cbc, sg_kat_pt);
+}
+
+TEST(TalAesKey, CtrKnownAnswers)
+{
+    __kat_check(TAL_AES_CTR, SYMMETRY_ENCRYPT, sg_kat_counter, sg_kat_pt, sg_kat_ctr);
+    __kat_check(TAL_AES_CTR, SYMMETRY_DECRYPT, sg_kat_counter, sg_kat_ctr, sg_kat_pt);
+}
+
+TEST(TalAesKey, GcmKnownAnswer)
+{
+    tal_aes_key_t *aes_key = NULL;
+    uint8_t out[sizeof(sg_gcm_pt)], tag[TAG_LEN];
+    std::vector<uint8_t> stream_out;
+
+    ASSERT_EQ(OPRT_OK, tal_aes_key_create(TAL_AES_GCM, SYMMETRY_ENCRYPT, sg_gcm_key, 128, &aes_key));
+    EXPECT_EQ(OPRT_OK, tal_aes_key_gcm_encrypt(aes_key, sg_gcm_iv, sizeof(sg_gcm_iv), sg_gcm_ad, sizeof(sg_gcm_ad),
+                                               sg_gcm_pt, sizeof(sg_gcm_pt), out, tag, TAG_LEN));
+    EXPECT_EQ(0, memcmp(out, sg_gcm_ct, sizeof(sg_gcm_ct)));
+    EXPECT_EQ(0, memcmp(tag, sg_gcm_tag, TAG_LEN));
+
+    // in place
+    EXPECT_EQ(OPRT_OK, tal_aes_key_gcm_decrypt(aes_key, sg_gcm_iv, sizeof(sg_gcm_iv), sg_gcm_ad, sizeof(sg_gcm_ad), out,
+                                               sizeof(out), out, sg_gcm_tag, TAG_LEN));
+    EXPECT_EQ(0, memcmp(out, sg_gcm_pt, sizeof(sg_gcm_pt)));
+
+    // a stream in odd chunks gives the same
+    memset(tag, 0, sizeof(tag));
+    ASSERT_EQ(OPRT_OK, __stream_run(aes_key, SYMMETRY_ENCRYPT, sg_gcm_iv, sizeof(sg_gcm_iv), sg_gcm_ad,
+                                    sizeof(sg_gcm_ad), sg_gcm_pt, sizeof(sg_gcm_pt), 13, &stream_out, tag));
+    ASSERT_EQ(sizeof(sg_gcm_ct), stream_out.size());
+    EXPECT_EQ(0, memcmp(stream_out.data(), sg_gcm_ct, sizeof(sg_gcm_ct)));
+    EXPECT_EQ(0, memcmp(tag, sg_gcm_tag, TAG_LEN));
+    ASSERT_EQ(OPRT_OK, __stream_run(aes_key, SYMMETRY_DECRYPT, sg_gcm_iv, sizeof(sg_gcm_iv), sg_gcm_ad,
+                                    sizeof(sg_gcm_ad), sg_gcm_ct, sizeof(sg_gcm_ct), 13, &stream_out, tag));
+    EXPECT_EQ(0, memcmp(stream_out.data(), sg_gcm_pt, sizeof(sg_gcm_pt)));
+    tal_aes_key_free(aes_key);
+}
+
+TEST(TalAesKey, GcmBadTagIsRefused)
+{
+    tal_aes_key_t *aes_key = NULL;
+    tal_aes_stream_t stream;
+    uint8_t out[sizeof(sg_gcm_ct)], tag[TAG_LEN];
+    size_t olen = 0;
+
+    memcpy(tag, sg_gcm_tag, TAG_LEN);
+    tag[3] ^= 0x10;
+    ASSERT_EQ(OPRT_OK, tal_aes_key_create(TAL_AES_GCM, SYMMETRY_DECRYPT, sg_gcm_key, 128, &aes_key));
+    EXPECT_EQ(OPRT_AUTHENTICATION_FAIL,
+              tal_aes_key_gcm_decrypt(aes_key, sg_gcm_iv, sizeof(sg_gcm_iv), sg_gcm_ad, sizeof(sg_gcm_ad), sg_gcm_ct,
+                                      sizeof(sg_gcm_ct), out, tag, TAG_LEN));
+
+    ASSERT_EQ(OPRT_OK,
+              tal_aes_stream_start(&stream, aes_key, SYMMETRY_DECRYPT, sg_gcm_iv, sizeof(sg_gcm_iv), FALSE));
+    ASSERT_EQ(OPRT_OK, tal_aes_stream_ad(&stream, sg_gcm_ad, sizeof(sg_gcm_ad)));
+    ASSERT_EQ(OPRT_OK, tal_aes_stream_update(&stream, sg_gcm_ct, sizeof(sg_gcm_ct), out, sizeof(out), &olen));
+    EXPECT_EQ(OPRT_AUTHENTICATION_FAIL, tal_aes_stream_finish(&stream, NULL, 0, &olen, tag, TAG_LEN));
+    tal_aes_key_free(aes_key);
+}
+
+TEST(TalAesKey, Pkcs7AnyLength)
+{
+    static const size_t chunks[] = {1, 7, 16, 33};
+    uint8_t key[16], iv[16], chain[16], in[48], buf[TAL_AES_PKCS7_LEN(48)];
+    tal_aes_key_t *enc_key = NULL, *dec_key = NULL;
+    std::vector<uint8_t> out;
+    size_t olen, slen;
+
+    __fill(key, sizeof(key), 2);
+    __fill(iv, sizeof(iv), 3);
+    __fill(in, sizeof(in), 1);
+    ASSERT_EQ(OPRT_OK, tal_aes_key_create(TAL_AES_CBC, SYMMETRY_ENCRYPT, key, 128, &enc_key));
+    ASSERT_EQ(OPRT_OK, tal_aes_key_create(TAL_AES_CBC, SYMMETRY_DECRYPT, key, 128, &dec_key));
+
+    for (size_t len = 0; len <= sizeof(in); len++) {
+        // in place
+        memcpy(buf, in, len);
+        memcpy(chain, iv, 16);
+        ASSERT_EQ(OPRT_OK, tal_aes_key_encrypt_pkcs7(enc_key, chain, buf, len, buf, TAL_AES_PKCS7_LEN(len), &olen));
+        ASSERT_EQ(TAL_AES_PKCS7_LEN(len), olen) << len;
+
+        // the convenience function pads the same, it takes no empty message
+        if (len) {
+            uint8_t *ec_data = NULL;
+            uint32_t ec_len = 0;
+
+            memcpy(chain, iv, 16);
+            ASSERT_EQ(OPRT_OK, tal_aes128_cbc_encode(in, len, key, chain, &ec_data, &ec_len));
+            EXPECT_EQ(olen, ec_len) << len;
+            EXPECT_EQ(0, memcmp(ec_data, buf, olen)) << len;
+            tal_aes_free_data(ec_data);
+        }
+
+        for (size_t chunk : chunks) {
+            ASSERT_EQ(OPRT_OK, __stream_run(enc_key, SYMMETRY_ENCRYPT, iv, 16, NULL, 0, in, len, chunk, &out, NULL));
+            ASSERT_EQ(olen, out.size()) << len << " in chunks of " << chunk;
+            EXPECT_EQ(0, memcmp(out.data(), buf, olen)) << len << " in chunks of " << chunk;
+            ASSERT_EQ(OPRT_OK, __stream_run(dec_key, SYMMETRY_DECRYPT, iv, 16, NULL, 0, buf, olen, chunk, &out, NULL));
+            ASSERT_EQ(len, out.size()) << len << " in chunks of " << chunk;
+            EXPECT_EQ(0, memcmp(out.data(), in, len)) << len << " in chunks of " << chunk;
+        }
+
+        memcpy(chain, iv, 16);
+        ASSERT_EQ(OPRT_OK, tal_aes_key_decrypt_pkcs7(dec_key, chain, buf, olen, buf, &slen));
+        ASSERT_EQ(len, slen);
+        EXPECT_EQ(0, memcmp(buf, in, len)) << len;
+    }
+
+    tal_aes_key_free(enc_key);
+    tal_aes_key_free(dec_key);
+}
+
+TEST(TalAesKey, BadPaddingIsRefused)
+{
+    uint8_t key[16], chain[16], buf[16], out[16];
+    tal_aes_key_t *enc_key = NULL, *dec_key = NULL;
+    size_t slen = 0;
+
+    __fill(key, sizeof(key), 2);
+    ASSERT_EQ(OPRT_OK, tal_aes_key_create(TAL_AES_CBC, SYMMETRY_ENCRYPT, key, 128, &enc_key));
+    ASSERT_EQ(OPRT_OK, tal_aes_key_create(TAL_AES_CBC, SYMMETRY_DECRYPT, key, 128, &dec_key));
+
+    // a padding byte that disagrees with the last one
+    memset(buf, 3, sizeof(buf));
+    buf[13] = 2;
+    memset(chain, 0, sizeof(chain));
+    ASSERT_EQ(OPRT_OK, tal_aes_key_crypt(enc_key, chain, buf, sizeof(buf), buf));
+    memset(chain, 0, sizeof(chain));
+    EXPECT_EQ(OPRT_COM_ERROR, tal_aes_key_decrypt_pkcs7(dec_key, chain, buf, sizeof(buf), out, &slen));
+
+    tal_aes_key_free(enc_key);
+    tal_aes_key_free(dec_key);
+}
@@ -39,6 +39,33 @@ typedef struct {
 } WORK_ITEM_T;
 typedef BOOL_T (*WORKQUEUE_TRAVERSE_CB)(WORK_ITEM_T *item, void *ctx);
 
+/**
+ * @brief priority of a work in a multi-worker workqueue
+ *
+ */
+typedef enum {
+    WORKQUEUE_PRIO_HIGH,
+    WORKQUEUE_PRIO_NORMAL,
+    WORKQUEUE_PRIO_LOW,
+    WORKQUEUE_PRIO_NUM
+} WORKQUEUE_PRIO_E;
+
+/**
+ * @brief workqueue statistics, latency is the time from ready to run
+ *
+ */
+typedef struct {
+    uint16_t depth;       // works waiting to run
+    uint16_t depth_max;   // highest depth seen
+    uint8_t worker_num;   // worker threads
+    uint8_t busy;         // workers running a work
+    uint32_t executed;    // works run
+    uint32_t latency_avg; // ms
+    uint32_t latency_p99; // ms, upper bound of the 99th percentile
+    uint32_t latency_max; // ms
+    uint32_t run_max;     // ms, longest work
+} WORKQUEUE_STATS_T;
+
 /**
  * @brief create and initialize a workqueue which runs in thread context
  *
@@ -52,6 +79,28 @@ typedef BOOL_T (*WORKQUEUE_TRAVERSE_CB)(WORK_ITEM_T *item, void *ctx);
  */
 OPERATE_RET tal_workqueue_create(const uint16_t queue_len, THREAD_CFG_T *thread_cfg, WORKQUEUE_HANDLE *handle);
 
+/**
+ * @brief create a workqueue served by several worker threads
+ *
+ * Works are run by priority, in order within a priority, and a slow work only
+ * holds its own worker. Delayed works of this workqueue are kept in a heap
+ * served by the workers instead of a software timer each. All the other
+ * tal_workqueue APIs apply, tal_workqueue_schedule uses WORKQUEUE_PRIO_NORMAL
+ * and tal_workqueue_schedule_instant puts the work first in
+ * WORKQUEUE_PRIO_HIGH.
+ *
+ * @param[in] queue_len the maximum number of works waiting to run
+ * @param[in] worker_num the number of worker threads
+ * @param[in] thread_cfg thread param of the workers, the name gets the worker
+ * index appended
+ * @param[out] handle the workqueue handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_create_multi(const uint16_t queue_len, const uint8_t worker_num, THREAD_CFG_T *thread_cfg,
+                                       WORKQUEUE_HANDLE *handle);
+
 /**
  * @brief put work task in workqueue
  *
@@ -64,6 +113,19 @@ OPERATE_RET tal_workqueue_create(const uint16_t queue_len, THREAD_CFG_T *thread_
  */
 OPERATE_RET tal_workqueue_schedule(WORKQUEUE_HANDLE handle, WORKQUEUE_CB cb, void *data);
 
+/**
+ * @brief put work task in workqueue with a priority
+ *
+ * @param[in] handle the workqueue handle
+ * @param[in] prio see @WORKQUEUE_PRIO_E, ignored by single thread workqueues
+ * @param[in] cb the work callback
+ * @param[in] data the work data
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_schedule_prio(WORKQUEUE_HANDLE handle, WORKQUEUE_PRIO_E prio, WORKQUEUE_CB cb, void *data);
+
 /**
  * @brief put work task in workqueue, instant will be dequeued first
  *
@@ -88,6 +150,32 @@ OPERATE_RET tal_workqueue_schedule_instant(WORKQUEUE_HANDLE handle, WORKQUEUE_CB
  */
 OPERATE_RET tal_workqueue_cancel(WORKQUEUE_HANDLE handle, WORKQUEUE_CB cb, void *data);
 
+/**
+ * @brief wait until the matching works queued or running are done
+ *
+ * @param[in] handle the workqueue handle
+ * @param[in] cb the work callback, NULL matches any
+ * @param[in] data the work data, NULL matches any
+ *
+ * @note a work must not flush itself, the running work of the calling worker
+ * is skipped
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_flush(WORKQUEUE_HANDLE handle, WORKQUEUE_CB cb, void *data);
+
+/**
+ * @brief get the workqueue statistics
+ *
+ * @param[in] handle the workqueue handle
+ * @param[out] stats the statistics, only depth for single thread workqueues
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_get_stats(WORKQUEUE_HANDLE handle, WORKQUEUE_STATS_T *stats);
+
 /**
  * @brief traverse the queue with specific callback
  *
@@ -45,6 +45,10 @@
 #define STACK_SIZE_WORK_QUEUE (5 * 1024)
 #endif
 
+#ifndef WORK_QUEUE_WORKER_NUM
+#define WORK_QUEUE_WORKER_NUM 1
+#endif
+
 #ifndef STACK_SIZE_MSG_QUEUE
 #define STACK_SIZE_MSG_QUEUE (4 * 1024)
 #endif
@@ -73,7 +77,14 @@ OPERATE_RET tal_workq_init(void)
     thread_cfg.stackDepth += 1024;
 #endif
     thread_cfg.thrdname = "wq_system";
+#if WORK_QUEUE_WORKER_NUM > 1
+    // works may run concurrently, a slow one no longer holds up the others
+    TUYA_CALL_ERR_GOTO(
+        tal_workqueue_create_multi(MAX_NODE_NUM_WORK_QUEUE, WORK_QUEUE_WORKER_NUM, &thread_cfg, &wq_system),
+        ERR_EXIT);
+#else
     TUYA_CALL_ERR_GOTO(tal_workqueue_create(MAX_NODE_NUM_WORK_QUEUE, &thread_cfg, &wq_system), ERR_EXIT);
+#endif
 
     thread_cfg.priority = THREAD_PRIO_1;
     thread_cfg.stackDepth = STACK_SIZE_MSG_QUEUE;
@@ -189,7 +200,15 @@ static BOOL_T _dump_cb(WORK_ITEM_T *item, void *ctx)
 
 void tal_workq_dump(WORKQ_SERVICE_E service)
 {
+    WORKQUEUE_STATS_T stats;
+
     PR_NOTICE("---------workq-%d dump begin---------", service);
+    if (OPRT_OK == tal_workqueue_get_stats(tal_workq_get_handle(service), &stats)) {
+        PR_NOTICE("depth:%d max:%d busy:%d/%d executed:%d", stats.depth, stats.depth_max, stats.busy,
+                  stats.worker_num, stats.executed);
+        PR_NOTICE("latency avg:%d p99:%d max:%d ms, longest work:%d ms", stats.latency_avg, stats.latency_p99,
+                  stats.latency_max, stats.run_max);
+    }
     tal_workqueue_traverse(tal_workq_get_handle(service), _dump_cb, NULL);
     tal_thread_diagnose(tal_workqueue_get_thread(tal_workq_get_handle(service)));
     PR_NOTICE("---------workq-%d dump end---------", service);
@@ -31,6 +31,8 @@
  *
  */
 
+#include <stdio.h>
+
 #include "tuya_queue.h"
 #include "tal_log.h"
 #include "tal_memory.h"
@@ -39,19 +41,104 @@
 #include "tal_semaphore.h"
 #include "tal_workqueue.h"
 #include "tal_sw_timer.h"
+#include "tal_mutex.h"
+#include "tuya_list.h"
+
+#define WORKQUEUE_MODE_SINGLE 0
+#define WORKQUEUE_MODE_MULTI  1
+
+/* latency histogram, bucket n holds [2^(n-1), 2^n) ms */
+#define WORKQUEUE_LATENCY_BUCKETS 17
+/* retry delay of a delayed work that found the queue full */
+#define WORKQUEUE_FULL_RETRY_MS 10
+
+/* common head of both workqueue types */
+typedef struct {
+    uint8_t mode;
+} TAL_WORKQUEUE_HEAD_T;
 
 typedef struct {
+    uint8_t mode;
     TUYA_QUEUE_HANDLE queue;
     THREAD_HANDLE thread;
     SEM_HANDLE sem;
+    MUTEX_HANDLE mutex; // orders the seq of the works with the queue
+    uint32_t seq;
     WORKQUEUE_CB last_cb; // used to debug which cb is blocked
+    void *last_data;
+    uint32_t last_seq;
 } TAL_WORKQUEUE_T;
 
+/* item of the single thread queue, the seq tells tal_workqueue_flush which
+ * works were queued before it started */
+typedef struct {
+    WORK_ITEM_T item;
+    uint32_t seq;
+} WORK_SEQ_ITEM_T;
+
+typedef struct {
+    TIMER_ID timer;
+    WORKQUEUE_CB cb;
+    void *data;
+    WORKQUEUE_HANDLE handle;
+    /* multi-worker workqueue only */
+    SYS_TIME_T deadline;
+    TIME_MS interval;
+    LOOP_TYPE type;
+    int heap_idx; // -1 when not started
+} DELAYED_WORK_T;
+
+typedef struct {
+    LIST_HEAD node;
+    WORK_ITEM_T item;
+    uint32_t seq;
+    SYS_TIME_T ready;
+} WORK_NODE_T;
+
+struct tal_workqueue_multi;
+
+typedef struct {
+    struct tal_workqueue_multi *wq;
+    THREAD_HANDLE thread;
+    WORK_ITEM_T running; // cb is NULL while idle
+    uint32_t running_seq;
+    char name[16];
+} WORKER_T;
+
+typedef struct tal_workqueue_multi {
+    uint8_t mode;
+    BOOL_T exit;
+    MUTEX_HANDLE mutex;
+    SEM_HANDLE sem;
+    uint8_t worker_num;
+    WORKER_T *workers;
+
+    WORK_NODE_T *nodes;
+    LIST_HEAD free_list;
+    LIST_HEAD ready[WORKQUEUE_PRIO_NUM];
+    uint32_t seq;
+
+    DELAYED_WORK_T **heap; // min-heap on deadline
+    uint16_t heap_num;
+    uint16_t heap_size;
+
+    uint16_t depth;
+    uint16_t depth_max;
+    uint8_t busy;
+    uint32_t executed;
+    uint64_t latency_sum;
+    uint32_t latency_max;
+    uint32_t run_max;
+    uint32_t latency_hist[WORKQUEUE_LATENCY_BUCKETS];
+} TAL_WORKQUEUE_MULTI_T;
+
+#define __is_multi(handle) (WORKQUEUE_MODE_MULTI == ((TAL_WORKQUEUE_HEAD_T *)(handle))->mode)
+
 static void __work_thread_cb(void *data)
 {
     OPERATE_RET op_ret = OPRT_OK;
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)data;
-    WORK_ITEM_T work_item = {0};
+    WORK_SEQ_ITEM_T work = {0};
 
     while (THREAD_STATE_RUNNING == tal_thread_get_state(workqueue->thread)) {
         op_ret = tal_semaphore_wait(workqueue->sem, SEM_WAIT_FOREVER);
@@ -60,16 +147,25 @@ static void __work_thread_cb(void *data)
             continue;
         }
 
-        op_ret = tuya_queue_output(workqueue->queue, &work_item);
+        // a flush sees the work either queued or running
+        tal_mutex_lock(workqueue->mutex);
+        op_ret = tuya_queue_output(workqueue->queue, &work);
+        if (OPRT_OK == op_ret) {
+            workqueue->last_cb = work.item.cb;
+            workqueue->last_data = work.item.data;
+            workqueue->last_seq = work.seq;
+        }
+        tal_mutex_unlock(workqueue->mutex);
         if (OPRT_OK != op_ret) {
             tal_system_sleep(10);
             continue;
         }
 
-        if (work_item.cb) {
-            workqueue->last_cb = work_item.cb;
-            work_item.cb(work_item.data);
+        if (work.item.cb) {
+            work.item.cb(work.item.data);
+            tal_mutex_lock(workqueue->mutex);
             workqueue->last_cb = NULL;
+            tal_mutex_unlock(workqueue->mutex);
         }
     }
 }
@@ -97,6 +193,295 @@ static BOOL_T __work_cancel_traverse(void *item, void *ctx)
     return TRUE;
 }
 
+/* -------------------------------------------------------------------------- */
+/*                        multi-worker workqueue                              */
+/* -------------------------------------------------------------------------- */
+static void __heap_swap(TAL_WORKQUEUE_MULTI_T *wq, int a, int b)
+{
+    DELAYED_WORK_T *tmp = wq->heap[a];
+
+    wq->heap[a] = wq->heap[b];
+    wq->heap[b] = tmp;
+    wq->heap[a]->heap_idx = a;
+    wq->heap[b]->heap_idx = b;
+}
+
+static void __heap_sift(TAL_WORKQUEUE_MULTI_T *wq, int i)
+{
+    int child;
+
+    while (i > 0 && wq->heap[i]->deadline < wq->heap[(i - 1) / 2]->deadline) {
+        __heap_swap(wq, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+
+    for (;;) {
+        child = 2 * i + 1;
+        if (child >= wq->heap_num) {
+            break;
+        }
+        if (child + 1 < wq->heap_num && wq->heap[child + 1]->deadline < wq->heap[child]->deadline) {
+            child++;
+        }
+        if (wq->heap[i]->deadline <= wq->heap[child]->deadline) {
+            break;
+        }
+        __heap_swap(wq, i, child);
+        i = child;
+    }
+}
+
+static OPERATE_RET __heap_insert(TAL_WORKQUEUE_MULTI_T *wq, DELAYED_WORK_T *dw)
+{
+    DELAYED_WORK_T **heap = NULL;
+
+    if (wq->heap_num == wq->heap_size) {
+        heap = tal_malloc((wq->heap_size + 8) * sizeof(DELAYED_WORK_T *));
+        if (NULL == heap) {
+            return OPRT_MALLOC_FAILED;
+        }
+        if (wq->heap) {
+            memcpy(heap, wq->heap, wq->heap_num * sizeof(DELAYED_WORK_T *));
+            tal_free(wq->heap);
+        }
+        wq->heap = heap;
+        wq->heap_size += 8;
+    }
+
+    dw->heap_idx = wq->heap_num++;
+    wq->heap[dw->heap_idx] = dw;
+    __heap_sift(wq, dw->heap_idx);
+
+    return OPRT_OK;
+}
+
+static void __heap_remove(TAL_WORKQUEUE_MULTI_T *wq, DELAYED_WORK_T *dw)
+{
+    int i = dw->heap_idx;
+
+    if (i < 0) {
+        return;
+    }
+
+    dw->heap_idx = -1;
+    wq->heap_num--;
+    if (i != wq->heap_num) {
+        wq->heap[i] = wq->heap[wq->heap_num];
+        wq->heap[i]->heap_idx = i;
+        __heap_sift(wq, i);
+    }
+}
+
+static OPERATE_RET __multi_push(TAL_WORKQUEUE_MULTI_T *wq, WORKQUEUE_PRIO_E prio, BOOL_T first, WORKQUEUE_CB cb,
+                                void *data)
+{
+    WORK_NODE_T *node = NULL;
+
+    if (tuya_list_empty(&wq->free_list)) {
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+
+    node = tuya_list_entry(wq->free_list.next, WORK_NODE_T, node);
+    tuya_list_del(&node->node);
+    node->item.cb = cb;
+    node->item.data = data;
+    node->seq = ++wq->seq;
+    node->ready = tal_system_get_millisecond();
+    if (first) {
+        tuya_list_add(&node->node, &wq->ready[prio]);
+    } else {
+        tuya_list_add_tail(&node->node, &wq->ready[prio]);
+    }
+
+    if (++wq->depth > wq->depth_max) {
+        wq->depth_max = wq->depth;
+    }
+    tal_semaphore_post(wq->sem);
+
+    return OPRT_OK;
+}
+
+/* moves the due delayed works to the ready lists, returns the time to the next one */
+static uint32_t __multi_delayed_expire(TAL_WORKQUEUE_MULTI_T *wq, SYS_TIME_T now)
+{
+    DELAYED_WORK_T *dw = NULL;
+
+    while (wq->heap_num && wq->heap[0]->deadline <= now) {
+        dw = wq->heap[0];
+        if (OPRT_OK != __multi_push(wq, WORKQUEUE_PRIO_NORMAL, FALSE, dw->cb, dw->data)) {
+            dw->deadline = now + WORKQUEUE_FULL_RETRY_MS;
+            __heap_sift(wq, 0);
+            break;
+        }
+
+        if (LOOP_CYCLE == dw->type && dw->interval) {
+            // keep the period, but do not catch up on missed runs
+            dw->deadline += dw->interval;
+            if (dw->deadline <= now) {
+                dw->deadline = now + dw->interval;
+            }
+            __heap_sift(wq, 0);
+        } else {
+            __heap_remove(wq, dw);
+        }
+    }
+
+    return wq->heap_num ? (uint32_t)(wq->heap[0]->deadline - now) : SEM_WAIT_FOREVER;
+}
+
+static WORK_NODE_T *__multi_pop(TAL_WORKQUEUE_MULTI_T *wq)
+{
+    int prio;
+    WORK_NODE_T *node = NULL;
+
+    for (prio = 0; prio < WORKQUEUE_PRIO_NUM; prio++) {
+        if (!tuya_list_empty(&wq->ready[prio])) {
+            node = tuya_list_entry(wq->ready[prio].next, WORK_NODE_T, node);
+            tuya_list_del(&node->node);
+            tuya_list_add_tail(&node->node, &wq->free_list);
+            wq->depth--;
+            return node;
+        }
+    }
+
+    return NULL;
+}
+
+static void __multi_stats_update(TAL_WORKQUEUE_MULTI_T *wq, uint32_t latency, uint32_t run)
+{
+    uint32_t bucket = 0, value = latency;
+
+    while (value && bucket < WORKQUEUE_LATENCY_BUCKETS - 1) {
+        bucket++;
+        value >>= 1;
+    }
+
+    wq->executed++;
+    wq->latency_sum += latency;
+    wq->latency_hist[bucket]++;
+    if (latency > wq->latency_max) {
+        wq->latency_max = latency;
+    }
+    if (run > wq->run_max) {
+        wq->run_max = run;
+    }
+}
+
+static void __multi_worker_cb(void *data)
+{
+    WORKER_T *worker = (WORKER_T *)data;
+    TAL_WORKQUEUE_MULTI_T *wq = worker->wq;
+    WORK_NODE_T *node = NULL;
+    SYS_TIME_T ready = 0, start = 0;
+    uint32_t wait = 0;
+
+    while (THREAD_STATE_RUNNING == tal_thread_get_state(worker->thread) && !wq->exit) {
+        tal_mutex_lock(wq->mutex);
+        start = tal_system_get_millisecond();
+        wait = __multi_delayed_expire(wq, start);
+        node = __multi_pop(wq);
+        if (node) {
+            // the node goes back to the pool, the worker keeps a copy of the work
+            worker->running = node->item;
+            worker->running_seq = node->seq;
+            ready = node->ready;
+            wq->busy++;
+        }
+        tal_mutex_unlock(wq->mutex);
+
+        if (NULL == node) {
+            tal_semaphore_wait(wq->sem, wait);
+            continue;
+        }
+
+        worker->running.cb(worker->running.data);
+
+        tal_mutex_lock(wq->mutex);
+        __multi_stats_update(wq, (uint32_t)(start - ready), (uint32_t)(tal_system_get_millisecond() - start));
+        worker->running.cb = NULL;
+        worker->running.data = NULL;
+        wq->busy--;
+        tal_mutex_unlock(wq->mutex);
+    }
+}
+
+static BOOL_T __work_match(WORK_ITEM_T *item, WORKQUEUE_CB cb, void *data)
+{
+    return (NULL == cb || cb == item->cb) && (NULL == data || data == item->data);
+}
+
+/* TRUE while a matching work queued up to seq is not done */
+static BOOL_T __multi_flush_pending(TAL_WORKQUEUE_MULTI_T *wq, WORKQUEUE_CB cb, void *data, uint32_t seq)
+{
+    int i;
+    BOOL_T is_self = FALSE;
+    struct tuya_list_head *p = NULL;
+    WORK_NODE_T *node = NULL;
+
+    for (i = 0; i < WORKQUEUE_PRIO_NUM; i++) {
+        tuya_list_for_each(p, &wq->ready[i])
+        {
+            node = tuya_list_entry(p, WORK_NODE_T, node);
+            if ((int32_t)(node->seq - seq) <= 0 && __work_match(&node->item, cb, data)) {
+                return TRUE;
+            }
+        }
+    }
+
+    for (i = 0; i < wq->worker_num; i++) {
+        if (NULL == wq->workers[i].running.cb || (int32_t)(wq->workers[i].running_seq - seq) > 0 ||
+            !__work_match(&wq->workers[i].running, cb, data)) {
+            continue;
+        }
+        tal_thread_is_self(wq->workers[i].thread, &is_self);
+        if (!is_self) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static OPERATE_RET __multi_release(TAL_WORKQUEUE_MULTI_T *wq)
+{
+    int i;
+    uint32_t count = 1;
+
+    wq->exit = TRUE;
+    for (i = 0; i < wq->worker_num; i++) {
+        if (wq->workers[i].thread) {
+            tal_thread_delete(wq->workers[i].thread);
+        }
+    }
+    for (i = 0; i < wq->worker_num; i++) {
+        tal_semaphore_post(wq->sem);
+    }
+
+    for (i = 0; i < wq->worker_num; i++) {
+        while (wq->workers[i].thread && THREAD_STATE_DELETE != tal_thread_get_state(wq->workers[i].thread)) {
+            tal_system_sleep(10);
+            if ((count++) % 500 == 0) {
+                PR_NOTICE("%p still running", wq->workers[i].thread);
+            }
+        }
+    }
+
+    // started delayed works are left stopped
+    for (i = 0; i < wq->heap_num; i++) {
+        wq->heap[i]->heap_idx = -1;
+    }
+    if (wq->heap) {
+        tal_free(wq->heap);
+    }
+    tal_semaphore_release(wq->sem);
+    tal_mutex_release(wq->mutex);
+    tal_free(wq->nodes);
+    tal_free(wq->workers);
+    tal_free(wq);
+
+    return OPRT_OK;
+}
+
 /**
  * @brief create and initialize a workqueue which runs in thread context
  *
@@ -122,7 +507,7 @@ OPERATE_RET tal_workqueue_create(const uint16_t queue_len, THREAD_CFG_T *thread_
         return OPRT_MALLOC_FAILED;
     }
 
-    op_ret = tuya_queue_create(queue_len, sizeof(WORK_ITEM_T), &workqueue->queue);
+    op_ret = tuya_queue_create(queue_len, sizeof(WORK_SEQ_ITEM_T), &workqueue->queue);
     if (OPRT_OK != op_ret) {
         tal_free(workqueue);
         return op_ret;
@@ -135,8 +520,17 @@ OPERATE_RET tal_workqueue_create(const uint16_t queue_len, THREAD_CFG_T *thread_
         return op_ret;
     }
 
+    op_ret = tal_mutex_create_init(&workqueue->mutex);
+    if (OPRT_OK != op_ret) {
+        tal_semaphore_release(workqueue->sem);
+        tuya_queue_release(workqueue->queue);
+        tal_free(workqueue);
+        return op_ret;
+    }
+
     op_ret = tal_thread_create_and_start(&workqueue->thread, NULL, NULL, __work_thread_cb, workqueue, thread_cfg);
     if (OPRT_OK != op_ret) {
+        tal_mutex_release(workqueue->mutex);
         tal_semaphore_release(workqueue->sem);
         tuya_queue_release(workqueue->queue);
         tal_free(workqueue);
@@ -147,6 +541,90 @@ OPERATE_RET tal_workqueue_create(const uint16_t queue_len, THREAD_CFG_T *thread_
     return op_ret;
 }
 
+/**
+ * @brief create a workqueue served by several worker threads
+ *
+ * @param[in] queue_len the maximum number of works waiting to run
+ * @param[in] worker_num the number of worker threads
+ * @param[in] thread_cfg thread param of the workers, the name gets the worker
+ * index appended
+ * @param[out] handle the workqueue handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_create_multi(const uint16_t queue_len, const uint8_t worker_num, THREAD_CFG_T *thread_cfg,
+                                       WORKQUEUE_HANDLE *handle)
+{
+    OPERATE_RET rt = OPRT_OK;
+    TAL_WORKQUEUE_MULTI_T *wq = NULL;
+    THREAD_CFG_T cfg;
+    int i;
+
+    if ((0 == queue_len) || (0 == worker_num) || (NULL == thread_cfg) || (NULL == handle)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    wq = (TAL_WORKQUEUE_MULTI_T *)tal_calloc(1, sizeof(TAL_WORKQUEUE_MULTI_T));
+    if (NULL == wq) {
+        return OPRT_MALLOC_FAILED;
+    }
+    wq->mode = WORKQUEUE_MODE_MULTI;
+    wq->worker_num = worker_num;
+    INIT_LIST_HEAD(&wq->free_list);
+    for (i = 0; i < WORKQUEUE_PRIO_NUM; i++) {
+        INIT_LIST_HEAD(&wq->ready[i]);
+    }
+
+    wq->nodes = (WORK_NODE_T *)tal_calloc(queue_len, sizeof(WORK_NODE_T));
+    wq->workers = (WORKER_T *)tal_calloc(worker_num, sizeof(WORKER_T));
+    if (NULL == wq->nodes || NULL == wq->workers) {
+        rt = OPRT_MALLOC_FAILED;
+        goto __EXIT;
+    }
+    for (i = 0; i < queue_len; i++) {
+        tuya_list_add_tail(&wq->nodes[i].node, &wq->free_list);
+    }
+
+    TUYA_CALL_ERR_GOTO(tal_mutex_create_init(&wq->mutex), __EXIT);
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&wq->sem, 0, queue_len + worker_num), __EXIT);
+
+    cfg = *thread_cfg;
+    for (i = 0; i < worker_num; i++) {
+        wq->workers[i].wq = wq;
+        snprintf(wq->workers[i].name, sizeof(wq->workers[i].name), "%.12s%d",
+                 thread_cfg->thrdname ? thread_cfg->thrdname : "wq", i);
+        cfg.thrdname = wq->workers[i].name;
+        TUYA_CALL_ERR_GOTO(tal_thread_create_and_start(&wq->workers[i].thread, NULL, NULL, __multi_worker_cb,
+                                                       &wq->workers[i], &cfg),
+                           __EXIT);
+    }
+
+    *handle = wq;
+    return OPRT_OK;
+
+__EXIT:
+    if (wq->nodes && wq->workers && wq->mutex && wq->sem) {
+        // workers already started are stopped by the release
+        __multi_release(wq);
+        return rt;
+    }
+    if (wq->sem) {
+        tal_semaphore_release(wq->sem);
+    }
+    if (wq->mutex) {
+        tal_mutex_release(wq->mutex);
+    }
+    if (wq->nodes) {
+        tal_free(wq->nodes);
+    }
+    if (wq->workers) {
+        tal_free(wq->workers);
+    }
+    tal_free(wq);
+    return rt;
+}
+
 /**
  * @brief put work task in workqueue
  *
@@ -165,10 +643,17 @@ OPERATE_RET tal_workqueue_schedule(WORKQUEUE_HANDLE handle, WORKQUEUE_CB cb, voi
         return OPRT_INVALID_PARM;
     }
 
+    if (__is_multi(handle)) {
+        return tal_workqueue_schedule_prio(handle, WORKQUEUE_PRIO_NORMAL, cb, data);
+    }
+
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
-    WORK_ITEM_T work_item = {.cb = cb, .data = data};
+    WORK_SEQ_ITEM_T work = {.item = {.cb = cb, .data = data}};
 
-    op_ret = tuya_queue_input(workqueue->queue, &work_item);
+    tal_mutex_lock(workqueue->mutex);
+    work.seq = ++workqueue->seq;
+    op_ret = tuya_queue_input(workqueue->queue, &work);
+    tal_mutex_unlock(workqueue->mutex);
     if (OPRT_OK == op_ret) {
         op_ret = tal_semaphore_post(workqueue->sem);
     }
@@ -176,6 +661,38 @@ OPERATE_RET tal_workqueue_schedule(WORKQUEUE_HANDLE handle, WORKQUEUE_CB cb, voi
     return op_ret;
 }
 
+/**
+ * @brief put work task in workqueue with a priority
+ *
+ * @param[in] handle the workqueue handle
+ * @param[in] prio see @WORKQUEUE_PRIO_E, ignored by single thread workqueues
+ * @param[in] cb the work callback
+ * @param[in] data the work data
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_schedule_prio(WORKQUEUE_HANDLE handle, WORKQUEUE_PRIO_E prio, WORKQUEUE_CB cb, void *data)
+{
+    OPERATE_RET op_ret = OPRT_OK;
+
+    if ((NULL == handle) || (NULL == cb) || (prio >= WORKQUEUE_PRIO_NUM)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (!__is_multi(handle)) {
+        return tal_workqueue_schedule(handle, cb, data);
+    }
+
+    TAL_WORKQUEUE_MULTI_T *wq = (TAL_WORKQUEUE_MULTI_T *)handle;
+
+    tal_mutex_lock(wq->mutex);
+    op_ret = __multi_push(wq, prio, FALSE, cb, data);
+    tal_mutex_unlock(wq->mutex);
+
+    return op_ret;
+}
+
 /**
  * @brief put work task in workqueue, instant will be dequeued first
  *
@@ -194,10 +711,21 @@ OPERATE_RET tal_workqueue_schedule_instant(WORKQUEUE_HANDLE handle, WORKQUEUE_CB
         return OPRT_INVALID_PARM;
     }
 
+    if (__is_multi(handle)) {
+        TAL_WORKQUEUE_MULTI_T *wq = (TAL_WORKQUEUE_MULTI_T *)handle;
+        tal_mutex_lock(wq->mutex);
+        op_ret = __multi_push(wq, WORKQUEUE_PRIO_HIGH, TRUE, cb, data);
+        tal_mutex_unlock(wq->mutex);
+        return op_ret;
+    }
+
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
-    WORK_ITEM_T work_item = {.cb = cb, .data = data};
+    WORK_SEQ_ITEM_T work = {.item = {.cb = cb, .data = data}};
 
-    op_ret = tuya_queue_input_instant(workqueue->queue, &work_item);
+    tal_mutex_lock(workqueue->mutex);
+    work.seq = ++workqueue->seq;
+    op_ret = tuya_queue_input_instant(workqueue->queue, &work);
+    tal_mutex_unlock(workqueue->mutex);
     if (OPRT_OK == op_ret) {
         op_ret = tal_semaphore_post(workqueue->sem);
     }
@@ -221,12 +749,186 @@ OPERATE_RET tal_workqueue_cancel(WORKQUEUE_HANDLE handle, WORKQUEUE_CB cb, void
         return OPRT_INVALID_PARM;
     }
 
+    if (__is_multi(handle)) {
+        // same matching as the single thread queue: cb or data
+        TAL_WORKQUEUE_MULTI_T *wq = (TAL_WORKQUEUE_MULTI_T *)handle;
+        struct tuya_list_head *p = NULL, *n = NULL;
+        WORK_NODE_T *node = NULL;
+        int i;
+
+        tal_mutex_lock(wq->mutex);
+        for (i = 0; i < WORKQUEUE_PRIO_NUM; i++) {
+            tuya_list_for_each_safe(p, n, &wq->ready[i])
+            {
+                node = tuya_list_entry(p, WORK_NODE_T, node);
+                if ((cb && cb == node->item.cb) || (data && data == node->item.data)) {
+                    tuya_list_del(&node->node);
+                    tuya_list_add_tail(&node->node, &wq->free_list);
+                    wq->depth--;
+                }
+            }
+        }
+        tal_mutex_unlock(wq->mutex);
+        return OPRT_OK;
+    }
+
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
     WORK_ITEM_T work_item = {.cb = cb, .data = data};
 
     return tuya_queue_traverse(workqueue->queue, __work_cancel_traverse, &work_item);
 }
 
+typedef struct {
+    WORK_ITEM_T match;
+    uint32_t seq;
+    BOOL_T found;
+} WORK_FLUSH_CTX_T;
+
+static BOOL_T __work_flush_traverse(void *item, void *ctx)
+{
+    WORK_SEQ_ITEM_T *src = (WORK_SEQ_ITEM_T *)item;
+    WORK_FLUSH_CTX_T *flush = (WORK_FLUSH_CTX_T *)ctx;
+
+    // cancelled works have no cb
+    if (src->item.cb && (int32_t)(src->seq - flush->seq) <= 0 &&
+        __work_match(&src->item, flush->match.cb, flush->match.data)) {
+        flush->found = TRUE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief wait until the matching works queued or running are done
+ *
+ * @param[in] handle the workqueue handle
+ * @param[in] cb the work callback, NULL matches any
+ * @param[in] data the work data, NULL matches any
+ *
+ * @note a work must not flush itself, the running work of the calling worker
+ * is skipped
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_flush(WORKQUEUE_HANDLE handle, WORKQUEUE_CB cb, void *data)
+{
+    BOOL_T pending = TRUE, is_self = FALSE;
+    WORK_FLUSH_CTX_T ctx = {.match = {.cb = cb, .data = data}};
+    WORK_ITEM_T running;
+
+    if (NULL == handle) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (__is_multi(handle)) {
+        TAL_WORKQUEUE_MULTI_T *wq = (TAL_WORKQUEUE_MULTI_T *)handle;
+        uint32_t seq;
+
+        tal_mutex_lock(wq->mutex);
+        seq = wq->seq;
+        tal_mutex_unlock(wq->mutex);
+
+        // works queued after the flush started are not waited for
+        while (pending) {
+            tal_mutex_lock(wq->mutex);
+            pending = __multi_flush_pending(wq, cb, data, seq);
+            tal_mutex_unlock(wq->mutex);
+            if (pending) {
+                tal_system_sleep(10);
+            }
+        }
+        return OPRT_OK;
+    }
+
+    TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
+
+    tal_thread_is_self(workqueue->thread, &is_self);
+    if (is_self) {
+        return OPRT_COM_ERROR;
+    }
+
+    tal_mutex_lock(workqueue->mutex);
+    ctx.seq = workqueue->seq;
+    tal_mutex_unlock(workqueue->mutex);
+
+    // works queued after the flush started are not waited for
+    while (pending) {
+        ctx.found = FALSE;
+        tal_mutex_lock(workqueue->mutex);
+        tuya_queue_traverse(workqueue->queue, __work_flush_traverse, &ctx);
+        running.cb = workqueue->last_cb;
+        running.data = workqueue->last_data;
+        if (running.cb && (int32_t)(workqueue->last_seq - ctx.seq) <= 0 && __work_match(&running, cb, data)) {
+            ctx.found = TRUE;
+        }
+        tal_mutex_unlock(workqueue->mutex);
+        pending = ctx.found;
+        if (pending) {
+            tal_system_sleep(10);
+        }
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief get the workqueue statistics
+ *
+ * @param[in] handle the workqueue handle
+ * @param[out] stats the statistics, only depth for single thread workqueues
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_get_stats(WORKQUEUE_HANDLE handle, WORKQUEUE_STATS_T *stats)
+{
+    uint32_t i, count = 0, target;
+
+    if (NULL == handle || NULL == stats) {
+        return OPRT_INVALID_PARM;
+    }
+
+    memset(stats, 0, sizeof(WORKQUEUE_STATS_T));
+
+    if (!__is_multi(handle)) {
+        TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
+        stats->depth = tuya_queue_get_used_num(workqueue->queue);
+        stats->worker_num = 1;
+        stats->busy = workqueue->last_cb ? 1 : 0;
+        return OPRT_OK;
+    }
+
+    TAL_WORKQUEUE_MULTI_T *wq = (TAL_WORKQUEUE_MULTI_T *)handle;
+
+    tal_mutex_lock(wq->mutex);
+    stats->depth = wq->depth;
+    stats->depth_max = wq->depth_max;
+    stats->worker_num = wq->worker_num;
+    stats->busy = wq->busy;
+    stats->executed = wq->executed;
+    stats->latency_max = wq->latency_max;
+    stats->run_max = wq->run_max;
+    if (wq->executed) {
+        stats->latency_avg = (uint32_t)(wq->latency_sum / wq->executed);
+        target = wq->executed - wq->executed / 100;
+        for (i = 0; i < WORKQUEUE_LATENCY_BUCKETS; i++) {
+            count += wq->latency_hist[i];
+            if (count >= target) {
+                stats->latency_p99 = (1U << i) - 1;
+                break;
+            }
+        }
+        if (stats->latency_p99 > stats->latency_max) {
+            stats->latency_p99 = stats->latency_max;
+        }
+    }
+    tal_mutex_unlock(wq->mutex);
+
+    return OPRT_OK;
+}
+
 /**
  * @brief traverse the queue with specific callback
  *
@@ -243,6 +945,25 @@ OPERATE_RET tal_workqueue_traverse(WORKQUEUE_HANDLE handle, WORKQUEUE_TRAVERSE_C
         return OPRT_INVALID_PARM;
     }
 
+    if (__is_multi(handle)) {
+        TAL_WORKQUEUE_MULTI_T *wq = (TAL_WORKQUEUE_MULTI_T *)handle;
+        struct tuya_list_head *p = NULL;
+        BOOL_T next = TRUE;
+        int i;
+
+        tal_mutex_lock(wq->mutex);
+        for (i = 0; i < WORKQUEUE_PRIO_NUM && next; i++) {
+            tuya_list_for_each(p, &wq->ready[i])
+            {
+                if (!(next = cb(&tuya_list_entry(p, WORK_NODE_T, node)->item, ctx))) {
+                    break;
+                }
+            }
+        }
+        tal_mutex_unlock(wq->mutex);
+        return OPRT_OK;
+    }
+
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
     return tuya_queue_traverse(workqueue->queue, (TRAVERSE_CB)cb, ctx);
 }
@@ -260,6 +981,10 @@ uint16_t tal_workqueue_get_num(WORKQUEUE_HANDLE handle)
         return OPRT_INVALID_PARM;
     }
 
+    if (__is_multi(handle)) {
+        return ((TAL_WORKQUEUE_MULTI_T *)handle)->depth;
+    }
+
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
 
     if (workqueue->last_cb) {
@@ -283,6 +1008,10 @@ OPERATE_RET tal_workqueue_release(WORKQUEUE_HANDLE handle)
         return OPRT_INVALID_PARM;
     }
 
+    if (__is_multi(handle)) {
+        return __multi_release((TAL_WORKQUEUE_MULTI_T *)handle);
+    }
+
     OPERATE_RET op_ret = OPRT_OK;
     uint32_t count = 1;
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
@@ -303,6 +1032,7 @@ OPERATE_RET tal_workqueue_release(WORKQUEUE_HANDLE handle)
 
     tuya_queue_release(workqueue->queue);
     tal_semaphore_release(workqueue->sem);
+    tal_mutex_release(workqueue->mutex);
     tal_free(workqueue);
 
     return OPRT_OK;
@@ -321,17 +1051,15 @@ THREAD_HANDLE tal_workqueue_get_thread(WORKQUEUE_HANDLE handle)
         return NULL;
     }
 
+    if (__is_multi(handle)) {
+        // the first worker stands for the workqueue
+        return ((TAL_WORKQUEUE_MULTI_T *)handle)->workers[0].thread;
+    }
+
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
     return workqueue->thread;
 }
 
-typedef struct {
-    TIMER_ID timer;
-    WORKQUEUE_CB cb;
-    void *data;
-    WORKQUEUE_HANDLE handle;
-} DELAYED_WORK_T;
-
 void __delayed_work_cb(TIMER_ID timer_id, void *arg)
 {
     DELAYED_WORK_T *p_delayed_work = (DELAYED_WORK_T *)arg;
@@ -367,6 +1095,13 @@ OPERATE_RET tal_workqueue_init_delayed(WORKQUEUE_HANDLE handle, WORKQUEUE_CB cb,
     p_delayed_work->data = data;
     p_delayed_work->cb = cb;
     p_delayed_work->handle = handle;
+    p_delayed_work->heap_idx = -1;
+
+    // served by the workers, no timer needed
+    if (__is_multi(handle)) {
+        *delayed_work = (DELAYED_WORK_HANDLE)p_delayed_work;
+        return OPRT_OK;
+    }
 
     op_ret = tal_sw_timer_create(__delayed_work_cb, p_delayed_work, &p_delayed_work->timer);
     if (OPRT_OK != op_ret) {
@@ -397,6 +1132,27 @@ OPERATE_RET tal_workqueue_start_delayed(DELAYED_WORK_HANDLE delayed_work, TIME_M
 
     DELAYED_WORK_T *p_delayed_work = (DELAYED_WORK_T *)delayed_work;
 
+    if (__is_multi(p_delayed_work->handle)) {
+        TAL_WORKQUEUE_MULTI_T *wq = (TAL_WORKQUEUE_MULTI_T *)p_delayed_work->handle;
+        OPERATE_RET op_ret = OPRT_OK;
+
+        tal_mutex_lock(wq->mutex);
+        p_delayed_work->interval = interval;
+        p_delayed_work->type = type;
+        p_delayed_work->deadline = tal_system_get_millisecond() + interval;
+        if (p_delayed_work->heap_idx < 0) {
+            op_ret = __heap_insert(wq, p_delayed_work);
+        } else {
+            __heap_sift(wq, p_delayed_work->heap_idx);
+        }
+        // a new earliest deadline shortens the wait of an idle worker
+        if (OPRT_OK == op_ret && 0 == p_delayed_work->heap_idx) {
+            tal_semaphore_post(wq->sem);
+        }
+        tal_mutex_unlock(wq->mutex);
+        return op_ret;
+    }
+
     return tal_sw_timer_start(p_delayed_work->timer, interval, type);
 }
 
@@ -416,6 +1172,14 @@ OPERATE_RET tal_workqueue_stop_delayed(DELAYED_WORK_HANDLE delayed_work)
 
     DELAYED_WORK_T *p_delayed_work = (DELAYED_WORK_T *)delayed_work;
 
+    if (__is_multi(p_delayed_work->handle)) {
+        TAL_WORKQUEUE_MULTI_T *wq = (TAL_WORKQUEUE_MULTI_T *)p_delayed_work->handle;
+        tal_mutex_lock(wq->mutex);
+        __heap_remove(wq, p_delayed_work);
+        tal_mutex_unlock(wq->mutex);
+        return OPRT_OK;
+    }
+
     return tal_sw_timer_stop(p_delayed_work->timer);
 }
 
@@ -435,7 +1199,11 @@ OPERATE_RET tal_workqueue_cancel_delayed(DELAYED_WORK_HANDLE delayed_work)
 
     DELAYED_WORK_T *p_delayed_work = (DELAYED_WORK_T *)delayed_work;
 
-    tal_sw_timer_delete(p_delayed_work->timer);
+    if (__is_multi(p_delayed_work->handle)) {
+        tal_workqueue_stop_delayed(delayed_work);
+    } else {
+        tal_sw_timer_delete(p_delayed_work->timer);
+    }
     tal_workqueue_cancel(p_delayed_work->handle, p_delayed_work->cb, p_delayed_work->data);
 
     tal_free(p_delayed_work);
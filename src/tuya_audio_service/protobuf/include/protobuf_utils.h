@@ -14,6 +14,10 @@
 #include "protobuf-c/protobuf-c.h"
 #include "tuya_list.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 struct opt_entry_data{
   ProtobufCMessage base;
   char *key;
@@ -40,6 +44,32 @@ OPERATE_RET pb_enc_opt_entry_set_kv_integer(PB_ENC_OPT_ENTRY_S *root, char *key,
 OPERATE_RET pb_enc_opt_entry_create_arr(PB_ENC_OPT_ENTRY_S *p_root);
 OPERATE_RET pb_enc_opt_entry_destory(PB_ENC_OPT_ENTRY_S *p_root);
 
+/* longest tag + length prefix of a length delimited field */
+#define PB_ENC_LEN_HEAD_MAX (10)
+
+/* writes fields straight into a caller buffer, in the order they are given */
+typedef struct {
+    uint8_t *buf;
+    uint32_t size;
+    uint32_t len;
+} PB_ENC_WRITER_S;
+
+void pb_enc_writer_init(PB_ENC_WRITER_S *writer, uint8_t *buf, uint32_t size);
+OPERATE_RET pb_enc_write_len_head(PB_ENC_WRITER_S *writer, uint32_t field, uint32_t len);
+OPERATE_RET pb_enc_write_string(PB_ENC_WRITER_S *writer, uint32_t field, const char *str);
+OPERATE_RET pb_enc_write_bytes(PB_ENC_WRITER_S *writer, uint32_t field, const uint8_t *data, uint32_t len);
+
+/* bump allocator for unpacking, what does not fit in buf goes to the heap */
+typedef struct {
+    ProtobufCAllocator allocator;
+    uint8_t *buf;
+    size_t size;
+    size_t used;
+} PB_DEC_ARENA_S;
+
+void pb_dec_arena_init(PB_DEC_ARENA_S *arena, uint8_t *buf, size_t size);
+void pb_dec_arena_reset(PB_DEC_ARENA_S *arena);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -154,3 +154,98 @@ OPERATE_RET pb_enc_opt_entry_create_arr(PB_ENC_OPT_ENTRY_S *p_root)
     return OPRT_OK;
 }
 
+static OPERATE_RET __pb_enc_write_varint(PB_ENC_WRITER_S *writer, uint32_t value)
+{
+    do {
+        if (writer->len >= writer->size) {
+            return OPRT_BUFFER_NOT_ENOUGH;
+        }
+        writer->buf[writer->len++] = (uint8_t)((value & 0x7F) | ((value > 0x7F) ? 0x80 : 0));
+        value >>= 7;
+    } while (value);
+
+    return OPRT_OK;
+}
+
+void pb_enc_writer_init(PB_ENC_WRITER_S *writer, uint8_t *buf, uint32_t size)
+{
+    writer->buf = buf;
+    writer->size = size;
+    writer->len = 0;
+}
+
+OPERATE_RET pb_enc_write_len_head(PB_ENC_WRITER_S *writer, uint32_t field, uint32_t len)
+{
+    OPERATE_RET rt = OPRT_OK;
+    TUYA_CHECK_NULL_RETURN(writer,OPRT_INVALID_PARM);
+
+    TUYA_CALL_ERR_RETURN(__pb_enc_write_varint(writer, (field << 3) | PROTOBUF_C_WIRE_TYPE_LENGTH_PREFIXED));
+    TUYA_CALL_ERR_RETURN(__pb_enc_write_varint(writer, len));
+    if (writer->size - writer->len < len) {
+        return OPRT_BUFFER_NOT_ENOUGH;
+    }
+
+    return OPRT_OK;
+}
+
+OPERATE_RET pb_enc_write_bytes(PB_ENC_WRITER_S *writer, uint32_t field, const uint8_t *data, uint32_t len)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    TUYA_CALL_ERR_RETURN(pb_enc_write_len_head(writer, field, len));
+    if (len) {
+        memcpy(writer->buf + writer->len, data, len);
+        writer->len += len;
+    }
+
+    return OPRT_OK;
+}
+
+OPERATE_RET pb_enc_write_string(PB_ENC_WRITER_S *writer, uint32_t field, const char *str)
+{
+    // proto3 leaves empty strings out, same as protobuf-c
+    if (NULL == str || '\0' == str[0]) {
+        return OPRT_OK;
+    }
+
+    return pb_enc_write_bytes(writer, field, (const uint8_t *)str, strlen(str));
+}
+
+static void *__pb_dec_arena_alloc(void *allocator_data, size_t size)
+{
+    PB_DEC_ARENA_S *arena = (PB_DEC_ARENA_S *)allocator_data;
+    size_t used = (arena->used + 7) & ~(size_t)7;
+
+    if (used <= arena->size && size <= arena->size - used) {
+        arena->used = used + size;
+        return arena->buf + used;
+    }
+
+    return Malloc(size);
+}
+
+static void __pb_dec_arena_free(void *allocator_data, void *pointer)
+{
+    PB_DEC_ARENA_S *arena = (PB_DEC_ARENA_S *)allocator_data;
+
+    // arena memory comes back all at once with pb_dec_arena_reset
+    if ((uint8_t *)pointer >= arena->buf && (uint8_t *)pointer < arena->buf + arena->size) {
+        return;
+    }
+    Free(pointer);
+}
+
+void pb_dec_arena_init(PB_DEC_ARENA_S *arena, uint8_t *buf, size_t size)
+{
+    arena->allocator.alloc = __pb_dec_arena_alloc;
+    arena->allocator.free = __pb_dec_arena_free;
+    arena->allocator.allocator_data = arena;
+    arena->buf = buf;
+    arena->size = size;
+    arena->used = 0;
+}
+
+void pb_dec_arena_reset(PB_DEC_ARENA_S *arena)
+{
+    arena->used = 0;
+}
@@ -15,6 +15,10 @@
 #define TY_KEY_VOICE_GW_DOMAIN      "voice_gw_domain_name"
 #define TY_ATOP_GET_VOICE_GW_DOMAIN "tuya.device.aispeech.gateway.ws.domain"
 
+#if TUYA_SPEAKER_WS_HEADROOM != WS_SEND_HEADROOM
+#error "TUYA_SPEAKER_WS_HEADROOM must match WS_SEND_HEADROOM"
+#endif
+
 struct domain_name_timer {
     TIMER_ID tm_msg;
     TIME_MS tm_val;
@@ -300,6 +304,13 @@ OPERATE_RET tuya_speaker_ws_send_bin(uint8_t *data, uint32_t len)
     return websocket_client_send_bin(s_ws_hdl, (uint8_t *)data, len);
 }
 
+OPERATE_RET tuya_speaker_ws_send_bin_inplace(uint8_t *frame, uint32_t len)
+{
+    if (!tuya_speaker_ws_is_online())
+        return OPRT_COM_ERROR;
+    return websocket_client_send_bin_inplace(s_ws_hdl, frame, len);
+}
+
 OPERATE_RET tuya_speaker_ws_send_text(uint8_t *data, uint32_t len)
 {
     if (!tuya_speaker_ws_is_online())
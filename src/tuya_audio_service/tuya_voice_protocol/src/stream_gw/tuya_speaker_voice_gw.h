@@ -16,6 +16,9 @@
 extern "C" {
 #endif
 
+/* bytes to reserve in front of the data given to tuya_speaker_ws_send_bin_inplace */
+#define TUYA_SPEAKER_WS_HEADROOM (14)
+
 typedef void (*TUYA_SPEAKER_WS_CB)(uint8_t *data, size_t len);
 
 OPERATE_RET tuya_speaker_ws_client_init(TUYA_SPEAKER_WS_CB bin_cb, TUYA_SPEAKER_WS_CB text_cb);
@@ -24,6 +27,7 @@ OPERATE_RET tuya_speaker_ws_client_start(void);
 OPERATE_RET tuya_speaker_ws_client_stop(void);
 
 OPERATE_RET tuya_speaker_ws_send_bin(uint8_t *data, uint32_t len);
+OPERATE_RET tuya_speaker_ws_send_bin_inplace(uint8_t *frame, uint32_t len);
 OPERATE_RET tuya_speaker_ws_send_text(uint8_t *data, uint32_t len);
 
 BOOL_T tuya_speaker_ws_is_online(void);
@@ -525,7 +525,7 @@ static OPERATE_RET __send_custom_mqtt_msg_wait(char *p_data, int overtime_s)
     }
 
     p_report->op_ret = 100;
-    ret = tuya_mqtt_protocol_data_publish_common(&iot_client->mqctx, VOICE_MQ_PROTOCOL_NUM, p_data, strlen(p_data), __result_cb, p_report, overtime_s, TRUE);
+    ret = tuya_mqtt_protocol_data_publish_common(&iot_client->mqctx, VOICE_MQ_PROTOCOL_NUM, p_data, strlen(p_data), __result_cb, p_report, overtime_s * 1000, TRUE);
     // ret = iot_mqc_send_custom_msg(VOICE_MQ_PROTOCOL_NUM, p_data, 1, overtime_s, __result_cb, p_report);
     if (ret != OPRT_OK) {
         PR_ERR("send custom msg fail. %d", ret);
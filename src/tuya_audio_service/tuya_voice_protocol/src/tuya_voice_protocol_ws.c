@@ -32,6 +32,15 @@
 #define TUYA_WS_REQUEST_ID_MAX_LEN (64)
 #define ENABLE_VOICE_DEBUG
 
+#ifndef VOICE_PROTOCOL_WS_RSP_ARENA_SIZE
+#define VOICE_PROTOCOL_WS_RSP_ARENA_SIZE (4096)
+#endif
+
+/* Speech__Request field numbers, see stream_gw/res/aispeech.proto */
+#define SPEECH_REQUEST_FIELD_REQUESTID (1)
+#define SPEECH_REQUEST_FIELD_TYPE      (3)
+#define SPEECH_REQUEST_FIELD_BLOCK     (5)
+
 typedef enum {
     TY_VOICE_RSP_ASR_MID,
     TY_VOICE_RSP_ASR_FINISH,
@@ -51,11 +60,15 @@ typedef enum {
 typedef struct {
     uint32_t data_len;
     char request_id[TUYA_WS_REQUEST_ID_MAX_LEN];
+    uint8_t *frame; // reused for every chunk, websocket header room + request
+    uint32_t frame_size;
 } TY_VOICE_WS_UPLOAD_CTX_S;
 
 typedef struct {
     char current_id[TUYA_WS_REQUEST_ID_MAX_LEN];
     MUTEX_HANDLE id_mutex;
+    uint64_t *rsp_arena_buf;
+    PB_DEC_ARENA_S rsp_arena;
 } TY_VOICE_PROTOCOL_WS_S;
 
 static TUYA_VOICE_CBS_S g_voice_ws_cbs = {0};
@@ -126,6 +139,10 @@ OPERATE_RET tuya_voice_proto_ws_init(TUYA_VOICE_CBS_S *cbs)
 
     memset(&g_protocol_ws, 0x00, sizeof(TY_VOICE_PROTOCOL_WS_S));
     tal_mutex_create_init(&g_protocol_ws.id_mutex);
+    /* without the arena the responses are unpacked on the heap */
+    g_protocol_ws.rsp_arena_buf = Malloc(VOICE_PROTOCOL_WS_RSP_ARENA_SIZE);
+    pb_dec_arena_init(&g_protocol_ws.rsp_arena, (uint8_t *)g_protocol_ws.rsp_arena_buf,
+                      g_protocol_ws.rsp_arena_buf ? VOICE_PROTOCOL_WS_RSP_ARENA_SIZE : 0);
     return OPRT_OK;
 }
 
@@ -143,6 +160,7 @@ OPERATE_RET tuya_voice_proto_ws_init(TUYA_VOICE_CBS_S *cbs)
 OPERATE_RET tuya_voice_proto_ws_deinit(void)
 {
     tal_mutex_release(g_protocol_ws.id_mutex);
+    SAFE_FREE(g_protocol_ws.rsp_arena_buf);
     memset(&g_protocol_ws, 0x00, sizeof(TY_VOICE_PROTOCOL_WS_S));
     return 0;
 }
@@ -356,6 +374,59 @@ OPERATE_RET tuya_voice_proto_ws_get_tts_audio(char *p_session_id, char *p_tts_te
     return rt;
 }
 
+/**
+ * @brief Encode an upload request in the frame buffer of the upload and send it
+ *
+ * @details The request is written after TUYA_SPEAKER_WS_HEADROOM bytes so the
+ *          websocket header goes in front of it and the frame is sent without
+ *          another copy. The buffer grows to the largest chunk and is reused.
+ *
+ * @param[in]  p_upload_ctx  The upload context
+ * @param[in]  type          Request type
+ * @param[in]  block         Audio block, can be NULL when len is 0
+ * @param[in]  len           Length of the audio block
+ * @param[out] enc_len       Length of the encoded request
+ *
+ * @return OPERATE_RET @n
+ * - OPRT_OK: Success
+ * - OPRT_COM_ERROR: Communication error
+ * - OPRT_MALLOC_FAILED: Memory allocation failed
+ */
+static OPERATE_RET __upload_frame_send(TY_VOICE_WS_UPLOAD_CTX_S *p_upload_ctx, const char *type, uint8_t *block,
+                                       uint32_t len, uint32_t *enc_len)
+{
+    OPERATE_RET rt = OPRT_OK;
+    PB_ENC_WRITER_S writer;
+    uint32_t need = 0;
+
+    need = TUYA_SPEAKER_WS_HEADROOM + 3 * PB_ENC_LEN_HEAD_MAX + strlen(p_upload_ctx->request_id) + strlen(type) + len;
+    if (need > p_upload_ctx->frame_size) {
+        SAFE_FREE(p_upload_ctx->frame);
+        p_upload_ctx->frame_size = 0;
+        if ((p_upload_ctx->frame = (uint8_t *)Malloc(need)) == NULL) {
+            PR_ERR("Malloc frame failed");
+            return OPRT_MALLOC_FAILED;
+        }
+        p_upload_ctx->frame_size = need;
+    }
+
+    pb_enc_writer_init(&writer, p_upload_ctx->frame + TUYA_SPEAKER_WS_HEADROOM,
+                       p_upload_ctx->frame_size - TUYA_SPEAKER_WS_HEADROOM);
+    TUYA_CALL_ERR_RETURN(pb_enc_write_string(&writer, SPEECH_REQUEST_FIELD_REQUESTID, p_upload_ctx->request_id));
+    TUYA_CALL_ERR_RETURN(pb_enc_write_string(&writer, SPEECH_REQUEST_FIELD_TYPE, type));
+    if (len) {
+        TUYA_CALL_ERR_RETURN(pb_enc_write_bytes(&writer, SPEECH_REQUEST_FIELD_BLOCK, block, len));
+    }
+
+    if ((rt = tuya_speaker_ws_send_bin_inplace(p_upload_ctx->frame, writer.len)) != OPRT_OK) {
+        PR_ERR("tuya_speaker_ws_send_bin_inplace failed %d", rt);
+        return OPRT_COM_ERROR;
+    }
+    *enc_len = writer.len;
+
+    return OPRT_OK;
+}
+
 /**
  * @brief Initialize and start a voice upload session through websocket protocol
  *
@@ -458,8 +529,7 @@ OPERATE_RET tuya_voice_proto_ws_upload_start(TUYA_VOICE_UPLOAD_T *uploader, TUYA
 OPERATE_RET tuya_voice_proto_ws_upload_send(TUYA_VOICE_UPLOAD_T uploader, uint8_t *buf, uint32_t len)
 {
     OPERATE_RET rt = OPRT_OK;
-    size_t enc_len = 0;
-    uint8_t *enc_buf = NULL;
+    uint32_t enc_len = 0;
 
     if (NULL == uploader || (len && !buf)) {
         PR_ERR("param is invalid");
@@ -473,38 +543,7 @@ OPERATE_RET tuya_voice_proto_ws_upload_send(TUYA_VOICE_UPLOAD_T uploader, uint8_
         return OPRT_COM_ERROR;
     }
 
-    Speech__Request device_req;
-    speech__request__init(&device_req);
-    device_req.requestid = p_upload_ctx->request_id;
-    device_req.type = "ASR_MID";
-    device_req.block.len = len;
-    device_req.block.data = (uint8_t *)buf;
-
-    do {
-        if ((enc_len = speech__request__get_packed_size(&device_req)) <= 0) {
-            PR_ERR("protobuf get encoded data len is invalid, enc_lan[%d]", enc_len);
-            rt = OPRT_COM_ERROR;
-            break;
-        }
-        if ((enc_buf = (uint8_t *)Malloc(enc_len)) == NULL) {
-            PR_ERR("Malloc enc_buf failed");
-            rt = OPRT_MALLOC_FAILED;
-            break;
-        }
-        if ((enc_len = speech__request__pack(&device_req, enc_buf)) <= 0) {
-            PR_ERR("protobuf encode data len is invalid, enc_lan[%d]", enc_len);
-            Free(enc_buf);
-            rt = OPRT_COM_ERROR;
-            break;
-        }
-        if ((rt = tuya_speaker_ws_send_bin(enc_buf, enc_len)) != OPRT_OK) {
-            PR_ERR("tuya_speaker_ws_send_bin failed");
-            Free(enc_buf);
-            rt = OPRT_COM_ERROR;
-            break;
-        }
-        Free(enc_buf);
-    } while (0);
+    rt = __upload_frame_send(p_upload_ctx, "ASR_MID", buf, len, &enc_len);
 
     p_upload_ctx->data_len += enc_len;
 
@@ -536,50 +575,22 @@ OPERATE_RET tuya_voice_proto_ws_upload_stop(TUYA_VOICE_UPLOAD_T uploader, BOOL_T
     TY_VOICE_WS_UPLOAD_CTX_S *p_upload_ctx = (TY_VOICE_WS_UPLOAD_CTX_S *)uploader;
 
     if (!force_stop) {
-        size_t enc_len = 0;
-        uint8_t *enc_buf = NULL;
+        uint32_t enc_len = 0;
 
         if (!tuya_speaker_ws_is_online()) {
             PR_ERR("Communication has been disconnected, can't upload voice, stop failed");
             return OPRT_COM_ERROR;
         }
 
-        Speech__Request device_req;
-        speech__request__init(&device_req);
-        device_req.requestid = p_upload_ctx->request_id;
-        device_req.type = "ASR_END";
         PR_INFO("voice upload stop");
-        do {
-            if ((enc_len = speech__request__get_packed_size(&device_req)) <= 0) {
-                PR_ERR("protobuf get encoded data len is invalid, enc_lan[%d]", enc_len);
-                rt = OPRT_COM_ERROR;
-                break;
-            }
-            if ((enc_buf = (uint8_t *)Malloc(enc_len)) == NULL) {
-                PR_ERR("Malloc enc_buf failed");
-                rt = OPRT_MALLOC_FAILED;
-                break;
-            }
-            if ((enc_len = speech__request__pack(&device_req, enc_buf)) <= 0) {
-                PR_ERR("protobuf encode data len is invalid, enc_lan[%d]", enc_len);
-                Free(enc_buf);
-                rt = OPRT_COM_ERROR;
-                break;
-            }
-            if ((rt = tuya_speaker_ws_send_bin(enc_buf, enc_len)) != OPRT_OK) {
-                PR_ERR("tuya_speaker_ws_send_bin failed");
-                Free(enc_buf);
-                rt = OPRT_COM_ERROR;
-                break;
-            }
-            Free(enc_buf);
-        } while (0);
+        rt = __upload_frame_send(p_upload_ctx, "ASR_END", NULL, 0, &enc_len);
         p_upload_ctx->data_len += enc_len;
     } else {
         rt = tuya_voice_proto_ws_interrupt();
     }
 
     PR_DEBUG("total upload data len:%d force_stop:%d --<<", p_upload_ctx->data_len, force_stop);
+    SAFE_FREE(p_upload_ctx->frame);
     SAFE_FREE(p_upload_ctx);
 
     return rt;
@@ -1252,15 +1263,13 @@ static OPERATE_RET __handle_cloud_rsp(TY_VOICE_RSP_TYPE_E type, Speech__Response
 }
 
 // callback used by stream_gw
-static void speaker_ws_recv_bin_cb(uint8_t *data, size_t len)
+static void __dispatch_cloud_rsp(Speech__Response *cloud_rsp)
 {
     size_t i = 0;
     char *rsp_type[TY_VOICE_RSP_TYPE_MAX] = {"ASR_MID",         "ASR_FINISH", "NLP_FINISH", "SKILL_FINISH",
                                              "SPEECH_FINISH",   "TTS_START",  "TTS_MID",    "TTS_FINISH",
                                              "TTS_INTERRUPTED", "TEXT_START", "TEXT_MID",   "TEXT_FINISH"};
 
-    Speech__Response *cloud_rsp = speech__response__unpack(NULL, len, data);
-
     TY_GW_CHECK_NULL_RETURN_VOID(cloud_rsp->code);
     TY_GW_CHECK_NULL_RETURN_VOID(cloud_rsp->message);
     TY_GW_CHECK_NULL_RETURN_VOID(cloud_rsp->requestid);
@@ -1274,13 +1283,29 @@ static void speaker_ws_recv_bin_cb(uint8_t *data, size_t len)
     for (i = 0; i < CNTSOF(rsp_type); i++) {
         if (0 == strcmp(cloud_rsp->data->type, rsp_type[i])) {
             __handle_cloud_rsp((TY_VOICE_RSP_TYPE_E)i, cloud_rsp);
-            speech__response__free_unpacked(cloud_rsp, NULL);
             return;
         }
     }
 
     PR_ERR("invalid rsp type: %s", cloud_rsp->data->type);
-    speech__response__free_unpacked(cloud_rsp, NULL);
+}
+
+static void speaker_ws_recv_bin_cb(uint8_t *data, size_t len)
+{
+    PB_DEC_ARENA_S *arena = &g_protocol_ws.rsp_arena;
+
+    Speech__Response *cloud_rsp = speech__response__unpack(&arena->allocator, len, data);
+    if (NULL == cloud_rsp) {
+        PR_ERR("cloud rsp unpack failed, len:%d", len);
+        pb_dec_arena_reset(arena);
+        return;
+    }
+
+    __dispatch_cloud_rsp(cloud_rsp);
+
+    /* only what did not fit in the arena is really freed here */
+    speech__response__free_unpacked(cloud_rsp, &arena->allocator);
+    pb_dec_arena_reset(arena);
 }
 
 static void speaker_ws_recv_text_cb(uint8_t *data, size_t len)
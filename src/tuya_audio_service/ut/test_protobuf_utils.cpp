@@ -0,0 +1,158 @@
+/**
+ * @file test_protobuf_utils.cpp
+ * @brief UT of the in-place protobuf writer and the unpack arena.
+ *
+ * The writer must give the bytes of speech__request__pack for the fields the
+ * voice upload writes, and the arena must hold a response without touching
+ * the heap until it runs out.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "tuya_cloud_types.h"
+#include "tuya_error_code.h"
+#include "tal_api.h"
+#include "bench_port.h"
+#include "protobuf_utils.h"
+#include "aispeech.pb-c.h"
+}
+
+/* Speech__Request field numbers, as in tuya_voice_protocol_ws.c */
+#define FIELD_REQUESTID 1
+#define FIELD_TYPE      3
+#define FIELD_BLOCK     5
+
+extern "C" {
+// only the option entries of protobuf_utils use it
+char *mm_strdup(const char *str)
+{
+    char *dup = (char *)tal_malloc(strlen(str) + 1);
+
+    if (dup) {
+        strcpy(dup, str);
+    }
+    return dup;
+}
+}
+
+namespace {
+
+std::vector<uint8_t> __pack(const char *request_id, const char *type, const std::vector<uint8_t> &block)
+{
+    Speech__Request req;
+
+    speech__request__init(&req);
+    req.requestid = (char *)request_id;
+    req.type = (char *)type;
+    req.block.len = block.size();
+    req.block.data = (uint8_t *)block.data();
+
+    std::vector<uint8_t> out(speech__request__get_packed_size(&req));
+    speech__request__pack(&req, out.data());
+    return out;
+}
+
+std::vector<uint8_t> __write(const char *request_id, const char *type, const std::vector<uint8_t> &block)
+{
+    PB_ENC_WRITER_S writer;
+    std::vector<uint8_t> buf(3 * PB_ENC_LEN_HEAD_MAX + strlen(request_id) + strlen(type) + block.size());
+
+    pb_enc_writer_init(&writer, buf.data(), buf.size());
+    EXPECT_EQ(OPRT_OK, pb_enc_write_string(&writer, FIELD_REQUESTID, request_id));
+    EXPECT_EQ(OPRT_OK, pb_enc_write_string(&writer, FIELD_TYPE, type));
+    if (block.size()) {
+        EXPECT_EQ(OPRT_OK, pb_enc_write_bytes(&writer, FIELD_BLOCK, block.data(), block.size()));
+    }
+    buf.resize(writer.len);
+    return buf;
+}
+
+std::vector<uint8_t> __block(size_t len)
+{
+    std::vector<uint8_t> block(len);
+
+    for (size_t i = 0; i < len; i++) {
+        block[i] = (uint8_t)(i * 31 + 7);
+    }
+    return block;
+}
+
+} // namespace
+
+TEST(PbEncWriter, WritesWhatProtobufCPacks)
+{
+    // the lengths cross the one, two and three byte varints
+    for (size_t len : {0, 1, 127, 128, 640, 16383, 16384, 40000}) {
+        std::vector<uint8_t> block = __block(len);
+
+        EXPECT_EQ(__pack("5d41402abc4b2a76b9719d911017c592", "ASR_MID", block),
+                  __write("5d41402abc4b2a76b9719d911017c592", "ASR_MID", block))
+            << "block of " << len;
+    }
+    EXPECT_EQ(__pack("id", "", {}), __write("id", "", {}));
+    EXPECT_EQ(__pack("", "ASR_END", {}), __write("", "ASR_END", {}));
+}
+
+TEST(PbEncWriter, StopsAtTheEndOfTheBuffer)
+{
+    PB_ENC_WRITER_S writer;
+    std::vector<uint8_t> block = __block(200);
+    uint8_t buf[200];
+
+    pb_enc_writer_init(&writer, buf, sizeof(buf));
+    EXPECT_EQ(OPRT_OK, pb_enc_write_string(&writer, FIELD_TYPE, "ASR_MID"));
+    EXPECT_EQ(OPRT_BUFFER_NOT_ENOUGH, pb_enc_write_bytes(&writer, FIELD_BLOCK, block.data(), block.size()));
+
+    pb_enc_writer_init(&writer, buf, 1);
+    EXPECT_EQ(OPRT_BUFFER_NOT_ENOUGH, pb_enc_write_string(&writer, FIELD_TYPE, "ASR_MID"));
+}
+
+TEST(PbDecArena, UnpacksWithoutTheHeap)
+{
+    alignas(8) uint8_t arena_buf[1024];
+    PB_DEC_ARENA_S arena;
+    BENCH_HEAP_STAT_T before, after;
+    std::vector<uint8_t> packed = __pack("5d41402abc4b2a76b9719d911017c592", "ASR_MID", __block(256));
+
+    pb_dec_arena_init(&arena, arena_buf, sizeof(arena_buf));
+    bench_heap_stat_get(&before);
+    for (int i = 0; i < 8; i++) {
+        Speech__Request *req = speech__request__unpack(&arena.allocator, packed.size(), packed.data());
+
+        ASSERT_NE(nullptr, req);
+        EXPECT_STREQ("ASR_MID", req->type);
+        EXPECT_EQ(__block(256), std::vector<uint8_t>(req->block.data, req->block.data + req->block.len));
+        speech__request__free_unpacked(req, &arena.allocator);
+        pb_dec_arena_reset(&arena);
+    }
+    bench_heap_stat_get(&after);
+    EXPECT_EQ(before.alloc_cnt, after.alloc_cnt);
+}
+
+TEST(PbDecArena, FallsBackToTheHeapWhenFull)
+{
+    alignas(8) uint8_t arena_buf[256];
+    PB_DEC_ARENA_S arena;
+    BENCH_HEAP_STAT_T before, after;
+    std::vector<uint8_t> packed = __pack("id", "ASR_MID", __block(1024));
+
+    pb_dec_arena_init(&arena, arena_buf, sizeof(arena_buf));
+    bench_heap_stat_get(&before);
+    Speech__Request *req = speech__request__unpack(&arena.allocator, packed.size(), packed.data());
+
+    ASSERT_NE(nullptr, req);
+    EXPECT_EQ(__block(1024), std::vector<uint8_t>(req->block.data, req->block.data + req->block.len));
+    speech__request__free_unpacked(req, &arena.allocator);
+    pb_dec_arena_reset(&arena);
+
+    bench_heap_stat_get(&after);
+    EXPECT_LT(before.alloc_cnt, after.alloc_cnt);
+    EXPECT_EQ(before.cur_bytes, after.cur_bytes);
+}
@@ -26,6 +26,7 @@ extern "C" {
 #define WS_HANDSHAKE_CONN_TIMEOUT       (10)//s
 #define WS_HANDSHAKE_RECV_TIMEOUT       (2*1000)//ms
 #define WS_RECONNECT_WAIT_TIME          (2*1000)//(5*1000)//ms
+#define WS_SEND_HEADROOM                (14)// bytes reserved in front of the payload for in-place sending
 
 typedef uint8_t WS_CONN_STATE_T;
 #define WS_CONN_STATE_NONE              (0)
@@ -146,6 +147,19 @@ OPERATE_RET websocket_client_send_text(WEBSOCKET_HANDLE_T handle, uint8_t *data,
  */
 OPERATE_RET websocket_client_send_bin(WEBSOCKET_HANDLE_T handle, uint8_t *data, uint32_t len);
 
+/**
+ * @brief Send binary data built in the caller's buffer without copying it
+ * 
+ * @param[in] handle WebSocket client handle
+ * @param[in] frame WS_SEND_HEADROOM reserved bytes followed by the data,
+ *                  the data is masked in place and can't be sent again
+ * @param[in] len Length of the data after the reserved bytes
+ * @return OPERATE_RET
+ *         - OPRT_OK: Success
+ *         - Others: Failure
+ */
+OPERATE_RET websocket_client_send_bin_inplace(WEBSOCKET_HANDLE_T handle, uint8_t *frame, uint32_t len);
+
 /**
  * @brief Send a ping frame through the WebSocket connection
  * 
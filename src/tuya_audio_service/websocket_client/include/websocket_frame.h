@@ -28,6 +28,7 @@ extern "C" {
 
 #define WS_FRAME_HEADER_SIZE            (10) // frame header size
 #define WS_MASKING_KEY_SIZE             (4) // masking key size
+#define WS_FRAME_SEND_HEADER_SIZE       (WS_FRAME_HEADER_SIZE + WS_MASKING_KEY_SIZE) // masked frame header size
 
 /**
  * @brief WebSocket ANBF description
@@ -119,6 +120,27 @@ typedef void (*WEBSOCKET_FRAME_RECV_CB)(WEBSOCKET_S *ws, WEBSOCKET_FRAME_TYPE_E
 OPERATE_RET websocket_send_frame(WEBSOCKET_S *ws, WEBSOCKET_FRAME_TYPE_E type,
                                  void *data, size_t len, BOOL_T first, BOOL_T final);
 
+/**
+ * @brief Send a WebSocket frame built in the caller's buffer
+ *
+ * The payload is masked in place and the frame header is written into the
+ * WS_FRAME_SEND_HEADER_SIZE bytes reserved in front of it, so the frame is sent
+ * without being copied.
+ *
+ * @param[in] ws Pointer to the WebSocket structure
+ * @param[in] type Type of the WebSocket frame
+ * @param[in] frame WS_FRAME_SEND_HEADER_SIZE reserved bytes followed by the payload
+ * @param[in] len Length of the payload in bytes
+ *
+ * @return OPERATE_RET
+ *         - OPRT_OK: Frame sent successfully
+ *         - OPRT_INVALID_PARM: Invalid parameters (NULL pointer)
+ *         - OPRT_SEND_ERR: Error occurred during frame sending
+ *
+ * @note The payload is left masked, it must be written again before it is reused.
+ */
+OPERATE_RET websocket_send_frame_inplace(WEBSOCKET_S *ws, WEBSOCKET_FRAME_TYPE_E type, uint8_t *frame, size_t len);
+
 /**
  * @brief Receive and process a WebSocket frame
  *
@@ -30,6 +30,11 @@
 #define WS_HB_PING_TIME_INTERVAL            (VOICE_PROTOCOL_STREAM_GW_KEEP_ALIVE_TIME/3 * 1000)  /**< unit millisecond */
 #define WS_HB_PONG_TIMEOUT                  ((VOICE_PROTOCOL_STREAM_GW_KEEP_ALIVE_TIME+1) * 1000) /**< unit millisecond */
 #endif
+
+#if WS_SEND_HEADROOM != WS_FRAME_SEND_HEADER_SIZE
+#error "WS_SEND_HEADROOM must match the masked frame header size"
+#endif
+
 static WEBSOCKET_S *s_websocket_clinet = NULL;
 static BOOL_T s_net_link_up_connected = TRUE;
 static void __set_handshake_conn_timeout(WEBSOCKET_S *ws, uint32_t timeout_s)
@@ -458,6 +463,23 @@ OPERATE_RET websocket_client_send_bin(WEBSOCKET_HANDLE_T handle, uint8_t *data,
     return websocket_send_frame(ws, WS_FRAME_TYPE_BINARY, data, len, TRUE, TRUE);
 }
 
+/**
+ * @brief Send binary data built in the caller's buffer without copying it
+ * 
+ * @param[in] handle WebSocket client handle
+ * @param[in] frame WS_SEND_HEADROOM reserved bytes followed by the data,
+ *                  the data is masked in place and can't be sent again
+ * @param[in] len Length of the data after the reserved bytes
+ * @return OPERATE_RET
+ *         - OPRT_OK: Success
+ *         - Others: Failure
+ */
+OPERATE_RET websocket_client_send_bin_inplace(WEBSOCKET_HANDLE_T handle, uint8_t *frame, uint32_t len)
+{
+    WEBSOCKET_S *ws = (WEBSOCKET_S *)handle;
+    return websocket_send_frame_inplace(ws, WS_FRAME_TYPE_BINARY, frame, len);
+}
+
 /**
  * @brief Send a ping frame through the WebSocket connection
  * 
@@ -91,7 +91,7 @@ OPERATE_RET websocket_send_frame(WEBSOCKET_S *ws, WEBSOCKET_FRAME_TYPE_E type,
                                  void *data, size_t len, BOOL_T first, BOOL_T final)
 {
     WEBSOCKET_FRAME_TYPE_E frame_type;
-    uint8_t headbuf[WS_FRAME_HEADER_SIZE] = {0}, headlen = 0;
+    uint8_t headbuf[WS_FRAME_SEND_HEADER_SIZE] = {0}, headlen = 0;
     uint8_t masking_key[WS_MASKING_KEY_SIZE] = {0};
     OPERATE_RET rt = OPRT_OK;
     WS_CHECK_NULL_RET(ws);
@@ -131,6 +131,53 @@ OPERATE_RET websocket_send_frame(WEBSOCKET_S *ws, WEBSOCKET_FRAME_TYPE_E type,
     return OPRT_OK;
 }
 
+/**
+ * @brief Send a WebSocket frame built in the caller's buffer
+ *
+ * The header is formatted right in front of the payload and the payload is
+ * masked in place, so the whole frame goes out in one send without a copy.
+ *
+ * @param[in] ws Pointer to the WebSocket structure
+ * @param[in] type Type of the WebSocket frame
+ * @param[in] frame WS_FRAME_SEND_HEADER_SIZE reserved bytes followed by the payload
+ * @param[in] len Length of the payload in bytes
+ *
+ * @return OPERATE_RET
+ *         - OPRT_OK: Frame sent successfully
+ *         - OPRT_INVALID_PARM: Invalid parameters (NULL pointer)
+ *         - OPRT_SEND_ERR: Error occurred during frame sending
+ */
+OPERATE_RET websocket_send_frame_inplace(WEBSOCKET_S *ws, WEBSOCKET_FRAME_TYPE_E type, uint8_t *frame, size_t len)
+{
+    uint8_t headbuf[WS_FRAME_SEND_HEADER_SIZE] = {0}, headlen = 0;
+    uint8_t masking_key[WS_MASKING_KEY_SIZE] = {0};
+    uint8_t *payload = NULL;
+    OPERATE_RET rt = OPRT_OK;
+    size_t i = 0;
+    WS_CHECK_NULL_RET(ws);
+    WS_CHECK_NULL_RET(frame);
+
+    rt = websocket_format_frame_header(TRUE, type, (uint64_t)len, masking_key, headbuf, &headlen);
+    if (OPRT_OK != rt) {
+        PR_ERR("websocket %p format header error, rt:%d", ws, rt);
+        return OPRT_SEND_ERR;
+    }
+
+    payload = frame + WS_FRAME_SEND_HEADER_SIZE;
+    for (i = 0; i < len; i++) {
+        payload[i] ^= masking_key[i % 4];
+    }
+    memcpy(payload - headlen, headbuf, headlen);
+
+    rt = websocket_netio_send_lock(ws, payload - headlen, headlen + len);
+    if (OPRT_OK != rt) {
+        PR_ERR("websocket %p websocket_send_frame_inplace error, rt:%d", ws, rt);
+        return OPRT_SEND_ERR;
+    }
+
+    return OPRT_OK;
+}
+
 static BOOL_T websocket_check_opcode_valid(uint8_t opcode)
 {
     if (opcode != WS_FRAME_TYPE_CONTINUATION && opcode != WS_FRAME_TYPE_TEXT &&
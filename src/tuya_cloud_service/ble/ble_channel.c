@@ -13,6 +13,10 @@
 
 #include "tal_api.h"
 #include "ble_channel.h"
+#include "ble_trsmitr.h"
+#if defined(ENABLE_BT_WND) && (ENABLE_BT_WND == 1)
+#include "ble_window.h"
+#endif
 
 #define SUBPACKET_RECV_ALL_DONE         0
 #define SUBPACKET_RECV_ONE_AND_NEXT     1
@@ -39,6 +43,25 @@ typedef struct {
 } ble_channel_mgr_t;
 
 static ble_channel_mgr_t s_ble_channel_mgr = {0}; // APP downlink channel transparent transmission
+// the response state is used by the session, the sender of the response and the window timer
+static MUTEX_HANDLE s_ble_channel_mutex = NULL;
+
+#if defined(ENABLE_BT_WND) && (ENABLE_BT_WND == 1)
+#define BLE_CHANNEL_AIR_PKT_MS 20 // ble_packet_resp paces the air packets
+
+typedef struct {
+    bool peer;           // the last downlink frame of the app had the window flag
+    uint8_t peer_window; // receive window of the app
+    bool tx_active;
+    uint8_t tx_id;
+    uint16_t tx_type;
+    ble_wnd_tx_t tx;
+    ble_wnd_rx_t rx;
+    DELAYED_WORK_HANDLE timer;
+} ble_channel_wnd_t;
+
+static ble_channel_wnd_t s_ble_channel_wnd = {0};
+#endif
 
 typedef struct {
     ble_channel_fn_t function;
@@ -47,6 +70,20 @@ typedef struct {
 
 static ble_channel_t s_ble_channel[BLE_CHANNEL_MAX];
 
+/**
+ * @brief Initializes the BLE channel.
+ *
+ * @return Returns OPRT_OK on success, or an error code on failure.
+ */
+int ble_channel_init(void)
+{
+    if (s_ble_channel_mutex) {
+        return OPRT_OK;
+    }
+
+    return tal_mutex_create_init(&s_ble_channel_mutex);
+}
+
 /**
  * @brief Adds a BLE channel.
  *
@@ -191,6 +228,138 @@ static void __response_to_app_by_subpack(uint16_t type)
     tal_free(pkg_buff);
 }
 
+#if defined(ENABLE_BT_WND) && (ENABLE_BT_WND == 1)
+static int __wnd_send_cb(ble_wnd_frame_t *frame, void *user_data)
+{
+    int rt;
+    uint8_t *pkg_buff = NULL;
+
+    pkg_buff = tal_malloc(TUYA_BLE_TRANS_DATA_SUBPACK_LEN);
+    if (NULL == pkg_buff) {
+        PR_ERR("malloc error in __wnd_send_cb");
+        return OPRT_MALLOC_FAILED;
+    }
+
+    rt = tuya_ble_send(s_ble_channel_wnd.tx_type, 0, pkg_buff, ble_wnd_frame_encode(frame, pkg_buff));
+    tal_free(pkg_buff);
+
+    return rt;
+}
+
+/**
+ * @brief ends or rearms the window transfer, called with the channel mutex held
+ */
+static void __wnd_tx_result(int rt)
+{
+    ble_channel_wnd_t *wnd = &s_ble_channel_wnd;
+
+    if (OPRT_SVC_BT_API_TRSMITR_CONTINUE == rt) {
+        tal_workq_start_delayed(wnd->timer, ble_wnd_tx_wait_get(&wnd->tx, tal_system_get_millisecond()) + 1,
+                                LOOP_ONCE);
+        return;
+    }
+
+    if (OPRT_OK != rt) {
+        PR_ERR("wnd subpack send failed %d", rt);
+    }
+
+    tal_workq_stop_delayed(wnd->timer);
+    wnd->tx_active = false;
+    if (s_ble_channel_mgr.rsp_data) {
+        tal_free(s_ble_channel_mgr.rsp_data);
+    }
+    memset(&s_ble_channel_mgr, 0, sizeof(s_ble_channel_mgr));
+}
+
+static void __wnd_timeout_cb(void *data)
+{
+    tal_mutex_lock(s_ble_channel_mutex);
+    if (s_ble_channel_wnd.tx_active) {
+        __wnd_tx_result(ble_wnd_tx_poll(&s_ble_channel_wnd.tx, tal_system_get_millisecond()));
+    }
+    tal_mutex_unlock(s_ble_channel_mutex);
+}
+
+static void __wnd_response_to_app(uint16_t type)
+{
+    ble_channel_wnd_t *wnd = &s_ble_channel_wnd;
+    uint16_t mtu = ble_frame_packet_len_get();
+    uint32_t chunk, rto_ms;
+    uint8_t window;
+
+    if (NULL == wnd->timer && OPRT_OK != tal_workq_init_delayed(WORKQ_HIGHTPRI, __wnd_timeout_cb, NULL, &wnd->timer)) {
+        PR_ERR("wnd timer init failed");
+        __wnd_tx_result(OPRT_COM_ERROR);
+        return;
+    }
+
+    ble_wnd_param_get(mtu, &chunk, &window);
+    if (wnd->peer_window && wnd->peer_window < window) {
+        window = wnd->peer_window;
+    }
+    // the whole window is paced out before the first ack can come back
+    rto_ms = BT_WND_RTO_MS + window * (chunk / mtu + 1) * BLE_CHANNEL_AIR_PKT_MS;
+
+    PR_DEBUG("wnd subpack len:%u, chunk:%u, window:%u", s_ble_channel_mgr.subpack_len, chunk, window);
+    wnd->tx_active = true;
+    wnd->tx_type = type;
+    __wnd_tx_result(ble_wnd_tx_start(&wnd->tx, ++wnd->tx_id, s_ble_channel_mgr.subpack_data,
+                                     s_ble_channel_mgr.subpack_len, chunk, window, rto_ms, __wnd_send_cb, NULL,
+                                     tal_system_get_millisecond()));
+}
+
+/**
+ * @brief applies a window ack of the app, called with the channel mutex held
+ */
+static void __wnd_ack_process(uint8_t *data, uint16_t len)
+{
+    ble_wnd_ack_t ack;
+
+    if (!s_ble_channel_wnd.tx_active || OPRT_OK != ble_wnd_ack_decode(data, len, &ack)) {
+        return;
+    }
+
+    __wnd_tx_result(ble_wnd_tx_ack(&s_ble_channel_wnd.tx, &ack, tal_system_get_millisecond()));
+}
+
+static void __wnd_downlink_process(ble_packet_t *req)
+{
+    ble_wnd_rx_t *rx = &s_ble_channel_wnd.rx;
+    ble_wnd_frame_t frame;
+    ble_wnd_ack_t ack;
+    uint8_t buf[BLE_WND_ACK_LEN];
+    uint32_t chunk;
+    uint8_t window;
+    bool ack_now = false;
+    int rt;
+
+    if (OPRT_OK != ble_wnd_frame_decode(req->data, req->len, &frame)) {
+        PR_ERR("wnd subpacket decode error");
+        return;
+    }
+
+    if (0 == rx->window) {
+        ble_wnd_param_get(ble_frame_packet_len_get(), &chunk, &window);
+        ble_wnd_rx_init(rx, window);
+    }
+
+    rt = ble_wnd_rx_put(rx, &frame, &ack_now);
+    PR_DEBUG("rece wnd downlink subpacket, id:%u, no:%u, len:%u, rt:%d", frame.id, frame.no, frame.len, rt);
+    if (ack_now) {
+        ble_wnd_rx_ack_get(rx, &ack);
+        tuya_ble_send(req->type, req->sn, buf, ble_wnd_ack_encode(&ack, frame.flag, buf));
+    }
+
+    if (OPRT_OK == rt) {
+        tuya_ble_raw_print("recv_donwlink_cmd", 16, rx->buf, rx->total);
+        ble_channel_process(rx->buf);
+        ble_wnd_rx_release(rx);
+    } else if (OPRT_SVC_BT_API_TRSMITR_CONTINUE != rt) {
+        PR_ERR("wnd subpacket recv error %d", rt);
+    }
+}
+#endif
+
 /**
  * @brief Sends a response to the app by subpack.
  *
@@ -207,6 +376,8 @@ static void __response_to_app_by_subpack(uint16_t type)
  */
 void ble_channle_ack(uint16_t type, uint8_t *data, uint32_t len)
 {
+    tal_mutex_lock(s_ble_channel_mutex);
+
     if (s_ble_channel_mgr.rsp_data) {
         PR_ERR("pre subpack data overwrite!");
         tal_free(s_ble_channel_mgr.rsp_data);
@@ -218,7 +389,17 @@ void ble_channle_ack(uint16_t type, uint8_t *data, uint32_t len)
     s_ble_channel_mgr.subpack_len = len - 2;
 
     PR_DEBUG("start to send subpack cmd:%x, subcmd:%x", type, data[3]);
+#if defined(ENABLE_BT_WND) && (ENABLE_BT_WND == 1)
+    s_ble_channel_wnd.tx_active = false;
+    if (s_ble_channel_wnd.peer) {
+        __wnd_response_to_app(type);
+        tal_mutex_unlock(s_ble_channel_mutex);
+        return;
+    }
+#endif
     __response_to_app_by_subpack(type);
+
+    tal_mutex_unlock(s_ble_channel_mutex);
 }
 
 /**
@@ -249,6 +430,18 @@ void ble_session_channel_process(ble_packet_t *req, void *user_data)
         // [0~1]: flag
         // bit0: 0 - not need response, 1 - need response
         // bit1: 0 - not subpacket, 1 - subpacket
+        // bit2: 0 - serial subpackets, 1 - window subpackets, [0] is the receive window
+#if defined(ENABLE_BT_WND) && (ENABLE_BT_WND == 1)
+        tal_mutex_lock(s_ble_channel_mutex);
+        s_ble_channel_wnd.peer = (pRawData[1] & BLE_WND_FLAG) ? true : false;
+        s_ble_channel_wnd.peer_window = s_ble_channel_wnd.peer ? pRawData[0] : 0;
+        tal_mutex_unlock(s_ble_channel_mutex);
+        // the receive state is only used here, and the channel functions may send a response
+        if ((pRawData[1] & BLE_WND_FLAG) && (pRawData[1] & 0x02)) {
+            __wnd_downlink_process(req);
+            return;
+        }
+#endif
         if (pRawData[1] & 0x02) { // subpacket process
             uint32_t offset = 0;
             uint32_t curSubpacketNo = 0;
@@ -330,6 +523,19 @@ void ble_session_channel_process(ble_packet_t *req, void *user_data)
     } else if (FRM_UPLINK_TRANSPARENT_REQ == req->type || FRM_UPLINK_TRANSPARENT_SPEC_REQ == req->type) {
         tuya_ble_raw_print("recv_uplink_frame", 16, pRawData, pRawLen);
         uint8_t status = pRawData[2];
+
+        tal_mutex_lock(s_ble_channel_mutex);
+#if defined(ENABLE_BT_WND) && (ENABLE_BT_WND == 1)
+        if (status == BLE_WND_STATUS_ACK) { // window subpack ack
+            __wnd_ack_process(pRawData, pRawLen);
+            tal_mutex_unlock(s_ble_channel_mutex);
+            return;
+        }
+        if (s_ble_channel_wnd.tx_active) { // serial acks do not apply to window subpacks
+            tal_mutex_unlock(s_ble_channel_mutex);
+            return;
+        }
+#endif
         if (status == 0) { // complete subpack send
             if (s_ble_channel_mgr.rsp_data) {
                 tal_free(s_ble_channel_mgr.rsp_data);
@@ -343,5 +549,6 @@ void ble_session_channel_process(ble_packet_t *req, void *user_data)
             __response_to_app_by_subpack(req->type);
         } else {
         }
+        tal_mutex_unlock(s_ble_channel_mutex);
     }
 }
@@ -33,6 +33,13 @@ typedef enum {
 
 typedef void (*ble_channel_fn_t)(void *data, void *user_data);
 
+/**
+ * @brief Initializes the BLE channel, before the channel session is added.
+ *
+ * @return Returns OPRT_OK on success, or an error code on failure.
+ */
+int ble_channel_init(void);
+
 /**
  * @brief Adds a BLE channel.
  *
@@ -61,6 +68,18 @@ int ble_channel_del(ble_channel_type_t type);
  */
 void ble_session_channel_process(ble_packet_t *req, void *priv_data);
 
+/**
+ * @brief Sends a response to the app by subpack.
+ *
+ * The response goes out in window subpackets when the last downlink frame of
+ * the app carried the window flag, otherwise one subpacket per app ack.
+ *
+ * @param type The type of the response.
+ * @param data The response, freed by the channel once it is sent.
+ * @param len The length of the response.
+ */
+void ble_channle_ack(uint16_t type, uint8_t *data, uint32_t len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -787,12 +787,17 @@ static uint8_t ble_dev_info_make(tuya_ble_mgr_t *ble, uint8_t *pbuf, uint8_t buf
     pbuf[payload_len++] = 0;
     pbuf[payload_len++] = 1;
     // CombosFlag Length
+    //  bit4: 1 - Supports window subpackets on the transparent channel; 0 - Does not support.
     //  bit3: 1 - Supports querying device AP name; 0 - Does not support.
     //  bit2: 1 - Supports log collection and transmission; 0 - Does not
     //  support. bit1: 1 - Supports reporting of various states during network
     //  configuration; 0 - Does not support. bit0: 1 - Supports querying WiFi
     //  hotspot list; 0 - Does not support.
+#if defined(ENABLE_BT_WND) && (ENABLE_BT_WND == 1)
+    pbuf[payload_len++] = (uint8_t)(1 << 4);
+#else
     pbuf[payload_len++] = 0;
+#endif
 
     return payload_len;
 }
@@ -1071,6 +1076,7 @@ int tuya_ble_init(tuya_ble_cfg_t *cfg)
     TUYA_CALL_ERR_GOTO(tal_sw_timer_create(ble_pair_timeout_cb, ble, &ble->pair_timer), __exit);
     TUYA_CALL_ERR_GOTO(tal_sw_timer_create(ble_mointor_timer_cb, ble, &ble->monitor_timer), __exit);
     TUYA_CALL_ERR_GOTO(tal_sw_timer_start(ble->monitor_timer, 3000, TAL_TIMER_CYCLE), __exit);
+    TUYA_CALL_ERR_GOTO(ble_channel_init(), __exit);
     tuya_ble_session_add(BLE_SESSION_SYSTEM, ble_session_system_process, ble);
     tuya_ble_session_add(BLE_SESSION_CHANNEL, ble_session_channel_process, ble);
     tuya_ble_session_add(BLE_SESSION_DP, ble_session_dp_process, ble->cfg.client);
@@ -0,0 +1,514 @@
+/**
+ * @file ble_window.c
+ * @brief Sliding window transport for the BLE transparent channel.
+ *
+ * The sender keeps at most window subpackets between base, the oldest one
+ * not acked, and next, the first one never sent. Each send is stamped with a
+ * send order, and when an ack reports a subpacket the holes sent before it
+ * are resent at once, like a selective repeat with fast retransmission. The
+ * receiver acks every half window, on any gap, gap filled or duplicate, and
+ * when the transfer is complete.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "tal_api.h"
+#include "ble_window.h"
+
+#define WND_IDX(no) ((no) % BLE_WND_LMT)
+
+static uint32_t __varint_encode(uint32_t num, uint8_t *buf)
+{
+    uint32_t offset = 0;
+
+    do {
+        buf[offset] = num % 0x80;
+        num /= 0x80;
+        if (num) {
+            buf[offset] |= 0x80;
+        }
+        offset++;
+    } while (num && offset < 4);
+
+    return offset;
+}
+
+static uint32_t __varint_decode(uint8_t *buf, uint32_t len, uint32_t *num)
+{
+    uint32_t multiplier = 1;
+    uint32_t offset = 0;
+    uint8_t digit;
+
+    *num = 0;
+    while (offset < len && offset < 4) {
+        digit = buf[offset++];
+        *num += (digit & 0x7f) * multiplier;
+        multiplier *= 0x80;
+        if (0 == (digit & 0x80)) {
+            return offset;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Derives the subpacket size and the window from the packet length
+ * negotiated with the app.
+ *
+ * @param mtu packet length of the link
+ * @param chunk data bytes per subpacket
+ * @param window subpackets in flight
+ */
+void ble_wnd_param_get(uint16_t mtu, uint32_t *chunk, uint8_t *window)
+{
+    uint32_t size = (uint32_t)mtu * BLE_WND_MTU_PKTS;
+    uint32_t num;
+
+    // a subpacket spans a few air packets at most, so a loss costs little
+    size = (size > TUYA_BLE_TRANS_DATA_SUBPACK_LEN) ? TUYA_BLE_TRANS_DATA_SUBPACK_LEN : size;
+    size = (size < BLE_WND_HDR_MAX + 64) ? BLE_WND_HDR_MAX + 64 : size;
+    *chunk = size - BLE_WND_HDR_MAX;
+
+    num = BT_WND_INFLIGHT_BYTES / *chunk;
+    num = (num > BT_WND_MAX) ? BT_WND_MAX : num;
+    num = (num > BLE_WND_LMT) ? BLE_WND_LMT : num;
+    *window = (num < 1) ? 1 : num;
+}
+
+/**
+ * @brief Encodes a window subpacket, channel flag included.
+ *
+ * @param frame the subpacket
+ * @param buf output buffer of at least BLE_WND_HDR_MAX + frame->len bytes
+ *
+ * @return the encoded length
+ */
+uint32_t ble_wnd_frame_encode(ble_wnd_frame_t *frame, uint8_t *buf)
+{
+    uint32_t offset = 0;
+
+    buf[offset++] = frame->window;
+    buf[offset++] = frame->flag | BLE_WND_FLAG;
+    buf[offset++] = frame->id;
+    offset += __varint_encode(frame->no, buf + offset);
+    if (0 == frame->no) {
+        offset += __varint_encode(frame->total, buf + offset);
+        buf[offset++] = (TUYA_BLE_PROTOCOL_VERSION_HIGN << 0x04);
+    } else {
+        offset += __varint_encode(frame->offset, buf + offset);
+    }
+    memcpy(buf + offset, frame->data, frame->len);
+
+    return offset + frame->len;
+}
+
+/**
+ * @brief Decodes a window subpacket, data points into raw_data.
+ *
+ * @return OPRT_OK on success, OPRT_SVC_BT_API_TRSMITR_ERROR on a malformed frame
+ */
+int ble_wnd_frame_decode(uint8_t *raw_data, uint32_t raw_len, ble_wnd_frame_t *frame)
+{
+    uint32_t offset = 3;
+    uint32_t n;
+
+    if (NULL == raw_data || NULL == frame || raw_len < offset) {
+        return OPRT_SVC_BT_API_TRSMITR_ERROR;
+    }
+
+    memset(frame, 0, sizeof(ble_wnd_frame_t));
+    frame->window = raw_data[0];
+    frame->flag = raw_data[1];
+    frame->id = raw_data[2];
+
+    n = __varint_decode(raw_data + offset, raw_len - offset, &frame->no);
+    if (0 == n || frame->no >= BLE_WND_NO_LMT) {
+        return OPRT_SVC_BT_API_TRSMITR_ERROR;
+    }
+    offset += n;
+
+    if (0 == frame->no) {
+        n = __varint_decode(raw_data + offset, raw_len - offset, &frame->total);
+        if (0 == n || offset + n + 1 > raw_len) {
+            return OPRT_SVC_BT_API_TRSMITR_ERROR;
+        }
+        offset += n + 1; // skip version and reserve
+    } else {
+        n = __varint_decode(raw_data + offset, raw_len - offset, &frame->offset);
+        if (0 == n) {
+            return OPRT_SVC_BT_API_TRSMITR_ERROR;
+        }
+        offset += n;
+    }
+
+    frame->data = raw_data + offset;
+    frame->len = raw_len - offset;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Encodes a window ack with the given channel flag.
+ *
+ * @return BLE_WND_ACK_LEN
+ */
+uint32_t ble_wnd_ack_encode(ble_wnd_ack_t *ack, uint8_t flag, uint8_t *buf)
+{
+    buf[0] = ack->window;
+    buf[1] = flag | BLE_WND_FLAG;
+    buf[2] = BLE_WND_STATUS_ACK;
+    buf[3] = ack->id;
+    buf[4] = ack->expect >> 8;
+    buf[5] = ack->expect;
+    buf[6] = ack->bitmap >> 24;
+    buf[7] = ack->bitmap >> 16;
+    buf[8] = ack->bitmap >> 8;
+    buf[9] = ack->bitmap;
+
+    return BLE_WND_ACK_LEN;
+}
+
+/**
+ * @brief Decodes a window ack.
+ *
+ * @return OPRT_OK on success, OPRT_SVC_BT_API_TRSMITR_ERROR on a malformed ack
+ */
+int ble_wnd_ack_decode(uint8_t *raw_data, uint32_t raw_len, ble_wnd_ack_t *ack)
+{
+    if (NULL == raw_data || NULL == ack || raw_len < BLE_WND_ACK_LEN || BLE_WND_STATUS_ACK != raw_data[2]) {
+        return OPRT_SVC_BT_API_TRSMITR_ERROR;
+    }
+
+    ack->window = raw_data[0];
+    ack->id = raw_data[3];
+    ack->expect = (raw_data[4] << 8) | raw_data[5];
+    ack->bitmap = ((uint32_t)raw_data[6] << 24) | ((uint32_t)raw_data[7] << 16) | ((uint32_t)raw_data[8] << 8) |
+                  raw_data[9];
+
+    return OPRT_OK;
+}
+
+static int __tx_send(ble_wnd_tx_t *tx, uint32_t no, uint32_t now_ms)
+{
+    ble_wnd_frame_t frame;
+    uint32_t offset = no * tx->chunk;
+
+    memset(&frame, 0, sizeof(ble_wnd_frame_t));
+    frame.window = tx->adv_window;
+    frame.flag = 0x03; // need response, subpacket
+    frame.id = tx->id;
+    frame.no = no;
+    frame.offset = offset;
+    frame.total = tx->total;
+    frame.data = tx->data + offset;
+    frame.len = (tx->total - offset < tx->chunk) ? tx->total - offset : tx->chunk;
+
+    tx->sent_seq[WND_IDX(no)] = tx->seq++;
+    tx->sent_ms[WND_IDX(no)] = now_ms;
+
+    return tx->send_cb(&frame, tx->user_data);
+}
+
+static bool __tx_acked(ble_wnd_tx_t *tx, uint32_t no)
+{
+    return (tx->acked >> (no - tx->base)) & 0x01;
+}
+
+static int __tx_fill(ble_wnd_tx_t *tx, uint32_t now_ms)
+{
+    int rt;
+
+    while (tx->next < tx->count && tx->next - tx->base < tx->window) {
+        rt = __tx_send(tx, tx->next, now_ms);
+        if (OPRT_OK != rt) {
+            return rt;
+        }
+        tx->next++;
+    }
+
+    return (tx->base == tx->count) ? OPRT_OK : OPRT_SVC_BT_API_TRSMITR_CONTINUE;
+}
+
+/**
+ * @brief Starts sending a transfer and sends the first window.
+ *
+ * @param tx the sender
+ * @param id transfer id, distinct from the previous transfer
+ * @param data transfer data, kept until the transfer ends
+ * @param len transfer length
+ * @param chunk data bytes per subpacket
+ * @param window subpackets in flight, lowered by the acks of the app
+ * @param rto_ms retransmission timeout
+ * @param send_cb sends a subpacket
+ * @param user_data passed to send_cb
+ * @param now_ms current time
+ *
+ * @return OPRT_SVC_BT_API_TRSMITR_CONTINUE while unacked, an error on failure
+ */
+int ble_wnd_tx_start(ble_wnd_tx_t *tx, uint8_t id, uint8_t *data, uint32_t len, uint32_t chunk, uint8_t window,
+                     uint32_t rto_ms, ble_wnd_send_cb_t send_cb, void *user_data, uint32_t now_ms)
+{
+    if (NULL == tx || NULL == data || 0 == len || 0 == chunk || 0 == window || NULL == send_cb) {
+        return OPRT_INVALID_PARM;
+    }
+
+    memset(tx, 0, sizeof(ble_wnd_tx_t));
+    tx->data = data;
+    tx->total = len;
+    tx->chunk = chunk;
+    tx->count = (len + chunk - 1) / chunk;
+    if (tx->count >= BLE_WND_NO_LMT) {
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+    tx->id = id;
+    tx->window = (window > BLE_WND_LMT) ? BLE_WND_LMT : window;
+    tx->adv_window = tx->window;
+    tx->rto_ms = rto_ms;
+    tx->send_cb = send_cb;
+    tx->user_data = user_data;
+
+    return __tx_fill(tx, now_ms);
+}
+
+/**
+ * @brief Applies an ack, resends the holes it reveals and fills the window.
+ *
+ * @return OPRT_OK once everything is acked, OPRT_SVC_BT_API_TRSMITR_CONTINUE
+ * while unacked, an error on failure
+ */
+int ble_wnd_tx_ack(ble_wnd_tx_t *tx, ble_wnd_ack_t *ack, uint32_t now_ms)
+{
+    uint32_t no, hi_seq = 0, base = tx->base, acked;
+    bool sacked = false;
+    uint8_t i;
+    int rt;
+
+    if (NULL == tx || NULL == ack || NULL == tx->data) {
+        return OPRT_INVALID_PARM;
+    }
+    if (ack->id != tx->id) {
+        return (tx->base == tx->count) ? OPRT_OK : OPRT_SVC_BT_API_TRSMITR_CONTINUE;
+    }
+
+    if (ack->window) {
+        tx->window = (ack->window < tx->adv_window) ? ack->window : tx->adv_window;
+    }
+
+    // cumulative part, a stale ack below base changes nothing
+    if (ack->expect > tx->base && ack->expect <= tx->next) {
+        tx->acked = (ack->expect - tx->base >= BLE_WND_LMT) ? 0 : tx->acked >> (ack->expect - tx->base);
+        tx->base = ack->expect;
+    }
+
+    for (i = 0; i < BLE_WND_LMT; i++) {
+        if (0 == ((ack->bitmap >> i) & 0x01)) {
+            continue;
+        }
+        no = ack->expect + 1 + i;
+        if (no < tx->base || no >= tx->next) {
+            continue;
+        }
+        tx->acked |= (1U << (no - tx->base));
+        if (!sacked || (int32_t)(tx->sent_seq[WND_IDX(no)] - hi_seq) > 0) {
+            hi_seq = tx->sent_seq[WND_IDX(no)];
+            sacked = true;
+        }
+    }
+
+    acked = tx->acked;
+    while (tx->base < tx->next && (tx->acked & 0x01)) {
+        tx->acked >>= 1;
+        tx->base++;
+    }
+    if (tx->base != base || tx->acked != acked || sacked) {
+        tx->stall = 0;
+    }
+
+    // a subpacket sent later got through, the holes sent before it are lost
+    for (no = tx->base; sacked && no < tx->next; no++) {
+        if (__tx_acked(tx, no) || (int32_t)(tx->sent_seq[WND_IDX(no)] - hi_seq) >= 0) {
+            continue;
+        }
+        rt = __tx_send(tx, no, now_ms);
+        if (OPRT_OK != rt) {
+            return rt;
+        }
+    }
+
+    return __tx_fill(tx, now_ms);
+}
+
+/**
+ * @brief Resends the subpackets whose timer ran out.
+ *
+ * @return OPRT_OK once everything is acked, OPRT_SVC_BT_API_TRSMITR_CONTINUE
+ * while unacked, OPRT_TIMEOUT after BT_WND_RETRY_MAX timeouts in a row
+ */
+int ble_wnd_tx_poll(ble_wnd_tx_t *tx, uint32_t now_ms)
+{
+    uint32_t no;
+    bool resend = false;
+    int rt;
+
+    if (NULL == tx || NULL == tx->data) {
+        return OPRT_INVALID_PARM;
+    }
+
+    for (no = tx->base; no < tx->next; no++) {
+        if (__tx_acked(tx, no) || now_ms - tx->sent_ms[WND_IDX(no)] < tx->rto_ms) {
+            continue;
+        }
+        if (!resend && ++tx->stall > BT_WND_RETRY_MAX) {
+            PR_ERR("ble wnd subpacket %u not acked", no);
+            return OPRT_TIMEOUT;
+        }
+        resend = true;
+        rt = __tx_send(tx, no, now_ms);
+        if (OPRT_OK != rt) {
+            return rt;
+        }
+    }
+
+    return __tx_fill(tx, now_ms);
+}
+
+/**
+ * @brief Time until the next retransmission.
+ *
+ * @return the time in ms, 0 if something is due now
+ */
+uint32_t ble_wnd_tx_wait_get(ble_wnd_tx_t *tx, uint32_t now_ms)
+{
+    uint32_t wait = tx->rto_ms;
+    uint32_t no, elapsed;
+
+    for (no = tx->base; no < tx->next; no++) {
+        if (__tx_acked(tx, no)) {
+            continue;
+        }
+        elapsed = now_ms - tx->sent_ms[WND_IDX(no)];
+        if (elapsed >= tx->rto_ms) {
+            return 0;
+        }
+        wait = (tx->rto_ms - elapsed < wait) ? tx->rto_ms - elapsed : wait;
+    }
+
+    return wait;
+}
+
+/**
+ * @brief Prepares a receiver.
+ *
+ * @param rx the receiver
+ * @param window receive window advertised in the acks
+ */
+void ble_wnd_rx_init(ble_wnd_rx_t *rx, uint8_t window)
+{
+    memset(rx, 0, sizeof(ble_wnd_rx_t));
+    rx->window = (window > BLE_WND_LMT) ? BLE_WND_LMT : window;
+}
+
+/**
+ * @brief Places a received subpacket.
+ *
+ * Subpacket 0 of a new transfer id starts a new transfer and allocates its
+ * buffer, other subpackets of an unknown transfer are dropped until it
+ * arrives.
+ *
+ * @param rx the receiver
+ * @param frame the decoded subpacket
+ * @param ack_now set when an ack should be sent now
+ *
+ * @return OPRT_OK when the transfer got complete, the data is in rx->buf,
+ * OPRT_SVC_BT_API_TRSMITR_CONTINUE otherwise, an error on a bad subpacket
+ */
+int ble_wnd_rx_put(ble_wnd_rx_t *rx, ble_wnd_frame_t *frame, bool *ack_now)
+{
+    bool gap;
+    uint32_t d;
+
+    *ack_now = false;
+
+    if (!rx->active || frame->id != rx->id) {
+        if (0 != frame->no) {
+            return OPRT_SVC_BT_API_TRSMITR_CONTINUE;
+        }
+        if (0 == frame->total) {
+            return OPRT_SVC_BT_API_TRSMITR_ERROR;
+        }
+        ble_wnd_rx_release(rx);
+        rx->buf = tal_malloc(frame->total);
+        if (NULL == rx->buf) {
+            PR_ERR("malloc err:%u", frame->total);
+            rx->active = false;
+            return OPRT_MALLOC_FAILED;
+        }
+        rx->id = frame->id;
+        rx->total = frame->total;
+        rx->recv_len = 0;
+        rx->expect = 0;
+        rx->got = 0;
+        rx->unacked = 0;
+        rx->active = true;
+        rx->done = false;
+    }
+
+    // duplicate or out of the window, the ack tells the sender where we are
+    d = frame->no - rx->expect;
+    if (rx->done || frame->no < rx->expect || d >= BLE_WND_LMT || ((rx->got >> d) & 0x01)) {
+        *ack_now = true;
+        return OPRT_SVC_BT_API_TRSMITR_CONTINUE;
+    }
+
+    if (frame->offset > rx->total || frame->len > rx->total - frame->offset || 0 == frame->len) {
+        return OPRT_SVC_BT_API_TRSMITR_ERROR;
+    }
+
+    memcpy(rx->buf + frame->offset, frame->data, frame->len);
+    rx->recv_len += frame->len;
+    gap = (0 != rx->got);
+    rx->got |= (1U << d);
+    while (rx->got & 0x01) {
+        rx->got >>= 1;
+        rx->expect++;
+    }
+    rx->unacked++;
+
+    if (rx->recv_len >= rx->total) {
+        rx->done = true;
+        *ack_now = true;
+        return OPRT_OK;
+    }
+
+    // a resend filling a gap is acked at once, the sender may have nothing else to send
+    if (gap || rx->got || rx->unacked >= (rx->window + 1) / 2) {
+        *ack_now = true;
+    }
+
+    return OPRT_SVC_BT_API_TRSMITR_CONTINUE;
+}
+
+/**
+ * @brief Gets the ack of the receiver state.
+ */
+void ble_wnd_rx_ack_get(ble_wnd_rx_t *rx, ble_wnd_ack_t *ack)
+{
+    ack->window = rx->window;
+    ack->id = rx->id;
+    ack->expect = rx->expect;
+    ack->bitmap = rx->got >> 1;
+    rx->unacked = 0;
+}
+
+/**
+ * @brief Frees the buffer of the receiver.
+ */
+void ble_wnd_rx_release(ble_wnd_rx_t *rx)
+{
+    if (rx->buf) {
+        tal_free(rx->buf);
+        rx->buf = NULL;
+    }
+}
@@ -0,0 +1,246 @@
+/**
+ * @file ble_window.h
+ * @brief Sliding window transport for the BLE transparent channel.
+ *
+ * The serial channel sends one subpacket and waits for the app to ack it
+ * before the next one. The window transport keeps several subpackets in
+ * flight: every subpacket carries its transfer id and data offset, so it can
+ * be placed wherever it lands, and the receiver answers with its next
+ * expected subpacket plus a bitmap of the ones received beyond it. The sender
+ * resends a hole as soon as a subpacket sent after it is acked, and anything
+ * still unacked when its timer runs out.
+ *
+ * It is used only when the app sets BLE_WND_FLAG in the channel flag,
+ * otherwise the channel keeps the serial framing. The state machines take the
+ * time from the caller and send through a callback, so they do not depend on
+ * the BLE stack.
+ *
+ * Window subpacket, after the 2 bytes channel flag:
+ *   [id 1B][no varint][offset varint, no > 0][total varint + version 1B, no == 0][data]
+ * Window ack, status BLE_WND_STATUS_ACK:
+ *   [flag 2B][status 1B][id 1B][expect 2B][bitmap 4B], bit i of bitmap is expect + 1 + i
+ * The first flag byte carries the receive window of the side sending it.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __BLE_WINDOW_H__
+#define __BLE_WINDOW_H__
+
+#include "tuya_cloud_types.h"
+#include "tuya_error_code.h"
+#include "ble_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#ifndef BT_WND_MAX
+#define BT_WND_MAX 8 // subpackets in flight
+#endif
+
+#ifndef BT_WND_INFLIGHT_BYTES
+#define BT_WND_INFLIGHT_BYTES 4096 // bytes in flight
+#endif
+
+#ifndef BT_WND_RTO_MS
+#define BT_WND_RTO_MS 600 // retransmission timeout
+#endif
+
+#ifndef BT_WND_RETRY_MAX
+#define BT_WND_RETRY_MAX 5 // timeouts in a row without any ack before the transfer fails
+#endif
+
+#define BLE_WND_LMT        32   // bits of the ack bitmap
+#define BLE_WND_FLAG       0x04 // channel flag bit2: window transport
+#define BLE_WND_STATUS_ACK 4    // channel ack status of a window ack
+#define BLE_WND_HDR_MAX    12   // largest subpacket header, channel flag included
+#define BLE_WND_ACK_LEN    10
+#define BLE_WND_NO_LMT     0xFFFF
+#define BLE_WND_MTU_PKTS   4 // air packets per subpacket
+
+typedef struct {
+    uint8_t window;  // receive window of the sender of the frame, 0 if not given
+    uint8_t flag;    // channel flag bits
+    uint8_t id;      // transfer id
+    uint32_t no;     // subpacket number
+    uint32_t offset; // data offset in the transfer
+    uint32_t total;  // transfer length, only valid in subpacket 0
+    uint8_t *data;
+    uint32_t len;
+} ble_wnd_frame_t;
+
+typedef struct {
+    uint8_t window;
+    uint8_t id;
+    uint16_t expect; // every subpacket below it was received
+    uint32_t bitmap; // bit i: subpacket expect + 1 + i was received
+} ble_wnd_ack_t;
+
+/**
+ * @brief Sends a subpacket, the frame is only valid during the call
+ */
+typedef int (*ble_wnd_send_cb_t)(ble_wnd_frame_t *frame, void *user_data);
+
+typedef struct {
+    uint8_t *data;
+    uint32_t total;
+    uint32_t chunk;
+    uint32_t count;
+    uint8_t id;
+    uint8_t window;
+    uint8_t adv_window;
+    uint32_t rto_ms;
+    uint32_t base;   // oldest subpacket not acked
+    uint32_t next;   // next subpacket never sent
+    uint32_t acked;  // bit i: subpacket base + i acked
+    uint32_t seq;    // send order
+    uint32_t sent_seq[BLE_WND_LMT];
+    uint32_t sent_ms[BLE_WND_LMT];
+    uint8_t stall; // timeouts since the last ack that acked something
+    ble_wnd_send_cb_t send_cb;
+    void *user_data;
+} ble_wnd_tx_t;
+
+typedef struct {
+    uint8_t *buf;
+    uint32_t total;
+    uint32_t recv_len;
+    uint32_t expect;
+    uint32_t got; // bit i: subpacket expect + i received
+    uint8_t id;
+    uint8_t window;
+    uint8_t unacked;
+    bool active;
+    bool done;
+} ble_wnd_rx_t;
+
+/***********************************************************
+*************************function define********************
+***********************************************************/
+/**
+ * @brief Derives the subpacket size and the window from the packet length
+ * negotiated with the app.
+ *
+ * @param mtu packet length of the link
+ * @param chunk data bytes per subpacket
+ * @param window subpackets in flight
+ */
+void ble_wnd_param_get(uint16_t mtu, uint32_t *chunk, uint8_t *window);
+
+/**
+ * @brief Encodes a window subpacket, channel flag included.
+ *
+ * @param frame the subpacket
+ * @param buf output buffer of at least BLE_WND_HDR_MAX + frame->len bytes
+ *
+ * @return the encoded length
+ */
+uint32_t ble_wnd_frame_encode(ble_wnd_frame_t *frame, uint8_t *buf);
+
+/**
+ * @brief Decodes a window subpacket, data points into raw_data.
+ *
+ * @return OPRT_OK on success, OPRT_SVC_BT_API_TRSMITR_ERROR on a malformed frame
+ */
+int ble_wnd_frame_decode(uint8_t *raw_data, uint32_t raw_len, ble_wnd_frame_t *frame);
+
+/**
+ * @brief Encodes a window ack with the given channel flag.
+ *
+ * @return BLE_WND_ACK_LEN
+ */
+uint32_t ble_wnd_ack_encode(ble_wnd_ack_t *ack, uint8_t flag, uint8_t *buf);
+
+/**
+ * @brief Decodes a window ack.
+ *
+ * @return OPRT_OK on success, OPRT_SVC_BT_API_TRSMITR_ERROR on a malformed ack
+ */
+int ble_wnd_ack_decode(uint8_t *raw_data, uint32_t raw_len, ble_wnd_ack_t *ack);
+
+/**
+ * @brief Starts sending a transfer and sends the first window.
+ *
+ * @param tx the sender
+ * @param id transfer id, distinct from the previous transfer
+ * @param data transfer data, kept until the transfer ends
+ * @param len transfer length
+ * @param chunk data bytes per subpacket
+ * @param window subpackets in flight, lowered by the acks of the app
+ * @param rto_ms retransmission timeout
+ * @param send_cb sends a subpacket
+ * @param user_data passed to send_cb
+ * @param now_ms current time
+ *
+ * @return OPRT_SVC_BT_API_TRSMITR_CONTINUE while unacked, an error on failure
+ */
+int ble_wnd_tx_start(ble_wnd_tx_t *tx, uint8_t id, uint8_t *data, uint32_t len, uint32_t chunk, uint8_t window,
+                     uint32_t rto_ms, ble_wnd_send_cb_t send_cb, void *user_data, uint32_t now_ms);
+
+/**
+ * @brief Applies an ack, resends the holes it reveals and fills the window.
+ *
+ * @return OPRT_OK once everything is acked, OPRT_SVC_BT_API_TRSMITR_CONTINUE
+ * while unacked, an error on failure
+ */
+int ble_wnd_tx_ack(ble_wnd_tx_t *tx, ble_wnd_ack_t *ack, uint32_t now_ms);
+
+/**
+ * @brief Resends the subpackets whose timer ran out.
+ *
+ * @return OPRT_OK once everything is acked, OPRT_SVC_BT_API_TRSMITR_CONTINUE
+ * while unacked, OPRT_TIMEOUT after BT_WND_RETRY_MAX timeouts in a row
+ */
+int ble_wnd_tx_poll(ble_wnd_tx_t *tx, uint32_t now_ms);
+
+/**
+ * @brief Time until the next retransmission.
+ *
+ * @return the time in ms, 0 if something is due now
+ */
+uint32_t ble_wnd_tx_wait_get(ble_wnd_tx_t *tx, uint32_t now_ms);
+
+/**
+ * @brief Prepares a receiver, its buffer must have been released.
+ *
+ * @param rx the receiver
+ * @param window receive window advertised in the acks
+ */
+void ble_wnd_rx_init(ble_wnd_rx_t *rx, uint8_t window);
+
+/**
+ * @brief Places a received subpacket.
+ *
+ * Subpacket 0 of a new transfer id starts a new transfer and allocates its
+ * buffer, other subpackets of an unknown transfer are dropped until it
+ * arrives.
+ *
+ * @param rx the receiver
+ * @param frame the decoded subpacket
+ * @param ack_now set when an ack should be sent now
+ *
+ * @return OPRT_OK when the transfer got complete, the data is in rx->buf,
+ * OPRT_SVC_BT_API_TRSMITR_CONTINUE otherwise, an error on a bad subpacket
+ */
+int ble_wnd_rx_put(ble_wnd_rx_t *rx, ble_wnd_frame_t *frame, bool *ack_now);
+
+/**
+ * @brief Gets the ack of the receiver state.
+ */
+void ble_wnd_rx_ack_get(ble_wnd_rx_t *rx, ble_wnd_ack_t *ack);
+
+/**
+ * @brief Frees the buffer of the receiver.
+ */
+void ble_wnd_rx_release(ble_wnd_rx_t *rx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLE_WINDOW_H__ */
@@ -21,25 +21,12 @@
 
 #include "tuya_cloud_types.h"
 #include "cJSON.h"
+#include "atop_codec.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-typedef struct {
-    const char *path;
-    const char *key;
-    const char *header;
-    const char *api;
-    const char *version;
-    const char *uuid;
-    const char *devid;
-    uint32_t timestamp;
-    void *data;
-    size_t datalen;
-    const void *user_data;
-} atop_base_request_t;
-
 typedef struct {
     bool success;
     cJSON *result;
@@ -56,6 +43,10 @@ typedef struct {
  * request data. The response data will be stored in the provided response
  * structure.
  *
+ * The request is encoded and the response decoded by atop_codec_request, the
+ * result is then parsed into a cJSON tree. Callers that only read a few fields
+ * should use atop_codec_request directly and spare the tree.
+ *
  * @param request Pointer to the `atop_base_request_t` structure containing the
  * request data.
  * @param response Pointer to the `atop_base_response_t` structure to store the
@@ -0,0 +1,467 @@
+/**
+ * @file atop_codec.c
+ * @brief Allocation-free encoding and decoding of ATOP requests.
+ *
+ * The arena holds the URL, then the body. The body is encrypted into the tail
+ * of its region and hex-expanded forward over itself: the hex of byte i ends
+ * before byte i + 1, so no second buffer is needed. The URL signature is an
+ * MD5 streamed over the parameters rather than over a joined copy of them.
+ *
+ * In the response, the base64 of the "result" string is decoded over itself,
+ * and the GCM plaintext is written over the ciphertext it comes from, both
+ * only ever write behind what they read. The decoded JSON is read with
+ * json_cursor_t. A response whose result is not encrypted is read as it is.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "atop_codec.h"
+#include "tuya_config_defaults.h"
+#include "tuya_endpoint.h"
+#include "tal_log.h"
+#include "tal_symmetry.h"
+#include "mbedtls/md5.h"
+#include "uni_random.h"
+
+#define MD5SUM_LENGTH    (16)
+#define POST_DATA_PREFIX "data="
+#define ATOP_PARAM_MAX   (6)
+#define ATOP_KEY_LEN     (16)
+
+typedef struct {
+    const char *key;
+    const char *value;
+} url_param_t;
+
+// the GCM key of the last request, kept set up for the next one. A request
+// that finds it in use by another one sets up its own.
+static struct {
+    uint8_t busy;
+    uint8_t key[ATOP_KEY_LEN];
+    tal_aes_key_t *gcm_key;
+} s_atop_key;
+
+static tal_aes_key_t *atop_codec_key_get(const char *key, bool *cached)
+{
+    tal_aes_key_t *gcm_key = NULL;
+
+    *cached = !__atomic_exchange_n(&s_atop_key.busy, 1, __ATOMIC_ACQUIRE);
+    if (!*cached) {
+        tal_aes_key_create(TAL_AES_GCM, SYMMETRY_ENCRYPT, (const uint8_t *)key, 128, &gcm_key);
+        return gcm_key;
+    }
+
+    if (s_atop_key.gcm_key && 0 == memcmp(s_atop_key.key, key, ATOP_KEY_LEN)) {
+        return s_atop_key.gcm_key;
+    }
+    tal_aes_key_free(s_atop_key.gcm_key);
+    s_atop_key.gcm_key = NULL;
+    if (OPRT_OK != tal_aes_key_create(TAL_AES_GCM, SYMMETRY_ENCRYPT, (const uint8_t *)key, 128, &s_atop_key.gcm_key)) {
+        s_atop_key.gcm_key = NULL;
+        __atomic_store_n(&s_atop_key.busy, 0, __ATOMIC_RELEASE);
+        return NULL;
+    }
+    memcpy(s_atop_key.key, key, ATOP_KEY_LEN);
+
+    return s_atop_key.gcm_key;
+}
+
+static void atop_codec_key_put(tal_aes_key_t *gcm_key, bool cached)
+{
+    if (cached) {
+        __atomic_store_n(&s_atop_key.busy, 0, __ATOMIC_RELEASE);
+    } else {
+        tal_aes_key_free(gcm_key);
+    }
+}
+
+void atop_codec_key_release(void)
+{
+    // a request holding the key keeps it, it is replaced at the next key change
+    if (__atomic_exchange_n(&s_atop_key.busy, 1, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    tal_aes_key_free(s_atop_key.gcm_key);
+    s_atop_key.gcm_key = NULL;
+    memset(s_atop_key.key, 0, sizeof(s_atop_key.key));
+    __atomic_store_n(&s_atop_key.busy, 0, __ATOMIC_RELEASE);
+}
+
+static int atop_codec_printf(char *out, size_t size, size_t *len, const char *fmt, ...)
+{
+    va_list args;
+    int ret;
+
+    va_start(args, fmt);
+    ret = vsnprintf(out + *len, size - *len, fmt, args);
+    va_end(args);
+    if (ret < 0 || (size_t)ret >= size - *len) {
+        return OPRT_BUFFER_NOT_ENOUGH;
+    }
+    *len += ret;
+
+    return OPRT_OK;
+}
+
+static int atop_codec_url_sign(const char *key, const url_param_t *params, int param_num, char *out, size_t size,
+                               size_t *len)
+{
+    mbedtls_md5_context md5;
+    uint8_t digest[MD5SUM_LENGTH];
+    int rt = OPRT_OK;
+    int i;
+
+    // md5 of "key=value||" of every param followed by the device key
+    mbedtls_md5_init(&md5);
+    mbedtls_md5_starts(&md5);
+    for (i = 0; i < param_num; i++) {
+        mbedtls_md5_update(&md5, (const uint8_t *)params[i].key, strlen(params[i].key));
+        mbedtls_md5_update(&md5, (const uint8_t *)"=", 1);
+        mbedtls_md5_update(&md5, (const uint8_t *)params[i].value, strlen(params[i].value));
+        mbedtls_md5_update(&md5, (const uint8_t *)"||", 2);
+    }
+    mbedtls_md5_update(&md5, (const uint8_t *)key, strlen(key));
+    mbedtls_md5_finish(&md5, digest);
+    mbedtls_md5_free(&md5);
+
+    for (i = 0; i < MD5SUM_LENGTH && OPRT_OK == rt; i++) {
+        rt = atop_codec_printf(out, size, len, "%02x", digest[i]);
+    }
+
+    return rt;
+}
+
+static int atop_codec_url_encode(const atop_base_request_t *request, char *out, size_t size)
+{
+    url_param_t params[ATOP_PARAM_MAX];
+    char ts_str[11];
+    size_t len = 0;
+    int rt = OPRT_OK;
+    int idx = 0;
+    int i;
+
+    params[idx].key = "a";
+    params[idx++].value = request->api;
+    if (request->devid) {
+        params[idx].key = "devId";
+        params[idx++].value = request->devid;
+    }
+    params[idx].key = "et";
+    params[idx++].value = "3";
+    sprintf(ts_str, "%d", request->timestamp);
+    params[idx].key = "t";
+    params[idx++].value = ts_str;
+    if (request->uuid) {
+        params[idx].key = "uuid";
+        params[idx++].value = request->uuid;
+    }
+    if (request->version) {
+        params[idx].key = "v";
+        params[idx++].value = request->version;
+    }
+
+    rt = atop_codec_printf(out, size, &len, "%s?", request->path);
+    for (i = 0; i < idx && OPRT_OK == rt; i++) {
+        rt = atop_codec_printf(out, size, &len, "%s=%s&", params[i].key, params[i].value);
+    }
+    if (OPRT_OK == rt) {
+        rt = atop_codec_printf(out, size, &len, "sign=");
+    }
+    if (OPRT_OK == rt) {
+        rt = atop_codec_url_sign(request->key, params, idx, out, size, &len);
+    }
+    if (OPRT_OK != rt) {
+        PR_ERR("url of %s longer than %d", request->api, (int)size - 1);
+    }
+
+    return rt;
+}
+
+static int atop_codec_body_encode(tal_aes_key_t *gcm_key, const uint8_t *input, size_t ilen, uint8_t *out,
+                                  size_t size, size_t *olen)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    size_t raw_len = ATOP_CODEC_NONCE_LEN + ilen + ATOP_CODEC_TAG_LEN;
+    size_t prefix_len = strlen(POST_DATA_PREFIX);
+    uint8_t *raw = NULL;
+    int rt = OPRT_OK;
+    size_t i;
+
+    if (size < prefix_len + raw_len * 2 + 1) {
+        return OPRT_BUFFER_NOT_ENOUGH;
+    }
+
+    // nonce, ciphertext and tag at the tail of the region, then hex-expanded forward
+    raw = out + size - raw_len;
+    uni_random_string((char *)raw, ATOP_CODEC_NONCE_LEN);
+
+    rt = tal_aes_key_gcm_encrypt(gcm_key, raw, ATOP_CODEC_NONCE_LEN, NULL, 0, input, ilen, raw + ATOP_CODEC_NONCE_LEN,
+                                 raw + ATOP_CODEC_NONCE_LEN + ilen, ATOP_CODEC_TAG_LEN);
+    if (OPRT_OK != rt) {
+        PR_ERR("tal_aes_key_gcm_encrypt:%d", rt);
+        return rt;
+    }
+
+    memcpy(out, POST_DATA_PREFIX, prefix_len);
+    for (i = 0; i < raw_len; i++) {
+        uint8_t byte = raw[i];
+        out[prefix_len + i * 2] = hex[byte >> 4];
+        out[prefix_len + i * 2 + 1] = hex[byte & 0x0F];
+    }
+    out[prefix_len + raw_len * 2] = '\0';
+    *olen = prefix_len + raw_len * 2;
+
+    return rt;
+}
+
+static int atop_codec_base64_value(char c)
+{
+    if (c >= 'A' && c <= 'Z') {
+        return c - 'A';
+    }
+    if (c >= 'a' && c <= 'z') {
+        return c - 'a' + 26;
+    }
+    if (c >= '0' && c <= '9') {
+        return c - '0' + 52;
+    }
+    if ('+' == c) {
+        return 62;
+    }
+    if ('/' == c) {
+        return 63;
+    }
+
+    return -1;
+}
+
+// decodes over the text, the JSON escape of '/' is skipped. Nothing is
+// written unless the whole text is valid base64.
+static int atop_codec_base64_decode(char *text, size_t len, size_t *olen)
+{
+    uint32_t acc = 0, bits = 0;
+    size_t digits = 0, pads = 0, out = 0, i;
+    int value;
+
+    for (i = 0; i < len; i++) {
+        if ('\\' == text[i]) {
+            continue;
+        }
+        if ('=' == text[i]) {
+            pads++;
+            continue;
+        }
+        if (pads || atop_codec_base64_value(text[i]) < 0) {
+            return OPRT_INVALID_PARM;
+        }
+        digits++;
+    }
+    if (0 != (digits + pads) % 4 || pads > 2) {
+        return OPRT_INVALID_PARM;
+    }
+
+    for (i = 0; i < len && '=' != text[i]; i++) {
+        value = atop_codec_base64_value(text[i]);
+        if (value < 0) {
+            continue;
+        }
+        acc = (acc << 6) | value;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            text[out++] = (char)(acc >> bits);
+        }
+    }
+    *olen = out;
+
+    return OPRT_OK;
+}
+
+// decrypts the "result" of the response over itself, returns the plaintext
+static int atop_codec_result_decrypt(tal_aes_key_t *gcm_key, char *text, size_t len, char **plain,
+                                     size_t *plain_len)
+{
+    json_cursor_t root, result;
+    uint8_t *raw = NULL;
+    size_t raw_len = 0;
+    int rt = OPRT_OK;
+
+    if (0 != json_cursor_init(&root, text, len) || 0 != json_cursor_get(&root, "result", &result) ||
+        JSON_CURSOR_STRING != result.type) {
+        return OPRT_CJSON_GET_ERR;
+    }
+
+    raw = (uint8_t *)result.json + 1;
+    rt = atop_codec_base64_decode((char *)raw, result.len - 2, &raw_len);
+    if (OPRT_OK != rt || raw_len <= ATOP_CODEC_NONCE_LEN + ATOP_CODEC_TAG_LEN) {
+        return OPRT_INVALID_PARM;
+    }
+    raw_len -= ATOP_CODEC_NONCE_LEN + ATOP_CODEC_TAG_LEN;
+
+    rt = tal_aes_key_gcm_decrypt(gcm_key, raw, ATOP_CODEC_NONCE_LEN, NULL, 0, raw + ATOP_CODEC_NONCE_LEN, raw_len,
+                                 raw + ATOP_CODEC_NONCE_LEN, raw + ATOP_CODEC_NONCE_LEN + raw_len, ATOP_CODEC_TAG_LEN);
+    if (OPRT_OK != rt) {
+        PR_ERR("tal_aes_key_gcm_decrypt:%d", rt);
+        return OPRT_COM_ERROR;
+    }
+
+    // the tag is not needed any more, it makes room for the NUL
+    raw[ATOP_CODEC_NONCE_LEN + raw_len] = '\0';
+    *plain = (char *)raw + ATOP_CODEC_NONCE_LEN;
+    *plain_len = raw_len;
+
+    return OPRT_OK;
+}
+
+static int atop_codec_result_parse(const char *text, size_t len, atop_codec_response_t *response)
+{
+    json_cursor_t root, item;
+
+    if (0 != json_cursor_init(&root, text, len) || JSON_CURSOR_OBJECT != root.type) {
+        PR_ERR("Json parse error");
+        return OPRT_CJSON_PARSE_ERR;
+    }
+
+    if (0 != json_cursor_get(&root, "success", &item)) {
+        PR_ERR("not found json success key");
+        return OPRT_CJSON_GET_ERR;
+    }
+    response->success = json_cursor_is_true(&item);
+
+    // sync timestamp
+    if (0 == json_cursor_get(&root, "t", &item)) {
+        json_cursor_int(&item, &response->t);
+    }
+
+    if (response->success) {
+        json_cursor_get(&root, "result", &response->result);
+        return OPRT_OK;
+    }
+
+    // error msg dump
+    if (0 == json_cursor_get(&root, "errorMsg", &item)) {
+        PR_ERR("errorMsg:%.*s", (int)item.len, item.json);
+    }
+
+    if (0 != json_cursor_get(&root, "errorCode", &response->error_code)) {
+        return OPRT_COM_ERROR;
+    }
+
+    if (json_cursor_string_equal(&response->error_code, "GATEWAY_NOT_EXISTS", true)) {
+        return OPRT_LINK_CORE_HTTP_GW_NOT_EXIST;
+    }
+
+    return OPRT_OK;
+}
+
+int atop_codec_request(const atop_base_request_t *request, uint8_t *arena, size_t arena_size,
+                       atop_codec_response_t *response)
+{
+    if (NULL == response) {
+        return OPRT_INVALID_PARM;
+    }
+    memset(response, 0, sizeof(atop_codec_response_t));
+
+    if (NULL == request || NULL == request->key || NULL == request->data || 0 == request->datalen || NULL == arena) {
+        return OPRT_INVALID_PARM;
+    }
+
+    int rt = OPRT_OK;
+    http_client_status_t http_status;
+    tal_aes_key_t *gcm_key = NULL;
+    bool key_cached = false;
+    char *path = (char *)arena;
+    uint8_t *body = arena + ATOP_CODEC_URL_MAX + 1;
+    size_t body_length = 0;
+    char *text = NULL;
+    size_t text_len = 0;
+
+    response->user_data = request->user_data;
+
+    if (arena_size < ATOP_CODEC_ARENA_SIZE(request->datalen)) {
+        PR_ERR("arena %d < %d", (int)arena_size, (int)ATOP_CODEC_ARENA_SIZE(request->datalen));
+        return OPRT_BUFFER_NOT_ENOUGH;
+    }
+
+    rt = atop_codec_url_encode(request, path, ATOP_CODEC_URL_MAX + 1);
+    if (rt != OPRT_OK) {
+        return rt;
+    }
+    PR_DEBUG("request url: %s", path);
+
+    // the body and the result share one key set up, usually by an earlier request
+    gcm_key = atop_codec_key_get(request->key, &key_cached);
+    if (NULL == gcm_key) {
+        PR_ERR("atop key setup error");
+        return OPRT_COM_ERROR;
+    }
+
+    rt = atop_codec_body_encode(gcm_key, request->data, request->datalen, body, arena_size - (ATOP_CODEC_URL_MAX + 1),
+                                &body_length);
+    if (rt != OPRT_OK) {
+        PR_ERR("atop_codec_body_encode error:%d", rt);
+        goto __exit;
+    }
+
+    /* HTTP headers */
+    http_client_header_t headers[] = {
+        {.key = "User-Agent", .value = "TUYA_IOT_SDK"},
+        {.key = "Content-Type", .value = "application/x-www-form-urlencoded;charset=UTF-8"},
+    };
+
+    const tuya_endpoint_t *endpoint = tuya_endpoint_get();
+    http_status = http_client_request(&(const http_client_request_t){.cacert = endpoint->cert,
+                                                                     .cacert_len = endpoint->cert_len,
+                                                                     .host = endpoint->atop.host,
+                                                                     .port = endpoint->atop.port,
+                                                                     .method = "POST",
+                                                                     .path = path,
+                                                                     .headers = headers,
+                                                                     .headers_count = CNTSOF(headers),
+                                                                     .body = body,
+                                                                     .body_length = body_length,
+                                                                     .timeout_ms = HTTP_TIMEOUT_MS_DEFAULT},
+                                      &response->http);
+    if (HTTP_CLIENT_SUCCESS != http_status) {
+        PR_ERR("http_request_send error:%d", http_status);
+        rt = OPRT_LINK_CORE_HTTP_CLIENT_SEND_ERROR;
+        goto __exit;
+    }
+
+    text = (char *)response->http.body;
+    text_len = response->http.body_length;
+    rt = atop_codec_result_decrypt(gcm_key, text, text_len, &text, &text_len);
+    if (OPRT_COM_ERROR == rt) {
+        // the result was overwritten, the response cannot be read as it is either
+        goto __exit;
+    }
+    if (OPRT_OK != rt) {
+        PR_NOTICE("atop result not encrypted, parse the plaintext data.");
+    } else {
+        PR_DEBUG("result:\r\n%.*s", (int)text_len, text);
+    }
+
+    rt = atop_codec_result_parse(text, text_len, response);
+
+__exit:
+    atop_codec_key_put(gcm_key, key_cached);
+    return rt;
+}
+
+void atop_codec_response_free(atop_codec_response_t *response)
+{
+    if (NULL == response) {
+        return;
+    }
+
+    if (response->http.buffer || response->http.body) {
+        http_client_free(&response->http);
+    }
+    memset(&response->http, 0, sizeof(http_client_response_t));
+    response->result.type = JSON_CURSOR_NONE;
+    response->error_code.type = JSON_CURSOR_NONE;
+}
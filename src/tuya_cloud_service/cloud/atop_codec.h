@@ -0,0 +1,100 @@
+/**
+ * @file atop_codec.h
+ * @brief Allocation-free encoding and decoding of ATOP requests.
+ *
+ * The request path with its signed URL parameters and the encrypted,
+ * hex-encoded body are built in an arena the caller provides, typically on
+ * the stack, ATOP_CODEC_ARENA_SIZE() bytes for a payload of a given length.
+ * The response is base64 decoded and decrypted where the HTTP client received
+ * it, and its fields are read through json_cursor_t views into that buffer
+ * instead of a cJSON tree.
+ *
+ * atop_base_request is built on this and parses the result with cJSON for the
+ * callers that need a tree.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __ATOP_CODEC_H__
+#define __ATOP_CODEC_H__
+
+#include "tuya_cloud_types.h"
+#include "http_client_interface.h"
+#include "json_cursor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ATOP_CODEC_URL_MAX   (255)
+#define ATOP_CODEC_NONCE_LEN (12)
+#define ATOP_CODEC_TAG_LEN   (16)
+
+/* arena bytes a request with a payload of datalen bytes needs: the URL, then
+ * 'data=' and the hex of nonce, ciphertext and tag */
+#define ATOP_CODEC_ARENA_SIZE(datalen)                                                                                 \
+    (ATOP_CODEC_URL_MAX + 1 + 5 + ((datalen) + ATOP_CODEC_NONCE_LEN + ATOP_CODEC_TAG_LEN) * 2 + 1)
+
+typedef struct {
+    const char *path;
+    const char *key;
+    const char *header;
+    const char *api;
+    const char *version;
+    const char *uuid;
+    const char *devid;
+    uint32_t timestamp;
+    void *data;
+    size_t datalen;
+    const void *user_data;
+} atop_base_request_t;
+
+typedef struct {
+    bool success;
+    int32_t t;
+    json_cursor_t result;     // "result" when success, JSON_CURSOR_NONE if absent
+    json_cursor_t error_code; // "errorCode" when not
+    const void *user_data;
+    http_client_response_t http; // holds the text the cursors point into
+} atop_codec_response_t;
+
+/**
+ * @brief Sends an ATOP request and decodes the response in place.
+ *
+ * @param[in] request: the request
+ * @param[in] arena: scratch memory for the URL and the encoded body, it is
+ * free again when the function returns
+ * @param[in] arena_size: at least ATOP_CODEC_ARENA_SIZE(request->datalen)
+ * @param[out] response: the response, released with atop_codec_response_free
+ * even when an error is returned
+ *
+ * @return OPRT_OK when a response was decoded, whether it reports success or
+ * not, OPRT_LINK_CORE_HTTP_GW_NOT_EXIST if the device was removed from the
+ * cloud, other codes on error
+ */
+int atop_codec_request(const atop_base_request_t *request, uint8_t *arena, size_t arena_size,
+                       atop_codec_response_t *response);
+
+/**
+ * @brief Releases the buffer of a response, its cursors are invalid then.
+ *
+ * @param[in] response: the response
+ *
+ * @return none
+ */
+void atop_codec_response_free(atop_codec_response_t *response);
+
+/**
+ * @brief Releases the key set up by the last request and kept for the next
+ * one, when the device leaves its keys.
+ *
+ * @return none
+ */
+void atop_codec_key_release(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ATOP_CODEC_H__ */
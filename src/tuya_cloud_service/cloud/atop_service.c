@@ -32,6 +32,52 @@
 #define CD_VER        "1.0.0"
 #define ATTRIBUTE_OTA (11)
 
+/**
+ * @brief Sends a request whose response is only checked for success.
+ *
+ * No cJSON tree is built for the result, and the codec arena is taken from
+ * the stack for payloads up to ATOP_DEFAULT_POST_BUFFER_LEN bytes.
+ *
+ * @param request The request to send.
+ * @return Returns OPRT_OK if the cloud reported success, OPRT_COM_ERROR if it
+ * did not, otherwise the error code of the request.
+ */
+static int atop_service_request_check(const atop_base_request_t *request)
+{
+    int rt = OPRT_OK;
+    uint8_t stack_arena[ATOP_CODEC_ARENA_SIZE(ATOP_DEFAULT_POST_BUFFER_LEN)];
+    uint8_t *arena = stack_arena;
+    size_t arena_size = sizeof(stack_arena);
+    atop_codec_response_t response;
+
+    if (ATOP_CODEC_ARENA_SIZE(request->datalen) > arena_size) {
+        arena_size = ATOP_CODEC_ARENA_SIZE(request->datalen);
+        arena = tal_malloc(arena_size);
+        if (NULL == arena) {
+            return OPRT_MALLOC_FAILED;
+        }
+    }
+
+    rt = atop_codec_request(request, arena, arena_size, &response);
+    if (arena != stack_arena) {
+        tal_free(arena);
+    }
+
+    bool success = response.success;
+    atop_codec_response_free(&response);
+
+    if (OPRT_OK != rt) {
+        PR_ERR("atop_codec_request error:%d", rt);
+        return rt;
+    }
+
+    if (success == false) {
+        return OPRT_COM_ERROR;
+    }
+
+    return rt;
+}
+
 /**
  * @brief Sends an activate request to the ATOP service.
  *
@@ -196,24 +242,10 @@ int atop_service_client_reset(const char *id, const char *key)
                                         .datalen = buffer_len,
                                         .user_data = NULL};
 
-    atop_base_response_t response = {0};
-
     /* ATOP service request send */
-    rt = atop_base_request(&atop_request, &response);
+    rt = atop_service_request_check(&atop_request);
     tal_free(buffer);
 
-    bool success = response.success;
-    atop_base_response_free(&response);
-
-    if (OPRT_OK != rt) {
-        PR_ERR("atop_base_request error:%d", rt);
-        return rt;
-    }
-
-    if (success == false) {
-        return OPRT_COM_ERROR;
-    }
-
     return rt;
 }
 
@@ -449,24 +481,10 @@ int atop_service_upgrade_status_update_v41(const char *id, const char *key, int
         .user_data = NULL,
     };
 
-    atop_base_response_t response = {0};
-
     /* ATOP service request send */
-    rt = atop_base_request(&atop_request, &response);
+    rt = atop_service_request_check(&atop_request);
     tal_free(buffer);
 
-    bool success = response.success;
-    atop_base_response_free(&response);
-
-    if (OPRT_OK != rt) {
-        PR_ERR("atop_base_request error:%d", rt);
-        return rt;
-    }
-
-    if (success == false) {
-        return OPRT_COM_ERROR;
-    }
-
     return rt;
 }
 
@@ -517,24 +535,10 @@ int atop_service_version_update_v41(const char *id, const char *key, const char
         .user_data = NULL,
     };
 
-    atop_base_response_t response = {0};
-
     /* ATOP service request send */
-    rt = atop_base_request(&atop_request, &response);
+    rt = atop_service_request_check(&atop_request);
     tal_free(buffer);
 
-    bool success = response.success;
-    atop_base_response_free(&response);
-
-    if (OPRT_OK != rt) {
-        PR_ERR("atop_base_request error:%d", rt);
-        return rt;
-    }
-
-    if (success == false) {
-        return OPRT_COM_ERROR;
-    }
-
     return rt;
 }
 
@@ -585,24 +589,10 @@ int atop_service_put_rst_log_v10(const char *id, const char *key, const char *rs
         .user_data = NULL,
     };
 
-    atop_base_response_t response = {0};
-
     /* ATOP service request send */
-    rt = atop_base_request(&atop_request, &response);
+    rt = atop_service_request_check(&atop_request);
     tal_free(buffer);
 
-    bool success = response.success;
-    atop_base_response_free(&response);
-
-    if (OPRT_OK != rt) {
-        PR_ERR("atop_base_request error:%d", rt);
-        return rt;
-    }
-
-    if (success == false) {
-        return OPRT_COM_ERROR;
-    }
-
     return rt;
 }
 
@@ -655,24 +645,10 @@ int atop_service_outdoors_property_upload(const char *id, const char *key, const
         .user_data = NULL,
     };
 
-    atop_base_response_t response = {0};
-
     /* ATOP service request send */
-    rt = atop_base_request(&atop_request, &response);
+    rt = atop_service_request_check(&atop_request);
     tal_free(buffer);
 
-    bool success = response.success;
-    atop_base_response_free(&response);
-
-    if (OPRT_OK != rt) {
-        PR_ERR("atop_base_request error:%d", rt);
-        return rt;
-    }
-
-    if (success == false) {
-        return OPRT_COM_ERROR;
-    }
-
     return rt;
 }
 
@@ -725,24 +701,10 @@ int atop_service_iccid_upload(const char *id, const char *key, const char *iccid
         .user_data = NULL,
     };
 
-    atop_base_response_t response = {0};
-
     /* ATOP service request send */
-    rt = atop_base_request(&atop_request, &response);
+    rt = atop_service_request_check(&atop_request);
     tal_free(buffer);
 
-    bool success = response.success;
-    atop_base_response_free(&response);
-
-    if (OPRT_OK != rt) {
-        PR_ERR("atop_base_request error:%d", rt);
-        return rt;
-    }
-
-    if (success == false) {
-        return OPRT_COM_ERROR;
-    }
-
     return rt;
 }
 
@@ -924,24 +886,10 @@ int atop_service_comm_node_enable(const char *id, const char *key)
                                         .datalen = buffer_len,
                                         .user_data = NULL};
 
-    atop_base_response_t response = {0};
-
     /* ATOP service request send */
-    rt = atop_base_request(&atop_request, &response);
+    rt = atop_service_request_check(&atop_request);
     tal_free(buffer);
 
-    bool success = response.success;
-    atop_base_response_free(&response);
-
-    if (OPRT_OK != rt) {
-        PR_ERR("atop_base_request error:%d", rt);
-        return rt;
-    }
-
-    if (success == false) {
-        return OPRT_COM_ERROR;
-    }
-
     return rt;
 }
 
@@ -985,24 +933,10 @@ int atop_service_comm_node_disable(const char *id, const char *key)
                                         .datalen = buffer_len,
                                         .user_data = NULL};
 
-    atop_base_response_t response = {0};
-
     /* ATOP service request send */
-    rt = atop_base_request(&atop_request, &response);
+    rt = atop_service_request_check(&atop_request);
     tal_free(buffer);
 
-    bool success = response.success;
-    atop_base_response_free(&response);
-
-    if (OPRT_OK != rt) {
-        PR_ERR("atop_base_request error:%d", rt);
-        return rt;
-    }
-
-    if (success == false) {
-        return OPRT_COM_ERROR;
-    }
-
     return rt;
 }
 
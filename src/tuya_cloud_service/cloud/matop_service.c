@@ -149,12 +149,22 @@ static int matop_service_file_rawdata_receive_cb(void *context, const uint8_t *i
 
 static void on_matop_service_data_receive(uint16_t msgid, const mqtt_client_message_t *msg, void *userdata)
 {
-    matop_service_data_receive_cb(userdata, msg->payload, msg->length);
+    matop_context_t *context = (matop_context_t *)userdata;
+
+    msg = mqtt_client_message_collect(&context->data_collector, msg);
+    if (msg) {
+        matop_service_data_receive_cb(userdata, msg->payload, msg->length);
+    }
 }
 
 static void on_matop_service_file_rawdata_receive(uint16_t msgid, const mqtt_client_message_t *msg, void *userdata)
 {
-    matop_service_file_rawdata_receive_cb(userdata, msg->payload, msg->length);
+    matop_context_t *context = (matop_context_t *)userdata;
+
+    msg = mqtt_client_message_collect(&context->file_collector, msg);
+    if (msg) {
+        matop_service_file_rawdata_receive_cb(userdata, msg->payload, msg->length);
+    }
 }
 
 static int matop_request_send(matop_context_t *context, const uint8_t *data, size_t datalen)
@@ -280,6 +290,8 @@ int matop_serice_destory(matop_context_t *context)
         *current = entry->next;
         tal_free(entry);
     }
+    mqtt_client_collector_reset(&context->data_collector);
+    mqtt_client_collector_reset(&context->file_collector);
 
     return OPRT_OK;
 }
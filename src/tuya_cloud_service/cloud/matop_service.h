@@ -55,6 +55,8 @@ typedef struct matop_context {
     uint32_t id_cnt;
     char resquest_topic[64];
     mqtt_atop_message_t *message_list;
+    mqtt_client_collector_t data_collector; // responses streamed by the MQTT client
+    mqtt_client_collector_t file_collector;
 } matop_context_t;
 
 /**
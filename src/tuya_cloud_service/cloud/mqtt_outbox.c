@@ -0,0 +1,776 @@
+/**
+ * @file mqtt_outbox.c
+ * @brief Bounded outbox for QoS1 MQTT publishes.
+ *
+ * Records are appended to a ring buffer in publish order and released from
+ * its head once they are acked or expired, so acks received out of order only
+ * mark their record done. Only in-flight records have a msgid, they are
+ * indexed by an open addressing table sized for the send window.
+ *
+ * A record the ring has no room for, or larger than the ring, is allocated on
+ * the heap instead, up to MQTT_OUTBOX_HEAP_SIZE bytes. Heap records follow the
+ * ring ones in publish order and are not saved, the ring bounds what is
+ * persisted.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "tuya_iot_config.h"
+#include "tuya_config_defaults.h"
+
+#include "tuya_error_code.h"
+#include "tal_api.h"
+#include "mqtt_outbox.h"
+
+#if MQTT_OUTBOX_WINDOW > 16
+#error "MQTT_OUTBOX_WINDOW must not exceed 16"
+#endif
+
+/* at most half full with the largest window */
+#define OUTBOX_HASH_SIZE 32
+#define OUTBOX_ALIGN(n)  (((n) + 7) & ~7)
+#define OUTBOX_MAGIC     "MQOB"
+
+typedef enum {
+    OUTBOX_REC_QUEUED,
+    OUTBOX_REC_INFLIGHT,
+    OUTBOX_REC_DONE,
+} outbox_rec_state_t;
+
+typedef struct {
+    uint32_t size;  // record size, header included
+    uint16_t msgid; // set while in flight
+    uint8_t state;
+    uint8_t topic_len;
+    uint32_t length;
+    uint32_t seq;
+    SYS_TIME_T deadline; // 0 for no limit
+    mqtt_outbox_notify_cb_t cb;
+    void *user_data;
+    /* char topic[topic_len + 1], uint8_t payload[length] */
+} outbox_rec_t;
+
+#define REC_TOPIC(rec)   ((char *)((rec) + 1))
+#define REC_PAYLOAD(rec) ((uint8_t *)((rec) + 1) + (rec)->topic_len + 1)
+
+typedef struct outbox_heap_rec {
+    struct outbox_heap_rec *next;
+    outbox_rec_t rec;
+} outbox_heap_rec_t;
+
+/* walks the ring records then the heap ones, that is in publish order */
+typedef struct {
+    uint32_t i;
+    uint32_t off;
+    outbox_heap_rec_t *heap;
+} outbox_iter_t;
+
+typedef struct {
+    char magic[4];
+    uint16_t num;
+    uint16_t rsvd;
+} outbox_save_head_t;
+
+typedef struct {
+    uint8_t topic_len;
+    uint8_t rsvd;
+    uint16_t length;
+} outbox_save_rec_t;
+
+struct mqtt_outbox {
+    MUTEX_HANDLE mutex;
+    mqtt_outbox_send_cb_t send_cb;
+    void *user_data;
+    bool online;
+    bool dirty;   // pending records not saved yet
+    bool saved;   // records up to saved_seq are in KV
+    uint32_t saved_seq;
+    SYS_TIME_T save_time;
+
+    /* data is [head, tail) or, once wrapped, [head, wrap) + [0, tail) */
+    uint32_t head;
+    uint32_t tail;
+    uint32_t wrap;
+    bool wrapped;
+    uint32_t count;   // records in the ring
+    uint32_t pending; // records not done
+    uint32_t seq;
+
+    /* records the ring had no room for, newer than all the ring ones */
+    outbox_heap_rec_t *heap;
+    uint32_t heap_bytes;
+
+    uint32_t inflight;
+    uint32_t inflight_bytes;
+    uint16_t hash_id[OUTBOX_HASH_SIZE];
+    outbox_rec_t *hash_rec[OUTBOX_HASH_SIZE];
+
+    uint64_t buf[MQTT_OUTBOX_BUFFER_SIZE / sizeof(uint64_t)]; // records are 8 bytes aligned
+};
+
+static outbox_rec_t *__rec(mqtt_outbox_t *outbox, uint32_t off)
+{
+    return (outbox_rec_t *)((uint8_t *)outbox->buf + off);
+}
+
+static uint32_t __rec_next(mqtt_outbox_t *outbox, uint32_t off)
+{
+    off += __rec(outbox, off)->size;
+    if (outbox->wrapped && off == outbox->wrap) {
+        off = 0;
+    }
+    return off;
+}
+
+static int __rec_alloc(mqtt_outbox_t *outbox, uint32_t size)
+{
+    uint32_t off;
+
+    if (0 == outbox->count) {
+        outbox->head = outbox->tail = 0;
+        outbox->wrapped = false;
+    }
+
+    if (!outbox->wrapped && MQTT_OUTBOX_BUFFER_SIZE - outbox->tail >= size) {
+        off = outbox->tail;
+    } else if (!outbox->wrapped && outbox->head >= size) {
+        outbox->wrap = outbox->tail;
+        outbox->wrapped = true;
+        off = 0;
+    } else if (outbox->wrapped && outbox->head - outbox->tail >= size) {
+        off = outbox->tail;
+    } else {
+        return -1;
+    }
+
+    outbox->tail = off + size;
+    outbox->count++;
+    return off;
+}
+
+/* releases the done records at the head of the ring and on the heap */
+static void __rec_release(mqtt_outbox_t *outbox)
+{
+    outbox_heap_rec_t **pp = &outbox->heap, *hrec = NULL;
+
+    while (outbox->count && OUTBOX_REC_DONE == __rec(outbox, outbox->head)->state) {
+        outbox->head += __rec(outbox, outbox->head)->size;
+        if (outbox->wrapped && outbox->head == outbox->wrap) {
+            outbox->head = 0;
+            outbox->wrapped = false;
+        }
+        outbox->count--;
+    }
+
+    while (*pp) {
+        hrec = *pp;
+        if (OUTBOX_REC_DONE != hrec->rec.state) {
+            pp = &hrec->next;
+            continue;
+        }
+        *pp = hrec->next;
+        outbox->heap_bytes -= hrec->rec.size;
+        tal_free(hrec);
+    }
+}
+
+static void __iter_init(mqtt_outbox_t *outbox, outbox_iter_t *it)
+{
+    it->i = 0;
+    it->off = outbox->head;
+    it->heap = outbox->heap;
+}
+
+static outbox_rec_t *__iter_next(mqtt_outbox_t *outbox, outbox_iter_t *it)
+{
+    outbox_rec_t *rec = NULL;
+
+    if (it->i < outbox->count) {
+        rec = __rec(outbox, it->off);
+        it->off = __rec_next(outbox, it->off);
+        it->i++;
+    } else if (it->heap) {
+        rec = &it->heap->rec;
+        it->heap = it->heap->next;
+    }
+
+    return rec;
+}
+
+static uint32_t __hash(uint16_t msgid)
+{
+    return ((uint32_t)msgid * 40503u >> 8) & (OUTBOX_HASH_SIZE - 1);
+}
+
+static void __hash_insert(mqtt_outbox_t *outbox, uint16_t msgid, outbox_rec_t *rec)
+{
+    uint32_t i = __hash(msgid);
+
+    while (outbox->hash_id[i]) {
+        i = (i + 1) & (OUTBOX_HASH_SIZE - 1);
+    }
+    outbox->hash_id[i] = msgid;
+    outbox->hash_rec[i] = rec;
+}
+
+static int __hash_find(mqtt_outbox_t *outbox, uint16_t msgid)
+{
+    uint32_t i = __hash(msgid);
+
+    while (outbox->hash_id[i]) {
+        if (outbox->hash_id[i] == msgid) {
+            return i;
+        }
+        i = (i + 1) & (OUTBOX_HASH_SIZE - 1);
+    }
+    return -1;
+}
+
+/* backward shift deletion, keeps the probe chains without tombstones */
+static void __hash_remove(mqtt_outbox_t *outbox, uint32_t i)
+{
+    uint32_t j = i, k;
+
+    outbox->hash_id[i] = 0;
+    for (;;) {
+        j = (j + 1) & (OUTBOX_HASH_SIZE - 1);
+        if (0 == outbox->hash_id[j]) {
+            return;
+        }
+        k = __hash(outbox->hash_id[j]);
+        // the entry at j stays if its home slot lies cyclically in (i, j]
+        if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j)) {
+            continue;
+        }
+        outbox->hash_id[i] = outbox->hash_id[j];
+        outbox->hash_rec[i] = outbox->hash_rec[j];
+        outbox->hash_id[j] = 0;
+        i = j;
+    }
+}
+
+/* marks a record done, the caller notifies it after the lock is released */
+static void __rec_done(mqtt_outbox_t *outbox, outbox_rec_t *rec)
+{
+    int i;
+
+    if (OUTBOX_REC_INFLIGHT == rec->state) {
+        i = __hash_find(outbox, rec->msgid);
+        if (i >= 0) {
+            __hash_remove(outbox, i);
+        }
+        outbox->inflight--;
+        outbox->inflight_bytes -= rec->length;
+    }
+    rec->state = OUTBOX_REC_DONE;
+    rec->msgid = 0;
+    outbox->pending--;
+}
+
+#if defined(ENABLE_MQTT_OUTBOX_PERSIST) && (ENABLE_MQTT_OUTBOX_PERSIST == 1)
+static void __save(mqtt_outbox_t *outbox)
+{
+    uint32_t i, off, len = sizeof(outbox_save_head_t);
+    outbox_save_head_t head;
+    outbox_save_rec_t save;
+    outbox_rec_t *rec = NULL;
+    uint8_t *data = NULL, *p = NULL;
+
+    outbox->dirty = false;
+    outbox->save_time = tal_system_get_millisecond();
+
+    for (i = 0, off = outbox->head; i < outbox->count; i++, off = __rec_next(outbox, off)) {
+        rec = __rec(outbox, off);
+        if (OUTBOX_REC_DONE != rec->state) {
+            len += sizeof(outbox_save_rec_t) + rec->topic_len + rec->length;
+        }
+    }
+
+    data = tal_malloc(len);
+    if (NULL == data) {
+        return;
+    }
+    memcpy(head.magic, OUTBOX_MAGIC, sizeof(head.magic));
+    head.num = 0;
+    head.rsvd = 0;
+    p = data + sizeof(outbox_save_head_t);
+
+    for (i = 0, off = outbox->head; i < outbox->count; i++, off = __rec_next(outbox, off)) {
+        rec = __rec(outbox, off);
+        if (OUTBOX_REC_DONE == rec->state) {
+            continue;
+        }
+        // the saved records are packed, copy the headers
+        save.topic_len = rec->topic_len;
+        save.rsvd = 0;
+        save.length = rec->length;
+        memcpy(p, &save, sizeof(outbox_save_rec_t));
+        p += sizeof(outbox_save_rec_t);
+        memcpy(p, REC_TOPIC(rec), rec->topic_len);
+        p += rec->topic_len;
+        memcpy(p, REC_PAYLOAD(rec), rec->length);
+        p += rec->length;
+        head.num++;
+        outbox->saved_seq = rec->seq;
+    }
+    memcpy(data, &head, sizeof(outbox_save_head_t));
+
+    if (OPRT_OK == tal_kv_set(MQTT_OUTBOX_KV_KEY, data, len)) {
+        outbox->saved = true;
+        PR_DEBUG("mqtt outbox saved %d messages", head.num);
+    }
+    tal_free(data);
+}
+
+/* drops the saved copy once everything it holds is done */
+static void __save_check(mqtt_outbox_t *outbox)
+{
+    if (!outbox->saved) {
+        return;
+    }
+    // only ring records are saved, the head one is not done after a release
+    if (outbox->count && __rec(outbox, outbox->head)->seq <= outbox->saved_seq) {
+        return;
+    }
+    tal_kv_del(MQTT_OUTBOX_KV_KEY);
+    outbox->saved = false;
+}
+#else
+#define __save(outbox)
+#define __save_check(outbox)
+#endif
+
+static outbox_rec_t *__heap_alloc(mqtt_outbox_t *outbox, uint32_t size)
+{
+    outbox_heap_rec_t *hrec = NULL, **pp = &outbox->heap;
+
+    if (size > MQTT_OUTBOX_HEAP_SIZE - outbox->heap_bytes) {
+        return NULL;
+    }
+    hrec = tal_malloc(offsetof(outbox_heap_rec_t, rec) + size);
+    if (NULL == hrec) {
+        return NULL;
+    }
+    hrec->next = NULL;
+    while (*pp) {
+        pp = &(*pp)->next;
+    }
+    *pp = hrec;
+    outbox->heap_bytes += size;
+
+    return &hrec->rec;
+}
+
+static int __push(mqtt_outbox_t *outbox, const char *topic, size_t topic_len, const uint8_t *payload,
+                  size_t length, mqtt_outbox_notify_cb_t cb, void *user_data, int timeout_ms)
+{
+    outbox_rec_t *rec = NULL;
+    int off = -1;
+    uint32_t size;
+
+    if (topic_len > 0xff || length > MQTT_OUTBOX_BUFFER_SIZE + MQTT_OUTBOX_HEAP_SIZE) {
+        return OPRT_MSG_OUT_OF_LIMIT;
+    }
+    size = OUTBOX_ALIGN(sizeof(outbox_rec_t) + topic_len + 1 + length);
+    if (size > MQTT_OUTBOX_BUFFER_SIZE && size > MQTT_OUTBOX_HEAP_SIZE) {
+        return OPRT_MSG_OUT_OF_LIMIT;
+    }
+
+    // the ring is not used while heap records wait, so it keeps the oldest
+    if (NULL == outbox->heap && size <= MQTT_OUTBOX_BUFFER_SIZE) {
+        off = __rec_alloc(outbox, size);
+    }
+    if (off >= 0) {
+        rec = __rec(outbox, off);
+    } else {
+        rec = __heap_alloc(outbox, size);
+        if (NULL == rec) {
+            return OPRT_EXCEED_UPPER_LIMIT;
+        }
+    }
+
+    rec->size = size;
+    rec->msgid = 0;
+    rec->state = OUTBOX_REC_QUEUED;
+    rec->topic_len = topic_len;
+    rec->length = length;
+    rec->seq = ++outbox->seq;
+    rec->deadline = timeout_ms > 0 ? tal_system_get_millisecond() + timeout_ms : 0;
+    rec->cb = cb;
+    rec->user_data = user_data;
+    memcpy(REC_TOPIC(rec), topic, topic_len);
+    REC_TOPIC(rec)[topic_len] = '\0';
+    memcpy(REC_PAYLOAD(rec), payload, length);
+    outbox->pending++;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Creates an outbox.
+ *
+ * @param send_cb sends a message to the broker
+ * @param user_data passed to send_cb
+ *
+ * @return the outbox, NULL on error
+ */
+mqtt_outbox_t *mqtt_outbox_create(mqtt_outbox_send_cb_t send_cb, void *user_data)
+{
+    mqtt_outbox_t *outbox = NULL;
+
+    if (NULL == send_cb) {
+        return NULL;
+    }
+
+    outbox = tal_malloc(sizeof(mqtt_outbox_t));
+    if (NULL == outbox) {
+        return NULL;
+    }
+    memset(outbox, 0, sizeof(mqtt_outbox_t));
+
+    if (OPRT_OK != tal_mutex_create_init(&outbox->mutex)) {
+        tal_free(outbox);
+        return NULL;
+    }
+    outbox->send_cb = send_cb;
+    outbox->user_data = user_data;
+
+    return outbox;
+}
+
+/**
+ * @brief Destroys an outbox, pending messages are dropped without notify.
+ *
+ * @param outbox the outbox
+ */
+void mqtt_outbox_destroy(mqtt_outbox_t *outbox)
+{
+    outbox_heap_rec_t *hrec = NULL;
+
+    if (NULL == outbox) {
+        return;
+    }
+
+    while (outbox->heap) {
+        hrec = outbox->heap;
+        outbox->heap = hrec->next;
+        tal_free(hrec);
+    }
+    tal_mutex_release(outbox->mutex);
+    tal_free(outbox);
+}
+
+/**
+ * @brief Queues a message.
+ *
+ * @param outbox the outbox
+ * @param topic topic to publish to
+ * @param payload message payload, copied
+ * @param length payload length
+ * @param cb notified with the result, may be NULL
+ * @param user_data passed to cb
+ * @param timeout_ms time left to the message to be acked, 0 for no limit
+ *
+ * @return OPRT_OK on success, OPRT_EXCEED_UPPER_LIMIT if the outbox is full,
+ * OPRT_MSG_OUT_OF_LIMIT if the message could never fit
+ */
+int mqtt_outbox_push(mqtt_outbox_t *outbox, const char *topic, const uint8_t *payload, size_t length,
+                     mqtt_outbox_notify_cb_t cb, void *user_data, int timeout_ms)
+{
+    int rt = OPRT_OK;
+
+    if (NULL == outbox || NULL == topic || (NULL == payload && length)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tal_mutex_lock(outbox->mutex);
+    rt = __push(outbox, topic, strlen(topic), payload, length, cb, user_data, timeout_ms);
+    if (OPRT_OK == rt && !outbox->online) {
+        outbox->dirty = true;
+    }
+    tal_mutex_unlock(outbox->mutex);
+
+    if (OPRT_OK != rt) {
+        PR_ERR("mqtt outbox push failed:%d, pending:%d", rt, outbox->pending);
+    }
+
+    return rt;
+}
+
+/**
+ * @brief Sends the queued messages in order while the send window has room.
+ *
+ * A message is sent as long as fewer than MQTT_OUTBOX_WINDOW are in flight
+ * and MQTT_OUTBOX_WINDOW_BYTES are not exceeded, so small reports share the
+ * window while a large one goes alone.
+ *
+ * @param outbox the outbox
+ *
+ * @return number of messages sent
+ */
+int mqtt_outbox_flush(mqtt_outbox_t *outbox)
+{
+    outbox_iter_t it;
+    uint16_t msgid;
+    outbox_rec_t *rec = NULL;
+    int sent = 0;
+
+    if (NULL == outbox) {
+        return 0;
+    }
+
+    tal_mutex_lock(outbox->mutex);
+    __iter_init(outbox, &it);
+    while (outbox->online && NULL != (rec = __iter_next(outbox, &it))) {
+        if (OUTBOX_REC_QUEUED != rec->state) {
+            continue;
+        }
+        if (outbox->inflight >= MQTT_OUTBOX_WINDOW ||
+            (outbox->inflight && outbox->inflight_bytes + rec->length > MQTT_OUTBOX_WINDOW_BYTES)) {
+            break;
+        }
+
+        // stop at the first failure so that the order is kept
+        msgid = outbox->send_cb(REC_TOPIC(rec), REC_PAYLOAD(rec), rec->length, outbox->user_data);
+        if (0 == msgid) {
+            break;
+        }
+        rec->msgid = msgid;
+        rec->state = OUTBOX_REC_INFLIGHT;
+        __hash_insert(outbox, msgid, rec);
+        outbox->inflight++;
+        outbox->inflight_bytes += rec->length;
+        sent++;
+    }
+    tal_mutex_unlock(outbox->mutex);
+
+    return sent;
+}
+
+/**
+ * @brief Completes the in-flight message acked by a PUBACK.
+ *
+ * @param outbox the outbox
+ * @param msgid msgid of the PUBACK
+ *
+ * @return OPRT_OK on success, OPRT_NOT_FOUND if no message has this msgid
+ */
+int mqtt_outbox_ack(mqtt_outbox_t *outbox, uint16_t msgid)
+{
+    int i;
+    outbox_rec_t *rec = NULL;
+    mqtt_outbox_notify_cb_t cb = NULL;
+    void *user_data = NULL;
+
+    if (NULL == outbox || 0 == msgid) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tal_mutex_lock(outbox->mutex);
+    i = __hash_find(outbox, msgid);
+    if (i < 0) {
+        tal_mutex_unlock(outbox->mutex);
+        return OPRT_NOT_FOUND;
+    }
+    rec = outbox->hash_rec[i];
+    cb = rec->cb;
+    user_data = rec->user_data;
+    __rec_done(outbox, rec);
+    __rec_release(outbox);
+    __save_check(outbox);
+    tal_mutex_unlock(outbox->mutex);
+
+    if (cb) {
+        cb(OPRT_OK, user_data);
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Periodic work: expires messages, saves the outbox and sends.
+ *
+ * @param outbox the outbox
+ */
+void mqtt_outbox_poll(mqtt_outbox_t *outbox)
+{
+    outbox_iter_t it;
+    outbox_rec_t *rec = NULL;
+    mqtt_outbox_notify_cb_t cb = NULL;
+    void *user_data = NULL;
+    SYS_TIME_T now;
+
+    if (NULL == outbox) {
+        return;
+    }
+
+    // expire one record at a time, the callback runs without the lock
+    for (;;) {
+        now = tal_system_get_millisecond();
+        tal_mutex_lock(outbox->mutex);
+        __iter_init(outbox, &it);
+        while (NULL != (rec = __iter_next(outbox, &it))) {
+            if (OUTBOX_REC_DONE != rec->state && rec->deadline && rec->deadline <= now) {
+                break;
+            }
+        }
+        if (rec) {
+            PR_WARN("mqtt outbox message %d timeout", rec->seq);
+            cb = rec->cb;
+            user_data = rec->user_data;
+            __rec_done(outbox, rec);
+            __rec_release(outbox);
+            __save_check(outbox);
+        }
+        tal_mutex_unlock(outbox->mutex);
+
+        if (NULL == rec) {
+            break;
+        }
+        if (cb) {
+            cb(OPRT_TIMEOUT, user_data);
+        }
+    }
+
+    tal_mutex_lock(outbox->mutex);
+    if (outbox->dirty && !outbox->online && now - outbox->save_time >= MQTT_OUTBOX_SAVE_INTERVAL_MS) {
+        __save(outbox);
+    }
+    tal_mutex_unlock(outbox->mutex);
+
+    mqtt_outbox_flush(outbox);
+}
+
+/**
+ * @brief Marks the link as up, queued messages are sent by the next flush.
+ *
+ * @param outbox the outbox
+ */
+void mqtt_outbox_link_up(mqtt_outbox_t *outbox)
+{
+    if (NULL == outbox) {
+        return;
+    }
+
+    tal_mutex_lock(outbox->mutex);
+    outbox->online = true;
+    outbox->dirty = false;
+    tal_mutex_unlock(outbox->mutex);
+    PR_DEBUG("mqtt outbox replay %d messages", outbox->pending);
+}
+
+/**
+ * @brief Marks the link as down, in-flight messages are queued again.
+ *
+ * The broker keeps no session, so messages without PUBACK are sent again
+ * from the start of the ring once the link is back, in their original order.
+ *
+ * @param outbox the outbox
+ */
+void mqtt_outbox_link_down(mqtt_outbox_t *outbox)
+{
+    outbox_iter_t it;
+    outbox_rec_t *rec = NULL;
+
+    if (NULL == outbox) {
+        return;
+    }
+
+    tal_mutex_lock(outbox->mutex);
+    outbox->online = false;
+    __iter_init(outbox, &it);
+    while (NULL != (rec = __iter_next(outbox, &it))) {
+        if (OUTBOX_REC_INFLIGHT == rec->state) {
+            rec->state = OUTBOX_REC_QUEUED;
+            rec->msgid = 0;
+        }
+    }
+    memset(outbox->hash_id, 0, sizeof(outbox->hash_id));
+    outbox->inflight = 0;
+    outbox->inflight_bytes = 0;
+    if (outbox->pending) {
+        __save(outbox);
+    }
+    tal_mutex_unlock(outbox->mutex);
+}
+
+/**
+ * @brief Loads the messages saved by a previous run.
+ *
+ * Restored messages have no callback and no timeout.
+ *
+ * @param outbox the outbox
+ * @param topic only messages to this topic are kept
+ *
+ * @return number of messages loaded
+ */
+int mqtt_outbox_restore(mqtt_outbox_t *outbox, const char *topic)
+{
+#if defined(ENABLE_MQTT_OUTBOX_PERSIST) && (ENABLE_MQTT_OUTBOX_PERSIST == 1)
+    uint8_t *data = NULL, *p = NULL;
+    size_t len = 0, topic_len;
+    uint32_t i;
+    int num = 0;
+    outbox_save_head_t head;
+    outbox_save_rec_t save;
+
+    if (NULL == outbox || NULL == topic) {
+        return 0;
+    }
+
+    if (OPRT_OK != tal_kv_get(MQTT_OUTBOX_KV_KEY, &data, &len)) {
+        return 0;
+    }
+
+    topic_len = strlen(topic);
+    memset(&head, 0, sizeof(head));
+    if (len >= sizeof(outbox_save_head_t)) {
+        memcpy(&head, data, sizeof(outbox_save_head_t));
+    }
+    p = data + sizeof(outbox_save_head_t);
+
+    tal_mutex_lock(outbox->mutex);
+    if (0 == memcmp(head.magic, OUTBOX_MAGIC, sizeof(head.magic))) {
+        for (i = 0; i < head.num && p + sizeof(outbox_save_rec_t) <= data + len; i++) {
+            memcpy(&save, p, sizeof(outbox_save_rec_t));
+            p += sizeof(outbox_save_rec_t);
+            if (p + save.topic_len + save.length > data + len) {
+                break;
+            }
+            // messages of another activation are dropped
+            if (save.topic_len == topic_len && 0 == memcmp(p, topic, topic_len) &&
+                OPRT_OK == __push(outbox, topic, topic_len, p + topic_len, save.length, NULL, NULL, 0)) {
+                num++;
+            }
+            p += save.topic_len + save.length;
+        }
+    }
+
+    if (num) {
+        outbox->saved = true;
+        outbox->saved_seq = outbox->seq;
+    } else {
+        tal_kv_del(MQTT_OUTBOX_KV_KEY);
+    }
+    tal_mutex_unlock(outbox->mutex);
+    tal_kv_free(data);
+
+    PR_DEBUG("mqtt outbox restored %d messages", num);
+    return num;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Number of messages not acked yet.
+ *
+ * @param outbox the outbox
+ *
+ * @return the number of messages
+ */
+uint32_t mqtt_outbox_pending(mqtt_outbox_t *outbox)
+{
+    return outbox ? outbox->pending : 0;
+}
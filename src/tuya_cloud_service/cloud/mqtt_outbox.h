@@ -0,0 +1,139 @@
+/**
+ * @file mqtt_outbox.h
+ * @brief Bounded outbox for QoS1 MQTT publishes.
+ *
+ * Messages are copied into a fixed ring buffer and sent in order, several at
+ * a time within a send window. In-flight messages are found by msgid through
+ * a small hash table when the PUBACK arrives. When the link drops, in-flight
+ * messages are queued again and replayed in order on reconnect, and with
+ * ENABLE_MQTT_OUTBOX_PERSIST the pending messages of the ring are saved to KV
+ * so they also survive a reboot. Messages the ring has no room for are kept
+ * on the heap up to MQTT_OUTBOX_HEAP_SIZE bytes and are not saved.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __MQTT_OUTBOX_H__
+#define __MQTT_OUTBOX_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MQTT_OUTBOX_KV_KEY "mqtt_outbox"
+
+/**
+ * @brief Sends one message, returns its msgid or 0 if it was not sent
+ */
+typedef uint16_t (*mqtt_outbox_send_cb_t)(const char *topic, const uint8_t *payload, size_t length, void *user_data);
+
+/**
+ * @brief Notified once per message with OPRT_OK on PUBACK or OPRT_TIMEOUT
+ */
+typedef void (*mqtt_outbox_notify_cb_t)(int result, void *user_data);
+
+typedef struct mqtt_outbox mqtt_outbox_t;
+
+/**
+ * @brief Creates an outbox.
+ *
+ * @param send_cb sends a message to the broker
+ * @param user_data passed to send_cb
+ *
+ * @return the outbox, NULL on error
+ */
+mqtt_outbox_t *mqtt_outbox_create(mqtt_outbox_send_cb_t send_cb, void *user_data);
+
+/**
+ * @brief Destroys an outbox, pending messages are dropped without notify.
+ *
+ * @param outbox the outbox
+ */
+void mqtt_outbox_destroy(mqtt_outbox_t *outbox);
+
+/**
+ * @brief Queues a message.
+ *
+ * @param outbox the outbox
+ * @param topic topic to publish to
+ * @param payload message payload, copied
+ * @param length payload length
+ * @param cb notified with the result, may be NULL
+ * @param user_data passed to cb
+ * @param timeout_ms time left to the message to be acked, 0 for no limit
+ *
+ * @return OPRT_OK on success, OPRT_EXCEED_UPPER_LIMIT if the outbox is full,
+ * OPRT_MSG_OUT_OF_LIMIT if the message could never fit
+ */
+int mqtt_outbox_push(mqtt_outbox_t *outbox, const char *topic, const uint8_t *payload, size_t length,
+                     mqtt_outbox_notify_cb_t cb, void *user_data, int timeout_ms);
+
+/**
+ * @brief Sends the queued messages in order while the send window has room.
+ *
+ * @param outbox the outbox
+ *
+ * @return number of messages sent
+ */
+int mqtt_outbox_flush(mqtt_outbox_t *outbox);
+
+/**
+ * @brief Completes the in-flight message acked by a PUBACK.
+ *
+ * @param outbox the outbox
+ * @param msgid msgid of the PUBACK
+ *
+ * @return OPRT_OK on success, OPRT_NOT_FOUND if no message has this msgid
+ */
+int mqtt_outbox_ack(mqtt_outbox_t *outbox, uint16_t msgid);
+
+/**
+ * @brief Periodic work: expires messages, saves the outbox and sends.
+ *
+ * @param outbox the outbox
+ */
+void mqtt_outbox_poll(mqtt_outbox_t *outbox);
+
+/**
+ * @brief Marks the link as up, queued messages are sent by the next flush.
+ *
+ * @param outbox the outbox
+ */
+void mqtt_outbox_link_up(mqtt_outbox_t *outbox);
+
+/**
+ * @brief Marks the link as down, in-flight messages are queued again.
+ *
+ * @param outbox the outbox
+ */
+void mqtt_outbox_link_down(mqtt_outbox_t *outbox);
+
+/**
+ * @brief Loads the messages saved by a previous run.
+ *
+ * @param outbox the outbox
+ * @param topic only messages to this topic are kept
+ *
+ * @return number of messages loaded
+ */
+int mqtt_outbox_restore(mqtt_outbox_t *outbox, const char *topic);
+
+/**
+ * @brief Number of messages not acked yet.
+ *
+ * @param outbox the outbox
+ *
+ * @return the number of messages
+ */
+uint32_t mqtt_outbox_pending(mqtt_outbox_t *outbox);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MQTT_OUTBOX_H__ */
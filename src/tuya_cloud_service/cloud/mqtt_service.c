@@ -119,37 +119,14 @@ int tuya_mqtt_subscribe_message_callback_register(tuya_mqtt_context_t *context,
         return OPRT_COM_ERROR;
     }
 
-    /* Repetition filter */
-    mqtt_subscribe_handle_t *target = context->subscribe_list;
-    while (target) {
-        if (!memcmp(target->topic, topic, target->topic_length) && target->cb == cb) {
-            PR_WARN("Repetition:%s", topic);
-            return OPRT_OK;
-        }
-        target = target->next;
-    }
-
-    /* Intser new handle */
-    mqtt_subscribe_handle_t *newtarget = tal_calloc(1, sizeof(mqtt_subscribe_handle_t));
-    if (!newtarget) {
-        PR_ERR("malloc error");
-        return OPRT_MALLOC_FAILED;
-    }
-
-    newtarget->topic_length = strlen(topic);
-    newtarget->topic = tal_calloc(1, newtarget->topic_length + 1); // strdup
-    strcpy(newtarget->topic, topic);
-
-    if (cb) {
-        newtarget->cb = cb;
-    } else {
-        newtarget->cb = on_subscribe_message_default;
-    }
-    newtarget->userdata = userdata;
     /* LOCK */
-    newtarget->next = context->subscribe_list;
-    context->subscribe_list = newtarget;
+    int ret = mqtt_topic_router_add(&context->subscribe_router, topic, strlen(topic),
+                                    cb ? cb : on_subscribe_message_default, userdata);
     /* UNLOCK */
+    if (OPRT_OK != ret) {
+        PR_ERR("topic route add error:%d", ret);
+        return ret;
+    }
     return OPRT_OK;
 }
 
@@ -172,21 +149,8 @@ int tuya_mqtt_subscribe_message_callback_unregister(tuya_mqtt_context_t *context
         return OPRT_INVALID_PARM;
     }
 
-    size_t topic_length = strlen(topic);
-
     /* LOCK */
-    /* Remove object form list */
-    mqtt_subscribe_handle_t **target = &context->subscribe_list;
-    while (*target) {
-        mqtt_subscribe_handle_t *entry = *target;
-        if (entry->topic_length == topic_length && !memcmp(topic, entry->topic, topic_length)) {
-            *target = entry->next;
-            tal_free(entry->topic);
-            tal_free(entry);
-        } else {
-            target = &entry->next;
-        }
-    }
+    mqtt_topic_router_remove(&context->subscribe_router, topic, strlen(topic), NULL);
     /* UNLOCK */
 
     uint16_t msgid = mqtt_client_unsubscribe(context->mqtt_client, topic, MQTT_QOS_1);
@@ -200,15 +164,9 @@ int tuya_mqtt_subscribe_message_callback_unregister(tuya_mqtt_context_t *context
 static void mqtt_subscribe_message_distribute(tuya_mqtt_context_t *context, uint16_t msgid,
                                               const mqtt_client_message_t *msg)
 {
-    const char *topic = msg->topic;
-    size_t topic_length = strlen(msg->topic);
-
     /* LOCK */
-    mqtt_subscribe_handle_t *target = context->subscribe_list;
-    for (; target; target = target->next) {
-        if (target->topic_length == topic_length && !memcmp(topic, target->topic, target->topic_length)) {
-            target->cb(msgid, msg, target->userdata);
-        }
+    if (0 == mqtt_topic_router_dispatch(&context->subscribe_router, msgid, msg)) {
+        PR_WARN("no handler for topic:%.*s", (int)msg->topic_length, msg->topic);
     }
     /* UNLOCK */
 }
@@ -279,6 +237,13 @@ static int tuya_protocol_message_parse_process(tuya_mqtt_context_t *context, con
 static void on_subscribe_message_default(uint16_t msgid, const mqtt_client_message_t *msg, void *userdata)
 {
     tuya_mqtt_context_t *context = (tuya_mqtt_context_t *)userdata;
+
+    /* commands are decrypted whole */
+    msg = mqtt_client_message_collect(&context->cmd_collector, msg);
+    if (msg == NULL) {
+        return;
+    }
+
     int ret = tuya_protocol_message_parse_process(context, msg->payload, msg->length);
     if (ret != OPRT_OK) {
         PR_ERR("protocol message parse error:%d", ret);
@@ -298,6 +263,7 @@ static void mqtt_client_connected_cb(void *client, void *userdata)
                                                   userdata);
     PR_DEBUG("SUBSCRIBE sent for topic %s to broker.", context->signature.topic_in);
     context->is_connected = true;
+    mqtt_outbox_link_up(context->outbox);
     if (context->on_connected) {
         context->on_connected(context, context->user_data);
     }
@@ -309,6 +275,7 @@ static void mqtt_client_disconnected_cb(void *client, void *userdata)
     tuya_mqtt_context_t *context = (tuya_mqtt_context_t *)userdata;
     PR_INFO("mqtt client disconnected!");
     context->is_connected = false;
+    mqtt_outbox_link_down(context->outbox);
     if (context->on_disconnect) {
         context->on_disconnect(context, context->user_data);
     }
@@ -320,7 +287,8 @@ static void mqtt_client_message_cb(void *client, uint16_t msgid, const mqtt_clie
     tuya_mqtt_context_t *context = (tuya_mqtt_context_t *)userdata;
 
     /* topic filter */
-    PR_DEBUG("recv message TopicName:%s, payload len:%d", msg->topic, msg->length);
+    PR_DEBUG("recv message TopicName:%.*s, payload len:%d at %d of %d", (int)msg->topic_length, msg->topic,
+             (int)msg->length, (int)msg->offset, (int)msg->total_length);
     mqtt_subscribe_message_distribute(context, msgid, msg);
 }
 
@@ -337,20 +305,16 @@ static void mqtt_client_puback_cb(void *client, uint16_t msgid, void *userdata)
     tuya_mqtt_context_t *context = (tuya_mqtt_context_t *)userdata;
     PR_DEBUG("PUBACK ID:%d", msgid);
 
-    /* LOCK */
-    /* publish async process */
-    mqtt_publish_handle_t **next_handle = &context->publish_list;
-    for (; *next_handle; next_handle = &(*next_handle)->next) {
-        mqtt_publish_handle_t *entry = *next_handle;
-        if (msgid == entry->msgid) {
-            entry->cb(OPRT_OK, entry->user_data);
-            *next_handle = entry->next;
-            tal_free(entry->payload);
-            tal_free(entry);
-            break;
-        }
+    if (OPRT_OK != mqtt_outbox_ack(context->outbox, msgid)) {
+        PR_DEBUG("PUBACK ID:%d not in outbox", msgid);
     }
-    /* UNLOCK */
+}
+
+static uint16_t mqtt_outbox_send_cb(const char *topic, const uint8_t *payload, size_t length, void *userdata)
+{
+    tuya_mqtt_context_t *context = (tuya_mqtt_context_t *)userdata;
+
+    return mqtt_client_publish(context->mqtt_client, topic, payload, length, MQTT_QOS_1);
 }
 
 /**
@@ -370,6 +334,7 @@ int tuya_mqtt_init(tuya_mqtt_context_t *context, const tuya_mqtt_config_t *confi
 
     /* Clean to zero */
     memset(context, 0, sizeof(tuya_mqtt_context_t));
+    mqtt_topic_router_init(&context->subscribe_router);
 
     /* configuration */
     context->user_data = config->user_data;
@@ -421,6 +386,16 @@ int tuya_mqtt_init(tuya_mqtt_context_t *context, const tuya_mqtt_config_t *confi
         return OPRT_COM_ERROR;
     }
 
+    /* QoS1 outbox, with the messages left by the previous run */
+    context->outbox = mqtt_outbox_create(mqtt_outbox_send_cb, context);
+    if (context->outbox == NULL) {
+        PR_ERR("mqtt outbox create fault.");
+        return OPRT_MALLOC_FAILED;
+    }
+    if (context->signature.topic_out[0]) {
+        mqtt_outbox_restore(context->outbox, context->signature.topic_out);
+    }
+
     BackoffAlgorithm_InitializeParams(&context->backoff_algorithm, MQTT_CONNECT_RETRY_MIN_DELAY_MS,
                                       MQTT_CONNECT_RETRY_MAX_DELAY_MS, MQTT_CONNECT_RETRY_MAX_ATTEMPTS);
 
@@ -654,37 +629,16 @@ int tuya_mqtt_client_publish_common(tuya_mqtt_context_t *context, const char *to
         return OPRT_OK;
     }
 
-    mqtt_publish_handle_t *handle = tal_malloc(sizeof(mqtt_publish_handle_t));
-    TUYA_CHECK_NULL_RETURN(handle, OPRT_MALLOC_FAILED);
-    handle->next = NULL;
-    handle->msgid = 0;
-    handle->topic = (char *)topic;
-    handle->timeout = tal_time_get_posix() + timeout_ms;
-    handle->cb = cb;
-    handle->user_data = user_data;
-    handle->payload_length = payload_length;
-    handle->payload = tal_malloc(payload_length);
-    if (handle->payload == NULL) {
-        return OPRT_MALLOC_FAILED;
+    /* QoS1 goes through the outbox, sent by the loop or right now if sync */
+    int rt = mqtt_outbox_push(context->outbox, topic, payload, payload_length, cb, user_data, timeout_ms);
+    if (OPRT_OK != rt) {
+        return rt;
     }
-    memcpy(handle->payload, payload, payload_length);
 
     if (async == false) {
-        handle->msgid = mqtt_client_publish(context->mqtt_client, handle->topic, handle->payload,
-                                            handle->payload_length, MQTT_QOS_1);
-    }
-
-    if (context->publish_list == NULL) {
-        context->publish_list = handle;
-        return OPRT_OK;
+        mqtt_outbox_flush(context->outbox);
     }
 
-    mqtt_publish_handle_t *last = context->publish_list;
-    while (last->next != NULL) {
-        last = last->next;
-    }
-    last->next = handle;
-
     return OPRT_OK;
 }
 
@@ -828,6 +782,9 @@ int tuya_mqtt_loop(tuya_mqtt_context_t *context)
         return rt;
     }
 
+    /* outbox timeout, save while offline and send window */
+    mqtt_outbox_poll(context->outbox);
+
     /* reconnect */
     if (context->is_connected == false) {
         mqtt_status = mqtt_client_connect(context->mqtt_client);
@@ -851,27 +808,6 @@ int tuya_mqtt_loop(tuya_mqtt_context_t *context)
         return rt;
     }
 
-    /* LOCK */
-    /* publish async process */
-    mqtt_publish_handle_t **next_handle = &context->publish_list;
-    for (; *next_handle; next_handle = &(*next_handle)->next) {
-        mqtt_publish_handle_t *entry = *next_handle;
-
-        if (entry->timeout <= tal_time_get_posix()) {
-            entry->cb(OPRT_TIMEOUT, entry->user_data);
-            *next_handle = entry->next;
-            tal_free(entry->payload);
-            tal_free(entry);
-            continue;
-        }
-
-        if (entry->msgid <= 0) {
-            entry->msgid =
-                mqtt_client_publish(context->mqtt_client, entry->topic, entry->payload, entry->payload_length, 1);
-        }
-    }
-    /* UNLOCK */
-
     /* yield */
     mqtt_client_yield(context->mqtt_client);
 
@@ -894,10 +830,14 @@ int tuya_mqtt_destory(tuya_mqtt_context_t *context)
     }
 
     tuya_mqtt_protocol_unregister_all(context);
+    mqtt_topic_router_deinit(&context->subscribe_router);
+    mqtt_client_collector_reset(&context->cmd_collector);
     if (context->mqtt_client) {
         mqtt_client_status_t mqtt_status = mqtt_client_deinit(context->mqtt_client);
         mqtt_client_free(context->mqtt_client);
         context->mqtt_client = NULL;
+        mqtt_outbox_destroy(context->outbox);
+        context->outbox = NULL;
         if (mqtt_status != MQTT_STATUS_SUCCESS) {
             return OPRT_COM_ERROR;
         }
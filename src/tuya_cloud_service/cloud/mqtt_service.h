@@ -30,6 +30,8 @@ extern "C" {
 #include "cJSON.h"
 #include "mqtt_client_interface.h"
 #include "backoff_algorithm.h"
+#include "mqtt_outbox.h"
+#include "mqtt_topic_router.h"
 
 // data max len
 #define TUYA_MQTT_CLIENTID_MAXLEN   (32U)
@@ -141,35 +143,17 @@ typedef struct tuya_protocol_handle {
     void *user_data;
 } tuya_protocol_handle_t;
 
-typedef void (*mqtt_subscribe_message_cb_t)(uint16_t msgid, const mqtt_client_message_t *msg, void *userdata);
-
-typedef struct mqtt_subscribe_handle {
-    struct mqtt_subscribe_handle *next;
-    char *topic;
-    size_t topic_length;
-    mqtt_subscribe_message_cb_t cb;
-    void *userdata;
-} mqtt_subscribe_handle_t;
+typedef mqtt_topic_handler_cb_t mqtt_subscribe_message_cb_t;
 
 typedef void (*mqtt_publish_notify_cb_t)(int result, void *user_data);
 
-typedef struct mqtt_publish_handle {
-    struct mqtt_publish_handle *next;
-    uint16_t msgid;
-    int timeout;
-    char *topic;
-    uint8_t *payload;
-    size_t payload_length;
-    mqtt_publish_notify_cb_t cb;
-    void *user_data;
-} mqtt_publish_handle_t;
-
 typedef struct {
     void *mqtt_client;
     tuya_mqtt_access_t signature;
     tuya_protocol_handle_t *protocol_list;
-    mqtt_subscribe_handle_t *subscribe_list;
-    mqtt_publish_handle_t *publish_list;
+    mqtt_topic_router_t subscribe_router;
+    mqtt_client_collector_t cmd_collector; // commands streamed by the MQTT client
+    mqtt_outbox_t *outbox;
     BackoffAlgorithmContext_t backoff_algorithm;
     uint32_t sequence_in;
     uint32_t sequence_out;
@@ -0,0 +1,407 @@
+/**
+ * @file mqtt_topic_router.c
+ * @brief Dispatch of MQTT publishes to the handlers of matching filters.
+ *
+ * The root node stands for the level before the first one. A node ends the
+ * filters of its handlers, its literal children are an array sorted by level
+ * length then bytes, its '+' and '#' children are held apart. Nodes left
+ * without handlers and children are freed on removal, so the trie only ever
+ * holds the levels of the filters added.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <string.h>
+#include "tuya_error_code.h"
+#include "tal_memory.h"
+#include "mqtt_topic_router.h"
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define ROUTER_CHILD_CAP_MIN 4
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct mqtt_topic_handler {
+    struct mqtt_topic_handler *next;
+    mqtt_topic_handler_cb_t cb;
+    void *userdata;
+} mqtt_topic_handler_t;
+
+struct mqtt_topic_node {
+    mqtt_topic_node_t **children; // literal levels, sorted
+    uint16_t child_num;
+    uint16_t child_cap;
+    mqtt_topic_node_t *plus;
+    mqtt_topic_node_t *hash;
+    mqtt_topic_handler_t *handlers; // in the order they were added
+    uint16_t len;
+    char level[0];
+};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+// the end of the level starting at p
+static const char *__level_end(const char *p, const char *end)
+{
+    const char *q = memchr(p, '/', end - p);
+
+    return q ? q : end;
+}
+
+static int __level_cmp(const mqtt_topic_node_t *node, const char *level, size_t len)
+{
+    if (node->len != len) {
+        return node->len < len ? -1 : 1;
+    }
+
+    return memcmp(node->level, level, len);
+}
+
+// binary search of a literal child, pos gets where it is or would be inserted
+static mqtt_topic_node_t *__child_find(const mqtt_topic_node_t *node, const char *level, size_t len, uint16_t *pos)
+{
+    uint16_t lo = 0, hi = node->child_num, mid;
+    int cmp;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        cmp = __level_cmp(node->children[mid], level, len);
+        if (0 == cmp) {
+            lo = mid;
+            break;
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (pos) {
+        *pos = lo;
+    }
+
+    return (lo < node->child_num && 0 == __level_cmp(node->children[lo], level, len)) ? node->children[lo] : NULL;
+}
+
+static mqtt_topic_node_t *__node_new(const char *level, size_t len)
+{
+    mqtt_topic_node_t *node = tal_malloc(sizeof(mqtt_topic_node_t) + len);
+
+    if (NULL == node) {
+        return NULL;
+    }
+    memset(node, 0, sizeof(mqtt_topic_node_t));
+    memcpy(node->level, level, len);
+    node->len = (uint16_t)len;
+
+    return node;
+}
+
+static bool __node_empty(const mqtt_topic_node_t *node)
+{
+    return NULL == node->handlers && 0 == node->child_num && NULL == node->plus && NULL == node->hash;
+}
+
+static void __node_free(mqtt_topic_node_t *node)
+{
+    mqtt_topic_handler_t *handler = NULL;
+    uint16_t i;
+
+    if (NULL == node) {
+        return;
+    }
+
+    for (i = 0; i < node->child_num; i++) {
+        __node_free(node->children[i]);
+    }
+    __node_free(node->plus);
+    __node_free(node->hash);
+    while (node->handlers) {
+        handler = node->handlers;
+        node->handlers = handler->next;
+        tal_free(handler);
+    }
+    tal_free(node->children);
+    tal_free(node);
+}
+
+static int __child_insert(mqtt_topic_node_t *node, uint16_t pos, mqtt_topic_node_t *child)
+{
+    mqtt_topic_node_t **children = NULL;
+    uint32_t cap = 0;
+
+    if (node->child_num == node->child_cap) {
+        cap = node->child_cap ? node->child_cap * 2 : ROUTER_CHILD_CAP_MIN;
+        if (cap > UINT16_MAX) {
+            return OPRT_MALLOC_FAILED;
+        }
+        children = tal_malloc(cap * sizeof(mqtt_topic_node_t *));
+        if (NULL == children) {
+            return OPRT_MALLOC_FAILED;
+        }
+        if (node->children) {
+            memcpy(children, node->children, node->child_num * sizeof(mqtt_topic_node_t *));
+            tal_free(node->children);
+        }
+        node->children = children;
+        node->child_cap = (uint16_t)cap;
+    }
+
+    memmove(&node->children[pos + 1], &node->children[pos], (node->child_num - pos) * sizeof(mqtt_topic_node_t *));
+    node->children[pos] = child;
+    node->child_num++;
+
+    return OPRT_OK;
+}
+
+static void __child_erase(mqtt_topic_node_t *node, uint16_t pos)
+{
+    node->child_num--;
+    memmove(&node->children[pos], &node->children[pos + 1], (node->child_num - pos) * sizeof(mqtt_topic_node_t *));
+    if (0 == node->child_num) {
+        tal_free(node->children);
+        node->children = NULL;
+        node->child_cap = 0;
+    }
+}
+
+static bool __filter_check(const char *filter, size_t filter_len)
+{
+    const char *p = filter, *end = filter + filter_len, *q = NULL;
+
+    if (0 == filter_len || filter_len > UINT16_MAX) {
+        return false;
+    }
+
+    for (;; p = q + 1) {
+        q = __level_end(p, end);
+        if ((memchr(p, '+', q - p) || memchr(p, '#', q - p)) && 1 != q - p) {
+            return false;
+        }
+        if (1 == q - p && '#' == *p && q != end) {
+            return false;
+        }
+        if (q == end) {
+            return true;
+        }
+    }
+}
+
+void mqtt_topic_router_init(mqtt_topic_router_t *router)
+{
+    if (router) {
+        memset(router, 0, sizeof(mqtt_topic_router_t));
+    }
+}
+
+void mqtt_topic_router_deinit(mqtt_topic_router_t *router)
+{
+    if (NULL == router) {
+        return;
+    }
+
+    __node_free(router->root);
+    router->root = NULL;
+    router->handler_num = 0;
+}
+
+static void __root_prune(mqtt_topic_router_t *router)
+{
+    if (router->root && __node_empty(router->root)) {
+        __node_free(router->root);
+        router->root = NULL;
+    }
+}
+
+// p is the level below node, NULL when node ends the filter. Empty nodes on
+// the path are freed, handlers are only removed when drop is set.
+static uint32_t __node_remove(mqtt_topic_node_t *node, const char *p, const char *end, mqtt_topic_handler_cb_t cb,
+                              bool drop)
+{
+    mqtt_topic_handler_t **handler = NULL, *entry = NULL;
+    mqtt_topic_node_t *child = NULL;
+    const char *q = NULL;
+    uint32_t removed = 0;
+    uint16_t pos = 0;
+
+    if (NULL == p) {
+        for (handler = &node->handlers; drop && *handler;) {
+            entry = *handler;
+            if (NULL == cb || entry->cb == cb) {
+                *handler = entry->next;
+                tal_free(entry);
+                removed++;
+            } else {
+                handler = &entry->next;
+            }
+        }
+        return removed;
+    }
+
+    q = __level_end(p, end);
+    if (1 == q - p && '+' == *p) {
+        child = node->plus;
+    } else if (1 == q - p && '#' == *p) {
+        child = node->hash;
+    } else {
+        child = __child_find(node, p, q - p, &pos);
+    }
+    if (NULL == child) {
+        return 0;
+    }
+
+    removed = __node_remove(child, (q == end) ? NULL : q + 1, end, cb, drop);
+    if (!__node_empty(child)) {
+        return removed;
+    }
+
+    if (child == node->plus) {
+        node->plus = NULL;
+    } else if (child == node->hash) {
+        node->hash = NULL;
+    } else {
+        __child_erase(node, pos);
+    }
+    __node_free(child);
+
+    return removed;
+}
+
+int mqtt_topic_router_add(mqtt_topic_router_t *router, const char *filter, size_t filter_len,
+                          mqtt_topic_handler_cb_t cb, void *userdata)
+{
+    const char *p = filter, *end = filter + filter_len, *q = NULL;
+    mqtt_topic_node_t *node = NULL, *child = NULL, **slot = NULL;
+    mqtt_topic_handler_t **handler = NULL;
+    uint16_t pos = 0;
+
+    if (NULL == router || NULL == filter || NULL == cb || !__filter_check(filter, filter_len)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (NULL == router->root) {
+        router->root = __node_new("", 0);
+        if (NULL == router->root) {
+            return OPRT_MALLOC_FAILED;
+        }
+    }
+
+    for (node = router->root;; p = q + 1) {
+        q = __level_end(p, end);
+        if (1 == q - p && ('+' == *p || '#' == *p)) {
+            slot = ('+' == *p) ? &node->plus : &node->hash;
+            if (NULL == *slot && NULL == (*slot = __node_new(p, 1))) {
+                goto __error;
+            }
+            child = *slot;
+        } else if (NULL == (child = __child_find(node, p, q - p, &pos))) {
+            child = __node_new(p, q - p);
+            if (NULL == child) {
+                goto __error;
+            }
+            if (OPRT_OK != __child_insert(node, pos, child)) {
+                tal_free(child);
+                goto __error;
+            }
+        }
+        node = child;
+        if (q == end) {
+            break;
+        }
+    }
+
+    for (handler = &node->handlers; *handler; handler = &(*handler)->next) {
+        if ((*handler)->cb == cb && (*handler)->userdata == userdata) {
+            return OPRT_OK;
+        }
+    }
+    *handler = tal_malloc(sizeof(mqtt_topic_handler_t));
+    if (NULL == *handler) {
+        goto __error;
+    }
+    (*handler)->next = NULL;
+    (*handler)->cb = cb;
+    (*handler)->userdata = userdata;
+    router->handler_num++;
+
+    return OPRT_OK;
+
+__error:
+    // frees the nodes created for the filter
+    __node_remove(router->root, filter, end, cb, false);
+    __root_prune(router);
+    return OPRT_MALLOC_FAILED;
+}
+
+uint32_t mqtt_topic_router_remove(mqtt_topic_router_t *router, const char *filter, size_t filter_len,
+                                  mqtt_topic_handler_cb_t cb)
+{
+    uint32_t removed = 0;
+
+    if (NULL == router || NULL == router->root || NULL == filter || 0 == filter_len) {
+        return 0;
+    }
+
+    removed = __node_remove(router->root, filter, filter + filter_len, cb, true);
+    router->handler_num -= removed;
+    __root_prune(router);
+
+    return removed;
+}
+
+static uint32_t __handlers_call(const mqtt_topic_node_t *node, uint16_t msgid, const mqtt_client_message_t *msg)
+{
+    const mqtt_topic_handler_t *handler = NULL;
+    uint32_t called = 0;
+
+    for (handler = node->handlers; handler; handler = handler->next, called++) {
+        handler->cb(msgid, msg, handler->userdata);
+    }
+
+    return called;
+}
+
+// p is the level below node, NULL when the topic ends at node. Wildcards do
+// not match the first level of a topic starting with '$'.
+static uint32_t __node_match(const mqtt_topic_node_t *node, const char *p, const char *end, bool wildcard,
+                             uint16_t msgid, const mqtt_client_message_t *msg)
+{
+    const mqtt_topic_node_t *child = NULL;
+    const char *q = NULL, *next = NULL;
+    uint32_t called = 0;
+
+    // "a/#" matches "a" too
+    if (wildcard && node->hash) {
+        called += __handlers_call(node->hash, msgid, msg);
+    }
+    if (NULL == p) {
+        return called + __handlers_call(node, msgid, msg);
+    }
+
+    q = __level_end(p, end);
+    next = (q == end) ? NULL : q + 1;
+    child = __child_find(node, p, q - p, NULL);
+    if (child) {
+        called += __node_match(child, next, end, true, msgid, msg);
+    }
+    if (wildcard && node->plus) {
+        called += __node_match(node->plus, next, end, true, msgid, msg);
+    }
+
+    return called;
+}
+
+uint32_t mqtt_topic_router_dispatch(mqtt_topic_router_t *router, uint16_t msgid, const mqtt_client_message_t *msg)
+{
+    if (NULL == router || NULL == router->root || NULL == msg || NULL == msg->topic || 0 == msg->topic_length) {
+        return 0;
+    }
+
+    return __node_match(router->root, msg->topic, msg->topic + msg->topic_length, '$' != msg->topic[0], msgid, msg);
+}
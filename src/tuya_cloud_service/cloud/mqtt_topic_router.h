@@ -0,0 +1,106 @@
+/**
+ * @file mqtt_topic_router.h
+ * @brief Dispatch of MQTT publishes to the handlers of matching filters.
+ *
+ * Topic filters are compiled into a trie with one node per topic level, and
+ * the '+' and '#' wildcards of MQTT 3.1.1 as dedicated children of a node.
+ * The literal children of a node are kept sorted, so an incoming topic is
+ * matched level by level with a binary search each, however many sub-device
+ * topics are subscribed next to each other. The topic is matched where the
+ * MQTT client received it, as a length-delimited string.
+ *
+ * A filter may have several handlers, and a topic matching several filters
+ * reaches the handlers of all of them.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __MQTT_TOPIC_ROUTER_H__
+#define __MQTT_TOPIC_ROUTER_H__
+
+#include "tuya_cloud_types.h"
+#include "mqtt_client_interface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*mqtt_topic_handler_cb_t)(uint16_t msgid, const mqtt_client_message_t *msg, void *userdata);
+
+typedef struct mqtt_topic_node mqtt_topic_node_t;
+
+typedef struct {
+    mqtt_topic_node_t *root;
+    uint32_t handler_num;
+} mqtt_topic_router_t;
+
+/**
+ * @brief Initializes an empty router.
+ *
+ * @param[out] router: the router
+ *
+ * @return none
+ */
+void mqtt_topic_router_init(mqtt_topic_router_t *router);
+
+/**
+ * @brief Removes every filter and frees the trie.
+ *
+ * @param[in] router: the router
+ *
+ * @return none
+ */
+void mqtt_topic_router_deinit(mqtt_topic_router_t *router);
+
+/**
+ * @brief Adds a handler to a topic filter.
+ *
+ * Adding the same callback with the same userdata to a filter twice has no
+ * effect.
+ *
+ * @param[in] router: the router
+ * @param[in] filter: the topic filter, '+' and '#' must take a whole level
+ * and '#' must be the last one
+ * @param[in] filter_len: length of the filter
+ * @param[in] cb: called for each publish matching the filter
+ * @param[in] userdata: passed to cb
+ *
+ * @return OPRT_OK on success, OPRT_INVALID_PARM if the filter is malformed,
+ * OPRT_MALLOC_FAILED on error
+ */
+int mqtt_topic_router_add(mqtt_topic_router_t *router, const char *filter, size_t filter_len,
+                          mqtt_topic_handler_cb_t cb, void *userdata);
+
+/**
+ * @brief Removes the handlers of a topic filter.
+ *
+ * @param[in] router: the router
+ * @param[in] filter: the topic filter, as it was added
+ * @param[in] filter_len: length of the filter
+ * @param[in] cb: the callback to remove, NULL for all the handlers of the
+ * filter
+ *
+ * @return number of handlers removed
+ */
+uint32_t mqtt_topic_router_remove(mqtt_topic_router_t *router, const char *filter, size_t filter_len,
+                                  mqtt_topic_handler_cb_t cb);
+
+/**
+ * @brief Calls the handlers of every filter matching the topic of a publish.
+ *
+ * Handlers must not add or remove filters of this router while called.
+ *
+ * @param[in] router: the router
+ * @param[in] msgid: packet identifier of the publish
+ * @param[in] msg: the publish, matched on topic and topic_length
+ *
+ * @return number of handlers called
+ */
+uint32_t mqtt_topic_router_dispatch(mqtt_topic_router_t *router, uint16_t msgid, const mqtt_client_message_t *msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MQTT_TOPIC_ROUTER_H__ */
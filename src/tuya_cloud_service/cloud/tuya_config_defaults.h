@@ -97,4 +97,53 @@
 #define MATOP_TIMEOUT_MS_DEFAULT (8000U)
 #endif
 
+/**
+ * @brief Bytes kept for QoS1 messages waiting for their PUBACK.
+ */
+#ifndef MQTT_OUTBOX_BUFFER_SIZE
+#define MQTT_OUTBOX_BUFFER_SIZE (4096U)
+#endif
+
+/**
+ * @brief Heap bytes for QoS1 messages the ring has no room for, not persisted.
+ */
+#ifndef MQTT_OUTBOX_HEAP_SIZE
+#define MQTT_OUTBOX_HEAP_SIZE (16384U)
+#endif
+
+/**
+ * @brief QoS1 messages in flight at the same time.
+ */
+#ifndef MQTT_OUTBOX_WINDOW
+#define MQTT_OUTBOX_WINDOW 4
+#endif
+
+/**
+ * @brief Payload bytes in flight at the same time, a larger message is sent alone.
+ */
+#ifndef MQTT_OUTBOX_WINDOW_BYTES
+#define MQTT_OUTBOX_WINDOW_BYTES (2048U)
+#endif
+
+/**
+ * @brief Minimum interval between two saves of the outbox while offline.
+ */
+#ifndef MQTT_OUTBOX_SAVE_INTERVAL_MS
+#define MQTT_OUTBOX_SAVE_INTERVAL_MS (5000U)
+#endif
+
+/**
+ * @brief Changes of a DP within this window are merged into one report.
+ */
+#ifndef DP_REPT_SCHED_WINDOW_MS
+#define DP_REPT_SCHED_WINDOW_MS (200U)
+#endif
+
+/**
+ * @brief Default minimum interval between two reports of a DP.
+ */
+#ifndef DP_REPT_SCHED_INTERVAL_MS
+#define DP_REPT_SCHED_INTERVAL_MS (0U)
+#endif
+
 #endif /* ifndef TUYA_CONFIG_DEFAULTS_H_ */
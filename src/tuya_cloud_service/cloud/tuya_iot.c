@@ -20,6 +20,7 @@
 #include "tal_kv.h"
 #include "atop_base.h"
 #include "atop_service.h"
+#include "atop_codec.h"
 #include "mqtt_bind.h"
 #include "cJSON.h"
 #include "tal_sw_timer.h"
@@ -506,6 +507,7 @@ static int run_state_reset(tuya_iot_client_t *client)
     }
 
     tuya_mqtt_destory(&client->mqctx);
+    atop_codec_key_release();
 
     /* Save devId */
     char devid_key[32];
@@ -586,6 +588,13 @@ int tuya_iot_init(tuya_iot_client_t *client, const tuya_iot_config_t *config)
 
     tuya_health_monitor_init();
 
+#if defined(ENABLE_DP_REPT_SCHED) && (ENABLE_DP_REPT_SCHED == 1)
+    ret = tuya_iot_dp_rept_sched_init(client);
+    if (OPRT_OK != ret) {
+        return ret;
+    }
+#endif
+
     /* Auto check upgrade timer init */
     ret = tal_sw_timer_create(check_auto_upgrade_timeout_on, client, &client->check_upgrade_timer);
     if (OPRT_OK != ret) {
@@ -1006,6 +1015,7 @@ int tuya_iot_activated_data_remove(tuya_iot_client_t *client)
     dp_schema_delete(client->activate.devid);
     tal_kv_del((const char *)(client->activate.schemaId));
     tal_kv_del((const char *)(client->config.storage_namespace));
+    tal_kv_del(MQTT_OUTBOX_KV_KEY);
     tuya_endpoint_remove();
     client->is_activated = false;
     PR_INFO("Activated data remove successed");
@@ -20,6 +20,8 @@
 #include "tuya_endpoint.h"
 #include "iotdns.h"
 #include "mix_method.h"
+#include "tuya_ota_delta.h"
+#include "tuya_ota_decomp.h"
 
 typedef struct {
     tuya_ota_config_t config;
@@ -29,6 +31,16 @@ typedef struct {
     uint8_t progress_percent;
     THREAD_HANDLE upgrade_thrd;
     TKL_HASH_HANDLE sha256;
+    bool compressed;
+    bool image_started;
+    bool start_notified;
+    bool image_failed;
+#if defined(ENABLE_OTA_DELTA) && (ENABLE_OTA_DELTA == 1)
+    tuya_ota_delta_t *delta;
+#endif
+#if defined(ENABLE_OTA_COMPRESS) && (ENABLE_OTA_COMPRESS == 1)
+    tuya_ota_decomp_t *decomp;
+#endif
 } tuya_ota_t;
 
 int tuya_ota_upgrade_status_report(tuya_ota_t *handle, int status);
@@ -36,6 +48,139 @@ int tuya_ota_upgrade_progress_report(tuya_ota_t *handle, int percent);
 
 static tuya_ota_t *s_ota_ctx;
 
+/**
+ * @brief write the new image to the OTA partition
+ *
+ * @return number of bytes consumed
+ */
+static int ota_flash_write(tuya_ota_t *ota, uint8_t *data, uint32_t len, uint32_t offset, uint32_t total)
+{
+    TUYA_OTA_DATA_T ota_pack;
+    uint32_t remain_len = 0;
+
+    if (!ota->start_notified) {
+        // postponed until the image size is known, after decompression and patch headers
+        tal_ota_start_notify(total, TUYA_OTA_FULL, TUYA_OTA_PATH_AIR);
+        ota->start_notified = true;
+    }
+
+    ota_pack.total_len = total;
+    ota_pack.offset = offset;
+    ota_pack.data = data;
+    ota_pack.len = len;
+    ota_pack.pri_data = NULL;
+    tal_ota_data_process(&ota_pack, &remain_len);
+
+    return len - remain_len;
+}
+
+#if defined(ENABLE_OTA_DELTA) && (ENABLE_OTA_DELTA == 1)
+static int ota_delta_output_cb(uint8_t *data, uint32_t len, uint32_t offset, void *user_data)
+{
+    tuya_ota_t *ota = (tuya_ota_t *)user_data;
+
+    return ota_flash_write(ota, data, len, offset, tuya_ota_delta_new_size(ota->delta));
+}
+#endif
+
+/**
+ * @brief handle the image data of channel 0, either a full image or a delta patch
+ *
+ * @return number of bytes consumed
+ */
+static int ota_image_write(tuya_ota_t *ota, uint8_t *data, uint32_t len, uint32_t offset, uint32_t total)
+{
+    if (ota->image_failed) {
+        // the rest is only hashed, the failure is reported at the end
+        return len;
+    }
+
+    if (!ota->image_started) {
+        ota->image_started = true;
+#if defined(ENABLE_OTA_DELTA) && (ENABLE_OTA_DELTA == 1)
+        if (tuya_ota_delta_detect(data, len)) {
+            PR_DEBUG("delta ota patch");
+            ota->delta = tuya_ota_delta_create(ota_delta_output_cb, ota);
+            ota->image_failed = (NULL == ota->delta);
+        }
+#endif
+    }
+
+#if defined(ENABLE_OTA_DELTA) && (ENABLE_OTA_DELTA == 1)
+    if (ota->delta) {
+        ota->image_failed = (OPRT_OK != tuya_ota_delta_write(ota->delta, data, len));
+        return len;
+    }
+#endif
+
+    return ota_flash_write(ota, data, len, offset, total);
+}
+
+#if defined(ENABLE_OTA_COMPRESS) && (ENABLE_OTA_COMPRESS == 1)
+static int ota_decomp_output_cb(uint8_t *data, uint32_t len, uint32_t offset, void *user_data)
+{
+    tuya_ota_t *ota = (tuya_ota_t *)user_data;
+
+    return ota_image_write(ota, data, len, offset, tuya_ota_decomp_raw_size(ota->decomp));
+}
+#endif
+
+static void ota_data_process(tuya_ota_t *ota, http_download_event_t *event)
+{
+    int consumed;
+
+#if defined(ENABLE_OTA_COMPRESS) && (ENABLE_OTA_COMPRESS == 1)
+    if (ota->compressed) {
+        if (NULL == ota->decomp && !ota->image_failed) {
+            ota->decomp = tuya_ota_decomp_create(ota_decomp_output_cb, ota);
+            ota->image_failed = (NULL == ota->decomp);
+        }
+        if (!ota->image_failed && OPRT_OK != tuya_ota_decomp_write(ota->decomp, event->data, event->data_len)) {
+            ota->image_failed = true;
+        }
+        // the cloud hmac covers the downloaded file, not the decompressed image
+        tal_sha256_update_ret(ota->sha256, event->data, event->data_len);
+        event->remain_len = 0;
+        return;
+    }
+#endif
+
+    consumed = ota_image_write(ota, event->data, event->data_len, event->offset, event->file_size);
+    event->remain_len = event->data_len - consumed;
+    tal_sha256_update_ret(ota->sha256, event->data, consumed);
+}
+
+/**
+ * @brief flush the image pipeline of channel 0 and reset it for the next download
+ *
+ * @return true if the new image is complete and verified
+ */
+static bool ota_image_finish(tuya_ota_t *ota)
+{
+    bool ok = !ota->image_failed;
+
+#if defined(ENABLE_OTA_COMPRESS) && (ENABLE_OTA_COMPRESS == 1)
+    if (ota->decomp) {
+        ok = ok && (OPRT_OK == tuya_ota_decomp_finish(ota->decomp)) && !ota->image_failed;
+        tuya_ota_decomp_destroy(ota->decomp);
+        ota->decomp = NULL;
+    }
+#endif
+#if defined(ENABLE_OTA_DELTA) && (ENABLE_OTA_DELTA == 1)
+    if (ota->delta) {
+        ok = ok && (OPRT_OK == tuya_ota_delta_finish(ota->delta));
+        tuya_ota_delta_destroy(ota->delta);
+        ota->delta = NULL;
+    }
+#endif
+
+    ota->image_started = false;
+    ota->start_notified = false;
+    ota->image_failed = false;
+
+    return ok;
+}
+
 static void file_download_event_cb(http_download_event_id_t id, http_download_event_t *event)
 {
     tuya_ota_t *ota = (tuya_ota_t *)event->user_data;
@@ -51,13 +196,13 @@ static void file_download_event_cb(http_download_event_id_t id, http_download_ev
         tuya_ota_upgrade_status_report(ota, TUS_UPGRDING);
         tal_sha256_create_init(&ota->sha256);
         tal_sha256_starts_ret(ota->sha256, 0);
+        ota_image_finish(ota);
         break;
 
     case DL_EVENT_ON_FILESIZE:
         PR_DEBUG("DL_EVENT_ON_FILESIZE");
-        if (0 == ota->channel) {
-            tal_ota_start_notify(event->file_size, TUYA_OTA_FULL, TUYA_OTA_PATH_AIR);
-        } else if (event_cb) {
+        // channel 0 calls tal_ota_start_notify with the first image data, once the image size is known
+        if (0 != ota->channel && event_cb) {
             ota->event.id = TUYA_OTA_EVENT_START;
             ota->event.file_size = event->file_size;
             ota->event.user_data = ota->config.user_data;
@@ -69,19 +214,7 @@ static void file_download_event_cb(http_download_event_id_t id, http_download_ev
         PR_DEBUG("DL_EVENT_ON_DATA:%d", event->data_len);
         PR_DEBUG("event->file_size %d, offset:%d, last remain %d", event->file_size, event->offset, event->remain_len);
         if (0 == ota->channel) {
-            TUYA_OTA_DATA_T ota_pack;
-
-            ota_pack.total_len = event->file_size;
-            ota_pack.offset = event->offset;
-            ota_pack.data = event->data;
-            ota_pack.len = event->data_len;
-            ota_pack.pri_data = NULL;
-            tal_ota_data_process(&ota_pack, (uint32_t *)&event->remain_len);
-            if (event->remain_len) {
-                tal_sha256_update_ret(ota->sha256, event->data, event->data_len - event->remain_len);
-            } else {
-                tal_sha256_update_ret(ota->sha256, event->data, event->data_len);
-            }
+            ota_data_process(ota, event);
         } else if (event_cb) {
             ota->event.id = TUYA_OTA_EVENT_ON_DATA;
             ota->event.data = event->data;
@@ -107,6 +240,13 @@ static void file_download_event_cb(http_download_event_id_t id, http_download_ev
         tal_sha256_mac((const uint8_t *)client->activate.seckey, strlen(client->activate.seckey), file_sha256, 32 * 2,
                        file_hmac);
         ascs2hex(self_hmac, (uint8_t *)(ota->msg.fw_hmac), FW_HMAC_LEN);
+        if (0 == ota->channel && !ota_image_finish(ota)) {
+            PR_ERR("ota image check failed");
+            tuya_ota_upgrade_status_report(ota, TUS_UPGRD_EXEC);
+            // let the platform drop the partly written image
+            tal_ota_end_notify(FALSE);
+            break;
+        }
         if ((memcmp(self_hmac, file_hmac, 32) == 0)) {
             PR_DEBUG("file hmac check success");
             tuya_ota_upgrade_progress_report(ota, 100);
@@ -122,6 +262,7 @@ static void file_download_event_cb(http_download_event_id_t id, http_download_ev
 
     case DL_EVENT_FAULT:
         PR_DEBUG("DL_EVENT_FAULT");
+        ota_image_finish(ota);
         tuya_ota_upgrade_status_report(ota, TUS_UPGRD_EXEC);
         if (event_cb) {
             ota->event.id = TUYA_OTA_EVENT_FAULT;
@@ -207,6 +348,17 @@ int tuya_ota_start(cJSON *upgrade)
     strcpy(ota->msg.fw_hmac, cJSON_GetObjectItem(upgrade, "hmac")->valuestring);
     strcpy(ota->msg.fw_md5, cJSON_GetObjectItem(upgrade, "md5")->valuestring);
 
+    // optional, the firmware of channel 0 may be compressed by tools/ota/ota_compress.py
+    cJSON *compress = cJSON_GetObjectItem(upgrade, "compress");
+    ota->compressed = (compress && compress->valuestring && 0 == strcmp(compress->valuestring, "heatshrink"));
+#if !defined(ENABLE_OTA_COMPRESS) || (ENABLE_OTA_COMPRESS == 0)
+    if (ota->compressed) {
+        PR_ERR("compressed ota is not supported");
+        tuya_ota_upgrade_status_report(ota, TUS_UPGRD_EXEC);
+        return OPRT_NOT_SUPPORTED;
+    }
+#endif
+
     THREAD_CFG_T thrd_param;
     thrd_param.priority = THREAD_PRIO_3;
     thrd_param.stackDepth = 4086;
@@ -0,0 +1,356 @@
+/**
+ * @file tuya_ota_decomp.c
+ * @brief Streaming decompression of compressed OTA downloads.
+ *
+ * The data is a heatshrink (LZSS) bit stream. Bits are collected in a small
+ * accumulator so the input can be split anywhere, the history is kept in a
+ * ring buffer of 2^window_bits bytes and the output is collected in a buffer
+ * before it is handed to the output callback.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "tal_memory.h"
+#include "tal_log.h"
+#include "tuya_ota_decomp.h"
+
+#define OTA_DECOMP_OUT_BUF 512
+
+typedef enum {
+    DECOMP_ST_HEADER,
+    DECOMP_ST_TAG,
+    DECOMP_ST_LITERAL,
+    DECOMP_ST_INDEX,
+    DECOMP_ST_COUNT,
+    DECOMP_ST_DONE,
+    DECOMP_ST_ERROR,
+} decomp_state_t;
+
+struct tuya_ota_decomp {
+    decomp_state_t state;
+    tuya_ota_decomp_output_cb output_cb;
+    void *user_data;
+
+    uint8_t head[OTA_DECOMP_HEADER_SIZE];
+    uint32_t head_len;
+
+    uint8_t window_bits;
+    uint8_t lookahead_bits;
+    uint32_t raw_size;
+    uint32_t produced;
+
+    uint32_t acc;
+    uint32_t nbits;
+    uint32_t index;
+
+    uint8_t *window;
+    uint32_t window_mask;
+    uint32_t window_pos;
+
+    uint32_t out_base;
+    uint32_t out_len;
+    uint32_t out_size;
+    uint8_t *out_buf;
+};
+
+static OPERATE_RET __out_flush(tuya_ota_decomp_t *decomp)
+{
+    int consumed;
+
+    if (0 == decomp->out_len) {
+        return OPRT_OK;
+    }
+
+    consumed = decomp->output_cb(decomp->out_buf, decomp->out_len, decomp->out_base, decomp->user_data);
+    if (consumed < 0 || consumed > decomp->out_len) {
+        return OPRT_COM_ERROR;
+    }
+
+    decomp->out_len -= consumed;
+    decomp->out_base += consumed;
+    if (decomp->out_len) {
+        memmove(decomp->out_buf, decomp->out_buf + consumed, decomp->out_len);
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief doubles the output buffer, for a flash that only takes larger writes
+ */
+static OPERATE_RET __out_grow(tuya_ota_decomp_t *decomp)
+{
+    uint8_t *buf = NULL;
+
+    if (decomp->out_size >= OTA_DECOMP_OUT_BUF_MAX) {
+        PR_ERR("ota output of %d bytes not consumed", decomp->out_len);
+        return OPRT_COM_ERROR;
+    }
+
+    buf = tal_realloc(decomp->out_buf, decomp->out_size * 2);
+    if (NULL == buf) {
+        return OPRT_MALLOC_FAILED;
+    }
+    decomp->out_buf = buf;
+    decomp->out_size *= 2;
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __out_byte(tuya_ota_decomp_t *decomp, uint8_t c)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (decomp->out_size == decomp->out_len) {
+        TUYA_CALL_ERR_RETURN(__out_flush(decomp));
+        // the tail that was not consumed is given again with the next bytes
+        if (decomp->out_size == decomp->out_len) {
+            TUYA_CALL_ERR_RETURN(__out_grow(decomp));
+        }
+    }
+
+    decomp->out_buf[decomp->out_len++] = c;
+    decomp->window[decomp->window_pos] = c;
+    decomp->window_pos = (decomp->window_pos + 1) & decomp->window_mask;
+    decomp->produced++;
+    if (decomp->produced == decomp->raw_size) {
+        decomp->state = DECOMP_ST_DONE;
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __header_parse(tuya_ota_decomp_t *decomp)
+{
+    const uint8_t *h = decomp->head;
+
+    if (memcmp(h, OTA_DECOMP_MAGIC, 4)) {
+        PR_ERR("ota file is not compressed");
+        return OPRT_NOT_SUPPORTED;
+    }
+
+    decomp->window_bits = h[4];
+    decomp->lookahead_bits = h[5];
+    decomp->raw_size = h[8] | (h[9] << 8) | (h[10] << 16) | ((uint32_t)h[11] << 24);
+    if (decomp->window_bits < 8 || decomp->window_bits > OTA_DECOMP_WINDOW_BITS_MAX || decomp->lookahead_bits < 3 ||
+        decomp->lookahead_bits >= decomp->window_bits) {
+        PR_ERR("unsupported ota compression window %d/%d", decomp->window_bits, decomp->lookahead_bits);
+        return OPRT_NOT_SUPPORTED;
+    }
+
+    decomp->window = tal_malloc(1 << decomp->window_bits);
+    if (NULL == decomp->window) {
+        return OPRT_MALLOC_FAILED;
+    }
+    // back references before the start read zeros
+    memset(decomp->window, 0, 1 << decomp->window_bits);
+    decomp->window_mask = (1 << decomp->window_bits) - 1;
+
+    PR_DEBUG("ota decompress raw size:%d window:%d", decomp->raw_size, 1 << decomp->window_bits);
+    decomp->state = (0 == decomp->raw_size) ? DECOMP_ST_DONE : DECOMP_ST_TAG;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief decode the elements whose bits are all in the accumulator
+ */
+static OPERATE_RET __bits_decode(tuya_ota_decomp_t *decomp)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t need, value, count, src;
+
+    for (;;) {
+        switch (decomp->state) {
+        case DECOMP_ST_TAG:
+            need = 1;
+            break;
+        case DECOMP_ST_LITERAL:
+            need = 8;
+            break;
+        case DECOMP_ST_INDEX:
+            need = decomp->window_bits;
+            break;
+        case DECOMP_ST_COUNT:
+            need = decomp->lookahead_bits;
+            break;
+        default:
+            return OPRT_OK;
+        }
+        if (decomp->nbits < need) {
+            return OPRT_OK;
+        }
+
+        decomp->nbits -= need;
+        value = (decomp->acc >> decomp->nbits) & ((1 << need) - 1);
+        decomp->acc &= (1 << decomp->nbits) - 1;
+
+        switch (decomp->state) {
+        case DECOMP_ST_TAG:
+            decomp->state = value ? DECOMP_ST_LITERAL : DECOMP_ST_INDEX;
+            break;
+
+        case DECOMP_ST_LITERAL:
+            decomp->state = DECOMP_ST_TAG;
+            TUYA_CALL_ERR_RETURN(__out_byte(decomp, (uint8_t)value));
+            break;
+
+        case DECOMP_ST_INDEX:
+            decomp->index = value + 1;
+            decomp->state = DECOMP_ST_COUNT;
+            break;
+
+        case DECOMP_ST_COUNT:
+            decomp->state = DECOMP_ST_TAG;
+            count = value + 1;
+            src = decomp->window_pos - decomp->index;
+            // the copy may overlap its own output, go byte by byte
+            while (count-- && DECOMP_ST_DONE != decomp->state) {
+                TUYA_CALL_ERR_RETURN(__out_byte(decomp, decomp->window[src++ & decomp->window_mask]));
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Creates a decompressor.
+ *
+ * @param output_cb called with the decompressed data
+ * @param user_data passed to output_cb
+ *
+ * @return the decompressor, NULL on error
+ */
+tuya_ota_decomp_t *tuya_ota_decomp_create(tuya_ota_decomp_output_cb output_cb, void *user_data)
+{
+    tuya_ota_decomp_t *decomp = NULL;
+
+    if (NULL == output_cb) {
+        return NULL;
+    }
+
+    decomp = tal_malloc(sizeof(tuya_ota_decomp_t));
+    if (NULL == decomp) {
+        return NULL;
+    }
+    memset(decomp, 0, sizeof(tuya_ota_decomp_t));
+    decomp->out_buf = tal_malloc(OTA_DECOMP_OUT_BUF);
+    if (NULL == decomp->out_buf) {
+        tal_free(decomp);
+        return NULL;
+    }
+    decomp->out_size = OTA_DECOMP_OUT_BUF;
+    decomp->output_cb = output_cb;
+    decomp->user_data = user_data;
+    decomp->state = DECOMP_ST_HEADER;
+
+    return decomp;
+}
+
+/**
+ * @brief Feeds compressed data, all of it is consumed.
+ *
+ * @param decomp the decompressor
+ * @param data compressed data
+ * @param len data length
+ *
+ * @return OPRT_OK on success, an error if the data is corrupted
+ */
+OPERATE_RET tuya_ota_decomp_write(tuya_ota_decomp_t *decomp, const uint8_t *data, size_t len)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t n;
+
+    if (NULL == decomp || (NULL == data && len)) {
+        return OPRT_INVALID_PARM;
+    }
+    if (DECOMP_ST_ERROR == decomp->state) {
+        return OPRT_COM_ERROR;
+    }
+
+    if (DECOMP_ST_HEADER == decomp->state) {
+        n = OTA_DECOMP_HEADER_SIZE - decomp->head_len;
+        n = (n > len) ? len : n;
+        memcpy(decomp->head + decomp->head_len, data, n);
+        decomp->head_len += n;
+        data += n;
+        len -= n;
+        if (decomp->head_len == OTA_DECOMP_HEADER_SIZE) {
+            rt = __header_parse(decomp);
+        }
+    }
+
+    // the padding bits after the last element are ignored
+    while (OPRT_OK == rt && len && DECOMP_ST_DONE != decomp->state) {
+        decomp->acc = (decomp->acc << 8) | *data++;
+        decomp->nbits += 8;
+        len--;
+        rt = __bits_decode(decomp);
+    }
+
+    if (OPRT_OK != rt) {
+        PR_ERR("ota decompress failed %d at %d", rt, decomp->produced);
+        decomp->state = DECOMP_ST_ERROR;
+    }
+
+    return rt;
+}
+
+/**
+ * @brief Gets the size of the decompressed file.
+ *
+ * @param decomp the decompressor
+ *
+ * @return the size, 0 while the header has not been received
+ */
+uint32_t tuya_ota_decomp_raw_size(tuya_ota_decomp_t *decomp)
+{
+    return decomp ? decomp->raw_size : 0;
+}
+
+/**
+ * @brief Flushes the decompressed data.
+ *
+ * @param decomp the decompressor
+ *
+ * @return OPRT_OK if the whole file was decompressed and consumed
+ */
+OPERATE_RET tuya_ota_decomp_finish(tuya_ota_decomp_t *decomp)
+{
+    uint32_t last;
+
+    if (NULL == decomp || DECOMP_ST_DONE != decomp->state) {
+        return OPRT_COM_ERROR;
+    }
+
+    while (decomp->out_len) {
+        last = decomp->out_len;
+        if (OPRT_OK != __out_flush(decomp) || last == decomp->out_len) {
+            return OPRT_COM_ERROR;
+        }
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Destroys the decompressor.
+ *
+ * @param decomp the decompressor
+ */
+void tuya_ota_decomp_destroy(tuya_ota_decomp_t *decomp)
+{
+    if (NULL == decomp) {
+        return;
+    }
+
+    if (decomp->window) {
+        tal_free(decomp->window);
+    }
+    tal_free(decomp->out_buf);
+    tal_free(decomp);
+}
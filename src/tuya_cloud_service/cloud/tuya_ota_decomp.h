@@ -0,0 +1,102 @@
+/**
+ * @file tuya_ota_decomp.h
+ * @brief Streaming decompression of compressed OTA downloads.
+ *
+ * Compressed files are built by tools/ota/ota_compress.py and flagged in the
+ * upgrade info with "compress": "heatshrink". The data is decompressed as it
+ * is downloaded through a window whose size is set by the file and limited by
+ * OTA_DECOMP_WINDOW_BITS_MAX, and the output is handed to a callback.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __TUYA_OTA_DECOMP_H__
+#define __TUYA_OTA_DECOMP_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_DECOMP_MAGIC       "TYHS"
+#define OTA_DECOMP_HEADER_SIZE 12
+
+#ifndef OTA_DECOMP_WINDOW_BITS_MAX
+#define OTA_DECOMP_WINDOW_BITS_MAX 12
+#endif
+
+/* the output buffer grows up to this size while the callback consumes nothing,
+ * e.g. a flash written a sector at a time */
+#ifndef OTA_DECOMP_OUT_BUF_MAX
+#define OTA_DECOMP_OUT_BUF_MAX 8192
+#endif
+
+/**
+ * @brief Output callback, receives the decompressed data in order
+ *
+ * @param data decompressed data
+ * @param len data length
+ * @param offset offset of data in the decompressed file
+ * @param user_data user data given at creation
+ *
+ * @return number of bytes consumed, the rest is given again with more data.
+ *         Consuming nothing is allowed until OTA_DECOMP_OUT_BUF_MAX bytes are
+ *         waiting. A negative value aborts the decompression.
+ */
+typedef int (*tuya_ota_decomp_output_cb)(uint8_t *data, uint32_t len, uint32_t offset, void *user_data);
+
+typedef struct tuya_ota_decomp tuya_ota_decomp_t;
+
+/**
+ * @brief Creates a decompressor.
+ *
+ * @param output_cb called with the decompressed data
+ * @param user_data passed to output_cb
+ *
+ * @return the decompressor, NULL on error
+ */
+tuya_ota_decomp_t *tuya_ota_decomp_create(tuya_ota_decomp_output_cb output_cb, void *user_data);
+
+/**
+ * @brief Feeds compressed data, all of it is consumed.
+ *
+ * @param decomp the decompressor
+ * @param data compressed data
+ * @param len data length
+ *
+ * @return OPRT_OK on success, an error if the data is corrupted
+ */
+OPERATE_RET tuya_ota_decomp_write(tuya_ota_decomp_t *decomp, const uint8_t *data, size_t len);
+
+/**
+ * @brief Gets the size of the decompressed file.
+ *
+ * @param decomp the decompressor
+ *
+ * @return the size, 0 while the header has not been received
+ */
+uint32_t tuya_ota_decomp_raw_size(tuya_ota_decomp_t *decomp);
+
+/**
+ * @brief Flushes the decompressed data.
+ *
+ * @param decomp the decompressor
+ *
+ * @return OPRT_OK if the whole file was decompressed and consumed
+ */
+OPERATE_RET tuya_ota_decomp_finish(tuya_ota_decomp_t *decomp);
+
+/**
+ * @brief Destroys the decompressor.
+ *
+ * @param decomp the decompressor
+ */
+void tuya_ota_decomp_destroy(tuya_ota_decomp_t *decomp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TUYA_OTA_DECOMP_H__ */
@@ -0,0 +1,588 @@
+/**
+ * @file tuya_ota_delta.c
+ * @brief Streaming application of delta OTA patches.
+ *
+ * The patch is parsed by a byte driven state machine, so it can be fed in
+ * chunks of any size. The old image is read from flash through a small window
+ * and the new image is collected in an output buffer before it is handed to
+ * the output callback. The old image is hashed along the way, in step with the
+ * new image produced, so no single write stalls the download for the whole
+ * partition. The format is described in tools/ota/ota_delta.py.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "tal_memory.h"
+#include "tal_log.h"
+#include "tal_hash.h"
+#include "tkl_flash.h"
+#include "tuya_ota_delta.h"
+
+#define OTA_DELTA_RECORD_SIZE 12
+#define OTA_DELTA_OLD_WINDOW  512
+#define OTA_DELTA_OUT_BUF     1024
+
+typedef enum {
+    DELTA_ST_HEADER,
+    DELTA_ST_RECORD,
+    DELTA_ST_DIFF_TOKEN,
+    DELTA_ST_DIFF_RUN,
+    DELTA_ST_DIFF_LITERAL,
+    DELTA_ST_EXTRA,
+    DELTA_ST_DONE,
+    DELTA_ST_ERROR,
+} delta_state_t;
+
+struct tuya_ota_delta {
+    delta_state_t state;
+    tuya_ota_delta_output_cb output_cb;
+    void *user_data;
+
+    uint8_t head[OTA_DELTA_HEADER_SIZE];
+    uint32_t head_len;
+    uint8_t token;
+
+    uint32_t old_addr;
+    uint32_t old_size;
+    uint32_t new_size;
+    uint8_t old_sha256[32];
+    uint8_t new_sha256[32];
+    TKL_HASH_HANDLE sha256;
+    TKL_HASH_HANDLE old_hash;
+    uint32_t old_hashed;
+    bool old_checked;
+    uint8_t hash_buf[OTA_DELTA_OLD_WINDOW];
+
+    uint32_t old_pos;
+    uint32_t diff_left;
+    uint32_t extra_left;
+    int32_t seek;
+    uint32_t run_left;
+
+    uint32_t window_addr;
+    uint32_t window_len;
+    uint8_t window[OTA_DELTA_OLD_WINDOW];
+
+    uint32_t out_base; // new image offset of out_buf[0]
+    uint32_t out_len;
+    uint32_t out_size;
+    uint32_t produced;
+    uint8_t *out_buf;
+};
+
+static uint32_t __get_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static OPERATE_RET __old_read(tuya_ota_delta_t *delta, uint32_t pos, uint8_t **data, uint32_t *len)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (pos < delta->window_addr || pos >= delta->window_addr + delta->window_len) {
+        delta->window_addr = pos;
+        delta->window_len = delta->old_size - pos;
+        if (delta->window_len > OTA_DELTA_OLD_WINDOW) {
+            delta->window_len = OTA_DELTA_OLD_WINDOW;
+        }
+        rt = tkl_flash_read(delta->old_addr + pos, delta->window, delta->window_len);
+        if (OPRT_OK != rt) {
+            delta->window_len = 0;
+            return rt;
+        }
+    }
+
+    *data = delta->window + (pos - delta->window_addr);
+    if (*len > delta->window_addr + delta->window_len - pos) {
+        *len = delta->window_addr + delta->window_len - pos;
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __out_flush(tuya_ota_delta_t *delta)
+{
+    int consumed;
+
+    if (0 == delta->out_len) {
+        return OPRT_OK;
+    }
+
+    consumed = delta->output_cb(delta->out_buf, delta->out_len, delta->out_base, delta->user_data);
+    if (consumed < 0 || consumed > delta->out_len) {
+        return OPRT_COM_ERROR;
+    }
+
+    delta->out_len -= consumed;
+    delta->out_base += consumed;
+    if (delta->out_len) {
+        memmove(delta->out_buf, delta->out_buf + consumed, delta->out_len);
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief doubles the output buffer, for a flash that only takes larger writes
+ */
+static OPERATE_RET __out_grow(tuya_ota_delta_t *delta)
+{
+    uint8_t *buf = NULL;
+
+    if (delta->out_size >= OTA_DELTA_OUT_BUF_MAX) {
+        PR_ERR("ota output of %d bytes not consumed", delta->out_len);
+        return OPRT_COM_ERROR;
+    }
+
+    buf = tal_realloc(delta->out_buf, delta->out_size * 2);
+    if (NULL == buf) {
+        return OPRT_MALLOC_FAILED;
+    }
+    delta->out_buf = buf;
+    delta->out_size *= 2;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief reserve room in the output buffer
+ *
+ * @return the number of bytes that can be written at out_buf + out_len, 0 on error
+ */
+static uint32_t __out_room(tuya_ota_delta_t *delta)
+{
+    if (delta->out_len == delta->out_size) {
+        if (OPRT_OK != __out_flush(delta)) {
+            return 0;
+        }
+        // the tail that was not consumed is given again with the next bytes
+        if (delta->out_len == delta->out_size && OPRT_OK != __out_grow(delta)) {
+            return 0;
+        }
+    }
+
+    return delta->out_size - delta->out_len;
+}
+
+static void __out_commit(tuya_ota_delta_t *delta, uint32_t len)
+{
+    tal_sha256_update_ret(delta->sha256, delta->out_buf + delta->out_len, len);
+    delta->out_len += len;
+    delta->produced += len;
+}
+
+/**
+ * @brief copy old image bytes to the output, adding the diff bytes if any
+ */
+static OPERATE_RET __out_old(tuya_ota_delta_t *delta, const uint8_t *diff, uint32_t len)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint8_t *old = NULL;
+    uint32_t n, i;
+
+    while (len) {
+        n = __out_room(delta);
+        if (0 == n) {
+            return OPRT_COM_ERROR;
+        }
+        n = (n > len) ? len : n;
+        TUYA_CALL_ERR_RETURN(__old_read(delta, delta->old_pos, &old, &n));
+
+        if (diff) {
+            for (i = 0; i < n; i++) {
+                delta->out_buf[delta->out_len + i] = old[i] + diff[i];
+            }
+            diff += n;
+        } else {
+            memcpy(delta->out_buf + delta->out_len, old, n);
+        }
+        __out_commit(delta, n);
+        delta->old_pos += n;
+        delta->diff_left -= n;
+        len -= n;
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __out_extra(tuya_ota_delta_t *delta, const uint8_t *data, uint32_t len)
+{
+    uint32_t n;
+
+    while (len) {
+        n = __out_room(delta);
+        if (0 == n) {
+            return OPRT_COM_ERROR;
+        }
+        n = (n > len) ? len : n;
+        memcpy(delta->out_buf + delta->out_len, data, n);
+        __out_commit(delta, n);
+        data += n;
+        delta->extra_left -= n;
+        len -= n;
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __old_image_locate(tuya_ota_delta_t *delta)
+{
+    OPERATE_RET rt = OPRT_OK;
+    TUYA_FLASH_BASE_INFO_T info;
+
+    memset(&info, 0, sizeof(info));
+    TUYA_CALL_ERR_RETURN(tkl_flash_get_one_type_info(TUYA_FLASH_TYPE_APP, &info));
+    if (0 == info.partition_num || delta->old_size > info.partition[0].size) {
+        PR_ERR("delta old image size %d exceeds app partition", delta->old_size);
+        return OPRT_INVALID_PARM;
+    }
+    delta->old_addr = info.partition[0].start_addr;
+
+    tal_sha256_starts_ret(delta->old_hash, 0);
+    tal_sha256_starts_ret(delta->sha256, 0);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief hash the old image up to the share of the new image produced so far
+ *
+ * @note The whole old image is hashed once the new one is complete, then it
+ *       is checked against the patch header.
+ */
+static OPERATE_RET __old_image_check(tuya_ota_delta_t *delta)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint8_t sha256[32];
+    uint32_t until = delta->old_size, n;
+
+    if (delta->old_checked) {
+        return OPRT_OK;
+    }
+
+    if (delta->produced < delta->new_size) {
+        until = (uint32_t)((uint64_t)delta->old_size * delta->produced / delta->new_size);
+    }
+    while (delta->old_hashed < until) {
+        n = until - delta->old_hashed;
+        n = (n > OTA_DELTA_OLD_WINDOW) ? OTA_DELTA_OLD_WINDOW : n;
+        TUYA_CALL_ERR_RETURN(tkl_flash_read(delta->old_addr + delta->old_hashed, delta->hash_buf, n));
+        tal_sha256_update_ret(delta->old_hash, delta->hash_buf, n);
+        delta->old_hashed += n;
+    }
+    if (delta->old_hashed < delta->old_size) {
+        return OPRT_OK;
+    }
+
+    tal_sha256_finish_ret(delta->old_hash, sha256);
+    delta->old_checked = true;
+    if (memcmp(sha256, delta->old_sha256, 32)) {
+        PR_ERR("delta patch does not apply to the running image");
+        return OPRT_COM_ERROR;
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __header_parse(tuya_ota_delta_t *delta)
+{
+    const uint8_t *h = delta->head;
+
+    if (memcmp(h, OTA_DELTA_MAGIC, OTA_DELTA_MAGIC_LEN) || OTA_DELTA_VERSION != (h[4] | (h[5] << 8))) {
+        PR_ERR("unsupported delta patch");
+        return OPRT_NOT_SUPPORTED;
+    }
+
+    delta->old_size = __get_u32(h + 8);
+    delta->new_size = __get_u32(h + 12);
+    memcpy(delta->old_sha256, h + 16, 32);
+    memcpy(delta->new_sha256, h + 48, 32);
+    PR_DEBUG("delta patch old size:%d new size:%d", delta->old_size, delta->new_size);
+
+    return __old_image_locate(delta);
+}
+
+static OPERATE_RET __record_parse(tuya_ota_delta_t *delta)
+{
+    delta->diff_left = __get_u32(delta->head);
+    delta->extra_left = __get_u32(delta->head + 4);
+    delta->seek = (int32_t)__get_u32(delta->head + 8);
+
+    if (delta->diff_left > delta->new_size - delta->produced ||
+        delta->extra_left > delta->new_size - delta->produced - delta->diff_left ||
+        delta->diff_left > delta->old_size - delta->old_pos) {
+        PR_ERR("delta record out of range");
+        return OPRT_COM_ERROR;
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief move to the state following the current diff or extra block
+ */
+static OPERATE_RET __record_next(tuya_ota_delta_t *delta)
+{
+    int64_t pos;
+
+    if (delta->diff_left) {
+        delta->state = DELTA_ST_DIFF_TOKEN;
+        return OPRT_OK;
+    }
+    if (delta->extra_left) {
+        delta->state = DELTA_ST_EXTRA;
+        return OPRT_OK;
+    }
+
+    pos = (int64_t)delta->old_pos + delta->seek;
+    if (pos < 0 || pos > delta->old_size) {
+        PR_ERR("delta seek out of range");
+        return OPRT_COM_ERROR;
+    }
+    delta->old_pos = (uint32_t)pos;
+    delta->head_len = 0;
+    delta->state = (delta->produced == delta->new_size) ? DELTA_ST_DONE : DELTA_ST_RECORD;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Checks whether a download starts with a delta patch header.
+ *
+ * @param data first bytes of the download
+ * @param len data length
+ *
+ * @return true if the data is a delta patch
+ */
+bool tuya_ota_delta_detect(const uint8_t *data, size_t len)
+{
+    return (data && len >= OTA_DELTA_MAGIC_LEN && 0 == memcmp(data, OTA_DELTA_MAGIC, OTA_DELTA_MAGIC_LEN));
+}
+
+/**
+ * @brief Creates a patch applier reading the old image from the APP partition.
+ *
+ * @param output_cb called with the new image data
+ * @param user_data passed to output_cb
+ *
+ * @return the applier, NULL on error
+ */
+tuya_ota_delta_t *tuya_ota_delta_create(tuya_ota_delta_output_cb output_cb, void *user_data)
+{
+    tuya_ota_delta_t *delta = NULL;
+
+    if (NULL == output_cb) {
+        return NULL;
+    }
+
+    delta = tal_malloc(sizeof(tuya_ota_delta_t));
+    if (NULL == delta) {
+        return NULL;
+    }
+    memset(delta, 0, sizeof(tuya_ota_delta_t));
+
+    delta->out_buf = tal_malloc(OTA_DELTA_OUT_BUF);
+    if (NULL == delta->out_buf) {
+        tal_free(delta);
+        return NULL;
+    }
+    delta->out_size = OTA_DELTA_OUT_BUF;
+
+    if (OPRT_OK != tal_sha256_create_init(&delta->sha256)) {
+        tal_free(delta->out_buf);
+        tal_free(delta);
+        return NULL;
+    }
+    if (OPRT_OK != tal_sha256_create_init(&delta->old_hash)) {
+        tal_sha256_free(delta->sha256);
+        tal_free(delta->out_buf);
+        tal_free(delta);
+        return NULL;
+    }
+    delta->output_cb = output_cb;
+    delta->user_data = user_data;
+    delta->state = DELTA_ST_HEADER;
+
+    return delta;
+}
+
+/**
+ * @brief Feeds patch data, all of it is consumed.
+ *
+ * @param delta the applier
+ * @param data patch data
+ * @param len data length
+ *
+ * @return OPRT_OK on success, an error if the patch is corrupted or does not
+ *         apply to the running image.
+ */
+OPERATE_RET tuya_ota_delta_write(tuya_ota_delta_t *delta, const uint8_t *data, size_t len)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t n;
+
+    if (NULL == delta || (NULL == data && len)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    while (len && OPRT_OK == rt) {
+        switch (delta->state) {
+        case DELTA_ST_HEADER:
+        case DELTA_ST_RECORD: {
+            uint32_t need = (DELTA_ST_HEADER == delta->state) ? OTA_DELTA_HEADER_SIZE : OTA_DELTA_RECORD_SIZE;
+            n = need - delta->head_len;
+            n = (n > len) ? len : n;
+            memcpy(delta->head + delta->head_len, data, n);
+            delta->head_len += n;
+            data += n;
+            len -= n;
+            if (delta->head_len < need) {
+                break;
+            }
+            if (DELTA_ST_HEADER == delta->state) {
+                rt = __header_parse(delta);
+                delta->head_len = 0;
+                delta->state = (0 == delta->new_size) ? DELTA_ST_DONE : DELTA_ST_RECORD;
+            } else {
+                rt = __record_parse(delta);
+                if (OPRT_OK == rt) {
+                    rt = __record_next(delta);
+                }
+            }
+            break;
+        }
+
+        case DELTA_ST_DIFF_TOKEN:
+            delta->token = *data++;
+            len--;
+            if (delta->token & 0x80) {
+                delta->state = DELTA_ST_DIFF_RUN;
+            } else {
+                delta->run_left = delta->token + 1;
+                if (delta->run_left > delta->diff_left) {
+                    rt = OPRT_COM_ERROR;
+                    break;
+                }
+                delta->state = DELTA_ST_DIFF_LITERAL;
+            }
+            break;
+
+        case DELTA_ST_DIFF_RUN:
+            delta->run_left = (((delta->token & 0x7F) << 8) | *data++) + 1;
+            len--;
+            if (delta->run_left > delta->diff_left) {
+                rt = OPRT_COM_ERROR;
+                break;
+            }
+            // zero diff bytes, the old image is copied as it is
+            rt = __out_old(delta, NULL, delta->run_left);
+            if (OPRT_OK == rt) {
+                rt = __record_next(delta);
+            }
+            break;
+
+        case DELTA_ST_DIFF_LITERAL:
+            n = (delta->run_left > len) ? len : delta->run_left;
+            rt = __out_old(delta, data, n);
+            data += n;
+            len -= n;
+            delta->run_left -= n;
+            if (OPRT_OK == rt && 0 == delta->run_left) {
+                rt = __record_next(delta);
+            }
+            break;
+
+        case DELTA_ST_EXTRA:
+            n = (delta->extra_left > len) ? len : delta->extra_left;
+            rt = __out_extra(delta, data, n);
+            data += n;
+            len -= n;
+            if (OPRT_OK == rt && 0 == delta->extra_left) {
+                rt = __record_next(delta);
+            }
+            break;
+
+        case DELTA_ST_DONE:
+            // trailing bytes, e.g. padding added by the server
+            len = 0;
+            break;
+
+        default:
+            rt = OPRT_COM_ERROR;
+            break;
+        }
+    }
+
+    if (OPRT_OK == rt && DELTA_ST_HEADER != delta->state) {
+        rt = __old_image_check(delta);
+    }
+
+    if (OPRT_OK != rt) {
+        PR_ERR("delta patch apply failed %d at %d", rt, delta->produced);
+        delta->state = DELTA_ST_ERROR;
+    }
+
+    return rt;
+}
+
+/**
+ * @brief Gets the size of the new image.
+ *
+ * @param delta the applier
+ *
+ * @return the size, 0 while the patch header has not been received
+ */
+uint32_t tuya_ota_delta_new_size(tuya_ota_delta_t *delta)
+{
+    return (delta && DELTA_ST_HEADER != delta->state) ? delta->new_size : 0;
+}
+
+/**
+ * @brief Flushes the new image and checks its SHA256.
+ *
+ * @param delta the applier
+ *
+ * @return OPRT_OK if the whole new image was produced and matches the patch
+ */
+OPERATE_RET tuya_ota_delta_finish(tuya_ota_delta_t *delta)
+{
+    uint8_t sha256[32];
+    uint32_t last;
+
+    if (NULL == delta || DELTA_ST_DONE != delta->state || !delta->old_checked) {
+        return OPRT_COM_ERROR;
+    }
+
+    while (delta->out_len) {
+        last = delta->out_len;
+        if (OPRT_OK != __out_flush(delta) || last == delta->out_len) {
+            return OPRT_COM_ERROR;
+        }
+    }
+
+    tal_sha256_finish_ret(delta->sha256, sha256);
+    if (memcmp(sha256, delta->new_sha256, 32)) {
+        PR_ERR("delta new image sha256 mismatch");
+        return OPRT_COM_ERROR;
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Destroys the applier.
+ *
+ * @param delta the applier
+ */
+void tuya_ota_delta_destroy(tuya_ota_delta_t *delta)
+{
+    if (NULL == delta) {
+        return;
+    }
+
+    tal_sha256_free(delta->sha256);
+    tal_sha256_free(delta->old_hash);
+    tal_free(delta->out_buf);
+    tal_free(delta);
+}
@@ -0,0 +1,111 @@
+/**
+ * @file tuya_ota_delta.h
+ * @brief Streaming application of delta OTA patches.
+ *
+ * A delta patch, built by tools/ota/ota_delta.py, turns the image running in
+ * the APP partition into the new image. The patch is fed as it is downloaded
+ * and the new image is produced through an output callback, so the RAM used
+ * does not depend on the image or patch size.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __TUYA_OTA_DELTA_H__
+#define __TUYA_OTA_DELTA_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_DELTA_MAGIC       "TYDF"
+#define OTA_DELTA_MAGIC_LEN   4
+#define OTA_DELTA_VERSION     1
+#define OTA_DELTA_HEADER_SIZE 80
+
+/* the output buffer grows up to this size while the callback consumes nothing,
+ * e.g. a flash written a sector at a time */
+#ifndef OTA_DELTA_OUT_BUF_MAX
+#define OTA_DELTA_OUT_BUF_MAX 8192
+#endif
+
+/**
+ * @brief Output callback, receives the new image in order
+ *
+ * @param data new image data
+ * @param len data length
+ * @param offset offset of data in the new image
+ * @param user_data user data given at creation
+ *
+ * @return number of bytes consumed, the rest is given again with more data.
+ *         Consuming nothing is allowed until OTA_DELTA_OUT_BUF_MAX bytes are
+ *         waiting. A negative value aborts the patch.
+ */
+typedef int (*tuya_ota_delta_output_cb)(uint8_t *data, uint32_t len, uint32_t offset, void *user_data);
+
+typedef struct tuya_ota_delta tuya_ota_delta_t;
+
+/**
+ * @brief Checks whether a download starts with a delta patch header.
+ *
+ * @param data first bytes of the download
+ * @param len data length
+ *
+ * @return true if the data is a delta patch
+ */
+bool tuya_ota_delta_detect(const uint8_t *data, size_t len);
+
+/**
+ * @brief Creates a patch applier reading the old image from the APP partition.
+ *
+ * @param output_cb called with the new image data
+ * @param user_data passed to output_cb
+ *
+ * @return the applier, NULL on error
+ */
+tuya_ota_delta_t *tuya_ota_delta_create(tuya_ota_delta_output_cb output_cb, void *user_data);
+
+/**
+ * @brief Feeds patch data, all of it is consumed.
+ *
+ * @param delta the applier
+ * @param data patch data
+ * @param len data length
+ *
+ * @return OPRT_OK on success, an error if the patch is corrupted or does not
+ *         apply to the running image.
+ */
+OPERATE_RET tuya_ota_delta_write(tuya_ota_delta_t *delta, const uint8_t *data, size_t len);
+
+/**
+ * @brief Gets the size of the new image.
+ *
+ * @param delta the applier
+ *
+ * @return the size, 0 while the patch header has not been received
+ */
+uint32_t tuya_ota_delta_new_size(tuya_ota_delta_t *delta);
+
+/**
+ * @brief Flushes the new image and checks its SHA256.
+ *
+ * @param delta the applier
+ *
+ * @return OPRT_OK if the whole new image was produced and matches the patch
+ */
+OPERATE_RET tuya_ota_delta_finish(tuya_ota_delta_t *delta);
+
+/**
+ * @brief Destroys the applier.
+ *
+ * @param delta the applier
+ */
+void tuya_ota_delta_destroy(tuya_ota_delta_t *delta);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TUYA_OTA_DELTA_H__ */
@@ -92,6 +92,9 @@ typedef struct {
 
     tuya_iot_client_t *iot_client;
     lan_cfg_t *cfg;
+    // HMAC of the session handshake, keyed with localkey_mac_key
+    tal_hash_mac_key_t *localkey_mac;
+    char localkey_mac_key[MAX_LENGTH_LOCALKEY + 1];
     // extension
     uint32_t recv_offset;
     uint8_t recv_buf[0]; // keep it last !!!
@@ -111,6 +114,28 @@ static lan_mgr_t *lan_mgr_get(void)
     return s_lan_mgr;
 }
 
+static int lan_localkey_hmac(lan_mgr_t *lan, const uint8_t *input, size_t ilen, uint8_t output[HMAC_LEN])
+{
+    const char *localkey = lan->iot_client->activate.localkey;
+    int ret = OPRT_OK;
+
+    // the key only changes with a new activation
+    if (lan->localkey_mac && strcmp(lan->localkey_mac_key, localkey)) {
+        tal_hash_mac_key_free(lan->localkey_mac);
+        lan->localkey_mac = NULL;
+    }
+    if (NULL == lan->localkey_mac) {
+        ret = tal_hash_mac_key_create(TAL_HASH_MAC_SHA256, (const uint8_t *)localkey, strlen(localkey),
+                                      &lan->localkey_mac);
+        if (OPRT_OK != ret) {
+            return ret;
+        }
+        snprintf(lan->localkey_mac_key, sizeof(lan->localkey_mac_key), "%s", localkey);
+    }
+
+    return tal_hash_mac_key_sign(lan->localkey_mac, input, ilen, output);
+}
+
 static void lan_session_free(lan_session_t *session)
 {
     memset(session, 0, sizeof(lan_session_t));
@@ -740,8 +765,7 @@ static void lan_protocol_process(lan_mgr_t *lan, lan_session_t *session, lpv35_f
         // randA
         memcpy(session->randA, out, RAND_LEN);
         // hmac randA
-        tal_sha256_mac((const uint8_t *)s_lan_mgr->iot_client->activate.localkey,
-                       strlen(s_lan_mgr->iot_client->activate.localkey), session->randA, RAND_LEN, session->hmac);
+        lan_localkey_hmac(lan, session->randA, RAND_LEN, session->hmac);
         // make randB
         uni_random_string((char *)(session->randB), RAND_LEN);
         // make frame buffer
@@ -764,8 +788,7 @@ static void lan_protocol_process(lan_mgr_t *lan, lan_session_t *session, lpv35_f
             break;
         }
         // hmac randB local
-        tal_sha256_mac((const uint8_t *)s_lan_mgr->iot_client->activate.localkey,
-                       strlen(s_lan_mgr->iot_client->activate.localkey), session->randB, RAND_LEN, session->hmac);
+        lan_localkey_hmac(lan, session->randB, RAND_LEN, session->hmac);
         // verify hmac
         if (memcmp(session->hmac, out, HMAC_LEN) != 0) {
             PR_ERR("verify hmac randB ERROR");
@@ -1324,6 +1347,8 @@ int tuya_lan_exit(void)
     }
     tal_mutex_release(s_lan_mgr->mutex);
     tal_mutex_release(s_lan_mgr->tcp_mutex);
+    tal_hash_mac_key_free(s_lan_mgr->localkey_mac);
+    memset(s_lan_mgr->localkey_mac_key, 0, sizeof(s_lan_mgr->localkey_mac_key));
     tal_free(s_lan_mgr);
     s_lan_mgr = NULL;
 
@@ -0,0 +1,386 @@
+/**
+ * @file dp_rept_sched.c
+ * @brief Coalescing scheduler for object DP reports.
+ *
+ * Every DP seen gets a slot that keeps its rule, its last report time and the
+ * value waiting to be reported. Waiting DPs are reported in the order their
+ * first waiting change arrived, so a burst keeps its order once merged. The
+ * values taken out count as reported, a report that fails is dropped like a
+ * direct report, the DP sync started by the report path takes care of the
+ * cloud state.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "tuya_cloud_types.h"
+#include "tal_api.h"
+#include "dp_rept_sched.h"
+
+typedef struct {
+    dp_obj_t dp;
+    uint32_t interval_ms;
+    uint32_t first_ms;
+    uint32_t last_ms;
+    uint32_t order;
+    uint8_t pending : 1;
+    uint8_t reported : 1;
+    uint8_t critical : 1;
+} dp_rept_slot_t;
+
+struct dp_rept_sched {
+    uint32_t window_ms;
+    uint32_t interval_ms;
+    uint32_t order;
+    uint8_t num;
+    uint8_t pending;
+    bool force;
+    dp_rept_slot_t slot[MAX_DP_NUM];
+    uint8_t out_slot[MAX_DP_NUM];
+};
+
+static dp_rept_slot_t *__slot_get(dp_rept_sched_t *sched, uint8_t dpid)
+{
+    dp_rept_slot_t *slot;
+    uint8_t i;
+
+    for (i = 0; i < sched->num; i++) {
+        if (sched->slot[i].dp.id == dpid) {
+            return &sched->slot[i];
+        }
+    }
+
+    if (MAX_DP_NUM == sched->num) {
+        return NULL;
+    }
+
+    slot = &sched->slot[sched->num++];
+    memset(slot, 0, sizeof(dp_rept_slot_t));
+    slot->dp.id = dpid;
+    slot->interval_ms = sched->interval_ms;
+
+    return slot;
+}
+
+static void __slot_value_free(dp_rept_slot_t *slot)
+{
+    if (PROP_STR == slot->dp.type && slot->dp.value.dp_str) {
+        tal_free(slot->dp.value.dp_str);
+        slot->dp.value.dp_str = NULL;
+    }
+}
+
+/**
+ * @brief time the waiting DP of a slot is due
+ */
+static uint32_t __slot_due(dp_rept_sched_t *sched, dp_rept_slot_t *slot)
+{
+    uint32_t due = slot->first_ms + sched->window_ms;
+
+    // the first waiting change always comes after the last report
+    if (slot->reported && slot->first_ms - slot->last_ms < slot->interval_ms &&
+        (int32_t)(slot->last_ms + slot->interval_ms - due) > 0) {
+        due = slot->last_ms + slot->interval_ms;
+    }
+
+    return due;
+}
+
+/**
+ * @brief takes the waiting DPs that are due, or all of them with force
+ */
+static int __sched_take(dp_rept_sched_t *sched, uint32_t now_ms, bool force, dp_obj_t **dps, uint16_t *dpscnt)
+{
+    dp_rept_slot_t *slot;
+    uint8_t i, j, n = 0, k;
+    dp_obj_t *out = NULL;
+
+    *dps = NULL;
+    *dpscnt = 0;
+
+    for (i = 0; i < sched->num; i++) {
+        slot = &sched->slot[i];
+        if (!slot->pending || (!force && (int32_t)(__slot_due(sched, slot) - now_ms) > 0)) {
+            continue;
+        }
+        // keep the arrival order of the first waiting changes
+        for (j = n; j > 0 && (int32_t)(sched->slot[sched->out_slot[j - 1]].order - slot->order) > 0; j--) {
+            sched->out_slot[j] = sched->out_slot[j - 1];
+        }
+        sched->out_slot[j] = i;
+        n++;
+    }
+
+    if (0 == n) {
+        return OPRT_OK;
+    }
+
+    out = tal_malloc(n * sizeof(dp_obj_t));
+    if (NULL == out) {
+        PR_ERR("dp rept sched take %d dps malloc failed", n);
+        return OPRT_MALLOC_FAILED;
+    }
+
+    // the string values go with the DPs
+    for (k = 0; k < n; k++) {
+        slot = &sched->slot[sched->out_slot[k]];
+        out[k] = slot->dp;
+        if (PROP_STR == slot->dp.type) {
+            slot->dp.value.dp_str = NULL;
+        }
+        slot->pending = false;
+        slot->reported = true;
+        slot->last_ms = now_ms;
+    }
+    sched->pending -= n;
+
+    *dps = out;
+    *dpscnt = n;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Creates a scheduler.
+ *
+ * @param window_ms coalescing window
+ * @param interval_ms default minimum interval between two reports of a DP
+ *
+ * @return the scheduler, NULL on error
+ */
+dp_rept_sched_t *dp_rept_sched_create(uint32_t window_ms, uint32_t interval_ms)
+{
+    dp_rept_sched_t *sched = NULL;
+
+    sched = tal_malloc(sizeof(dp_rept_sched_t));
+    if (NULL == sched) {
+        return NULL;
+    }
+    memset(sched, 0, sizeof(dp_rept_sched_t));
+    sched->window_ms = window_ms;
+    sched->interval_ms = interval_ms;
+
+    return sched;
+}
+
+/**
+ * @brief Destroys a scheduler, waiting DPs are dropped.
+ *
+ * @param sched the scheduler
+ */
+void dp_rept_sched_destroy(dp_rept_sched_t *sched)
+{
+    uint8_t i;
+
+    if (NULL == sched) {
+        return;
+    }
+
+    for (i = 0; i < sched->num; i++) {
+        __slot_value_free(&sched->slot[i]);
+    }
+    tal_free(sched);
+}
+
+/**
+ * @brief Sets the report rule of a DP.
+ *
+ * @param sched the scheduler
+ * @param dpid the DP
+ * @param interval_ms minimum interval between two reports of the DP
+ * @param critical a change of the DP sends all waiting DPs at once
+ *
+ * @return OPRT_OK on success, OPRT_EXCEED_UPPER_LIMIT if MAX_DP_NUM DPs are known
+ */
+int dp_rept_sched_rule_set(dp_rept_sched_t *sched, uint8_t dpid, uint32_t interval_ms, bool critical)
+{
+    dp_rept_slot_t *slot;
+
+    if (NULL == sched) {
+        return OPRT_INVALID_PARM;
+    }
+
+    slot = __slot_get(sched, dpid);
+    if (NULL == slot) {
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+    slot->interval_ms = interval_ms;
+    slot->critical = critical;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Queues DP changes, the last value of a DP wins.
+ *
+ * @param sched the scheduler
+ * @param dps the DPs, string values are copied
+ * @param dpscnt number of DPs
+ * @param now_ms current time
+ *
+ * @return OPRT_OK on success, an error if a DP could not be queued
+ */
+int dp_rept_sched_push(dp_rept_sched_t *sched, const dp_obj_t *dps, uint16_t dpscnt, uint32_t now_ms)
+{
+    dp_rept_slot_t *slot;
+    char *str = NULL;
+    uint16_t i;
+
+    if (NULL == sched || NULL == dps || 0 == dpscnt) {
+        return OPRT_INVALID_PARM;
+    }
+
+    for (i = 0; i < dpscnt; i++) {
+        slot = __slot_get(sched, dps[i].id);
+        if (NULL == slot) {
+            return OPRT_EXCEED_UPPER_LIMIT;
+        }
+
+        if (PROP_STR == dps[i].type) {
+            str = tal_malloc(strlen(dps[i].value.dp_str ? dps[i].value.dp_str : "") + 1);
+            if (NULL == str) {
+                return OPRT_MALLOC_FAILED;
+            }
+            strcpy(str, dps[i].value.dp_str ? dps[i].value.dp_str : "");
+        }
+
+        __slot_value_free(slot);
+        slot->dp = dps[i];
+        if (PROP_STR == dps[i].type) {
+            slot->dp.value.dp_str = str;
+        }
+
+        if (!slot->pending) {
+            slot->pending = true;
+            slot->first_ms = now_ms;
+            slot->order = sched->order++;
+            sched->pending++;
+        }
+        if (slot->critical) {
+            sched->force = true;
+        }
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Time until the next waiting DP is due.
+ *
+ * @param sched the scheduler
+ * @param now_ms current time
+ *
+ * @return time in ms, 0 if a DP is due or a critical DP changed, DP_REPT_SCHED_IDLE if none is waiting
+ */
+uint32_t dp_rept_sched_next(dp_rept_sched_t *sched, uint32_t now_ms)
+{
+    uint32_t next = DP_REPT_SCHED_IDLE;
+    int32_t wait;
+    uint8_t i;
+
+    if (NULL == sched || 0 == sched->pending) {
+        return DP_REPT_SCHED_IDLE;
+    }
+
+    if (sched->force) {
+        return 0;
+    }
+
+    for (i = 0; i < sched->num; i++) {
+        if (!sched->slot[i].pending) {
+            continue;
+        }
+        wait = (int32_t)(__slot_due(sched, &sched->slot[i]) - now_ms);
+        wait = (wait < 0) ? 0 : wait;
+        next = ((uint32_t)wait < next) ? (uint32_t)wait : next;
+    }
+
+    return next;
+}
+
+/**
+ * @brief Takes the DPs that are due, they count as reported at now_ms.
+ *
+ * @param sched the scheduler
+ * @param now_ms current time
+ * @param dpscnt number of DPs taken
+ * @param next_ms time in ms until the next DP is due, DP_REPT_SCHED_IDLE if none is waiting
+ *
+ * @return the DPs merged in arrival order, to be freed with dp_rept_sched_dps_free, NULL if none is due
+ */
+dp_obj_t *dp_rept_sched_poll(dp_rept_sched_t *sched, uint32_t now_ms, uint16_t *dpscnt, uint32_t *next_ms)
+{
+    dp_obj_t *dps = NULL;
+
+    if (NULL == sched || NULL == dpscnt || NULL == next_ms) {
+        return NULL;
+    }
+
+    if (OPRT_OK != __sched_take(sched, now_ms, sched->force, &dps, dpscnt)) {
+        // retry once a window has passed rather than spin
+        *next_ms = sched->window_ms ? sched->window_ms : 1;
+        return NULL;
+    }
+    sched->force = false;
+    *next_ms = dp_rept_sched_next(sched, now_ms);
+
+    return dps;
+}
+
+/**
+ * @brief Takes all waiting DPs now, ignoring windows and intervals.
+ *
+ * @param sched the scheduler
+ * @param now_ms current time
+ * @param dpscnt number of DPs taken
+ *
+ * @return the DPs merged in arrival order, to be freed with dp_rept_sched_dps_free, NULL if none is waiting
+ */
+dp_obj_t *dp_rept_sched_flush(dp_rept_sched_t *sched, uint32_t now_ms, uint16_t *dpscnt)
+{
+    dp_obj_t *dps = NULL;
+
+    if (NULL == sched || NULL == dpscnt) {
+        return NULL;
+    }
+
+    if (OPRT_OK == __sched_take(sched, now_ms, true, &dps, dpscnt)) {
+        sched->force = false;
+    }
+
+    return dps;
+}
+
+/**
+ * @brief Frees the DPs taken from a scheduler and their string values.
+ *
+ * @param dps the DPs
+ * @param dpscnt number of DPs
+ */
+void dp_rept_sched_dps_free(dp_obj_t *dps, uint16_t dpscnt)
+{
+    uint16_t i;
+
+    if (NULL == dps) {
+        return;
+    }
+
+    for (i = 0; i < dpscnt; i++) {
+        if (PROP_STR == dps[i].type && dps[i].value.dp_str) {
+            tal_free(dps[i].value.dp_str);
+        }
+    }
+    tal_free(dps);
+}
+
+/**
+ * @brief Number of DPs waiting to be reported.
+ *
+ * @param sched the scheduler
+ *
+ * @return the number of DPs
+ */
+uint32_t dp_rept_sched_pending(dp_rept_sched_t *sched)
+{
+    return sched ? sched->pending : 0;
+}
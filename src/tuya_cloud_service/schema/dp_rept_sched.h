@@ -0,0 +1,131 @@
+/**
+ * @file dp_rept_sched.h
+ * @brief Coalescing scheduler for object DP reports.
+ *
+ * DP changes are kept per dpid, a new value replaces the one still waiting.
+ * A DP is reported once its coalescing window has passed since its first
+ * waiting change and its own minimum interval has passed since its last
+ * report, and all the DPs due at the same time go out in one report. A change
+ * of a critical DP sends everything waiting at once. The time is given by the
+ * caller, so the scheduler itself does not depend on a clock.
+ *
+ * The scheduler does not report anything itself: the due DPs are taken out of
+ * it and the caller reports them, so a slow report never runs under the lock
+ * the caller keeps around the scheduler.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __DP_REPT_SCHED_H__
+#define __DP_REPT_SCHED_H__
+
+#include "dp_schema.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Returned by dp_rept_sched_poll when nothing is waiting
+ */
+#define DP_REPT_SCHED_IDLE (0xFFFFFFFFU)
+
+typedef struct dp_rept_sched dp_rept_sched_t;
+
+/**
+ * @brief Creates a scheduler.
+ *
+ * @param window_ms coalescing window
+ * @param interval_ms default minimum interval between two reports of a DP
+ *
+ * @return the scheduler, NULL on error
+ */
+dp_rept_sched_t *dp_rept_sched_create(uint32_t window_ms, uint32_t interval_ms);
+
+/**
+ * @brief Destroys a scheduler, waiting DPs are dropped.
+ *
+ * @param sched the scheduler
+ */
+void dp_rept_sched_destroy(dp_rept_sched_t *sched);
+
+/**
+ * @brief Sets the report rule of a DP.
+ *
+ * @param sched the scheduler
+ * @param dpid the DP
+ * @param interval_ms minimum interval between two reports of the DP
+ * @param critical a change of the DP sends all waiting DPs at once
+ *
+ * @return OPRT_OK on success, OPRT_EXCEED_UPPER_LIMIT if MAX_DP_NUM DPs are known
+ */
+int dp_rept_sched_rule_set(dp_rept_sched_t *sched, uint8_t dpid, uint32_t interval_ms, bool critical);
+
+/**
+ * @brief Queues DP changes, the last value of a DP wins.
+ *
+ * @param sched the scheduler
+ * @param dps the DPs, string values are copied
+ * @param dpscnt number of DPs
+ * @param now_ms current time
+ *
+ * @return OPRT_OK on success, an error if a DP could not be queued
+ */
+int dp_rept_sched_push(dp_rept_sched_t *sched, const dp_obj_t *dps, uint16_t dpscnt, uint32_t now_ms);
+
+/**
+ * @brief Time until the next waiting DP is due.
+ *
+ * @param sched the scheduler
+ * @param now_ms current time
+ *
+ * @return time in ms, 0 if a DP is due or a critical DP changed, DP_REPT_SCHED_IDLE if none is waiting
+ */
+uint32_t dp_rept_sched_next(dp_rept_sched_t *sched, uint32_t now_ms);
+
+/**
+ * @brief Takes the DPs that are due, they count as reported at now_ms.
+ *
+ * @param sched the scheduler
+ * @param now_ms current time
+ * @param dpscnt number of DPs taken
+ * @param next_ms time in ms until the next DP is due, DP_REPT_SCHED_IDLE if none is waiting
+ *
+ * @return the DPs merged in arrival order, to be freed with dp_rept_sched_dps_free, NULL if none is due
+ */
+dp_obj_t *dp_rept_sched_poll(dp_rept_sched_t *sched, uint32_t now_ms, uint16_t *dpscnt, uint32_t *next_ms);
+
+/**
+ * @brief Takes all waiting DPs now, ignoring windows and intervals.
+ *
+ * @param sched the scheduler
+ * @param now_ms current time
+ * @param dpscnt number of DPs taken
+ *
+ * @return the DPs merged in arrival order, to be freed with dp_rept_sched_dps_free, NULL if none is waiting
+ */
+dp_obj_t *dp_rept_sched_flush(dp_rept_sched_t *sched, uint32_t now_ms, uint16_t *dpscnt);
+
+/**
+ * @brief Frees the DPs taken from a scheduler and their string values.
+ *
+ * @param dps the DPs
+ * @param dpscnt number of DPs
+ */
+void dp_rept_sched_dps_free(dp_obj_t *dps, uint16_t dpscnt);
+
+/**
+ * @brief Number of DPs waiting to be reported.
+ *
+ * @param sched the scheduler
+ *
+ * @return the number of DPs
+ */
+uint32_t dp_rept_sched_pending(dp_rept_sched_t *sched);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DP_REPT_SCHED_H__ */
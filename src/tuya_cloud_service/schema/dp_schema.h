@@ -347,6 +347,7 @@ typedef struct {
 #define DP_REPT_NO_FILTER_FLAG  (1 << 0)
 #define DP_DUMP_STAT_LOCAL_FLAG (1 << 1)
 #define DP_APPEND_HEADER_FLAG   (1 << 2)
+#define DP_REPT_SCHED_BYPASS_FLAG (1 << 3)
 
 typedef struct {
     char *devid;
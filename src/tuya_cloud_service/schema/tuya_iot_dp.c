@@ -24,6 +24,8 @@
 #include "tuya_lan.h"
 #include "tal_api.h"
 #include "mix_method.h"
+#include "tuya_config_defaults.h"
+#include "dp_rept_sched.h"
 
 #ifdef ENABLE_BLUETOOTH
 #include "ble_mgr.h"
@@ -32,6 +34,13 @@
 
 static DELAYED_WORK_HANDLE s_tmm_dp_sync = NULL;
 
+#if defined(ENABLE_DP_REPT_SCHED) && (ENABLE_DP_REPT_SCHED == 1)
+static dp_rept_sched_t *s_rept_sched = NULL;
+static MUTEX_HANDLE s_rept_sched_mutex = NULL;
+static MUTEX_HANDLE s_rept_out_mutex = NULL;
+static DELAYED_WORK_HANDLE s_tmm_rept_sched = NULL;
+#endif
+
 int tuya_iot_dp_sync_start(tuya_iot_client_t *client, uint32_t timeout_s);
 
 static void dp_sync_cb(int result, void *user_data)
@@ -109,6 +118,194 @@ int tuya_iot_dp_sync_start(tuya_iot_client_t *client, uint32_t timeout_s)
     return tal_workq_start_delayed(s_tmm_dp_sync, timeout_s * 1000, LOOP_ONCE);
 }
 
+#if defined(ENABLE_DP_REPT_SCHED) && (ENABLE_DP_REPT_SCHED == 1)
+/**
+ * @brief arms the timer for the next due DP, called with the mutex held
+ */
+static void rept_sched_arm(uint32_t next)
+{
+    if (DP_REPT_SCHED_IDLE != next) {
+        tal_workq_start_delayed(s_tmm_rept_sched, next ? next : 1, LOOP_ONCE);
+    }
+}
+
+/**
+ * @brief reports the DPs taken from the scheduler and frees them
+ *
+ * The scheduler mutex is not held here, so a slow publish does not block the
+ * DP changes. The output mutex keeps the reports in the order their DPs were
+ * taken.
+ */
+static int rept_sched_report(tuya_iot_client_t *client, dp_obj_t *dps, uint16_t dpscnt)
+{
+    int ret = OPRT_OK;
+
+    if (NULL == dps) {
+        return OPRT_OK;
+    }
+
+    ret = tuya_iot_dp_obj_report(client, client->activate.devid, dps, dpscnt, DP_REPT_SCHED_BYPASS_FLAG);
+    if (OPRT_OK != ret) {
+        PR_WARN("dp rept sched report %d dps failed %d", dpscnt, ret);
+    }
+    dp_rept_sched_dps_free(dps, dpscnt);
+
+    return ret;
+}
+
+static void tuya_iot_dp_rept_sched_process(void *data)
+{
+    dp_obj_t *dps = NULL;
+    uint16_t dpscnt = 0;
+    uint32_t next = DP_REPT_SCHED_IDLE;
+
+    tal_mutex_lock(s_rept_out_mutex);
+
+    tal_mutex_lock(s_rept_sched_mutex);
+    dps = dp_rept_sched_poll(s_rept_sched, (uint32_t)tal_system_get_millisecond(), &dpscnt, &next);
+    rept_sched_arm(next);
+    tal_mutex_unlock(s_rept_sched_mutex);
+
+    rept_sched_report((tuya_iot_client_t *)data, dps, dpscnt);
+
+    tal_mutex_unlock(s_rept_out_mutex);
+}
+
+/**
+ * @brief Initializes the report scheduler of the device data points.
+ *
+ * Object DP reports of the device itself without flags are then coalesced
+ * within DP_REPT_SCHED_WINDOW_MS before they are sent.
+ *
+ * @param client The Tuya IoT client instance.
+ *
+ * @return OPRT_OK on success, or an error code on failure.
+ */
+int tuya_iot_dp_rept_sched_init(tuya_iot_client_t *client)
+{
+    int ret = OPRT_OK;
+
+    if (s_rept_sched) {
+        return OPRT_OK;
+    }
+
+    ret = tal_mutex_create_init(&s_rept_sched_mutex);
+    if (OPRT_OK != ret) {
+        return ret;
+    }
+
+    ret = tal_mutex_create_init(&s_rept_out_mutex);
+    if (OPRT_OK != ret) {
+        tal_mutex_release(s_rept_sched_mutex);
+        s_rept_sched_mutex = NULL;
+        return ret;
+    }
+
+    ret = tal_workq_init_delayed(WORKQ_SYSTEM, tuya_iot_dp_rept_sched_process, client, &s_tmm_rept_sched);
+    if (OPRT_OK != ret) {
+        tal_mutex_release(s_rept_out_mutex);
+        tal_mutex_release(s_rept_sched_mutex);
+        s_rept_out_mutex = NULL;
+        s_rept_sched_mutex = NULL;
+        return ret;
+    }
+
+    s_rept_sched = dp_rept_sched_create(DP_REPT_SCHED_WINDOW_MS, DP_REPT_SCHED_INTERVAL_MS);
+    if (NULL == s_rept_sched) {
+        tal_workq_cancel_delayed(s_tmm_rept_sched);
+        tal_mutex_release(s_rept_out_mutex);
+        tal_mutex_release(s_rept_sched_mutex);
+        s_tmm_rept_sched = NULL;
+        s_rept_out_mutex = NULL;
+        s_rept_sched_mutex = NULL;
+        return OPRT_MALLOC_FAILED;
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Sets how a data point of the device is reported.
+ *
+ * @param client The Tuya IoT client instance.
+ * @param dpid The data point.
+ * @param interval_ms Minimum interval between two reports of the data point.
+ * @param critical A change of the data point sends all waiting data points at once.
+ *
+ * @return OPRT_OK on success, or an error code on failure.
+ */
+int tuya_iot_dp_rept_rule_set(tuya_iot_client_t *client, uint8_t dpid, uint32_t interval_ms, bool critical)
+{
+    int ret = OPRT_OK;
+
+    if (NULL == s_rept_sched) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+
+    tal_mutex_lock(s_rept_sched_mutex);
+    ret = dp_rept_sched_rule_set(s_rept_sched, dpid, interval_ms, critical);
+    tal_mutex_unlock(s_rept_sched_mutex);
+
+    return ret;
+}
+
+/**
+ * @brief Sends the data points of the device waiting in the report scheduler.
+ *
+ * @param client The Tuya IoT client instance.
+ *
+ * @return OPRT_OK on success, or an error code on failure.
+ */
+int tuya_iot_dp_rept_flush(tuya_iot_client_t *client)
+{
+    int ret = OPRT_OK;
+    dp_obj_t *dps = NULL;
+    uint16_t dpscnt = 0;
+
+    if (NULL == s_rept_sched) {
+        return OPRT_OK;
+    }
+
+    tal_mutex_lock(s_rept_out_mutex);
+
+    tal_mutex_lock(s_rept_sched_mutex);
+    dps = dp_rept_sched_flush(s_rept_sched, (uint32_t)tal_system_get_millisecond(), &dpscnt);
+    if (NULL == dps && dp_rept_sched_pending(s_rept_sched)) {
+        ret = OPRT_MALLOC_FAILED;
+    }
+    tal_mutex_unlock(s_rept_sched_mutex);
+
+    if (dps) {
+        ret = rept_sched_report(client, dps, dpscnt);
+    }
+
+    tal_mutex_unlock(s_rept_out_mutex);
+
+    return ret;
+}
+
+static int rept_sched_queue(dp_schema_t *schema, dp_obj_t *dps, uint16_t dpscnt)
+{
+    int ret = OPRT_OK;
+
+    for (uint16_t i = 0; i < dpscnt; i++) {
+        dp_node_t *node = dp_node_find(schema, dps[i].id);
+        if (NULL == node || T_OBJ != node->desc.type || node->desc.prop_tp != dps[i].type) {
+            PR_ERR("dp %d not reportable", dps[i].id);
+            return OPRT_INVALID_PARM;
+        }
+    }
+
+    // the DPs due now are reported by the timer, never on the caller's thread
+    tal_mutex_lock(s_rept_sched_mutex);
+    ret = dp_rept_sched_push(s_rept_sched, dps, dpscnt, (uint32_t)tal_system_get_millisecond());
+    rept_sched_arm(dp_rept_sched_next(s_rept_sched, (uint32_t)tal_system_get_millisecond()));
+    tal_mutex_unlock(s_rept_sched_mutex);
+
+    return ret;
+}
+#endif
+
 /**
  * @brief Dispatches an event for the Tuya IoT data point (DP).
  *
@@ -230,6 +427,14 @@ int tuya_iot_dp_obj_report(tuya_iot_client_t *client, const char *devid, dp_obj_
         return OPRT_INVALID_PARM;
     }
 
+#if defined(ENABLE_DP_REPT_SCHED) && (ENABLE_DP_REPT_SCHED == 1)
+    //! reports with flags are sent as they are
+    if (s_rept_sched && 0 == flags && 0 == strcmp(schema->devid, client->activate.devid)) {
+        return rept_sched_queue(schema, dps, dpscnt);
+    }
+    flags &= ~DP_REPT_SCHED_BYPASS_FLAG;
+#endif
+
     dp_rept_valid_t *dpvalid = tal_malloc(sizeof(dp_rept_valid_t) + sizeof(uint8_t) * dpscnt);
     if (NULL == dpvalid) {
         return OPRT_MALLOC_FAILED;
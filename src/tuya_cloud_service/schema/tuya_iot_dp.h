@@ -76,6 +76,37 @@ int tuya_iot_dp_raw_report(tuya_iot_client_t *client, const char *devid, dp_raw_
  */
 char *tuya_iot_dp_obj_dump(tuya_iot_client_t *client, char *devid, int flags);
 
+#if defined(ENABLE_DP_REPT_SCHED) && (ENABLE_DP_REPT_SCHED == 1)
+/**
+ * @brief Initializes the report scheduler, object DP reports of the device
+ * without flags are then coalesced before they are sent.
+ *
+ * @param client
+ * @return int
+ */
+int tuya_iot_dp_rept_sched_init(tuya_iot_client_t *client);
+
+/**
+ * @brief Sets the minimum report interval of a DP, a change of a critical DP
+ * sends all waiting DPs at once.
+ *
+ * @param client
+ * @param dpid
+ * @param interval_ms
+ * @param critical
+ * @return int
+ */
+int tuya_iot_dp_rept_rule_set(tuya_iot_client_t *client, uint8_t dpid, uint32_t interval_ms, bool critical);
+
+/**
+ * @brief Sends the DPs waiting in the report scheduler now.
+ *
+ * @param client
+ * @return int
+ */
+int tuya_iot_dp_rept_flush(tuya_iot_client_t *client);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,6 +21,11 @@
 #include "tuya_transporter.h"
 #include "tcp_transporter.h"
 #include "tal_network.h"
+#include "tal_dns_cache.h"
+
+#ifndef TCP_CONNECT_RACE_TIMEOUT_MS
+#define TCP_CONNECT_RACE_TIMEOUT_MS 10000 // used when the caller gives no timeout
+#endif
 
 typedef struct tcp_transporter_inter_t {
     struct tuya_transporter_inter_t base;
@@ -54,19 +59,39 @@ OPERATE_RET tuya_tcp_transporter_connect(tuya_transporter_t t, const char *host,
 
     OPERATE_RET op_ret = OPRT_OK;
     tuya_tcp_transporter_t tcp_transporter = (tuya_tcp_transporter_t)t;
-
-    /*resolve ip addr of host*/
+    BOOL_T connected = FALSE;
     TUYA_IP_ADDR_T hostaddr;
-    op_ret = tal_net_gethostbyname(host, &hostaddr);
-    if (op_ret != OPRT_OK) {
-        PR_ERR("DNS parser host %s failed %d", host, op_ret);
-        return OPRT_MID_TRANSPORT_DNS_PARSED_FAILED;
+
+#if defined(ENABLE_DNS_CACHE) && (ENABLE_DNS_CACHE == 1)
+    // race the cached addresses of the host unless the socket must be bound first,
+    // the options below are applied to the connected socket
+    if (0 == tcp_transporter->config.bindPort && 0 == tcp_transporter->config.bindAddr) {
+        op_ret = tal_net_connect_race(host, port, (timeout_ms > 0) ? timeout_ms : TCP_CONNECT_RACE_TIMEOUT_MS,
+                                      &tcp_transporter->socket_fd);
+        if (OPRT_OK != op_ret) {
+            PR_ERR("connect host %s failed %d", host, op_ret);
+            tcp_transporter->socket_fd = -1;
+            // the race times out once the host resolved, anything else is the resolver
+            return (OPRT_TIMEOUT == op_ret) ? OPRT_MID_TRANSPORT_TCP_CONNECD_FAILED
+                                            : OPRT_MID_TRANSPORT_DNS_PARSED_FAILED;
+        }
+        connected = TRUE;
     }
+#endif
+
+    if (!connected) {
+        /*resolve ip addr of host*/
+        op_ret = tal_net_gethostbyname(host, &hostaddr);
+        if (op_ret != OPRT_OK) {
+            PR_ERR("DNS parser host %s failed %d", host, op_ret);
+            return OPRT_MID_TRANSPORT_DNS_PARSED_FAILED;
+        }
 
-    tcp_transporter->socket_fd = tal_net_socket_create(PROTOCOL_TCP);
-    if (tcp_transporter->socket_fd < 0) {
-        op_ret = OPRT_MID_TRANSPORT_SOCK_CREAT_FAILED;
-        goto err_out;
+        tcp_transporter->socket_fd = tal_net_socket_create(PROTOCOL_TCP);
+        if (tcp_transporter->socket_fd < 0) {
+            op_ret = OPRT_MID_TRANSPORT_SOCK_CREAT_FAILED;
+            goto err_out;
+        }
     }
     // reuse socket port
     if (tcp_transporter->config.isReuse && (OPRT_OK != tal_net_set_reuse(tcp_transporter->socket_fd))) {
@@ -117,7 +142,9 @@ OPERATE_RET tuya_tcp_transporter_connect(tuya_transporter_t t, const char *host,
         // goto err_out;
     }
 
-    if (tal_net_connect(tcp_transporter->socket_fd, hostaddr, port) < 0) {
+    if (!connected && tal_net_connect(tcp_transporter->socket_fd, hostaddr, port) < 0) {
+        // the cached address may be gone, resolve again on the next connect
+        tal_dns_cache_invalidate(host);
         op_ret = OPRT_MID_TRANSPORT_TCP_CONNECD_FAILED;
         goto err_out;
     }
@@ -0,0 +1,318 @@
+/**
+ * @file test_ble_window.cpp
+ * @brief UT of the sliding window transport of the BLE transparent channel.
+ *
+ * A sender and a receiver talk over a simulated link on a simulated
+ * millisecond clock. The link delays every frame, can reorder them with
+ * jitter and drops subpackets and acks at a given rate, from a fixed seed so
+ * a failure replays. The sender is driven like ble_channel.c does it: its
+ * timer is armed from ble_wnd_tx_wait_get after every result.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <map>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "tuya_cloud_types.h"
+#include "tuya_error_code.h"
+#include "tal_api.h"
+#include "ble_window.h"
+}
+
+#define LINK_MTU        244
+#define LINK_DELAY_MS   15
+#define SIM_END_MS      600000U
+
+namespace {
+
+struct Frame {
+    bool to_rx; // a subpacket, otherwise an ack
+    std::vector<uint8_t> bytes;
+};
+
+struct Link {
+    uint32_t seed = 1;
+    uint32_t loss_pct = 0;
+    uint32_t jitter_ms = 0;
+    bool duplicate = false;
+    int drop_no = -1; // drops the first send of this subpacket only
+    std::multimap<uint32_t, Frame> air;
+
+    uint32_t rand()
+    {
+        seed = seed * 1103515245U + 12345U;
+        return (seed >> 16) & 0x7FFF;
+    }
+
+    void send(uint32_t now_ms, bool to_rx, const uint8_t *buf, uint32_t len)
+    {
+        if (loss_pct && rand() % 100 < loss_pct) {
+            return;
+        }
+        uint32_t at = now_ms + LINK_DELAY_MS + (jitter_ms ? rand() % jitter_ms : 0);
+        air.insert({at, {to_rx, std::vector<uint8_t>(buf, buf + len)}});
+        if (duplicate) {
+            air.insert({at + 1, {to_rx, std::vector<uint8_t>(buf, buf + len)}});
+        }
+    }
+};
+
+struct Result {
+    int rt;
+    uint32_t end_ms;
+    uint32_t sent;    // subpackets sent, resends included
+    uint32_t count;   // subpackets of the transfer
+    uint32_t max_inflight;
+    std::vector<uint8_t> received;
+};
+
+class BleWindow : public ::testing::Test {
+  protected:
+    void SetUp() override
+    {
+        ble_wnd_param_get(LINK_MTU, &chunk, &window);
+        ble_wnd_rx_init(&rx, window);
+    }
+
+    void TearDown() override
+    {
+        ble_wnd_rx_release(&rx);
+    }
+
+    static int __send_cb(ble_wnd_frame_t *frame, void *user_data)
+    {
+        BleWindow *self = (BleWindow *)user_data;
+        std::vector<uint8_t> buf(BLE_WND_HDR_MAX + frame->len);
+
+        if (self->link.drop_no == (int)frame->no) {
+            self->link.drop_no = -1;
+        } else {
+            self->link.send(self->now, true, buf.data(), ble_wnd_frame_encode(frame, buf.data()));
+        }
+        self->sent++;
+        return OPRT_OK;
+    }
+
+    // runs a transfer until the sender is done, returns what the receiver got
+    Result transfer(const std::vector<uint8_t> &data, uint8_t id = 1)
+    {
+        Result r = {};
+        uint32_t timer = 0;
+        bool armed = false;
+        int rt;
+
+        now = 0;
+        sent = 0;
+        rt = ble_wnd_tx_start(&tx, id, (uint8_t *)data.data(), data.size(), chunk, window, BT_WND_RTO_MS, __send_cb,
+                              this, now);
+        while (OPRT_SVC_BT_API_TRSMITR_CONTINUE == rt) {
+            r.max_inflight = (tx.next - tx.base > r.max_inflight) ? tx.next - tx.base : r.max_inflight;
+            timer = now + ble_wnd_tx_wait_get(&tx, now) + 1;
+            armed = true;
+
+            rt = OPRT_SVC_BT_API_TRSMITR_CONTINUE;
+            while (OPRT_SVC_BT_API_TRSMITR_CONTINUE == rt && armed) {
+                if (!link.air.empty() && link.air.begin()->first < timer) {
+                    now = link.air.begin()->first;
+                    Frame f = link.air.begin()->second;
+                    link.air.erase(link.air.begin());
+                    if (f.to_rx) {
+                        __rx(f, r);
+                        continue;
+                    }
+                    ble_wnd_ack_t ack;
+                    if (OPRT_OK != ble_wnd_ack_decode(f.bytes.data(), f.bytes.size(), &ack)) {
+                        ADD_FAILURE() << "bad ack";
+                        continue;
+                    }
+                    rt = ble_wnd_tx_ack(&tx, &ack, now);
+                } else {
+                    now = timer;
+                    rt = ble_wnd_tx_poll(&tx, now);
+                }
+                armed = false;
+            }
+            if (now > SIM_END_MS) {
+                ADD_FAILURE() << "transfer never ends";
+                break;
+            }
+        }
+
+        r.rt = rt;
+        r.end_ms = now;
+        r.sent = sent;
+        r.count = tx.count;
+        r.received = received;
+        return r;
+    }
+
+    void __rx(Frame &f, Result &r)
+    {
+        ble_wnd_frame_t frame;
+        ble_wnd_ack_t ack;
+        uint8_t buf[BLE_WND_ACK_LEN];
+        bool ack_now = false;
+
+        ASSERT_EQ(OPRT_OK, ble_wnd_frame_decode(f.bytes.data(), f.bytes.size(), &frame));
+        int rt = ble_wnd_rx_put(&rx, &frame, &ack_now);
+        if (ack_now) {
+            ble_wnd_rx_ack_get(&rx, &ack);
+            link.send(now, false, buf, ble_wnd_ack_encode(&ack, frame.flag, buf));
+        }
+        if (OPRT_OK == rt) {
+            // what ble_channel.c hands to the channel function
+            received.assign(rx.buf, rx.buf + rx.total);
+            ble_wnd_rx_release(&rx);
+        } else {
+            EXPECT_EQ(OPRT_SVC_BT_API_TRSMITR_CONTINUE, rt);
+        }
+    }
+
+    static std::vector<uint8_t> __data(size_t len)
+    {
+        std::vector<uint8_t> data(len);
+
+        for (size_t i = 0; i < len; i++) {
+            data[i] = (uint8_t)(i * 131 + (i >> 8));
+        }
+        return data;
+    }
+
+    static void __print(const char *name, const Result &r)
+    {
+        printf("[ LINK     ] %-12s %4u subpackets: sent %4u, %5u ms, %d\n", name, r.count, r.sent, r.end_ms, r.rt);
+    }
+
+    ble_wnd_tx_t tx;
+    ble_wnd_rx_t rx;
+    Link link;
+    uint32_t chunk = 0;
+    uint8_t window = 0;
+    uint32_t now = 0;
+    uint32_t sent = 0;
+    std::vector<uint8_t> received;
+};
+
+} // namespace
+
+TEST_F(BleWindow, CleanLinkSendsEverySubpacketOnce)
+{
+    std::vector<uint8_t> data = __data(16 * 1024);
+    Result r = transfer(data);
+
+    __print("clean", r);
+    ASSERT_EQ(OPRT_OK, r.rt);
+    EXPECT_EQ(data, r.received);
+    EXPECT_EQ(r.count, r.sent);
+    EXPECT_EQ((uint32_t)window, r.max_inflight);
+    EXPECT_LT(r.end_ms, (uint32_t)BT_WND_RTO_MS);
+}
+
+TEST_F(BleWindow, LossyLinkDeliversIntact)
+{
+    std::vector<uint8_t> data = __data(16 * 1024);
+
+    // both ways, the retries give up only after BT_WND_RETRY_MAX timeouts without any ack
+    for (uint32_t loss : {5, 10, 25}) {
+        uint32_t sent = 0, count = 0;
+
+        for (uint32_t seed = 1; seed <= 5; seed++) {
+            ble_wnd_rx_release(&rx);
+            ble_wnd_rx_init(&rx, window);
+            received.clear();
+            link = Link();
+            link.seed = seed;
+            link.loss_pct = loss;
+            Result r = transfer(data, (uint8_t)seed);
+
+            char name[32];
+            snprintf(name, sizeof(name), "loss %u%% #%u", loss, seed);
+            __print(name, r);
+            ASSERT_EQ(OPRT_OK, r.rt) << name;
+            EXPECT_EQ(data, r.received) << name;
+            sent += r.sent;
+            count += r.count;
+        }
+        EXPECT_GT(sent, count) << "loss " << loss << "%";
+    }
+}
+
+TEST_F(BleWindow, HoleIsResentBeforeTheTimer)
+{
+    std::vector<uint8_t> data = __data(8 * 1024);
+
+    link.drop_no = 1;
+    Result r = transfer(data);
+
+    __print("one hole", r);
+    ASSERT_EQ(OPRT_OK, r.rt);
+    EXPECT_EQ(data, r.received);
+    EXPECT_EQ(r.count + 1, r.sent);
+    // the ack of a later subpacket revealed it, no timeout
+    EXPECT_LT(r.end_ms, (uint32_t)BT_WND_RTO_MS);
+}
+
+TEST_F(BleWindow, ReorderedAndDuplicatedFramesAreDelivered)
+{
+    std::vector<uint8_t> data = __data(16 * 1024);
+
+    link.jitter_ms = 40;
+    link.duplicate = true;
+    Result r = transfer(data);
+
+    __print("reordered", r);
+    ASSERT_EQ(OPRT_OK, r.rt);
+    EXPECT_EQ(data, r.received);
+}
+
+TEST_F(BleWindow, ReceiveWindowOfTheAppCapsTheSubpacketsInFlight)
+{
+    std::vector<uint8_t> data = __data(16 * 1024);
+
+    ble_wnd_rx_init(&rx, 2);
+    Result r = transfer(data);
+
+    ASSERT_EQ(OPRT_OK, r.rt);
+    EXPECT_EQ(data, r.received);
+    // the first window goes out before the app could tell
+    EXPECT_EQ((uint32_t)window, r.max_inflight);
+    EXPECT_LE(tx.window, 2);
+}
+
+TEST_F(BleWindow, DeadLinkTimesOut)
+{
+    std::vector<uint8_t> data = __data(4 * 1024);
+
+    link.loss_pct = 100;
+    Result r = transfer(data);
+
+    __print("dead", r);
+    EXPECT_EQ(OPRT_TIMEOUT, r.rt);
+    EXPECT_TRUE(received.empty());
+    EXPECT_GE(r.end_ms, (uint32_t)BT_WND_RTO_MS * (BT_WND_RETRY_MAX + 1));
+    EXPECT_LT(r.end_ms, (uint32_t)BT_WND_RTO_MS * (BT_WND_RETRY_MAX + 2) + 10);
+}
+
+TEST_F(BleWindow, AckOfAnotherTransferIsIgnored)
+{
+    std::vector<uint8_t> data = __data(4 * 1024);
+    ble_wnd_ack_t ack = {};
+
+    ASSERT_EQ(OPRT_SVC_BT_API_TRSMITR_CONTINUE,
+              ble_wnd_tx_start(&tx, 7, data.data(), data.size(), chunk, window, BT_WND_RTO_MS, __send_cb, this, 0));
+    ack.id = 6;
+    ack.expect = (uint16_t)tx.next;
+    EXPECT_EQ(OPRT_SVC_BT_API_TRSMITR_CONTINUE, ble_wnd_tx_ack(&tx, &ack, 10));
+    EXPECT_EQ(0U, tx.base);
+
+    ack.id = 7;
+    EXPECT_EQ(OPRT_SVC_BT_API_TRSMITR_CONTINUE, ble_wnd_tx_ack(&tx, &ack, 20));
+    EXPECT_EQ(ack.expect, tx.base);
+    link.air.clear();
+}
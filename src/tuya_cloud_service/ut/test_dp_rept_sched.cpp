@@ -0,0 +1,316 @@
+/**
+ * @file test_dp_rept_sched.cpp
+ * @brief UT of the report scheduler of the object DPs.
+ *
+ * The scheduler takes the time as a parameter, so the sequences run on a
+ * simulated millisecond clock: DP changes are pushed at given times and the
+ * due DPs are taken when the timer armed from the last poll would fire, the
+ * way tuya_iot_dp.c drives it.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "tuya_cloud_types.h"
+#include "tuya_error_code.h"
+#include "tal_api.h"
+#include "dp_rept_sched.h"
+}
+
+#define WINDOW_MS 200
+
+namespace {
+
+struct Report {
+    uint32_t at_ms;
+    std::vector<std::pair<uint8_t, int>> dps; // id, value
+};
+
+struct Change {
+    uint32_t at_ms;
+    uint8_t id;
+    int value;
+};
+
+dp_obj_t __dp(uint8_t id, int value)
+{
+    dp_obj_t dp = {};
+
+    dp.id = id;
+    dp.type = PROP_VALUE;
+    dp.value.dp_value = value;
+    return dp;
+}
+
+class DpReptSched : public ::testing::Test {
+  protected:
+    void SetUp() override
+    {
+        sched = dp_rept_sched_create(WINDOW_MS, 0);
+        ASSERT_NE(nullptr, sched);
+    }
+
+    void TearDown() override
+    {
+        dp_rept_sched_destroy(sched);
+    }
+
+    void push(uint32_t now_ms, uint8_t id, int value)
+    {
+        dp_obj_t dp = __dp(id, value);
+
+        EXPECT_EQ(OPRT_OK, dp_rept_sched_push(sched, &dp, 1, now_ms));
+    }
+
+    // takes the due DPs, records them as a report and returns the time to the next
+    uint32_t poll(uint32_t now_ms)
+    {
+        uint16_t dpscnt = 0;
+        uint32_t next = 0;
+        dp_obj_t *dps = dp_rept_sched_poll(sched, now_ms, &dpscnt, &next);
+
+        take(now_ms, dps, dpscnt);
+        return next;
+    }
+
+    void take(uint32_t now_ms, dp_obj_t *dps, uint16_t dpscnt)
+    {
+        if (NULL == dps) {
+            EXPECT_EQ(0, dpscnt);
+            return;
+        }
+
+        Report r = {now_ms, {}};
+        for (uint16_t i = 0; i < dpscnt; i++) {
+            r.dps.push_back({dps[i].id, dps[i].value.dp_value});
+        }
+        reports.push_back(r);
+        dp_rept_sched_dps_free(dps, dpscnt);
+    }
+
+    // replays the changes, polling whenever the timer of the last poll fires
+    void replay(const std::vector<Change> &changes)
+    {
+        uint32_t timer = DP_REPT_SCHED_IDLE, now;
+        size_t next = 0;
+
+        while (next < changes.size() || DP_REPT_SCHED_IDLE != timer) {
+            if (next < changes.size() && (DP_REPT_SCHED_IDLE == timer || changes[next].at_ms < timer)) {
+                now = changes[next].at_ms;
+                push(now, changes[next].id, changes[next].value);
+                next++;
+                timer = __arm(now, dp_rept_sched_next(sched, now));
+            } else {
+                now = timer;
+                timer = __arm(now, poll(now));
+            }
+        }
+    }
+
+    static uint32_t __arm(uint32_t now_ms, uint32_t next)
+    {
+        return (DP_REPT_SCHED_IDLE == next) ? DP_REPT_SCHED_IDLE : now_ms + (next ? next : 1);
+    }
+
+    dp_rept_sched_t *sched = nullptr;
+    std::vector<Report> reports;
+};
+
+} // namespace
+
+TEST_F(DpReptSched, LastValueWithinTheWindowIsReported)
+{
+    push(0, 1, 10);
+    push(50, 1, 11);
+    push(100, 2, 20);
+
+    EXPECT_EQ(1U, poll(199));
+    EXPECT_TRUE(reports.empty());
+
+    EXPECT_EQ(100U, poll(200));
+    ASSERT_EQ(1U, reports.size());
+    EXPECT_EQ((std::vector<std::pair<uint8_t, int>>{{1, 11}}), reports[0].dps);
+
+    EXPECT_EQ(DP_REPT_SCHED_IDLE, poll(300));
+    ASSERT_EQ(2U, reports.size());
+    EXPECT_EQ((std::vector<std::pair<uint8_t, int>>{{2, 20}}), reports[1].dps);
+    EXPECT_EQ(0U, dp_rept_sched_pending(sched));
+}
+
+TEST_F(DpReptSched, DueDpsShareOneReportInArrivalOrder)
+{
+    push(0, 5, 50);
+    push(10, 3, 30);
+    push(20, 5, 51);
+
+    poll(WINDOW_MS + 10);
+    ASSERT_EQ(1U, reports.size());
+    EXPECT_EQ((std::vector<std::pair<uint8_t, int>>{{5, 51}, {3, 30}}), reports[0].dps);
+}
+
+TEST_F(DpReptSched, IntervalLimitsTheReportsOfADp)
+{
+    ASSERT_EQ(OPRT_OK, dp_rept_sched_rule_set(sched, 1, 1000, false));
+
+    push(0, 1, 10);
+    EXPECT_EQ(DP_REPT_SCHED_IDLE, poll(WINDOW_MS));
+    ASSERT_EQ(1U, reports.size());
+
+    // the window is over at 500, the interval at 1200
+    push(300, 1, 11);
+    EXPECT_EQ(700U, poll(500));
+    EXPECT_EQ(1U, reports.size());
+    EXPECT_EQ(DP_REPT_SCHED_IDLE, poll(1200));
+    ASSERT_EQ(2U, reports.size());
+    EXPECT_EQ(1200U, reports[1].at_ms);
+
+    // a change long after the interval only waits for its window
+    push(5000, 1, 12);
+    EXPECT_EQ((uint32_t)WINDOW_MS, dp_rept_sched_next(sched, 5000));
+}
+
+TEST_F(DpReptSched, CriticalDpSendsEverythingWaiting)
+{
+    ASSERT_EQ(OPRT_OK, dp_rept_sched_rule_set(sched, 9, 0, true));
+
+    push(0, 1, 10);
+    push(10, 2, 20);
+    EXPECT_EQ((uint32_t)WINDOW_MS - 10, dp_rept_sched_next(sched, 10));
+    push(20, 9, 1);
+    EXPECT_EQ(0U, dp_rept_sched_next(sched, 20));
+
+    EXPECT_EQ(DP_REPT_SCHED_IDLE, poll(21));
+    ASSERT_EQ(1U, reports.size());
+    EXPECT_EQ((std::vector<std::pair<uint8_t, int>>{{1, 10}, {2, 20}, {9, 1}}), reports[0].dps);
+}
+
+TEST_F(DpReptSched, FlushTakesEverythingNow)
+{
+    uint16_t dpscnt = 0;
+
+    EXPECT_EQ(nullptr, dp_rept_sched_flush(sched, 0, &dpscnt));
+    EXPECT_EQ(0, dpscnt);
+
+    push(0, 1, 10);
+    push(5, 2, 20);
+    dp_obj_t *dps = dp_rept_sched_flush(sched, 6, &dpscnt);
+    take(6, dps, dpscnt);
+
+    ASSERT_EQ(1U, reports.size());
+    EXPECT_EQ(2U, reports[0].dps.size());
+    EXPECT_EQ(0U, dp_rept_sched_pending(sched));
+    EXPECT_EQ(DP_REPT_SCHED_IDLE, dp_rept_sched_next(sched, 6));
+}
+
+TEST_F(DpReptSched, StringValuesAreCopiedAndHandedOver)
+{
+    char value[16] = "first";
+    dp_obj_t dp = {};
+    uint16_t dpscnt = 0;
+    uint32_t next = 0;
+
+    dp.id = 7;
+    dp.type = PROP_STR;
+    dp.value.dp_str = value;
+    ASSERT_EQ(OPRT_OK, dp_rept_sched_push(sched, &dp, 1, 0));
+    strcpy(value, "second");
+    ASSERT_EQ(OPRT_OK, dp_rept_sched_push(sched, &dp, 1, 10));
+    strcpy(value, "changed");
+
+    dp_obj_t *dps = dp_rept_sched_poll(sched, WINDOW_MS, &dpscnt, &next);
+    ASSERT_NE(nullptr, dps);
+    ASSERT_EQ(1, dpscnt);
+    EXPECT_STREQ("second", dps[0].value.dp_str);
+
+    // the taken string outlives the next value of the DP
+    ASSERT_EQ(OPRT_OK, dp_rept_sched_push(sched, &dp, 1, 300));
+    EXPECT_STREQ("second", dps[0].value.dp_str);
+    dp_rept_sched_dps_free(dps, dpscnt);
+
+    // destroyed in TearDown with the string still waiting
+    EXPECT_EQ(1U, dp_rept_sched_pending(sched));
+}
+
+TEST_F(DpReptSched, KnowsAtMostMaxDpNum)
+{
+    for (int i = 0; i < MAX_DP_NUM; i++) {
+        push(0, (uint8_t)i, i);
+    }
+    dp_obj_t dp = __dp(MAX_DP_NUM, 0);
+    EXPECT_EQ(OPRT_EXCEED_UPPER_LIMIT, dp_rept_sched_push(sched, &dp, 1, 0));
+    EXPECT_EQ(OPRT_EXCEED_UPPER_LIMIT, dp_rept_sched_rule_set(sched, MAX_DP_NUM, 0, true));
+    EXPECT_EQ((uint32_t)MAX_DP_NUM, dp_rept_sched_pending(sched));
+
+    poll(WINDOW_MS);
+    ASSERT_EQ(1U, reports.size());
+    EXPECT_EQ((size_t)MAX_DP_NUM, reports[0].dps.size());
+}
+
+TEST_F(DpReptSched, SurvivesTheClockWrap)
+{
+    uint32_t start = 0xFFFFFFFFU - 50;
+
+    push(start, 1, 10);
+    EXPECT_EQ((uint32_t)WINDOW_MS, dp_rept_sched_next(sched, start));
+    EXPECT_EQ(1U, poll(start + WINDOW_MS - 1));
+    EXPECT_TRUE(reports.empty());
+    poll(start + WINDOW_MS);
+    EXPECT_EQ(1U, reports.size());
+}
+
+TEST_F(DpReptSched, SliderDragIsCoalesced)
+{
+    std::vector<Change> changes;
+
+    // a brightness slider dragged for a second, a change every 20 ms
+    for (uint32_t i = 0; i < 50; i++) {
+        changes.push_back({i * 20, 22, (int)i});
+    }
+    replay(changes);
+
+    // one report per window and the final value last
+    ASSERT_EQ(5U, reports.size());
+    for (size_t i = 0; i < reports.size(); i++) {
+        EXPECT_EQ((i + 1) * WINDOW_MS, reports[i].at_ms);
+        EXPECT_EQ(1U, reports[i].dps.size());
+    }
+    EXPECT_EQ(49, reports.back().dps[0].second);
+}
+
+TEST_F(DpReptSched, RateLimitedSensorKeepsItsInterval)
+{
+    std::vector<Change> changes;
+
+    // a sensor changing every 100 ms, limited to a report per second, next to a switch
+    ASSERT_EQ(OPRT_OK, dp_rept_sched_rule_set(sched, 101, 1000, false));
+    for (uint32_t i = 0; i < 40; i++) {
+        changes.push_back({i * 100, 101, (int)i});
+    }
+    changes.push_back({1550, 1, 1});
+    replay(changes);
+
+    uint32_t last = 0, sensor = 0;
+    bool switched = false;
+    for (auto &r : reports) {
+        for (auto &dp : r.dps) {
+            if (101 == dp.first) {
+                EXPECT_TRUE(0 == sensor || r.at_ms - last >= 1000) << "sensor reported at " << r.at_ms;
+                last = r.at_ms;
+                sensor++;
+            } else {
+                // the switch only waits for its own window
+                EXPECT_EQ(1550U + WINDOW_MS, r.at_ms);
+                switched = true;
+            }
+        }
+    }
+    EXPECT_TRUE(switched);
+    EXPECT_LE(sensor, 5U);
+    EXPECT_EQ(39, reports.back().dps.back().second);
+}
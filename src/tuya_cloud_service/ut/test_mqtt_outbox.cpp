@@ -0,0 +1,325 @@
+/**
+ * @file test_mqtt_outbox.cpp
+ * @brief UT of the QoS1 outbox of the MQTT service.
+ *
+ * The broker is the send callback: it hands out msgids and keeps what it was
+ * sent, and killing the transport makes it fail until the link comes back,
+ * like mqtt_service does on a disconnect. KV is kept in memory so a reboot is
+ * a new outbox restoring from it.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "tuya_iot_config.h"
+#include "tuya_config_defaults.h"
+#include "tuya_error_code.h"
+#include "tal_api.h"
+#include "bench_port.h"
+#include "mqtt_outbox.h"
+}
+
+#define TOPIC "smart/device/out/ut"
+
+namespace {
+
+struct Sent {
+    uint16_t msgid;
+    std::string payload;
+};
+
+struct Broker {
+    bool alive = true;
+    uint16_t next_msgid = 1;
+    std::vector<Sent> sent;
+};
+
+std::map<std::string, std::string> sg_kv;
+std::vector<std::pair<int, std::string>> sg_results;
+
+uint16_t __send(const char *topic, const uint8_t *payload, size_t length, void *user_data)
+{
+    Broker *broker = (Broker *)user_data;
+
+    if (!broker->alive) {
+        return 0;
+    }
+    broker->sent.push_back({broker->next_msgid, std::string((const char *)payload, length)});
+
+    return broker->next_msgid++;
+}
+
+void __notify(int result, void *user_data)
+{
+    sg_results.push_back({result, *(std::string *)user_data});
+}
+
+class MqttOutbox : public ::testing::Test {
+  protected:
+    void SetUp() override
+    {
+        sg_kv.clear();
+        sg_results.clear();
+        outbox = mqtt_outbox_create(__send, &broker);
+        ASSERT_NE(nullptr, outbox);
+    }
+
+    void TearDown() override
+    {
+        mqtt_outbox_destroy(outbox);
+    }
+
+    int push(const std::string &payload, int timeout_ms = 0)
+    {
+        names.push_back(new std::string(payload.substr(0, 8)));
+        return mqtt_outbox_push(outbox, TOPIC, (const uint8_t *)payload.data(), payload.size(), __notify,
+                                names.back(), timeout_ms);
+    }
+
+    // acks everything sent since the last call, newest first
+    void ack_all()
+    {
+        for (size_t i = broker.sent.size(); i > acked; i--) {
+            mqtt_outbox_ack(outbox, broker.sent[i - 1].msgid);
+        }
+        acked = broker.sent.size();
+    }
+
+    // the transport dies, mqtt_service marks the link down on the disconnect
+    void kill_transport()
+    {
+        broker.alive = false;
+        mqtt_outbox_link_down(outbox);
+    }
+
+    void reconnect()
+    {
+        broker.alive = true;
+        acked = broker.sent.size();
+        mqtt_outbox_link_up(outbox);
+    }
+
+    std::vector<std::string> payloads(size_t from = 0)
+    {
+        std::vector<std::string> v;
+
+        for (size_t i = from; i < broker.sent.size(); i++) {
+            v.push_back(broker.sent[i].payload);
+        }
+        return v;
+    }
+
+    Broker broker;
+    mqtt_outbox_t *outbox = nullptr;
+    size_t acked = 0;
+    std::vector<std::string *> names;
+
+    ~MqttOutbox()
+    {
+        for (auto n : names) {
+            delete n;
+        }
+    }
+};
+
+} // namespace
+
+extern "C" {
+int tal_kv_set(const char *key, const uint8_t *value, size_t length)
+{
+    sg_kv[key] = std::string((const char *)value, length);
+    return OPRT_OK;
+}
+
+int tal_kv_get(const char *key, uint8_t **value, size_t *length)
+{
+    auto it = sg_kv.find(key);
+
+    if (it == sg_kv.end()) {
+        return OPRT_NOT_FOUND;
+    }
+    *value = (uint8_t *)tal_malloc(it->second.size());
+    memcpy(*value, it->second.data(), it->second.size());
+    *length = it->second.size();
+    return OPRT_OK;
+}
+
+int tal_kv_free(uint8_t *value)
+{
+    tal_free(value);
+    return OPRT_OK;
+}
+
+int tal_kv_del(const char *key)
+{
+    sg_kv.erase(key);
+    return OPRT_OK;
+}
+}
+
+TEST_F(MqttOutbox, SendsInOrderWithinTheWindow)
+{
+    for (int i = 0; i < 10; i++) {
+        ASSERT_EQ(OPRT_OK, push("msg" + std::to_string(i)));
+    }
+    EXPECT_EQ(0, mqtt_outbox_flush(outbox)); // offline
+    mqtt_outbox_link_up(outbox);
+
+    EXPECT_EQ(MQTT_OUTBOX_WINDOW, mqtt_outbox_flush(outbox));
+    // an ack out of order frees a slot of the window only
+    EXPECT_EQ(OPRT_OK, mqtt_outbox_ack(outbox, broker.sent[1].msgid));
+    EXPECT_EQ(1, mqtt_outbox_flush(outbox));
+    EXPECT_EQ(OPRT_NOT_FOUND, mqtt_outbox_ack(outbox, broker.sent[1].msgid));
+
+    while (mqtt_outbox_pending(outbox)) {
+        ack_all();
+        mqtt_outbox_flush(outbox);
+    }
+
+    std::vector<std::string> expected;
+    for (int i = 0; i < 10; i++) {
+        expected.push_back("msg" + std::to_string(i));
+    }
+    EXPECT_EQ(expected, payloads());
+    ASSERT_EQ(10U, sg_results.size());
+    for (auto &r : sg_results) {
+        EXPECT_EQ(OPRT_OK, r.first);
+    }
+}
+
+TEST_F(MqttOutbox, ReplaysInOrderWhenTheTransportIsKilled)
+{
+    mqtt_outbox_link_up(outbox);
+    for (int i = 0; i < 6; i++) {
+        ASSERT_EQ(OPRT_OK, push("msg" + std::to_string(i)));
+    }
+    mqtt_outbox_flush(outbox);
+    // msg0 is acked, the PUBACKs of the others are lost with the link
+    EXPECT_EQ(OPRT_OK, mqtt_outbox_ack(outbox, broker.sent[0].msgid));
+    size_t before = broker.sent.size();
+    uint16_t lost = broker.sent[1].msgid;
+
+    kill_transport();
+    ASSERT_EQ(OPRT_OK, push("late"));
+    EXPECT_EQ(0, mqtt_outbox_flush(outbox));
+    EXPECT_EQ(6U, mqtt_outbox_pending(outbox));
+
+    reconnect();
+    while (mqtt_outbox_pending(outbox)) {
+        ASSERT_GT(mqtt_outbox_flush(outbox), 0);
+        ack_all();
+    }
+    // a PUBACK of the old session does not complete a replayed message
+    EXPECT_EQ(OPRT_NOT_FOUND, mqtt_outbox_ack(outbox, lost));
+
+    std::vector<std::string> expected = {"msg1", "msg2", "msg3", "msg4", "msg5", "late"};
+    EXPECT_EQ(expected, payloads(before));
+    EXPECT_EQ(7U, sg_results.size());
+}
+
+TEST_F(MqttOutbox, SurvivesARebootWhileOffline)
+{
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(OPRT_OK, push("msg" + std::to_string(i)));
+    }
+    kill_transport();
+    ASSERT_EQ(1U, sg_kv.count(MQTT_OUTBOX_KV_KEY));
+
+    mqtt_outbox_destroy(outbox);
+    outbox = mqtt_outbox_create(__send, &broker);
+    ASSERT_NE(nullptr, outbox);
+    // another activation does not get the messages
+    EXPECT_EQ(0, mqtt_outbox_restore(outbox, "smart/device/out/other"));
+    sg_kv.clear();
+    push("keep");
+    kill_transport();
+    mqtt_outbox_destroy(outbox);
+
+    outbox = mqtt_outbox_create(__send, &broker);
+    ASSERT_NE(nullptr, outbox);
+    EXPECT_EQ(1, mqtt_outbox_restore(outbox, TOPIC));
+    reconnect();
+    mqtt_outbox_flush(outbox);
+    ack_all();
+    EXPECT_EQ(0U, mqtt_outbox_pending(outbox));
+    // the saved copy goes once everything in it is acked
+    EXPECT_EQ(0U, sg_kv.count(MQTT_OUTBOX_KV_KEY));
+    EXPECT_EQ(std::vector<std::string>{"keep"}, payloads());
+}
+
+TEST_F(MqttOutbox, KeepsWhatTheRingCannotHoldOnTheHeap)
+{
+    BENCH_HEAP_STAT_T before, after;
+    std::string large(MQTT_OUTBOX_BUFFER_SIZE + 100, 'L');
+    std::string medium(MQTT_OUTBOX_BUFFER_SIZE / 3, 'M');
+    std::vector<std::string> expected;
+
+    bench_heap_stat_get(&before);
+    // the ring fills up, the rest goes to the heap and keeps its order
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(OPRT_OK, push(medium + std::to_string(i)));
+        expected.push_back(medium + std::to_string(i));
+    }
+    ASSERT_EQ(OPRT_OK, push(large));
+    expected.push_back(large);
+    ASSERT_EQ(OPRT_OK, push("small"));
+    expected.push_back("small");
+
+    kill_transport();
+    reconnect();
+    while (mqtt_outbox_pending(outbox)) {
+        ASSERT_GT(mqtt_outbox_flush(outbox), 0);
+        ack_all();
+    }
+    EXPECT_EQ(expected, payloads());
+    EXPECT_EQ(6U, sg_results.size());
+
+    bench_heap_stat_get(&after);
+    EXPECT_EQ(before.cur_bytes, after.cur_bytes);
+}
+
+TEST_F(MqttOutbox, SavesTheRingOnly)
+{
+    std::string large(MQTT_OUTBOX_BUFFER_SIZE + 100, 'L');
+
+    ASSERT_EQ(OPRT_OK, push("ring"));
+    ASSERT_EQ(OPRT_OK, push(large));
+    kill_transport();
+    mqtt_outbox_destroy(outbox);
+
+    outbox = mqtt_outbox_create(__send, &broker);
+    ASSERT_NE(nullptr, outbox);
+    EXPECT_EQ(1, mqtt_outbox_restore(outbox, TOPIC));
+}
+
+TEST_F(MqttOutbox, RejectsWhatNeverFits)
+{
+    EXPECT_EQ(OPRT_MSG_OUT_OF_LIMIT, push(std::string(MQTT_OUTBOX_BUFFER_SIZE + MQTT_OUTBOX_HEAP_SIZE, 'H')));
+    // the heap is full, a message the ring could take waits behind it
+    ASSERT_EQ(OPRT_OK, push(std::string(MQTT_OUTBOX_HEAP_SIZE - 64, 'h')));
+    EXPECT_EQ(OPRT_EXCEED_UPPER_LIMIT, push("small"));
+    EXPECT_EQ(1U, mqtt_outbox_pending(outbox));
+}
+
+TEST_F(MqttOutbox, ExpiresMessagesNotAckedInTime)
+{
+    mqtt_outbox_link_up(outbox);
+    ASSERT_EQ(OPRT_OK, push("expires", 1));
+    ASSERT_EQ(OPRT_OK, push("stays"));
+    mqtt_outbox_flush(outbox);
+    tal_system_sleep(5);
+    mqtt_outbox_poll(outbox);
+
+    ASSERT_EQ(1U, sg_results.size());
+    EXPECT_EQ(OPRT_TIMEOUT, sg_results[0].first);
+    EXPECT_EQ(1U, mqtt_outbox_pending(outbox));
+    EXPECT_EQ(OPRT_NOT_FOUND, mqtt_outbox_ack(outbox, broker.sent[0].msgid));
+    EXPECT_EQ(OPRT_OK, mqtt_outbox_ack(outbox, broker.sent[1].msgid));
+}
@@ -0,0 +1,282 @@
+/**
+ * @file test_ota_delta.cpp
+ * @brief UT of delta OTA patches, from tools/ota/ota_delta.py to tuya_ota_delta.
+ *
+ * The old and new images are synthetic firmware: recurring code like words
+ * with random bytes in between, the new one made of moved, changed, inserted
+ * and dropped blocks of the old one. The patch is built by ota_delta.py diff
+ * and applied by tuya_ota_delta against the old image in the RAM flash of the
+ * port, in download sized chunks, and the result is compared with the new
+ * image and with what ota_delta.py apply makes of the same patch.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "tuya_cloud_types.h"
+#include "tuya_error_code.h"
+#include "tal_api.h"
+#include "tkl_flash.h"
+#include "bench_port.h"
+#include "tuya_ota_delta.h"
+}
+
+#define OLD_LEN     (96 * 1024)
+#define FLASH_ERASE BENCH_FLASH_BLOCK
+#define SECTOR      4096
+
+namespace {
+
+struct Sink {
+    std::vector<uint8_t> image;
+    uint32_t total = 0;
+    uint32_t sector = 0; // takes whole sectors only but the last one, 0 takes everything
+    bool offset_ok = true;
+};
+
+uint32_t sg_seed = 1;
+
+uint32_t __rand(void)
+{
+    sg_seed = sg_seed * 1103515245U + 12345U;
+    return sg_seed >> 8;
+}
+
+std::vector<uint8_t> __old_image(void)
+{
+    std::vector<uint8_t> words(64 * 16);
+    std::vector<uint8_t> img;
+
+    for (auto &b : words) {
+        b = (uint8_t)__rand();
+    }
+    while (img.size() < OLD_LEN) {
+        if (__rand() % 4) {
+            uint32_t w = __rand() % 64;
+            img.insert(img.end(), words.begin() + w * 16, words.begin() + w * 16 + 16);
+        } else {
+            for (uint32_t i = __rand() % 24; i; i--) {
+                img.push_back((uint8_t)__rand());
+            }
+        }
+    }
+    img.resize(OLD_LEN);
+    return img;
+}
+
+// a new build of the old image: blocks moved, some bytes changed, code added and removed
+std::vector<uint8_t> __new_image(const std::vector<uint8_t> &old)
+{
+    std::vector<uint8_t> img;
+    uint32_t pos = 0;
+
+    while (pos < old.size()) {
+        uint32_t len = 512 + __rand() % 4096;
+        len = (pos + len > old.size()) ? (uint32_t)old.size() - pos : len;
+        switch (__rand() % 8) {
+        case 0: // dropped
+            break;
+        case 1: // new code
+            for (uint32_t i = 0; i < len / 2; i++) {
+                img.push_back((uint8_t)__rand());
+            }
+            img.insert(img.end(), old.begin() + pos, old.begin() + pos + len);
+            break;
+        case 2: { // relocated, a few bytes of every word change
+            size_t start = img.size();
+            img.insert(img.end(), old.begin() + pos, old.begin() + pos + len);
+            for (size_t i = start; i < img.size(); i += 16) {
+                img[i] += 4;
+            }
+            break;
+        }
+        default:
+            img.insert(img.end(), old.begin() + pos, old.begin() + pos + len);
+            break;
+        }
+        pos += len;
+    }
+    return img;
+}
+
+void __file_write(const std::string &path, const std::vector<uint8_t> &data)
+{
+    FILE *f = fopen(path.c_str(), "wb");
+
+    ASSERT_NE(nullptr, f) << path;
+    ASSERT_EQ(data.size(), fwrite(data.data(), 1, data.size(), f));
+    fclose(f);
+}
+
+std::vector<uint8_t> __file_read(const std::string &path)
+{
+    std::vector<uint8_t> data;
+    FILE *f = fopen(path.c_str(), "rb");
+    int c;
+
+    if (f) {
+        while (EOF != (c = fgetc(f))) {
+            data.push_back((uint8_t)c);
+        }
+        fclose(f);
+    }
+    return data;
+}
+
+int __ota_delta_py(const char *cmd, const std::string &in, const std::string &other, const std::string &out)
+{
+    std::string line = "python3 " UT_OTA_DELTA_PY " ";
+
+    line += cmd;
+    line += " " + in + " " + other + " " + out;
+    return system(line.c_str());
+}
+
+// the running image, in the APP partition
+void __flash_load(const std::vector<uint8_t> &img)
+{
+    uint32_t len = ((uint32_t)img.size() + FLASH_ERASE - 1) / FLASH_ERASE * FLASH_ERASE;
+
+    ASSERT_EQ(OPRT_OK, tkl_flash_erase(BENCH_FLASH_APP_ADDR, len));
+    ASSERT_EQ(OPRT_OK, tkl_flash_write(BENCH_FLASH_APP_ADDR, img.data(), (uint32_t)img.size()));
+}
+
+int __sink_cb(uint8_t *data, uint32_t len, uint32_t offset, void *user_data)
+{
+    Sink *sink = (Sink *)user_data;
+
+    sink->offset_ok = sink->offset_ok && (offset == sink->image.size());
+    if (sink->sector && offset + len < sink->total) {
+        len -= len % sink->sector;
+    }
+    sink->image.insert(sink->image.end(), data, data + len);
+    return (int)len;
+}
+
+class OtaDelta : public ::testing::Test {
+  protected:
+    static std::vector<uint8_t> old_img;
+    static std::vector<uint8_t> new_img;
+    static std::vector<uint8_t> patch;
+
+    static void SetUpTestSuite()
+    {
+        std::string dir = UT_OTA_DIR;
+
+        sg_seed = 1;
+        old_img = __old_image();
+        new_img = __new_image(old_img);
+        __file_write(dir + "/old.bin", old_img);
+        __file_write(dir + "/new.bin", new_img);
+        ASSERT_EQ(0, __ota_delta_py("diff", dir + "/old.bin", dir + "/new.bin", dir + "/patch.bin"));
+        patch = __file_read(dir + "/patch.bin");
+    }
+
+    void SetUp() override
+    {
+        ASSERT_FALSE(patch.empty());
+        __flash_load(old_img);
+    }
+
+    // feeds the patch in chunks of the given size
+    OPERATE_RET apply(Sink *sink, uint32_t chunk, const std::vector<uint8_t> &p)
+    {
+        OPERATE_RET rt = OPRT_OK;
+        tuya_ota_delta_t *delta = tuya_ota_delta_create(__sink_cb, sink);
+
+        if (NULL == delta) {
+            return OPRT_MALLOC_FAILED;
+        }
+        sink->total = (uint32_t)new_img.size();
+        for (uint32_t pos = 0; pos < p.size() && OPRT_OK == rt; pos += chunk) {
+            uint32_t n = (pos + chunk > p.size()) ? (uint32_t)p.size() - pos : chunk;
+            rt = tuya_ota_delta_write(delta, p.data() + pos, n);
+        }
+        if (OPRT_OK == rt) {
+            EXPECT_EQ(new_img.size(), tuya_ota_delta_new_size(delta));
+            rt = tuya_ota_delta_finish(delta);
+        }
+        tuya_ota_delta_destroy(delta);
+        return rt;
+    }
+};
+
+std::vector<uint8_t> OtaDelta::old_img;
+std::vector<uint8_t> OtaDelta::new_img;
+std::vector<uint8_t> OtaDelta::patch;
+
+} // namespace
+
+TEST_F(OtaDelta, PatchIsSmallerThanTheImage)
+{
+    EXPECT_TRUE(tuya_ota_delta_detect(patch.data(), patch.size()));
+    EXPECT_FALSE(tuya_ota_delta_detect(new_img.data(), new_img.size()));
+    EXPECT_LT(patch.size(), new_img.size() / 2);
+}
+
+TEST_F(OtaDelta, PythonApplyGivesTheNewImage)
+{
+    std::string dir = UT_OTA_DIR;
+
+    ASSERT_EQ(0, __ota_delta_py("apply", dir + "/old.bin", dir + "/patch.bin", dir + "/out.bin"));
+    EXPECT_TRUE(new_img == __file_read(dir + "/out.bin"));
+}
+
+TEST_F(OtaDelta, RoundTripInAnyChunkSize)
+{
+    uint32_t chunks[] = {1, 7, 80, 1024, 4096, (uint32_t)patch.size()};
+
+    for (uint32_t chunk : chunks) {
+        Sink sink;
+
+        ASSERT_EQ(OPRT_OK, apply(&sink, chunk, patch)) << chunk;
+        EXPECT_TRUE(sink.offset_ok) << chunk;
+        EXPECT_TRUE(new_img == sink.image) << chunk;
+    }
+}
+
+TEST_F(OtaDelta, SectorSinkGetsTheWholeImage)
+{
+    Sink sink;
+
+    // the flash takes whole sectors only, the applier keeps the tail meanwhile
+    sink.sector = SECTOR;
+    ASSERT_EQ(OPRT_OK, apply(&sink, 1024, patch));
+    EXPECT_TRUE(sink.offset_ok);
+    EXPECT_TRUE(new_img == sink.image);
+}
+
+TEST_F(OtaDelta, SinkTakingNothingFails)
+{
+    Sink sink;
+
+    sink.sector = OTA_DELTA_OUT_BUF_MAX * 2;
+    EXPECT_NE(OPRT_OK, apply(&sink, 1024, patch));
+}
+
+TEST_F(OtaDelta, OtherOldImageIsRefused)
+{
+    std::vector<uint8_t> other = old_img;
+    Sink sink;
+
+    other[other.size() / 2] ^= 0x01;
+    __flash_load(other);
+    EXPECT_NE(OPRT_OK, apply(&sink, 1024, patch));
+}
+
+TEST_F(OtaDelta, CorruptedPatchIsRefused)
+{
+    std::vector<uint8_t> bad = patch;
+    Sink sink;
+
+    bad[bad.size() - 1] ^= 0x01;
+    EXPECT_NE(OPRT_OK, apply(&sink, 1024, bad));
+}
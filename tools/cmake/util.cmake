@@ -41,14 +41,16 @@ function(deal_with_components COMPONENTS_LIB HDIR)
 endfunction()
 
 
+# the paths relative to DIR of the directories with a ut/CMakeLists.txt,
+# components of src and their sub modules, or apps
 function(list_uts RETURN DIR)
-    execute_process(COMMAND "find" ${DIR} "-maxdepth" "3" "-wholename" "*ut/CMakeLists.txt"
+    execute_process(COMMAND "find" ${DIR} "-maxdepth" "4" "-wholename" "*/ut/CMakeLists.txt"
         OUTPUT_VARIABLE find_dir)
-    string(REPLACE "\n" ";" sub_split ${find_dir})
+    string(REPLACE "\n" ";" sub_split "${find_dir}")
     foreach(s ${sub_split})
         get_filename_component(ut_dir ${s} DIRECTORY)
         get_filename_component(sub_dir ${ut_dir} DIRECTORY)
-        get_filename_component(comp_name ${sub_dir} NAME)
+        file(RELATIVE_PATH comp_name ${DIR} ${sub_dir})
         list(APPEND ans ${comp_name})
     endforeach(s)
     set(${RETURN} "${ans}" PARENT_SCOPE)
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Compress OTA files for src/tuya_cloud_service/cloud/tuya_ota_decomp.c.
+
+Full images and delta patches from ota_delta.py can both be compressed. The
+upgrade info must carry "compress": "heatshrink" so that the device
+decompresses the download before it reaches the delta applier or the OTA
+partition. The device keeps only a window of 2^window_bits bytes.
+
+    header : magic "TYHS", u8 window_bits, u8 lookahead_bits, u16 rsvd,
+             u32 raw_size (little endian)
+    data   : heatshrink bit stream, most significant bit first
+             1 + 8 bits                          -> literal byte
+             0 + window_bits + lookahead_bits    -> copy (count + 1) bytes
+                                                    from (index + 1) bytes back
+
+Usage:
+
+    ota_compress.py compress   in.bin out.bin [-w 11] [-l 4]
+    ota_compress.py decompress in.bin out.bin
+    ota_compress.py sweep      in.bin          # ratio for each window size
+"""
+import argparse
+import struct
+import sys
+import time
+
+HS_MAGIC = b"TYHS"
+HEADER_FMT = "<4sBBHI"
+
+MIN_WINDOW_BITS, MAX_WINDOW_BITS = 8, 14
+MIN_LOOKAHEAD_BITS = 3
+HASH_CHAIN = 32
+
+
+class BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.acc = 0
+        self.n = 0
+
+    def put(self, value, bits):
+        self.acc = (self.acc << bits) | value
+        self.n += bits
+        while self.n >= 8:
+            self.n -= 8
+            self.out.append((self.acc >> self.n) & 0xFF)
+        self.acc &= (1 << self.n) - 1
+
+    def flush(self):
+        if self.n:
+            self.out.append((self.acc << (8 - self.n)) & 0xFF)
+            self.acc = self.n = 0
+        return bytes(self.out)
+
+
+def compress(data, w, l):
+    window = 1 << w
+    max_len = 1 << l
+    # a copy pays off once it is shorter than the literals it replaces
+    min_len = (1 + w + l) // 9 + 1
+    bw = BitWriter()
+    chains = {}
+    i, n = 0, len(data)
+    while i < n:
+        best_len, best_off = 0, 0
+        if i + 2 < n:
+            key = data[i:i + 3]
+            limit = min(max_len, n - i)
+            for p in reversed(chains.get(key, ())):
+                if i - p > window:
+                    break
+                k = 3
+                while k < limit and data[p + k] == data[i + k]:
+                    k += 1
+                if k > best_len:
+                    best_len, best_off = k, i - p
+                    if k == limit:
+                        break
+        if best_len >= max(min_len, 3):
+            bw.put(0, 1)
+            bw.put(best_off - 1, w)
+            bw.put(best_len - 1, l)
+            step = best_len
+        else:
+            bw.put(1, 1)
+            bw.put(data[i], 8)
+            step = 1
+        for j in range(i, min(i + step, n - 2)):
+            chain = chains.setdefault(data[j:j + 3], [])
+            chain.append(j)
+            if len(chain) > HASH_CHAIN:
+                del chain[0]
+        i += step
+
+    return struct.pack(HEADER_FMT, HS_MAGIC, w, l, 0, len(data)) + bw.flush()
+
+
+def decompress(blob):
+    magic, w, l, _, raw_size = struct.unpack_from(HEADER_FMT, blob)
+    if magic != HS_MAGIC:
+        raise ValueError("not a compressed OTA file")
+    out = bytearray()
+    acc, nbits, pos = 0, 0, struct.calcsize(HEADER_FMT)
+
+    def get(bits):
+        nonlocal acc, nbits, pos
+        while nbits < bits:
+            acc = (acc << 8) | blob[pos]
+            pos += 1
+            nbits += 8
+        nbits -= bits
+        v = (acc >> nbits) & ((1 << bits) - 1)
+        acc &= (1 << nbits) - 1
+        return v
+
+    while len(out) < raw_size:
+        if get(1):
+            out.append(get(8))
+        else:
+            off = get(w) + 1
+            cnt = get(l) + 1
+            for _ in range(cnt):
+                # the window starts zero filled
+                out.append(out[-off] if off <= len(out) else 0)
+    return bytes(out[:raw_size])
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compress OTA files with a small decompression window")
+    parser.add_argument("cmd", choices=("compress", "decompress", "sweep"))
+    parser.add_argument("input")
+    parser.add_argument("output", nargs="?")
+    parser.add_argument("-w", "--window-bits", type=int, default=11,
+                        help="window of 2^w bytes kept by the device [%d-%d]" % (MIN_WINDOW_BITS, MAX_WINDOW_BITS))
+    parser.add_argument("-l", "--lookahead-bits", type=int, default=4, help="longest copy is 2^l bytes")
+    args = parser.parse_args()
+
+    if not MIN_WINDOW_BITS <= args.window_bits <= MAX_WINDOW_BITS or \
+            not MIN_LOOKAHEAD_BITS <= args.lookahead_bits < args.window_bits:
+        parser.error("invalid window or lookahead bits")
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+
+    if args.cmd == "sweep":
+        for w in range(MIN_WINDOW_BITS, MAX_WINDOW_BITS + 1):
+            start = time.time()
+            out = compress(data, w, args.lookahead_bits)
+            print(f"window {1 << w:6d}: {len(data)} -> {len(out)} bytes "
+                  f"({len(out) * 100 // max(len(data), 1)}%), {time.time() - start:.1f}s")
+        return 0
+
+    if args.output is None:
+        parser.error("output is required")
+
+    if args.cmd == "compress":
+        out = compress(data, args.window_bits, args.lookahead_bits)
+        if decompress(out) != data:
+            raise RuntimeError("compression check failed")
+        print(f"compress: {len(data)} -> {len(out)} bytes ({len(out) * 100 // max(len(data), 1)}%)")
+    else:
+        out = decompress(data)
+
+    with open(args.output, "wb") as f:
+        f.write(out)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
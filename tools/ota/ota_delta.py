@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Build and apply delta OTA patches, see src/tuya_cloud_service/cloud/tuya_ota_delta.c.
+
+The patch turns the image running on the device (as stored in the APP
+partition) into the new image. It is applied on the device while it is
+downloaded, so it is a plain stream of bsdiff style records:
+
+    header  : magic "TYDF", u16 version, u16 rsvd, u32 old_size, u32 new_size,
+              u8 old_sha256[32], u8 new_sha256[32]
+    record  : u32 diff_len, u32 extra_len, i32 seek, diff, extra
+              diff  : diff_len bytes added to the old image, coded as tokens
+                      0xxxxxxx             -> x + 1 literal bytes follow
+                      1xxxxxxx yyyyyyyy    -> (x << 8 | y) + 1 zero bytes
+              extra : extra_len bytes copied to the new image as they are
+              seek  : moves the old image position after the diff
+
+All fields are little endian. Usage:
+
+    ota_delta.py diff  old.bin new.bin patch.bin
+    ota_delta.py apply old.bin patch.bin new.bin
+"""
+import argparse
+import hashlib
+import struct
+import sys
+
+DELTA_MAGIC = b"TYDF"
+DELTA_VERSION = 1
+
+HEADER_FMT = "<4sHHII32s32s"
+RECORD_FMT = "<IIi"
+
+KEY_LEN = 8       # bytes hashed to find match candidates
+KEY_STEP = 4      # old image positions indexed, the images are mostly 4 byte aligned code
+MIN_MATCH = 24    # shorter exact matches are not worth a new record
+
+LITERAL_MAX = 0x80
+ZERO_RUN_MAX = 0x8000
+
+
+def encode_diff(diff):
+    out = bytearray()
+    i, n = 0, len(diff)
+    while i < n:
+        if diff[i] == 0:
+            j = i
+            while j < n and diff[j] == 0 and j - i < ZERO_RUN_MAX:
+                j += 1
+            run = j - i - 1
+            out += bytes((0x80 | (run >> 8), run & 0xFF))
+            i = j
+        else:
+            j = i
+            # a single zero between literals is cheaper inline than as a run
+            while j < n and j - i < LITERAL_MAX and (diff[j] != 0 or (j + 1 < n and diff[j + 1] != 0)):
+                j += 1
+            out.append(j - i - 1)
+            out += diff[i:j]
+            i = j
+    return bytes(out)
+
+
+def decode_diff(data, pos, length):
+    out = bytearray()
+    while len(out) < length:
+        c = data[pos]
+        pos += 1
+        if c & 0x80:
+            out += bytes((((c & 0x7F) << 8) | data[pos]) + 1)
+            pos += 1
+        else:
+            out += data[pos:pos + c + 1]
+            pos += c + 1
+    if len(out) != length:
+        raise ValueError("diff token crosses the record end")
+    return bytes(out), pos
+
+
+def build_index(old):
+    index = {}
+    for i in range(0, len(old) - KEY_LEN + 1, KEY_STEP):
+        index.setdefault(old[i:i + KEY_LEN], i)
+    return index
+
+
+def match_len(old, i, new, j):
+    n = 0
+    limit = min(len(old) - i, len(new) - j)
+    # compare in blocks first, then byte by byte
+    while n + 64 <= limit and old[i + n:i + n + 64] == new[j + n:j + n + 64]:
+        n += 64
+    while n < limit and old[i + n] == new[j + n]:
+        n += 1
+    return n
+
+
+def extend_forward(old, i, new, j, end):
+    """length of the approximate match from (i, j) up to end, bsdiff scoring"""
+    best, score, best_score = 0, 0, 0
+    k = 0
+    limit = min(len(old) - i, end - j)
+    while k < limit:
+        score += 1 if old[i + k] == new[j + k] else -1
+        k += 1
+        if score > best_score:
+            best_score, best = score, k
+        if score < best_score - 64:
+            # too many mismatches in a row, the alignment is lost
+            break
+    return best
+
+
+def make_patch(old, new):
+    index = build_index(old)
+    records = []
+
+    last_j, last_i = 0, 0     # start of the current record in new/old
+    exact = 0                 # exact match length at the record start
+    j = 0
+    while j <= len(new) - KEY_LEN:
+        i = index.get(new[j:j + KEY_LEN])
+        if i is None or i - j == last_i - last_j:
+            j += 1
+            continue
+        n = match_len(old, i, new, j)
+        if n < MIN_MATCH:
+            j += 1
+            continue
+        # does the current alignment still do as well here?
+        ci = last_i + (j - last_j)
+        if 0 <= ci < len(old) and match_len(old, ci, new, j) >= n:
+            j += n
+            continue
+
+        records.append(close_record(old, new, last_i, last_j, exact, j, i))
+        last_i, last_j, exact = i, j, n
+        j += n
+
+    records.append(close_record(old, new, last_i, last_j, exact, len(new), 0))
+
+    out = bytearray(struct.pack(HEADER_FMT, DELTA_MAGIC, DELTA_VERSION, 0, len(old), len(new),
+                                hashlib.sha256(old).digest(), hashlib.sha256(new).digest()))
+    for r in records:
+        out += r
+    return bytes(out)
+
+
+def close_record(old, new, oi, nj, exact, next_j, next_i):
+    dlen = max(exact, extend_forward(old, oi, new, nj, next_j))
+    dlen = min(dlen, next_j - nj, len(old) - oi)
+    diff = bytes((new[nj + k] - old[oi + k]) & 0xFF for k in range(dlen))
+    extra = new[nj + dlen:next_j]
+    seek = next_i - (oi + dlen)
+    return struct.pack(RECORD_FMT, dlen, len(extra), seek) + encode_diff(diff) + extra
+
+
+def apply_patch(old, patch):
+    magic, version, _, old_size, new_size, old_sha, new_sha = struct.unpack_from(HEADER_FMT, patch)
+    if magic != DELTA_MAGIC or version != DELTA_VERSION:
+        raise ValueError("not a delta patch")
+    if old_size != len(old) or hashlib.sha256(old).digest() != old_sha:
+        raise ValueError("patch does not apply to this image")
+
+    pos = struct.calcsize(HEADER_FMT)
+    new = bytearray()
+    oi = 0
+    while len(new) < new_size:
+        dlen, elen, seek = struct.unpack_from(RECORD_FMT, patch, pos)
+        pos += struct.calcsize(RECORD_FMT)
+        diff, pos = decode_diff(patch, pos, dlen)
+        new += bytes((old[oi + k] + diff[k]) & 0xFF for k in range(dlen))
+        new += patch[pos:pos + elen]
+        pos += elen
+        oi += dlen + seek
+
+    if hashlib.sha256(new).digest() != new_sha:
+        raise ValueError("new image hash mismatch")
+    return bytes(new)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build or apply a delta OTA patch")
+    parser.add_argument("cmd", choices=("diff", "apply"))
+    parser.add_argument("input", help="old image")
+    parser.add_argument("other", help="new image for diff, patch for apply")
+    parser.add_argument("output", help="patch for diff, new image for apply")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as f:
+        old = f.read()
+    with open(args.other, "rb") as f:
+        other = f.read()
+
+    if args.cmd == "diff":
+        out = make_patch(old, other)
+        # check the patch before it is released
+        apply_patch(old, out)
+        print(f"delta: {len(other)} -> {len(out)} bytes ({len(out) * 100 // max(len(other), 1)}%)")
+    else:
+        out = apply_patch(old, other)
+
+    with open(args.output, "wb") as f:
+        f.write(out)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
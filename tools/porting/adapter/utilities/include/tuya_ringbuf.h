@@ -97,6 +97,46 @@ uint32_t tuya_ring_buff_peek(TUYA_RINGBUFF_T ringbuff, void *data, uint32_t len)
  */
 uint32_t tuya_ring_buff_write(TUYA_RINGBUFF_T ringbuff, const void *data, uint32_t len);
 
+/**
+ * @brief get the contiguous free area of ringbuff
+ * the area can be filled in place, by a driver or a DMA, and is handed to
+ * the reader with tuya_ring_buff_write_commit
+ *
+ * @param[in]   ringbuff: ringbuff handle
+ * @param[out]  data:     point to the start of the area
+ * @return  length of the area, 0 if ringbuff is full
+ */
+uint32_t tuya_ring_buff_write_region_get(TUYA_RINGBUFF_T ringbuff, uint8_t **data);
+
+/**
+ * @brief commit data filled in the area of tuya_ring_buff_write_region_get
+ *
+ * @param[in]   ringbuff: ringbuff handle
+ * @param[in]   len:      filled len, at most the length of the area
+ * @return  length of the data committed
+ */
+uint32_t tuya_ring_buff_write_commit(TUYA_RINGBUFF_T ringbuff, uint32_t len);
+
+/**
+ * @brief get the contiguous unread area of ringbuff
+ * the area can be sent in place, by a driver or a DMA, and is released with
+ * tuya_ring_buff_read_commit
+ *
+ * @param[in]   ringbuff: ringbuff handle
+ * @param[out]  data:     point to the start of the area
+ * @return  length of the area, 0 if ringbuff is empty
+ */
+uint32_t tuya_ring_buff_read_region_get(TUYA_RINGBUFF_T ringbuff, uint8_t **data);
+
+/**
+ * @brief release data consumed from the area of tuya_ring_buff_read_region_get
+ *
+ * @param[in]   ringbuff: ringbuff handle
+ * @param[in]   len:      consumed len, at most the length of the area
+ * @return  length of the data released
+ */
+uint32_t tuya_ring_buff_read_commit(TUYA_RINGBUFF_T ringbuff, uint32_t len);
+
 #ifdef __cplusplus
 }
 #endif
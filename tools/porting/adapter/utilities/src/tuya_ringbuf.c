@@ -223,3 +223,64 @@ uint32_t tuya_ring_buff_peek(TUYA_RINGBUFF_T ringbuff, void *data, uint32_t len)
 
     return tmp_len + len;
 }
+
+uint32_t tuya_ring_buff_write_region_get(TUYA_RINGBUFF_T ringbuff, uint8_t **data)
+{
+    __RINGBUFF_T *rbuff = (__RINGBUFF_T *)ringbuff;
+
+    if (rbuff == NULL || data == NULL) {
+        return 0;
+    }
+
+    // the area ends at the end of buff or one byte before out
+    *data = &rbuff->buff[rbuff->in];
+    return GET_MIN(rbuff->len - rbuff->in, tuya_ring_buff_free_size_get(rbuff));
+}
+
+uint32_t tuya_ring_buff_write_commit(TUYA_RINGBUFF_T ringbuff, uint32_t len)
+{
+    uint8_t *data;
+    __RINGBUFF_T *rbuff = (__RINGBUFF_T *)ringbuff;
+
+    len = GET_MIN(len, tuya_ring_buff_write_region_get(rbuff, &data));
+    if (len == 0) {
+        return 0;
+    }
+
+    rbuff->in += len;
+    if (rbuff->in >= rbuff->len) {
+        rbuff->in = 0;
+    }
+
+    return len;
+}
+
+uint32_t tuya_ring_buff_read_region_get(TUYA_RINGBUFF_T ringbuff, uint8_t **data)
+{
+    __RINGBUFF_T *rbuff = (__RINGBUFF_T *)ringbuff;
+
+    if (rbuff == NULL || data == NULL) {
+        return 0;
+    }
+
+    *data = &rbuff->buff[rbuff->out];
+    return GET_MIN(rbuff->len - rbuff->out, tuya_ring_buff_used_size_get(rbuff));
+}
+
+uint32_t tuya_ring_buff_read_commit(TUYA_RINGBUFF_T ringbuff, uint32_t len)
+{
+    uint8_t *data;
+    __RINGBUFF_T *rbuff = (__RINGBUFF_T *)ringbuff;
+
+    len = GET_MIN(len, tuya_ring_buff_read_region_get(rbuff, &data));
+    if (len == 0) {
+        return 0;
+    }
+
+    rbuff->out += len;
+    if (rbuff->out >= rbuff->len) {
+        rbuff->out = 0;
+    }
+
+    return len;
+}
@@ -16,6 +16,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <sys/time.h>
 #include <sys/types.h>
 
@@ -31,15 +32,34 @@ typedef struct {
     int fd;
     pthread_t tid;
     TUYA_UART_IRQ_CB rx_cb;
+    TUYA_UART_IRQ_CB tx_cb;
     uint8_t readchar;
     uint8_t readbuff[1024];
 } uart_dev_t;
 
 static uart_dev_t s_uart_dev[3];
+static struct termios s_term_orig;
+static volatile sig_atomic_t s_term_saved = 0;
+
+// the console was put in raw mode with Ctrl-C off, the shell gets it back as it was
+static void __term_restore(void)
+{
+    if (s_term_saved) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &s_term_orig);
+    }
+}
+
+static void __term_signal_handler(int sig)
+{
+    __term_restore();
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
 
 static void __irq_handler(void *arg)
 {
     uart_dev_t *uart_dev = arg;
+    int pending = 0;
 
     for (;;) {
         fd_set readfd;
@@ -48,6 +68,10 @@ static void __irq_handler(void *arg)
         FD_SET(uart_dev->fd, &readfd);
         select(uart_dev->fd + 1, &readfd, NULL, NULL, NULL);
         if (FD_ISSET(uart_dev->fd, &readfd)) {
+            // readable with nothing to read, stdin was a file or a pipe and ended
+            if (0 == ioctl(uart_dev->fd, FIONREAD, &pending) && 0 == pending) {
+                break;
+            }
             uart_dev->rx_cb(0);
         }
     }
@@ -88,19 +112,30 @@ static void __udp_irq_handler(void *arg)
 OPERATE_RET tkl_uart_init(uint32_t port_id, TUYA_UART_BASE_CFG_T *cfg)
 {
     if (0 == port_id) {
-        struct termios term_orig;
         struct termios term_vi;
 
-        s_uart_dev[port_id].fd = open("/dev/stdin", O_RDWR | O_NOCTTY | O_NDELAY);
+        s_uart_dev[port_id].fd = open("/dev/stdin", O_RDONLY | O_NOCTTY | O_NDELAY);
         if (0 > s_uart_dev[port_id].fd) {
             return OPRT_COM_ERROR;
         }
 
-        tcgetattr(s_uart_dev[port_id].fd, &term_orig);
-        term_vi = term_orig;
-        term_vi.c_lflag &= (~ICANON & ~ECHO); // leave ISIG ON- allow intr's
-        term_vi.c_iflag &= (~IXON & ~ICRNL);
-        tcsetattr(s_uart_dev[port_id].fd, TCSANOW, &term_vi);
+        // saved once, a second init must not take the raw mode for the original
+        if (s_term_saved || 0 == tcgetattr(s_uart_dev[port_id].fd, &s_term_orig)) {
+            if (!s_term_saved) {
+                s_term_saved = 1;
+                atexit(__term_restore);
+                signal(SIGINT, __term_signal_handler);
+                signal(SIGTERM, __term_signal_handler);
+                signal(SIGQUIT, __term_signal_handler);
+                signal(SIGHUP, __term_signal_handler);
+            }
+            term_vi = s_term_orig;
+            term_vi.c_lflag &= (~ICANON & ~ECHO); // leave ISIG ON- allow intr's
+            term_vi.c_iflag &= (~IXON & ~ICRNL);
+            // Ctrl-C goes to the CLI as a byte, Ctrl-\ still quits
+            term_vi.c_cc[VINTR] = _POSIX_VDISABLE;
+            tcsetattr(s_uart_dev[port_id].fd, TCSANOW, &term_vi);
+        }
 
         pthread_attr_t attr;
         pthread_attr_init(&attr);
@@ -144,6 +179,9 @@ OPERATE_RET tkl_uart_init(uint32_t port_id, TUYA_UART_BASE_CFG_T *cfg)
  */
 OPERATE_RET tkl_uart_deinit(uint32_t port_id)
 {
+    if (0 == port_id) {
+        __term_restore();
+    }
     close(s_uart_dev[port_id].fd);
 
     if (1 == port_id) {
@@ -170,9 +208,22 @@ OPERATE_RET tkl_uart_deinit(uint32_t port_id)
  */
 int tkl_uart_write(uint32_t port_id, void *buff, uint16_t len)
 {
+    int ret = 0;
 
     if (0 == port_id) {
-        return write(s_uart_dev[port_id].fd, buff, len);
+        // stdin may be a pipe, the console writes to stdout
+        for (uint16_t sent = 0; sent < len; sent += ret) {
+            ret = write(STDOUT_FILENO, (uint8_t *)buff + sent, len - sent);
+            if (ret <= 0) {
+                return sent ? sent : ret;
+            }
+        }
+
+        // the write is done already, the tx interrupt of an async write comes at once
+        if (s_uart_dev[port_id].tx_cb) {
+            s_uart_dev[port_id].tx_cb(port_id);
+        }
+        return len;
     } else if (1 == port_id) {
         int port = 7878;
         const char *ip = "172.16.61.117"; // IP地址字符串
@@ -182,7 +233,11 @@ int tkl_uart_write(uint32_t port_id, void *buff, uint16_t len)
         address.sin_port = htons(port);
         address.sin_addr.s_addr = inet_addr(ip);
 
-        return sendto(s_uart_dev[port_id].fd, buff, len, 0, (struct sockaddr *)&address, sizeof(address));
+        ret = sendto(s_uart_dev[port_id].fd, buff, len, 0, (struct sockaddr *)&address, sizeof(address));
+        if (ret > 0 && s_uart_dev[port_id].tx_cb) {
+            s_uart_dev[port_id].tx_cb(port_id);
+        }
+        return ret;
     }
 
     return -1;
@@ -224,6 +279,7 @@ void tkl_uart_rx_irq_cb_reg(uint32_t port_id, TUYA_UART_IRQ_CB rx_cb)
  */
 void tkl_uart_tx_irq_cb_reg(uint32_t port_id, TUYA_UART_IRQ_CB tx_cb)
 {
+    s_uart_dev[port_id].tx_cb = tx_cb;
     return;
 }
 
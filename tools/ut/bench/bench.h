@@ -0,0 +1,143 @@
+/**
+ * @file bench.h
+ * @brief Host benchmarks of the hot paths of the SDK.
+ *
+ * A case runs a fixed workload of ops operations per round. The runner times
+ * every round and counts the allocations and the heap peak seen during it.
+ * The speed of a case is its fastest round, the host only ever adds noise
+ * by slowing a round down.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+typedef struct {
+    const char *name;
+    uint32_t ops;   // operations per round
+    uint32_t bytes; // payload bytes per operation, 0 if it is not a throughput case
+    // prepares the case outside of the measure, may be NULL
+    OPERATE_RET (*setup)(void);
+    // one operation, i is the operation index in the round
+    OPERATE_RET (*run)(uint32_t i);
+    // frees what setup got, may be NULL
+    void (*teardown)(void);
+} BENCH_CASE_T;
+
+/***********************************************************
+*************************function define********************
+***********************************************************/
+/**
+ * @brief Cases of the modules without TAL dependencies: CRC, base64, the
+ * cipher wrapper and tal_hash.
+ */
+const BENCH_CASE_T *bench_core_cases_get(uint32_t *num);
+
+/**
+ * @brief Cases of the modules built on TAL: tal_kv, DP JSON and websocket
+ * framing. They need the littlefs and cJSON submodules.
+ */
+const BENCH_CASE_T *bench_tal_cases_get(uint32_t *num);
+
+/**
+ * @brief Cases of the encoding of voice upload chunks, protobuf-c against the
+ * in-place writer. Built with the TAL cases.
+ */
+const BENCH_CASE_T *bench_voice_cases_get(uint32_t *num);
+
+/**
+ * @brief Cases of the lwIP sys_arch mailboxes, the OS queue against the
+ * lock-free one.
+ */
+const BENCH_CASE_T *bench_mbox_cases_get(uint32_t *num);
+
+/**
+ * @brief Cases of the zero copy rx/tx path of the ethernet interface against
+ * the copy path, on lwip's pbuf core.
+ */
+const BENCH_CASE_T *bench_eth_cases_get(uint32_t *num);
+
+/**
+ * @brief Cases of tal_uart streaming through the pty UART of the host port.
+ */
+const BENCH_CASE_T *bench_uart_cases_get(uint32_t *num);
+
+/**
+ * @brief Cases of http_client_request and its connection pool, and of the
+ * ATOP codec, against a loopback HTTP server.
+ */
+const BENCH_CASE_T *bench_http_cases_get(uint32_t *num);
+
+/**
+ * @brief Cases of the dispatch of incoming MQTT publishes to the subscribe
+ * handlers of a gateway with hundreds of sub-device topics.
+ */
+const BENCH_CASE_T *bench_mqtt_cases_get(uint32_t *num);
+
+/**
+ * @brief Cases of the MQTT client streaming publishes larger than its buffer
+ * from a loopback broker.
+ */
+const BENCH_CASE_T *bench_mqtt_recv_cases_get(uint32_t *num);
+
+/**
+ * @brief Cases of the AES API of tal_symmetry, keyed once against the
+ * convenience functions.
+ */
+const BENCH_CASE_T *bench_aes_cases_get(uint32_t *num);
+
+/**
+ * @brief Cases of the command line engine of tal_cli, on the console of a pty
+ * UART.
+ */
+const BENCH_CASE_T *bench_cli_cases_get(uint32_t *num);
+
+/**
+ * @brief Cases of the touch filter and gesture recognizer, on recorded traces.
+ */
+const BENCH_CASE_T *bench_touch_cases_get(uint32_t *num);
+
+/**
+ * @brief Cases of the quadrature decoder and speed estimator of the encoder
+ * driver, on synthetic edges.
+ */
+const BENCH_CASE_T *bench_encoder_cases_get(uint32_t *num);
+
+/**
+ * @brief Cases of the streaming decompression of compressed OTA downloads.
+ */
+const BENCH_CASE_T *bench_ota_cases_get(uint32_t *num);
+
+/**
+ * @brief Cases of tal_workqueue, the queueing latency of short works behind
+ * slow ones on a single thread and on a multi-worker queue.
+ */
+const BENCH_CASE_T *bench_workq_cases_get(uint32_t *num);
+
+/**
+ * @brief Records a latency of the running case, the runner reports the 99th
+ * percentile of the round.
+ */
+void bench_latency_record(uint64_t ns);
+
+/**
+ * @brief Fills a buffer with the same pseudo random bytes on every run.
+ */
+void bench_data_fill(uint8_t *buf, uint32_t len, uint32_t seed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BENCH_H__ */
@@ -0,0 +1,278 @@
+/**
+ * @file bench_cases.c
+ * @brief Benchmarks of CRC, base64, the cipher wrapper and tal_hash.
+ *
+ * Every setup checks the result of the module once, a broken module fails
+ * the case instead of reporting a speed.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "tuya_cloud_types.h"
+#include "tal_log.h"
+#include "crc32i.h"
+#include "crc_16.h"
+#include "mix_method.h"
+#include "cipher_wrapper.h"
+#include "tal_hash.h"
+#include "bench.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define BENCH_BUF_LEN  4096
+#define BENCH_B64_LEN  1024
+#define BENCH_GCM_LEN  1024
+#define BENCH_HMAC_LEN 256
+#define BENCH_TAG_LEN  16
+#define BENCH_SIGN_LEN 16 // the random of a LAN session handshake
+#define BENCH_SIGN_NUM 8
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static uint8_t sg_in[BENCH_BUF_LEN];
+static uint8_t sg_out[BENCH_BUF_LEN * 2];
+static uint8_t sg_tmp[BENCH_BUF_LEN * 2];
+static uint8_t sg_tag[BENCH_TAG_LEN];
+static uint8_t sg_key[32];
+static uint8_t sg_nonce[12];
+static uint8_t sg_ad[16];
+static volatile uint32_t sg_sink;
+static tal_hash_mac_key_t *sg_mac_key;
+static tal_hash_buf_t sg_sign_bufs[BENCH_SIGN_NUM];
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static OPERATE_RET __data_setup(void)
+{
+    bench_data_fill(sg_in, sizeof(sg_in), 1);
+    bench_data_fill(sg_key, sizeof(sg_key), 2);
+    bench_data_fill(sg_nonce, sizeof(sg_nonce), 3);
+    bench_data_fill(sg_ad, sizeof(sg_ad), 4);
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __crc32_setup(void)
+{
+    __data_setup();
+
+    // CRC-32 check value
+    return (0xCBF43926 == hash_crc32i_total("123456789", 9)) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+static OPERATE_RET __crc32_run(uint32_t i)
+{
+    sg_sink += hash_crc32i_total(sg_in, BENCH_BUF_LEN);
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __crc16_run(uint32_t i)
+{
+    sg_sink += get_crc_16(sg_in, 1024);
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __b64_setup(void)
+{
+    __data_setup();
+
+    tuya_base64_encode(sg_in, (char *)sg_out, BENCH_B64_LEN);
+    if (BENCH_B64_LEN != tuya_base64_decode((char *)sg_out, sg_tmp) || memcmp(sg_in, sg_tmp, BENCH_B64_LEN)) {
+        return OPRT_COM_ERROR;
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __b64_enc_run(uint32_t i)
+{
+    tuya_base64_encode(sg_in, (char *)sg_tmp, BENCH_B64_LEN);
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __b64_dec_run(uint32_t i)
+{
+    return (BENCH_B64_LEN == tuya_base64_decode((char *)sg_out, sg_tmp)) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+static void __gcm_params(cipher_params_t *params, uint8_t *data)
+{
+    memset(params, 0, sizeof(cipher_params_t));
+    params->cipher_type = MBEDTLS_CIPHER_AES_128_GCM;
+    params->key = sg_key;
+    params->key_len = 16;
+    params->nonce = sg_nonce;
+    params->nonce_len = sizeof(sg_nonce);
+    params->ad = sg_ad;
+    params->ad_len = sizeof(sg_ad);
+    params->data = data;
+    params->data_len = BENCH_GCM_LEN;
+}
+
+static OPERATE_RET __gcm_enc_run(uint32_t i)
+{
+    cipher_params_t params;
+    size_t olen = 0;
+
+    __gcm_params(&params, sg_in);
+
+    return mbedtls_cipher_auth_encrypt_wrapper(&params, sg_out, &olen, sg_tag, BENCH_TAG_LEN);
+}
+
+static OPERATE_RET __gcm_setup(void)
+{
+    cipher_params_t params;
+    size_t olen = 0;
+
+    __data_setup();
+    if (OPRT_OK != __gcm_enc_run(0)) {
+        return OPRT_COM_ERROR;
+    }
+
+    __gcm_params(&params, sg_out);
+    if (OPRT_OK != mbedtls_cipher_auth_decrypt_wrapper(&params, sg_tmp, &olen, sg_tag, BENCH_TAG_LEN) ||
+        BENCH_GCM_LEN != olen || memcmp(sg_in, sg_tmp, BENCH_GCM_LEN)) {
+        return OPRT_COM_ERROR;
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __gcm_dec_run(uint32_t i)
+{
+    cipher_params_t params;
+    size_t olen = 0;
+
+    __gcm_params(&params, sg_out);
+
+    return mbedtls_cipher_auth_decrypt_wrapper(&params, sg_tmp, &olen, sg_tag, BENCH_TAG_LEN);
+}
+
+static OPERATE_RET __hmac_run(uint32_t i)
+{
+    return mbedtls_message_digest_hmac(MBEDTLS_MD_SHA256, sg_key, sizeof(sg_key), sg_in, BENCH_HMAC_LEN, sg_tmp);
+}
+
+static OPERATE_RET __sha256_run(uint32_t i)
+{
+    return mbedtls_message_digest(MBEDTLS_MD_SHA256, sg_in, BENCH_BUF_LEN, sg_tmp);
+}
+
+static OPERATE_RET __sign_run(uint32_t i)
+{
+    return tal_sha256_mac(sg_key, sizeof(sg_key), sg_in + i % 64, BENCH_SIGN_LEN, sg_tmp);
+}
+
+static OPERATE_RET __mac_key_run(uint32_t i)
+{
+    return tal_hash_mac_key_sign(sg_mac_key, sg_in + i % 64, BENCH_SIGN_LEN, sg_tmp);
+}
+
+static OPERATE_RET __mac_multi_run(uint32_t i)
+{
+    return tal_hash_mac_key_sign_multi(sg_mac_key, sg_sign_bufs, BENCH_SIGN_NUM, sg_tmp);
+}
+
+// the keyed object against the one-shot MAC and the digests of a batch
+// against one by one, for both hashes and for keys above the block size
+static OPERATE_RET __mac_key_check(void)
+{
+    static const size_t keylens[] = {4, 16, 32, 64, 65, 131};
+    static const TAL_HASH_MAC_TYPE_E types[] = {TAL_HASH_MAC_SHA1, TAL_HASH_MAC_SHA256};
+    tal_hash_mac_key_t *mac_key = NULL;
+    OPERATE_RET rt = OPRT_OK;
+    uint8_t one[32];
+    size_t size;
+    uint32_t t, k, n;
+
+    for (t = 0; t < CNTSOF(types); t++) {
+        size = (TAL_HASH_MAC_SHA256 == types[t]) ? 32 : 20;
+        for (k = 0; k < CNTSOF(keylens); k++) {
+            TUYA_CALL_ERR_RETURN(tal_hash_mac_key_create(types[t], sg_tmp, keylens[k], &mac_key));
+            // a message given up halfway does not leak into the next
+            tal_hash_mac_key_update(mac_key, sg_in, 7);
+            tal_hash_mac_key_starts(mac_key);
+            rt = tal_hash_mac_key_sign_multi(mac_key, sg_sign_bufs, BENCH_SIGN_NUM, sg_out);
+            tal_hash_mac_key_free(mac_key);
+            TUYA_CALL_ERR_RETURN(rt);
+
+            for (n = 0; n < BENCH_SIGN_NUM; n++) {
+                if (TAL_HASH_MAC_SHA256 == types[t]) {
+                    rt = tal_sha256_mac(sg_tmp, keylens[k], sg_sign_bufs[n].input, sg_sign_bufs[n].ilen, one);
+                } else {
+                    rt = tal_sha1_mac(sg_tmp, keylens[k], sg_sign_bufs[n].input, sg_sign_bufs[n].ilen, one);
+                }
+                if (OPRT_OK != rt || memcmp(one, sg_out + n * size, size)) {
+                    return OPRT_COM_ERROR;
+                }
+            }
+        }
+    }
+
+    TUYA_CALL_ERR_RETURN(tal_sha256_multi_ret(sg_sign_bufs, BENCH_SIGN_NUM, sg_out, 0));
+    for (n = 0; n < BENCH_SIGN_NUM; n++) {
+        TUYA_CALL_ERR_RETURN(tal_sha256_ret(sg_sign_bufs[n].input, sg_sign_bufs[n].ilen, one, 0));
+        if (memcmp(one, sg_out + n * 32, 32)) {
+            return OPRT_COM_ERROR;
+        }
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __mac_key_setup(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t n;
+
+    __data_setup();
+    bench_data_fill(sg_tmp, 256, 5);
+    for (n = 0; n < BENCH_SIGN_NUM; n++) {
+        // messages of different lengths
+        sg_sign_bufs[n].input = sg_in + n * 64;
+        sg_sign_bufs[n].ilen = BENCH_SIGN_LEN + n * 9;
+    }
+    TUYA_CALL_ERR_RETURN(__mac_key_check());
+    for (n = 0; n < BENCH_SIGN_NUM; n++) {
+        sg_sign_bufs[n].ilen = BENCH_SIGN_LEN;
+    }
+
+    return tal_hash_mac_key_create(TAL_HASH_MAC_SHA256, sg_key, sizeof(sg_key), &sg_mac_key);
+}
+
+static void __mac_key_teardown(void)
+{
+    tal_hash_mac_key_free(sg_mac_key);
+    sg_mac_key = NULL;
+}
+
+static const BENCH_CASE_T sg_core_cases[] = {
+    {"crc32_4k", 20000, BENCH_BUF_LEN, __crc32_setup, __crc32_run, NULL},
+    {"crc16_1k", 50000, 1024, __data_setup, __crc16_run, NULL},
+    {"base64_enc_1k", 50000, BENCH_B64_LEN, __b64_setup, __b64_enc_run, NULL},
+    {"base64_dec_1k", 50000, BENCH_B64_LEN, __b64_setup, __b64_dec_run, NULL},
+    {"aes128_gcm_enc_1k", 10000, BENCH_GCM_LEN, __gcm_setup, __gcm_enc_run, NULL},
+    {"aes128_gcm_dec_1k", 10000, BENCH_GCM_LEN, __gcm_setup, __gcm_dec_run, NULL},
+    {"hmac_sha256_256", 20000, BENCH_HMAC_LEN, __data_setup, __hmac_run, NULL},
+    {"sha256_4k", 5000, BENCH_BUF_LEN, __data_setup, __sha256_run, NULL},
+    {"tal_sha256_mac_16", 100000, BENCH_SIGN_LEN, __mac_key_setup, __sign_run, __mac_key_teardown},
+    {"tal_mac_key_16", 100000, BENCH_SIGN_LEN, __mac_key_setup, __mac_key_run, __mac_key_teardown},
+    {"tal_mac_key_multi8_16", 20000, BENCH_SIGN_LEN * BENCH_SIGN_NUM, __mac_key_setup, __mac_multi_run,
+     __mac_key_teardown},
+};
+
+const BENCH_CASE_T *bench_core_cases_get(uint32_t *num)
+{
+    *num = CNTSOF(sg_core_cases);
+
+    return sg_core_cases;
+}
@@ -0,0 +1,166 @@
+/**
+ * @file bench_cases_aes.c
+ * @brief Benchmarks of the AES API of tal_symmetry.
+ *
+ * aes128_cbc_encode is the convenience function that allocates the
+ * padded output and sets the key up for every message. The tal_aes_key cases
+ * run the same message with a key created once: in place with PKCS7 added at
+ * the edge, in chunks through a stream the way tal_kv writes a value, and
+ * through GCM against the aes128_gcm cases of the cipher wrapper.
+ *
+ * The known answers, the padding and the streams are checked by the UT of
+ * tal_security.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "tuya_cloud_types.h"
+#include "tal_log.h"
+#include "tal_symmetry.h"
+#include "bench.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define BENCH_AES_LEN   1024
+#define BENCH_AES_SMALL 64 // a DP report
+#define BENCH_AES_CHUNK 64
+#define BENCH_AES_TAG   16
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static uint8_t sg_in[BENCH_AES_LEN];
+static uint8_t sg_buf[TAL_AES_PKCS7_LEN(BENCH_AES_LEN)];
+static uint8_t sg_out[TAL_AES_PKCS7_LEN(BENCH_AES_LEN) + 16];
+static uint8_t sg_key[16];
+static uint8_t sg_iv[16];
+static uint8_t sg_nonce[12];
+static uint8_t sg_ad[16];
+static uint8_t sg_tag[BENCH_AES_TAG];
+static tal_aes_key_t *sg_enc_key;
+static tal_aes_key_t *sg_gcm_key;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+// a message through a stream in chunks of chunk bytes
+static OPERATE_RET __stream_run(tal_aes_key_t *aes_key, TAL_SYMMETRY_CRYPT_MODE crypt, const uint8_t *iv,
+                                const uint8_t *input, size_t len, size_t chunk, uint8_t *output, size_t *olen)
+{
+    tal_aes_stream_t stream;
+    OPERATE_RET rt = OPRT_OK;
+    size_t done = 0, n, i;
+
+    TUYA_CALL_ERR_RETURN(tal_aes_stream_start(&stream, aes_key, crypt, iv, 16, TRUE));
+    for (i = 0; i < len; i += chunk) {
+        n = (len - i < chunk) ? len - i : chunk;
+        TUYA_CALL_ERR_RETURN(tal_aes_stream_update(&stream, input + i, n, output + done, chunk + 16, &n));
+        done += n;
+    }
+    TUYA_CALL_ERR_RETURN(tal_aes_stream_finish(&stream, output + done, 16, &n, NULL, 0));
+    *olen = done + n;
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __aes_setup(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    bench_data_fill(sg_in, sizeof(sg_in), 1);
+    bench_data_fill(sg_key, sizeof(sg_key), 2);
+    bench_data_fill(sg_iv, sizeof(sg_iv), 3);
+    bench_data_fill(sg_nonce, sizeof(sg_nonce), 4);
+    bench_data_fill(sg_ad, sizeof(sg_ad), 5);
+
+    TUYA_CALL_ERR_RETURN(tal_aes_key_create(TAL_AES_CBC, SYMMETRY_ENCRYPT, sg_key, 128, &sg_enc_key));
+    TUYA_CALL_ERR_RETURN(tal_aes_key_create(TAL_AES_GCM, SYMMETRY_ENCRYPT, sg_key, 128, &sg_gcm_key));
+
+    return OPRT_OK;
+}
+
+static void __aes_teardown(void)
+{
+    tal_aes_key_free(sg_enc_key);
+    sg_enc_key = NULL;
+    tal_aes_key_free(sg_gcm_key);
+    sg_gcm_key = NULL;
+}
+
+static OPERATE_RET __cbc_encode(uint32_t len)
+{
+    uint8_t *ec_data = NULL;
+    uint32_t ec_len = 0;
+    OPERATE_RET rt = OPRT_OK;
+
+    memcpy(sg_iv, sg_out, 16);
+    rt = tal_aes128_cbc_encode(sg_in, len, sg_key, sg_iv, &ec_data, &ec_len);
+    tal_aes_free_data(ec_data);
+
+    return rt;
+}
+
+static OPERATE_RET __key_cbc(uint32_t len)
+{
+    size_t olen = 0;
+
+    memcpy(sg_iv, sg_out, 16);
+    memcpy(sg_buf, sg_in, len);
+
+    return tal_aes_key_encrypt_pkcs7(sg_enc_key, sg_iv, sg_buf, len, sg_buf, sizeof(sg_buf), &olen);
+}
+
+static OPERATE_RET __cbc_encode_run(uint32_t i)
+{
+    return __cbc_encode(BENCH_AES_LEN);
+}
+
+static OPERATE_RET __cbc_encode_small_run(uint32_t i)
+{
+    return __cbc_encode(BENCH_AES_SMALL);
+}
+
+static OPERATE_RET __key_cbc_run(uint32_t i)
+{
+    return __key_cbc(BENCH_AES_LEN);
+}
+
+static OPERATE_RET __key_cbc_small_run(uint32_t i)
+{
+    return __key_cbc(BENCH_AES_SMALL);
+}
+
+static OPERATE_RET __stream_cbc_run(uint32_t i)
+{
+    size_t olen = 0;
+
+    memcpy(sg_iv, sg_out, 16);
+
+    return __stream_run(sg_enc_key, SYMMETRY_ENCRYPT, sg_iv, sg_in, BENCH_AES_LEN, BENCH_AES_CHUNK, sg_buf, &olen);
+}
+
+static OPERATE_RET __key_gcm_run(uint32_t i)
+{
+    return tal_aes_key_gcm_encrypt(sg_gcm_key, sg_nonce, sizeof(sg_nonce), sg_ad, sizeof(sg_ad), sg_in, BENCH_AES_LEN,
+                                   sg_buf, sg_tag, BENCH_AES_TAG);
+}
+
+static const BENCH_CASE_T sg_aes_cases[] = {
+    {"aes128_cbc_encode_1k", 20000, BENCH_AES_LEN, __aes_setup, __cbc_encode_run, __aes_teardown},
+    {"tal_aes_key_cbc_1k", 20000, BENCH_AES_LEN, __aes_setup, __key_cbc_run, __aes_teardown},
+    {"aes128_cbc_encode_64", 200000, BENCH_AES_SMALL, __aes_setup, __cbc_encode_small_run, __aes_teardown},
+    {"tal_aes_key_cbc_64", 200000, BENCH_AES_SMALL, __aes_setup, __key_cbc_small_run, __aes_teardown},
+    {"tal_aes_stream_cbc_1k", 20000, BENCH_AES_LEN, __aes_setup, __stream_cbc_run, __aes_teardown},
+    {"tal_aes_key_gcm_1k", 10000, BENCH_AES_LEN, __aes_setup, __key_gcm_run, __aes_teardown},
+};
+
+const BENCH_CASE_T *bench_aes_cases_get(uint32_t *num)
+{
+    *num = CNTSOF(sg_aes_cases);
+
+    return sg_aes_cases;
+}
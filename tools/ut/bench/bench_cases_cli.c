@@ -0,0 +1,296 @@
+/**
+ * @file bench_cases_cli.c
+ * @brief Benchmarks of the command line engine of tal_cli.
+ *
+ * The CLI runs on the pty UART of the host port, its console is driven from
+ * the master side like a terminal would. One operation runs one command line
+ * through tal_cli_exec, among the BENCH_CLI_CMDS commands a device may
+ * register, with its output caught by a callback.
+ *
+ * The setup checks the console first: a piped line, Ctrl-C on a command that
+ * does not end by itself and a line typed while another one runs. Then the
+ * filters, the errors and a script run through tal_cli_exec.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "tuya_cloud_types.h"
+#include "tal_log.h"
+#include "tal_system.h"
+#include "tal_uart.h"
+#include "tal_cli.h"
+#include "bench.h"
+#include "bench_port.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define BENCH_CLI_PORT      TUYA_UART_NUM_3
+#define BENCH_CLI_CMDS      40
+#define BENCH_CLI_OUT_SIZE  4096
+#define BENCH_CLI_WAIT_MS   2000
+#define BENCH_CLI_SPIN_MS   5000 // bench_spin ends by itself after that
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static char sg_names[BENCH_CLI_CMDS][16];
+static cli_cmd_t sg_cmds[BENCH_CLI_CMDS + 3];
+static uint32_t sg_calls;
+static char sg_out[BENCH_CLI_OUT_SIZE];
+static uint32_t sg_out_len;
+static char sg_console[BENCH_CLI_OUT_SIZE];
+static uint32_t sg_console_len;
+static char sg_line[32];
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static void __nop_cmd(int argc, char *argv[])
+{
+    sg_calls += argc;
+}
+
+// bench_lines <n>: "line 0" to "line n-1"
+static void __lines_cmd(int argc, char *argv[])
+{
+    uint32_t i, num = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1;
+
+    for (i = 0; i < num && !tal_cli_canceled(); i++) {
+        tal_cli_printf("\r\nline %u", i);
+    }
+}
+
+// bench_spin: prints until canceled
+static void __spin_cmd(int argc, char *argv[])
+{
+    SYS_TIME_T start = tal_system_get_millisecond();
+    uint32_t i;
+
+    for (i = 0; !tal_cli_canceled() && tal_system_get_millisecond() - start < BENCH_CLI_SPIN_MS; i++) {
+        tal_cli_printf("\r\nspin %u", i);
+        tal_system_sleep(1);
+    }
+}
+
+// bench_sleep <ms>
+static void __sleep_cmd(int argc, char *argv[])
+{
+    tal_system_sleep((argc > 1) ? strtoul(argv[1], NULL, 10) : 1);
+}
+
+static void __out_cb(const char *data, uint32_t len, void *arg)
+{
+    len = MIN(len, BENCH_CLI_OUT_SIZE - 1 - sg_out_len);
+    memcpy(sg_out + sg_out_len, data, len);
+    sg_out_len += len;
+    sg_out[sg_out_len] = '\0';
+}
+
+static int __exec(const char *line)
+{
+    sg_out_len = 0;
+    sg_out[0] = '\0';
+
+    return tal_cli_exec(line, __out_cb, NULL);
+}
+
+static OPERATE_RET __console_send(const char *keys)
+{
+    size_t len = strlen(keys);
+
+    return (write(bench_uart_peer_fd(BENCH_CLI_PORT), keys, len) == (ssize_t)len) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+// reads the console until want shows up, then drops what was read
+static OPERATE_RET __console_expect(const char *want)
+{
+    struct pollfd pfd = {.fd = bench_uart_peer_fd(BENCH_CLI_PORT), .events = POLLIN};
+    SYS_TIME_T start = tal_system_get_millisecond();
+    ssize_t ret;
+
+    while (NULL == strstr(sg_console, want)) {
+        if (tal_system_get_millisecond() - start > BENCH_CLI_WAIT_MS) {
+            fprintf(stderr, "cli: no '%s' on the console, got '%s'\n", want, sg_console);
+            return OPRT_COM_ERROR;
+        }
+        if (poll(&pfd, 1, 20) <= 0) {
+            continue;
+        }
+        ret = read(pfd.fd, sg_console + sg_console_len, sizeof(sg_console) - 1 - sg_console_len);
+        if (ret > 0) {
+            sg_console_len += ret;
+            sg_console[sg_console_len] = '\0';
+        }
+    }
+    sg_console_len = 0;
+    sg_console[0] = '\0';
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __console_check(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    TUYA_CALL_ERR_RETURN(__console_expect("tuya>"));
+
+    TUYA_CALL_ERR_RETURN(__console_send("bench_lines 3 | count\r"));
+    TUYA_CALL_ERR_RETURN(__console_expect("\r\n3\r\ntuya>"));
+
+    // the prompt is back before the command noticed, its output is dropped
+    TUYA_CALL_ERR_RETURN(__console_send("bench_spin\r"));
+    TUYA_CALL_ERR_RETURN(__console_expect("spin 1"));
+    TUYA_CALL_ERR_RETURN(__console_send("\x03"));
+    TUYA_CALL_ERR_RETURN(__console_expect("^C\r\ntuya>"));
+    TUYA_CALL_ERR_RETURN(__console_send("bench_lines 2\r"));
+    TUYA_CALL_ERR_RETURN(__console_expect("line 1\r\ntuya>"));
+    if (strstr(sg_console, "spin")) {
+        fprintf(stderr, "cli: output of a canceled command\n");
+        return OPRT_COM_ERROR;
+    }
+
+    // typed while the first line runs
+    TUYA_CALL_ERR_RETURN(__console_send("bench_sleep 200\rbench_lines 5 | head 1\r"));
+    TUYA_CALL_ERR_RETURN(__console_expect("\r\nline 0\r\ntuya>"));
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __exec_expect(const char *line, int result, const char *out)
+{
+    int ret = __exec(line);
+
+    if (result != ret || 0 != strcmp(sg_out, out)) {
+        fprintf(stderr, "cli: '%s' returned %d with '%s'\n", line, ret, sg_out);
+        return OPRT_COM_ERROR;
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __script_check(void)
+{
+    char path[] = "/tmp/bench_cli_XXXXXX";
+    char line[64];
+    OPERATE_RET rt = OPRT_OK;
+    FILE *fp = NULL;
+    int fd;
+
+    fd = mkstemp(path);
+    if (fd < 0 || NULL == (fp = fdopen(fd, "w"))) {
+        return OPRT_COM_ERROR;
+    }
+    fprintf(fp, "# lines\n\n  bench_lines 5 | grep 3\r\nbench_lines 2\nnope\n");
+    fclose(fp);
+
+    snprintf(line, sizeof(line), "source %s | count", path);
+    rt = __exec_expect(line, OPRT_OK, "\r\n4");
+    if (OPRT_OK == rt) {
+        // a head stops the script too
+        snprintf(line, sizeof(line), "source %s | head 2", path);
+        rt = __exec_expect(line, OPRT_OK, "\r\nline 3\r\nline 0");
+    }
+    if (OPRT_OK == rt) {
+        fp = fopen(path, "w");
+        fprintf(fp, "source %s\n", path);
+        fclose(fp);
+        snprintf(line, sizeof(line), "source %s", path);
+        rt = __exec_expect(line, OPRT_OK, "\r\nScripts nested too deep");
+    }
+    unlink(path);
+
+    return rt;
+}
+
+static OPERATE_RET __cli_check(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    TUYA_CALL_ERR_RETURN(__console_check());
+
+    TUYA_CALL_ERR_RETURN(__exec_expect("bench_lines 2", OPRT_OK, "\r\nline 0\r\nline 1"));
+    TUYA_CALL_ERR_RETURN(__exec_expect("bench_lines 12 | grep -v 1 | count", OPRT_OK, "\r\n9"));
+    TUYA_CALL_ERR_RETURN(__exec_expect("bench_lines 30|grep 2|head 2", OPRT_OK, "\r\nline 2\r\nline 12"));
+    TUYA_CALL_ERR_RETURN(__exec_expect("bench_spin | head 3", OPRT_OK, "\r\nspin 0\r\nspin 1\r\nspin 2"));
+    TUYA_CALL_ERR_RETURN(__exec_expect("help | grep bench_cmd39 | count", OPRT_OK, "\r\n1"));
+    TUYA_CALL_ERR_RETURN(__exec_expect("nope", OPRT_NOT_FOUND, "\r\nNo command or file name"));
+    TUYA_CALL_ERR_RETURN(__exec_expect("bench_lines | sort", OPRT_INVALID_PARM,
+                                       "\r\nBad filter, use grep [-v] <text>, head [lines] or count"));
+    TUYA_CALL_ERR_RETURN(__exec_expect("bench_lines | a | b | c | d", OPRT_INVALID_PARM, "\r\nToo many pipes"));
+
+    return __script_check();
+}
+
+static OPERATE_RET __exec_setup(void)
+{
+    static bool checked = false;
+    OPERATE_RET rt = OPRT_OK;
+
+    if (!checked) {
+        checked = true;
+        TUYA_CALL_ERR_RETURN(__cli_check());
+    }
+    sg_calls = 0;
+    snprintf(sg_line, sizeof(sg_line), "%s a b c", sg_names[BENCH_CLI_CMDS - 1]);
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __exec_run(uint32_t i)
+{
+    uint32_t calls = sg_calls;
+    OPERATE_RET rt = tal_cli_exec(sg_line, __out_cb, NULL);
+
+    return (OPRT_OK == rt && calls + 4 == sg_calls) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+static OPERATE_RET __pipe_run(uint32_t i)
+{
+    OPERATE_RET rt = __exec("bench_lines 64 | grep 3 | count");
+
+    // 3, 13, 23, 30 to 39, 43, 53 and 63
+    return (OPRT_OK == rt && 0 == strcmp(sg_out, "\r\n16")) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+static const BENCH_CASE_T sg_cli_cases[] = {
+    {"cli_exec", 20000, 0, __exec_setup, __exec_run, NULL},
+    {"cli_exec_pipe", 2000, 0, NULL, __pipe_run, NULL},
+};
+
+const BENCH_CASE_T *bench_cli_cases_get(uint32_t *num)
+{
+    static bool inited = false;
+    uint32_t i;
+
+    // the console and its tasks live as long as the device, they are started
+    // here rather than counted as a leak of the first case
+    if (!inited) {
+        inited = true;
+        for (i = 0; i < BENCH_CLI_CMDS; i++) {
+            snprintf(sg_names[i], sizeof(sg_names[i]), "bench_cmd%02u", i);
+            sg_cmds[i].name = sg_names[i];
+            sg_cmds[i].help = "does nothing";
+            sg_cmds[i].func = __nop_cmd;
+        }
+        sg_cmds[i++] = (cli_cmd_t){.name = "bench_lines", .help = "print lines", .func = __lines_cmd};
+        sg_cmds[i++] = (cli_cmd_t){.name = "bench_spin", .help = "print until canceled", .func = __spin_cmd};
+        sg_cmds[i++] = (cli_cmd_t){.name = "bench_sleep", .help = "sleep", .func = __sleep_cmd};
+        tal_cli_cmd_register(sg_cmds, CNTSOF(sg_cmds));
+        if (OPRT_OK != tal_cli_init_with_uart(BENCH_CLI_PORT)) {
+            *num = 0;
+            return NULL;
+        }
+    }
+
+    *num = CNTSOF(sg_cli_cases);
+
+    return sg_cli_cases;
+}
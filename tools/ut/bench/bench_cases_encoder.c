@@ -0,0 +1,80 @@
+/**
+ * @file bench_cases_encoder.c
+ * @brief Benchmarks of the quadrature decoder of the encoder driver.
+ *
+ * One operation runs BENCH_ENCODER_EDGES synthetic edges through
+ * encoder_quad_edge, the work of the GPIO interrupt: a knob turned back and
+ * forth with contact bounce. The decoder and the velocity estimator are
+ * checked by the UT of src/peripherals/encoder.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "tuya_cloud_types.h"
+#include "tal_log.h"
+#include "encoder_quad.h"
+#include "bench.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define BENCH_ENCODER_EDGES 4096
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static uint8_t sg_edges[BENCH_ENCODER_EDGES];
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static void __edges_build(void)
+{
+    static const uint8_t forwards[4] = {3, 2, 0, 1};
+    uint8_t rnd[BENCH_ENCODER_EDGES];
+    int32_t pos = 0;
+    uint32_t i;
+
+    // runs of a few steps each way, one edge in eight bounces back
+    bench_data_fill(rnd, sizeof(rnd), 11);
+    for (i = 0; i < BENCH_ENCODER_EDGES; i++) {
+        if (0 == (rnd[i] & 0x07)) {
+            pos--;
+        } else {
+            pos += (i & 0x100) ? -1 : 1;
+        }
+        sg_edges[i] = forwards[pos & 0x03];
+    }
+}
+
+static OPERATE_RET __decode_setup(void)
+{
+    __edges_build();
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __decode_run(uint32_t i)
+{
+    encoder_quad_t quad;
+    uint32_t e;
+
+    encoder_quad_reset(&quad, ENCODER_QUAD_REST, 4);
+    for (e = 0; e < BENCH_ENCODER_EDGES; e++) {
+        encoder_quad_edge(&quad, sg_edges[e]);
+    }
+
+    return (0 == quad.errors && quad.steps) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+static const BENCH_CASE_T sg_encoder_cases[] = {
+    {"encoder_decode", 20000, 0, __decode_setup, __decode_run, NULL},
+};
+
+const BENCH_CASE_T *bench_encoder_cases_get(uint32_t *num)
+{
+    *num = CNTSOF(sg_encoder_cases);
+
+    return sg_encoder_cases;
+}
@@ -0,0 +1,198 @@
+/**
+ * @file bench_cases_eth.c
+ * @brief Benchmarks of the zero copy rx/tx path of the ethernet interface
+ * against the copy path.
+ *
+ * One operation moves one full sized frame between a simulated driver and
+ * lwip. On rx, eth_rx_copy_1514 copies the driver buffer into a PBUF_POOL
+ * pbuf like a driver without LWIP_TUYA_ZERO_COPY does, eth_rx_zc_1514 lends
+ * it with tuya_ethernetif_rx_input. The netif input strips the ethernet
+ * header and drops the frame. On tx, the frame is a header pbuf chained to a
+ * PBUF_REF payload like the ones of tcp_write, flattened into a driver buffer
+ * by tuya_ethernetif_tx_copy or listed by tuya_ethernetif_tx_sg.
+ *
+ * The cases count the bytes copied on their path, from the counters of
+ * ethernetif_zc.c for the zero copy functions, and print the bytes copied
+ * per frame once the case is over.
+ *
+ * Built with the lwip options of src/liblwip/ut, the pbufs come from the
+ * libc and are not counted in allocs/op.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lwip/mem.h"
+#include "lwip/memp.h"
+#include "lwip/pbuf.h"
+#include "lwip/ethernetif.h"
+#include "bench.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define BENCH_ETH_FRAME_LEN 1514
+#define BENCH_ETH_HDR_LEN   54 // ethernet, ip and tcp headers
+#define BENCH_ETH_HLEN      14
+#define BENCH_ETH_RX_BUFS   4 // the rx ring of the driver
+#define BENCH_ETH_SG_NUM    4
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static struct netif sg_eth_netif;
+static uint8_t sg_eth_rx_buf[BENCH_ETH_RX_BUFS][BENCH_ETH_FRAME_LEN];
+static uint8_t sg_eth_tx_payload[BENCH_ETH_FRAME_LEN - BENCH_ETH_HDR_LEN];
+static uint8_t sg_eth_tx_buf[BENCH_ETH_FRAME_LEN];
+static struct pbuf *sg_eth_tx_pkt = NULL;
+static TUYA_ETHERNETIF_ZC_STAT_T sg_eth_stat;
+static uint32_t sg_eth_released = 0;
+static uint64_t sg_eth_frames = 0;
+static uint64_t sg_eth_copied = 0;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+// what ethernet_input does before passing the frame up, which drops it
+static err_t __eth_input(struct pbuf *p, struct netif *inp)
+{
+    pbuf_remove_header(p, BENCH_ETH_HLEN);
+    pbuf_free(p);
+
+    return ERR_OK;
+}
+
+static void __eth_rx_free_cb(void *buf, void *arg)
+{
+    sg_eth_released++;
+}
+
+static OPERATE_RET __eth_setup(void)
+{
+    uint32_t i;
+
+    mem_init();
+    memp_init();
+    memset(&sg_eth_netif, 0, sizeof(sg_eth_netif));
+    sg_eth_netif.input = __eth_input;
+    for (i = 0; i < BENCH_ETH_RX_BUFS; i++) {
+        bench_data_fill(sg_eth_rx_buf[i], BENCH_ETH_FRAME_LEN, 51 + i);
+    }
+
+    tuya_ethernetif_zc_stat_get(&sg_eth_stat);
+    sg_eth_released = 0;
+    sg_eth_frames = 0;
+    sg_eth_copied = 0;
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __eth_tx_setup(void)
+{
+    struct pbuf *payload = NULL;
+
+    __eth_setup();
+
+    sg_eth_tx_pkt = pbuf_alloc(PBUF_RAW, BENCH_ETH_HDR_LEN, PBUF_RAM);
+    payload = pbuf_alloc(PBUF_RAW, sizeof(sg_eth_tx_payload), PBUF_REF);
+    if (NULL == sg_eth_tx_pkt || NULL == payload) {
+        return OPRT_MALLOC_FAILED;
+    }
+    bench_data_fill(sg_eth_tx_pkt->payload, BENCH_ETH_HDR_LEN, 55);
+    bench_data_fill(sg_eth_tx_payload, sizeof(sg_eth_tx_payload), 56);
+    payload->payload = sg_eth_tx_payload;
+    pbuf_cat(sg_eth_tx_pkt, payload);
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __eth_rx_copy_run(uint32_t i)
+{
+    uint8_t *buf = sg_eth_rx_buf[i % BENCH_ETH_RX_BUFS];
+    struct pbuf *p = NULL;
+
+    p = pbuf_alloc(PBUF_RAW, BENCH_ETH_FRAME_LEN, PBUF_POOL);
+    if (NULL == p) {
+        return OPRT_MALLOC_FAILED;
+    }
+    pbuf_take(p, buf, BENCH_ETH_FRAME_LEN);
+    __eth_rx_free_cb(buf, NULL);
+    if (ERR_OK != sg_eth_netif.input(p, &sg_eth_netif)) {
+        pbuf_free(p);
+    }
+    sg_eth_copied += BENCH_ETH_FRAME_LEN;
+    sg_eth_frames++;
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __eth_rx_zc_run(uint32_t i)
+{
+    uint32_t released = sg_eth_released;
+
+    if (ERR_OK != tuya_ethernetif_rx_input(&sg_eth_netif, sg_eth_rx_buf[i % BENCH_ETH_RX_BUFS],
+                                           BENCH_ETH_FRAME_LEN, __eth_rx_free_cb, NULL)) {
+        return OPRT_COM_ERROR;
+    }
+    sg_eth_frames++;
+
+    // the input drops the frame at once, so the buffer is back already
+    return (released + 1 == sg_eth_released) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+static OPERATE_RET __eth_tx_copy_run(uint32_t i)
+{
+    if (BENCH_ETH_FRAME_LEN != tuya_ethernetif_tx_copy(sg_eth_tx_pkt, sg_eth_tx_buf, sizeof(sg_eth_tx_buf))) {
+        return OPRT_COM_ERROR;
+    }
+    sg_eth_frames++;
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __eth_tx_sg_run(uint32_t i)
+{
+    TUYA_ETHERNETIF_SG_T sg[BENCH_ETH_SG_NUM];
+
+    if (2 != tuya_ethernetif_tx_sg(sg_eth_tx_pkt, sg, BENCH_ETH_SG_NUM)) {
+        return OPRT_COM_ERROR;
+    }
+    sg_eth_frames++;
+
+    return OPRT_OK;
+}
+
+static void __eth_teardown(void)
+{
+    TUYA_ETHERNETIF_ZC_STAT_T stat;
+
+    tuya_ethernetif_zc_stat_get(&stat);
+    sg_eth_copied += stat.rx_copy_bytes - sg_eth_stat.rx_copy_bytes;
+    sg_eth_copied += stat.tx_copy_bytes - sg_eth_stat.tx_copy_bytes;
+    if (sg_eth_frames) {
+        printf("eth: %llu bytes copied per frame of %u\n", (unsigned long long)(sg_eth_copied / sg_eth_frames),
+               BENCH_ETH_FRAME_LEN);
+    }
+
+    if (sg_eth_tx_pkt) {
+        pbuf_free(sg_eth_tx_pkt);
+        sg_eth_tx_pkt = NULL;
+    }
+}
+
+static const BENCH_CASE_T sg_eth_cases[] = {
+    {"eth_rx_copy_1514", 200000, BENCH_ETH_FRAME_LEN, __eth_setup, __eth_rx_copy_run, __eth_teardown},
+    {"eth_rx_zc_1514", 200000, BENCH_ETH_FRAME_LEN, __eth_setup, __eth_rx_zc_run, __eth_teardown},
+    {"eth_tx_copy_1514", 200000, BENCH_ETH_FRAME_LEN, __eth_tx_setup, __eth_tx_copy_run, __eth_teardown},
+    {"eth_tx_sg_1514", 200000, BENCH_ETH_FRAME_LEN, __eth_tx_setup, __eth_tx_sg_run, __eth_teardown},
+};
+
+const BENCH_CASE_T *bench_eth_cases_get(uint32_t *num)
+{
+    *num = CNTSOF(sg_eth_cases);
+
+    return sg_eth_cases;
+}
@@ -0,0 +1,696 @@
+/**
+ * @file bench_cases_http.c
+ * @brief Benchmarks of http_client_request against a loopback HTTP server.
+ *
+ * A server thread on 127.0.0.1 answers every request with the number in its
+ * path and counts the connections it accepts, one operation is one request.
+ * http_keepalive reuses the pooled connection, http_close runs against a
+ * server that closes every connection after its response, the cost of a
+ * request without the pool.
+ *
+ * Before it is measured, http_keepalive checks the pool connects once per
+ * host, and then, against a server that drops connections behind its back,
+ * that every request still succeeds with exactly one new connection per
+ * dropped one: a connection closed while parked is found by the health check,
+ * a request the server dropped unanswered is retried once. A link change and,
+ * when it is short enough, the idle timeout must close the parked connection.
+ *
+ * The atop cases send an activation sized ATOP request and read an encrypted
+ * response, atop_codec_request with a stack arena and cursors against
+ * atop_base_request and its cJSON tree, whose peak heap is the one the
+ * activation used to need. During setup the server decrypts every request
+ * body and checks the URL signature.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "tuya_cloud_types.h"
+#include "tal_log.h"
+#include "tal_event.h"
+#include "tal_system.h"
+#include "tal_sw_timer.h"
+#include "tal_time_service.h"
+#include "http_client_interface.h"
+#include "http_client_pool.h"
+#include "mbedtls/gcm.h"
+#include "mbedtls/md5.h"
+#include "mbedtls/base64.h"
+#include "tuya_endpoint.h"
+#include "atop_codec.h"
+#if BENCH_WITH_TAL
+#include "atop_base.h"
+#endif
+#include "bench.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define BENCH_HTTP_HOST      "127.0.0.1"
+#define BENCH_HTTP_CONN_MAX  8
+#define BENCH_HTTP_REQ_MAX   2048
+#define BENCH_HTTP_RESP_MAX  1024
+#define BENCH_HTTP_STRESS    1000
+#define BENCH_HTTP_POLL_MS   5
+#define BENCH_HTTP_LOST_MS   1000 // a connection not closed by then is leaked
+#define BENCH_HTTP_TIMEOUT   1000
+
+// while flaky, the server closes a connection after every BENCH_HTTP_FLAKY_CLOSE-th
+// response and drops every BENCH_HTTP_FLAKY_DROP-th request unanswered, but
+// never the first one of a connection: that may be the retry of a dropped one
+#define BENCH_HTTP_FLAKY_CLOSE 41
+#define BENCH_HTTP_FLAKY_DROP  97
+
+#define BENCH_ATOP_KEY    "0123456789abcdef"
+#define BENCH_ATOP_T      1735689600
+#define BENCH_ATOP_SCHEMA "000004abcd"
+#define BENCH_ATOP_VERIFY 16
+// the payload of an activation
+#define BENCH_ATOP_DATA                                                                                                \
+    "{\"token\":\"AYabcdef123456\",\"softVer\":\"1.0.0\",\"productKey\":\"keyabcdefgh12345\",\"protocolVer\":"       \
+    "\"2.2\",\"baselineVer\":\"40.00\",\"cadVer\":\"1.0.3\",\"cdVer\":\"1.0.0\",\"options\":\"{\\\"isFK\\\":false}\","  \
+    "\"t\":1735689600}"
+#define BENCH_ATOP_RESULT                                                                                              \
+    "{\"success\":true,\"t\":1735689600,\"result\":{\"schemaId\":\"" BENCH_ATOP_SCHEMA "\",\"devId\":"                 \
+    "\"6c1234567890abcdefgh\",\"secKey\":\"0123456789abcdef\",\"localKey\":\"fedcba9876543210\",\"stdTimeZone\":"     \
+    "\"+08:00\",\"timeZone\":\"+08:00\",\"resetFactory\":false,\"capability\":1025}}"
+
+typedef enum {
+    BENCH_HTTP_KEEP,
+    BENCH_HTTP_CLOSE,
+    BENCH_HTTP_FLAKY,
+    BENCH_HTTP_LAST, // closes the connection after the next response without a word
+    BENCH_HTTP_ATOP, // answers sg_atop_body, like KEEP otherwise
+} BENCH_HTTP_MODE_E;
+
+typedef struct {
+    int fd;
+    uint32_t served; // responses sent on the connection
+    uint32_t len;
+    char buf[BENCH_HTTP_REQ_MAX];
+} BENCH_HTTP_CONN_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static int sg_listen_fd = -1;
+static uint16_t sg_port;
+static pthread_t sg_server;
+static uint32_t sg_stop;
+static uint32_t sg_mode;
+static BENCH_HTTP_CONN_T sg_conn[BENCH_HTTP_CONN_MAX];
+// counted by the server
+static uint32_t sg_accepts;
+static uint32_t sg_requests;
+static uint32_t sg_server_closes; // connections the server closed
+static uint32_t sg_client_closes; // connections the client closed
+static uint32_t sg_seq;
+static char sg_atop_body[BENCH_HTTP_RESP_MAX / 2];
+static uint32_t sg_atop_verify; // the server checks the ATOP requests
+static uint32_t sg_atop_bad;    // and found a bad one
+static tuya_endpoint_t sg_endpoint;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static void __conn_close(BENCH_HTTP_CONN_T *conn, uint32_t *counter)
+{
+    close(conn->fd);
+    conn->fd = -1;
+    __atomic_add_fetch(counter, 1, __ATOMIC_RELEASE);
+}
+
+static int __hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+
+    return -1;
+}
+
+// the query "a=..&..&sign=<md5>" of the path, signed as "a=..||..||<key>"
+static bool __atop_sign_check(const char *query, const char *query_end)
+{
+    mbedtls_md5_context md5;
+    uint8_t digest[16];
+    char sign[33];
+    const char *param = query, *amp = NULL;
+    uint32_t i;
+
+    mbedtls_md5_init(&md5);
+    mbedtls_md5_starts(&md5);
+    while (param < query_end && 0 != strncmp(param, "sign=", 5)) {
+        amp = memchr(param, '&', query_end - param);
+        if (NULL == amp) {
+            mbedtls_md5_free(&md5);
+            return false;
+        }
+        mbedtls_md5_update(&md5, (const uint8_t *)param, amp - param);
+        mbedtls_md5_update(&md5, (const uint8_t *)"||", 2);
+        param = amp + 1;
+    }
+    mbedtls_md5_update(&md5, (const uint8_t *)BENCH_ATOP_KEY, strlen(BENCH_ATOP_KEY));
+    mbedtls_md5_finish(&md5, digest);
+    mbedtls_md5_free(&md5);
+
+    for (i = 0; i < sizeof(digest); i++) {
+        snprintf(sign + i * 2, 3, "%02x", digest[i]);
+    }
+
+    return query_end - param == 5 + 32 && 0 == memcmp(param + 5, sign, 32);
+}
+
+// the body "data=<hex of nonce, ciphertext and tag>" must decrypt to BENCH_ATOP_DATA
+static bool __atop_body_check(const char *body, uint32_t len)
+{
+    uint8_t raw[BENCH_HTTP_REQ_MAX / 2], plain[BENCH_HTTP_REQ_MAX / 2];
+    mbedtls_gcm_context gcm;
+    uint32_t raw_len = (len - 5) / 2, i;
+    int hi, lo, ret;
+
+    if (len < 5 || 0 != memcmp(body, "data=", 5) || 0 != (len - 5) % 2 || raw_len <= 28 || raw_len > sizeof(raw)) {
+        return false;
+    }
+    for (i = 0; i < raw_len; i++) {
+        hi = __hex_value(body[5 + i * 2]);
+        lo = __hex_value(body[5 + i * 2 + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        raw[i] = (uint8_t)(hi << 4 | lo);
+    }
+
+    mbedtls_gcm_init(&gcm);
+    ret = mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, (const uint8_t *)BENCH_ATOP_KEY, 128);
+    if (0 == ret) {
+        ret = mbedtls_gcm_auth_decrypt(&gcm, raw_len - 28, raw, 12, NULL, 0, raw + raw_len - 16, 16, raw + 12, plain);
+    }
+    mbedtls_gcm_free(&gcm);
+
+    return 0 == ret && raw_len - 28 == strlen(BENCH_ATOP_DATA) && 0 == memcmp(plain, BENCH_ATOP_DATA, raw_len - 28);
+}
+
+static bool __atop_request_check(const char *req, uint32_t header_len, uint32_t req_len)
+{
+    const char *query = strchr(req, '?');
+    const char *query_end = strchr(req, ' ');
+
+    query_end = query_end ? strchr(query_end + 1, ' ') : NULL;
+    if (NULL == query || NULL == query_end || query > query_end) {
+        return false;
+    }
+
+    return __atop_sign_check(query + 1, query_end) && __atop_body_check(req + header_len, req_len - header_len);
+}
+
+// answers the complete requests in the buffer of a connection
+static void __conn_serve(BENCH_HTTP_CONN_T *conn)
+{
+    char resp[BENCH_HTTP_RESP_MAX], num_body[12], *end = NULL, *length = NULL;
+    const char *body = num_body;
+    uint32_t header_len, req_len, num;
+    BENCH_HTTP_MODE_E mode = __atomic_load_n(&sg_mode, __ATOMIC_RELAXED);
+    int len;
+
+    while (conn->fd >= 0 && NULL != (end = strstr(conn->buf, "\r\n\r\n"))) {
+        header_len = end + 4 - conn->buf;
+        req_len = header_len;
+        // a POST is complete with its body
+        length = strstr(conn->buf, "Content-Length:");
+        if (length && length < end) {
+            req_len += strtoul(length + strlen("Content-Length:"), NULL, 10);
+        }
+        if (req_len > conn->len) {
+            return;
+        }
+
+        num = __atomic_add_fetch(&sg_requests, 1, __ATOMIC_RELAXED);
+        if (BENCH_HTTP_FLAKY == mode && 0 == num % BENCH_HTTP_FLAKY_DROP && conn->served) {
+            __conn_close(conn, &sg_server_closes);
+            return;
+        }
+
+        if (BENCH_HTTP_ATOP == mode) {
+            body = sg_atop_body;
+            if (__atomic_load_n(&sg_atop_verify, __ATOMIC_RELAXED) &&
+                !__atop_request_check(conn->buf, header_len, req_len)) {
+                fprintf(stderr, "http: bad ATOP request %.*s\n", (int)req_len, conn->buf);
+                __atomic_store_n(&sg_atop_bad, 1, __ATOMIC_RELAXED);
+            }
+        } else {
+            // the body is the number of the path, "GET /n/<number> HTTP/1.1"
+            snprintf(num_body, sizeof(num_body), "%lu", strtoul(conn->buf + strlen("GET /n/"), NULL, 10));
+        }
+        len = snprintf(resp, sizeof(resp), "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n%s\r\n%s",
+                       (uint32_t)strlen(body), BENCH_HTTP_CLOSE == mode ? "Connection: close\r\n" : "", body);
+        if (len != send(conn->fd, resp, len, MSG_NOSIGNAL) || BENCH_HTTP_CLOSE == mode || BENCH_HTTP_LAST == mode ||
+            (BENCH_HTTP_FLAKY == mode && 0 == num % BENCH_HTTP_FLAKY_CLOSE)) {
+            __conn_close(conn, &sg_server_closes);
+            return;
+        }
+
+        conn->served++;
+        conn->len -= req_len;
+        memmove(conn->buf, conn->buf + req_len, conn->len + 1);
+    }
+}
+
+static void *__server_task(void *arg)
+{
+    struct pollfd pfd[BENCH_HTTP_CONN_MAX + 1];
+    BENCH_HTTP_CONN_T *conn = NULL;
+    uint32_t i;
+    int fd, ret;
+
+    while (!__atomic_load_n(&sg_stop, __ATOMIC_RELAXED)) {
+        pfd[0].fd = sg_listen_fd;
+        pfd[0].events = POLLIN;
+        for (i = 0; i < BENCH_HTTP_CONN_MAX; i++) {
+            pfd[i + 1].fd = sg_conn[i].fd;
+            pfd[i + 1].events = POLLIN;
+        }
+        if (poll(pfd, BENCH_HTTP_CONN_MAX + 1, BENCH_HTTP_POLL_MS) <= 0) {
+            continue;
+        }
+
+        if (pfd[0].revents & POLLIN) {
+            fd = accept(sg_listen_fd, NULL, NULL);
+            for (i = 0; fd >= 0 && i < BENCH_HTTP_CONN_MAX && sg_conn[i].fd >= 0; i++) {
+            }
+            if (i < BENCH_HTTP_CONN_MAX) {
+                sg_conn[i].fd = fd;
+                sg_conn[i].served = 0;
+                sg_conn[i].len = 0;
+                __atomic_add_fetch(&sg_accepts, 1, __ATOMIC_RELEASE);
+            } else if (fd >= 0) {
+                fprintf(stderr, "http: more than %d connections\n", BENCH_HTTP_CONN_MAX);
+                close(fd);
+            }
+        }
+
+        for (i = 0; i < BENCH_HTTP_CONN_MAX; i++) {
+            conn = &sg_conn[i];
+            if (conn->fd < 0 || pfd[i + 1].fd != conn->fd || !(pfd[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+
+            ret = recv(conn->fd, conn->buf + conn->len, BENCH_HTTP_REQ_MAX - 1 - conn->len, 0);
+            if (ret <= 0) {
+                __conn_close(conn, &sg_client_closes);
+                continue;
+            }
+            conn->len += ret;
+            conn->buf[conn->len] = '\0';
+            __conn_serve(conn);
+        }
+    }
+
+    return NULL;
+}
+
+static OPERATE_RET __server_start(BENCH_HTTP_MODE_E mode)
+{
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = 0};
+    socklen_t addr_len = sizeof(addr);
+    uint32_t i;
+
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sg_listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sg_listen_fd < 0 || bind(sg_listen_fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+        listen(sg_listen_fd, BENCH_HTTP_CONN_MAX) || getsockname(sg_listen_fd, (struct sockaddr *)&addr, &addr_len)) {
+        perror("http: listen");
+        if (sg_listen_fd >= 0) {
+            close(sg_listen_fd);
+        }
+        return OPRT_COM_ERROR;
+    }
+    sg_port = ntohs(addr.sin_port);
+
+    for (i = 0; i < BENCH_HTTP_CONN_MAX; i++) {
+        sg_conn[i].fd = -1;
+    }
+    sg_stop = 0;
+    sg_mode = mode;
+    sg_accepts = 0;
+    sg_requests = 0;
+    sg_server_closes = 0;
+    sg_client_closes = 0;
+    sg_seq = 0;
+    if (0 != pthread_create(&sg_server, NULL, __server_task, NULL)) {
+        close(sg_listen_fd);
+        return OPRT_COM_ERROR;
+    }
+
+    return OPRT_OK;
+}
+
+static void __server_stop(void)
+{
+    uint32_t i;
+
+    // the pool must not keep a connection to a server that is gone
+    http_client_pool_flush();
+    atop_codec_key_release();
+
+    __atomic_store_n(&sg_stop, 1, __ATOMIC_RELAXED);
+    pthread_join(sg_server, NULL);
+    for (i = 0; i < BENCH_HTTP_CONN_MAX; i++) {
+        if (sg_conn[i].fd >= 0) {
+            close(sg_conn[i].fd);
+        }
+    }
+    close(sg_listen_fd);
+    sg_listen_fd = -1;
+}
+
+static OPERATE_RET __request_run(uint32_t i)
+{
+    http_client_response_t response = {0};
+    http_client_status_t rt = HTTP_CLIENT_SUCCESS;
+    char path[24], body[12];
+    bool ok;
+
+    sg_seq++;
+    snprintf(path, sizeof(path), "/n/%u", sg_seq);
+    snprintf(body, sizeof(body), "%u", sg_seq);
+
+    http_client_request_t request = {
+        .host = BENCH_HTTP_HOST,
+        .port = sg_port,
+        .path = path,
+        .method = "GET",
+        .timeout_ms = BENCH_HTTP_TIMEOUT,
+    };
+    rt = http_client_request(&request, &response);
+    if (HTTP_CLIENT_SUCCESS != rt) {
+        fprintf(stderr, "http: request %u failed %d\n", sg_seq, rt);
+        return OPRT_COM_ERROR;
+    }
+
+    ok = 200 == response.status_code && strlen(body) == response.body_length &&
+         0 == memcmp(body, response.body, response.body_length);
+    if (!ok) {
+        fprintf(stderr, "http: request %u got status %u body %.*s\n", sg_seq, response.status_code,
+                (int)response.body_length, response.body);
+    }
+    http_client_free(&response);
+
+    return ok ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+static OPERATE_RET __stress(uint32_t num)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t i;
+
+    for (i = 0; i < num; i++) {
+        TUYA_CALL_ERR_RETURN(__request_run(i));
+    }
+
+    return OPRT_OK;
+}
+
+// waits for the client to close as many connections in all
+static OPERATE_RET __client_closes_wait(uint32_t num, uint32_t wait_ms)
+{
+    SYS_TIME_T start = tal_system_get_millisecond();
+
+    while (__atomic_load_n(&sg_client_closes, __ATOMIC_ACQUIRE) < num) {
+        if (tal_system_get_millisecond() - start > wait_ms) {
+            fprintf(stderr, "http: client closed %u of %u connections\n",
+                    __atomic_load_n(&sg_client_closes, __ATOMIC_ACQUIRE), num);
+            return OPRT_TIMEOUT;
+        }
+        tal_system_sleep(1);
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __accepts_check(uint32_t expected)
+{
+    uint32_t accepts = __atomic_load_n(&sg_accepts, __ATOMIC_ACQUIRE);
+
+    if (accepts != expected) {
+        fprintf(stderr, "http: %u connections for %u requests, expected %u\n", accepts, sg_seq, expected);
+        return OPRT_COM_ERROR;
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __pool_check(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t closes;
+
+#if defined(ENABLE_HTTP_POOL) && (ENABLE_HTTP_POOL == 1)
+    TUYA_CALL_ERR_RETURN(__stress(BENCH_HTTP_STRESS));
+    TUYA_CALL_ERR_RETURN(__accepts_check(1));
+
+    // every connection the server closes costs one new connection, no request,
+    // the request after the stress pays for a close by its last response
+    __atomic_store_n(&sg_mode, BENCH_HTTP_FLAKY, __ATOMIC_RELAXED);
+    TUYA_CALL_ERR_RETURN(__stress(BENCH_HTTP_STRESS));
+    __atomic_store_n(&sg_mode, BENCH_HTTP_KEEP, __ATOMIC_RELAXED);
+    TUYA_CALL_ERR_RETURN(__request_run(0));
+    closes = __atomic_load_n(&sg_server_closes, __ATOMIC_ACQUIRE);
+    if (closes < BENCH_HTTP_STRESS / BENCH_HTTP_FLAKY_DROP) {
+        fprintf(stderr, "http: the server closed only %u connections\n", closes);
+        return OPRT_COM_ERROR;
+    }
+    TUYA_CALL_ERR_RETURN(__accepts_check(1 + closes));
+
+    // the health check finds a connection closed while it was parked
+    __atomic_store_n(&sg_mode, BENCH_HTTP_LAST, __ATOMIC_RELAXED);
+    TUYA_CALL_ERR_RETURN(__request_run(0));
+    __atomic_store_n(&sg_mode, BENCH_HTTP_KEEP, __ATOMIC_RELAXED);
+    tal_system_sleep(HTTP_POOL_CHECK_IDLE_MS + BENCH_HTTP_POLL_MS);
+    TUYA_CALL_ERR_RETURN(__request_run(0));
+    TUYA_CALL_ERR_RETURN(__accepts_check(2 + closes));
+
+    // a link change closes the parked connection
+    tal_event_publish(EVENT_LINK_STATUS_CHG, NULL);
+    TUYA_CALL_ERR_RETURN(__client_closes_wait(1, BENCH_HTTP_LOST_MS));
+    TUYA_CALL_ERR_RETURN(__request_run(0));
+    TUYA_CALL_ERR_RETURN(__accepts_check(3 + closes));
+
+#if HTTP_POOL_IDLE_TIMEOUT_MS <= 1000
+    TUYA_CALL_ERR_RETURN(__client_closes_wait(2, HTTP_POOL_IDLE_TIMEOUT_MS + BENCH_HTTP_LOST_MS));
+#endif
+#else
+    TUYA_CALL_ERR_RETURN(__stress(BENCH_HTTP_STRESS));
+    TUYA_CALL_ERR_RETURN(__accepts_check(BENCH_HTTP_STRESS));
+#endif
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __keepalive_setup(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    TUYA_CALL_ERR_RETURN(__server_start(BENCH_HTTP_KEEP));
+    rt = __pool_check();
+    if (OPRT_OK != rt) {
+        __server_stop();
+    }
+
+    return rt;
+}
+
+static OPERATE_RET __close_setup(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    TUYA_CALL_ERR_RETURN(__server_start(BENCH_HTTP_CLOSE));
+    rt = __stress(BENCH_HTTP_STRESS);
+    if (OPRT_OK == rt) {
+        rt = __accepts_check(BENCH_HTTP_STRESS);
+    }
+    if (OPRT_OK != rt) {
+        __server_stop();
+    }
+
+    return rt;
+}
+
+// the host has no endpoint service, the ATOP requests go to the loopback server
+const tuya_endpoint_t *tuya_endpoint_get(void)
+{
+    return &sg_endpoint;
+}
+
+static char sg_atop_data[] = BENCH_ATOP_DATA;
+static const atop_base_request_t sg_atop_request = {
+    .key = BENCH_ATOP_KEY,
+    .path = "/d.json",
+    .timestamp = BENCH_ATOP_T,
+    .api = "tuya.device.active",
+    .version = "4.4",
+    .uuid = "uuid0123456789ab",
+    .data = sg_atop_data,
+    .datalen = sizeof(sg_atop_data) - 1,
+};
+
+// the response of the cloud to an activation, with '/' escaped as a JSON encoder may do
+static OPERATE_RET __atop_body_build(void)
+{
+    uint8_t raw[ATOP_CODEC_NONCE_LEN + sizeof(BENCH_ATOP_RESULT) - 1 + ATOP_CODEC_TAG_LEN];
+    unsigned char b64[sizeof(sg_atop_body)];
+    char escaped[sizeof(sg_atop_body)];
+    size_t plain_len = strlen(BENCH_ATOP_RESULT), b64_len = 0, i, j;
+    mbedtls_gcm_context gcm;
+    int ret;
+
+    memset(raw, '7', ATOP_CODEC_NONCE_LEN);
+    mbedtls_gcm_init(&gcm);
+    ret = mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, (const uint8_t *)BENCH_ATOP_KEY, 128);
+    if (0 == ret) {
+        ret = mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, plain_len, raw, ATOP_CODEC_NONCE_LEN, NULL, 0,
+                                        (const uint8_t *)BENCH_ATOP_RESULT, raw + ATOP_CODEC_NONCE_LEN,
+                                        ATOP_CODEC_TAG_LEN, raw + ATOP_CODEC_NONCE_LEN + plain_len);
+    }
+    mbedtls_gcm_free(&gcm);
+    if (0 != ret || 0 != mbedtls_base64_encode(b64, sizeof(b64), &b64_len, raw, sizeof(raw))) {
+        return OPRT_COM_ERROR;
+    }
+
+    for (i = 0, j = 0; i < b64_len && j + 2 < sizeof(escaped); i++) {
+        if ('/' == b64[i]) {
+            escaped[j++] = '\\';
+        }
+        escaped[j++] = b64[i];
+    }
+    escaped[j] = '\0';
+    if (i < b64_len || snprintf(sg_atop_body, sizeof(sg_atop_body),
+                                "{\"result\":\"%s\",\"t\":%d,\"sign\":\"0123456789abcdef0123456789abcdef\"}",
+                                escaped, BENCH_ATOP_T) >= (int)sizeof(sg_atop_body)) {
+        return OPRT_BUFFER_NOT_ENOUGH;
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __atop_codec_run(uint32_t i)
+{
+    uint8_t arena[ATOP_CODEC_ARENA_SIZE(sizeof(sg_atop_data) - 1)];
+    atop_codec_response_t response;
+    json_cursor_t schema;
+    int rt;
+    bool ok;
+
+    rt = atop_codec_request(&sg_atop_request, arena, sizeof(arena), &response);
+    ok = OPRT_OK == rt && response.success && BENCH_ATOP_T == response.t &&
+         0 == json_cursor_get(&response.result, "schemaId", &schema) &&
+         json_cursor_string_equal(&schema, BENCH_ATOP_SCHEMA, false);
+    atop_codec_response_free(&response);
+    if (!ok) {
+        fprintf(stderr, "atop: request %u failed %d\n", i, rt);
+    }
+
+    return ok ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+#if BENCH_WITH_TAL
+static OPERATE_RET __atop_base_run(uint32_t i)
+{
+    atop_base_response_t response = {0};
+    cJSON *schema = NULL;
+    int rt;
+    bool ok;
+
+    rt = atop_base_request(&sg_atop_request, &response);
+    ok = OPRT_OK == rt && response.success && BENCH_ATOP_T == response.t &&
+         NULL != (schema = cJSON_GetObjectItem(response.result, "schemaId")) &&
+         0 == strcmp(schema->valuestring, BENCH_ATOP_SCHEMA);
+    atop_base_response_free(&response);
+    if (!ok) {
+        fprintf(stderr, "atop: request %u failed %d\n", i, rt);
+    }
+
+    return ok ? OPRT_OK : OPRT_COM_ERROR;
+}
+#endif
+
+// the first requests are checked by the server
+static OPERATE_RET __atop_setup(OPERATE_RET (*run)(uint32_t i))
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t i;
+
+    TUYA_CALL_ERR_RETURN(__atop_body_build());
+    TUYA_CALL_ERR_RETURN(__server_start(BENCH_HTTP_ATOP));
+    strcpy(sg_endpoint.atop.host, BENCH_HTTP_HOST);
+    sg_endpoint.atop.port = sg_port;
+
+    sg_atop_bad = 0;
+    __atomic_store_n(&sg_atop_verify, 1, __ATOMIC_RELAXED);
+    for (i = 0; i < BENCH_ATOP_VERIFY && OPRT_OK == rt; i++) {
+        rt = run(i);
+    }
+    __atomic_store_n(&sg_atop_verify, 0, __ATOMIC_RELAXED);
+    if (OPRT_OK == rt && __atomic_load_n(&sg_atop_bad, __ATOMIC_RELAXED)) {
+        rt = OPRT_COM_ERROR;
+    }
+    if (OPRT_OK != rt) {
+        __server_stop();
+    }
+
+    return rt;
+}
+
+static OPERATE_RET __atop_codec_setup(void)
+{
+    return __atop_setup(__atop_codec_run);
+}
+
+#if BENCH_WITH_TAL
+static OPERATE_RET __atop_base_setup(void)
+{
+    return __atop_setup(__atop_base_run);
+}
+#endif
+
+static const BENCH_CASE_T sg_http_cases[] = {
+    {"http_keepalive", 2000, 0, __keepalive_setup, __request_run, __server_stop},
+    {"http_close", 2000, 0, __close_setup, __request_run, __server_stop},
+    {"atop_codec_request", 1000, 0, __atop_codec_setup, __atop_codec_run, __server_stop},
+#if BENCH_WITH_TAL
+    {"atop_base_request", 1000, 0, __atop_base_setup, __atop_base_run, __server_stop},
+#endif
+};
+
+const BENCH_CASE_T *bench_http_cases_get(uint32_t *num)
+{
+    static bool inited = false;
+    http_client_pool_key_t key = {.host = BENCH_HTTP_HOST};
+
+    // the services a device starts at boot, and the lazy allocations of the
+    // pool, are made once here rather than counted as a leak of the first case
+    if (!inited) {
+        inited = true;
+        tal_time_service_init();
+        tal_sw_timer_init();
+        http_client_pool_checkin(&key, tuya_transporter_create(TRANSPORT_TYPE_TCP, NULL), TRUE);
+        http_client_pool_flush();
+    }
+
+    *num = CNTSOF(sg_http_cases);
+
+    return sg_http_cases;
+}
@@ -0,0 +1,198 @@
+/**
+ * @file bench_cases_mbox.c
+ * @brief Benchmarks of the lwIP sys_arch mailboxes: the OS queue one and the
+ * lock-free one of LWIP_TUYA_LF_MBOX.
+ *
+ * Producer threads post messages, one operation is the consumer fetching one
+ * of them. A message not fetched within a second fails the case. The order
+ * and the loss of messages are checked by the UT of src/liblwip/ut.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <pthread.h>
+
+#include "tuya_cloud_types.h"
+#include "tal_log.h"
+#include "tal_queue.h"
+#include "lwip/arch/sys_mbox_lf.h"
+#include "bench.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define BENCH_MBOX_SIZE         16 // a tcpip mailbox of a few messages rounds up to this
+#define BENCH_MBOX_PRODUCERS    4
+#define BENCH_MBOX_WAIT_FOREVER 0xFFFFFFFF
+#define BENCH_MBOX_LOST_MS      1000 // a message not fetched by then is lost
+
+// the two mailboxes the way sys_arch.c drives them
+typedef struct {
+    OPERATE_RET (*create)(void **mbox, uint32_t size);
+    OPERATE_RET (*post)(void *mbox, void *msg);
+    OPERATE_RET (*fetch)(void *mbox, void **msg, uint32_t timeout);
+    void (*free)(void *mbox);
+} BENCH_MBOX_OPS_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static const BENCH_MBOX_OPS_T *sg_ops;
+static void *sg_mbox;
+static pthread_t sg_producer[BENCH_MBOX_PRODUCERS];
+static uint32_t sg_producer_num;
+static uint32_t sg_stop;
+static uint32_t sg_exited;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static OPERATE_RET __queue_create(void **mbox, uint32_t size)
+{
+    return tal_queue_create_init((QUEUE_HANDLE *)mbox, sizeof(void *), size);
+}
+
+static OPERATE_RET __queue_post(void *mbox, void *msg)
+{
+    // a queue that woke a blocked post for a slot another producer took fails it
+    while (OPRT_OK != tal_queue_post(mbox, &msg, BENCH_MBOX_WAIT_FOREVER)) {
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __queue_fetch(void *mbox, void **msg, uint32_t timeout)
+{
+    return tal_queue_fetch(mbox, msg, timeout);
+}
+
+static void __queue_free(void *mbox)
+{
+    tal_queue_free(mbox);
+}
+
+static const BENCH_MBOX_OPS_T sg_queue_ops = {__queue_create, __queue_post, __queue_fetch, __queue_free};
+
+static OPERATE_RET __lf_create(void **mbox, uint32_t size)
+{
+    return sys_mbox_lf_create((SYS_MBOX_LF_HANDLE *)mbox, size);
+}
+
+static OPERATE_RET __lf_post(void *mbox, void *msg)
+{
+    return sys_mbox_lf_post(mbox, msg);
+}
+
+static OPERATE_RET __lf_fetch(void *mbox, void **msg, uint32_t timeout)
+{
+    return sys_mbox_lf_fetch(mbox, msg, timeout);
+}
+
+static void __lf_free(void *mbox)
+{
+    sys_mbox_lf_free(mbox);
+}
+
+static const BENCH_MBOX_OPS_T sg_lf_ops = {__lf_create, __lf_post, __lf_fetch, __lf_free};
+
+static void *__producer_task(void *arg)
+{
+    uint32_t seq;
+
+    for (seq = 0; !__atomic_load_n(&sg_stop, __ATOMIC_RELAXED); seq++) {
+        if (OPRT_OK != sg_ops->post(sg_mbox, (void *)(uintptr_t)seq)) {
+            break;
+        }
+    }
+    __atomic_add_fetch(&sg_exited, 1, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+static OPERATE_RET __producers_start(const BENCH_MBOX_OPS_T *ops, uint32_t size, uint32_t num)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t i;
+
+    TUYA_CALL_ERR_RETURN(ops->create(&sg_mbox, size));
+    sg_ops = ops;
+    sg_producer_num = num;
+    sg_stop = 0;
+    sg_exited = 0;
+
+    for (i = 0; i < num; i++) {
+        if (0 != pthread_create(&sg_producer[i], NULL, __producer_task, (void *)(uintptr_t)i)) {
+            sg_producer_num = i;
+            return OPRT_COM_ERROR;
+        }
+    }
+
+    return OPRT_OK;
+}
+
+static void __producers_stop(void)
+{
+    void *msg = NULL;
+    uint32_t i;
+
+    // producers blocked on a full mailbox leave once it drains
+    __atomic_store_n(&sg_stop, 1, __ATOMIC_RELAXED);
+    while (__atomic_load_n(&sg_exited, __ATOMIC_ACQUIRE) < sg_producer_num) {
+        sg_ops->fetch(sg_mbox, &msg, 1);
+    }
+    for (i = 0; i < sg_producer_num; i++) {
+        pthread_join(sg_producer[i], NULL);
+    }
+    while (OPRT_OK == sg_ops->fetch(sg_mbox, &msg, 0)) {
+    }
+
+    sg_ops->free(sg_mbox);
+    sg_mbox = NULL;
+}
+
+static OPERATE_RET __mbox_setup(const BENCH_MBOX_OPS_T *ops, uint32_t producers)
+{
+    return __producers_start(ops, BENCH_MBOX_SIZE, producers);
+}
+
+static OPERATE_RET __queue_1p_setup(void)
+{
+    return __mbox_setup(&sg_queue_ops, 1);
+}
+
+static OPERATE_RET __queue_4p_setup(void)
+{
+    return __mbox_setup(&sg_queue_ops, 4);
+}
+
+static OPERATE_RET __lf_1p_setup(void)
+{
+    return __mbox_setup(&sg_lf_ops, 1);
+}
+
+static OPERATE_RET __lf_4p_setup(void)
+{
+    return __mbox_setup(&sg_lf_ops, 4);
+}
+
+static OPERATE_RET __mbox_run(uint32_t i)
+{
+    void *msg = NULL;
+
+    return sg_ops->fetch(sg_mbox, &msg, BENCH_MBOX_LOST_MS);
+}
+
+static const BENCH_CASE_T sg_mbox_cases[] = {
+    {"mbox_queue_1p", 100000, 0, __queue_1p_setup, __mbox_run, __producers_stop},
+    {"mbox_lf_1p", 100000, 0, __lf_1p_setup, __mbox_run, __producers_stop},
+    {"mbox_queue_4p", 100000, 0, __queue_4p_setup, __mbox_run, __producers_stop},
+    {"mbox_lf_4p", 100000, 0, __lf_4p_setup, __mbox_run, __producers_stop},
+};
+
+const BENCH_CASE_T *bench_mbox_cases_get(uint32_t *num)
+{
+    *num = CNTSOF(sg_mbox_cases);
+
+    return sg_mbox_cases;
+}
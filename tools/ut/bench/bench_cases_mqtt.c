@@ -0,0 +1,348 @@
+/**
+ * @file bench_cases_mqtt.c
+ * @brief Benchmarks of the dispatch of incoming MQTT publishes to the
+ * subscribe handlers of mqtt_service.
+ *
+ * The subscriptions are those of a gateway with BENCH_MQTT_SUBDEVS sub-devices,
+ * each with its command, RPC response and RPC file topics, plus a few wildcard
+ * filters. One operation dispatches one publish to the topic of a sub-device,
+ * whose name is read out of a packet buffer the way the MQTT client hands it
+ * over, not NUL terminated. mqtt_route_list is the previous dispatch, a topic
+ * copy and a walk of the subscribe list, kept here for comparison.
+ *
+ * The setup checks the matching rules of the router first: wildcards, '$'
+ * topics, several handlers per filter and the release of pruned nodes.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tuya_cloud_types.h"
+#include "tal_log.h"
+#include "tal_memory.h"
+#include "mqtt_topic_router.h"
+#include "bench_port.h"
+#include "bench.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define BENCH_MQTT_SUBDEVS   256
+#define BENCH_MQTT_TOPIC_MAX 48
+#define BENCH_MQTT_PKT_SIZE  (BENCH_MQTT_SUBDEVS * BENCH_MQTT_TOPIC_MAX)
+
+typedef struct bench_mqtt_sub {
+    struct bench_mqtt_sub *next;
+    char *topic;
+    size_t topic_length;
+    mqtt_topic_handler_cb_t cb;
+    void *userdata;
+} BENCH_MQTT_SUB_T;
+
+typedef struct {
+    const char *filter;
+    const char *topic;
+    bool match;
+} BENCH_MQTT_RULE_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static mqtt_topic_router_t sg_router;
+static BENCH_MQTT_SUB_T *sg_list;
+// the topics of the publishes, back to back like in received packets
+static char sg_pkt[BENCH_MQTT_PKT_SIZE];
+static uint16_t sg_topic_off[BENCH_MQTT_SUBDEVS];
+static uint16_t sg_topic_len[BENCH_MQTT_SUBDEVS];
+static uint32_t sg_hits[BENCH_MQTT_SUBDEVS + 1];
+
+static const BENCH_MQTT_RULE_T sg_rules[] = {
+    {"a/b/c", "a/b/c", true},
+    {"a/b/c", "a/b", false},
+    {"a/b/c", "a/b/c/d", false},
+    {"a/+/c", "a/x/c", true},
+    {"a/+/c", "a/x/y/c", false},
+    {"a/+", "a/", true},
+    {"a/+", "a", false},
+    {"+/+", "/x", true},
+    {"a//b", "a//b", true},
+    {"a/#", "a", true},
+    {"a/#", "a/x/y", true},
+    {"a/#", "ab", false},
+    {"#", "x/y", true},
+    {"#", "$SYS/x", false},
+    {"+/x", "$SYS/x", false},
+    {"$SYS/#", "$SYS/x", true},
+    {"$SYS/+", "$SYS/x", true},
+};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static void __hit_cb(uint16_t msgid, const mqtt_client_message_t *msg, void *userdata)
+{
+    sg_hits[(uintptr_t)userdata]++;
+}
+
+static void __other_cb(uint16_t msgid, const mqtt_client_message_t *msg, void *userdata)
+{
+    sg_hits[BENCH_MQTT_SUBDEVS]++;
+}
+
+static uint32_t __route(const char *topic, uint32_t *hits)
+{
+    mqtt_client_message_t msg = {.topic = topic, .topic_length = strlen(topic)};
+    uint32_t called;
+
+    memset(sg_hits, 0, sizeof(sg_hits));
+    called = mqtt_topic_router_dispatch(&sg_router, 1, &msg);
+    *hits = sg_hits[0] + sg_hits[BENCH_MQTT_SUBDEVS];
+
+    return called;
+}
+
+static OPERATE_RET __router_check(void)
+{
+    static const char *bad[] = {"", "a/#/b", "a+", "a/b#", "#/"};
+    BENCH_HEAP_STAT_T before, after;
+    uint32_t i, called, hits;
+
+    bench_heap_stat_get(&before);
+    mqtt_topic_router_init(&sg_router);
+
+    for (i = 0; i < CNTSOF(bad); i++) {
+        if (OPRT_INVALID_PARM != mqtt_topic_router_add(&sg_router, bad[i], strlen(bad[i]), __hit_cb, NULL)) {
+            fprintf(stderr, "mqtt: filter '%s' accepted\n", bad[i]);
+            return OPRT_COM_ERROR;
+        }
+    }
+
+    for (i = 0; i < CNTSOF(sg_rules); i++) {
+        mqtt_topic_router_add(&sg_router, sg_rules[i].filter, strlen(sg_rules[i].filter), __hit_cb, NULL);
+        called = __route(sg_rules[i].topic, &hits);
+        mqtt_topic_router_remove(&sg_router, sg_rules[i].filter, strlen(sg_rules[i].filter), NULL);
+        if (called != (sg_rules[i].match ? 1 : 0) || hits != called) {
+            fprintf(stderr, "mqtt: '%s' on '%s' called %u handlers\n", sg_rules[i].filter, sg_rules[i].topic, called);
+            return OPRT_COM_ERROR;
+        }
+    }
+
+    // handlers of overlapping filters all run, a duplicate is added once
+    mqtt_topic_router_add(&sg_router, "s/d/1", 5, __hit_cb, NULL);
+    mqtt_topic_router_add(&sg_router, "s/d/1", 5, __hit_cb, NULL);
+    mqtt_topic_router_add(&sg_router, "s/d/1", 5, __other_cb, NULL);
+    mqtt_topic_router_add(&sg_router, "s/+/1", 5, __hit_cb, NULL);
+    mqtt_topic_router_add(&sg_router, "s/#", 3, __other_cb, NULL);
+    called = __route("s/d/1", &hits);
+    if (4 != called || 2 != sg_hits[0] || 4 != sg_router.handler_num) {
+        fprintf(stderr, "mqtt: overlapping filters called %u handlers\n", called);
+        return OPRT_COM_ERROR;
+    }
+    if (1 != mqtt_topic_router_remove(&sg_router, "s/d/1", 5, __other_cb) || 3 != __route("s/d/1", &hits) ||
+        1 != mqtt_topic_router_remove(&sg_router, "s/d/1", 5, NULL) || 2 != __route("s/d/1", &hits) ||
+        0 != mqtt_topic_router_remove(&sg_router, "s/d", 3, NULL)) {
+        fprintf(stderr, "mqtt: remove of one handler failed\n");
+        return OPRT_COM_ERROR;
+    }
+    mqtt_topic_router_remove(&sg_router, "s/+/1", 5, NULL);
+    mqtt_topic_router_remove(&sg_router, "s/#", 3, NULL);
+
+    // the trie is gone with its last filter
+    bench_heap_stat_get(&after);
+    if (0 != sg_router.handler_num || NULL != sg_router.root || after.cur_bytes != before.cur_bytes) {
+        fprintf(stderr, "mqtt: %zu bytes left in an empty router\n", after.cur_bytes - before.cur_bytes);
+        return OPRT_COM_ERROR;
+    }
+
+    return OPRT_OK;
+}
+
+static void __topics_build(void)
+{
+    uint32_t i, off = 0;
+    int len;
+
+    for (i = 0; i < BENCH_MQTT_SUBDEVS; i++) {
+        // no NUL between the topics
+        len = snprintf(sg_pkt + off, BENCH_MQTT_TOPIC_MAX, "smart/device/in/6c%018x", i * 2654435761u);
+        sg_topic_off[i] = off;
+        sg_topic_len[i] = len;
+        off += len;
+    }
+}
+
+typedef int (*BENCH_MQTT_ADD_FN)(const char *filter, uint32_t idx, mqtt_topic_handler_cb_t cb);
+
+static OPERATE_RET __subscribe_all(BENCH_MQTT_ADD_FN add)
+{
+    static const char *fixed[] = {"smart/device/in/6cgateway000000000", "smart/device/out/+", "$SYS/broker/#"};
+    char filter[BENCH_MQTT_TOPIC_MAX];
+    const char *id = NULL;
+    uint32_t i;
+
+    for (i = 0; i < CNTSOF(fixed); i++) {
+        if (0 != add(fixed[i], BENCH_MQTT_SUBDEVS, __other_cb)) {
+            return OPRT_MALLOC_FAILED;
+        }
+    }
+    for (i = 0; i < BENCH_MQTT_SUBDEVS; i++) {
+        id = sg_pkt + sg_topic_off[i] + strlen("smart/device/in/");
+        snprintf(filter, sizeof(filter), "rpc/rsp/%.20s", id);
+        if (0 != add(filter, i, __other_cb)) {
+            return OPRT_MALLOC_FAILED;
+        }
+        snprintf(filter, sizeof(filter), "rpc/file/%.20s", id);
+        if (0 != add(filter, i, __other_cb)) {
+            return OPRT_MALLOC_FAILED;
+        }
+        snprintf(filter, sizeof(filter), "smart/device/in/%.20s", id);
+        if (0 != add(filter, i, __hit_cb)) {
+            return OPRT_MALLOC_FAILED;
+        }
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __dispatch_check(OPERATE_RET (*run)(uint32_t i))
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t i;
+
+    memset(sg_hits, 0, sizeof(sg_hits));
+    for (i = 0; i < BENCH_MQTT_SUBDEVS; i++) {
+        TUYA_CALL_ERR_RETURN(run(i));
+    }
+    for (i = 0; i < BENCH_MQTT_SUBDEVS; i++) {
+        if (1 != sg_hits[i]) {
+            fprintf(stderr, "mqtt: sub-device %u got %u messages\n", i, sg_hits[i]);
+            return OPRT_COM_ERROR;
+        }
+    }
+
+    return OPRT_OK;
+}
+
+static int __trie_add(const char *filter, uint32_t idx, mqtt_topic_handler_cb_t cb)
+{
+    return mqtt_topic_router_add(&sg_router, filter, strlen(filter), cb, (void *)(uintptr_t)idx);
+}
+
+static OPERATE_RET __trie_run(uint32_t i)
+{
+    uint32_t idx = (i * 7) % BENCH_MQTT_SUBDEVS;
+    mqtt_client_message_t msg = {
+        .topic = sg_pkt + sg_topic_off[idx],
+        .topic_length = sg_topic_len[idx],
+    };
+
+    return (1 == mqtt_topic_router_dispatch(&sg_router, 1, &msg)) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+static OPERATE_RET __trie_setup(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    TUYA_CALL_ERR_RETURN(__router_check());
+    __topics_build();
+    mqtt_topic_router_init(&sg_router);
+    TUYA_CALL_ERR_RETURN(__subscribe_all(__trie_add));
+
+    return __dispatch_check(__trie_run);
+}
+
+static void __trie_teardown(void)
+{
+    mqtt_topic_router_deinit(&sg_router);
+}
+
+// the subscribe list of mqtt_service before the router, newest first
+static int __list_add(const char *filter, uint32_t idx, mqtt_topic_handler_cb_t cb)
+{
+    BENCH_MQTT_SUB_T *sub = tal_calloc(1, sizeof(BENCH_MQTT_SUB_T));
+
+    if (NULL == sub) {
+        return OPRT_MALLOC_FAILED;
+    }
+    sub->topic_length = strlen(filter);
+    sub->topic = tal_calloc(1, sub->topic_length + 1);
+    if (NULL == sub->topic) {
+        tal_free(sub);
+        return OPRT_MALLOC_FAILED;
+    }
+    strcpy(sub->topic, filter);
+    sub->cb = cb;
+    sub->userdata = (void *)(uintptr_t)idx;
+    sub->next = sg_list;
+    sg_list = sub;
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __list_run(uint32_t i)
+{
+    uint32_t idx = (i * 7) % BENCH_MQTT_SUBDEVS;
+    mqtt_client_message_t msg = {0};
+    BENCH_MQTT_SUB_T *sub = NULL;
+    size_t topic_length = 0;
+    char *topic = NULL;
+    uint32_t called = 0;
+
+    // the copy the MQTT client wrapper made of every topic
+    topic = tal_malloc(sg_topic_len[idx] + 1);
+    if (NULL == topic) {
+        return OPRT_MALLOC_FAILED;
+    }
+    memcpy(topic, sg_pkt + sg_topic_off[idx], sg_topic_len[idx]);
+    topic[sg_topic_len[idx]] = '\0';
+    msg.topic = topic;
+
+    topic_length = strlen(msg.topic);
+    for (sub = sg_list; sub; sub = sub->next) {
+        if (sub->topic_length == topic_length && !memcmp(topic, sub->topic, sub->topic_length)) {
+            sub->cb(1, &msg, sub->userdata);
+            called++;
+        }
+    }
+    tal_free(topic);
+
+    return (1 == called) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+static void __list_teardown(void)
+{
+    BENCH_MQTT_SUB_T *sub = NULL;
+
+    while (sg_list) {
+        sub = sg_list;
+        sg_list = sub->next;
+        tal_free(sub->topic);
+        tal_free(sub);
+    }
+}
+
+static OPERATE_RET __list_setup(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    __topics_build();
+    // the wildcard filters never matched a list entry
+    TUYA_CALL_ERR_RETURN(__subscribe_all(__list_add));
+
+    return __dispatch_check(__list_run);
+}
+
+static const BENCH_CASE_T sg_mqtt_cases[] = {
+    {"mqtt_route_trie", 200000, 0, __trie_setup, __trie_run, __trie_teardown},
+    {"mqtt_route_list", 200000, 0, __list_setup, __list_run, __list_teardown},
+};
+
+const BENCH_CASE_T *bench_mqtt_cases_get(uint32_t *num)
+{
+    *num = CNTSOF(sg_mqtt_cases);
+
+    return sg_mqtt_cases;
+}
@@ -0,0 +1,317 @@
+/**
+ * @file bench_cases_mqtt_recv.c
+ * @brief Benchmarks of the MQTT client receiving publishes larger than its
+ * buffer from a loopback broker.
+ *
+ * A broker thread on 127.0.0.1 accepts the client and sends it
+ * BENCH_MQTT_RECV_PAYLOAD byte QoS 1 publishes back to back until it is
+ * stopped. The client has its default CORE_MQTT_BUFFER_SIZE, so every one of
+ * them is streamed to on_message in chunks. One operation is one publish,
+ * each chunk is compared in place.
+ *
+ * The chunking, the reassembly, the acks and the dropped publishes are
+ * checked by the UT of libmqtt.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "tuya_cloud_types.h"
+#include "tal_log.h"
+#include "mqtt_client_interface.h"
+#include "bench.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define BENCH_MQTT_RECV_HOST     "127.0.0.1"
+#define BENCH_MQTT_RECV_TOPIC    "bench/stream"
+#define BENCH_MQTT_RECV_PAYLOAD  (64 * 1024)
+#define BENCH_MQTT_RECV_ID_MAX   100
+#define BENCH_MQTT_RECV_POLL_MS  5
+// short, the broker never lets the client idle and yield runs past it
+#define BENCH_MQTT_RECV_YIELD_MS 2
+
+#define BENCH_MQTT_RECV_HDR_MAX (5 + 2 + sizeof(BENCH_MQTT_RECV_TOPIC) + 2)
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static uint8_t sg_payload[BENCH_MQTT_RECV_PAYLOAD];
+static uint8_t sg_stream[BENCH_MQTT_RECV_HDR_MAX + BENCH_MQTT_RECV_PAYLOAD];
+static uint32_t sg_stream_len;
+
+static int sg_listen_fd = -1;
+static uint16_t sg_port;
+static pthread_t sg_server;
+static uint32_t sg_stop;
+
+static void *sg_client;
+// counted by on_message
+static uint32_t sg_streamed;
+static uint32_t sg_bad;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static uint32_t __publish_build(uint8_t *buf, const char *topic, uint16_t topic_len, uint8_t qos, uint16_t msgid,
+                                const uint8_t *payload, uint32_t length)
+{
+    uint32_t remaining = 2 + topic_len + (qos ? 2 : 0) + length;
+    uint32_t n = 0;
+
+    buf[n++] = 0x30 | (qos << 1);
+    do {
+        buf[n] = remaining % 128;
+        remaining /= 128;
+        buf[n] |= remaining ? 0x80 : 0;
+        n++;
+    } while (remaining);
+
+    buf[n++] = topic_len >> 8;
+    buf[n++] = topic_len & 0xFF;
+    memcpy(&buf[n], topic, topic_len);
+    n += topic_len;
+    if (qos) {
+        buf[n++] = msgid >> 8;
+        buf[n++] = msgid & 0xFF;
+    }
+    memcpy(&buf[n], payload, length);
+
+    return n + length;
+}
+
+static void __packets_build(void)
+{
+    bench_data_fill(sg_payload, sizeof(sg_payload), 7);
+
+    // the packet id is set before each send
+    sg_stream_len = __publish_build(sg_stream, BENCH_MQTT_RECV_TOPIC, strlen(BENCH_MQTT_RECV_TOPIC), 1, 0, sg_payload,
+                                    BENCH_MQTT_RECV_PAYLOAD);
+}
+
+// blocking, for the CONNECT only
+static int __packet_skip(int fd)
+{
+    uint32_t remaining = 0, shift = 0;
+    uint8_t c;
+
+    if (1 != recv(fd, &c, 1, MSG_WAITALL)) {
+        return -1;
+    }
+    do {
+        if (1 != recv(fd, &c, 1, MSG_WAITALL)) {
+            return -1;
+        }
+        remaining |= (uint32_t)(c & 0x7F) << shift;
+        shift += 7;
+    } while (c & 0x80);
+
+    for (; remaining; remaining--) {
+        if (1 != recv(fd, &c, 1, MSG_WAITALL)) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void *__server_task(void *arg)
+{
+    static const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+    const uint8_t *out = NULL;
+    uint32_t out_len = 0;
+    uint16_t msgid = 0;
+    struct pollfd pfd;
+    uint8_t in[64];
+    int fd = -1, ret;
+
+    pfd.fd = sg_listen_fd;
+    pfd.events = POLLIN;
+    while (fd < 0 && !__atomic_load_n(&sg_stop, __ATOMIC_RELAXED)) {
+        if (poll(&pfd, 1, BENCH_MQTT_RECV_POLL_MS) > 0) {
+            fd = accept(sg_listen_fd, NULL, NULL);
+        }
+    }
+    if (fd < 0 || __packet_skip(fd) || sizeof(connack) != send(fd, connack, sizeof(connack), MSG_NOSIGNAL)) {
+        goto __exit;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    while (!__atomic_load_n(&sg_stop, __ATOMIC_RELAXED)) {
+        pfd.fd = fd;
+        pfd.events = POLLIN | POLLOUT;
+        if (poll(&pfd, 1, BENCH_MQTT_RECV_POLL_MS) <= 0) {
+            continue;
+        }
+
+        // the PUBACKs, dropped
+        if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+            if (recv(fd, in, sizeof(in), 0) <= 0) {
+                break;
+            }
+        }
+
+        if (pfd.revents & POLLOUT) {
+            if (0 == out_len) {
+                msgid = (msgid % BENCH_MQTT_RECV_ID_MAX) + 1;
+                sg_stream[sg_stream_len - BENCH_MQTT_RECV_PAYLOAD - 2] = msgid >> 8;
+                sg_stream[sg_stream_len - BENCH_MQTT_RECV_PAYLOAD - 1] = msgid & 0xFF;
+                out = sg_stream;
+                out_len = sg_stream_len;
+            }
+            ret = send(fd, out, out_len, MSG_NOSIGNAL);
+            if (ret > 0) {
+                out += ret;
+                out_len -= ret;
+            }
+        }
+    }
+
+__exit:
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    return NULL;
+}
+
+static OPERATE_RET __server_start(void)
+{
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = 0};
+    socklen_t addr_len = sizeof(addr);
+
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sg_listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sg_listen_fd < 0 || bind(sg_listen_fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(sg_listen_fd, 1) ||
+        getsockname(sg_listen_fd, (struct sockaddr *)&addr, &addr_len)) {
+        perror("mqtt_recv: listen");
+        if (sg_listen_fd >= 0) {
+            close(sg_listen_fd);
+        }
+        return OPRT_COM_ERROR;
+    }
+    sg_port = ntohs(addr.sin_port);
+
+    sg_stop = 0;
+    if (0 != pthread_create(&sg_server, NULL, __server_task, NULL)) {
+        close(sg_listen_fd);
+        return OPRT_COM_ERROR;
+    }
+
+    return OPRT_OK;
+}
+
+static void __server_stop(void)
+{
+    __atomic_store_n(&sg_stop, 1, __ATOMIC_RELAXED);
+    pthread_join(sg_server, NULL);
+    close(sg_listen_fd);
+    sg_listen_fd = -1;
+}
+
+static void __on_message(void *client, uint16_t msgid, const mqtt_client_message_t *msg, void *userdata)
+{
+    if (msg->topic_length != strlen(BENCH_MQTT_RECV_TOPIC) ||
+        0 != memcmp(msg->topic, BENCH_MQTT_RECV_TOPIC, msg->topic_length) ||
+        msg->total_length != BENCH_MQTT_RECV_PAYLOAD || msg->offset + msg->length > msg->total_length) {
+        sg_bad++;
+        return;
+    }
+
+    // zero-copy, each chunk is checked where the client read it
+    if (0 != memcmp(msg->payload, sg_payload + msg->offset, msg->length)) {
+        sg_bad++;
+    }
+    if (msg->offset + msg->length == msg->total_length) {
+        sg_streamed++;
+    }
+}
+
+static void __stream_teardown(void)
+{
+    if (sg_client) {
+        mqtt_client_disconnect(sg_client);
+        mqtt_client_deinit(sg_client);
+        mqtt_client_free(sg_client);
+        sg_client = NULL;
+    }
+    if (sg_listen_fd >= 0) {
+        __server_stop();
+    }
+}
+
+static OPERATE_RET __stream_setup(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+    mqtt_client_config_t config = {
+        .host = BENCH_MQTT_RECV_HOST,
+        .keepalive = 60,
+        .timeout_ms = BENCH_MQTT_RECV_YIELD_MS,
+        .clientid = "bench",
+        .username = "bench",
+        .password = "bench",
+        .on_message = __on_message,
+    };
+
+    __packets_build();
+    TUYA_CALL_ERR_RETURN(__server_start());
+    config.port = sg_port;
+
+    sg_streamed = 0;
+    sg_bad = 0;
+    sg_client = mqtt_client_new();
+    if (NULL == sg_client || MQTT_STATUS_SUCCESS != mqtt_client_init(sg_client, &config)) {
+        mqtt_client_free(sg_client);
+        sg_client = NULL;
+        __stream_teardown();
+        return OPRT_COM_ERROR;
+    }
+    if (MQTT_STATUS_SUCCESS != mqtt_client_connect(sg_client)) {
+        fprintf(stderr, "mqtt_recv: connect failed\n");
+        __stream_teardown();
+        return OPRT_COM_ERROR;
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __stream_run(uint32_t i)
+{
+    uint32_t streamed = sg_streamed;
+
+    // a yield may take several publishes, the next operations find them done
+    if (0 == i) {
+        sg_streamed = 0;
+        streamed = 0;
+    }
+    while (streamed <= i) {
+        if (MQTT_STATUS_SUCCESS != mqtt_client_yield(sg_client)) {
+            return OPRT_COM_ERROR;
+        }
+        streamed = sg_streamed;
+    }
+
+    return sg_bad ? OPRT_COM_ERROR : OPRT_OK;
+}
+
+static const BENCH_CASE_T sg_mqtt_recv_cases[] = {
+    {"mqtt_recv_stream_64k", 1000, BENCH_MQTT_RECV_PAYLOAD, __stream_setup, __stream_run, __stream_teardown},
+};
+
+const BENCH_CASE_T *bench_mqtt_recv_cases_get(uint32_t *num)
+{
+    *num = CNTSOF(sg_mqtt_recv_cases);
+
+    return sg_mqtt_recv_cases;
+}
@@ -0,0 +1,473 @@
+/**
+ * @file bench_cases_ota.c
+ * @brief Benchmarks of the decompression and delta patching of OTA downloads.
+ *
+ * The image is synthetic firmware: runs of a few dozen recurring 16 byte
+ * words with random bytes in between, which compresses about like code. The
+ * setup compresses it in the format of tools/ota/ota_compress.py with a 256B,
+ * a 2KB and a 4KB window. One operation feeds the whole file through
+ * tuya_ota_decomp in download sized chunks.
+ *
+ * The delta cases apply a patch in the format of tools/ota/ota_delta.py
+ * through tuya_ota_delta, the image being the old one in the APP partition of
+ * the RAM flash. The new image keeps most blocks of the old one, changes a
+ * byte of every word of some, inserts new code and drops old code, and the
+ * setup writes the patch records from that edit list directly.
+ *
+ * The sink of ota_decomp_64k and ota_delta_64k takes every byte it is given.
+ * The one of the sector cases only takes whole 4KB sectors, like a flash
+ * without a write buffer, so the decoder keeps its tail and grows its output
+ * buffer.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tuya_cloud_types.h"
+#include "tal_log.h"
+#include "tal_hash.h"
+#include "tkl_flash.h"
+#include "tuya_ota_decomp.h"
+#include "tuya_ota_delta.h"
+#include "bench.h"
+#include "bench_port.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define BENCH_OTA_RAW_LEN   (64 * 1024)
+#define BENCH_OTA_CHUNK     1024 // a download read
+#define BENCH_OTA_SECTOR    4096
+#define BENCH_OTA_LOOKAHEAD 4
+#define BENCH_OTA_WORDS     64
+#define BENCH_OTA_HASH      4096
+#define BENCH_OTA_PROBES    32
+#define BENCH_OTA_RECORDS   64
+// the new image grows by the inserted code, at most half of every block
+#define BENCH_OTA_NEW_MAX   (BENCH_OTA_RAW_LEN * 3 / 2)
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint8_t *buf;
+    uint32_t len;
+    uint32_t acc;
+    uint32_t nbits;
+} BENCH_BITS_T;
+
+typedef struct {
+    uint8_t window;
+    uint8_t *data;
+    uint32_t len;
+} BENCH_OTA_COMP_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static uint8_t sg_raw[BENCH_OTA_RAW_LEN];
+static BENCH_OTA_COMP_T sg_comp[] = {{8}, {11}, {12}};
+static bool sg_comp_ready = false;
+static uint8_t *sg_new = NULL; // the image the delta patch makes of sg_raw
+static uint32_t sg_new_len = 0;
+static uint8_t *sg_patch = NULL;
+static uint32_t sg_patch_len = 0;
+// what the sinks compare the output with
+static const uint8_t *sg_expect = NULL;
+static uint32_t sg_expect_len = 0;
+static uint32_t sg_sink_len = 0;
+static bool sg_sink_ok = true;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static void __bits_put(BENCH_BITS_T *bits, uint32_t value, uint32_t n)
+{
+    bits->acc = (bits->acc << n) | value;
+    bits->nbits += n;
+    while (bits->nbits >= 8) {
+        bits->nbits -= 8;
+        bits->buf[bits->len++] = (uint8_t)(bits->acc >> bits->nbits);
+    }
+    bits->acc &= (1 << bits->nbits) - 1;
+}
+
+static uint32_t __hash3(const uint8_t *p)
+{
+    return ((p[0] << 8) ^ (p[1] << 4) ^ p[2]) & (BENCH_OTA_HASH - 1);
+}
+
+// greedy LZSS over a hash chain, the elements decoded by tuya_ota_decomp
+static uint32_t __compress(const uint8_t *in, uint32_t len, uint8_t window_bits, uint8_t *out)
+{
+    static int32_t head[BENCH_OTA_HASH];
+    static int32_t prev[BENCH_OTA_RAW_LEN];
+    const uint32_t window = 1 << window_bits, max_len = 1 << BENCH_OTA_LOOKAHEAD;
+    BENCH_BITS_T bits = {out + OTA_DECOMP_HEADER_SIZE, 0, 0, 0};
+    uint32_t i = 0, j, best_len, best_dist, cand_len, probes;
+    int32_t cand;
+
+    memcpy(out, OTA_DECOMP_MAGIC, 4);
+    out[4] = window_bits;
+    out[5] = BENCH_OTA_LOOKAHEAD;
+    out[6] = out[7] = 0;
+    out[8] = len & 0xff;
+    out[9] = (len >> 8) & 0xff;
+    out[10] = (len >> 16) & 0xff;
+    out[11] = (len >> 24) & 0xff;
+
+    memset(head, 0xff, sizeof(head));
+    while (i < len) {
+        best_len = 0;
+        best_dist = 0;
+        if (i + 3 <= len) {
+            cand = head[__hash3(&in[i])];
+            for (probes = 0; cand >= 0 && i - cand <= window && probes < BENCH_OTA_PROBES; probes++) {
+                for (cand_len = 0; cand_len < max_len && i + cand_len < len && in[cand + cand_len] == in[i + cand_len];
+                     cand_len++) {
+                }
+                if (cand_len > best_len) {
+                    best_len = cand_len;
+                    best_dist = i - cand;
+                }
+                cand = prev[cand];
+            }
+        }
+
+        // a copy costs 1 + window + 4 bits, at most 17, three literals 27
+        if (best_len >= 3) {
+            __bits_put(&bits, 0, 1);
+            __bits_put(&bits, best_dist - 1, window_bits);
+            __bits_put(&bits, best_len - 1, BENCH_OTA_LOOKAHEAD);
+        } else {
+            best_len = 1;
+            __bits_put(&bits, 1, 1);
+            __bits_put(&bits, in[i], 8);
+        }
+        for (j = 0; j < best_len; j++, i++) {
+            if (i + 3 <= len) {
+                prev[i] = head[__hash3(&in[i])];
+                head[__hash3(&in[i])] = i;
+            }
+        }
+    }
+    if (bits.nbits) {
+        __bits_put(&bits, 0, 8 - bits.nbits);
+    }
+
+    return OTA_DECOMP_HEADER_SIZE + bits.len;
+}
+
+static void __image_build(void)
+{
+    static uint8_t words[BENCH_OTA_WORDS][16];
+    uint8_t rnd[BENCH_OTA_RAW_LEN / 4];
+    uint32_t pos = 0, r = 0, n;
+
+    bench_data_fill(&words[0][0], sizeof(words), 31);
+    bench_data_fill(rnd, sizeof(rnd), 32);
+    while (pos < BENCH_OTA_RAW_LEN) {
+        if (rnd[r % sizeof(rnd)] < 96) {
+            n = MIN(16, BENCH_OTA_RAW_LEN - pos);
+            memcpy(&sg_raw[pos], words[rnd[(r + 1) % sizeof(rnd)] % BENCH_OTA_WORDS], n);
+        } else {
+            n = MIN(4, BENCH_OTA_RAW_LEN - pos);
+            memcpy(&sg_raw[pos], &rnd[(r + 2) % (sizeof(rnd) - 4)], n);
+        }
+        pos += n;
+        r += 3;
+    }
+}
+
+static int __sink_check(uint8_t *data, uint32_t len, uint32_t offset)
+{
+    if (offset != sg_sink_len || offset + len > sg_expect_len || memcmp(data, &sg_expect[offset], len)) {
+        sg_sink_ok = false;
+        return -1;
+    }
+    sg_sink_len += len;
+
+    return (int)len;
+}
+
+static int __sink_all(uint8_t *data, uint32_t len, uint32_t offset, void *user_data)
+{
+    return __sink_check(data, len, offset);
+}
+
+static int __sink_sector(uint8_t *data, uint32_t len, uint32_t offset, void *user_data)
+{
+    // the last sector of the image is written short
+    if (offset + len < sg_expect_len) {
+        len -= (offset + len) % BENCH_OTA_SECTOR;
+    }
+
+    return len ? __sink_check(data, len, offset) : 0;
+}
+
+static OPERATE_RET __decomp_setup(void)
+{
+    uint32_t i;
+
+    if (sg_comp_ready) {
+        return OPRT_OK;
+    }
+
+    __image_build();
+    for (i = 0; i < CNTSOF(sg_comp); i++) {
+        // a literal takes 9 bits, nothing grows by more than 1/8
+        sg_comp[i].data = malloc(OTA_DECOMP_HEADER_SIZE + BENCH_OTA_RAW_LEN + BENCH_OTA_RAW_LEN / 8 + 1);
+        if (NULL == sg_comp[i].data) {
+            return OPRT_MALLOC_FAILED;
+        }
+        sg_comp[i].len = __compress(sg_raw, BENCH_OTA_RAW_LEN, sg_comp[i].window, sg_comp[i].data);
+        printf("ota: %u bytes compressed to %u (%u%%) with a %u byte window\n", BENCH_OTA_RAW_LEN, sg_comp[i].len,
+               sg_comp[i].len * 100 / BENCH_OTA_RAW_LEN, 1 << sg_comp[i].window);
+    }
+    sg_comp_ready = true;
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __decomp_image(const BENCH_OTA_COMP_T *comp, tuya_ota_decomp_output_cb output_cb)
+{
+    OPERATE_RET rt = OPRT_OK;
+    tuya_ota_decomp_t *decomp = NULL;
+    uint32_t pos, n;
+
+    decomp = tuya_ota_decomp_create(output_cb, NULL);
+    if (NULL == decomp) {
+        return OPRT_MALLOC_FAILED;
+    }
+
+    sg_expect = sg_raw;
+    sg_expect_len = BENCH_OTA_RAW_LEN;
+    sg_sink_len = 0;
+    sg_sink_ok = true;
+    for (pos = 0; pos < comp->len && OPRT_OK == rt; pos += n) {
+        n = MIN(BENCH_OTA_CHUNK, comp->len - pos);
+        rt = tuya_ota_decomp_write(decomp, comp->data + pos, n);
+    }
+    if (OPRT_OK == rt) {
+        rt = tuya_ota_decomp_finish(decomp);
+    }
+    tuya_ota_decomp_destroy(decomp);
+
+    if (OPRT_OK == rt && (!sg_sink_ok || BENCH_OTA_RAW_LEN != sg_sink_len)) {
+        rt = OPRT_COM_ERROR;
+    }
+
+    return rt;
+}
+
+static OPERATE_RET __decomp_w8_run(uint32_t i)
+{
+    return __decomp_image(&sg_comp[0], __sink_all);
+}
+
+static OPERATE_RET __decomp_run(uint32_t i)
+{
+    return __decomp_image(&sg_comp[1], __sink_all);
+}
+
+static OPERATE_RET __decomp_w12_run(uint32_t i)
+{
+    return __decomp_image(&sg_comp[2], __sink_all);
+}
+
+static OPERATE_RET __decomp_sector_run(uint32_t i)
+{
+    return __decomp_image(&sg_comp[1], __sink_sector);
+}
+
+static void __decomp_teardown(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < CNTSOF(sg_comp); i++) {
+        free(sg_comp[i].data);
+        sg_comp[i].data = NULL;
+    }
+    sg_comp_ready = false;
+}
+
+static void __put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = (v >> 24) & 0xff;
+}
+
+// the diff coding of ota_delta.py: zero runs and literal runs
+static uint32_t __diff_encode(const uint8_t *old, const uint8_t *new, uint32_t len, uint8_t *out)
+{
+    uint32_t i = 0, j, o = 0;
+
+    while (i < len) {
+        if (old[i] == new[i]) {
+            for (j = i; j < len && old[j] == new[j] && j - i < 0x8000; j++) {
+            }
+            out[o++] = 0x80 | ((j - i - 1) >> 8);
+            out[o++] = (j - i - 1) & 0xff;
+        } else {
+            for (j = i; j < len && old[j] != new[j] && j - i < 0x80; j++) {
+            }
+            out[o++] = j - i - 1;
+            for (; i < j; i++) {
+                out[o++] = new[i] - old[i];
+            }
+        }
+        i = j;
+    }
+
+    return o;
+}
+
+/**
+ * @brief makes the new image out of blocks of sg_raw and the patch from it
+ *
+ * A record takes a block of the old image, with a byte of every word changed
+ * in one block out of four, then new code in one out of four and skips old
+ * code in one out of eight.
+ */
+static OPERATE_RET __delta_setup(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint8_t rnd[BENCH_OTA_RECORDS * 4];
+    uint8_t *rec = NULL;
+    uint32_t r, old_pos = 0, diff_len, extra_len, seek, k;
+
+    if (sg_patch) {
+        return OPRT_OK;
+    }
+    TUYA_CALL_ERR_RETURN(__decomp_setup());
+
+    // the old image runs from the APP partition
+    TUYA_CALL_ERR_RETURN(tkl_flash_erase(BENCH_FLASH_APP_ADDR, BENCH_OTA_RAW_LEN));
+    TUYA_CALL_ERR_RETURN(tkl_flash_write(BENCH_FLASH_APP_ADDR, sg_raw, BENCH_OTA_RAW_LEN));
+
+    sg_new = malloc(BENCH_OTA_NEW_MAX);
+    // a diff byte codes in 1 + 1/128 bytes at worst
+    sg_patch = malloc(OTA_DELTA_HEADER_SIZE + BENCH_OTA_RECORDS * 12 + BENCH_OTA_NEW_MAX * 2);
+    if (NULL == sg_new || NULL == sg_patch) {
+        return OPRT_MALLOC_FAILED;
+    }
+
+    bench_data_fill(rnd, sizeof(rnd), 33);
+    sg_new_len = 0;
+    sg_patch_len = OTA_DELTA_HEADER_SIZE;
+    for (r = 0; old_pos < BENCH_OTA_RAW_LEN; r++) {
+        if (r >= BENCH_OTA_RECORDS - 1) {
+            diff_len = BENCH_OTA_RAW_LEN - old_pos;
+        } else {
+            diff_len = MIN(512 + rnd[r * 4] * 8, BENCH_OTA_RAW_LEN - old_pos);
+        }
+        extra_len = (0 == rnd[r * 4 + 1] % 4) ? 64 + rnd[r * 4 + 2] : 0;
+        seek = (0 == rnd[r * 4 + 3] % 8) ? MIN(256 + rnd[r * 4 + 2], BENCH_OTA_RAW_LEN - old_pos - diff_len) : 0;
+
+        rec = sg_patch + sg_patch_len;
+        __put_u32(rec, diff_len);
+        __put_u32(rec + 4, extra_len);
+        __put_u32(rec + 8, seek);
+        sg_patch_len += 12;
+
+        memcpy(sg_new + sg_new_len, sg_raw + old_pos, diff_len);
+        if (0 == rnd[r * 4 + 1] % 4 || 1 == rnd[r * 4 + 1] % 4) {
+            for (k = 0; k < diff_len; k += 16) {
+                sg_new[sg_new_len + k] += 4;
+            }
+        }
+        sg_patch_len += __diff_encode(sg_raw + old_pos, sg_new + sg_new_len, diff_len, sg_patch + sg_patch_len);
+        sg_new_len += diff_len;
+
+        bench_data_fill(sg_new + sg_new_len, extra_len, 34 + r);
+        memcpy(sg_patch + sg_patch_len, sg_new + sg_new_len, extra_len);
+        sg_patch_len += extra_len;
+        sg_new_len += extra_len;
+
+        old_pos += diff_len + seek;
+    }
+
+    memcpy(sg_patch, OTA_DELTA_MAGIC, OTA_DELTA_MAGIC_LEN);
+    sg_patch[4] = OTA_DELTA_VERSION;
+    sg_patch[5] = sg_patch[6] = sg_patch[7] = 0;
+    __put_u32(sg_patch + 8, BENCH_OTA_RAW_LEN);
+    __put_u32(sg_patch + 12, sg_new_len);
+    tal_sha256_ret(sg_raw, BENCH_OTA_RAW_LEN, sg_patch + 16, 0);
+    tal_sha256_ret(sg_new, sg_new_len, sg_patch + 48, 0);
+    printf("ota: delta of %u bytes to %u, %u byte patch (%u%%)\n", BENCH_OTA_RAW_LEN, sg_new_len, sg_patch_len,
+           sg_patch_len * 100 / sg_new_len);
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __delta_image(tuya_ota_delta_output_cb output_cb)
+{
+    OPERATE_RET rt = OPRT_OK;
+    tuya_ota_delta_t *delta = NULL;
+    uint32_t pos, n;
+
+    delta = tuya_ota_delta_create(output_cb, NULL);
+    if (NULL == delta) {
+        return OPRT_MALLOC_FAILED;
+    }
+
+    sg_expect = sg_new;
+    sg_expect_len = sg_new_len;
+    sg_sink_len = 0;
+    sg_sink_ok = true;
+    for (pos = 0; pos < sg_patch_len && OPRT_OK == rt; pos += n) {
+        n = MIN(BENCH_OTA_CHUNK, sg_patch_len - pos);
+        rt = tuya_ota_delta_write(delta, sg_patch + pos, n);
+    }
+    if (OPRT_OK == rt) {
+        rt = tuya_ota_delta_finish(delta);
+    }
+    tuya_ota_delta_destroy(delta);
+
+    if (OPRT_OK == rt && (!sg_sink_ok || sg_new_len != sg_sink_len)) {
+        rt = OPRT_COM_ERROR;
+    }
+
+    return rt;
+}
+
+static OPERATE_RET __delta_run(uint32_t i)
+{
+    return __delta_image(__sink_all);
+}
+
+static OPERATE_RET __delta_sector_run(uint32_t i)
+{
+    return __delta_image(__sink_sector);
+}
+
+static void __delta_teardown(void)
+{
+    free(sg_new);
+    sg_new = NULL;
+    free(sg_patch);
+    sg_patch = NULL;
+    __decomp_teardown();
+}
+
+static const BENCH_CASE_T sg_ota_cases[] = {
+    {"ota_decomp_64k", 200, BENCH_OTA_RAW_LEN, __decomp_setup, __decomp_run, __decomp_teardown},
+    {"ota_decomp_w8_64k", 200, BENCH_OTA_RAW_LEN, __decomp_setup, __decomp_w8_run, __decomp_teardown},
+    {"ota_decomp_w12_64k", 200, BENCH_OTA_RAW_LEN, __decomp_setup, __decomp_w12_run, __decomp_teardown},
+    {"ota_decomp_sector_64k", 200, BENCH_OTA_RAW_LEN, __decomp_setup, __decomp_sector_run, __decomp_teardown},
+    {"ota_delta_64k", 200, BENCH_OTA_RAW_LEN, __delta_setup, __delta_run, __delta_teardown},
+    {"ota_delta_sector_64k", 200, BENCH_OTA_RAW_LEN, __delta_setup, __delta_sector_run, __delta_teardown},
+};
+
+const BENCH_CASE_T *bench_ota_cases_get(uint32_t *num)
+{
+    *num = CNTSOF(sg_ota_cases);
+
+    return sg_ota_cases;
+}
@@ -0,0 +1,294 @@
+/**
+ * @file bench_cases_tal.c
+ * @brief Benchmarks of tal_kv, the DP report JSON and websocket framing.
+ *
+ * tal_kv runs on littlefs over the RAM flash of the port. The websocket
+ * cases replace the socket layer: sent frames are dropped and received
+ * frames are read from a prepared server frame.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tuya_cloud_types.h"
+#include "tal_api.h"
+#include "cJSON.h"
+#include "dp_schema.h"
+#include "websocket_frame.h"
+#include "websocket_netio.h"
+#include "bench.h"
+#include "bench_port.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define BENCH_KV_KEYS    8
+#define BENCH_KV_LEN     256
+#define BENCH_DP_NUM     8
+#define BENCH_DP_DEVID   "bench00000000000devid"
+#define BENCH_WS_LEN     1024
+
+// the DP types of a typical appliance
+static const char sg_dp_schema[] =
+    "[{\"mode\":\"rw\",\"property\":{\"type\":\"bool\"},\"id\":1,\"type\":\"obj\"},"
+    "{\"mode\":\"rw\",\"property\":{\"min\":0,\"max\":1000,\"scale\":0,\"step\":1,\"type\":\"value\"},\"id\":2,"
+    "\"type\":\"obj\"},"
+    "{\"mode\":\"rw\",\"property\":{\"range\":[\"white\",\"colour\",\"scene\",\"music\"],\"type\":\"enum\"},\"id\":3,"
+    "\"type\":\"obj\"},"
+    "{\"mode\":\"rw\",\"property\":{\"type\":\"string\",\"maxlen\":255},\"id\":4,\"type\":\"obj\"},"
+    "{\"mode\":\"ro\",\"property\":{\"label\":[\"fault1\",\"fault2\"],\"type\":\"bitmap\",\"maxlen\":2},\"id\":5,"
+    "\"type\":\"obj\"},"
+    "{\"mode\":\"rw\",\"property\":{\"min\":-40,\"max\":100,\"scale\":1,\"step\":1,\"type\":\"value\"},\"id\":6,"
+    "\"type\":\"obj\"},"
+    "{\"mode\":\"rw\",\"property\":{\"type\":\"bool\"},\"id\":7,\"type\":\"obj\"},"
+    "{\"mode\":\"ro\",\"property\":{\"min\":0,\"max\":86400,\"scale\":0,\"step\":1,\"type\":\"value\"},\"id\":8,"
+    "\"type\":\"obj\"}]";
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static uint8_t sg_kv_val[BENCH_KV_LEN];
+static char sg_kv_key[BENCH_KV_KEYS][16];
+
+static dp_schema_t *sg_schema;
+static dp_obj_t sg_dps[BENCH_DP_NUM];
+static char sg_dp_str[48];
+
+static WEBSOCKET_S sg_ws;
+static uint8_t sg_ws_payload[WS_FRAME_SEND_HEADER_SIZE + BENCH_WS_LEN];
+static uint8_t sg_ws_rx[WS_FRAME_HEADER_SIZE + BENCH_WS_LEN];
+static size_t sg_ws_rx_len, sg_ws_rx_off, sg_ws_sent;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+TIME_T tal_time_get_posix(void)
+{
+    return 1700000000;
+}
+
+int uni_random_range(unsigned int range)
+{
+    return tal_system_get_random(range ? range : 0xFF);
+}
+
+OPERATE_RET websocket_netio_send_lock(WEBSOCKET_S *ws, void *data, size_t len)
+{
+    sg_ws_sent += len;
+
+    return OPRT_OK;
+}
+
+OPERATE_RET websocket_netio_recv_ext(WEBSOCKET_S *ws, uint8_t *buf, size_t len)
+{
+    if (sg_ws_rx_off + len > sg_ws_rx_len) {
+        return OPRT_RECV_ERR;
+    }
+    memcpy(buf, sg_ws_rx + sg_ws_rx_off, len);
+    sg_ws_rx_off += len;
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __kv_setup(void)
+{
+    tal_kv_cfg_t cfg = {
+        .seed = "vmlkasdh93dlvlcy",
+        .key = "dflfuap134ddlduq",
+    };
+    uint8_t *value = NULL;
+    size_t len = 0;
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t i;
+
+    bench_flash_erase_all();
+    bench_data_fill(sg_kv_val, sizeof(sg_kv_val), 5);
+    TUYA_CALL_ERR_RETURN(tal_kv_init(&cfg));
+
+    for (i = 0; i < BENCH_KV_KEYS; i++) {
+        snprintf(sg_kv_key[i], sizeof(sg_kv_key[i]), "bench.key%u", i);
+        TUYA_CALL_ERR_RETURN(tal_kv_set(sg_kv_key[i], sg_kv_val, BENCH_KV_LEN));
+    }
+
+    TUYA_CALL_ERR_RETURN(tal_kv_get(sg_kv_key[0], &value, &len));
+    rt = (BENCH_KV_LEN == len && 0 == memcmp(value, sg_kv_val, len)) ? OPRT_OK : OPRT_COM_ERROR;
+    tal_kv_free(value);
+
+    return rt;
+}
+
+static void __kv_teardown(void)
+{
+    lfs_unmount(tal_lfs_get());
+}
+
+static OPERATE_RET __kv_set_run(uint32_t i)
+{
+    sg_kv_val[0] = (uint8_t)i;
+
+    return tal_kv_set(sg_kv_key[i % BENCH_KV_KEYS], sg_kv_val, BENCH_KV_LEN);
+}
+
+static OPERATE_RET __kv_get_run(uint32_t i)
+{
+    uint8_t *value = NULL;
+    size_t len = 0;
+    OPERATE_RET rt = OPRT_OK;
+
+    TUYA_CALL_ERR_RETURN(tal_kv_get(sg_kv_key[i % BENCH_KV_KEYS], &value, &len));
+    tal_kv_free(value);
+
+    return (BENCH_KV_LEN == len) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+static OPERATE_RET __dp_setup(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    // same hooks as the applications, see tuya_main.c
+    cJSON_InitHooks(&(cJSON_Hooks){.malloc_fn = tal_malloc, .free_fn = tal_free});
+    TUYA_CALL_ERR_RETURN(dp_schema_create(BENCH_DP_DEVID, (char *)sg_dp_schema, &sg_schema));
+
+    memset(sg_dps, 0, sizeof(sg_dps));
+    sg_dps[0] = (dp_obj_t){.id = 1, .type = PROP_BOOL};
+    sg_dps[1] = (dp_obj_t){.id = 2, .type = PROP_VALUE};
+    sg_dps[2] = (dp_obj_t){.id = 3, .type = PROP_ENUM};
+    sg_dps[3] = (dp_obj_t){.id = 4, .type = PROP_STR, .value.dp_str = sg_dp_str};
+    sg_dps[4] = (dp_obj_t){.id = 5, .type = PROP_BITMAP};
+    sg_dps[5] = (dp_obj_t){.id = 6, .type = PROP_VALUE};
+    sg_dps[6] = (dp_obj_t){.id = 7, .type = PROP_BOOL};
+    sg_dps[7] = (dp_obj_t){.id = 8, .type = PROP_VALUE};
+
+    return OPRT_OK;
+}
+
+static void __dp_teardown(void)
+{
+    dp_schema_delete(BENCH_DP_DEVID);
+    sg_schema = NULL;
+}
+
+/**
+ * @brief the JSON part of tuya_iot_dp_obj_report, up to the LAN message
+ */
+static OPERATE_RET __dp_rept_json_run(uint32_t i)
+{
+    dp_rept_in_t dpin = {.rept_type = T_OBJ_REPT, .dpscnt = BENCH_DP_NUM, .dps = sg_dps};
+    dp_rept_out_t dpout = {0};
+    dp_rept_valid_t *dpvalid = NULL;
+    char *out = NULL;
+    OPERATE_RET rt = OPRT_OK;
+
+    sg_dps[0].value.dp_bool = i & 1;
+    sg_dps[1].value.dp_value = i % 1000;
+    sg_dps[2].value.dp_enum = i % 4;
+    snprintf(sg_dp_str, sizeof(sg_dp_str), "scene \"%u\" 0e0d0000000a03e803e8", i);
+    sg_dps[4].value.dp_bitmap = i & 3;
+    sg_dps[5].value.dp_value = (int)(i % 140) - 40;
+    sg_dps[6].value.dp_bool = !(i & 1);
+    sg_dps[7].value.dp_value = i % 86400;
+
+    dpvalid = tal_malloc(sizeof(dp_rept_valid_t) + BENCH_DP_NUM);
+    if (NULL == dpvalid) {
+        return OPRT_MALLOC_FAILED;
+    }
+    memset(dpvalid, 0, sizeof(dp_rept_valid_t) + BENCH_DP_NUM);
+
+    rt = dp_rept_valid_check(sg_schema, &dpin, dpvalid);
+    if (OPRT_OK == rt) {
+        rt = dp_rept_json_output(sg_schema, &dpin, dpvalid, &dpout);
+    }
+    if (OPRT_OK == rt) {
+        rt = dp_rept_json_append(sg_schema, dpout.dpsjson, NULL, NULL, 0, &out);
+    }
+
+    tal_free(out);
+    tal_free(dpout.dpsjson);
+    tal_free(dpout.timejson);
+    tal_free(dpvalid);
+
+    return rt;
+}
+
+static OPERATE_RET __dp_dump_run(uint32_t i)
+{
+    char *json = dp_obj_dump_all_json(BENCH_DP_DEVID, 0);
+    if (NULL == json) {
+        return OPRT_COM_ERROR;
+    }
+    tal_free(json);
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __dp_dump_setup(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    TUYA_CALL_ERR_RETURN(__dp_setup());
+
+    // give every DP a value to dump
+    return __dp_rept_json_run(1);
+}
+
+static OPERATE_RET __ws_setup(void)
+{
+    WEBSOCKET_FRAME_HEADER_S *head = (WEBSOCKET_FRAME_HEADER_S *)sg_ws_rx;
+
+    memset(&sg_ws, 0, sizeof(sg_ws));
+    bench_data_fill(sg_ws_payload, sizeof(sg_ws_payload), 6);
+
+    // unmasked server frame with a 16 bit length
+    memset(sg_ws_rx, 0, sizeof(sg_ws_rx));
+    head->fin = 1;
+    head->opcode = WS_FRAME_TYPE_BINARY;
+    head->payload_len = 126;
+    sg_ws_rx[2] = (uint8_t)(BENCH_WS_LEN >> 8);
+    sg_ws_rx[3] = (uint8_t)BENCH_WS_LEN;
+    bench_data_fill(sg_ws_rx + 4, BENCH_WS_LEN, 7);
+    sg_ws_rx_len = 4 + BENCH_WS_LEN;
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __ws_send_run(uint32_t i)
+{
+    return websocket_send_frame(&sg_ws, WS_FRAME_TYPE_BINARY, sg_ws_payload, BENCH_WS_LEN, TRUE, TRUE);
+}
+
+static OPERATE_RET __ws_send_inplace_run(uint32_t i)
+{
+    return websocket_send_frame_inplace(&sg_ws, WS_FRAME_TYPE_BINARY, sg_ws_payload, BENCH_WS_LEN);
+}
+
+static void __ws_recv_cb(WEBSOCKET_S *ws, WEBSOCKET_FRAME_TYPE_E type, BOOL_T final, void *data, size_t len)
+{
+    sg_ws_sent += len;
+}
+
+static OPERATE_RET __ws_recv_run(uint32_t i)
+{
+    sg_ws_rx_off = 0;
+
+    return websocket_recv_frame(&sg_ws, __ws_recv_cb);
+}
+
+static const BENCH_CASE_T sg_tal_cases[] = {
+    {"kv_set_256", 2000, BENCH_KV_LEN, __kv_setup, __kv_set_run, __kv_teardown},
+    {"kv_get_256", 5000, BENCH_KV_LEN, __kv_setup, __kv_get_run, __kv_teardown},
+    {"dp_rept_json_8dp", 20000, 0, __dp_setup, __dp_rept_json_run, __dp_teardown},
+    {"dp_dump_all_json", 20000, 0, __dp_dump_setup, __dp_dump_run, __dp_teardown},
+    {"ws_send_1k", 50000, BENCH_WS_LEN, __ws_setup, __ws_send_run, NULL},
+    {"ws_send_inplace_1k", 50000, BENCH_WS_LEN, __ws_setup, __ws_send_inplace_run, NULL},
+    {"ws_recv_1k", 50000, BENCH_WS_LEN, __ws_setup, __ws_recv_run, NULL},
+};
+
+const BENCH_CASE_T *bench_tal_cases_get(uint32_t *num)
+{
+    *num = CNTSOF(sg_tal_cases);
+
+    return sg_tal_cases;
+}
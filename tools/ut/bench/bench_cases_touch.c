@@ -0,0 +1,78 @@
+/**
+ * @file bench_cases_touch.c
+ * @brief Benchmarks of the touch filter and gesture recognizer.
+ *
+ * One operation replays every recorded trace of touch_traces.h through
+ * touch_gesture_feed. The events they give are checked by the UT of
+ * src/peripherals/touch.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <string.h>
+
+#include "tuya_cloud_types.h"
+#include "tal_log.h"
+#include "touch_gesture.h"
+#include "touch_traces.h"
+#include "bench.h"
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static TOUCH_TRACE_FRAME_T sg_frames[CNTSOF(sg_touch_traces)][TOUCH_TRACE_FRAME_MAX];
+static uint32_t sg_frame_num[CNTSOF(sg_touch_traces)];
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static uint32_t __trace_replay(uint32_t t)
+{
+    touch_event_t events[TOUCH_GESTURE_EVENT_MAX];
+    touch_point_t points[TOUCH_GESTURE_POINT_MAX];
+    touch_gesture_t gesture;
+    uint32_t f, total = 0;
+
+    touch_gesture_reset(&gesture);
+    for (f = 0; f < sg_frame_num[t]; f++) {
+        memcpy(points, sg_frames[t][f].point, sizeof(points));
+        total += touch_gesture_feed(&gesture, points, sg_frames[t][f].num, sg_frames[t][f].ms, events);
+    }
+
+    return total;
+}
+
+static OPERATE_RET __replay_setup(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t t;
+
+    for (t = 0; t < CNTSOF(sg_touch_traces); t++) {
+        TUYA_CALL_ERR_RETURN(touch_trace_parse(sg_touch_traces[t].frames, sg_frames[t], &sg_frame_num[t]));
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __replay_run(uint32_t i)
+{
+    uint32_t t, events = 0;
+
+    for (t = 0; t < CNTSOF(sg_touch_traces); t++) {
+        events += __trace_replay(t);
+    }
+
+    return events ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+static const BENCH_CASE_T sg_touch_cases[] = {
+    {"touch_replay", 20000, 0, __replay_setup, __replay_run, NULL},
+};
+
+const BENCH_CASE_T *bench_touch_cases_get(uint32_t *num)
+{
+    *num = CNTSOF(sg_touch_cases);
+
+    return sg_touch_cases;
+}
@@ -0,0 +1,292 @@
+/**
+ * @file bench_cases_uart.c
+ * @brief Benchmarks of tal_uart on the pty UART of the host port.
+ *
+ * A peer thread plays the device at the other end of the wire. It sends or
+ * checks an endless stream in which every byte depends on its position, so a
+ * lost, duplicated or reordered byte fails the case. One operation moves one
+ * chunk of the stream through tal_uart. Before it is measured, every case
+ * streams some megabytes and checks that all of them arrived intact.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "tuya_cloud_types.h"
+#include "tal_log.h"
+#include "tal_system.h"
+#include "tal_uart.h"
+#include "bench.h"
+#include "bench_port.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define BENCH_UART_CHUNK    4096
+#define BENCH_UART_RING     (16 * 1024)
+#define BENCH_UART_STRESS   (4 * 1024 * 1024)
+#define BENCH_UART_LOST_MS  1000 // a byte not received by then is lost
+#define BENCH_UART_POLL_MS  20
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static TUYA_UART_NUM_E sg_port;
+static int sg_peer_fd = -1;
+static pthread_t sg_peer;
+static uint32_t sg_stop;
+static uint64_t sg_pos;       // stream bytes moved by tal_uart
+static uint64_t sg_peer_pos;  // stream bytes moved by the peer
+static uint32_t sg_peer_bad;  // the peer received a wrong byte
+static uint32_t sg_tx_done;   // tx done callbacks
+static uint8_t sg_buf[BENCH_UART_CHUNK];
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static uint8_t __stream_byte(uint64_t pos)
+{
+    return (uint8_t)((pos ^ (pos >> 8) ^ (pos >> 16)) * 167);
+}
+
+static void __stream_fill(uint8_t *buf, uint32_t len, uint64_t pos)
+{
+    uint32_t i;
+
+    for (i = 0; i < len; i++) {
+        buf[i] = __stream_byte(pos + i);
+    }
+}
+
+static bool __stream_check(const uint8_t *buf, uint32_t len, uint64_t pos)
+{
+    uint32_t i;
+
+    for (i = 0; i < len; i++) {
+        if (buf[i] != __stream_byte(pos + i)) {
+            fprintf(stderr, "uart: byte %llu is 0x%02x, expected 0x%02x\n", (unsigned long long)(pos + i), buf[i],
+                    __stream_byte(pos + i));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void *__peer_send_task(void *arg)
+{
+    uint8_t buf[BENCH_UART_CHUNK];
+    struct pollfd pfd = {.fd = sg_peer_fd, .events = POLLOUT};
+    uint32_t len = 0, off = 0;
+    int ret;
+
+    while (!__atomic_load_n(&sg_stop, __ATOMIC_RELAXED)) {
+        if (off == len) {
+            __stream_fill(buf, sizeof(buf), sg_peer_pos);
+            len = sizeof(buf);
+            off = 0;
+        }
+
+        ret = write(sg_peer_fd, buf + off, len - off);
+        if (ret > 0) {
+            off += ret;
+            sg_peer_pos += ret;
+        } else {
+            // the pty is full while tal_uart holds rx off
+            poll(&pfd, 1, BENCH_UART_POLL_MS);
+        }
+    }
+
+    return NULL;
+}
+
+static void *__peer_recv_task(void *arg)
+{
+    uint8_t buf[BENCH_UART_CHUNK];
+    struct pollfd pfd = {.fd = sg_peer_fd, .events = POLLIN};
+    uint64_t pos = 0;
+    int ret;
+
+    while (!__atomic_load_n(&sg_stop, __ATOMIC_RELAXED)) {
+        ret = read(sg_peer_fd, buf, sizeof(buf));
+        if (ret <= 0) {
+            poll(&pfd, 1, BENCH_UART_POLL_MS);
+            continue;
+        }
+
+        if (!__stream_check(buf, ret, pos)) {
+            __atomic_store_n(&sg_peer_bad, 1, __ATOMIC_RELAXED);
+        }
+        pos += ret;
+        __atomic_store_n(&sg_peer_pos, pos, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+static void __tx_done_cb(TUYA_UART_NUM_E port_id, void *arg)
+{
+    __atomic_add_fetch(&sg_tx_done, 1, __ATOMIC_RELAXED);
+}
+
+static OPERATE_RET __uart_start(TUYA_UART_NUM_E port, uint8_t open_mode, void *(*peer)(void *))
+{
+    OPERATE_RET rt = OPRT_OK;
+    TAL_UART_CFG_T cfg = {0};
+
+    cfg.rx_buffer_size = BENCH_UART_RING;
+    cfg.tx_buffer_size = BENCH_UART_RING;
+    cfg.open_mode = open_mode;
+    cfg.base_cfg.baudrate = 921600;
+    cfg.base_cfg.databits = TUYA_UART_DATA_LEN_8BIT;
+    cfg.base_cfg.stopbits = TUYA_UART_STOP_LEN_1BIT;
+    cfg.base_cfg.parity = TUYA_UART_PARITY_TYPE_NONE;
+    cfg.base_cfg.flowctrl = TUYA_UART_FLOWCTRL_RTSCTS;
+    TUYA_CALL_ERR_RETURN(tal_uart_init(port, &cfg));
+    TUYA_CALL_ERR_RETURN(tal_uart_tx_done_cb_reg(port, __tx_done_cb, NULL));
+
+    sg_port = port;
+    sg_peer_fd = bench_uart_peer_fd(port);
+    fcntl(sg_peer_fd, F_SETFL, fcntl(sg_peer_fd, F_GETFL) | O_NONBLOCK);
+    sg_stop = 0;
+    sg_pos = 0;
+    sg_peer_pos = 0;
+    sg_peer_bad = 0;
+    sg_tx_done = 0;
+    if (0 != pthread_create(&sg_peer, NULL, peer, NULL)) {
+        tal_uart_deinit(port);
+        return OPRT_COM_ERROR;
+    }
+
+    return OPRT_OK;
+}
+
+static void __uart_stop(void)
+{
+    __atomic_store_n(&sg_stop, 1, __ATOMIC_RELAXED);
+    pthread_join(sg_peer, NULL);
+    tal_uart_deinit(sg_port);
+    sg_peer_fd = -1;
+}
+
+static OPERATE_RET __rx_run(uint32_t i)
+{
+    uint32_t got = 0;
+    int ret;
+
+    while (got < BENCH_UART_CHUNK) {
+        ret = tal_uart_read_timeout(sg_port, sg_buf + got, BENCH_UART_CHUNK - got, BENCH_UART_LOST_MS);
+        if (ret <= 0) {
+            fprintf(stderr, "uart: nothing received after byte %llu\n", (unsigned long long)(sg_pos + got));
+            return OPRT_TIMEOUT;
+        }
+        got += ret;
+    }
+
+    if (!__stream_check(sg_buf, BENCH_UART_CHUNK, sg_pos)) {
+        return OPRT_COM_ERROR;
+    }
+    sg_pos += BENCH_UART_CHUNK;
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __tx_run(uint32_t i)
+{
+    __stream_fill(sg_buf, BENCH_UART_CHUNK, sg_pos);
+    if (BENCH_UART_CHUNK != tal_uart_write(sg_port, sg_buf, BENCH_UART_CHUNK)) {
+        return OPRT_COM_ERROR;
+    }
+    sg_pos += BENCH_UART_CHUNK;
+
+    return __atomic_load_n(&sg_peer_bad, __ATOMIC_RELAXED) ? OPRT_COM_ERROR : OPRT_OK;
+}
+
+// waits until the peer has every byte written so far
+static OPERATE_RET __tx_drain(bool async)
+{
+    SYS_TIME_T start = tal_system_get_millisecond();
+
+    while (__atomic_load_n(&sg_peer_pos, __ATOMIC_ACQUIRE) < sg_pos ||
+           (async && 0 == __atomic_load_n(&sg_tx_done, __ATOMIC_RELAXED))) {
+        if (tal_system_get_millisecond() - start > BENCH_UART_LOST_MS) {
+            fprintf(stderr, "uart: peer got %llu of %llu bytes\n",
+                    (unsigned long long)__atomic_load_n(&sg_peer_pos, __ATOMIC_ACQUIRE), (unsigned long long)sg_pos);
+            return OPRT_TIMEOUT;
+        }
+        tal_system_sleep(1);
+    }
+
+    return __atomic_load_n(&sg_peer_bad, __ATOMIC_RELAXED) ? OPRT_COM_ERROR : OPRT_OK;
+}
+
+static OPERATE_RET __stress(OPERATE_RET (*run)(uint32_t i))
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t i;
+
+    for (i = 0; i < BENCH_UART_STRESS / BENCH_UART_CHUNK; i++) {
+        TUYA_CALL_ERR_RETURN(run(i));
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __rx_setup(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    TUYA_CALL_ERR_RETURN(__uart_start(TUYA_UART_NUM_0, O_BLOCK | O_FLOW_CTRL, __peer_send_task));
+    rt = __stress(__rx_run);
+    if (OPRT_OK != rt) {
+        __uart_stop();
+    }
+
+    return rt;
+}
+
+static OPERATE_RET __tx_setup_mode(TUYA_UART_NUM_E port, uint8_t open_mode)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    TUYA_CALL_ERR_RETURN(__uart_start(port, open_mode, __peer_recv_task));
+    rt = __stress(__tx_run);
+    if (OPRT_OK == rt) {
+        rt = __tx_drain(open_mode & O_ASYNC_WRITE);
+    }
+    if (OPRT_OK != rt) {
+        __uart_stop();
+    }
+
+    return rt;
+}
+
+static OPERATE_RET __tx_setup(void)
+{
+    return __tx_setup_mode(TUYA_UART_NUM_1, O_BLOCK);
+}
+
+static OPERATE_RET __tx_async_setup(void)
+{
+    return __tx_setup_mode(TUYA_UART_NUM_2, O_BLOCK | O_ASYNC_WRITE);
+}
+
+static const BENCH_CASE_T sg_uart_cases[] = {
+    {"uart_pty_rx", 256, BENCH_UART_CHUNK, __rx_setup, __rx_run, __uart_stop},
+    {"uart_pty_tx", 256, BENCH_UART_CHUNK, __tx_setup, __tx_run, __uart_stop},
+    {"uart_pty_tx_async", 256, BENCH_UART_CHUNK, __tx_async_setup, __tx_run, __uart_stop},
+};
+
+const BENCH_CASE_T *bench_uart_cases_get(uint32_t *num)
+{
+    *num = CNTSOF(sg_uart_cases);
+
+    return sg_uart_cases;
+}
@@ -0,0 +1,161 @@
+/**
+ * @file bench_cases_voice.c
+ * @brief Benchmarks of the encoding of voice upload chunks.
+ *
+ * One operation uploads a second of 16 kHz 16 bit audio in 20 ms chunks, so
+ * allocs/op is the allocations per second of audio. Each chunk is a
+ * Speech__Request framed as a websocket binary frame, sent through the
+ * socket layer of bench_cases_tal.c which drops it.
+ *
+ * voice_upload_pack_1s is the protobuf-c path: speech__request__pack into a
+ * buffer allocated per chunk, copied again by websocket_send_frame.
+ * voice_upload_writer_1s writes the request with PB_ENC_WRITER_S after the
+ * room of the websocket header in one reused frame and sends it with
+ * websocket_send_frame_inplace, the audio is copied once.
+ *
+ * Both cases count the bytes written by the copies of their path, the
+ * encoding of the request and the copy of the frame by the websocket layer,
+ * and print the bytes copied per chunk once the case is over.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tuya_cloud_types.h"
+#include "tal_api.h"
+#include "protobuf_utils.h"
+#include "aispeech.pb-c.h"
+#include "websocket_frame.h"
+#include "bench.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define BENCH_VOICE_CHUNK      640 // 20 ms
+#define BENCH_VOICE_CHUNKS     50
+#define BENCH_VOICE_REQUEST_ID "5d41402abc4b2a76b9719d911017c592"
+#define BENCH_VOICE_TYPE       "ASR_MID"
+
+/* Speech__Request field numbers, as in tuya_voice_protocol_ws.c */
+#define BENCH_VOICE_FIELD_REQUESTID 1
+#define BENCH_VOICE_FIELD_TYPE      3
+#define BENCH_VOICE_FIELD_BLOCK     5
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static WEBSOCKET_S sg_voice_ws;
+static uint8_t sg_voice_audio[BENCH_VOICE_CHUNK * BENCH_VOICE_CHUNKS];
+static uint8_t *sg_voice_frame = NULL;
+static uint32_t sg_voice_frame_size = 0;
+static uint64_t sg_voice_copied = 0;
+static uint64_t sg_voice_chunks = 0;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+// the masked header websocket_format_frame_header writes for a payload
+static uint32_t __ws_head_len(size_t len)
+{
+    return ((len < 126) ? 2 : 4) + WS_MASKING_KEY_SIZE;
+}
+
+static OPERATE_RET __voice_setup(void)
+{
+    memset(&sg_voice_ws, 0, sizeof(sg_voice_ws));
+    bench_data_fill(sg_voice_audio, sizeof(sg_voice_audio), 41);
+    sg_voice_copied = 0;
+    sg_voice_chunks = 0;
+
+    // what tuya_voice_proto_ws_upload_send keeps for a session
+    sg_voice_frame_size = WS_FRAME_SEND_HEADER_SIZE + 3 * PB_ENC_LEN_HEAD_MAX + strlen(BENCH_VOICE_REQUEST_ID) +
+                          strlen(BENCH_VOICE_TYPE) + BENCH_VOICE_CHUNK;
+    sg_voice_frame = tal_malloc(sg_voice_frame_size);
+    if (NULL == sg_voice_frame) {
+        return OPRT_MALLOC_FAILED;
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __voice_pack_run(uint32_t i)
+{
+    OPERATE_RET rt = OPRT_OK;
+    Speech__Request req;
+    uint8_t *enc_buf = NULL;
+    size_t enc_len;
+    uint32_t c;
+
+    speech__request__init(&req);
+    req.requestid = BENCH_VOICE_REQUEST_ID;
+    req.type = BENCH_VOICE_TYPE;
+    for (c = 0; c < BENCH_VOICE_CHUNKS && OPRT_OK == rt; c++) {
+        req.block.len = BENCH_VOICE_CHUNK;
+        req.block.data = sg_voice_audio + c * BENCH_VOICE_CHUNK;
+
+        enc_len = speech__request__get_packed_size(&req);
+        enc_buf = tal_malloc(enc_len);
+        if (NULL == enc_buf) {
+            return OPRT_MALLOC_FAILED;
+        }
+        speech__request__pack(&req, enc_buf);
+        rt = websocket_send_frame(&sg_voice_ws, WS_FRAME_TYPE_BINARY, enc_buf, enc_len, TRUE, TRUE);
+        tal_free(enc_buf);
+        // packed into enc_buf, then copied after the header into the frame
+        sg_voice_copied += enc_len + __ws_head_len(enc_len) + enc_len;
+        sg_voice_chunks++;
+    }
+
+    return rt;
+}
+
+static OPERATE_RET __voice_writer_run(uint32_t i)
+{
+    OPERATE_RET rt = OPRT_OK;
+    PB_ENC_WRITER_S writer;
+    uint32_t c;
+
+    for (c = 0; c < BENCH_VOICE_CHUNKS; c++) {
+        pb_enc_writer_init(&writer, sg_voice_frame + WS_FRAME_SEND_HEADER_SIZE,
+                           sg_voice_frame_size - WS_FRAME_SEND_HEADER_SIZE);
+        TUYA_CALL_ERR_RETURN(pb_enc_write_string(&writer, BENCH_VOICE_FIELD_REQUESTID, BENCH_VOICE_REQUEST_ID));
+        TUYA_CALL_ERR_RETURN(pb_enc_write_string(&writer, BENCH_VOICE_FIELD_TYPE, BENCH_VOICE_TYPE));
+        TUYA_CALL_ERR_RETURN(pb_enc_write_bytes(&writer, BENCH_VOICE_FIELD_BLOCK, sg_voice_audio + c * BENCH_VOICE_CHUNK,
+                                                BENCH_VOICE_CHUNK));
+        TUYA_CALL_ERR_RETURN(
+            websocket_send_frame_inplace(&sg_voice_ws, WS_FRAME_TYPE_BINARY, sg_voice_frame, writer.len));
+        // written into the frame, only the header is copied in front of it
+        sg_voice_copied += writer.len + __ws_head_len(writer.len);
+        sg_voice_chunks++;
+    }
+
+    return OPRT_OK;
+}
+
+static void __voice_teardown(void)
+{
+    if (sg_voice_chunks) {
+        printf("voice: %llu bytes copied per chunk of %u audio bytes\n",
+               (unsigned long long)(sg_voice_copied / sg_voice_chunks), BENCH_VOICE_CHUNK);
+    }
+    tal_free(sg_voice_frame);
+    sg_voice_frame = NULL;
+    sg_voice_frame_size = 0;
+}
+
+static const BENCH_CASE_T sg_voice_cases[] = {
+    {"voice_upload_pack_1s", 2000, BENCH_VOICE_CHUNK * BENCH_VOICE_CHUNKS, __voice_setup, __voice_pack_run,
+     __voice_teardown},
+    {"voice_upload_writer_1s", 2000, BENCH_VOICE_CHUNK * BENCH_VOICE_CHUNKS, __voice_setup, __voice_writer_run,
+     __voice_teardown},
+};
+
+const BENCH_CASE_T *bench_voice_cases_get(uint32_t *num)
+{
+    *num = CNTSOF(sg_voice_cases);
+
+    return sg_voice_cases;
+}
@@ -0,0 +1,127 @@
+/**
+ * @file bench_cases_workq.c
+ * @brief Benchmarks of the queueing latency of tal_workqueue.
+ *
+ * One operation schedules a short work and waits for it, its latency is the
+ * time from the schedule to the start of the callback. Every
+ * BENCH_WORKQ_SLOW_EVERY operations a slow work of BENCH_WORKQ_SLOW_US is
+ * scheduled first at low priority, unless the last one still runs. On the
+ * single thread queue the short work that follows waits behind it, on the
+ * multi-worker queue another worker takes it, which shows in the p99.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tuya_cloud_types.h"
+#include "tal_log.h"
+#include "tal_semaphore.h"
+#include "tal_workqueue.h"
+#include "bench.h"
+#include "bench_port.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define BENCH_WORKQ_LEN        64
+#define BENCH_WORKQ_WORKERS    2
+#define BENCH_WORKQ_SLOW_EVERY 64
+#define BENCH_WORKQ_SLOW_US    300
+#define BENCH_WORKQ_WAIT_MS    1000 // a work not run by then is lost
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static WORKQUEUE_HANDLE sg_workq = NULL;
+static SEM_HANDLE sg_done = NULL;
+static uint64_t sg_scheduled_ns;
+static BOOL_T sg_slow_busy = FALSE;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static void __short_work(void *data)
+{
+    bench_latency_record(bench_time_ns() - sg_scheduled_ns);
+    tal_semaphore_post(sg_done);
+}
+
+static void __slow_work(void *data)
+{
+    uint64_t end = bench_time_ns() + BENCH_WORKQ_SLOW_US * 1000ULL;
+
+    // busy like a work parsing or signing, not sleeping
+    while (bench_time_ns() < end) {
+    }
+    __atomic_store_n(&sg_slow_busy, FALSE, __ATOMIC_RELEASE);
+}
+
+static OPERATE_RET __workq_setup(uint8_t worker_num)
+{
+    OPERATE_RET rt = OPRT_OK;
+    THREAD_CFG_T cfg = {.stackDepth = 4096, .priority = THREAD_PRIO_2, .thrdname = "bench_wq"};
+
+    TUYA_CALL_ERR_RETURN(tal_semaphore_create_init(&sg_done, 0, 1));
+    if (worker_num > 1) {
+        rt = tal_workqueue_create_multi(BENCH_WORKQ_LEN, worker_num, &cfg, &sg_workq);
+    } else {
+        rt = tal_workqueue_create(BENCH_WORKQ_LEN, &cfg, &sg_workq);
+    }
+    if (OPRT_OK != rt) {
+        tal_semaphore_release(sg_done);
+        sg_done = NULL;
+    }
+
+    return rt;
+}
+
+static OPERATE_RET __single_setup(void)
+{
+    return __workq_setup(1);
+}
+
+static OPERATE_RET __multi_setup(void)
+{
+    return __workq_setup(BENCH_WORKQ_WORKERS);
+}
+
+static OPERATE_RET __latency_run(uint32_t i)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    // the other workers take the short works faster than the slow ones run,
+    // they would fill the queue if scheduled regardless
+    if (0 == i % BENCH_WORKQ_SLOW_EVERY && !__atomic_exchange_n(&sg_slow_busy, TRUE, __ATOMIC_ACQ_REL)) {
+        TUYA_CALL_ERR_RETURN(tal_workqueue_schedule_prio(sg_workq, WORKQUEUE_PRIO_LOW, __slow_work, NULL));
+    }
+
+    sg_scheduled_ns = bench_time_ns();
+    TUYA_CALL_ERR_RETURN(tal_workqueue_schedule_prio(sg_workq, WORKQUEUE_PRIO_HIGH, __short_work, NULL));
+
+    return tal_semaphore_wait(sg_done, BENCH_WORKQ_WAIT_MS);
+}
+
+static void __workq_teardown(void)
+{
+    tal_workqueue_flush(sg_workq, NULL, NULL);
+    tal_workqueue_release(sg_workq);
+    sg_slow_busy = FALSE;
+    sg_workq = NULL;
+    tal_semaphore_release(sg_done);
+    sg_done = NULL;
+}
+
+static const BENCH_CASE_T sg_workq_cases[] = {
+    {"workq_single_latency", 4096, 0, __single_setup, __latency_run, __workq_teardown},
+    {"workq_multi2_latency", 4096, 0, __multi_setup, __latency_run, __workq_teardown},
+};
+
+const BENCH_CASE_T *bench_workq_cases_get(uint32_t *num)
+{
+    *num = CNTSOF(sg_workq_cases);
+
+    return sg_workq_cases;
+}
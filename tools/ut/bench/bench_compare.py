@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Compares a tuya_bench result with the checked-in baseline.
+
+usage: bench_compare.py BASELINE RESULT [--update] [--allow-missing]
+
+A case regresses when:
+  ops_per_sec   drops below baseline * (1 - threshold)
+  allocs_per_op rises above baseline * (1 + threshold)
+  peak_heap     rises above baseline * (1 + threshold)
+  p99_us        rises above baseline * (1 + threshold), for the cases
+                recording a latency
+  leak_bytes    is not 0
+The thresholds of the baseline apply to every case, a case may override
+them with its own "thresholds". allocs_per_op and peak_heap are exact on
+every host, the ops_per_sec default is loose enough for a shared CI runner
+and is worth tightening in the baseline of a quiet machine, so is the p99_us
+one.
+
+A case of the result without a baseline fails, so does a case of the
+baseline missing from the result unless --allow-missing, which is meant for
+--filter runs. The cases listed in "tal_cases" of the baseline need the
+littlefs and cJSON submodules: a result built without them ("with_tal": 0)
+skips them, a result built with them must find them in the baseline.
+--update writes the result into the baseline and keeps the thresholds and
+"tal_cases".
+"""
+
+import argparse
+import json
+import sys
+
+METRICS = ("ops_per_sec", "allocs_per_op", "peak_heap")
+LATENCY_METRICS = ("p99_us",)
+DEFAULT_THRESHOLDS = {"ops_per_sec": 0.5, "allocs_per_op": 0.0, "peak_heap": 0.10, "p99_us": 1.0}
+
+
+def load(path):
+    with open(path, "r", encoding="utf-8") as f:
+        return json.load(f)
+
+
+def check_case(name, base, result, thresholds):
+    """Returns the regressions and the notes of a case."""
+    limits = dict(thresholds)
+    limits.update(base.get("thresholds", {}))
+    fails, notes = [], []
+
+    ops, base_ops = result["ops_per_sec"], base["ops_per_sec"]
+    if ops < base_ops * (1 - limits["ops_per_sec"]):
+        fails.append("ops/s %.1f < %.1f (-%.0f%%)" % (ops, base_ops, 100 * (1 - ops / base_ops)))
+    elif ops > base_ops * (1 + limits["ops_per_sec"]):
+        notes.append("ops/s %.1f > %.1f, consider --update" % (ops, base_ops))
+
+    for metric in ("allocs_per_op", "peak_heap"):
+        value, base_value = result[metric], base[metric]
+        # 1e-9 absorbs the rounding of the JSON output
+        if value > base_value * (1 + limits[metric]) + 1e-9:
+            fails.append("%s %s > %s" % (metric, value, base_value))
+        elif value < base_value:
+            notes.append("%s %s < %s, consider --update" % (metric, value, base_value))
+
+    for metric in LATENCY_METRICS:
+        if metric not in base:
+            continue
+        value, base_value = result.get(metric, 0), base[metric]
+        if value > base_value * (1 + limits[metric]):
+            fails.append("%s %.1f > %.1f" % (metric, value, base_value))
+        elif 0 == value:
+            fails.append("%s not recorded" % metric)
+
+    if result.get("leak_bytes", 0) != 0:
+        fails.append("leaks %d bytes" % result["leak_bytes"])
+
+    return fails, notes
+
+
+def update(baseline_path, baseline, results):
+    cases = baseline.setdefault("cases", {})
+    for name, result in results["cases"].items():
+        entry = cases.setdefault(name, {})
+        for metric in METRICS:
+            entry[metric] = result[metric]
+        for metric in LATENCY_METRICS:
+            if metric in result:
+                entry[metric] = result[metric]
+    baseline.setdefault("version", 1)
+    baseline.setdefault("thresholds", DEFAULT_THRESHOLDS)
+    with open(baseline_path, "w", encoding="utf-8") as f:
+        json.dump(baseline, f, indent=2, sort_keys=True)
+        f.write("\n")
+    print("[BENCH] baseline %s updated with %d cases" % (baseline_path, len(results["cases"])))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare tuya_bench results with a baseline.")
+    parser.add_argument("baseline")
+    parser.add_argument("result")
+    parser.add_argument("--update", action="store_true", help="write the result into the baseline")
+    parser.add_argument("--allow-missing", action="store_true", help="do not fail on cases missing from the result, for --filter runs")
+    args = parser.parse_args()
+
+    results = load(args.result)
+    try:
+        baseline = load(args.baseline)
+    except FileNotFoundError:
+        baseline = {}
+
+    if args.update:
+        update(args.baseline, baseline, results)
+        return 0
+
+    thresholds = dict(DEFAULT_THRESHOLDS)
+    thresholds.update(baseline.get("thresholds", {}))
+    base_cases = baseline.get("cases", {})
+    tal_cases = set(baseline.get("tal_cases", []))
+    with_tal = results.get("with_tal", 1)
+    failed = 0
+
+    for name, result in results["cases"].items():
+        if name not in base_cases:
+            failed += 1
+            print("[BENCH] %-22s FAIL  no baseline, run bench_update" % name)
+            continue
+        fails, notes = check_case(name, base_cases[name], result, thresholds)
+        if fails:
+            failed += 1
+            print("[BENCH] %-22s FAIL  %s" % (name, "; ".join(fails)))
+        else:
+            print("[BENCH] %-22s OK    %s" % (name, "; ".join(notes)))
+
+    for name in sorted((set(base_cases) | tal_cases) - set(results["cases"])):
+        if name in tal_cases and not with_tal:
+            print("[BENCH] %-22s SKIP  built without littlefs and cJSON" % name)
+            continue
+        print("[BENCH] %-22s MISSING" % name)
+        if not args.allow_missing:
+            failed += 1
+
+    if failed:
+        print("[BENCH] %d case(s) regressed" % failed)
+        return 1
+
+    print("[BENCH] no regression")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
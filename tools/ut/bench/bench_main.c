@@ -0,0 +1,294 @@
+/**
+ * @file bench_main.c
+ * @brief Runner of the host benchmarks.
+ *
+ * usage: tuya_bench [--rounds N] [--filter TEXT] [--json FILE] [--list]
+ *
+ * Every case is warmed up once, then measured --rounds times. The table goes
+ * to stdout, --json writes the results in the format read by
+ * bench_compare.py. A case recording latencies also gets the 99th percentile
+ * of its best round.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tuya_cloud_types.h"
+#include "tal_memory.h"
+#include "mbedtls/platform.h"
+#include "bench.h"
+#include "bench_port.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define BENCH_ROUNDS_DEF  5
+#define BENCH_LATENCY_MAX 65536
+
+#if defined(BENCH_WITH_TAL) && (BENCH_WITH_TAL == 1)
+#define BENCH_TAL_BUILT 1
+#else
+#define BENCH_TAL_BUILT 0
+#endif
+
+typedef struct {
+    double ops_per_sec;
+    double mb_per_sec;
+    double allocs_per_op;
+    size_t peak_heap; // heap peak of a round above the heap in use before it
+    long leak_bytes;  // heap still in use after teardown
+    double p99_us;    // 0 if the case records no latency
+} BENCH_RESULT_T;
+
+typedef const BENCH_CASE_T *(*BENCH_GROUP_GET)(uint32_t *num);
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static const BENCH_GROUP_GET sg_groups[] = {
+    bench_core_cases_get,
+    bench_mbox_cases_get,
+    bench_eth_cases_get,
+    bench_uart_cases_get,
+    bench_http_cases_get,
+    bench_mqtt_cases_get,
+    bench_aes_cases_get,
+    bench_cli_cases_get,
+    bench_touch_cases_get,
+    bench_mqtt_recv_cases_get,
+    bench_encoder_cases_get,
+    bench_ota_cases_get,
+    bench_workq_cases_get,
+#if defined(BENCH_WITH_TAL) && (BENCH_WITH_TAL == 1)
+    bench_tal_cases_get,
+    bench_voice_cases_get,
+#endif
+};
+
+static uint64_t sg_latency[BENCH_LATENCY_MAX];
+static uint32_t sg_latency_num;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+void bench_latency_record(uint64_t ns)
+{
+    if (sg_latency_num < BENCH_LATENCY_MAX) {
+        sg_latency[sg_latency_num++] = ns;
+    }
+}
+
+static int __latency_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+// p99 of the latencies recorded since the last call, in us
+static double __latency_p99(void)
+{
+    double p99;
+
+    if (0 == sg_latency_num) {
+        return 0;
+    }
+    qsort(sg_latency, sg_latency_num, sizeof(uint64_t), __latency_cmp);
+    p99 = sg_latency[(sg_latency_num - 1) * 99 / 100] / 1000.0;
+    sg_latency_num = 0;
+
+    return p99;
+}
+
+void bench_data_fill(uint8_t *buf, uint32_t len, uint32_t seed)
+{
+    uint32_t i;
+
+    for (i = 0; i < len; i++) {
+        seed = seed * 1664525 + 1013904223;
+        buf[i] = (uint8_t)(seed >> 24);
+    }
+}
+
+static OPERATE_RET __round_run(const BENCH_CASE_T *bcase, uint32_t ops)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t i;
+
+    for (i = 0; i < ops; i++) {
+        rt = bcase->run(i);
+        if (OPRT_OK != rt) {
+            fprintf(stderr, "%s: op %u failed %d\n", bcase->name, i, rt);
+            return rt;
+        }
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __case_run(const BENCH_CASE_T *bcase, uint32_t rounds, BENCH_RESULT_T *result)
+{
+    double ops_per_sec = 0, p99_us = 0, p99;
+    BENCH_HEAP_STAT_T before, start, end;
+    uint64_t t0, t1, allocs = 0;
+    size_t peak = 0;
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t r;
+
+    memset(result, 0, sizeof(BENCH_RESULT_T));
+    bench_heap_stat_get(&before);
+
+    if (bcase->setup) {
+        rt = bcase->setup();
+        if (OPRT_OK != rt) {
+            fprintf(stderr, "%s: setup failed %d\n", bcase->name, rt);
+            return rt;
+        }
+    }
+
+    // warm up the caches and the lazy allocations of the module
+    rt = __round_run(bcase, bcase->ops / 8 + 1);
+    __latency_p99();
+
+    for (r = 0; r < rounds && OPRT_OK == rt; r++) {
+        bench_heap_stat_get(&start);
+        bench_heap_peak_reset();
+        t0 = bench_time_ns();
+        rt = __round_run(bcase, bcase->ops);
+        t1 = bench_time_ns();
+        bench_heap_stat_get(&end);
+
+        ops_per_sec = MAX(ops_per_sec, (double)bcase->ops * 1e9 / (double)(t1 - t0 ? t1 - t0 : 1));
+        allocs = MAX(allocs, end.alloc_cnt - start.alloc_cnt);
+        peak = MAX(peak, end.peak_bytes - start.cur_bytes);
+        p99 = __latency_p99();
+        if (p99 > 0 && (0 == p99_us || p99 < p99_us)) {
+            p99_us = p99;
+        }
+    }
+
+    if (bcase->teardown) {
+        bcase->teardown();
+    }
+    if (OPRT_OK != rt) {
+        return rt;
+    }
+
+    bench_heap_stat_get(&end);
+    result->ops_per_sec = ops_per_sec;
+    result->mb_per_sec = result->ops_per_sec * bcase->bytes / (1024.0 * 1024.0);
+    result->allocs_per_op = (double)allocs / bcase->ops;
+    result->peak_heap = peak;
+    result->leak_bytes = (long)end.cur_bytes - (long)before.cur_bytes;
+    result->p99_us = p99_us;
+
+    return OPRT_OK;
+}
+
+static void __json_write(FILE *fp, const BENCH_CASE_T *bcase, BENCH_RESULT_T *result, bool first)
+{
+    fprintf(fp, "%s\n    \"%s\": {\"ops_per_sec\": %.1f, \"mb_per_sec\": %.2f, \"allocs_per_op\": %.3f, "
+                "\"peak_heap\": %zu, \"leak_bytes\": %ld",
+            first ? "" : ",", bcase->name, result->ops_per_sec, result->mb_per_sec, result->allocs_per_op,
+            result->peak_heap, result->leak_bytes);
+    if (result->p99_us > 0) {
+        fprintf(fp, ", \"p99_us\": %.1f", result->p99_us);
+    }
+    fprintf(fp, "}");
+}
+
+static void __usage(const char *prog)
+{
+    printf("usage: %s [--rounds N] [--filter TEXT] [--json FILE] [--list]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    const BENCH_CASE_T *groups[CNTSOF(sg_groups)];
+    uint32_t group_num[CNTSOF(sg_groups)] = {0};
+    const char *filter = NULL, *json = NULL;
+    uint32_t rounds = BENCH_ROUNDS_DEF;
+    bool list = false, first = true;
+    BENCH_RESULT_T result;
+    FILE *fp = NULL;
+    int failed = 0;
+    uint32_t g, i;
+
+    for (i = 1; i < (uint32_t)argc; i++) {
+        if (0 == strcmp(argv[i], "--rounds") && i + 1 < (uint32_t)argc) {
+            rounds = (uint32_t)atoi(argv[++i]);
+        } else if (0 == strcmp(argv[i], "--filter") && i + 1 < (uint32_t)argc) {
+            filter = argv[++i];
+        } else if (0 == strcmp(argv[i], "--json") && i + 1 < (uint32_t)argc) {
+            json = argv[++i];
+        } else if (0 == strcmp(argv[i], "--list")) {
+            list = true;
+        } else {
+            __usage(argv[0]);
+            return 2;
+        }
+    }
+    if (0 == rounds) {
+        fprintf(stderr, "rounds must be at least 1\n");
+        return 2;
+    }
+
+    // the SDK routes the mbedtls heap through TAL, see tuya_tls_init
+    mbedtls_platform_set_calloc_free(tal_calloc, tal_free);
+    bench_flash_erase_all();
+
+    for (g = 0; g < CNTSOF(sg_groups); g++) {
+        groups[g] = sg_groups[g](&group_num[g]);
+    }
+
+    if (json) {
+        fp = fopen(json, "w");
+        if (NULL == fp) {
+            perror(json);
+            return 2;
+        }
+        // bench_compare.py skips the tal_cases of the baseline when they are not built
+        fprintf(fp, "{\n  \"version\": 1,\n  \"rounds\": %u,\n  \"with_tal\": %d,\n  \"cases\": {", rounds,
+                BENCH_TAL_BUILT);
+    }
+
+    if (!list) {
+        printf("%-22s %14s %10s %10s %10s %8s %10s\n", "case", "ops/s", "MB/s", "allocs/op", "peak heap", "leak",
+               "p99 us");
+    }
+    for (g = 0; g < CNTSOF(groups); g++) {
+        for (i = 0; i < group_num[g]; i++) {
+            const BENCH_CASE_T *bcase = &groups[g][i];
+            if (filter && NULL == strstr(bcase->name, filter)) {
+                continue;
+            }
+            if (list) {
+                printf("%s\n", bcase->name);
+                continue;
+            }
+
+            if (OPRT_OK != __case_run(bcase, rounds, &result)) {
+                printf("%-22s %14s\n", bcase->name, "FAILED");
+                failed++;
+                continue;
+            }
+            printf("%-22s %14.1f %10.2f %10.3f %10zu %8ld %10.1f\n", bcase->name, result.ops_per_sec,
+                   result.mb_per_sec, result.allocs_per_op, result.peak_heap, result.leak_bytes, result.p99_us);
+            if (fp) {
+                __json_write(fp, bcase, &result, first);
+                first = false;
+            }
+        }
+    }
+
+    if (fp) {
+        fprintf(fp, "\n  }\n}\n");
+        fclose(fp);
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,447 @@
+/**
+ * @file bench_port.c
+ * @brief Host port of the benchmark runner.
+ *
+ * Only the TKL interfaces reached by the benchmarked modules are provided.
+ * The queue, semaphore and thread ones come from the Linux porting template,
+ * the UART is the pty one of bench_uart.c and the transporter the socket one
+ * of bench_transport.c. The OTA ones are referenced by tal_api.c but never
+ * used by a benchmark, they fail with OPRT_NOT_SUPPORTED. The files of
+ * tal_fs are those of the host.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "tuya_cloud_types.h"
+#include "tkl_system.h"
+#include "tkl_memory.h"
+#include "tkl_mutex.h"
+#include "tkl_flash.h"
+#include "tkl_ota.h"
+#include "tal_log.h"
+#include "tal_event.h"
+#include "tal_fs.h"
+#include "tuya_tls.h"
+#include "bench_port.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+// keeps the returned pointers aligned like malloc does
+#define BENCH_HEAP_HDR 16
+#define BENCH_EVENT_MAX 8
+
+typedef struct {
+    const char *name;
+    EVENT_SUBSCRIBE_CB cb;
+} BENCH_EVENT_SUB_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static BENCH_HEAP_STAT_T sg_heap;
+static uint8_t sg_flash[BENCH_FLASH_SIZE];
+static uint32_t sg_rand_seed = 0x5EED;
+// the interrupts of the host UART are threads, a critical section locks them out
+static pthread_mutex_t sg_critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static BENCH_EVENT_SUB_T sg_event_sub[BENCH_EVENT_MAX];
+static bool sg_clock_frozen = false;
+static SYS_TIME_T sg_clock_ms;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static void __heap_add(size_t size)
+{
+    sg_heap.alloc_cnt++;
+    sg_heap.cur_bytes += size;
+    if (sg_heap.cur_bytes > sg_heap.peak_bytes) {
+        sg_heap.peak_bytes = sg_heap.cur_bytes;
+    }
+}
+
+void bench_heap_stat_get(BENCH_HEAP_STAT_T *stat)
+{
+    *stat = sg_heap;
+}
+
+void bench_heap_peak_reset(void)
+{
+    sg_heap.peak_bytes = sg_heap.cur_bytes;
+}
+
+uint64_t bench_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void bench_clock_freeze(SYS_TIME_T now_ms)
+{
+    sg_clock_ms = now_ms;
+    sg_clock_frozen = true;
+}
+
+void bench_clock_advance(SYS_TIME_T ms)
+{
+    sg_clock_ms += ms;
+}
+
+void bench_clock_release(void)
+{
+    sg_clock_frozen = false;
+}
+
+void bench_flash_erase_all(void)
+{
+    memset(sg_flash, 0xFF, sizeof(sg_flash));
+}
+
+void *tkl_system_malloc(size_t size)
+{
+    uint8_t *ptr = malloc(size + BENCH_HEAP_HDR);
+    if (NULL == ptr) {
+        return NULL;
+    }
+
+    *(size_t *)ptr = size;
+    __heap_add(size);
+
+    return ptr + BENCH_HEAP_HDR;
+}
+
+void tkl_system_free(void *ptr)
+{
+    uint8_t *hdr = NULL;
+
+    if (NULL == ptr) {
+        return;
+    }
+
+    hdr = (uint8_t *)ptr - BENCH_HEAP_HDR;
+    sg_heap.free_cnt++;
+    sg_heap.cur_bytes -= *(size_t *)hdr;
+    free(hdr);
+}
+
+void *tkl_system_calloc(size_t nitems, size_t size)
+{
+    void *ptr = tkl_system_malloc(nitems * size);
+    if (ptr) {
+        memset(ptr, 0, nitems * size);
+    }
+
+    return ptr;
+}
+
+void *tkl_system_realloc(void *ptr, size_t size)
+{
+    uint8_t *hdr = NULL;
+    size_t old = 0;
+
+    if (NULL == ptr) {
+        return tkl_system_malloc(size);
+    }
+
+    hdr = (uint8_t *)ptr - BENCH_HEAP_HDR;
+    old = *(size_t *)hdr;
+    hdr = realloc(hdr, size + BENCH_HEAP_HDR);
+    if (NULL == hdr) {
+        return NULL;
+    }
+
+    *(size_t *)hdr = size;
+    sg_heap.cur_bytes -= old;
+    __heap_add(size);
+
+    return hdr + BENCH_HEAP_HDR;
+}
+
+int tkl_system_get_free_heap_size(void)
+{
+    return 0x7FFFFFFF - (int)sg_heap.cur_bytes;
+}
+
+void tkl_system_reset(void)
+{
+    abort();
+}
+
+SYS_TICK_T tkl_system_get_tick_count(void)
+{
+    return (SYS_TICK_T)tkl_system_get_millisecond();
+}
+
+SYS_TIME_T tkl_system_get_millisecond(void)
+{
+    if (sg_clock_frozen) {
+        return sg_clock_ms;
+    }
+
+    return (SYS_TIME_T)(bench_time_ns() / 1000000);
+}
+
+int tkl_system_get_random(uint32_t range)
+{
+    // fixed sequence, every run sees the same data
+    sg_rand_seed = sg_rand_seed * 1103515245 + 12345;
+
+    return range ? (int)((sg_rand_seed >> 8) % range) : 0;
+}
+
+uint32_t tkl_system_enter_critical(void)
+{
+    pthread_mutex_lock(&sg_critical);
+
+    return 0;
+}
+
+void tkl_system_exit_critical(uint32_t irq_mask)
+{
+    pthread_mutex_unlock(&sg_critical);
+}
+
+TUYA_RESET_REASON_E tkl_system_get_reset_reason(char **describe)
+{
+    return TUYA_RESET_REASON_UNKNOWN;
+}
+
+void tkl_system_sleep(uint32_t num_ms)
+{
+    struct timespec ts = {num_ms / 1000, (num_ms % 1000) * 1000000};
+
+    nanosleep(&ts, NULL);
+}
+
+OPERATE_RET tkl_system_get_cpu_info(TUYA_CPU_INFO_T **cpu_ary, int *cpu_cnt)
+{
+    return OPRT_NOT_SUPPORTED;
+}
+
+OPERATE_RET tkl_mutex_create_init(TKL_MUTEX_HANDLE *pMutexHandle)
+{
+    pthread_mutex_t *mutex = malloc(sizeof(pthread_mutex_t));
+    if (NULL == mutex) {
+        return OPRT_MALLOC_FAILED;
+    }
+
+    pthread_mutex_init(mutex, NULL);
+    *pMutexHandle = mutex;
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tkl_mutex_lock(const TKL_MUTEX_HANDLE mutexHandle)
+{
+    return pthread_mutex_lock((pthread_mutex_t *)mutexHandle) ? OPRT_COM_ERROR : OPRT_OK;
+}
+
+OPERATE_RET tkl_mutex_trylock(const TKL_MUTEX_HANDLE mutexHandle)
+{
+    return pthread_mutex_trylock((pthread_mutex_t *)mutexHandle) ? OPRT_COM_ERROR : OPRT_OK;
+}
+
+OPERATE_RET tkl_mutex_unlock(const TKL_MUTEX_HANDLE mutexHandle)
+{
+    return pthread_mutex_unlock((pthread_mutex_t *)mutexHandle) ? OPRT_COM_ERROR : OPRT_OK;
+}
+
+OPERATE_RET tkl_mutex_release(const TKL_MUTEX_HANDLE mutexHandle)
+{
+    pthread_mutex_destroy((pthread_mutex_t *)mutexHandle);
+    free(mutexHandle);
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tkl_flash_read(uint32_t addr, uint8_t *dst, uint32_t size)
+{
+    if (addr + size > BENCH_FLASH_SIZE) {
+        return OPRT_INVALID_PARM;
+    }
+    memcpy(dst, sg_flash + addr, size);
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tkl_flash_write(uint32_t addr, const uint8_t *src, uint32_t size)
+{
+    uint32_t i;
+
+    if (addr + size > BENCH_FLASH_SIZE) {
+        return OPRT_INVALID_PARM;
+    }
+    // nor flash only clears bits
+    for (i = 0; i < size; i++) {
+        sg_flash[addr + i] &= src[i];
+    }
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tkl_flash_erase(uint32_t addr, uint32_t size)
+{
+    if (addr + size > BENCH_FLASH_SIZE) {
+        return OPRT_INVALID_PARM;
+    }
+    memset(sg_flash + addr, 0xFF, size);
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tkl_flash_lock(uint32_t addr, uint32_t size)
+{
+    return OPRT_OK;
+}
+
+OPERATE_RET tkl_flash_unlock(uint32_t addr, uint32_t size)
+{
+    return OPRT_OK;
+}
+
+OPERATE_RET tkl_flash_get_one_type_info(TUYA_FLASH_TYPE_E type, TUYA_FLASH_BASE_INFO_T *info)
+{
+    memset(info, 0, sizeof(TUYA_FLASH_BASE_INFO_T));
+    info->partition_num = 1;
+    info->partition[0].block_size = BENCH_FLASH_BLOCK;
+    info->partition[0].start_addr = (TUYA_FLASH_TYPE_APP == type) ? BENCH_FLASH_APP_ADDR : 0;
+    info->partition[0].size = BENCH_FLASH_SIZE / 2;
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tkl_ota_get_ability(uint32_t *image_size, TUYA_OTA_TYPE_E *type)
+{
+    return OPRT_NOT_SUPPORTED;
+}
+
+OPERATE_RET tkl_ota_start_notify(uint32_t image_size, TUYA_OTA_TYPE_E type, TUYA_OTA_PATH_E path)
+{
+    return OPRT_NOT_SUPPORTED;
+}
+
+OPERATE_RET tkl_ota_data_process(TUYA_OTA_DATA_T *pack, uint32_t *remain_len)
+{
+    return OPRT_NOT_SUPPORTED;
+}
+
+OPERATE_RET tkl_ota_end_notify(BOOL_T reset)
+{
+    return OPRT_NOT_SUPPORTED;
+}
+
+/**
+ * @brief Only errors are printed, formatting every debug log would be
+ * measured as part of the modules.
+ */
+OPERATE_RET tal_log_print(const TAL_LOG_LEVEL_E level, const char *file, const int line, char *fmt, ...)
+{
+    va_list ap;
+
+    if (level > TAL_LOG_LEVEL_ERR) {
+        return OPRT_OK;
+    }
+
+    va_start(ap, fmt);
+    fprintf(stderr, "[E][%s:%d] ", file, line);
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tal_log_print_raw(const char *pFmt, ...)
+{
+    return OPRT_OK;
+}
+
+/**
+ * @brief A table of subscribers instead of tal_event.c, which pulls
+ * tal_api.h. Events are dispatched synchronously to the subscribers of the
+ * name, in the order they subscribed.
+ */
+OPERATE_RET tal_event_subscribe(const char *name, const char *desc, const EVENT_SUBSCRIBE_CB cb, SUBSCRIBE_TYPE_E type)
+{
+    uint32_t i;
+
+    for (i = 0; i < BENCH_EVENT_MAX; i++) {
+        if (NULL == sg_event_sub[i].cb) {
+            sg_event_sub[i].name = name;
+            sg_event_sub[i].cb = cb;
+            return OPRT_OK;
+        }
+    }
+
+    return OPRT_EXCEED_UPPER_LIMIT;
+}
+
+OPERATE_RET tal_event_publish(const char *name, void *data)
+{
+    uint32_t i;
+
+    for (i = 0; i < BENCH_EVENT_MAX; i++) {
+        if (sg_event_sub[i].cb && 0 == strcmp(sg_event_sub[i].name, name)) {
+            sg_event_sub[i].cb(data);
+        }
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief The files the CLI runs scripts from and the UTs read their data
+ * from, on the host file system instead of the littlefs of tal_fs.c.
+ */
+TUYA_FILE tal_fopen(const char *path, const char *mode)
+{
+    return (TUYA_FILE)fopen(path, mode);
+}
+
+int tal_fclose(TUYA_FILE file)
+{
+    return fclose((FILE *)file);
+}
+
+char *tal_fgets(char *buf, int len, TUYA_FILE file)
+{
+    return fgets(buf, len, (FILE *)file);
+}
+
+int tal_fread(void *buf, int bytes, TUYA_FILE file)
+{
+    return (int)fread(buf, 1, bytes, (FILE *)file);
+}
+
+int tal_fseek(TUYA_FILE file, int64_t offs, int whence)
+{
+    // the TUYA_SEEK_* values are the ones of stdio
+    return fseek((FILE *)file, (long)offs, whence);
+}
+
+/**
+ * @brief The random source of uni_random.c, from the fixed sequence of
+ * tkl_system_get_random rather than the TLS entropy of tuya_tls.c.
+ */
+int tuya_tls_random(unsigned char *output, size_t output_len)
+{
+    size_t i;
+
+    for (i = 0; i < output_len; i++) {
+        output[i] = (unsigned char)tkl_system_get_random(256);
+    }
+
+    return 0;
+}
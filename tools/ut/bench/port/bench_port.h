@@ -0,0 +1,94 @@
+/**
+ * @file bench_port.h
+ * @brief Host port of the benchmark runner.
+ *
+ * The benchmarks link the module sources against this port instead of a TKL
+ * platform: the heap counts every allocation done through tkl_system_malloc,
+ * the flash is kept in RAM, the UARTs are pseudo terminals and the logs are
+ * dropped, so the numbers only depend on the code under test.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __BENCH_PORT_H__
+#define __BENCH_PORT_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#ifndef BENCH_FLASH_SIZE
+#define BENCH_FLASH_SIZE (512 * 1024)
+#endif
+
+/* the APP partition, holding the running image of an OTA, is the upper half,
+ * every other type shares the lower one */
+#define BENCH_FLASH_APP_ADDR (BENCH_FLASH_SIZE / 2)
+
+#ifndef BENCH_FLASH_BLOCK
+#define BENCH_FLASH_BLOCK 4096
+#endif
+
+typedef struct {
+    uint64_t alloc_cnt; // malloc, calloc and realloc calls
+    uint64_t free_cnt;
+    size_t cur_bytes;   // bytes in use
+    size_t peak_bytes;  // highest cur_bytes since the last bench_heap_peak_reset
+} BENCH_HEAP_STAT_T;
+
+/***********************************************************
+*************************function define********************
+***********************************************************/
+/**
+ * @brief Gets the heap counters.
+ */
+void bench_heap_stat_get(BENCH_HEAP_STAT_T *stat);
+
+/**
+ * @brief Restarts the peak from the bytes in use now.
+ */
+void bench_heap_peak_reset(void);
+
+/**
+ * @brief Monotonic time in ns.
+ */
+uint64_t bench_time_ns(void);
+
+/**
+ * @brief Stops the millisecond clock of the TKL at now_ms, for tests that run
+ * on simulated time. bench_time_ns keeps running.
+ */
+void bench_clock_freeze(SYS_TIME_T now_ms);
+
+/**
+ * @brief Moves the frozen millisecond clock forward.
+ */
+void bench_clock_advance(SYS_TIME_T ms);
+
+/**
+ * @brief Lets the millisecond clock of the TKL run with the host again.
+ */
+void bench_clock_release(void);
+
+/**
+ * @brief Erases the whole RAM flash.
+ */
+void bench_flash_erase_all(void);
+
+/**
+ * @brief The far end of the wire of a host UART, the master fd of its pty.
+ * Valid between tkl_uart_init and tkl_uart_deinit of the port.
+ */
+int bench_uart_peer_fd(uint32_t port_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BENCH_PORT_H__ */
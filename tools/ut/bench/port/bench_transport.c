@@ -0,0 +1,160 @@
+/**
+ * @file bench_transport.c
+ * @brief Host transporter of the benchmark runner, plain TCP on BSD sockets.
+ *
+ * Stands in for tuya_transport.c and the TCP transporter, whose tal_network
+ * pulls tal_api.h and with it the submodules. It keeps their semantics where
+ * http_client_request relies on them: a read that times out returns
+ * OPRT_RESOURCE_NOT_READY, a read of a closed connection returns 0 and
+ * tuya_transporter_poll_read returns the readable count of a select. TLS and
+ * websocket transporters are not available.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "tuya_cloud_types.h"
+#include "tal_memory.h"
+#include "tuya_transporter.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+typedef struct {
+    struct tuya_transporter_inter_t base;
+    int fd;
+} BENCH_TRANSPORTER_T;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static int __fd_poll(int fd, short events, int timeout_ms)
+{
+    struct pollfd pfd = {.fd = fd, .events = events};
+    int ret = poll(&pfd, 1, timeout_ms);
+
+    if (ret > 0 && (pfd.revents & POLLERR)) {
+        return -1;
+    }
+
+    return ret;
+}
+
+tuya_transporter_t tuya_transporter_create(TUYA_TRANSPORT_TYPE_E transport_type, tuya_transporter_t dependency)
+{
+    BENCH_TRANSPORTER_T *t = NULL;
+
+    if (TRANSPORT_TYPE_TCP != transport_type) {
+        return NULL;
+    }
+
+    t = tal_malloc(sizeof(BENCH_TRANSPORTER_T));
+    if (t) {
+        memset(t, 0, sizeof(BENCH_TRANSPORTER_T));
+        t->fd = -1;
+    }
+
+    return (tuya_transporter_t)t;
+}
+
+OPERATE_RET tuya_transporter_destroy(tuya_transporter_t transporter)
+{
+    tal_free(transporter);
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tuya_transporter_connect(tuya_transporter_t transporter, const char *host, int port, int timeout_ms)
+{
+    BENCH_TRANSPORTER_T *t = (BENCH_TRANSPORTER_T *)transporter;
+    struct addrinfo hints = {.ai_family = AF_INET, .ai_socktype = SOCK_STREAM};
+    struct addrinfo *res = NULL;
+    char service[8];
+    int one = 1;
+
+    snprintf(service, sizeof(service), "%d", port);
+    if (0 != getaddrinfo(host, service, &hints, &res)) {
+        return OPRT_MID_TRANSPORT_DNS_PARSED_FAILED;
+    }
+
+    t->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (t->fd < 0 || 0 != connect(t->fd, res->ai_addr, res->ai_addrlen)) {
+        freeaddrinfo(res);
+        return OPRT_MID_TRANSPORT_TCP_CONNECD_FAILED;
+    }
+    freeaddrinfo(res);
+    setsockopt(t->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tuya_transporter_read(tuya_transporter_t transporter, uint8_t *buf, int len, int timeout_ms)
+{
+    BENCH_TRANSPORTER_T *t = (BENCH_TRANSPORTER_T *)transporter;
+    int ret = 0;
+
+    if (t->fd < 0) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (timeout_ms > 0) {
+        ret = __fd_poll(t->fd, POLLIN, timeout_ms);
+        if (ret < 0) {
+            return ret;
+        }
+        if (0 == ret) {
+            return OPRT_RESOURCE_NOT_READY;
+        }
+    }
+
+    return recv(t->fd, buf, len, 0);
+}
+
+OPERATE_RET tuya_transporter_write(tuya_transporter_t transporter, uint8_t *buf, int len, int timeout_ms)
+{
+    BENCH_TRANSPORTER_T *t = (BENCH_TRANSPORTER_T *)transporter;
+
+    if (t->fd < 0) {
+        return OPRT_INVALID_PARM;
+    }
+
+    // a device has no SIGPIPE, a write to a reset connection only fails
+    return send(t->fd, buf, len, MSG_NOSIGNAL);
+}
+
+OPERATE_RET tuya_transporter_poll_read(tuya_transporter_t transporter, int timeout_ms)
+{
+    BENCH_TRANSPORTER_T *t = (BENCH_TRANSPORTER_T *)transporter;
+
+    if (t->fd < 0) {
+        return OPRT_INVALID_PARM;
+    }
+
+    return __fd_poll(t->fd, POLLIN, timeout_ms);
+}
+
+OPERATE_RET tuya_transporter_close(tuya_transporter_t transporter)
+{
+    BENCH_TRANSPORTER_T *t = (BENCH_TRANSPORTER_T *)transporter;
+
+    if (t->fd >= 0) {
+        close(t->fd);
+        t->fd = -1;
+    }
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tuya_transporter_ctrl(tuya_transporter_t transporter, uint32_t cmd, void *args)
+{
+    return OPRT_NOT_SUPPORTED;
+}
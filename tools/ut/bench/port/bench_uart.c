@@ -0,0 +1,265 @@
+/**
+ * @file bench_uart.c
+ * @brief Host UART of the benchmark runner, every port is a pseudo terminal.
+ *
+ * tal_uart drives the slave side of the pty like a UART, the case plays the
+ * device at the other end of the wire through the master side. A thread per
+ * port stands for the interrupts: the rx one calls the rx callback while the
+ * slave has data and stops while tal holds rx off with
+ * tkl_uart_set_rx_flowctrl, the data then waits in the pty and the peer
+ * blocks like a sender seeing RTS. Once a tx callback is registered,
+ * tkl_uart_write only hands the buffer to the tx thread, which writes it out
+ * and calls the tx callback, the way a DMA does.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <termios.h>
+
+#include "tuya_cloud_types.h"
+#include "tkl_uart.h"
+#include "bench_port.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define BENCH_UART_NUM     4
+#define BENCH_UART_POLL_MS 20
+
+typedef struct {
+    int fd;      // slave, the UART of tal
+    int peer_fd; // master, the other end of the wire
+    uint32_t stop;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t rx_tid;
+    pthread_t tx_tid;
+    TUYA_UART_IRQ_CB rx_cb;
+    TUYA_UART_IRQ_CB tx_cb;
+    bool rx_held;
+    uint8_t *tx_buf;
+    uint32_t tx_len;
+} BENCH_UART_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static BENCH_UART_T sg_uart[BENCH_UART_NUM];
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static int __fd_wait(int fd, short events)
+{
+    struct pollfd pfd = {.fd = fd, .events = events};
+
+    return poll(&pfd, 1, BENCH_UART_POLL_MS);
+}
+
+static void *__rx_task(void *arg)
+{
+    BENCH_UART_T *uart = arg;
+    uint32_t port = uart - sg_uart;
+
+    while (!__atomic_load_n(&uart->stop, __ATOMIC_RELAXED)) {
+        pthread_mutex_lock(&uart->mutex);
+        while (uart->rx_held && !uart->stop) {
+            pthread_cond_wait(&uart->cond, &uart->mutex);
+        }
+        pthread_mutex_unlock(&uart->mutex);
+
+        if (__fd_wait(uart->fd, POLLIN) > 0 && uart->rx_cb) {
+            uart->rx_cb(port);
+        }
+    }
+
+    return NULL;
+}
+
+static void *__tx_task(void *arg)
+{
+    BENCH_UART_T *uart = arg;
+    uint32_t port = uart - sg_uart, sent;
+    int ret;
+
+    pthread_mutex_lock(&uart->mutex);
+    while (!uart->stop) {
+        if (0 == uart->tx_len) {
+            pthread_cond_wait(&uart->cond, &uart->mutex);
+            continue;
+        }
+        pthread_mutex_unlock(&uart->mutex);
+
+        for (sent = 0; sent < uart->tx_len && !__atomic_load_n(&uart->stop, __ATOMIC_RELAXED);) {
+            ret = write(uart->fd, uart->tx_buf + sent, uart->tx_len - sent);
+            if (ret > 0) {
+                sent += ret;
+            } else {
+                __fd_wait(uart->fd, POLLOUT);
+            }
+        }
+
+        pthread_mutex_lock(&uart->mutex);
+        uart->tx_len = 0;
+        pthread_mutex_unlock(&uart->mutex);
+        uart->tx_cb(port);
+        pthread_mutex_lock(&uart->mutex);
+    }
+    pthread_mutex_unlock(&uart->mutex);
+
+    return NULL;
+}
+
+int bench_uart_peer_fd(uint32_t port_id)
+{
+    return port_id < BENCH_UART_NUM ? sg_uart[port_id].peer_fd : -1;
+}
+
+OPERATE_RET tkl_uart_init(uint32_t port_id, TUYA_UART_BASE_CFG_T *cfg)
+{
+    BENCH_UART_T *uart = NULL;
+    struct termios tio;
+
+    if (port_id >= BENCH_UART_NUM) {
+        return OPRT_INVALID_PARM;
+    }
+    uart = &sg_uart[port_id];
+    memset(uart, 0, sizeof(BENCH_UART_T));
+
+    uart->peer_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (uart->peer_fd < 0 || grantpt(uart->peer_fd) || unlockpt(uart->peer_fd)) {
+        goto __ERR;
+    }
+    uart->fd = open(ptsname(uart->peer_fd), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (uart->fd < 0) {
+        goto __ERR;
+    }
+
+    // a UART moves bytes, no line discipline on either side
+    tcgetattr(uart->fd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(uart->fd, TCSANOW, &tio);
+    tcgetattr(uart->peer_fd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(uart->peer_fd, TCSANOW, &tio);
+
+    pthread_mutex_init(&uart->mutex, NULL);
+    pthread_cond_init(&uart->cond, NULL);
+    if (pthread_create(&uart->rx_tid, NULL, __rx_task, uart)) {
+        goto __ERR;
+    }
+
+    return OPRT_OK;
+
+__ERR:
+    if (uart->fd > 0) {
+        close(uart->fd);
+    }
+    if (uart->peer_fd > 0) {
+        close(uart->peer_fd);
+    }
+    return OPRT_COM_ERROR;
+}
+
+OPERATE_RET tkl_uart_deinit(uint32_t port_id)
+{
+    BENCH_UART_T *uart = NULL;
+
+    if (port_id >= BENCH_UART_NUM) {
+        return OPRT_INVALID_PARM;
+    }
+    uart = &sg_uart[port_id];
+
+    pthread_mutex_lock(&uart->mutex);
+    uart->stop = 1;
+    pthread_cond_broadcast(&uart->cond);
+    pthread_mutex_unlock(&uart->mutex);
+    pthread_join(uart->rx_tid, NULL);
+    if (uart->tx_cb) {
+        pthread_join(uart->tx_tid, NULL);
+    }
+
+    close(uart->fd);
+    close(uart->peer_fd);
+    pthread_mutex_destroy(&uart->mutex);
+    pthread_cond_destroy(&uart->cond);
+
+    return OPRT_OK;
+}
+
+int tkl_uart_write(uint32_t port_id, void *buff, uint16_t len)
+{
+    BENCH_UART_T *uart = &sg_uart[port_id];
+    int ret;
+
+    if (uart->tx_cb) {
+        pthread_mutex_lock(&uart->mutex);
+        uart->tx_buf = buff;
+        uart->tx_len = len;
+        pthread_cond_broadcast(&uart->cond);
+        pthread_mutex_unlock(&uart->mutex);
+        return len;
+    }
+
+    while ((ret = write(uart->fd, buff, len)) <= 0) {
+        __fd_wait(uart->fd, POLLOUT);
+    }
+
+    return ret;
+}
+
+int tkl_uart_read(uint32_t port_id, void *buff, uint16_t len)
+{
+    return read(sg_uart[port_id].fd, buff, len);
+}
+
+void tkl_uart_rx_irq_cb_reg(uint32_t port_id, TUYA_UART_IRQ_CB rx_cb)
+{
+    sg_uart[port_id].rx_cb = rx_cb;
+}
+
+void tkl_uart_tx_irq_cb_reg(uint32_t port_id, TUYA_UART_IRQ_CB tx_cb)
+{
+    BENCH_UART_T *uart = &sg_uart[port_id];
+
+    if (NULL == uart->tx_cb) {
+        uart->tx_cb = tx_cb;
+        pthread_create(&uart->tx_tid, NULL, __tx_task, uart);
+    }
+}
+
+OPERATE_RET tkl_uart_set_tx_int(uint32_t port_id, BOOL_T enable)
+{
+    return OPRT_NOT_SUPPORTED;
+}
+
+OPERATE_RET tkl_uart_set_rx_flowctrl(uint32_t port_id, BOOL_T enable)
+{
+    BENCH_UART_T *uart = &sg_uart[port_id];
+
+    pthread_mutex_lock(&uart->mutex);
+    uart->rx_held = enable;
+    pthread_cond_broadcast(&uart->cond);
+    pthread_mutex_unlock(&uart->mutex);
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tkl_uart_wait_for_data(uint32_t port_id, int timeout_ms)
+{
+    return OPRT_NOT_SUPPORTED;
+}
+
+OPERATE_RET tkl_uart_ioctl(uint32_t port_id, uint32_t cmd, void *arg)
+{
+    return OPRT_NOT_SUPPORTED;
+}
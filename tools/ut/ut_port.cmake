@@ -0,0 +1,51 @@
+##
+# @file ut_port.cmake
+# @brief Host port of the UT cases.
+#
+# A UT case compiles the module sources it tests, includes ${UT_INC} and
+# links [ut_port] and ${GTEST_LIB}. The port is the one of the benchmarks:
+# the TKL of the Linux porting template, a counted heap, a RAM flash and the
+# logs dropped, so no platform is needed. A case hashing or ciphering through
+# tal_security also links [ut_mbedtls].
+#/
+
+find_package(Threads REQUIRED)
+
+set(UT_SRC_DIR "${TOP_SOURCE_DIR}/src")
+set(UT_PORT_DIR "${TOP_SOURCE_DIR}/tools/ut/bench/port")
+
+file(GLOB UT_ADAPTER_INC LIST_DIRECTORIES true "${TOP_SOURCE_DIR}/tools/porting/adapter/*/include")
+set(UT_INC
+    ${UT_PORT_DIR}
+    ${TOP_BINARY_DIR}/include
+    ${UT_ADAPTER_INC}
+    ${UT_SRC_DIR}/common/include
+    ${UT_SRC_DIR}/common/utilities
+    ${UT_SRC_DIR}/tal_system/include
+    ${UT_SRC_DIR}/tal_driver/include
+    ${UT_SRC_DIR}/tal_cli/include
+    ${UT_SRC_DIR}/tal_kv/include
+    ${UT_SRC_DIR}/tal_kv/littlefs
+    ${UT_SRC_DIR}/tal_security/include
+    ${UT_SRC_DIR}/libtls/include
+    ${UT_SRC_DIR}/libtls/port
+    ${UT_SRC_DIR}/libtls/mbedtls-3.1.0/include
+    ${UT_SRC_DIR}/tuya_cloud_service/tls
+    )
+
+add_library(ut_port STATIC
+    ${UT_PORT_DIR}/bench_port.c
+    ${TOP_SOURCE_DIR}/tools/porting/template/linux/tkl_queue.c
+    ${TOP_SOURCE_DIR}/tools/porting/template/linux/tkl_semaphore.c
+    ${TOP_SOURCE_DIR}/tools/porting/template/linux/tkl_thread.c
+    ${UT_SRC_DIR}/tal_system/src/tal_system.c
+    ${UT_SRC_DIR}/tal_system/src/tal_api.c
+    )
+target_include_directories(ut_port PUBLIC ${UT_INC})
+target_link_libraries(ut_port PUBLIC Threads::Threads)
+
+# mbedtls is archived so only the objects a case reaches are linked
+file(GLOB UT_MBEDTLS_SRCS "${UT_SRC_DIR}/libtls/mbedtls-3.1.0/library/*.c")
+add_library(ut_mbedtls STATIC ${UT_MBEDTLS_SRCS})
+target_include_directories(ut_mbedtls PUBLIC ${UT_INC})
+target_compile_options(ut_mbedtls PRIVATE -O2 -w)